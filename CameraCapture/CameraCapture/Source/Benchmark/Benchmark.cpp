@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "BenchmarkHost.h"
+
+// copied next to the benchmark by the post build step
+#define BENCHMARK_PLUGIN L"CameraCapture.dll"
+
+#define BENCHMARK_DEFAULT_FRAMES 600
+#define BENCHMARK_DEFAULT_WIDTH 1280
+#define BENCHMARK_DEFAULT_HEIGHT 720
+#define BENCHMARK_DEFAULT_FRAME_RATE 120
+
+// the preview's texture ring, frames not released yet hold a texture each
+#define BENCHMARK_TEXTURE_COUNT 3
+
+// states taken per PollState
+#define BENCHMARK_POLLED_STATES 16
+
+// a stalled pipeline ends the run instead of hanging it
+#define BENCHMARK_TIMEOUT_MILLISECONDS 60000
+
+// CallbackMode::Polled, states wait in the plugin for PollState like the unity sample's
+#define BENCHMARK_CALLBACK_MODE_POLLED 1
+
+typedef int32_t(UNITY_INTERFACE_API* CreateCaptureFn)(StateChangedCallback fnCallback, void* managedObject, LPCWSTR videoDeviceId, INSTANCE_HANDLE* handleId);
+typedef int32_t(UNITY_INTERFACE_API* CaptureSetSyntheticSourceFn)(INSTANCE_HANDLE id, boolean enable, uint32_t frameRate, uint32_t jitterMs);
+typedef int32_t(UNITY_INTERFACE_API* CaptureStartPreviewFn)(INSTANCE_HANDLE id, uint32_t width, uint32_t height, boolean enableAudio, boolean enableMrc, uint32_t textureCount, uint32_t sampleRequests);
+typedef int32_t(UNITY_INTERFACE_API* CaptureStopPreviewFn)(INSTANCE_HANDLE id);
+typedef int32_t(UNITY_INTERFACE_API* CaptureReleaseFrameFn)(INSTANCE_HANDLE id, uint32_t textureIndex);
+typedef int32_t(UNITY_INTERFACE_API* CaptureGetStatsFn)(INSTANCE_HANDLE id, CAPTURE_STATS* stats);
+typedef int32_t(UNITY_INTERFACE_API* GetMemoryStatsFn)(TEXTURE_MEMORY_STATS* stats);
+typedef int32_t(UNITY_INTERFACE_API* SetCallbackModeFn)(INSTANCE_HANDLE id, int32_t callbackMode);
+typedef int32_t(UNITY_INTERFACE_API* PollStateFn)(INSTANCE_HANDLE id, CALLBACK_STATE* pStates, uint32_t capacity, uint32_t* pStateCount);
+typedef void(UNITY_INTERFACE_API* ReleaseInstanceFn)(INSTANCE_HANDLE id);
+
+// indexed by LatencyStage
+static wchar_t const* s_stageNames[LATENCY_STAGE_COUNT] = { L"sensor", L"queue", L"copy", L"transform", L"callback", L"pipeline" };
+
+// states are polled, only what's raised before the mode is set lands here
+static void __stdcall OnStateChanged(
+    _In_ void* callbackObject,
+    _In_ CALLBACK_STATE args)
+{
+    UNREFERENCED_PARAMETER(callbackObject);
+    UNREFERENCED_PARAMETER(args);
+}
+
+// the synthetic source pushes its frames into StreamSink::ProcessSample like the camera would,
+// each frame's latency is its time from the stream sink to the state callback, an instance left
+// by a failure is shut down by UnityPluginUnload
+static HRESULT RunCapture(
+    _In_ uint32_t frameCount,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _In_ uint32_t frameRate,
+    _In_ uint32_t jitterMs)
+{
+    auto& host = BenchmarkHost::Instance();
+
+    CreateCaptureFn createCapture = nullptr;
+    CaptureSetSyntheticSourceFn setSyntheticSource = nullptr;
+    CaptureStartPreviewFn startPreview = nullptr;
+    CaptureStopPreviewFn stopPreview = nullptr;
+    CaptureReleaseFrameFn releaseFrame = nullptr;
+    CaptureGetStatsFn getStats = nullptr;
+    GetMemoryStatsFn getMemoryStats = nullptr;
+    SetCallbackModeFn setCallbackMode = nullptr;
+    PollStateFn pollState = nullptr;
+    ReleaseInstanceFn releaseInstance = nullptr;
+    IFR(host.GetExport("CreateCapture", createCapture));
+    IFR(host.GetExport("CaptureSetSyntheticSource", setSyntheticSource));
+    IFR(host.GetExport("CaptureStartPreview", startPreview));
+    IFR(host.GetExport("CaptureStopPreview", stopPreview));
+    IFR(host.GetExport("CaptureReleaseFrame", releaseFrame));
+    IFR(host.GetExport("CaptureGetStats", getStats));
+    IFR(host.GetExport("GetMemoryStats", getMemoryStats));
+    IFR(host.GetExport("SetCallbackMode", setCallbackMode));
+    IFR(host.GetExport("PollState", pollState));
+    IFR(host.GetExport("ReleaseInstance", releaseInstance));
+
+    INSTANCE_HANDLE id = INSTANCE_HANDLE_INVALID;
+    IFR(createCapture(OnStateChanged, &host, nullptr, &id));
+    IFR(setCallbackMode(id, BENCHMARK_CALLBACK_MODE_POLLED));
+    IFR(setSyntheticSource(id, true, frameRate, jitterMs));
+    IFR(startPreview(id, width, height, false, false, BENCHMARK_TEXTURE_COUNT, 0));
+
+    wchar_t name[128]{};
+    StringCchPrintfW(name, ARRAYSIZE(name), L"CameraCapture preview, synthetic %ux%u at %u fps, %u ms jitter", width, height, frameRate, jitterMs);
+
+    BenchmarkResult result(name, L"stream sink to callback");
+    TEXTURE_MEMORY_STATS memoryStats{};
+
+    CALLBACK_STATE states[BENCHMARK_POLLED_STATES]{};
+    uint32_t warmupFrames = 0;
+
+    ULONGLONG timeout = GetTickCount64() + BENCHMARK_TIMEOUT_MILLISECONDS;
+    while (result.FrameCount() < frameCount)
+    {
+        if (GetTickCount64() > timeout)
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+        }
+
+        host.RunFrame();
+
+        uint32_t stateCount = 0;
+        IFR(pollState(id, states, ARRAYSIZE(states), &stateCount));
+
+        for (uint32_t i = 0; i < stateCount; ++i)
+        {
+            auto const& state = states[i];
+            if (state.type == CallbackType::Failed)
+            {
+                IFR(state.value.failedState.hresult);
+            }
+
+            if (state.type != CallbackType::Capture || state.value.captureState.stateType != CaptureStateType::PreviewVideoFrame)
+            {
+                continue;
+            }
+
+            auto const& captureState = state.value.captureState;
+
+            // the sensor stage is the synthetic source's own pacing, the rest is the plugin's
+            uint32_t latency = captureState.queueLatency + captureState.copyLatency + captureState.transformLatency + captureState.callbackLatency;
+
+            if (warmupFrames < BENCHMARK_WARMUP_FRAMES)
+            {
+                if (++warmupFrames == BENCHMARK_WARMUP_FRAMES)
+                {
+                    IFR(getMemoryStats(&memoryStats));
+
+                    result.Start(frameCount, &memoryStats);
+                }
+            }
+            else if (result.FrameCount() < frameCount)
+            {
+                result.AddFrame(latency / 1000.0);
+            }
+
+            if (captureState.textureIndex != UINT32_MAX)
+            {
+                IFR(releaseFrame(id, captureState.textureIndex));
+            }
+        }
+    }
+
+    IFR(getMemoryStats(&memoryStats));
+
+    result.Stop(&memoryStats);
+
+    CAPTURE_STATS stats{};
+    IFR(getStats(id, &stats));
+
+    IFR(stopPreview(id));
+
+    releaseInstance(id);
+
+    result.Print();
+
+    // the plugin's own rolling percentiles, per stage
+    for (uint32_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        wprintf(L"  %-10s p50 %.3f ms, p99 %.3f ms\n", s_stageNames[stage], stats.p50[stage] / 1000.0, stats.p99[stage] / 1000.0);
+    }
+
+    return S_OK;
+}
+
+// Benchmark.exe [frames] [width] [height] [frameRate] [jitterMs]
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    uint32_t frameCount = argc > 1 ? static_cast<uint32_t>(_wtoi(argv[1])) : BENCHMARK_DEFAULT_FRAMES;
+    uint32_t width = argc > 2 ? static_cast<uint32_t>(_wtoi(argv[2])) : BENCHMARK_DEFAULT_WIDTH;
+    uint32_t height = argc > 3 ? static_cast<uint32_t>(_wtoi(argv[3])) : BENCHMARK_DEFAULT_HEIGHT;
+    uint32_t frameRate = argc > 4 ? static_cast<uint32_t>(_wtoi(argv[4])) : BENCHMARK_DEFAULT_FRAME_RATE;
+    uint32_t jitterMs = argc > 5 ? static_cast<uint32_t>(_wtoi(argv[5])) : 0;
+    if (frameCount == 0 || width == 0 || height == 0 || frameRate == 0)
+    {
+        wprintf(L"usage: Benchmark.exe [frames] [width] [height] [frameRate] [jitterMs]\n");
+
+        return 1;
+    }
+
+    winrt::init_apartment();
+
+    auto& host = BenchmarkHost::Instance();
+
+    HRESULT hr = host.Load(BENCHMARK_PLUGIN);
+    if (SUCCEEDED(hr))
+    {
+        hr = RunCapture(frameCount, width, height, frameRate, jitterMs);
+    }
+
+    host.Unload();
+
+    if (FAILED(hr))
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<uint32_t>(hr));
+
+        return 1;
+    }
+
+    return 0;
+}
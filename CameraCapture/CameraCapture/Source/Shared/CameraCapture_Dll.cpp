@@ -3,12 +3,11 @@
 
 #include "pch.h"
 
-#include "Unity/IUnityGraphics.h"
-#include "PlatformBase.h"
-#include "UnityDeviceResource.h"
+#include "PluginDll.h"
 
 #include "Plugin.CaptureEngine.h"
 #include "Media.PayloadHandler.h"
+#include "Media.DeviceCache.h"
 
 namespace impl
 {
@@ -21,209 +20,710 @@ namespace winrt
     using namespace winrt::CameraCapture::Media::Capture;
 }
 
-static INSTANCE_HANDLE s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
-static std::unordered_map<INSTANCE_HANDLE, winrt::Module> s_instances;
-HRESULT GetModule(INSTANCE_HANDLE id, _Out_ winrt::Module& module)
+// async releases still tearing down, unload waits for them
+static CriticalSection s_releaseCs;
+static uint32_t s_pendingReleases = 0;
+static winrt::handle s_releasesDoneEvent(CreateEvent(nullptr, true, true, nullptr));
+
+// every capture gets its own payload handler, they all map into the same app coordinate system
+static winrt::Windows::Perception::Spatial::SpatialCoordinateSystem s_appCoordinateSystem = nullptr;
+
+void OnPluginLoad()
+{
+}
+
+void OnPluginUnloading()
+{
+}
+
+void OnPluginUnload()
 {
-    if (id < INSTANCE_HANDLE_START)
+    // the dll can't go away under a background teardown
+    WaitForSingleObject(s_releasesDoneEvent.get(), 15000);
+
+    DeviceCache::Instance().Shutdown();
+
+    // pooled textures keep their devices alive
+    SharedTexturePool::Instance().Clear();
+
+    s_appCoordinateSystem = nullptr;
+}
+
+void OnPluginDeviceResetStarted()
+{
+    SharedTexturePool::Instance().Clear();
+}
+
+
+// --------------------------------------------------------------------------
+// Other function
+static winrt::fire_and_forget ShutdownModuleAsync(
+    winrt::IModule module,
+    INSTANCE_HANDLE id,
+    ReleaseCompletedCallback fnCompleted,
+    void* completedObject)
+{
+    // stopping the preview waits on the capture, keep it off unity's thread
+    co_await winrt::resume_background();
+
+    module.Shutdown();
+    module = nullptr;
+
+    if (fnCompleted != nullptr)
     {
-        IFR(E_INVALIDARG);
+        fnCompleted(completedObject, id);
     }
 
-    auto it = s_instances.find(id);
-    if (it == s_instances.end())
+    auto guard = s_releaseCs.Guard();
+
+    if (--s_pendingReleases == 0)
     {
-        IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+        SetEvent(s_releasesDoneEvent.get());
     }
+}
 
-    module = it->second;
+// returns right away, the instance stops raising callbacks before this returns
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstanceAsync(
+    _In_ INSTANCE_HANDLE id,
+    _In_opt_ ReleaseCompletedCallback fnCompleted,
+    _In_opt_ void* completedObject)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModules().Remove(id, module);
+    if (SUCCEEDED(hr))
+    {
+        module.as<IModulePriv>()->DetachCallbacks();
 
-    NULL_CHK_HR(module, E_POINTER);
+        {
+            auto guard = s_releaseCs.Guard();
+
+            if (s_pendingReleases++ == 0)
+            {
+                ResetEvent(s_releasesDoneEvent.get());
+            }
+        }
+
+        ShutdownModuleAsync(module, id, fnCompleted, completedObject);
+    }
+
+    return hr;
+}
+
+// shared by every capture, idle textures past the budget are released oldest first
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureBudget(
+    _In_ uint64_t budgetBytes)
+{
+    SharedTexturePool::Instance().SetBudget(budgetBytes);
+}
+
+// frame delivery of captures started afterwards, a dedicated mmcss queue keeps it steady under load
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPayloadWorkQueue(
+    _In_ int32_t mode,
+    _In_ int32_t priority)
+{
+    return winrt::CameraCapture::Media::implementation::PayloadHandler::SetWorkQueue(static_cast<PayloadQueueMode>(mode), priority);
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetMemoryStats(
+    _Out_ TEXTURE_MEMORY_STATS* stats)
+{
+    NULL_CHK_HR(stats, E_INVALIDARG);
+
+    SharedTexturePool::Instance().GetStats(*stats);
 
     return S_OK;
 }
 
-static std::shared_ptr<IUnityDeviceResource> s_deviceResource;
-static UnityGfxRenderer s_deviceType = kUnityGfxRendererNull;
-static IUnityInterfaces* s_unityInterfaces = nullptr;
-static IUnityGraphics* s_unityGraphics = nullptr;
-static winrt::CameraCapture::Media::PayloadHandler s_payloadHandler = nullptr;
+// polled states are only handed out by PollState, nothing crosses into the client on media threads
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetCallbackMode(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t callbackMode)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        hr = module.as<IModulePriv>()->SetCallbackMode(static_cast<CallbackMode>(callbackMode));
+    }
+
+    return hr;
+}
 
-HRESULT TrackModule(winrt::Module &module, INSTANCE_HANDLE * handleId)
+// drains up to capacity queued states in the order they were raised
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PollState(
+    _In_ INSTANCE_HANDLE id,
+    _Out_writes_to_(capacity, *pStateCount) CALLBACK_STATE* pStates,
+    _In_ uint32_t capacity,
+    _Out_ uint32_t* pStateCount)
 {
-    // get the last index value;
-    auto handle = s_lastPluginHandleIndex;
+    NULL_CHK_HR(pStateCount, E_INVALIDARG);
+
+    *pStateCount = 0;
 
-    // add to map
-    auto success = s_instances.emplace(handle, module);
-    if (success.second)
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        *handleId = handle++;
-        s_lastPluginHandleIndex = handle;
+        hr = module.as<IModulePriv>()->PollState(pStates, capacity, pStateCount);
     }
 
-    return (success.second ? S_OK : E_UNEXPECTED);
+    return hr;
 }
 
-// --------------------------------------------------------------------------
-// UnitySetInterfaces
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces)
+// Capture
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateCapture(
+    _In_ StateChangedCallback fnCallback,
+    _In_ void* managedObject,
+    _In_opt_ LPCWSTR videoDeviceId,
+    _Out_ INSTANCE_HANDLE* handleId)
 {
-    s_lastPluginHandleIndex = INSTANCE_HANDLE_START;
-    s_instances.clear();
+    if (managedObject == nullptr)
+    {
+        return E_INVALIDARG;
+    }
 
-    s_unityInterfaces = unityInterfaces;
-    s_unityGraphics = s_unityInterfaces->Get<IUnityGraphics>();
-    s_unityGraphics->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
+    // null or empty picks the first camera
+    winrt::hstring deviceId = (videoDeviceId != nullptr) ? winrt::hstring(videoDeviceId) : winrt::hstring();
 
-    // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
-    OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
+    winrt::IModule module = impl::CaptureEngine::Create(GetUnityDeviceResource(), fnCallback, managedObject, deviceId);
+
+    return TrackModule(module, handleId);
 }
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStartPreview(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _In_ boolean enableAudio,
+    _In_ boolean enableMrc,
+    _In_ uint32_t textureCount,
+    _In_ uint32_t sampleRequests)
 {
-    for (auto&& kv : s_instances)
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        kv.second.Shutdown();
-        kv.second = nullptr;
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.StartPreview(width, height, enableAudio, enableMrc, textureCount, sampleRequests);
+        if (SUCCEEDED(hr))
+        {
+            // a shared handler would hand each capture the other cameras' frames
+            auto payloadHandler = capture.PayloadHandler();
+            if (payloadHandler == nullptr)
+            {
+                payloadHandler = winrt::CameraCapture::Media::PayloadHandler();
+                payloadHandler.AppCoordinateSystem(s_appCoordinateSystem);
+            }
+
+            capture.PayloadHandler(payloadHandler);
+        }
     }
-    s_instances.clear();
 
-    s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStopPreview(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.StopPreview();
+    }
 
-    s_unityGraphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+    return hr;
 }
 
-// --------------------------------------------------------------------------
-// GraphicsDeviceEvent
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureReleaseFrame(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t textureIndex)
 {
-    // Create graphics API implementation upon initialization
-    if (eventType == kUnityGfxDeviceEventInitialize)
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        assert(s_deviceResource == nullptr);
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
 
-        s_deviceType = s_unityGraphics->GetRenderer();
+        hr = capture.ReleaseFrame(textureIndex);
+    }
 
-        s_deviceResource = CreateDeviceResource(s_deviceType);
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetTextureSync(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t syncMode)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetTextureSync(syncMode);
     }
 
-    // Let the implementation process the device related event
-    if (s_deviceResource != nullptr)
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetPreviewFormat(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t previewFormat)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        s_deviceResource->ProcessDeviceEvent(eventType, s_unityInterfaces);
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetPreviewFormat(previewFormat);
     }
 
-    // Cleanup graphics API implementation upon shutdown
-    if (eventType == kUnityGfxDeviceEventShutdown)
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetZeroCopy(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        s_deviceResource.reset();
-        s_deviceResource = nullptr;
-        s_deviceType = kUnityGfxRendererNull;
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetZeroCopy(enable);
     }
+
+    return hr;
 }
 
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetKeepWarm(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetKeepWarm(enable);
+    }
 
-// --------------------------------------------------------------------------
-// OnRenderEvent
-// This will be called for GL.IssuePluginEvent script calls; eventID will
-// be the integer passed to IssuePluginEvent. In this example, we just ignore
-// that value.
-static void UNITY_INTERFACE_API OnRenderEvent(int32_t eventID)
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetSyntheticSource(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ uint32_t frameRate,
+    _In_ uint32_t jitterMs)
 {
-    DWORD dwId = static_cast<DWORD>(eventID);
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
 
-    INSTANCE_HANDLE id = static_cast<INSTANCE_HANDLE>(LOWORD(dwId));
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->SetSyntheticSource(enable, frameRate, jitterMs);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetSampleCopyCounts(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ uint64_t* gpuCopies,
+    _Out_ uint64_t* cpuCopies)
+{
+    NULL_CHK_HR(gpuCopies, E_INVALIDARG);
+    NULL_CHK_HR(cpuCopies, E_INVALIDARG);
 
-    winrt::Module module = nullptr;
-    if (SUCCEEDED(GetModule(id, module)))
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        uint16_t frameId = static_cast<uint16_t>(HIWORD(dwId));
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
 
-        module.OnRenderEvent(frameId);
+        hr = capture.GetSampleCopyCounts(*gpuCopies, *cpuCopies);
     }
+
+    return hr;
 }
 
-// --------------------------------------------------------------------------
-// GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
-extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc()
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetAudioBufferLength(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t milliseconds)
 {
-    return OnRenderEvent;
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetAudioBufferLength(milliseconds);
+    }
+
+    return hr;
 }
 
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetAudioFormat(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ uint32_t* sampleRate,
+    _Out_ uint32_t* channelCount)
+{
+    NULL_CHK_HR(sampleRate, E_INVALIDARG);
+    NULL_CHK_HR(channelCount, E_INVALIDARG);
 
-// --------------------------------------------------------------------------
-// Other function
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstance(
-    _In_ INSTANCE_HANDLE id)
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.GetAudioFormat(*sampleRate, *channelCount);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureReadAudio(
+    _In_ INSTANCE_HANDLE id,
+    _Out_writes_to_(count, *samplesRead) float* samples,
+    _In_ uint32_t count,
+    _Out_ int64_t* timestamp,
+    _Out_ uint32_t* samplesRead)
 {
-    winrt::Module module = nullptr;
-    if (SUCCEEDED(GetModule(id, module)))
+    NULL_CHK_HR(samples, E_INVALIDARG);
+    NULL_CHK_HR(timestamp, E_INVALIDARG);
+    NULL_CHK_HR(samplesRead, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        s_instances.erase(id);
-        module.Shutdown();
-        module = nullptr;
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.ReadAudio(winrt::array_view<float>(samples, samples + count), *samplesRead, *timestamp);
     }
+
+    return hr;
 }
 
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStartStreaming(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t codec,
+    _In_ uint32_t bitrate,
+    _In_ EncodedFrameCallback fnCallback,
+    _In_ void* callbackObject)
+{
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
 
-// Capture
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateCapture(
-    _In_ StateChangedCallback fnCallback,
-    _In_ void* managedObject,
-    _Out_ INSTANCE_HANDLE* handleId)
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        // the callback goes straight to the implementation, it can't cross the abi
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->StartStreaming(static_cast<VideoCodec>(codec), bitrate, fnCallback, callbackObject);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStopStreaming(
+    _In_ INSTANCE_HANDLE id)
 {
-    if (managedObject == nullptr)
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        return E_INVALIDARG;
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->StopStreaming();
     }
-    winrt::Module module = impl::CaptureEngine::Create(s_deviceResource, fnCallback, managedObject);
 
-    return TrackModule(module, handleId);
+    return hr;
 }
 
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStartPreview(
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStartFrameTap(
     _In_ INSTANCE_HANDLE id,
     _In_ uint32_t width,
     _In_ uint32_t height,
-    _In_ boolean enableAudio,
-    _In_ boolean enableMrc)
+    _In_ FrameTapCallback fnCallback,
+    _In_ void* callbackObject)
 {
-    winrt::Module module = nullptr;
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
     winrt::hresult hr = GetModule(id, module);
     if (SUCCEEDED(hr))
     {
         auto capture = module.as<winrt::CaptureEngine>();
         NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
 
-        hr = capture.StartPreview(width, height, enableAudio, enableMrc);
-        if (SUCCEEDED(hr))
-        {
-            if (s_payloadHandler == nullptr)
-            {
-                s_payloadHandler = winrt::CameraCapture::Media::PayloadHandler();
-            }
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->StartFrameTap(width, height, fnCallback, callbackObject);
+    }
 
-            capture.PayloadHandler(s_payloadHandler);
-        }
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStopFrameTap(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->StopFrameTap();
     }
 
     return hr;
 }
 
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStopPreview(
+// frames arrive as DepthVideoFrame or InfraredVideoFrame states, each is released with CaptureReleaseSourceFrame
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStartFrameSource(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t sourceKind)
+{
+    if (sourceKind < static_cast<int32_t>(FrameSourceKind::Depth) || sourceKind > static_cast<int32_t>(FrameSourceKind::Infrared))
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->StartFrameSource(static_cast<FrameSourceKind>(sourceKind), s_appCoordinateSystem);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStopFrameSource(
     _In_ INSTANCE_HANDLE id)
 {
-    winrt::Module module = nullptr;
+    winrt::IModule module = nullptr;
     winrt::hresult hr = GetModule(id, module);
     if (SUCCEEDED(hr))
     {
         auto capture = module.as<winrt::CaptureEngine>();
         NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
 
-        hr = capture.StopPreview();
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->StopFrameSource();
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureReleaseSourceFrame(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t textureIndex)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->ReleaseSourceFrame(textureIndex);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStartRecording(
+    _In_ INSTANCE_HANDLE id,
+    _In_z_ LPCWSTR path)
+{
+    NULL_CHK_HR(path, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.StartRecording(path);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureStopRecording(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.StopRecording();
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetTargetFrameRate(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t framesPerSecond)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetTargetFrameRate(framesPerSecond);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetPreviewResolution(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t width,
+    _In_ uint32_t height)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetPreviewResolution(width, height);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetSampleQueueOccupancy(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ float* averageOccupancy)
+{
+    NULL_CHK_HR(averageOccupancy, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.GetSampleQueueOccupancy(*averageOccupancy);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetStats(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ CAPTURE_STATS* stats)
+{
+    NULL_CHK_HR(stats, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->GetStats(*stats);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetIntrinsics(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ CAMERA_INTRINSICS* intrinsics)
+{
+    NULL_CHK_HR(intrinsics, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->GetIntrinsics(*intrinsics);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetRegionOfInterest(
+    _In_ INSTANCE_HANDLE id,
+    _In_ float x,
+    _In_ float y,
+    _In_ float width,
+    _In_ float height,
+    _In_ uint32_t outputWidth,
+    _In_ uint32_t outputHeight)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        REGION_OF_INTEREST region{ x, y, width, height, outputWidth, outputHeight };
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->SetRegionOfInterest(region);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetPhotoMode(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t photoMode)
+{
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.SetPhotoMode(photoMode);
     }
 
     return hr;
@@ -235,7 +735,7 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureTakePhoto(
     _In_ uint32_t height,
     _In_ boolean enableMrc)
 {
-    winrt::Module module = nullptr;
+    winrt::IModule module = nullptr;
     winrt::hresult hr = GetModule(id, module);
     if (SUCCEEDED(hr))
     {
@@ -248,11 +748,55 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureTakePhoto(
     return hr;
 }
 
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureTakeBurst(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t frameCount,
+    _In_ BurstCallback fnCallback,
+    _In_ void* callbackObject)
+{
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->TakeBurst(frameCount, fnCallback, callbackObject);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureTakeJpegPhoto(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _In_ boolean enableMrc,
+    _In_ EncodedPhotoCallback fnCallback,
+    _In_ void* callbackObject)
+{
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = winrt::get_self<impl::CaptureEngine>(capture)->TakeJpegPhoto(width, height, enableMrc, fnCallback, callbackObject);
+    }
+
+    return hr;
+}
+
 extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetCoordinateSystem(
     _In_ INSTANCE_HANDLE id,
     _In_ IUnknown* worldOrigin)
 {
-    winrt::Module module = nullptr;
+    winrt::IModule module = nullptr;
     winrt::hresult hr = GetModule(id, module);
     if (SUCCEEDED(hr))
     {
@@ -270,12 +814,22 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetCoordina
             }
         }
 
-        if (s_payloadHandler == nullptr)
+        s_appCoordinateSystem = coordinateSystem;
+
+        // the world origin is app wide, every running capture follows it
+        GetModules().ForEach([&coordinateSystem](INSTANCE_HANDLE, winrt::IModule const& instance)
         {
-            s_payloadHandler = winrt::CameraCapture::Media::PayloadHandler();
-        }
+            auto other = instance.try_as<winrt::CaptureEngine>();
+            if (other != nullptr && other.PayloadHandler() != nullptr)
+            {
+                other.PayloadHandler().AppCoordinateSystem(coordinateSystem);
+            }
 
-        s_payloadHandler.AppCoordinateSystem(coordinateSystem);
+            if (other != nullptr)
+            {
+                winrt::get_self<impl::CaptureEngine>(other)->FrameSourceCoordinateSystem(coordinateSystem);
+            }
+        });
     }
 
     return hr;
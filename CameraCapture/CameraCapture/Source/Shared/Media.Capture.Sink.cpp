@@ -5,6 +5,7 @@
 #include "Media.Capture.Sink.h"
 #include "Media.Capture.Sink.g.cpp"
 #include "Media.PayloadHandler.g.h"
+#include "Media.Payload.h"
 
 using namespace winrt;
 using namespace CameraCapture::Media::Capture::implementation;
@@ -17,6 +18,7 @@ Sink::Sink(MediaEncodingProfile const& encodingProfile)
     , m_mediaEncodingProfile(encodingProfile)
     , m_streamSinks()
     , m_payloadHandler(nullptr)
+    , m_recorder(nullptr)
 {
 
     if (encodingProfile.Audio() != nullptr)
@@ -41,7 +43,13 @@ Sink::Sink(MediaEncodingProfile const& encodingProfile)
 // IMediaExtension
 void Sink::SetProperties(Windows::Foundation::Collections::IPropertySet const& configuration)
 {
-    UNREFERENCED_PARAMETER(configuration);
+    auto guard = m_cs.Guard();
+
+    // each stream sink picks the keys that apply to it
+    for (auto&& streamSink : m_streamSinks)
+    {
+        streamSink.SetProperties(configuration);
+    }
 }
 
 // IMFMediaSink
@@ -467,6 +475,13 @@ void Sink::Reset()
         m_payloadHandler = nullptr;
     }
 
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Finalize();
+
+        m_recorder = nullptr;
+    }
+
     while (m_streamSinks.size() > 0)
     {
         m_streamSinks.front().Shutdown();
@@ -517,8 +532,109 @@ void Sink::QueuePayload(CameraCapture::Media::Payload const& payload)
 {
     auto guard = m_cs.Guard();
 
+    // the recorder gets every sample the stream sinks accept, the handler may drop under load
+    if (m_recorder != nullptr)
+    {
+        auto streamSample = payload.try_as<IStreamSample>();
+        if (streamSample != nullptr)
+        {
+            m_recorder->WriteSample(streamSample->MajorType(), streamSample->Sample());
+        }
+    }
+
     if (m_payloadHandler != nullptr)
     {
         m_payloadHandler.QueuePayload(payload);
     }
 }
+
+// Sink
+_Use_decl_annotations_
+HRESULT Sink::StartRecording(
+    LPCWSTR path,
+    com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager)
+{
+    Log(L"Sink::StartRecording()\n");
+
+    auto guard = m_cs.Guard();
+
+    IFR(CheckShutdown());
+
+    if (m_recorder != nullptr)
+    {
+        IFR(MF_E_INVALIDREQUEST);
+    }
+
+    // the recorder takes the same media types the capture pipeline negotiated with us
+    com_ptr<IMFMediaType> videoType = nullptr;
+    com_ptr<IMFMediaType> audioType = nullptr;
+    for (auto&& streamSink : m_streamSinks)
+    {
+        auto typeHandler = streamSink.as<IMFMediaTypeHandler>();
+
+        GUID majorType = GUID_NULL;
+        IFR(typeHandler->GetMajorType(&majorType));
+
+        com_ptr<IMFMediaType> mediaType = nullptr;
+        if (FAILED(typeHandler->GetCurrentMediaType(mediaType.put())) || mediaType == nullptr)
+        {
+            continue;
+        }
+
+        if (MFMediaType_Video == majorType)
+        {
+            videoType = mediaType;
+        }
+        else if (MFMediaType_Audio == majorType)
+        {
+            audioType = mediaType;
+        }
+    }
+
+    NULL_CHK_HR(videoType, MF_E_INVALIDMEDIATYPE);
+
+    IFR(Recorder::Create(path, dxgiDeviceManager, videoType, audioType, m_recorder));
+
+    return S_OK;
+}
+
+float Sink::VideoQueueOccupancy()
+{
+    auto guard = m_cs.Guard();
+
+    for (auto&& streamSink : m_streamSinks)
+    {
+        GUID majorType = GUID_NULL;
+        if (SUCCEEDED(streamSink.as<IMFMediaTypeHandler>()->GetMajorType(&majorType)) && MFMediaType_Video == majorType)
+        {
+            return get_self<StreamSink>(streamSink)->AverageQueueOccupancy();
+        }
+    }
+
+    return 0.0f;
+}
+
+HRESULT Sink::StopRecording()
+{
+    Log(L"Sink::StopRecording()\n");
+
+    com_ptr<Recorder> recorder = nullptr;
+    {
+        auto guard = m_cs.Guard();
+
+        recorder = m_recorder;
+        m_recorder = nullptr;
+    }
+
+    NULL_CHK_HR(recorder, MF_E_INVALIDREQUEST);
+
+    // closing the file can take a while, don't hold up the stream sinks
+    return recorder->Finalize();
+}
+
+bool Sink::IsRecording()
+{
+    auto guard = m_cs.Guard();
+
+    return m_recorder != nullptr;
+}
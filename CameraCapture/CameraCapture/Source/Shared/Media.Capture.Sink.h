@@ -6,6 +6,7 @@
 #include "Media.Capture.Sink.g.h"
 #include "Media.Capture.StreamSink.h"
 #include "Media.PayloadHandler.g.h"
+#include "Media.Recorder.h"
 
 #include <mfapi.h>
 #include <mfidl.h>
@@ -81,6 +82,16 @@ namespace winrt::CameraCapture::Media::Capture::implementation
         }
         Windows::Media::MediaProperties::MediaEncodingProfile EncodingProfile() { return m_mediaEncodingProfile; }
 
+        // tees the stream samples into a fragmented mp4, preview keeps running
+        HRESULT StartRecording(
+            _In_ LPCWSTR path,
+            _In_ com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager);
+        HRESULT StopRecording();
+        bool IsRecording();
+
+        // average payloads held downstream of the video stream sink
+        float VideoQueueOccupancy();
+
     private:
         void Reset();
 
@@ -112,6 +123,8 @@ namespace winrt::CameraCapture::Media::Capture::implementation
         com_ptr<IMFPresentationClock> m_presentationClock;
 
         CameraCapture::Media::PayloadHandler m_payloadHandler;
+
+        com_ptr<Recorder> m_recorder;
     };
 }
 
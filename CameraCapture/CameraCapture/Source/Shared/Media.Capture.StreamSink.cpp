@@ -27,8 +27,11 @@ StreamSink::StreamSink(
     , m_setDiscontinuity(false)
     , m_enableSampleRequests(true)
     , m_sampleRequests(0)
+    , m_maxSampleRequests(DEFAULT_SAMPLE_REQUESTS)
     , m_lastTimestamp(-1)
     , m_lastDecodeTime(-1)
+    , m_frameInterval(0)
+    , m_nextFrameTime(-1)
 {
     IFT(MFCreateMediaTypeFromProperties(winrt::get_unknown(m_encodingProperties), m_mediaType.put()));
     IFT(m_mediaType->GetGUID(MF_MT_MAJOR_TYPE, &m_guidMajorType));
@@ -45,8 +48,11 @@ StreamSink::StreamSink(
     , m_setDiscontinuity(false)
     , m_enableSampleRequests(true)
     , m_sampleRequests(0)
+    , m_maxSampleRequests(DEFAULT_SAMPLE_REQUESTS)
     , m_lastTimestamp(-1)
     , m_lastDecodeTime(-1)
+    , m_frameInterval(0)
+    , m_nextFrameTime(-1)
 {
     m_mediaType.copy_from(pMediaType);
     IFT(pMediaType->GetGUID(MF_MT_MAJOR_TYPE, &m_guidMajorType));
@@ -58,7 +64,30 @@ StreamSink::StreamSink(
 // IMediaExtension
 void StreamSink::SetProperties(IPropertySet const& configuration)
 {
-    UNREFERENCED_PARAMETER(configuration);
+    if (configuration == nullptr)
+    {
+        return;
+    }
+
+    // 1 for the lowest latency, 3-4 to absorb bursts like mrc composition spikes
+    auto requestsKey = MFMediaType_Video == m_guidMajorType ? PROPERTY_VIDEOSAMPLEREQUESTS : PROPERTY_AUDIOSAMPLEREQUESTS;
+    if (configuration.HasKey(requestsKey))
+    {
+        auto sampleRequests = unbox_value<uint32_t>(configuration.Lookup(requestsKey));
+
+        auto guard = m_cs.Guard();
+
+        // a lower depth takes effect as the outstanding requests are served
+        m_maxSampleRequests = static_cast<uint8_t>(sampleRequests > 0 ? min(sampleRequests, static_cast<uint32_t>(MAX_SAMPLE_REQUESTS)) : DEFAULT_SAMPLE_REQUESTS);
+    }
+
+    // only video is throttled, audio packets are never dropped for rate
+    if (MFMediaType_Video == m_guidMajorType && configuration.HasKey(PROPERTY_TARGETFRAMEINTERVAL))
+    {
+        auto frameInterval = unbox_value<int64_t>(configuration.Lookup(PROPERTY_TARGETFRAMEINTERVAL));
+
+        m_frameInterval = frameInterval > 0 ? frameInterval : 0;
+    }
 }
 
 // IMFStreamSink
@@ -132,6 +161,11 @@ HRESULT StreamSink::ProcessSample(
 
     bool shouldDrop = false;
 
+    // before the lock, waiting on it is part of the pipeline latency
+    LONGLONG receivedTime = QueryPerformanceTime();
+
+    PLUGIN_TRACE_SCOPE("StreamSink.ProcessSample", PLUGIN_TRACE_KEYWORD_SAMPLE);
+
     auto guard = m_cs.Guard();
 
     IFG(CheckShutdown(), done);
@@ -155,12 +189,11 @@ HRESULT StreamSink::ProcessSample(
         com_ptr<IMFSample> spSample = nullptr;
         spSample.copy_from(pSample); //add ref
 
-        auto payload = CameraCapture::Media::Payload();
-        auto streamSample = payload.try_as<IStreamSample>();
-        if (streamSample != nullptr)
-        {
-            streamSample->Sample(m_guidMajorType, m_mediaType, spSample);
-        }
+        // reuses a payload the consumer is done with
+        CameraCapture::Media::Payload payload = nullptr;
+        IFG(m_payloadPool.Acquire(m_guidMajorType, m_mediaType, spSample, payload), done);
+
+        payload.as<IStreamSample>()->MarkStage(PayloadStage::Received, receivedTime);
 
         m_parentSink.QueuePayload(payload);
     }
@@ -381,6 +414,7 @@ HRESULT StreamSink::Start(int64_t systemTime, int64_t clockStartOffset)
     IFR(CheckShutdown());
 
     m_clockStartOffset = clockStartOffset;
+    m_nextFrameTime = -1;
 
     State(State::Started);
 
@@ -430,6 +464,8 @@ HRESULT StreamSink::Shutdown()
     m_mediaType = nullptr;
     m_parentSink = nullptr;
 
+    m_payloadPool.Clear();
+
     return S_OK;
 }
 
@@ -483,7 +519,7 @@ HRESULT StreamSink::NotifyMarker(const PROPVARIANT *pVarContextValue)
 _Use_decl_annotations_
 HRESULT StreamSink::NotifyRequestSample()
 {
-    for (DWORD i = m_sampleRequests; i < m_cMaxSampleRequests; i++)
+    for (DWORD i = m_sampleRequests; i < m_maxSampleRequests; i++)
     {
         m_sampleRequests++;
 
@@ -538,17 +574,24 @@ HRESULT StreamSink::ShouldDropSample(
         // No MFSampleExtension_DecodeTimestamp means DTS eaqual to PTS, using timestamp
         if (timestamp <= m_lastDecodeTime)
         {
-            Log(L"received sample with past timestamp, ts=%I64d (timestamp) m_lastDecodeTime=%I64d; dropping\n", timestamp, m_lastDecodeTime);
+            TraceLoggingWrite(g_hPluginTraceProvider, "StreamSink.PastTimestamp",
+                TraceLoggingLevel(WINEVENT_LEVEL_WARNING),
+                TraceLoggingKeyword(PLUGIN_TRACE_KEYWORD_SAMPLE),
+                TraceLoggingInt64(timestamp, "Timestamp"),
+                TraceLoggingInt64(m_lastDecodeTime, "LastDecodeTime"));
             *pDrop = true;
         }
     }
     else
     {
         hasDecodeTime = true;
-        Log(L"DTS exists, DTS=%I64d PTS=%I64d\n", decodeTime, timestamp);
         if (decodeTime <= m_lastDecodeTime)
         {
-            Log(L"received sample with past timestamp, ts=%I64d (decodeTime) m_lastDecodeTime=%I64d; dropping\n", decodeTime, m_lastDecodeTime);
+            TraceLoggingWrite(g_hPluginTraceProvider, "StreamSink.PastTimestamp",
+                TraceLoggingLevel(WINEVENT_LEVEL_WARNING),
+                TraceLoggingKeyword(PLUGIN_TRACE_KEYWORD_SAMPLE),
+                TraceLoggingInt64(decodeTime, "Timestamp"),
+                TraceLoggingInt64(m_lastDecodeTime, "LastDecodeTime"));
             *pDrop = true;
         }
     }
@@ -556,7 +599,10 @@ HRESULT StreamSink::ShouldDropSample(
     IFG(pSample->GetTotalLength(&totalLength), done);
     if (0 == totalLength)
     {
-        Log(L"received 0 length sample; dropping\n");
+        TraceLoggingWrite(g_hPluginTraceProvider, "StreamSink.EmptySample",
+            TraceLoggingLevel(WINEVENT_LEVEL_WARNING),
+            TraceLoggingKeyword(PLUGIN_TRACE_KEYWORD_SAMPLE),
+            TraceLoggingInt64(timestamp, "Timestamp"));
         *pDrop = true;
     }
 
@@ -575,6 +621,26 @@ HRESULT StreamSink::ShouldDropSample(
         {
             m_lastDecodeTime = timestamp;
         }
+
+        // frames over the target rate are expected, they don't mark a discontinuity
+        LONGLONG frameInterval = m_frameInterval;
+        if (frameInterval > 0)
+        {
+            // an eighth of the interval absorbs the camera's timestamp jitter
+            if (m_nextFrameTime >= 0 && timestamp < m_nextFrameTime - frameInterval / 8)
+            {
+                *pDrop = true;
+            }
+            else if (m_nextFrameTime < 0 || timestamp >= m_nextFrameTime + frameInterval)
+            {
+                // first frame or after a stall, restart the grid instead of bursting to catch up
+                m_nextFrameTime = timestamp + frameInterval;
+            }
+            else
+            {
+                m_nextFrameTime += frameInterval;
+            }
+        }
     }
 
 done:
@@ -9,7 +9,17 @@
 #include <mfidl.h>
 #include <mferror.h>
 
-#define MAX_SAMPLE_REQUESTS 2
+#include "Media.PayloadPool.h"
+
+#define DEFAULT_SAMPLE_REQUESTS 2
+#define MAX_SAMPLE_REQUESTS 4
+
+// UInt32, outstanding MEStreamSinkRequestSample events per stream, 0 restores the default
+#define PROPERTY_VIDEOSAMPLEREQUESTS L"VideoSampleRequests"
+#define PROPERTY_AUDIOSAMPLEREQUESTS L"AudioSampleRequests"
+
+// Int64, 100ns between delivered video frames, 0 delivers every frame
+#define PROPERTY_TARGETFRAMEINTERVAL L"TargetFrameInterval"
 
 namespace winrt::CameraCapture::Media::Capture::implementation
 {
@@ -81,6 +91,8 @@ namespace winrt::CameraCapture::Media::Capture::implementation
         HRESULT Shutdown();
 
         Capture::State State() { auto guard = m_cs.Guard(); return m_currentState; }
+
+        float AverageQueueOccupancy() const { return m_payloadPool.AverageOccupancy(); }
         void State(Capture::State const& value) { m_currentState = value; }
 
     private:
@@ -135,14 +147,18 @@ namespace winrt::CameraCapture::Media::Capture::implementation
 
         CameraCapture::Media::Capture::Sink m_parentSink;
         com_ptr<IMFMediaEventQueue> m_eventQueue;
+        PayloadPool m_payloadPool;
 
         bool m_setDiscontinuity;
         bool m_enableSampleRequests;
         uint8_t m_sampleRequests;
+        uint8_t m_maxSampleRequests;
         LONGLONG m_lastTimestamp;
         LONGLONG m_lastDecodeTime;
 
-        static const uint8_t m_cMaxSampleRequests = MAX_SAMPLE_REQUESTS;
+        // target frame rate, samples arriving before m_nextFrameTime are dropped
+        std::atomic<LONGLONG> m_frameInterval;
+        LONGLONG m_nextFrameTime;
     };
 }
 
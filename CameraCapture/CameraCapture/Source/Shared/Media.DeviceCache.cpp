@@ -0,0 +1,428 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.DeviceCache.h"
+#include "Media.Functions.h"
+
+#include "PipelineCache.h"
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Foundation::Collections;
+using namespace winrt::Windows::Devices::Enumeration;
+using namespace winrt::Windows::Media::Capture;
+using namespace winrt::Windows::Media::Devices;
+using namespace winrt::Windows::Media::MediaProperties;
+
+// pipeline cache keys, device ids never have a tab or a line break in them
+static std::wstring FirstDeviceKey(
+    DeviceClass const deviceClass)
+{
+    return L"FirstDevice:" + std::to_wstring(static_cast<int32_t>(deviceClass));
+}
+
+static std::wstring ProfileSupportKey(
+    hstring const& deviceId)
+{
+    return L"VideoProfileSupported:" + std::wstring(deviceId);
+}
+
+static std::wstring KnownGoodProfileKey(
+    hstring const& deviceId,
+    KnownVideoProfile const knownVideoProfile,
+    MediaStreamType const mediaStreamType,
+    uint32_t width,
+    uint32_t height)
+{
+    return L"KnownGoodProfile:" + std::wstring(deviceId)
+        + L"|" + std::to_wstring(static_cast<int32_t>(knownVideoProfile))
+        + L"|" + std::to_wstring(static_cast<int32_t>(mediaStreamType))
+        + L"|" + std::to_wstring(width) + L"x" + std::to_wstring(height);
+}
+
+// the profile id last, it's the only free form part
+static std::wstring DescribeProfile(
+    MediaCaptureVideoProfile const& videoProfile,
+    MediaCaptureVideoProfileMediaDescription const& mediaDescription)
+{
+    return std::wstring(mediaDescription.Subtype())
+        + L"|" + std::to_wstring(mediaDescription.Width())
+        + L"|" + std::to_wstring(mediaDescription.Height())
+        + L"|" + std::to_wstring(mediaDescription.FrameRate())
+        + L"|" + std::wstring(videoProfile.Id());
+}
+
+DeviceCache& DeviceCache::Instance()
+{
+    static DeviceCache s_deviceCache;
+
+    return s_deviceCache;
+}
+
+DeviceCache::DeviceCache()
+    : m_generation(0)
+{
+}
+
+_Use_decl_annotations_
+IAsyncOperation<DeviceInformation> DeviceCache::FirstDeviceAsync(
+    DeviceClass const deviceClass)
+{
+    uint32_t generation = 0;
+    {
+        auto guard = m_cs.Guard();
+
+        auto it = m_firstDevices.find(deviceClass);
+        if (it != m_firstDevices.end())
+        {
+            co_return it->second;
+        }
+
+        Watch(deviceClass);
+
+        generation = m_generation;
+    }
+
+    // not under the lock, enumeration can take a while
+    auto deviceInfo = co_await GetFirstDeviceAsync(deviceClass);
+
+    {
+        auto guard = m_cs.Guard();
+
+        // a device changed while enumerating, the next caller looks again
+        if (generation == m_generation)
+        {
+            if (deviceInfo != nullptr)
+            {
+                m_firstDevices[deviceClass] = deviceInfo;
+
+                PipelineCache::Instance().Set(FirstDeviceKey(deviceClass), std::wstring(deviceInfo.Id()));
+            }
+            else
+            {
+                PipelineCache::Instance().Remove(FirstDeviceKey(deviceClass));
+            }
+        }
+    }
+
+    co_return deviceInfo;
+}
+
+_Use_decl_annotations_
+IAsyncOperation<hstring> DeviceCache::FirstDeviceIdAsync(
+    DeviceClass const deviceClass)
+{
+    {
+        auto guard = m_cs.Guard();
+
+        auto it = m_firstDevices.find(deviceClass);
+        if (it != m_firstDevices.end())
+        {
+            co_return it->second.Id();
+        }
+    }
+
+    std::wstring deviceId;
+    if (PipelineCache::Instance().TryGet(FirstDeviceKey(deviceClass), deviceId) && !deviceId.empty())
+    {
+        ValidateFirstDeviceAsync(deviceClass);
+
+        co_return hstring(deviceId);
+    }
+
+    auto deviceInfo = co_await FirstDeviceAsync(deviceClass);
+
+    co_return deviceInfo != nullptr ? deviceInfo.Id() : hstring();
+}
+
+_Use_decl_annotations_
+bool DeviceCache::IsVideoProfileSupported(
+    hstring const& deviceId)
+{
+    auto guard = m_cs.Guard();
+
+    std::wstring key(deviceId);
+
+    auto it = m_profileSupport.find(key);
+    if (it != m_profileSupport.end())
+    {
+        return it->second;
+    }
+
+    // only a capture that initialized stores it, it's cleared again when one fails
+    std::wstring persisted;
+    if (PipelineCache::Instance().TryGet(ProfileSupportKey(deviceId), persisted))
+    {
+        bool supported = persisted == L"1";
+
+        m_profileSupport[key] = supported;
+
+        return supported;
+    }
+
+    bool supported = MediaCapture::IsVideoProfileSupported(deviceId);
+
+    m_profileSupport[key] = supported;
+
+    return supported;
+}
+
+_Use_decl_annotations_
+IVectorView<MediaCaptureVideoProfile> DeviceCache::FindKnownVideoProfiles(
+    hstring const& deviceId,
+    KnownVideoProfile const knownVideoProfile)
+{
+    auto guard = m_cs.Guard();
+
+    std::wstring key = std::wstring(deviceId) + L"|" + std::to_wstring(static_cast<int32_t>(knownVideoProfile));
+
+    auto it = m_videoProfiles.find(key);
+    if (it != m_videoProfiles.end())
+    {
+        return it->second;
+    }
+
+    auto profiles = MediaCapture::FindKnownVideoProfiles(deviceId, knownVideoProfile);
+
+    m_videoProfiles[key] = profiles;
+
+    return profiles;
+}
+
+_Use_decl_annotations_
+IVectorView<IMediaEncodingProperties> DeviceCache::GetAvailableMediaStreamProperties(
+    VideoDeviceController const& videoDeviceController,
+    MediaStreamType const mediaStreamType)
+{
+    auto guard = m_cs.Guard();
+
+    std::wstring key = std::wstring(videoDeviceController.Id()) + L"|" + std::to_wstring(static_cast<int32_t>(mediaStreamType));
+
+    auto it = m_streamProperties.find(key);
+    if (it != m_streamProperties.end())
+    {
+        return it->second;
+    }
+
+    auto properties = videoDeviceController.GetAvailableMediaStreamProperties(mediaStreamType);
+
+    // a device that isn't started yet can report nothing, ask again next time
+    if (properties.Size() > 0)
+    {
+        m_streamProperties[key] = properties;
+    }
+
+    return properties;
+}
+
+_Use_decl_annotations_
+bool DeviceCache::FindKnownGoodProfile(
+    hstring const& deviceId,
+    KnownVideoProfile const knownVideoProfile,
+    MediaStreamType const mediaStreamType,
+    uint32_t width,
+    uint32_t height,
+    MediaCaptureVideoProfile& videoProfile,
+    MediaCaptureVideoProfileMediaDescription& mediaDescription)
+{
+    videoProfile = nullptr;
+    mediaDescription = nullptr;
+
+    std::wstring knownGood;
+    if (!PipelineCache::Instance().TryGet(KnownGoodProfileKey(deviceId, knownVideoProfile, mediaStreamType, width, height), knownGood))
+    {
+        return false;
+    }
+
+    // the profile objects only come from the device, the match skips the search by size and rate
+    for (auto const& profile : FindKnownVideoProfiles(deviceId, knownVideoProfile))
+    {
+        auto const& descriptions = mediaStreamType == MediaStreamType::VideoPreview ? profile.SupportedPreviewMediaDescription() : profile.SupportedRecordMediaDescription();
+        for (auto const& description : descriptions)
+        {
+            if (DescribeProfile(profile, description) == knownGood)
+            {
+                videoProfile = profile;
+                mediaDescription = description;
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+_Use_decl_annotations_
+void DeviceCache::SetKnownGood(
+    hstring const& deviceId,
+    KnownVideoProfile const knownVideoProfile,
+    MediaStreamType const mediaStreamType,
+    uint32_t width,
+    uint32_t height,
+    MediaCaptureVideoProfile const& videoProfile,
+    MediaCaptureVideoProfileMediaDescription const& mediaDescription)
+{
+    auto& pipelineCache = PipelineCache::Instance();
+
+    bool supported = videoProfile != nullptr && mediaDescription != nullptr;
+
+    pipelineCache.Set(ProfileSupportKey(deviceId), supported ? L"1" : L"0");
+
+    auto key = KnownGoodProfileKey(deviceId, knownVideoProfile, mediaStreamType, width, height);
+    if (supported)
+    {
+        pipelineCache.Set(key, DescribeProfile(videoProfile, mediaDescription));
+    }
+    else
+    {
+        pipelineCache.Remove(key);
+    }
+}
+
+_Use_decl_annotations_
+bool DeviceCache::ForgetKnownGood(
+    hstring const& deviceId,
+    KnownVideoProfile const knownVideoProfile,
+    MediaStreamType const mediaStreamType,
+    uint32_t width,
+    uint32_t height)
+{
+    auto& pipelineCache = PipelineCache::Instance();
+
+    bool forgotten = false;
+    {
+        auto guard = m_cs.Guard();
+
+        m_profileSupport.erase(std::wstring(deviceId));
+
+        // an id this launch enumerated is current whatever initialize made of it
+        std::wstring firstDeviceId;
+        if (m_firstDevices.find(DeviceClass::VideoCapture) == m_firstDevices.end()
+            && pipelineCache.TryGet(FirstDeviceKey(DeviceClass::VideoCapture), firstDeviceId)
+            && firstDeviceId == deviceId)
+        {
+            forgotten |= pipelineCache.Remove(FirstDeviceKey(DeviceClass::VideoCapture));
+        }
+    }
+
+    forgotten |= pipelineCache.Remove(ProfileSupportKey(deviceId));
+    forgotten |= pipelineCache.Remove(KnownGoodProfileKey(deviceId, knownVideoProfile, mediaStreamType, width, height));
+
+    return forgotten;
+}
+
+void DeviceCache::Shutdown()
+{
+    auto guard = m_cs.Guard();
+
+    for (auto& kv : m_watchers)
+    {
+        auto& watcher = kv.second;
+
+        watcher->added.revoke();
+        watcher->removed.revoke();
+        watcher->updated.revoke();
+        watcher->enumerationCompleted.revoke();
+
+        auto status = watcher->watcher.Status();
+        if (status == DeviceWatcherStatus::Started || status == DeviceWatcherStatus::EnumerationCompleted)
+        {
+            watcher->watcher.Stop();
+        }
+    }
+    m_watchers.clear();
+    m_enumerated.clear();
+
+    Clear();
+}
+
+// private, called under m_cs
+_Use_decl_annotations_
+void DeviceCache::Watch(
+    DeviceClass const deviceClass)
+{
+    if (m_watchers.find(deviceClass) != m_watchers.end())
+    {
+        return;
+    }
+
+    auto watcher = std::make_unique<Watcher>(Watcher{ DeviceInformation::CreateWatcher(deviceClass) });
+
+    // handlers only touch the cache, never the watcher entry it may be tearing down
+    watcher->added = watcher->watcher.Added(auto_revoke, [this, deviceClass](auto const&, auto const&)
+        {
+            OnDevicesChanged(deviceClass);
+        });
+    watcher->removed = watcher->watcher.Removed(auto_revoke, [this, deviceClass](auto const&, auto const&)
+        {
+            OnDevicesChanged(deviceClass);
+        });
+    watcher->updated = watcher->watcher.Updated(auto_revoke, [this, deviceClass](auto const&, auto const&)
+        {
+            OnDevicesChanged(deviceClass);
+        });
+    watcher->enumerationCompleted = watcher->watcher.EnumerationCompleted(auto_revoke, [this, deviceClass](auto const&, auto const&)
+        {
+            auto guard = m_cs.Guard();
+
+            m_enumerated[deviceClass] = true;
+        });
+
+    m_enumerated[deviceClass] = false;
+
+    watcher->watcher.Start();
+
+    m_watchers[deviceClass] = std::move(watcher);
+}
+
+_Use_decl_annotations_
+void DeviceCache::OnDevicesChanged(
+    DeviceClass const deviceClass)
+{
+    auto guard = m_cs.Guard();
+
+    auto it = m_enumerated.find(deviceClass);
+    if (it == m_enumerated.end() || !it->second)
+    {
+        return;
+    }
+
+    Log(L"DeviceCache: devices changed, dropping the cache\n");
+
+    // the first device, its profiles and stream properties can all differ now
+    Clear();
+
+    // the next launch enumerates again
+    PipelineCache::Instance().Remove(FirstDeviceKey(deviceClass));
+}
+
+// private, called under m_cs
+void DeviceCache::Clear()
+{
+    ++m_generation;
+
+    m_firstDevices.clear();
+    m_profileSupport.clear();
+    m_videoProfiles.clear();
+    m_streamProperties.clear();
+}
+
+// private, a failed enumeration leaves the stored id for initialize to find out about
+_Use_decl_annotations_
+fire_and_forget DeviceCache::ValidateFirstDeviceAsync(
+    DeviceClass const deviceClass)
+{
+    co_await resume_background();
+
+    try
+    {
+        co_await FirstDeviceAsync(deviceClass);
+    }
+    catch (hresult_error const& e)
+    {
+        Log(L"DeviceCache: failed to enumerate devices: %s\n", e.message().c_str());
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <winrt/windows.foundation.collections.h>
+#include <winrt/windows.devices.enumeration.h>
+#include <winrt/windows.media.capture.h>
+#include <winrt/windows.media.devices.h>
+#include <winrt/windows.media.mediaproperties.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// process wide, device enumeration, video profiles and stream properties are looked up once
+// per device id and shared by every capture engine, a device watcher drops the cache when
+// cameras or microphones come and go. first devices, profile support and the profile that
+// last initialized a capture are kept in the pipeline cache for the next launch, thread safe
+struct DeviceCache
+{
+    static DeviceCache& Instance();
+
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Devices::Enumeration::DeviceInformation> FirstDeviceAsync(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass);
+
+    // the id from an earlier launch comes back without waiting, an enumeration in the background
+    // checks it and stores what it finds. empty when there's no device
+    winrt::Windows::Foundation::IAsyncOperation<winrt::hstring> FirstDeviceIdAsync(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass);
+
+    bool IsVideoProfileSupported(
+        _In_ winrt::hstring const& deviceId);
+
+    winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Media::Capture::MediaCaptureVideoProfile> FindKnownVideoProfiles(
+        _In_ winrt::hstring const& deviceId,
+        _In_ winrt::Windows::Media::Capture::KnownVideoProfile const knownVideoProfile);
+
+    winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Media::MediaProperties::IMediaEncodingProperties> GetAvailableMediaStreamProperties(
+        _In_ winrt::Windows::Media::Devices::VideoDeviceController const& videoDeviceController,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const mediaStreamType);
+
+    // the profile and description that initialized a capture for the same request on an earlier
+    // launch, false when there's none or the device doesn't offer them anymore
+    bool FindKnownGoodProfile(
+        _In_ winrt::hstring const& deviceId,
+        _In_ winrt::Windows::Media::Capture::KnownVideoProfile const knownVideoProfile,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const mediaStreamType,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _Out_ winrt::Windows::Media::Capture::MediaCaptureVideoProfile& videoProfile,
+        _Out_ winrt::Windows::Media::Capture::MediaCaptureVideoProfileMediaDescription& mediaDescription);
+
+    // initialize succeeded, what it used is kept for the next launch. a null profile means the
+    // device has no profiles
+    void SetKnownGood(
+        _In_ winrt::hstring const& deviceId,
+        _In_ winrt::Windows::Media::Capture::KnownVideoProfile const knownVideoProfile,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const mediaStreamType,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ winrt::Windows::Media::Capture::MediaCaptureVideoProfile const& videoProfile,
+        _In_ winrt::Windows::Media::Capture::MediaCaptureVideoProfileMediaDescription const& mediaDescription);
+
+    // initialize failed, drops what an earlier launch stored for the device and the request that
+    // this launch hasn't checked yet. false when there was nothing, the failure is the device's
+    bool ForgetKnownGood(
+        _In_ winrt::hstring const& deviceId,
+        _In_ winrt::Windows::Media::Capture::KnownVideoProfile const knownVideoProfile,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const mediaStreamType,
+        _In_ uint32_t width,
+        _In_ uint32_t height);
+
+    // stops the watchers and drops the cache, the plugin is unloading
+    void Shutdown();
+
+private:
+    DeviceCache();
+
+    void Watch(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass);
+    void OnDevicesChanged(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass);
+    void Clear();
+
+    winrt::fire_and_forget ValidateFirstDeviceAsync(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass);
+
+private:
+    struct Watcher
+    {
+        winrt::Windows::Devices::Enumeration::DeviceWatcher watcher;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::Added_revoker added;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::Removed_revoker removed;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::Updated_revoker updated;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::EnumerationCompleted_revoker enumerationCompleted;
+    };
+
+    CriticalSection m_cs;
+
+    // bumped on every invalidation, lookups that started before it are not stored
+    uint32_t m_generation;
+
+    std::map<winrt::Windows::Devices::Enumeration::DeviceClass, winrt::Windows::Devices::Enumeration::DeviceInformation> m_firstDevices;
+    std::map<std::wstring, bool> m_profileSupport;
+    std::map<std::wstring, winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Media::Capture::MediaCaptureVideoProfile>> m_videoProfiles;
+    std::map<std::wstring, winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Media::MediaProperties::IMediaEncodingProperties>> m_streamProperties;
+
+    // the initial enumeration raises added for every device, only changes after it count
+    std::map<winrt::Windows::Devices::Enumeration::DeviceClass, std::unique_ptr<Watcher>> m_watchers;
+    std::map<winrt::Windows::Devices::Enumeration::DeviceClass, bool> m_enumerated;
+};
@@ -0,0 +1,555 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.FrameReaderStream.h"
+
+#include <mferror.h>
+#include <MemoryBuffer.h>
+
+#include <winrt/Windows.Foundation.Numerics.h>
+#include <winrt/Windows.Graphics.Imaging.h>
+#include <winrt/Windows.Media.Devices.Core.h>
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Foundation::Numerics;
+using namespace winrt::Windows::Graphics::Imaging;
+using namespace winrt::Windows::Media::Capture;
+using namespace winrt::Windows::Media::Capture::Frames;
+using namespace winrt::Windows::Perception::Spatial;
+
+#if !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+EXTERN_GUID(MFSampleExtension_DeviceTimestamp, 0x8f3e35e7, 0x2dcd, 0x4887, 0x86, 0x22, 0x2a, 0x58, 0xba, 0xa6, 0x52, 0xb0);
+EXTERN_GUID(MFSampleExtension_Spatial_CameraCoordinateSystem, 0x9d13c82f, 0x2199, 0x4e67, 0x91, 0xcd, 0xd1, 0xa4, 0x18, 0x1f, 0x25, 0x34);
+EXTERN_GUID(MFSampleExtension_Spatial_CameraViewTransform, 0x4e251fa4, 0x830f, 0x4770, 0x85, 0x9a, 0x4b, 0x8d, 0x99, 0xaa, 0x80, 0x9b);
+EXTERN_GUID(MFSampleExtension_Spatial_CameraProjectionTransform, 0x47f9fcb5, 0x2a02, 0x4f26, 0xa4, 0x77, 0x79, 0x2f, 0xdf, 0x95, 0x88, 0x6a);
+#endif
+
+_Use_decl_annotations_
+HRESULT FrameReaderStream::Create(
+    std::weak_ptr<ID3D11DeviceResource> const& unityDevice,
+    com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+    FrameSourceKind sourceKind,
+    TextureSyncMode syncMode,
+    FrameCallback const& fnCallback,
+    com_ptr<FrameReaderStream>& frameReaderStream)
+{
+    frameReaderStream = nullptr;
+
+    NULL_CHK_HR(dxgiDeviceManager, E_INVALIDARG);
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+    if (sourceKind != FrameSourceKind::Depth && sourceKind != FrameSourceKind::Infrared)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto stream = make_self<FrameReaderStream>();
+    stream->m_unityDevice = unityDevice;
+    stream->m_dxgiDeviceManager = dxgiDeviceManager;
+    stream->m_sourceKind = sourceKind;
+    stream->m_syncMode = syncMode;
+    stream->m_fnCallback = fnCallback;
+
+    frameReaderStream = stream;
+
+    return S_OK;
+}
+
+FrameReaderStream::FrameReaderStream()
+    : m_unityDevice()
+    , m_dxgiDeviceManager(nullptr)
+    , m_sourceKind(FrameSourceKind::Depth)
+    , m_syncMode(TextureSyncMode::None)
+    , m_fnCallback(nullptr)
+    , m_isClosed(false)
+    , m_mediaCapture(nullptr)
+    , m_frameReader(nullptr)
+    , m_frameArrivedToken()
+    , m_appCoordinateSystem(nullptr)
+    , m_transform(CameraCapture::Media::Transform())
+    , m_payload(CameraCapture::Media::Payload())
+    , m_textureRing(nullptr)
+    , m_frameSequence(0)
+    , m_frameTexture(nullptr)
+    , m_renderSequence(0)
+    , m_renderTexture(nullptr)
+{
+}
+
+FrameReaderStream::~FrameReaderStream()
+{
+    Close();
+}
+
+_Use_decl_annotations_
+IAsyncAction FrameReaderStream::StartAsync(
+    hstring const videoDeviceId)
+{
+    auto strong = get_strong();
+
+    co_await resume_background();
+
+    auto sourceKind = m_sourceKind == FrameSourceKind::Depth ? MediaFrameSourceKind::Depth : MediaFrameSourceKind::Infrared;
+
+    // hololens 2 keeps its depth and ir cameras behind research mode, no group has them there
+    MediaFrameSourceGroup sourceGroup = nullptr;
+    MediaFrameSourceInfo sourceInfo = nullptr;
+
+    auto sourceGroups = co_await MediaFrameSourceGroup::FindAllAsync();
+    for (auto const& group : sourceGroups)
+    {
+        MediaFrameSourceInfo groupSource = nullptr;
+        bool hasCamera = videoDeviceId.empty();
+
+        for (auto const& info : group.SourceInfos())
+        {
+            if (groupSource == nullptr && info.SourceKind() == sourceKind)
+            {
+                groupSource = info;
+            }
+
+            if (!hasCamera && info.DeviceInformation() != nullptr && info.DeviceInformation().Id() == videoDeviceId)
+            {
+                hasCamera = true;
+            }
+        }
+
+        if (groupSource == nullptr)
+        {
+            continue;
+        }
+
+        // the preview's camera wins, its poses line up with the colour frames
+        if (sourceInfo == nullptr || hasCamera)
+        {
+            sourceGroup = group;
+            sourceInfo = groupSource;
+        }
+
+        if (hasCamera)
+        {
+            break;
+        }
+    }
+
+    if (sourceInfo == nullptr)
+    {
+        throw_hresult(MF_E_NO_CAPTURE_DEVICES_AVAILABLE);
+    }
+
+    // read only, the preview's capture keeps exclusive control of the device
+    auto initSettings = MediaCaptureInitializationSettings();
+    initSettings.SourceGroup(sourceGroup);
+    initSettings.SharingMode(MediaCaptureSharingMode::SharedReadOnly);
+    initSettings.MemoryPreference(MediaCaptureMemoryPreference::Cpu);
+    initSettings.StreamingCaptureMode(StreamingCaptureMode::Video);
+
+    auto mediaCapture = MediaCapture();
+    co_await mediaCapture.InitializeAsync(initSettings);
+
+    auto frameReader = co_await mediaCapture.CreateFrameReaderAsync(mediaCapture.FrameSources().Lookup(sourceInfo.Id()));
+    frameReader.AcquisitionMode(MediaFrameReaderAcquisitionMode::Realtime);
+
+    {
+        auto guard = m_cs.Guard();
+
+        // closed while the device was opening
+        if (m_isClosed)
+        {
+            frameReader.Close();
+            mediaCapture.Close();
+
+            co_return;
+        }
+
+        m_mediaCapture = mediaCapture;
+        m_frameReader = frameReader;
+        m_frameArrivedToken = m_frameReader.FrameArrived([weak = get_weak()](MediaFrameReader const& sender, MediaFrameArrivedEventArgs const&)
+            {
+                if (auto stream = weak.get())
+                {
+                    stream->OnFrameArrived(sender);
+                }
+            });
+    }
+
+    auto startStatus = co_await frameReader.StartAsync();
+    if (startStatus != MediaFrameReaderStartStatus::Success)
+    {
+        throw_hresult(HRESULT_FROM_WIN32(ERROR_DEVICE_NOT_AVAILABLE));
+    }
+}
+
+void FrameReaderStream::Close()
+{
+    MediaFrameReader frameReader = nullptr;
+    MediaCapture mediaCapture = nullptr;
+    {
+        auto guard = m_cs.Guard();
+
+        if (m_isClosed)
+        {
+            return;
+        }
+
+        m_isClosed = true;
+        m_fnCallback = nullptr;
+
+        frameReader = m_frameReader;
+        m_frameReader = nullptr;
+
+        mediaCapture = m_mediaCapture;
+        m_mediaCapture = nullptr;
+    }
+
+    // outside the lock, a frame in flight finishes first
+    if (frameReader != nullptr)
+    {
+        frameReader.FrameArrived(m_frameArrivedToken);
+        frameReader.Close();
+    }
+
+    if (mediaCapture != nullptr)
+    {
+        mediaCapture.Close();
+    }
+
+    ReleaseTextures();
+
+    auto guard = m_cs.Guard();
+
+    // a scheduled pose refresh holds the transform until it runs
+    get_self<CameraCapture::Media::implementation::Transform>(m_transform)->Close();
+
+    m_payload.as<IStreamSample>()->Reset();
+}
+
+_Use_decl_annotations_
+void FrameReaderStream::AppCoordinateSystem(
+    SpatialCoordinateSystem const& value)
+{
+    auto guard = m_cs.Guard();
+
+    m_appCoordinateSystem = value;
+}
+
+_Use_decl_annotations_
+HRESULT FrameReaderStream::Release(
+    uint32_t textureIndex)
+{
+    auto guard = m_cs.Guard();
+
+    NULL_CHK_HR(m_textureRing, MF_E_NOT_INITIALIZED);
+
+    return m_textureRing->Release(textureIndex);
+}
+
+void FrameReaderStream::OnRenderEvent()
+{
+    auto guard = m_cs.Guard();
+
+    if (m_renderSequence == m_frameSequence)
+    {
+        return;
+    }
+
+    // the same slot came back, it has to be handed over before it can be taken again
+    if (m_renderTexture != nullptr && m_renderTexture == m_frameTexture)
+    {
+        m_renderTexture->EndFrameRead();
+
+        m_renderTexture = nullptr;
+    }
+
+    // never wait on the render thread, keep the frame we hold and try again on the next event
+    if (m_frameTexture != nullptr && FAILED(m_frameTexture->BeginFrameRead(SHARED_TEXTURE_SYNC_TIMEOUT_MS)))
+    {
+        return;
+    }
+
+    if (m_renderTexture != nullptr)
+    {
+        m_renderTexture->EndFrameRead();
+    }
+
+    m_renderTexture = m_frameTexture;
+    m_renderSequence = m_frameSequence;
+}
+
+void FrameReaderStream::ReleaseTextures()
+{
+    auto guard = m_cs.Guard();
+
+    if (m_renderTexture != nullptr)
+    {
+        m_renderTexture->EndFrameRead();
+
+        m_renderTexture = nullptr;
+    }
+
+    m_frameTexture = nullptr;
+    m_renderSequence = m_frameSequence;
+
+    if (m_textureRing != nullptr)
+    {
+        m_textureRing->Reset();
+
+        m_textureRing = nullptr;
+    }
+}
+
+// private
+_Use_decl_annotations_
+void FrameReaderStream::OnFrameArrived(
+    MediaFrameReader const& frameReader)
+{
+    PLUGIN_TRACE_SCOPE("FrameReaderStream.FrameArrived", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    auto frame = frameReader.TryAcquireLatestFrame();
+    if (frame == nullptr || frame.VideoMediaFrame() == nullptr)
+    {
+        return;
+    }
+
+    CAPTURE_STATE captureState{};
+    ZeroMemory(&captureState, sizeof(CAPTURE_STATE));
+
+    com_ptr<ID3D11ShaderResourceView> textureSRV = nullptr;
+    FrameCallback fnCallback = nullptr;
+    {
+        auto guard = m_cs.Guard();
+
+        if (m_isClosed)
+        {
+            return;
+        }
+
+        auto videoFormat = frame.Format().VideoFormat();
+        uint32_t width = videoFormat.Width();
+        uint32_t height = videoFormat.Height();
+
+        // built on the first frame and again when the source changes size
+        if (m_textureRing == nullptr || m_textureRing->Width() != width || m_textureRing->Height() != height)
+        {
+            auto resources = m_unityDevice.lock();
+            NULL_CHK_R(resources);
+
+            if (m_textureRing != nullptr)
+            {
+                m_textureRing->Reset();
+
+                m_textureRing = nullptr;
+            }
+
+            IFV(SharedTextureRing::Create(resources->GetDevice(), m_dxgiDeviceManager, width, height, FRAME_SOURCE_TEXTURES, DXGI_FORMAT_R16_UNORM, m_syncMode, m_textureRing));
+        }
+
+        // every slot is still held by the consumer, drop the frame
+        uint32_t writeIndex = 0;
+        com_ptr<SharedTexture> writeTexture = nullptr;
+        if (FAILED(m_textureRing->AcquireWrite(&writeIndex, writeTexture)))
+        {
+            return;
+        }
+
+        // the unity device still owns the texture, drop the frame
+        if (FAILED(writeTexture->BeginMediaWrite(SHARED_TEXTURE_SYNC_TIMEOUT_MS)))
+        {
+            m_textureRing->Discard(writeIndex);
+
+            return;
+        }
+
+        HRESULT hrUpload = UploadFrame(frame, writeTexture);
+
+        // release ownership or signal the fence so the unity device can read
+        writeTexture->EndMediaWrite();
+
+        if (FAILED(hrUpload))
+        {
+            m_textureRing->Discard(writeIndex);
+
+            return;
+        }
+
+        // a frame without a pose still goes out, the matrices stay zero
+        bool hasAttributes = SUCCEEDED(SetSampleAttributes(frame, writeTexture->mediaSample));
+
+        IFV(m_textureRing->Publish(writeIndex));
+
+        // hand the newest completed slot to the consumer, it stays untouched until released
+        uint32_t frameIndex = 0;
+        com_ptr<SharedTexture> frameTexture = nullptr;
+        IFV(m_textureRing->AcquireLatest(&frameIndex, frameTexture));
+
+        // picked up by the next render event
+        m_frameTexture = frameTexture;
+        ++m_frameSequence;
+
+        captureState.stateType = m_sourceKind == FrameSourceKind::Depth ? CaptureStateType::DepthVideoFrame : CaptureStateType::InfraredVideoFrame;
+        captureState.width = frameTexture->frameTextureDesc.Width;
+        captureState.height = frameTexture->frameTextureDesc.Height;
+        captureState.textureIndex = frameIndex;
+
+        // same path as the preview's frames, the slot's sample carries the spatial attributes
+        auto streamSample = m_payload.as<IStreamSample>();
+        if (hasAttributes
+            && m_appCoordinateSystem != nullptr
+            && SUCCEEDED(streamSample->Sample(MFMediaType_Video, nullptr, frameTexture->mediaSample))
+            && m_transform.ProcessWorldTransform(m_payload, m_appCoordinateSystem))
+        {
+            streamSample->GetTransformAndProjection(&captureState.worldMatrix, &captureState.projectionMatrix);
+        }
+
+        // doesn't keep the slot's sample alive
+        streamSample->Reset();
+
+        textureSRV = frameTexture->frameTextureSRV;
+        fnCallback = m_fnCallback;
+    }
+
+    // outside the lock, the engine's callback can release the slot
+    if (fnCallback != nullptr)
+    {
+        fnCallback(captureState, textureSRV.get());
+    }
+}
+
+_Use_decl_annotations_
+HRESULT FrameReaderStream::UploadFrame(
+    MediaFrameReference const& frame,
+    com_ptr<SharedTexture> const& target)
+{
+    // the capture asked for cpu memory, a source that only has gpu frames isn't supported
+    auto bitmap = frame.VideoMediaFrame().SoftwareBitmap();
+    NULL_CHK_HR(bitmap, MF_E_INVALIDMEDIATYPE);
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        // 8 bit ir is widened, unity always gets r16
+        if (bitmap.BitmapPixelFormat() != BitmapPixelFormat::Gray16)
+        {
+            bitmap = SoftwareBitmap::Convert(bitmap, BitmapPixelFormat::Gray16);
+        }
+
+        auto bitmapBuffer = bitmap.LockBuffer(BitmapBufferAccessMode::Read);
+        auto plane = bitmapBuffer.GetPlaneDescription(0);
+        auto reference = bitmapBuffer.CreateReference();
+
+        if (static_cast<uint32_t>(plane.Width) != target->frameTextureDesc.Width
+            ||
+            static_cast<uint32_t>(plane.Height) != target->frameTextureDesc.Height)
+        {
+            throw_hresult(MF_E_INVALIDMEDIATYPE);
+        }
+
+        uint8_t* data = nullptr;
+        uint32_t capacity = 0;
+        check_hresult(reference.as<::Windows::Foundation::IMemoryBufferByteAccess>()->GetBuffer(&data, &capacity));
+
+        com_ptr<ID3D11Device> device = nullptr;
+        target->mediaTexture->GetDevice(device.put());
+
+        com_ptr<ID3D11DeviceContext> context = nullptr;
+        device->GetImmediateContext(context.put());
+
+        // multithread protected, the preview's copies on the same device don't race this one
+        context->UpdateSubresource(target->mediaTexture.get(), 0, nullptr, data + plane.StartIndex, static_cast<UINT>(plane.Stride), 0);
+
+        // nothing else submits the upload when there's no fence or mutex
+        if (target->syncMode == TextureSyncMode::None)
+        {
+            context->Flush();
+        }
+
+        reference.Close();
+        bitmapBuffer.Close();
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT FrameReaderStream::SetSampleAttributes(
+    MediaFrameReference const& frame,
+    com_ptr<IMFSample> const& sample)
+{
+    // the slot's sample is reused, nothing from its previous frame may be left
+    IFR(sample->DeleteAllItems());
+
+    // qpc time in 100ns units, what the camera stamps as the device timestamp
+    auto systemTime = frame.SystemRelativeTime();
+    LONGLONG sampleTime = systemTime != nullptr ? systemTime.Value().count() : 0;
+    IFR(sample->SetSampleTime(sampleTime));
+    if (systemTime != nullptr)
+    {
+        IFR(sample->SetUINT64(MFSampleExtension_DeviceTimestamp, static_cast<UINT64>(sampleTime)));
+    }
+
+    // the frame reader hands the driver's blobs out as byte arrays
+    static GUID const c_blobAttributes[] =
+    {
+        MFSampleExtension_Spatial_CameraViewTransform,
+        MFSampleExtension_Spatial_CameraProjectionTransform,
+        MFSampleExtension_PinholeCameraIntrinsics,
+        MFSampleExtension_CameraExtrinsics
+    };
+
+    auto properties = frame.Properties();
+    for (auto const& attribute : c_blobAttributes)
+    {
+        if (!properties.HasKey(attribute))
+        {
+            continue;
+        }
+
+        auto propertyValue = properties.Lookup(attribute).try_as<IPropertyValue>();
+        if (propertyValue == nullptr || propertyValue.Type() != PropertyType::UInt8Array)
+        {
+            continue;
+        }
+
+        com_array<uint8_t> blob;
+        propertyValue.GetUInt8Array(blob);
+
+        IFR(sample->SetBlob(attribute, blob.data(), blob.size()));
+    }
+
+    auto coordinateSystem = frame.CoordinateSystem();
+    NULL_CHK_HR(coordinateSystem, MF_E_NOT_FOUND);
+
+    IFR(sample->SetUnknown(MFSampleExtension_Spatial_CameraCoordinateSystem, get_unknown(coordinateSystem)));
+
+    // no view transform, the frame's coordinate system is the camera's
+    UINT32 blobSize = 0;
+    if (FAILED(sample->GetBlobSize(MFSampleExtension_Spatial_CameraViewTransform, &blobSize)))
+    {
+        auto cameraView = float4x4::identity();
+        IFR(sample->SetBlob(MFSampleExtension_Spatial_CameraViewTransform, reinterpret_cast<UINT8 const*>(&cameraView), sizeof(cameraView)));
+    }
+
+    // the transform builds the projection from these when the driver sent none
+    auto cameraIntrinsics = frame.VideoMediaFrame().CameraIntrinsics();
+    if (cameraIntrinsics != nullptr && FAILED(sample->GetBlobSize(MFSampleExtension_PinholeCameraIntrinsics, &blobSize)))
+    {
+        MFPinholeCameraIntrinsics pinholeIntrinsics{};
+        pinholeIntrinsics.IntrinsicModelCount = 1;
+        pinholeIntrinsics.IntrinsicModels[0].Width = cameraIntrinsics.ImageWidth();
+        pinholeIntrinsics.IntrinsicModels[0].Height = cameraIntrinsics.ImageHeight();
+        pinholeIntrinsics.IntrinsicModels[0].CameraModel.FocalLength = { cameraIntrinsics.FocalLength().x, cameraIntrinsics.FocalLength().y };
+        pinholeIntrinsics.IntrinsicModels[0].CameraModel.PrincipalPoint = { cameraIntrinsics.PrincipalPoint().x, cameraIntrinsics.PrincipalPoint().y };
+
+        IFR(sample->SetBlob(MFSampleExtension_PinholeCameraIntrinsics, reinterpret_cast<UINT8 const*>(&pinholeIntrinsics), sizeof(pinholeIntrinsics)));
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "D3D11DeviceResources.h"
+#include "Media.Payload.h"
+#include "Media.SharedTextureRing.h"
+#include "Media.Transform.h"
+
+#include <mfapi.h>
+#include <winrt/Windows.Media.Capture.h>
+#include <winrt/Windows.Media.Capture.Frames.h>
+#include <winrt/Windows.Perception.Spatial.h>
+
+#include <functional>
+
+// slots for the secondary stream, it runs at a lower rate than the preview
+#define FRAME_SOURCE_TEXTURES 3
+
+// depth or infrared frames from a frame reader on a media capture of their own, shared read only
+// so the preview's capture keeps control of the device and never waits on this one. frames are
+// uploaded to an r16 ring on the media device and handed out with their camera to world transform,
+// the frame reader's thread does the work, thread safe
+struct FrameReaderStream : winrt::implements<FrameReaderStream, winrt::Windows::Foundation::IInspectable>
+{
+    // the texture view is unity's to convert, the slot stays acquired until Release
+    typedef std::function<void(CAPTURE_STATE& captureState, ID3D11ShaderResourceView* textureSRV)> FrameCallback;
+
+    static HRESULT Create(
+        _In_ std::weak_ptr<ID3D11DeviceResource> const& unityDevice,
+        _In_ winrt::com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+        _In_ FrameSourceKind sourceKind,
+        _In_ TextureSyncMode syncMode,
+        _In_ FrameCallback const& fnCallback,
+        _Out_ winrt::com_ptr<FrameReaderStream>& frameReaderStream);
+
+    FrameReaderStream();
+    virtual ~FrameReaderStream();
+
+    // picks the source group with the preview's camera in it, or the first with a source of the kind
+    winrt::Windows::Foundation::IAsyncAction StartAsync(
+        _In_ winrt::hstring const videoDeviceId);
+
+    // not under a lock the frame callback takes, closing waits for a frame in flight
+    void Close();
+
+    void AppCoordinateSystem(
+        _In_ winrt::Windows::Perception::Spatial::SpatialCoordinateSystem const& value);
+
+    HRESULT Release(
+        _In_ uint32_t textureIndex);
+
+    // unity's render thread, hands the previous frame back to the media device and takes the newest
+    void OnRenderEvent();
+
+    // unity's device is going away, the next frame builds the ring again
+    void ReleaseTextures();
+
+private:
+    void OnFrameArrived(
+        _In_ winrt::Windows::Media::Capture::Frames::MediaFrameReader const& frameReader);
+
+    HRESULT UploadFrame(
+        _In_ winrt::Windows::Media::Capture::Frames::MediaFrameReference const& frame,
+        _In_ winrt::com_ptr<SharedTexture> const& target);
+
+    // the spatial attributes a sink sample would carry, so the transform reads both the same way
+    HRESULT SetSampleAttributes(
+        _In_ winrt::Windows::Media::Capture::Frames::MediaFrameReference const& frame,
+        _In_ winrt::com_ptr<IMFSample> const& sample);
+
+private:
+    CriticalSection m_cs;
+
+    std::weak_ptr<ID3D11DeviceResource> m_unityDevice;
+    winrt::com_ptr<IMFDXGIDeviceManager> m_dxgiDeviceManager;
+    FrameSourceKind m_sourceKind;
+    TextureSyncMode m_syncMode;
+    FrameCallback m_fnCallback;
+    boolean m_isClosed;
+
+    winrt::Windows::Media::Capture::MediaCapture m_mediaCapture;
+    winrt::Windows::Media::Capture::Frames::MediaFrameReader m_frameReader;
+    winrt::event_token m_frameArrivedToken;
+
+    // its own transform, the preview's caches the pose for a different camera
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_appCoordinateSystem;
+    winrt::CameraCapture::Media::Transform m_transform;
+    winrt::CameraCapture::Media::Payload m_payload;
+
+    winrt::com_ptr<SharedTextureRing> m_textureRing;
+
+    // newest frame handed to the consumer and the one the unity device owns
+    uint64_t m_frameSequence;
+    winrt::com_ptr<SharedTexture> m_frameTexture;
+    uint64_t m_renderSequence;
+    winrt::com_ptr<SharedTexture> m_renderTexture;
+};
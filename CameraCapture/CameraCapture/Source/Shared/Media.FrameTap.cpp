@@ -0,0 +1,185 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.FrameTap.h"
+
+#include <mferror.h>
+
+using namespace winrt;
+
+_Use_decl_annotations_
+HRESULT FrameTap::Create(
+    com_ptr<ID3D11Device> const& d3dDevice,
+    uint32_t inputWidth, uint32_t inputHeight,
+    DXGI_FORMAT const inputFormat,
+    uint32_t outputWidth, uint32_t outputHeight,
+    FrameTapCallback fnCallback,
+    void* pCallbackObject,
+    com_ptr<FrameTap>& frameTap)
+{
+    NULL_CHK_HR(d3dDevice, E_INVALIDARG);
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+    // nv12 planes need even dimensions
+    if (outputWidth < 2 || outputHeight < 2 || (outputWidth & 1) != 0 || (outputHeight & 1) != 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    frameTap = nullptr;
+
+    auto inputColorSpace = (inputFormat == DXGI_FORMAT_NV12) ? DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709 : DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
+
+    // full range luma, vision code expects 0-255
+    com_ptr<VideoProcessor> videoProcessor = nullptr;
+    IFR(VideoProcessor::Create(
+        d3dDevice,
+        inputWidth, inputHeight, inputColorSpace,
+        outputWidth, outputHeight, DXGI_COLOR_SPACE_YCBCR_FULL_G22_LEFT_P709,
+        videoProcessor));
+
+    com_ptr<ID3D11Texture2D> scaledTexture = nullptr;
+    CD3D11_TEXTURE2D_DESC scaledDesc(DXGI_FORMAT_NV12, outputWidth, outputHeight, 1, 1, D3D11_BIND_RENDER_TARGET);
+    IFR(d3dDevice->CreateTexture2D(&scaledDesc, nullptr, scaledTexture.put()));
+
+    auto tap = make<FrameTap>().as<FrameTap>();
+
+    CD3D11_TEXTURE2D_DESC stagingDesc(DXGI_FORMAT_NV12, outputWidth, outputHeight, 1, 1, 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+    for (auto& slot : tap->m_slots)
+    {
+        IFR(d3dDevice->CreateTexture2D(&stagingDesc, nullptr, slot.texture.put()));
+    }
+
+    tap->m_inputWidth = inputWidth;
+    tap->m_inputHeight = inputHeight;
+    tap->m_inputFormat = inputFormat;
+    tap->m_outputWidth = outputWidth;
+    tap->m_outputHeight = outputHeight;
+    tap->m_fnCallback = fnCallback;
+    tap->m_callbackObject = pCallbackObject;
+    tap->m_videoProcessor = videoProcessor;
+    tap->m_scaledTexture = scaledTexture;
+    tap->m_luma.resize(static_cast<size_t>(outputWidth) * outputHeight);
+
+    d3dDevice->GetImmediateContext(tap->m_d3dContext.put());
+
+    frameTap = tap;
+
+    return S_OK;
+}
+
+FrameTap::FrameTap()
+    : m_inputWidth(0)
+    , m_inputHeight(0)
+    , m_inputFormat(DXGI_FORMAT_UNKNOWN)
+    , m_outputWidth(0)
+    , m_outputHeight(0)
+    , m_fnCallback(nullptr)
+    , m_callbackObject(nullptr)
+    , m_d3dContext(nullptr)
+    , m_videoProcessor(nullptr)
+    , m_scaledTexture(nullptr)
+    , m_slots()
+    , m_writeIndex(0)
+    , m_readIndex(0)
+{}
+
+FrameTap::~FrameTap()
+{
+    Reset();
+}
+
+_Use_decl_annotations_
+HRESULT FrameTap::Process(
+    com_ptr<ID3D11Texture2D> const& source,
+    uint32_t sourceArraySlice,
+    LONGLONG sampleTime)
+{
+    PLUGIN_TRACE_SCOPE("FrameTap.Process", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    NULL_CHK_HR(source, E_INVALIDARG);
+    NULL_CHK_HR(m_videoProcessor, MF_E_NOT_INITIALIZED);
+
+    IFR(DeliverCompleted());
+
+    // the gpu is a whole ring behind, drop the oldest copy instead of waiting on it
+    auto& slot = m_slots[m_writeIndex];
+    if (slot.pending)
+    {
+        slot.pending = false;
+
+        m_readIndex = (m_readIndex + 1) % FRAME_TAP_STAGING_TEXTURES;
+    }
+
+    IFR(m_videoProcessor->Blt(m_d3dContext, source, sourceArraySlice, m_scaledTexture));
+
+    m_d3dContext->CopyResource(slot.texture.get(), m_scaledTexture.get());
+
+    // submit now, so the copy is done by the time a later frame maps it
+    m_d3dContext->Flush();
+
+    slot.sampleTime = sampleTime;
+    slot.pending = true;
+
+    m_writeIndex = (m_writeIndex + 1) % FRAME_TAP_STAGING_TEXTURES;
+
+    return S_OK;
+}
+
+void FrameTap::Reset()
+{
+    for (auto& slot : m_slots)
+    {
+        slot.texture = nullptr;
+        slot.pending = false;
+    }
+    m_writeIndex = 0;
+    m_readIndex = 0;
+
+    m_scaledTexture = nullptr;
+
+    if (m_videoProcessor != nullptr)
+    {
+        m_videoProcessor->Reset();
+
+        m_videoProcessor = nullptr;
+    }
+
+    m_d3dContext = nullptr;
+}
+
+HRESULT FrameTap::DeliverCompleted()
+{
+    while (m_slots[m_readIndex].pending)
+    {
+        auto& slot = m_slots[m_readIndex];
+
+        D3D11_MAPPED_SUBRESOURCE mapped{};
+        HRESULT hr = m_d3dContext->Map(slot.texture.get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+        {
+            // later copies were queued behind this one
+            return S_OK;
+        }
+        IFR(hr);
+
+        // the luma plane comes first, rows are padded to the row pitch
+        auto source = static_cast<uint8_t const*>(mapped.pData);
+        for (uint32_t row = 0; row < m_outputHeight; ++row)
+        {
+            memcpy(m_luma.data() + static_cast<size_t>(row) * m_outputWidth, source + static_cast<size_t>(row) * mapped.RowPitch, m_outputWidth);
+        }
+
+        m_d3dContext->Unmap(slot.texture.get(), 0);
+
+        slot.pending = false;
+
+        m_readIndex = (m_readIndex + 1) % FRAME_TAP_STAGING_TEXTURES;
+
+        m_fnCallback(m_callbackObject, m_luma.data(), m_outputWidth, m_outputHeight, slot.sampleTime);
+    }
+
+    return S_OK;
+}
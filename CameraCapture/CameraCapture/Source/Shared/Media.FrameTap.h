@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.VideoProcessor.h"
+
+#include <array>
+#include <vector>
+
+#define FRAME_TAP_STAGING_TEXTURES 3
+
+// downscaled luma copy of the video frames for cpu vision, frames are scaled into nv12 on the
+// media device and read back through a ring of staging textures, a copy is only mapped once the
+// gpu finished it so the cpu never waits, not thread safe
+struct FrameTap : winrt::implements<FrameTap, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ winrt::com_ptr<ID3D11Device> const& d3dDevice,
+        _In_ uint32_t inputWidth,
+        _In_ uint32_t inputHeight,
+        _In_ DXGI_FORMAT const inputFormat,
+        _In_ uint32_t outputWidth,
+        _In_ uint32_t outputHeight,
+        _In_ FrameTapCallback fnCallback,
+        _In_ void* pCallbackObject,
+        _Out_ winrt::com_ptr<FrameTap>& frameTap);
+
+    FrameTap();
+    virtual ~FrameTap();
+
+    // hands out the copies the gpu finished, then queues this frame behind them
+    HRESULT Process(
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& source,
+        _In_ uint32_t sourceArraySlice,
+        _In_ LONGLONG sampleTime);
+
+    uint32_t InputWidth() const { return m_inputWidth; }
+    uint32_t InputHeight() const { return m_inputHeight; }
+    DXGI_FORMAT InputFormat() const { return m_inputFormat; }
+    uint32_t OutputWidth() const { return m_outputWidth; }
+    uint32_t OutputHeight() const { return m_outputHeight; }
+
+    void Reset();
+
+private:
+    HRESULT DeliverCompleted();
+
+private:
+    struct StagingSlot
+    {
+        winrt::com_ptr<ID3D11Texture2D> texture;
+        LONGLONG sampleTime;
+        boolean pending;
+    };
+
+    uint32_t m_inputWidth;
+    uint32_t m_inputHeight;
+    DXGI_FORMAT m_inputFormat;
+    uint32_t m_outputWidth;
+    uint32_t m_outputHeight;
+
+    FrameTapCallback m_fnCallback;
+    void* m_callbackObject;
+
+    winrt::com_ptr<ID3D11DeviceContext> m_d3dContext;
+    winrt::com_ptr<VideoProcessor> m_videoProcessor;
+    winrt::com_ptr<ID3D11Texture2D> m_scaledTexture;
+
+    // copies are read in the order they were queued
+    std::array<StagingSlot, FRAME_TAP_STAGING_TEXTURES> m_slots;
+    uint32_t m_writeIndex;
+    uint32_t m_readIndex;
+
+    // tightly packed luma rows handed to the callback
+    std::vector<uint8_t> m_luma;
+};
@@ -3,6 +3,7 @@
 
 #include "pch.h"
 #include "Media.Functions.h"
+#include "Media.DeviceCache.h"
 
 #include <mfapi.h>
 #include <mferror.h>
@@ -27,116 +28,6 @@ EXTERN_GUID(MFSampleExtension_Spatial_CameraViewTransform, 0x4e251fa4, 0x830f, 0
 EXTERN_GUID(MFSampleExtension_Spatial_CameraProjectionTransform, 0x47f9fcb5, 0x2a02, 0x4f26, 0xa4, 0x77, 0x79, 0x2f, 0xdf, 0x95, 0x88, 0x6a);
 #endif
 
-// Check for SDK Layer support.
-inline bool SdkLayersAvailable()
-{
-	HRESULT hr = E_NOTIMPL;
-
-#if defined(_DEBUG)
-	hr = D3D11CreateDevice(
-		nullptr,
-		D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
-		0,
-		D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
-		nullptr,                    // Any feature level will do.
-		0,
-		D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
-		nullptr,                    // No need to keep the D3D device reference.
-		nullptr,                    // No need to know the feature level.
-		nullptr                     // No need to keep the D3D device context reference.
-	);
-#endif
-
-	return SUCCEEDED(hr);
-}
-
-_Use_decl_annotations_
-HRESULT CreateMediaDevice(
-	IDXGIAdapter* pDXGIAdapter,
-	ID3D11Device** ppDevice)
-{
-	NULL_CHK_HR(ppDevice, E_INVALIDARG);
-
-	// Create the Direct3D 11 API device object and a corresponding context.
-	D3D_FEATURE_LEVEL featureLevel;
-
-	// This flag adds support for surfaces with a different color channel ordering
-	// than the API default. It is required for compatibility with Direct2D.
-	UINT creationFlags = D3D11_CREATE_DEVICE_VIDEO_SUPPORT | D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-
-	// If the project is in a debug build, enable debugging via SDK Layers with this flag.
-	if (SdkLayersAvailable())
-	{
-		creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
-	}
-
-	D3D_FEATURE_LEVEL featureLevels[] =
-	{
-		D3D_FEATURE_LEVEL_11_1,
-		D3D_FEATURE_LEVEL_11_0,
-		D3D_FEATURE_LEVEL_10_1,
-		D3D_FEATURE_LEVEL_10_0,
-	};
-
-	com_ptr<ID3D11Device> spDevice;
-	com_ptr<ID3D11DeviceContext> spContext;
-
-	D3D_DRIVER_TYPE driverType = (nullptr != pDXGIAdapter) ? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE;
-
-	// Create a device using the hardware graphics driver if adapter is not supplied
-	HRESULT hr = D3D11CreateDevice(
-		pDXGIAdapter,               // if nullptr will use default adapter.
-		driverType,
-		0,                          // Should be 0 unless the driver is D3D_DRIVER_TYPE_SOFTWARE.
-		creationFlags,              // Set debug and Direct2D compatibility flags.
-		featureLevels,              // List of feature levels this app can support.
-		ARRAYSIZE(featureLevels),   // Size of the list above.
-		D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
-		spDevice.put(),             // Returns the Direct3D device created.
-		&featureLevel,              // Returns feature level of device created.
-		spContext.put()             // Returns the device immediate context.
-	);
-
-	if (FAILED(hr))
-	{
-		// fallback to WARP if we are not specifying an adapter
-		if (nullptr == pDXGIAdapter)
-		{
-			// If the initialization fails, fall back to the WARP device.
-			// For more information on WARP, see:
-			// http://go.microsoft.com/fwlink/?LinkId=286690
-			hr = D3D11CreateDevice(
-				nullptr,
-				D3D_DRIVER_TYPE_WARP, // Create a WARP device instead of a hardware device.
-				0,
-				creationFlags,
-				featureLevels,
-				ARRAYSIZE(featureLevels),
-				D3D11_SDK_VERSION,
-				spDevice.put(),
-				&featureLevel,
-				spContext.put());
-		}
-
-		IFR(hr);
-	}
-	else
-	{
-		// workaround for nvidia GPU's, cast to ID3D11VideoDevice
-		auto videoDevice = spDevice.as<ID3D11VideoDevice>();
-	}
-
-	// Turn multithreading on
-	auto spMultithread = spContext.as<ID3D10Multithread>();
-	NULL_CHK_HR(spMultithread, E_POINTER);
-
-	spMultithread->SetMultithreadProtected(TRUE);
-
-	*ppDevice = spDevice.detach();
-
-	return S_OK;
-}
-
 _Use_decl_annotations_
 IAsyncOperation<DeviceInformation> GetFirstDeviceAsync(
 	DeviceClass const& deviceClass)
@@ -166,7 +57,8 @@ IMediaEncodingProperties GetVideoDeviceProperties(
 	hstring subType)
 {
 	// select a camera property that meets the resolution at the highest framerate
-	auto preferredSettings = videoDeviceController.GetAvailableMediaStreamProperties(mediaStreamType);
+	// cached per device, the list doesn't change while the camera is attached
+	auto preferredSettings = DeviceCache::Instance().GetAvailableMediaStreamProperties(videoDeviceController, mediaStreamType);
 	if (preferredSettings.Size() == 0)
 	{
 		return nullptr;
@@ -281,15 +173,118 @@ MediaStreamSource CreateMediaSource(
 	return mediaStreamSource;
 }
 
+// copies each dxgi buffer of the source, one view or array slice each, into the
+// matching array slice of the destination texture, S_FALSE if this can't be done
+// on the device. a subresource holds every plane of a planar format, nv12 is one
+// copy. views the destination has no slice for are left out, a ring texture only
+// carries the base view
+static HRESULT CopyTexturesOnDevice(
+	com_ptr<IMFSample> const& srcSample,
+	DWORD srcBufferCount,
+	com_ptr<IMFSample> const& dstSample)
+{
+	DWORD dstBufferCount = 0;
+	IFR(dstSample->GetBufferCount(&dstBufferCount));
+
+	if (srcBufferCount < 1 || dstBufferCount != 1)
+	{
+		return S_FALSE;
+	}
+
+	com_ptr<IMFMediaBuffer> dstBuffer = nullptr;
+	IFR(dstSample->GetBufferByIndex(0, dstBuffer.put()));
+
+	auto dstDxgiBuffer = dstBuffer.try_as<IMFDXGIBuffer>();
+	if (dstDxgiBuffer == nullptr)
+	{
+		return S_FALSE;
+	}
+
+	com_ptr<ID3D11Texture2D> dstTexture = nullptr;
+	IFR(dstDxgiBuffer->GetResource(__uuidof(ID3D11Texture2D), dstTexture.put_void()));
+
+	UINT dstSubresource = 0;
+	IFR(dstDxgiBuffer->GetSubresourceIndex(&dstSubresource));
+
+	D3D11_TEXTURE2D_DESC dstDesc{};
+	dstTexture->GetDesc(&dstDesc);
+
+	UINT dstMipSlice = dstSubresource % dstDesc.MipLevels;
+	UINT dstArraySlice = dstSubresource / dstDesc.MipLevels;
+	UINT copyCount = min(srcBufferCount, dstDesc.ArraySize - dstArraySlice);
+
+	com_ptr<ID3D11Device> d3dDevice = nullptr;
+	dstTexture->GetDevice(d3dDevice.put());
+
+	com_ptr<ID3D11DeviceContext> d3dContext = nullptr;
+	d3dDevice->GetImmediateContext(d3dContext.put());
+
+	// a failed check after the first slice is fine, the cpu path rewrites the whole destination
+	for (UINT i = 0; i < copyCount; ++i)
+	{
+		com_ptr<IMFMediaBuffer> srcBuffer = nullptr;
+		IFR(srcSample->GetBufferByIndex(i, srcBuffer.put()));
+
+		auto srcDxgiBuffer = srcBuffer.try_as<IMFDXGIBuffer>();
+		if (srcDxgiBuffer == nullptr)
+		{
+			return S_FALSE;
+		}
+
+		com_ptr<ID3D11Texture2D> srcTexture = nullptr;
+		IFR(srcDxgiBuffer->GetResource(__uuidof(ID3D11Texture2D), srcTexture.put_void()));
+
+		UINT srcSubresource = 0;
+		IFR(srcDxgiBuffer->GetSubresourceIndex(&srcSubresource));
+
+		D3D11_TEXTURE2D_DESC srcDesc{};
+		srcTexture->GetDesc(&srcDesc);
+
+		com_ptr<ID3D11Device> srcDevice = nullptr;
+		srcTexture->GetDevice(srcDevice.put());
+
+		if (srcDevice != d3dDevice || srcDesc.Format != dstDesc.Format)
+		{
+			return S_FALSE;
+		}
+
+		UINT targetSubresource = D3D11CalcSubresource(dstMipSlice, dstArraySlice + i, dstDesc.MipLevels);
+
+		// capture textures can be padded past the frame size, a box into a 4:2:0 texture stays even
+		UINT copyWidth = min(srcDesc.Width, dstDesc.Width);
+		UINT copyHeight = min(srcDesc.Height, dstDesc.Height);
+		if (srcDesc.Format == DXGI_FORMAT_NV12 || srcDesc.Format == DXGI_FORMAT_P010)
+		{
+			copyWidth &= ~1u;
+			copyHeight &= ~1u;
+		}
+
+		D3D11_BOX srcBox = { 0, 0, 0, copyWidth, copyHeight, 1 };
+
+		d3dContext->CopySubresourceRegion(dstTexture.get(), targetSubresource, 0, 0, 0, srcTexture.get(), srcSubresource, &srcBox);
+	}
+
+	// not flushed here, EndMediaWrite releases the keyed mutex or signals and flushes
+	return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT CopySample(
 	GUID majorType,
 	com_ptr<IMFSample> const& srcSample,
-	com_ptr<IMFSample> const& dstSample)
+	com_ptr<IMFSample> const& dstSample,
+	CopySamplePath* copyPath)
 {
+	PLUGIN_TRACE_SCOPE("CopySample", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
 	NULL_CHK_HR(srcSample, E_INVALIDARG);
 	NULL_CHK_HR(dstSample, E_INVALIDARG);
 
+	if (copyPath != nullptr)
+	{
+		*copyPath = CopySamplePath::None;
+	}
+
 	// copy IMFAttributes
 	IFR(srcSample->CopyAllItems(dstSample.get()));
 
@@ -320,6 +315,25 @@ HRESULT CopySample(
 		DWORD srcBufferCount = 0;
 		IFR(srcSample->GetBufferCount(&srcBufferCount));
 
+		// keep dxgi buffers on the device, S_FALSE means a buffer is in system memory
+		HRESULT hr = CopyTexturesOnDevice(srcSample, srcBufferCount, dstSample);
+		IFR(hr);
+
+		if (hr == S_OK)
+		{
+			if (copyPath != nullptr)
+			{
+				*copyPath = CopySamplePath::Gpu;
+			}
+
+			return S_OK;
+		}
+
+		if (copyPath != nullptr)
+		{
+			*copyPath = CopySamplePath::Cpu;
+		}
+
 		com_ptr<IMFMediaBuffer> srcBuffer = nullptr;
 		if (srcBufferCount > 1)
 		{
@@ -591,6 +605,43 @@ HRESULT GetDXGISurfaceFromSample(
 	return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT GetTextureFromSample(
+	com_ptr<IMFSample> const& mediaSample,
+	com_ptr<ID3D11Texture2D>& texture,
+	uint32_t* subresourceIndex)
+{
+	NULL_CHK_HR(mediaSample, E_INVALIDARG);
+	NULL_CHK_HR(subresourceIndex, E_INVALIDARG);
+
+	// validate it has only one buffer
+	DWORD bufferCount = 0;
+	IFR(mediaSample->GetBufferCount(&bufferCount));
+
+	if (bufferCount > 1)
+	{
+		IFR(MF_E_INVALIDTYPE);
+	}
+
+	com_ptr<IMFMediaBuffer> mediaBuffer = nullptr;
+	IFR(mediaSample->GetBufferByIndex(0, mediaBuffer.put()));
+
+	com_ptr<IMFDXGIBuffer> mediaDxgiBuffer = nullptr;
+	IFR(mediaBuffer->QueryInterface(__uuidof(IMFDXGIBuffer), mediaDxgiBuffer.put_void()));
+
+	com_ptr<ID3D11Texture2D> sampleTexture = nullptr;
+	IFR(mediaDxgiBuffer->GetResource(__uuidof(ID3D11Texture2D), sampleTexture.put_void()));
+
+	// capture pipelines usually hand out slices of a texture array
+	UINT subResource = 0;
+	IFR(mediaDxgiBuffer->GetSubresourceIndex(&subResource));
+
+	texture.attach(sampleTexture.detach());
+	*subresourceIndex = subResource;
+
+	return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT CreateMediaStreamSample(
 	com_ptr<IMFSample> const& mediaSample,
@@ -796,4 +847,26 @@ HRESULT NV12ToRGB(
 	}
 
 	return S_OK;
+}
+
+_Use_decl_annotations_
+winrt::Windows::Foundation::Numerics::float4x4 GetCropProjection(
+	winrt::Windows::Foundation::Numerics::float4x4 const& projection,
+	RECT const& cropRect,
+	uint32_t width,
+	uint32_t height)
+{
+	// row vectors, the crop's ndc is (ndc - center) / scale
+	float scaleX = static_cast<float>(cropRect.right - cropRect.left) / width;
+	float scaleY = static_cast<float>(cropRect.bottom - cropRect.top) / height;
+	float centerX = static_cast<float>(cropRect.left + cropRect.right) / width - 1.0f;
+	float centerY = 1.0f - static_cast<float>(cropRect.top + cropRect.bottom) / height;
+
+	auto crop = winrt::Windows::Foundation::Numerics::float4x4::identity();
+	crop.m11 = 1.0f / scaleX;
+	crop.m22 = 1.0f / scaleY;
+	crop.m41 = -centerX / scaleX;
+	crop.m42 = -centerY / scaleY;
+
+	return projection * crop;
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <d3d11_1.h>
 #include <mfidl.h>
 
+#include "MediaDevice.h"
+
 #include <winrt/windows.foundation.h>
 #include <winrt/windows.devices.enumeration.h>
 #include <winrt/windows.media.devices.h>
@@ -14,10 +16,6 @@
 #include <winrt/windows.media.core.h>
 #include <winrt/windows.graphics.directx.direct3d11.h>
 
-HRESULT CreateMediaDevice(
-    _In_opt_ IDXGIAdapter* pDXGIAdapter,
-    _COM_Outptr_ ID3D11Device** ppDevice);
-
 winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Devices::Enumeration::DeviceInformation> GetFirstDeviceAsync(
     _In_ winrt::Windows::Devices::Enumeration::DeviceClass const& deviceClass);
 
@@ -38,19 +36,40 @@ HRESULT GetSurfaceFromTexture(
     _In_ ID3D11Texture2D* pTexture,
     _Out_ winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface& ppSurface);
 
+// how CopySample moved the video data
+enum class CopySamplePath
+{
+    None = 0,
+    Gpu,    // CopySubresourceRegion per dxgi buffer
+    Cpu     // Copy2DTo, system memory buffers
+};
+
 HRESULT CopySample(
     _In_ GUID majorType,
     _In_ winrt::com_ptr<IMFSample> const& srcSample,
-    _In_ winrt::com_ptr<IMFSample> const& dstSample);
+    _In_ winrt::com_ptr<IMFSample> const& dstSample,
+    _Out_opt_ CopySamplePath* copyPath = nullptr);
 
 HRESULT GetDXGISurfaceFromSample(
     _In_ winrt::com_ptr<IMFSample> const& mediaSample,
     _Inout_ winrt::com_ptr<IDXGISurface2>& dxgiSurface);
 
+HRESULT GetTextureFromSample(
+    _In_ winrt::com_ptr<IMFSample> const& mediaSample,
+    _Out_ winrt::com_ptr<ID3D11Texture2D>& texture,
+    _Out_ uint32_t* subresourceIndex);
+
 HRESULT CreateMediaStreamSample(
     _In_ winrt::com_ptr<IMFSample> const& mediaSample, 
     _In_ winrt::Windows::Foundation::TimeSpan const& timeStamp, 
     _Out_ winrt::Windows::Media::Core::MediaStreamSample& streamSample);
+
+// the projection of a crop of a width x height frame, clip space squeezed onto the crop
+winrt::Windows::Foundation::Numerics::float4x4 GetCropProjection(
+    _In_ winrt::Windows::Foundation::Numerics::float4x4 const& projection,
+    _In_ RECT const& cropRect,
+    _In_ uint32_t width,
+    _In_ uint32_t height);
 _Use_decl_annotations_
 
 
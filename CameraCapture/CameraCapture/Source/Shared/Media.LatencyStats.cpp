@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.LatencyStats.h"
+
+#include <mfapi.h>
+
+#include <algorithm>
+
+using namespace winrt;
+
+// the payload stages after Received line up with the latency stages
+static_assert(static_cast<size_t>(PayloadStage::Dispatched) == static_cast<size_t>(LatencyStage::Queue), "stage mismatch");
+static_assert(static_cast<size_t>(PayloadStage::Copied) == static_cast<size_t>(LatencyStage::Copy), "stage mismatch");
+static_assert(static_cast<size_t>(PayloadStage::Transformed) == static_cast<size_t>(LatencyStage::Transform), "stage mismatch");
+static_assert(static_cast<size_t>(PayloadStage::Delivered) == static_cast<size_t>(LatencyStage::Callback), "stage mismatch");
+static_assert(static_cast<size_t>(LatencyStage::Pipeline) == LATENCY_STAGE_COUNT - 1, "stage mismatch");
+
+LatencyStats::LatencyStats()
+    : m_qpcFrequency(0)
+    , m_history()
+    , m_frameCount(0)
+{
+    LARGE_INTEGER frequency{};
+    QueryPerformanceFrequency(&frequency);
+
+    m_qpcFrequency = frequency.QuadPart;
+}
+
+_Use_decl_annotations_
+void LatencyStats::Record(
+    com_ptr<IStreamSample> const& streamSample,
+    std::array<uint32_t, LATENCY_STAGE_COUNT>& stageLatency)
+{
+    stageLatency.fill(0);
+
+    if (streamSample == nullptr)
+    {
+        return;
+    }
+
+    LONGLONG receivedTime = streamSample->StageTime(PayloadStage::Received);
+    if (receivedTime == 0)
+    {
+        return;
+    }
+
+    // a skipped stage takes the time of the one before it
+    LONGLONG previousTime = receivedTime;
+    for (size_t stage = static_cast<size_t>(PayloadStage::Dispatched); stage < static_cast<size_t>(PayloadStage::Count); ++stage)
+    {
+        LONGLONG stageTime = max(streamSample->StageTime(static_cast<PayloadStage>(stage)), previousTime);
+
+        stageLatency[stage] = ToMicroseconds(stageTime - previousTime);
+
+        previousTime = stageTime;
+    }
+
+    stageLatency[static_cast<size_t>(LatencyStage::Pipeline)] = ToMicroseconds(previousTime - receivedTime);
+
+    // the device timestamp is qpc in 100ns units, it tells sensor and driver time apart from ours
+    auto sample = streamSample->Sample();
+    if (sample != nullptr)
+    {
+        LONGLONG deviceTime = static_cast<LONGLONG>(MFGetAttributeUINT64(sample.get(), MFSampleExtension_DeviceTimestamp, 0));
+        LONGLONG receivedHns = ToHundredNanoseconds(receivedTime);
+        if (deviceTime > 0 && deviceTime <= receivedHns)
+        {
+            stageLatency[static_cast<size_t>(LatencyStage::Sensor)] = static_cast<uint32_t>(min((receivedHns - deviceTime) / 10, static_cast<LONGLONG>(UINT32_MAX)));
+        }
+    }
+
+    uint32_t index = m_frameCount % LATENCY_HISTORY_FRAMES;
+    for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        m_history[stage][index] = stageLatency[stage];
+    }
+
+    ++m_frameCount;
+}
+
+_Use_decl_annotations_
+void LatencyStats::Compute(
+    CAPTURE_STATS& stats) const
+{
+    ZeroMemory(&stats, sizeof(CAPTURE_STATS));
+
+    uint32_t frameCount = min(m_frameCount, static_cast<uint32_t>(LATENCY_HISTORY_FRAMES));
+    if (frameCount == 0)
+    {
+        return;
+    }
+
+    stats.frameCount = frameCount;
+
+    std::array<uint32_t, LATENCY_HISTORY_FRAMES> values;
+    for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        auto begin = values.begin();
+        auto end = std::copy_n(m_history[stage].begin(), frameCount, begin);
+
+        auto p50 = begin + (frameCount - 1) * 50 / 100;
+        std::nth_element(begin, p50, end);
+        stats.p50[stage] = *p50;
+
+        // the upper part is still unordered after the first pass
+        auto p99 = begin + (frameCount - 1) * 99 / 100;
+        std::nth_element(p50, p99, end);
+        stats.p99[stage] = *p99;
+    }
+}
+
+void LatencyStats::Clear()
+{
+    m_frameCount = 0;
+}
+
+// private
+_Use_decl_annotations_
+uint32_t LatencyStats::ToMicroseconds(
+    LONGLONG qpcTicks) const
+{
+    if (qpcTicks <= 0 || m_qpcFrequency <= 0)
+    {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(min(qpcTicks * 1000000 / m_qpcFrequency, static_cast<LONGLONG>(UINT32_MAX)));
+}
+
+_Use_decl_annotations_
+LONGLONG LatencyStats::ToHundredNanoseconds(
+    LONGLONG qpcTime) const
+{
+    if (m_qpcFrequency <= 0)
+    {
+        return 0;
+    }
+
+    // split so the multiply doesn't overflow on machines that have been up for days
+    return (qpcTime / m_qpcFrequency) * 10000000 + (qpcTime % m_qpcFrequency) * 10000000 / m_qpcFrequency;
+}
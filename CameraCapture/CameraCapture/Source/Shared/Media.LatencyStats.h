@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.Payload.h"
+
+#include <array>
+
+#define LATENCY_HISTORY_FRAMES 256
+
+// per stage latency of the last LATENCY_HISTORY_FRAMES video frames, taken from the
+// payload stage stamps. not thread safe, the capture engine calls it under its lock
+struct LatencyStats
+{
+    LatencyStats();
+
+    // stages that didn't run for this frame count as 0
+    void Record(
+        _In_ winrt::com_ptr<IStreamSample> const& streamSample,
+        _Out_ std::array<uint32_t, LATENCY_STAGE_COUNT>& stageLatency);
+
+    void Compute(
+        _Out_ CAPTURE_STATS& stats) const;
+
+    void Clear();
+
+private:
+    uint32_t ToMicroseconds(
+        _In_ LONGLONG qpcTicks) const;
+    LONGLONG ToHundredNanoseconds(
+        _In_ LONGLONG qpcTime) const;
+
+private:
+    LONGLONG m_qpcFrequency;
+
+    std::array<std::array<uint32_t, LATENCY_HISTORY_FRAMES>, LATENCY_STAGE_COUNT> m_history;
+    uint32_t m_frameCount;
+};
@@ -17,19 +17,27 @@ using namespace Windows::Media::Core;
 using namespace Windows::Media::MediaProperties;
 
 Payload::Payload()
-    : m_mediaType(nullptr)
+    : m_majorType(GUID_NULL)
+    , m_mediaType(nullptr)
     , m_mediaSample(nullptr)
-    , m_propertySet()
+    , m_sampleTime(0)
+    , m_propertySet(nullptr)
     , m_encodingProperties(nullptr)
     , m_mediaStreamSample(nullptr)
     , m_hasTransform(false)
     , m_cameraToWorld()
     , m_cameraProjection()
+    , m_stageTimes()
 {
 }
 
 MediaPropertySet Payload::MediaPropertySet()
 {
+    if (m_propertySet == nullptr)
+    {
+        m_propertySet = Windows::Media::MediaProperties::MediaPropertySet();
+    }
+
     return m_propertySet;
 }
 
@@ -45,6 +53,17 @@ IMediaEncodingProperties Payload::EncodingProperties()
 
 MediaStreamSample Payload::MediaStreamSample()
 {
+    // only created when asked for, the capture engine reads the sample directly
+    if (m_mediaStreamSample == nullptr && m_mediaSample != nullptr)
+    {
+        Windows::Media::Core::MediaStreamSample streamSample = nullptr;
+        IFT(CreateMediaStreamSample(m_mediaSample, TimeSpan(m_sampleTime), streamSample));
+
+        streamSample.ExtendedProperties().Insert(MF_MT_MAJOR_TYPE, box_value(m_majorType));
+
+        m_mediaStreamSample = streamSample;
+    }
+
     return m_mediaStreamSample;
 }
 
@@ -54,32 +73,62 @@ com_ptr<IMFSample> Payload::Sample()
      return m_mediaSample; 
 }
 
+_Use_decl_annotations_
+guid Payload::MajorType()
+{
+    return m_majorType;
+}
+
+_Use_decl_annotations_
+com_ptr<IMFMediaType> Payload::MediaType()
+{
+    return m_mediaType;
+}
+
 _Use_decl_annotations_
 hresult Payload::Sample(
     winrt::guid const& majorType,
     com_ptr<IMFMediaType> const& mediaType, 
     com_ptr<IMFSample> const& mediaSample)
 {
-    m_hasTransform = false;
+    NULL_CHK_HR(mediaSample, E_INVALIDARG);
 
-    // convert to mediastreamsample
     LONGLONG sampleTime = 0;
     IFR(mediaSample->GetSampleTime(&sampleTime));
 
-    Windows::Media::Core::MediaStreamSample streamSample = nullptr;
-    IFR(CreateMediaStreamSample(mediaSample, TimeSpan(sampleTime), streamSample));
+    // pooled payloads are reused, drop everything from the previous sample
+    if (m_mediaType != mediaType)
+    {
+        m_encodingProperties = nullptr;
+    }
 
-    winrt::guid type = majorType;
-    streamSample.ExtendedProperties().Insert(MF_MT_MAJOR_TYPE, box_value(type));
+    m_hasTransform = false;
+    m_propertySet = nullptr;
+    m_mediaStreamSample = nullptr;
+    m_stageTimes.fill(0);
 
     // store objects
+    m_majorType = majorType;
     m_mediaType = mediaType;
     m_mediaSample = mediaSample;
-    m_mediaStreamSample = streamSample;
+    m_sampleTime = sampleTime;
 
     return S_OK;
 }
 
+void Payload::Reset()
+{
+    m_hasTransform = false;
+    m_propertySet = nullptr;
+    m_mediaStreamSample = nullptr;
+    m_encodingProperties = nullptr;
+    m_mediaSample = nullptr;
+    m_mediaType = nullptr;
+    m_sampleTime = 0;
+    m_majorType = GUID_NULL;
+    m_stageTimes.fill(0);
+}
+
 _Use_decl_annotations_
 void Payload::SetTransformAndProjection(
     _In_ Windows::Foundation::Numerics::float4x4 const& cameraToWorld,
@@ -89,3 +138,37 @@ void Payload::SetTransformAndProjection(
     m_cameraToWorld = cameraToWorld;
     m_cameraProjection = cameraProjection;
 }
+
+_Use_decl_annotations_
+bool Payload::GetTransformAndProjection(
+    Windows::Foundation::Numerics::float4x4* cameraToWorld,
+    Windows::Foundation::Numerics::float4x4* cameraProjection)
+{
+    if (!m_hasTransform || cameraToWorld == nullptr || cameraProjection == nullptr)
+    {
+        return false;
+    }
+
+    *cameraToWorld = m_cameraToWorld;
+    *cameraProjection = m_cameraProjection;
+
+    return true;
+}
+
+_Use_decl_annotations_
+void Payload::MarkStage(
+    PayloadStage stage,
+    LONGLONG qpcTime)
+{
+    if (stage < PayloadStage::Count)
+    {
+        m_stageTimes[static_cast<size_t>(stage)] = qpcTime;
+    }
+}
+
+_Use_decl_annotations_
+LONGLONG Payload::StageTime(
+    PayloadStage stage)
+{
+    return stage < PayloadStage::Count ? m_stageTimes[static_cast<size_t>(stage)] : 0;
+}
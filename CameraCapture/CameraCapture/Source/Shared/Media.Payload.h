@@ -8,6 +8,8 @@
 #include <mfidl.h>
 #include <winrt/windows.media.mediaproperties.h>
 
+#include <array>
+
 // {09F82036-0542-4561-84A1-C59FEDA47403}
 extern const __declspec(selectany) winrt::guid MF_PAYLOAD_FLUSH =
 { 0x9f82036, 0x542, 0x4561, { 0x84, 0xa1, 0xc5, 0x9f, 0xed, 0xa4, 0x74, 0x3 } };
@@ -21,16 +23,48 @@ extern const __declspec(selectany) winrt::guid MF_PAYLOAD_MARKER_TICK =
 extern const __declspec(selectany) winrt::guid MF_PAYLOAD_MARKER_TICK_TIMESTAMP =
 { 0x86e63da3, 0xa537, 0x4887, { 0xae, 0x1a, 0x18, 0xbb, 0xe9, 0x9f, 0xce, 0x9 } };
 
+// points a payload passes on its way to unity, in the order they happen
+enum class PayloadStage
+{
+    Received = 0,   // stream sink got the sample
+    Dispatched,     // payload handler thread picked it up
+    Copied,         // capture texture copied for unity
+    Transformed,    // camera to world transform resolved
+    Delivered,      // state callback raised
+    Count
+};
+
+// qpc ticks, the stage stamps are compared against each other and the device timestamp
+inline LONGLONG QueryPerformanceTime()
+{
+    LARGE_INTEGER counter{};
+    QueryPerformanceCounter(&counter);
+
+    return counter.QuadPart;
+}
+
 struct __declspec(uuid("8300b3cc-c919-4c54-b01a-b375b843d3f8")) IStreamSample : ::IUnknown
 {
     virtual winrt::com_ptr<IMFSample> __stdcall Sample() = 0;
+    virtual winrt::guid __stdcall MajorType() = 0;
+    virtual winrt::com_ptr<IMFMediaType> __stdcall MediaType() = 0;
     virtual winrt::hresult __stdcall Sample(
         _In_ winrt::guid const& majorType,
         _In_ winrt::com_ptr<IMFMediaType> const& mediaType, 
         _In_ winrt::com_ptr<IMFSample> const& sample) = 0;
+    virtual void __stdcall Reset() = 0;
     virtual void __stdcall SetTransformAndProjection(
         _In_ winrt::Windows::Foundation::Numerics::float4x4 const& cameraTranform,
         _In_ winrt::Windows::Foundation::Numerics::float4x4 const& cameraProjection) = 0;
+    // copies into the caller's storage, false when the sample has no transform
+    virtual bool __stdcall GetTransformAndProjection(
+        _Out_ winrt::Windows::Foundation::Numerics::float4x4* cameraToWorld,
+        _Out_ winrt::Windows::Foundation::Numerics::float4x4* cameraProjection) = 0;
+    virtual void __stdcall MarkStage(
+        _In_ PayloadStage stage,
+        _In_ LONGLONG qpcTime) = 0;
+    virtual LONGLONG __stdcall StageTime(
+        _In_ PayloadStage stage) = 0;
 };
 
 namespace winrt::CameraCapture::Media::implementation
@@ -39,6 +73,8 @@ namespace winrt::CameraCapture::Media::implementation
     {
         Payload();
 
+        // created on first access, the encoding properties are kept while the media type is the same,
+        // MajorType and Sample read the stored values with no projection at all
         Windows::Media::MediaProperties::MediaPropertySet MediaPropertySet();
         Windows::Media::MediaProperties::IMediaEncodingProperties EncodingProperties();
         Windows::Media::Core::MediaStreamSample MediaStreamSample();
@@ -49,17 +85,30 @@ namespace winrt::CameraCapture::Media::implementation
 
         // IStreamSample
         virtual winrt::com_ptr<IMFSample> __stdcall Sample() override;
+        virtual guid __stdcall MajorType() override;
+        virtual com_ptr<IMFMediaType> __stdcall MediaType() override;
         virtual hresult __stdcall Sample(
             _In_ guid const& majorType,
             _In_ com_ptr<IMFMediaType> const& mediaType, 
             _In_ com_ptr<IMFSample> const& sample) override;
+        virtual void __stdcall Reset() override;
         virtual void __stdcall SetTransformAndProjection(
             _In_ Windows::Foundation::Numerics::float4x4 const& cameraTranform,
             _In_ Windows::Foundation::Numerics::float4x4 const& cameraProjection) override;
+        virtual bool __stdcall GetTransformAndProjection(
+            _Out_ Windows::Foundation::Numerics::float4x4* cameraToWorld,
+            _Out_ Windows::Foundation::Numerics::float4x4* cameraProjection) override;
+        virtual void __stdcall MarkStage(
+            _In_ PayloadStage stage,
+            _In_ LONGLONG qpcTime) override;
+        virtual LONGLONG __stdcall StageTime(
+            _In_ PayloadStage stage) override;
 
     private:
+        guid m_majorType;
         com_ptr<IMFMediaType> m_mediaType;
         com_ptr<IMFSample> m_mediaSample;
+        LONGLONG m_sampleTime;
 
         Windows::Media::MediaProperties::MediaPropertySet m_propertySet;
         Windows::Media::MediaProperties::IMediaEncodingProperties m_encodingProperties;
@@ -68,6 +117,9 @@ namespace winrt::CameraCapture::Media::implementation
         bool m_hasTransform;
         Windows::Foundation::Numerics::float4x4 m_cameraToWorld;
         Windows::Foundation::Numerics::float4x4 m_cameraProjection;
+
+        // 0 until the stage is reached
+        std::array<LONGLONG, static_cast<size_t>(PayloadStage::Count)> m_stageTimes;
     };
 }
 
@@ -14,15 +14,53 @@ using namespace CameraCapture::Media::implementation;
 using namespace Windows::Media::Core;
 using namespace Windows::Media::MediaProperties;
 
+static std::atomic<PayloadQueueMode> s_workQueueMode = PayloadQueueMode::Shared;
+static std::atomic<int32_t> s_workQueuePriority = 0;
+
+_Use_decl_annotations_
+HRESULT PayloadHandler::SetWorkQueue(
+    PayloadQueueMode mode,
+    int32_t priority)
+{
+    if (mode < PayloadQueueMode::Shared || mode > PayloadQueueMode::Playback)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    s_workQueueMode = mode;
+    s_workQueuePriority = priority;
+
+    return S_OK;
+}
+
 PayloadHandler::PayloadHandler()
     : m_isShutdown(false)
     , m_workItemQueueId(MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    , m_sharedQueueId(MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    , m_drainPending(false)
     , m_transform(CameraCapture::Media::Transform())
     , m_appCoordinateSystem(nullptr)
 {
     IFT(MFStartup(MF_VERSION));
 
-    IFT(MFAllocateSerialWorkQueue(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, &m_workItemQueueId));
+    // payloads still go out one at a time in order, the serial queue sits on top of either
+    DWORD parentQueueId = MFASYNC_CALLBACK_QUEUE_MULTITHREADED;
+
+    auto mode = s_workQueueMode.load();
+    if (mode != PayloadQueueMode::Shared)
+    {
+        // doesn't compete with the rest of media foundation's work, mrc composition included
+        DWORD taskId = 0;
+        IFT(MFLockSharedWorkQueue(
+            mode == PayloadQueueMode::Capture ? L"Capture" : L"Playback",
+            s_workQueuePriority.load(),
+            &taskId,
+            &m_sharedQueueId));
+
+        parentQueueId = m_sharedQueueId;
+    }
+
+    IFT(MFAllocateSerialWorkQueue(parentQueueId, &m_workItemQueueId));
 }
 
 Windows::Perception::Spatial::SpatialCoordinateSystem PayloadHandler::AppCoordinateSystem()
@@ -49,29 +87,62 @@ void PayloadHandler::Close()
 {
     auto gurad = m_cs.Guard();
 
+    // the destructor closes again
+    if (m_isShutdown)
+    {
+        return;
+    }
+
     m_isShutdown = true;
 
+    m_videoQueue.Clear();
+    m_audioQueue.Clear();
+
+    // a scheduled pose refresh holds the transform until it runs
+    get_self<Media::implementation::Transform>(m_transform)->Close();
+
+    // work items still queued see the shutdown and return
+    if (m_workItemQueueId != MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    {
+        MFUnlockWorkQueue(m_workItemQueueId);
+
+        m_workItemQueueId = MFASYNC_CALLBACK_QUEUE_UNDEFINED;
+    }
+
+    if (m_sharedQueueId != MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    {
+        MFUnlockWorkQueue(m_sharedQueueId);
+
+        m_sharedQueueId = MFASYNC_CALLBACK_QUEUE_UNDEFINED;
+    }
+
     MFShutdown();
 }
 
 void PayloadHandler::QueueEncodingProfile(MediaEncodingProfile const& mediaProfile)
 {
-    QueueUnknown(winrt::get_unknown(mediaProfile));
+    QueueItem(mediaProfile);
 }
 
 void PayloadHandler::QueueMetadata(MediaPropertySet const& metaData)
 {
-    QueueUnknown(winrt::get_unknown(metaData));
+    QueueItem(metaData);
 }
 
 void PayloadHandler::QueueEncodingProperties(Windows::Media::MediaProperties::IMediaEncodingProperties const& mediaDescription)
 {
-    QueueUnknown(winrt::get_unknown(mediaDescription));
+    QueueItem(mediaDescription);
 }
 
 void PayloadHandler::QueuePayload(CameraCapture::Media::Payload const& payload)
 {
-    QueueUnknown(winrt::get_unknown(payload));
+    bool queued = false;
+    if (SUCCEEDED(QueueStreamPayload(payload, &queued)) && queued)
+    {
+        return;
+    }
+
+    QueueItem(payload);
 }
 
 _Use_decl_annotations_
@@ -83,16 +154,16 @@ HRESULT PayloadHandler::QueueMFSample(
     auto payload = make<Media::implementation::Payload>();
 
     payload.as<IStreamSample>()->Sample(majorType, type, sample);
-    
-    return QueueUnknown(winrt::get_unknown(payload));
+
+    QueuePayload(payload);
+
+    return S_OK;
 }
 
 _Use_decl_annotations_
-HRESULT PayloadHandler::QueueUnknown(
-    IUnknown* pUnknown)
+HRESULT PayloadHandler::QueueItem(
+    PayloadItem::Value const& value)
 {
-    NULL_CHK_HR(pUnknown, S_OK);
-
     auto gurad = m_cs.Guard();
 
     if (m_isShutdown)
@@ -105,10 +176,104 @@ HRESULT PayloadHandler::QueueUnknown(
         return S_OK;
     }
 
+    auto item = make<PayloadItem>(value);
+
+    // the work queue holds its own reference to the result
     com_ptr<IMFAsyncResult> asyncResult = nullptr;
-    IFR(MFCreateAsyncResult(nullptr, this, pUnknown, asyncResult.put()));
+    IFR(MFCreateAsyncResult(nullptr, this, winrt::get_unknown(item), asyncResult.put()));
+
+    return MFPutWorkItemEx2(m_workItemQueueId, 0, asyncResult.get());
+}
+
+_Use_decl_annotations_
+HRESULT PayloadHandler::QueueStreamPayload(
+    CameraCapture::Media::Payload const& payload,
+    bool* queued)
+{
+    NULL_CHK_HR(queued, E_INVALIDARG);
+
+    *queued = false;
+
+    auto streamSample = payload.try_as<IStreamSample>();
+    if (streamSample == nullptr || streamSample->Sample() == nullptr)
+    {
+        return S_OK;
+    }
+
+    auto majorType = streamSample->MajorType();
+    if (majorType != MFMediaType_Video && majorType != MFMediaType_Audio)
+    {
+        return S_OK;
+    }
+
+    // Close unlocks the work queue under the same lock
+    auto gurad = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        IFR(MF_E_SHUTDOWN);
+    }
+
+    if (m_workItemQueueId == MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    {
+        return S_OK;
+    }
+
+    // each stream sink is the only producer for its queue
+    if (majorType == MFMediaType_Video)
+    {
+        m_videoQueue.Push(payload);
+    }
+    else
+    {
+        m_audioQueue.Push(payload);
+    }
+
+    *queued = true;
+
+    // one work item per batch, the consumer clears the flag before draining
+    if (!m_drainPending.exchange(true))
+    {
+        HRESULT hr = MFPutWorkItem2(m_workItemQueueId, 0, this, nullptr);
+        if (FAILED(hr))
+        {
+            m_drainPending = false;
+
+            IFR(hr);
+        }
+    }
+
+    return S_OK;
+}
+
+void PayloadHandler::DrainStreamPayloads()
+{
+    PLUGIN_TRACE_SCOPE("PayloadHandler.DrainStreamPayloads", PLUGIN_TRACE_KEYWORD_SAMPLE);
+
+    m_drainPending = false;
+
+    auto payload = CameraCapture::Media::Payload(nullptr);
+
+    // audio first, it has the smaller latency budget
+    while (!m_isShutdown && m_audioQueue.TryPop(payload))
+    {
+        if (m_payloadEvent)
+        {
+            m_payloadEvent(*this, payload);
+        }
+    }
+
+    while (!m_isShutdown && m_videoQueue.TryPop(payload))
+    {
+        payload.as<IStreamSample>()->MarkStage(PayloadStage::Dispatched, QueryPerformanceTime());
+
+        if (m_payloadEvent)
+        {
+            m_payloadEvent(*this, payload);
+        }
+    }
 
-    return MFPutWorkItemEx2(m_workItemQueueId, 0, asyncResult.detach());
+    payload = nullptr;
 }
 
 _Use_decl_annotations_
@@ -138,53 +303,57 @@ HRESULT PayloadHandler::Invoke(
         return S_OK;
     }
 
-    // convert back to Payload
-    com_ptr<IUnknown> spState = nullptr;
-    spState.attach(pAsyncResult->GetStateNoAddRef());
+    // stream samples are queued without a state object
+    if (pAsyncResult->GetStateNoAddRef() == nullptr)
+    {
+        DrainStreamPayloads();
+
+        return pAsyncResult->SetStatus(S_OK);
+    }
+
+    // everything else carries a PayloadItem, no need to probe the type
+    Windows::Foundation::IInspectable state = nullptr;
+    copy_from_abi(state, pAsyncResult->GetStateNoAddRef());
+
+    auto item = get_self<PayloadItem>(state);
 
-    NULL_CHK_HR(spState, E_POINTER);
-        
     hresult hr = S_OK;
 
-    auto payload = spState.try_as<CameraCapture::Media::Payload>();
-    auto profile = spState.try_as<MediaEncodingProfile>();
-    auto metaData = spState.try_as<MediaPropertySet>();
-    auto mediaDescription = spState.try_as<IMediaEncodingProperties>();
-    auto streamSample = spState.try_as<MediaStreamSample>();
-    if (profile != nullptr)
+    switch (item->value.index())
     {
-        if (m_profileEvent)
+    case PayloadItem::TypePayload:
+        if (m_payloadEvent)
         {
-            m_profileEvent(*this, profile);
+            m_payloadEvent(*this, std::get<CameraCapture::Media::Payload>(item->value));
         }
-    }
-    else if (payload != nullptr)
-    {
-        if (m_payloadEvent)
+        break;
+    case PayloadItem::TypeProfile:
+        if (m_profileEvent)
         {
-            m_payloadEvent(*this, payload);
+            m_profileEvent(*this, std::get<MediaEncodingProfile>(item->value));
         }
-    } 
-    else if (metaData != nullptr)
-    {
+        break;
+    case PayloadItem::TypeMetadata:
         if (m_metaDataEvent)
         {
-            m_metaDataEvent(*this, metaData);
+            m_metaDataEvent(*this, std::get<MediaPropertySet>(item->value));
         }
-    } 
-    else if (mediaDescription != nullptr)
-    {
+        break;
+    case PayloadItem::TypeEncodingProperties:
         if (m_mediaDescriptionEvent)
         {
-            m_mediaDescriptionEvent(*this, mediaDescription);
+            m_mediaDescriptionEvent(*this, std::get<IMediaEncodingProperties>(item->value));
         }
-    }
-    else if (streamSample != nullptr)
-    {
+        break;
+    case PayloadItem::TypeStreamSample:
         if (m_streamSampleEvent)
         {
-            m_streamSampleEvent(*this, streamSample);
+            m_streamSampleEvent(*this, std::get<MediaStreamSample>(item->value));
         }
+        break;
+    default:
+        hr = E_UNEXPECTED;
+        break;
     }
 
     return pAsyncResult->SetStatus(hr);
@@ -10,14 +10,51 @@
 #include <mferror.h>
 
 #include "Media.Transform.h"
+#include "Media.PayloadQueue.h"
+
+#include <variant>
+
+#define PAYLOAD_QUEUE_VIDEO_SIZE 4
+#define PAYLOAD_QUEUE_AUDIO_SIZE 32
 
 namespace winrt::CameraCapture::Media::implementation
 {
+    // work item state, the variant index tells Invoke what was queued
+    struct PayloadItem : winrt::implements<PayloadItem, Windows::Foundation::IInspectable>
+    {
+        using Value = std::variant<
+            CameraCapture::Media::Payload,
+            Windows::Media::MediaProperties::MediaEncodingProfile,
+            Windows::Media::MediaProperties::MediaPropertySet,
+            Windows::Media::MediaProperties::IMediaEncodingProperties,
+            Windows::Media::Core::MediaStreamSample>;
+
+        // matches the order of the variant alternatives
+        enum : size_t
+        {
+            TypePayload = 0,
+            TypeProfile,
+            TypeMetadata,
+            TypeEncodingProperties,
+            TypeStreamSample
+        };
+
+        PayloadItem(Value const& itemValue) : value(itemValue) {}
+
+        Value value;
+    };
+
     struct PayloadHandler : PayloadHandlerT<PayloadHandler, IMFAsyncCallback>
     {
         PayloadHandler();
         ~PayloadHandler() { Close(); }
 
+        // not part of the runtime class, process wide, handlers created afterwards deliver on it.
+        // the priority is the base priority of the mmcss queue's threads, unused for Shared
+        static HRESULT SetWorkQueue(
+            _In_ PayloadQueueMode mode,
+            _In_ int32_t priority);
+
         // PayloadHandler
         bool ProceesTranform(CameraCapture::Media::Payload const& payload);
         Windows::Perception::Spatial::SpatialCoordinateSystem AppCoordinateSystem();
@@ -83,9 +120,6 @@ namespace winrt::CameraCapture::Media::implementation
             _In_ com_ptr<IMFMediaType> const& type,
             _In_ com_ptr<IMFSample> const& sample);
 
-        STDMETHODIMP QueueUnknown(
-            _In_ ::IUnknown* pUnknown);
-
         // IMFAsyncCallback
         STDOVERRIDEMETHODIMP GetParameters(
             __RPC__out DWORD *pdwFlags,
@@ -93,11 +127,25 @@ namespace winrt::CameraCapture::Media::implementation
         STDOVERRIDEMETHODIMP Invoke(
             __RPC__in_opt IMFAsyncResult *pAsyncResult);
 
+    private:
+        HRESULT QueueItem(
+            _In_ PayloadItem::Value const& value);
+        HRESULT QueueStreamPayload(
+            _In_ CameraCapture::Media::Payload const& payload,
+            _Out_ bool* queued);
+        void DrainStreamPayloads();
+
     private:
         CriticalSection m_cs;
         boolean m_isShutdown;
         DWORD m_workItemQueueId;
-        
+        DWORD m_sharedQueueId;      // the mmcss queue under the serial one, locked while the handler lives
+
+        // samples bypass the per item work queue dispatch, one wakeup drains a batch
+        PayloadQueue<CameraCapture::Media::Payload, PAYLOAD_QUEUE_VIDEO_SIZE> m_videoQueue;
+        PayloadQueue<CameraCapture::Media::Payload, PAYLOAD_QUEUE_AUDIO_SIZE> m_audioQueue;
+        std::atomic<bool> m_drainPending;
+
         event<Windows::Foundation::EventHandler<Windows::Media::MediaProperties::MediaEncodingProfile>> m_profileEvent;
         event<Windows::Foundation::EventHandler<CameraCapture::Media::Payload>> m_payloadEvent;
         event<Windows::Foundation::EventHandler<Windows::Media::Core::MediaStreamSample>> m_streamSampleEvent;
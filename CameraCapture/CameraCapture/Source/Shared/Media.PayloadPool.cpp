@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.PayloadPool.h"
+
+using namespace winrt;
+
+PayloadPool::PayloadPool()
+    : m_occupancyTotal(0)
+    , m_occupancySamples(0)
+{}
+
+_Use_decl_annotations_
+HRESULT PayloadPool::Acquire(
+    GUID const& majorType,
+    com_ptr<IMFMediaType> const& mediaType,
+    com_ptr<IMFSample> const& sample,
+    CameraCapture::Media::Payload& payload)
+{
+    payload = nullptr;
+
+    CameraCapture::Media::Payload found = nullptr;
+
+    uint64_t inUse = 0;
+    for (auto const& pooled : m_payloads)
+    {
+        if (!IsFree(pooled))
+        {
+            ++inUse;
+
+            continue;
+        }
+
+        if (found == nullptr)
+        {
+            found = pooled;
+        }
+        else
+        {
+            // idle payloads still hold the last capture sample, give it back to the source
+            pooled.as<IStreamSample>()->Reset();
+        }
+    }
+
+    if (found == nullptr)
+    {
+        found = make<CameraCapture::Media::implementation::Payload>();
+
+        // everything is in flight, hand out an unpooled payload
+        if (m_payloads.size() < MAX_POOLED_PAYLOADS)
+        {
+            m_payloads.push_back(found);
+        }
+    }
+
+    m_occupancyTotal.fetch_add(inUse, std::memory_order_relaxed);
+    m_occupancySamples.fetch_add(1, std::memory_order_relaxed);
+
+    IFR(found.as<IStreamSample>()->Sample(majorType, mediaType, sample));
+
+    payload = found;
+
+    return S_OK;
+}
+
+void PayloadPool::Clear()
+{
+    for (auto const& pooled : m_payloads)
+    {
+        pooled.as<IStreamSample>()->Reset();
+    }
+    m_payloads.clear();
+
+    m_occupancyTotal = 0;
+    m_occupancySamples = 0;
+}
+
+float PayloadPool::AverageOccupancy() const
+{
+    uint64_t samples = m_occupancySamples.load(std::memory_order_relaxed);
+    if (samples == 0)
+    {
+        return 0.0f;
+    }
+
+    return static_cast<float>(static_cast<double>(m_occupancyTotal.load(std::memory_order_relaxed)) / samples);
+}
+
+_Use_decl_annotations_
+bool PayloadPool::IsFree(
+    CameraCapture::Media::Payload const& payload)
+{
+    auto unknown = winrt::get_unknown(payload);
+
+    // the count returned by Release is only used to check for the pool being the last owner
+    unknown->AddRef();
+
+    return unknown->Release() == 1;
+}
@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.Payload.h"
+
+#include <atomic>
+#include <vector>
+
+#define MAX_POOLED_PAYLOADS 40
+
+// recycles Payload objects for a stream sink, a payload is free again
+// once the pool holds the last reference to it. not thread safe, the
+// stream sink calls it under its own lock
+struct PayloadPool
+{
+    PayloadPool();
+    ~PayloadPool() { Clear(); }
+
+    HRESULT Acquire(
+        _In_ GUID const& majorType,
+        _In_ winrt::com_ptr<IMFMediaType> const& mediaType,
+        _In_ winrt::com_ptr<IMFSample> const& sample,
+        _Out_ winrt::CameraCapture::Media::Payload& payload);
+
+    void Clear();
+
+    // payloads still owned downstream when a new sample arrived, safe from any thread
+    float AverageOccupancy() const;
+
+private:
+    static bool IsFree(
+        _In_ winrt::CameraCapture::Media::Payload const& payload);
+
+private:
+    std::vector<winrt::CameraCapture::Media::Payload> m_payloads;
+
+    std::atomic<uint64_t> m_occupancyTotal;
+    std::atomic<uint64_t> m_occupancySamples;
+};
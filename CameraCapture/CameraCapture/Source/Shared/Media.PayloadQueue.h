@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// bounded lock-free queue between a stream sink and the payload handler.
+// one producer and one consumer, when the queue is full the producer drops
+// the oldest entry, so the dequeue side is claimed with a cas
+template <typename T, size_t N>
+struct PayloadQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "PayloadQueue size must be a power of two");
+
+    PayloadQueue()
+        : m_enqueuePos(0)
+        , m_dequeuePos(0)
+        , m_dropped(0)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // producer only, returns true if an older entry was dropped to make room
+    bool Push(T const& value)
+    {
+        bool dropped = false;
+
+        while (!TryPush(value))
+        {
+            T oldest{ nullptr };
+            if (TryPop(oldest))
+            {
+                ++m_dropped;
+
+                dropped = true;
+            }
+            else
+            {
+                // the consumer is still moving out of the slot we need
+                YieldProcessor();
+            }
+        }
+
+        return dropped;
+    }
+
+    bool TryPop(T& value)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+
+        for (;;)
+        {
+            cell = &m_cells[pos & (N - 1)];
+
+            auto diff = static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // empty
+                return false;
+            }
+            else
+            {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->value = nullptr;
+        cell->sequence.store(pos + N, std::memory_order_release);
+
+        return true;
+    }
+
+    void Clear()
+    {
+        T value{ nullptr };
+        while (TryPop(value))
+        {
+            value = nullptr;
+        }
+    }
+
+    uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    bool TryPush(T const& value)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[pos & (N - 1)];
+
+        auto diff = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+        if (diff != 0)
+        {
+            // full
+            return false;
+        }
+
+        cell.value = value;
+        cell.sequence.store(pos + 1, std::memory_order_release);
+
+        m_enqueuePos.store(pos + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value{ nullptr };
+    };
+
+    // keep the producer and consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) std::atomic<size_t> m_dequeuePos;
+    std::atomic<uint64_t> m_dropped;
+
+    std::array<Cell, N> m_cells;
+};
@@ -0,0 +1,315 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.Recorder.h"
+
+#include <mfapi.h>
+#include <mferror.h>
+
+using namespace winrt;
+
+// {0B5A2C5E-4E59-4F0A-9E0B-6A3C1E8D7F21}
+// keeps the capture sample alive while the encoder reads its buffers
+extern const __declspec(selectany) GUID MF_RECORDER_SOURCE_SAMPLE =
+    { 0xb5a2c5e, 0x4e59, 0x4f0a, { 0x9e, 0xb, 0x6a, 0x3c, 0x1e, 0x8d, 0x7f, 0x21 } };
+
+_Use_decl_annotations_
+HRESULT Recorder::Create(
+    LPCWSTR path,
+    com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+    com_ptr<IMFMediaType> const& videoType,
+    com_ptr<IMFMediaType> const& audioType,
+    com_ptr<Recorder>& recorder)
+{
+    NULL_CHK_HR(path, E_INVALIDARG);
+    NULL_CHK_HR(dxgiDeviceManager, E_INVALIDARG);
+    NULL_CHK_HR(videoType, E_INVALIDARG);
+
+    recorder = nullptr;
+
+    // hardware encoders on the media device, fragments keep the file playable if the app dies
+    com_ptr<IMFAttributes> attributes = nullptr;
+    IFR(MFCreateAttributes(attributes.put(), 4));
+    IFR(attributes->SetGUID(MF_TRANSCODE_CONTAINERTYPE, MFTranscodeContainerType_FMPEG4));
+    IFR(attributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE));
+    IFR(attributes->SetUINT32(MF_SINK_WRITER_DISABLE_THROTTLING, TRUE));
+    IFR(attributes->SetUnknown(MF_SINK_WRITER_D3D_MANAGER, dxgiDeviceManager.get()));
+
+    com_ptr<IMFSinkWriter> sinkWriter = nullptr;
+    IFR(MFCreateSinkWriterFromURL(path, nullptr, attributes.get(), sinkWriter.put()));
+
+    // h264 at about 1/8 bit per pixel
+    UINT32 width = 0, height = 0;
+    IFR(MFGetAttributeSize(videoType.get(), MF_MT_FRAME_SIZE, &width, &height));
+
+    UINT32 rateNumerator = 30, rateDenominator = 1;
+    MFGetAttributeRatio(videoType.get(), MF_MT_FRAME_RATE, &rateNumerator, &rateDenominator);
+    if (rateNumerator < 1 || rateDenominator < 1)
+    {
+        rateNumerator = 30;
+        rateDenominator = 1;
+    }
+
+    UINT32 bitrate = static_cast<UINT32>(static_cast<uint64_t>(width) * height * rateNumerator / rateDenominator / 8);
+
+    com_ptr<IMFMediaType> videoOutputType = nullptr;
+    IFR(MFCreateMediaType(videoOutputType.put()));
+    IFR(videoOutputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    IFR(videoOutputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264));
+    IFR(videoOutputType->SetUINT32(MF_MT_AVG_BITRATE, bitrate));
+    IFR(videoOutputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    IFR(MFSetAttributeSize(videoOutputType.get(), MF_MT_FRAME_SIZE, width, height));
+    IFR(MFSetAttributeRatio(videoOutputType.get(), MF_MT_FRAME_RATE, rateNumerator, rateDenominator));
+    IFR(MFSetAttributeRatio(videoOutputType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+
+    DWORD videoStreamIndex = 0;
+    IFR(sinkWriter->AddStream(videoOutputType.get(), &videoStreamIndex));
+    IFR(sinkWriter->SetInputMediaType(videoStreamIndex, videoType.get(), nullptr));
+
+    // aac only takes 44.1 or 48 khz, other devices record video only
+    DWORD audioStreamIndex = 0;
+    boolean hasAudio = false;
+    if (audioType != nullptr)
+    {
+        UINT32 sampleRate = MFGetAttributeUINT32(audioType.get(), MF_MT_AUDIO_SAMPLES_PER_SECOND, 0);
+        UINT32 channelCount = MFGetAttributeUINT32(audioType.get(), MF_MT_AUDIO_NUM_CHANNELS, 0);
+
+        if ((sampleRate == 44100 || sampleRate == 48000) && (channelCount == 1 || channelCount == 2))
+        {
+            com_ptr<IMFMediaType> audioOutputType = nullptr;
+            IFR(MFCreateMediaType(audioOutputType.put()));
+            IFR(audioOutputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio));
+            IFR(audioOutputType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_AAC));
+            IFR(audioOutputType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16));
+            IFR(audioOutputType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, sampleRate));
+            IFR(audioOutputType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, channelCount));
+            IFR(audioOutputType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, 24000));
+
+            IFR(sinkWriter->AddStream(audioOutputType.get(), &audioStreamIndex));
+            IFR(sinkWriter->SetInputMediaType(audioStreamIndex, audioType.get(), nullptr));
+
+            hasAudio = true;
+        }
+        else
+        {
+            Log(L"Recorder: audio format not supported, %d hz %d channels\n", sampleRate, channelCount);
+        }
+    }
+
+    IFR(sinkWriter->BeginWriting());
+
+    auto record = make<Recorder>().as<Recorder>();
+    IFR(MFAllocateSerialWorkQueue(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, &record->m_workQueueId));
+    record->m_sinkWriter = sinkWriter;
+    record->m_videoStreamIndex = videoStreamIndex;
+    record->m_audioStreamIndex = audioStreamIndex;
+    record->m_hasAudio = hasAudio;
+
+    recorder = record;
+
+    return S_OK;
+}
+
+Recorder::Recorder()
+    : m_isShutdown(false)
+    , m_workQueueId(MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    , m_writePending(false)
+    , m_sinkWriter(nullptr)
+    , m_videoStreamIndex(0)
+    , m_audioStreamIndex(0)
+    , m_hasAudio(false)
+    , m_hasTimeBase(false)
+    , m_timeBase(0)
+    , m_droppedSamples(0)
+{}
+
+Recorder::~Recorder()
+{
+    Finalize();
+
+    if (m_workQueueId != MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    {
+        MFUnlockWorkQueue(m_workQueueId);
+
+        m_workQueueId = MFASYNC_CALLBACK_QUEUE_UNDEFINED;
+    }
+}
+
+_Use_decl_annotations_
+HRESULT Recorder::WriteSample(
+    GUID const& majorType,
+    com_ptr<IMFSample> const& sample)
+{
+    NULL_CHK_HR(sample, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        IFR(MF_E_SHUTDOWN);
+    }
+
+    bool isVideo = MFMediaType_Video == majorType;
+    if (!isVideo && !(MFMediaType_Audio == majorType && m_hasAudio))
+    {
+        return S_OK;
+    }
+
+    LONGLONG sampleTime = 0;
+    IFR(sample->GetSampleTime(&sampleTime));
+
+    if (!m_hasTimeBase)
+    {
+        if (!isVideo)
+        {
+            return S_OK;
+        }
+
+        m_timeBase = sampleTime;
+        m_hasTimeBase = true;
+    }
+
+    if (sampleTime < m_timeBase)
+    {
+        return S_OK;
+    }
+
+    // a second sample on the same buffers, the preview payload keeps its own timing
+    com_ptr<IMFSample> recordSample = nullptr;
+    IFR(MFCreateSample(recordSample.put()));
+
+    DWORD bufferCount = 0;
+    IFR(sample->GetBufferCount(&bufferCount));
+    for (DWORD i = 0; i < bufferCount; ++i)
+    {
+        com_ptr<IMFMediaBuffer> buffer = nullptr;
+        IFR(sample->GetBufferByIndex(i, buffer.put()));
+        IFR(recordSample->AddBuffer(buffer.get()));
+    }
+
+    IFR(recordSample->SetUnknown(MF_RECORDER_SOURCE_SAMPLE, sample.get()));
+    IFR(recordSample->SetSampleTime(sampleTime - m_timeBase));
+
+    LONGLONG sampleDuration = 0;
+    if (SUCCEEDED(sample->GetSampleDuration(&sampleDuration)))
+    {
+        IFR(recordSample->SetSampleDuration(sampleDuration));
+    }
+
+    // queued video holds capture buffers, keep only a few so preview doesn't starve
+    auto& queue = isVideo ? m_videoSamples : m_audioSamples;
+    size_t maxSamples = isVideo ? MAX_RECORDER_PENDING_VIDEO : MAX_RECORDER_PENDING_AUDIO;
+
+    queue.push_back({ isVideo ? m_videoStreamIndex : m_audioStreamIndex, recordSample });
+    while (queue.size() > maxSamples)
+    {
+        queue.pop_front();
+
+        ++m_droppedSamples;
+    }
+
+    if (!m_writePending)
+    {
+        IFR(MFPutWorkItem2(m_workQueueId, 0, this, nullptr));
+
+        m_writePending = true;
+    }
+
+    return S_OK;
+}
+
+HRESULT Recorder::Finalize()
+{
+    auto writerGuard = m_writerCs.Guard();
+
+    {
+        auto guard = m_cs.Guard();
+
+        if (m_isShutdown)
+        {
+            return S_OK;
+        }
+        m_isShutdown = true;
+    }
+
+    NULL_CHK_HR(m_sinkWriter, MF_E_NOT_INITIALIZED);
+
+    WritePendingSamples();
+
+    // nothing was written, the sink writer refuses to finalize an empty file
+    HRESULT hr = m_hasTimeBase ? m_sinkWriter->Finalize() : S_OK;
+
+    m_sinkWriter = nullptr;
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT Recorder::GetParameters(
+    DWORD* pdwFlags,
+    DWORD* pdwQueue)
+{
+    *pdwFlags = 0;
+    *pdwQueue = m_workQueueId;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT Recorder::Invoke(
+    IMFAsyncResult* pAsyncResult)
+{
+    UNREFERENCED_PARAMETER(pAsyncResult);
+
+    auto writerGuard = m_writerCs.Guard();
+
+    if (m_sinkWriter == nullptr)
+    {
+        return S_OK;
+    }
+
+    WritePendingSamples();
+
+    return S_OK;
+}
+
+// private
+void Recorder::WritePendingSamples()
+{
+    std::deque<PendingSample> videoSamples;
+    std::deque<PendingSample> audioSamples;
+    {
+        auto guard = m_cs.Guard();
+
+        videoSamples.swap(m_videoSamples);
+        audioSamples.swap(m_audioSamples);
+
+        m_writePending = false;
+    }
+
+    // interleave by time, the muxer writes fragments in arrival order
+    while (!videoSamples.empty() || !audioSamples.empty())
+    {
+        bool takeVideo = audioSamples.empty();
+        if (!takeVideo && !videoSamples.empty())
+        {
+            LONGLONG videoTime = 0, audioTime = 0;
+            videoSamples.front().sample->GetSampleTime(&videoTime);
+            audioSamples.front().sample->GetSampleTime(&audioTime);
+
+            takeVideo = videoTime <= audioTime;
+        }
+
+        auto& queue = takeVideo ? videoSamples : audioSamples;
+
+        HRESULT hr = m_sinkWriter->WriteSample(queue.front().streamIndex, queue.front().sample.get());
+        if (FAILED(hr))
+        {
+            Log(L"Recorder: WriteSample failed: 0x%lx\n", hr);
+        }
+
+        queue.pop_front();
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <mfidl.h>
+#include <mfreadwrite.h>
+
+#include <deque>
+
+#define MAX_RECORDER_PENDING_VIDEO 4
+#define MAX_RECORDER_PENDING_AUDIO 32
+
+// fragmented mp4 writer fed from the preview sink, samples share the capture
+// buffers and are encoded by the sink writer on a serial work queue
+struct Recorder : winrt::implements<Recorder, IMFAsyncCallback>
+{
+    static HRESULT Create(
+        _In_ LPCWSTR path,
+        _In_ winrt::com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+        _In_ winrt::com_ptr<IMFMediaType> const& videoType,
+        _In_opt_ winrt::com_ptr<IMFMediaType> const& audioType,
+        _Out_ winrt::com_ptr<Recorder>& recorder);
+
+    Recorder();
+    virtual ~Recorder();
+
+    // never blocks on the encoder, a full queue drops the oldest sample
+    HRESULT WriteSample(
+        _In_ GUID const& majorType,
+        _In_ winrt::com_ptr<IMFSample> const& sample);
+
+    // writes what is still queued and closes the file
+    HRESULT Finalize();
+
+    uint64_t DroppedSamples() const { return m_droppedSamples; }
+
+    // IMFAsyncCallback
+    STDOVERRIDEMETHODIMP GetParameters(
+        _Out_ DWORD* pdwFlags,
+        _Out_ DWORD* pdwQueue);
+    STDOVERRIDEMETHODIMP Invoke(
+        _In_ IMFAsyncResult* pAsyncResult);
+
+private:
+    struct PendingSample
+    {
+        DWORD streamIndex;
+        winrt::com_ptr<IMFSample> sample;
+    };
+
+    void WritePendingSamples();
+
+private:
+    // lock order is m_writerCs then m_cs, WriteSample only takes m_cs
+    CriticalSection m_cs;
+    CriticalSection m_writerCs;
+    boolean m_isShutdown;
+    DWORD m_workQueueId;
+    boolean m_writePending;
+
+    winrt::com_ptr<IMFSinkWriter> m_sinkWriter;
+    DWORD m_videoStreamIndex;
+    DWORD m_audioStreamIndex;
+    boolean m_hasAudio;
+
+    // the file starts at the first video frame
+    boolean m_hasTimeBase;
+    LONGLONG m_timeBase;
+
+    std::deque<PendingSample> m_videoSamples;
+    std::deque<PendingSample> m_audioSamples;
+    uint64_t m_droppedSamples;
+};
@@ -0,0 +1,124 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.SampleTexture.h"
+
+#include <mferror.h>
+
+using namespace winrt;
+
+_Use_decl_annotations_
+bool SampleTexture::IsShareable(
+    D3D11_TEXTURE2D_DESC const& desc)
+{
+    // keyed mutex pools need the producer to release the key first
+    if ((desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX) != 0)
+    {
+        return false;
+    }
+
+    if ((desc.MiscFlags & (D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE)) == 0)
+    {
+        return false;
+    }
+
+    // unity external textures can't address a slice of an array
+    if (desc.ArraySize != 1 || desc.MipLevels > 1)
+    {
+        return false;
+    }
+
+    return desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM || desc.Format == DXGI_FORMAT_NV12;
+}
+
+_Use_decl_annotations_
+HRESULT SampleTexture::Create(
+    com_ptr<ID3D11Device> const d3dDevice,
+    com_ptr<ID3D11Texture2D> const& mediaTexture,
+    com_ptr<SampleTexture>& sampleTexture)
+{
+    NULL_CHK_HR(d3dDevice, E_INVALIDARG);
+    NULL_CHK_HR(mediaTexture, E_INVALIDARG);
+
+    sampleTexture = nullptr;
+
+    D3D11_TEXTURE2D_DESC desc{};
+    mediaTexture->GetDesc(&desc);
+
+    if (!IsShareable(desc))
+    {
+        IFR(MF_E_UNSUPPORTED_D3D_TYPE);
+    }
+
+    // open the capture texture on the unity device
+    com_ptr<ID3D11Texture2D> frameTexture = nullptr;
+    if ((desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED_NTHANDLE) != 0)
+    {
+        auto dxgiResource = mediaTexture.as<IDXGIResource1>();
+
+        winrt::handle sharedHandle{};
+        IFR(dxgiResource->CreateSharedHandle(nullptr, DXGI_SHARED_RESOURCE_READ, nullptr, sharedHandle.put()));
+
+        auto d3dDevice1 = d3dDevice.as<ID3D11Device1>();
+        IFR(d3dDevice1->OpenSharedResource1(sharedHandle.get(), __uuidof(ID3D11Texture2D), frameTexture.put_void()));
+    }
+    else
+    {
+        auto dxgiResource = mediaTexture.as<IDXGIResource>();
+
+        HANDLE sharedHandle = nullptr;
+        IFR(dxgiResource->GetSharedHandle(&sharedHandle));
+
+        IFR(d3dDevice->OpenSharedResource(sharedHandle, __uuidof(ID3D11Texture2D), frameTexture.put_void()));
+    }
+
+    com_ptr<ID3D11ShaderResourceView> spSRV = nullptr;
+    com_ptr<ID3D11ShaderResourceView> spChromaSRV = nullptr;
+    if (desc.Format == DXGI_FORMAT_NV12)
+    {
+        auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(frameTexture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8_UNORM);
+        IFR(d3dDevice->CreateShaderResourceView(frameTexture.get(), &srvDesc, spSRV.put()));
+
+        srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(frameTexture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8_UNORM);
+        IFR(d3dDevice->CreateShaderResourceView(frameTexture.get(), &srvDesc, spChromaSRV.put()));
+    }
+    else
+    {
+        auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(frameTexture.get(), D3D11_SRV_DIMENSION_TEXTURE2D);
+        IFR(d3dDevice->CreateShaderResourceView(frameTexture.get(), &srvDesc, spSRV.put()));
+    }
+
+    auto texture = make<SampleTexture>().as<SampleTexture>();
+    texture->mediaTexture = mediaTexture;
+    texture->frameTextureDesc = CD3D11_TEXTURE2D_DESC(desc);
+    texture->frameTexture = frameTexture;
+    texture->frameTextureSRV = spSRV;
+    texture->frameChromaSRV = spChromaSRV;
+
+    sampleTexture = texture;
+
+    return S_OK;
+}
+
+SampleTexture::SampleTexture()
+    : mediaTexture(nullptr)
+    , frameTextureDesc()
+    , frameTexture(nullptr)
+    , frameTextureSRV(nullptr)
+    , frameChromaSRV(nullptr)
+{}
+
+SampleTexture::~SampleTexture()
+{
+    Reset();
+}
+
+void SampleTexture::Reset()
+{
+    frameChromaSRV = nullptr;
+    frameTextureSRV = nullptr;
+    frameTexture = nullptr;
+    mediaTexture = nullptr;
+}
@@ -0,0 +1,33 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11_1.h>
+
+#define MAX_SAMPLE_TEXTURES 16
+
+// a capture sample texture opened on the unity device through its shared handle,
+// unity samples the media foundation buffer directly instead of a SharedTexture copy
+struct SampleTexture : winrt::implements<SampleTexture, winrt::Windows::Foundation::IInspectable>
+{
+    // the capture pipeline only shares some of its sample pools
+    static bool IsShareable(
+        _In_ D3D11_TEXTURE2D_DESC const& desc);
+
+    static HRESULT Create(
+        _In_ winrt::com_ptr<ID3D11Device> const d3dDevice,
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& mediaTexture,
+        _Out_ winrt::com_ptr<SampleTexture>& sampleTexture);
+
+    SampleTexture();
+    virtual ~SampleTexture();
+
+    void Reset();
+
+    winrt::com_ptr<ID3D11Texture2D> mediaTexture;
+    CD3D11_TEXTURE2D_DESC frameTextureDesc;
+    winrt::com_ptr<ID3D11Texture2D> frameTexture;
+    winrt::com_ptr<ID3D11ShaderResourceView> frameTextureSRV;  // luma plane for nv12
+    winrt::com_ptr<ID3D11ShaderResourceView> frameChromaSRV;   // nv12 only
+};
@@ -30,7 +30,10 @@ HRESULT SharedTexture::Create(
     com_ptr<ID3D11Device> const d3dDevice,
     com_ptr<IMFDXGIDeviceManager> const dxgiDeviceManager,
     uint32_t width, uint32_t height,
-    com_ptr<SharedTexture>& sharedTexture)
+    DXGI_FORMAT format,
+    TextureSyncMode syncMode,
+    com_ptr<SharedTexture>& sharedTexture,
+    uint32_t arraySize)
 {
     NULL_CHK_HR(d3dDevice, E_INVALIDARG);
     NULL_CHK_HR(dxgiDeviceManager, E_INVALIDARG);
@@ -39,6 +42,23 @@ HRESULT SharedTexture::Create(
         IFR(E_INVALIDARG);
     }
 
+    // nv12 is exposed as two planes, the format needs even dimensions, r16 carries depth and ir
+    bool isNv12 = format == DXGI_FORMAT_NV12;
+    if (!isNv12 && format != DXGI_FORMAT_B8G8R8A8_UNORM && format != DXGI_FORMAT_R16_UNORM)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (isNv12 && ((width & 1) != 0 || (height & 1) != 0))
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (arraySize < 1 || (isNv12 && arraySize > 1))
+    {
+        IFR(E_INVALIDARG);
+    }
+
     sharedTexture = nullptr;
 
     HANDLE deviceHandle;
@@ -50,16 +70,40 @@ HRESULT SharedTexture::Create(
     // since the device is locked, unlock before we exit function
     HRESULT hr = S_OK;
 
-    auto textureDesc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, width, height);
-    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+    // fences need 11.4 on both devices, otherwise use the keyed mutex
+    auto unityDevice5 = d3dDevice.try_as<ID3D11Device5>();
+    auto mediaDevice5 = mediaDevice.try_as<ID3D11Device5>();
+    if (syncMode == TextureSyncMode::Fence && (unityDevice5 == nullptr || mediaDevice5 == nullptr))
+    {
+        syncMode = TextureSyncMode::KeyedMutex;
+    }
+
+    // a resolution change back and forth doesn't allocate again
+    TEXTURE_POOL_KEY poolKey{ d3dDevice.get(), mediaDevice.get(), width, height, format, arraySize, static_cast<uint32_t>(syncMode) };
+    uint64_t poolBytes = GetTextureBytes(format, width, height, arraySize);
+
+    auto& pool = SharedTexturePool::Instance();
+
+    sharedTexture = pool.Acquire(poolKey, poolBytes);
+    if (sharedTexture != nullptr)
+    {
+        dxgiDeviceManager->UnlockDevice(deviceHandle, FALSE);
+
+        return S_OK;
+    }
+
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(format, width, height, arraySize);
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (isNv12 ? 0 : D3D11_BIND_RENDER_TARGET);
     textureDesc.MipLevels = 1;
-    textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+    textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+    textureDesc.MiscFlags |= (syncMode == TextureSyncMode::KeyedMutex) ? D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX : D3D11_RESOURCE_MISC_SHARED;
     textureDesc.Usage = D3D11_USAGE_DEFAULT;
 
     // create a texture
     com_ptr<ID3D11Texture2D> spTexture = nullptr;
     D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
     com_ptr<ID3D11ShaderResourceView> spSRV = nullptr;
+    com_ptr<ID3D11ShaderResourceView> spChromaSRV = nullptr;
     com_ptr<IDXGIResource1> spDXGIResource = nullptr;
     com_ptr<ID3D11Texture2D> spMediaTexture = nullptr;
     HANDLE sharedHandle = INVALID_HANDLE_VALUE;
@@ -68,11 +112,29 @@ HRESULT SharedTexture::Create(
     com_ptr<IMFMediaBuffer> dxgiMediaBuffer = nullptr;
     com_ptr<IMFSample> mediaSample = nullptr;
 
+    com_ptr<IDXGIKeyedMutex> spFrameKeyedMutex = nullptr;
+    com_ptr<IDXGIKeyedMutex> spMediaKeyedMutex = nullptr;
+    HANDLE sharedFenceHandle = INVALID_HANDLE_VALUE;
+    com_ptr<ID3D11Fence> spMediaFence = nullptr;
+    com_ptr<ID3D11Fence> spFrameFence = nullptr;
+
     IFG(d3dDevice->CreateTexture2D(&textureDesc, nullptr, spTexture.put()), done);
 
     // srv for the texture
-    srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.get(), D3D11_SRV_DIMENSION_TEXTURE2D);
-    IFG(d3dDevice->CreateShaderResourceView(spTexture.get(), &srvDesc, spSRV.put()), done);
+    if (isNv12)
+    {
+        // R8 views the full size luma plane, R8G8 the half size interleaved chroma plane
+        srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8_UNORM);
+        IFG(d3dDevice->CreateShaderResourceView(spTexture.get(), &srvDesc, spSRV.put()), done);
+
+        srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8_UNORM);
+        IFG(d3dDevice->CreateShaderResourceView(spTexture.get(), &srvDesc, spChromaSRV.put()), done);
+    }
+    else
+    {
+        srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.get(), arraySize > 1 ? D3D11_SRV_DIMENSION_TEXTURE2DARRAY : D3D11_SRV_DIMENSION_TEXTURE2D);
+        IFG(d3dDevice->CreateShaderResourceView(spTexture.get(), &srvDesc, spSRV.put()), done);
+    }
 
     IFG(spTexture->QueryInterface(__uuidof(IDXGIResource1), spDXGIResource.put_void()), done);
 
@@ -85,6 +147,19 @@ HRESULT SharedTexture::Create(
 
     IFG(mediaDevice->OpenSharedResource1(sharedHandle, __uuidof(ID3D11Texture2D), spMediaTexture.put_void()), done);
 
+    if (syncMode == TextureSyncMode::KeyedMutex)
+    {
+        IFG(spTexture->QueryInterface(__uuidof(IDXGIKeyedMutex), spFrameKeyedMutex.put_void()), done);
+        IFG(spMediaTexture->QueryInterface(__uuidof(IDXGIKeyedMutex), spMediaKeyedMutex.put_void()), done);
+    }
+    else if (syncMode == TextureSyncMode::Fence)
+    {
+        // signaled by the media device, waited on by the unity device
+        IFG(mediaDevice5->CreateFence(0, D3D11_FENCE_FLAG_SHARED, __uuidof(ID3D11Fence), spMediaFence.put_void()), done);
+        IFG(spMediaFence->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, &sharedFenceHandle), done);
+        IFG(unityDevice5->OpenSharedFence(sharedFenceHandle, __uuidof(ID3D11Fence), spFrameFence.put_void()), done);
+    }
+
     IFG(GetSurfaceFromTexture(spMediaTexture.get(), mediaSurface), done);
 
     // create a media buffer for the texture
@@ -99,11 +174,23 @@ HRESULT SharedTexture::Create(
     sharedTexture->frameTextureDesc = textureDesc;
     sharedTexture->frameTexture.attach(spTexture.detach());
     sharedTexture->frameTextureSRV.attach(spSRV.detach());
+    sharedTexture->frameChromaSRV.attach(spChromaSRV.detach());
     sharedTexture->sharedTextureHandle = sharedHandle;
     sharedTexture->mediaTexture.attach(spMediaTexture.detach());
     sharedTexture->mediaSurface = mediaSurface;
     sharedTexture->mediaBuffer.attach(dxgiMediaBuffer.detach());
     sharedTexture->mediaSample.attach(mediaSample.detach());
+    sharedTexture->syncMode = syncMode;
+    sharedTexture->frameKeyedMutex.attach(spFrameKeyedMutex.detach());
+    sharedTexture->mediaKeyedMutex.attach(spMediaKeyedMutex.detach());
+    sharedTexture->sharedFenceHandle = sharedFenceHandle;
+    sharedTexture->frameFence.attach(spFrameFence.detach());
+    sharedTexture->mediaFence.attach(spMediaFence.detach());
+    sharedTexture->poolKey = poolKey;
+    sharedTexture->poolBytes = poolBytes;
+    sharedTexture->poolGeneration = pool.Generation();
+
+    pool.OnAllocated(poolBytes);
 
 done:
     if (FAILED(hr))
@@ -112,6 +199,11 @@ done:
         {
             CloseHandle(sharedHandle);
         }
+
+        if (sharedFenceHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(sharedFenceHandle);
+        }
     }
 
     dxgiDeviceManager->UnlockDevice(deviceHandle, FALSE);
@@ -123,11 +215,22 @@ SharedTexture::SharedTexture()
     : frameTextureDesc{}
     , frameTexture(nullptr)
     , frameTextureSRV(nullptr)
+    , frameChromaSRV(nullptr)
     , sharedTextureHandle(INVALID_HANDLE_VALUE)
     , mediaTexture(nullptr)
     , mediaSurface(nullptr)
     , mediaBuffer(nullptr)
     , mediaSample(nullptr)
+    , syncMode(TextureSyncMode::None)
+    , frameKeyedMutex(nullptr)
+    , mediaKeyedMutex(nullptr)
+    , sharedFenceHandle(INVALID_HANDLE_VALUE)
+    , frameFence(nullptr)
+    , mediaFence(nullptr)
+    , fenceValue(0)
+    , poolKey{}
+    , poolBytes(0)
+    , poolGeneration(0)
 {}
 
 SharedTexture::~SharedTexture()
@@ -135,8 +238,24 @@ SharedTexture::~SharedTexture()
     Reset();
 }
 
+_Use_decl_annotations_
+void SharedTexture::Recycle(
+    com_ptr<SharedTexture>& sharedTexture)
+{
+    SharedTexturePool::Instance().Recycle(std::move(sharedTexture));
+
+    sharedTexture = nullptr;
+}
+
 void SharedTexture::Reset()
 {
+    if (poolBytes != 0)
+    {
+        SharedTexturePool::Instance().OnReleased(poolBytes);
+
+        poolBytes = 0;
+    }
+
     // primary texture
     if (sharedTextureHandle != INVALID_HANDLE_VALUE)
     {
@@ -146,13 +265,128 @@ void SharedTexture::Reset()
         }
     }
 
+    if (sharedFenceHandle != INVALID_HANDLE_VALUE)
+    {
+        if (CloseHandle(sharedFenceHandle))
+        {
+            sharedFenceHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    frameFence = nullptr;
+    mediaFence = nullptr;
+    frameKeyedMutex = nullptr;
+    mediaKeyedMutex = nullptr;
+    fenceValue = 0;
+    syncMode = TextureSyncMode::None;
+
     mediaSample = nullptr;
     mediaBuffer = nullptr;
     mediaSurface = nullptr;
     mediaTexture = nullptr;
+    frameChromaSRV = nullptr;
     frameTextureSRV = nullptr;
     frameTexture = nullptr;
 
     ZeroMemory(&frameTextureDesc, sizeof(CD3D11_TEXTURE2D_DESC));
 }
 
+// both sides use the same key, the keyed mutex only hands over ownership,
+// the ring decides which side gets the texture next
+static const UINT64 c_sharedTextureKey = 0;
+
+_Use_decl_annotations_
+HRESULT SharedTexture::BeginMediaWrite(
+    DWORD timeoutMs)
+{
+    if (syncMode != TextureSyncMode::KeyedMutex)
+    {
+        return S_OK;
+    }
+
+    NULL_CHK_HR(mediaKeyedMutex, MF_E_NOT_INITIALIZED);
+
+    HRESULT hr = mediaKeyedMutex->AcquireSync(c_sharedTextureKey, timeoutMs);
+    if (hr == static_cast<HRESULT>(WAIT_TIMEOUT) || hr == static_cast<HRESULT>(WAIT_ABANDONED))
+    {
+        IFR(HRESULT_FROM_WIN32(hr));
+    }
+
+    IFR(hr);
+
+    return S_OK;
+}
+
+HRESULT SharedTexture::EndMediaWrite()
+{
+    if (syncMode == TextureSyncMode::KeyedMutex)
+    {
+        NULL_CHK_HR(mediaKeyedMutex, MF_E_NOT_INITIALIZED);
+
+        IFR(mediaKeyedMutex->ReleaseSync(c_sharedTextureKey));
+    }
+    else if (syncMode == TextureSyncMode::Fence)
+    {
+        NULL_CHK_HR(mediaFence, MF_E_NOT_INITIALIZED);
+
+        com_ptr<ID3D11Device> device = nullptr;
+        mediaTexture->GetDevice(device.put());
+
+        com_ptr<ID3D11DeviceContext> context = nullptr;
+        device->GetImmediateContext(context.put());
+
+        auto context4 = context.as<ID3D11DeviceContext4>();
+        IFR(context4->Signal(mediaFence.get(), ++fenceValue));
+
+        // submit the copy and signal, does not wait on the gpu
+        context4->Flush();
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SharedTexture::BeginFrameRead(
+    DWORD timeoutMs)
+{
+    if (syncMode == TextureSyncMode::KeyedMutex)
+    {
+        NULL_CHK_HR(frameKeyedMutex, MF_E_NOT_INITIALIZED);
+
+        HRESULT hr = frameKeyedMutex->AcquireSync(c_sharedTextureKey, timeoutMs);
+        if (hr == static_cast<HRESULT>(WAIT_TIMEOUT) || hr == static_cast<HRESULT>(WAIT_ABANDONED))
+        {
+            IFR(HRESULT_FROM_WIN32(hr));
+        }
+
+        IFR(hr);
+    }
+    else if (syncMode == TextureSyncMode::Fence)
+    {
+        NULL_CHK_HR(frameFence, MF_E_NOT_INITIALIZED);
+
+        com_ptr<ID3D11Device> device = nullptr;
+        frameTexture->GetDevice(device.put());
+
+        com_ptr<ID3D11DeviceContext> context = nullptr;
+        device->GetImmediateContext(context.put());
+
+        // gpu side wait, the unity context is not blocked on the cpu
+        auto context4 = context.as<ID3D11DeviceContext4>();
+        IFR(context4->Wait(frameFence.get(), fenceValue));
+    }
+
+    return S_OK;
+}
+
+HRESULT SharedTexture::EndFrameRead()
+{
+    if (syncMode != TextureSyncMode::KeyedMutex)
+    {
+        return S_OK;
+    }
+
+    NULL_CHK_HR(frameKeyedMutex, MF_E_NOT_INITIALIZED);
+
+    return frameKeyedMutex->ReleaseSync(c_sharedTextureKey);
+}
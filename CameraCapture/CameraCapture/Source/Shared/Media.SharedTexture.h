@@ -3,11 +3,19 @@
 
 #pragma once
 
-#include <d3d11_1.h>
+#include "TexturePool.h"
+
+#include <d3d11_4.h>
 #include <mfapi.h>
+#include <atomic>
 #include <winrt/windows.foundation.numerics.h>
 #include <winrt/windows.graphics.directx.direct3d11.h>
 
+// how long either device waits for the other to hand over the texture, neither does,
+// a texture the other side still owns is skipped and the ring moves on
+#define SHARED_TEXTURE_SYNC_TIMEOUT_MS 0
+
+// a pooled texture of the same shape on the same devices is handed out before a new one is made
 struct SharedTexture : winrt::implements<SharedTexture, winrt::Windows::Foundation::IInspectable>
 {
     static HRESULT Create(
@@ -15,20 +23,53 @@ struct SharedTexture : winrt::implements<SharedTexture, winrt::Windows::Foundati
         _In_ winrt::com_ptr<IMFDXGIDeviceManager> const dxgiDeviceManager,
         _In_ uint32_t width,
         _In_ uint32_t height,
-        _Out_ winrt::com_ptr<SharedTexture>& sharedTexture);
+        _In_ DXGI_FORMAT format,
+        _In_ TextureSyncMode syncMode,
+        _Out_ winrt::com_ptr<SharedTexture>& sharedTexture,
+        _In_ uint32_t arraySize = 1);   // bgra and r16 only, the media sample wraps slice 0
+
+    // back to the pool instead of released, neither device may still be using it
+    static void Recycle(
+        _Inout_ winrt::com_ptr<SharedTexture>& sharedTexture);
 
     SharedTexture();
     virtual ~SharedTexture();
 
     void Reset();
 
+    // media device side, brackets writes into mediaTexture
+    HRESULT BeginMediaWrite(_In_ DWORD timeoutMs);
+    HRESULT EndMediaWrite();
+
+    // unity device side, brackets reads from frameTexture
+    HRESULT BeginFrameRead(_In_ DWORD timeoutMs);
+    HRESULT EndFrameRead();
+
 public:
     CD3D11_TEXTURE2D_DESC frameTextureDesc;
     winrt::com_ptr<ID3D11Texture2D> frameTexture;
-    winrt::com_ptr<ID3D11ShaderResourceView> frameTextureSRV;
+    winrt::com_ptr<ID3D11ShaderResourceView> frameTextureSRV;  // luma plane for nv12
+    winrt::com_ptr<ID3D11ShaderResourceView> frameChromaSRV;   // nv12 only
     HANDLE sharedTextureHandle;
     winrt::com_ptr<ID3D11Texture2D> mediaTexture;
     winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface mediaSurface;
     winrt::com_ptr<IMFMediaBuffer> mediaBuffer;
     winrt::com_ptr<IMFSample> mediaSample;
+
+    // cross device synchronization
+    TextureSyncMode syncMode;
+    winrt::com_ptr<IDXGIKeyedMutex> frameKeyedMutex;
+    winrt::com_ptr<IDXGIKeyedMutex> mediaKeyedMutex;
+    HANDLE sharedFenceHandle;
+    winrt::com_ptr<ID3D11Fence> frameFence;
+    winrt::com_ptr<ID3D11Fence> mediaFence;
+    std::atomic<uint64_t> fenceValue;
+
+    // set by Create, a texture that was Reset isn't taken back
+    TEXTURE_POOL_KEY poolKey;
+    uint64_t poolBytes;
+    uint32_t poolGeneration;
 };
+
+// one for every engine in the process
+typedef TexturePool<winrt::com_ptr<SharedTexture>> SharedTexturePool;
@@ -0,0 +1,265 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.SharedTextureRing.h"
+
+#include <Mferror.h>
+
+using namespace winrt;
+
+_Use_decl_annotations_
+HRESULT SharedTextureRing::Create(
+    com_ptr<ID3D11Device> const d3dDevice,
+    com_ptr<IMFDXGIDeviceManager> const dxgiDeviceManager,
+    uint32_t width, uint32_t height,
+    uint32_t count,
+    DXGI_FORMAT format,
+    TextureSyncMode syncMode,
+    com_ptr<SharedTextureRing>& textureRing)
+{
+    if (count < 1 || count > MAX_SHARED_TEXTURES)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    textureRing = nullptr;
+
+    auto ring = make<SharedTextureRing>().as<SharedTextureRing>();
+    ring->m_slots.resize(count);
+
+    for (auto& slot : ring->m_slots)
+    {
+        IFR(SharedTexture::Create(d3dDevice, dxgiDeviceManager, width, height, format, syncMode, slot.texture));
+
+        slot.state = SlotState::Free;
+        slot.sequence = 0;
+        slot.acquiredTicks = 0;
+    }
+
+    ring->m_width = width;
+    ring->m_height = height;
+    ring->m_format = format;
+    ring->m_syncMode = syncMode;
+
+    textureRing = ring;
+
+    return S_OK;
+}
+
+SharedTextureRing::SharedTextureRing()
+    : m_width(0)
+    , m_height(0)
+    , m_format(DXGI_FORMAT_UNKNOWN)
+    , m_syncMode(TextureSyncMode::None)
+    , m_sequence(0)
+{}
+
+SharedTextureRing::~SharedTextureRing()
+{
+    Reset();
+}
+
+_Use_decl_annotations_
+HRESULT SharedTextureRing::AcquireWrite(
+    uint32_t* index,
+    com_ptr<SharedTexture>& sharedTexture)
+{
+    NULL_CHK_HR(index, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    if (m_slots.empty())
+    {
+        IFR(MF_E_NOT_INITIALIZED);
+    }
+
+    // a single slot is always overwritten, matches the behavior without a ring
+    uint32_t found = m_slots.size() == 1 ? 0 : UINT32_MAX;
+
+    // prefer a free slot, otherwise recycle the oldest frame nobody has taken
+    for (uint32_t i = 0; found == UINT32_MAX && i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].state == SlotState::Free)
+        {
+            found = i;
+        }
+    }
+
+    for (uint32_t i = 0; found == UINT32_MAX && i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].state == SlotState::Ready)
+        {
+            found = i;
+        }
+    }
+
+    // every slot is held, a consumer that stopped releasing gives up its oldest one
+    // rather than stalling the preview for good
+    ULONGLONG nowTicks = GetTickCount64();
+    uint32_t stale = UINT32_MAX;
+    for (uint32_t i = 0; found == UINT32_MAX && i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].state == SlotState::Acquired
+            &&
+            nowTicks - m_slots[i].acquiredTicks >= SHARED_TEXTURE_RELEASE_TIMEOUT_MS
+            &&
+            (stale == UINT32_MAX || m_slots[i].sequence < m_slots[stale].sequence))
+        {
+            stale = i;
+        }
+    }
+
+    if (found == UINT32_MAX)
+    {
+        found = stale;
+    }
+
+    if (found == UINT32_MAX)
+    {
+        IFR(MF_E_SAMPLEALLOCATOR_EMPTY);
+    }
+
+    m_slots[found].state = SlotState::Writing;
+
+    *index = found;
+    sharedTexture = m_slots[found].texture;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SharedTextureRing::Publish(
+    uint32_t index)
+{
+    auto guard = m_cs.Guard();
+
+    if (index >= m_slots.size())
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (m_slots[index].state != SlotState::Writing)
+    {
+        IFR(MF_E_INVALIDREQUEST);
+    }
+
+    // only the newest frame can still be handed out
+    for (auto& slot : m_slots)
+    {
+        if (slot.state == SlotState::Ready)
+        {
+            slot.state = SlotState::Free;
+        }
+    }
+
+    m_slots[index].state = SlotState::Ready;
+    m_slots[index].sequence = ++m_sequence;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SharedTextureRing::Discard(
+    uint32_t index)
+{
+    auto guard = m_cs.Guard();
+
+    if (index >= m_slots.size())
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (m_slots[index].state == SlotState::Writing)
+    {
+        m_slots[index].state = SlotState::Free;
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SharedTextureRing::AcquireLatest(
+    uint32_t* index,
+    com_ptr<SharedTexture>& sharedTexture)
+{
+    NULL_CHK_HR(index, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    uint32_t found = UINT32_MAX;
+    for (uint32_t i = 0; i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].state == SlotState::Ready
+            &&
+            (found == UINT32_MAX || m_slots[i].sequence > m_slots[found].sequence))
+        {
+            found = i;
+        }
+    }
+
+    if (found == UINT32_MAX)
+    {
+        IFR(MF_E_SAMPLEALLOCATOR_EMPTY);
+    }
+
+    m_slots[found].state = SlotState::Acquired;
+    m_slots[found].acquiredTicks = GetTickCount64();
+
+    *index = found;
+    sharedTexture = m_slots[found].texture;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SharedTextureRing::Release(
+    uint32_t index)
+{
+    auto guard = m_cs.Guard();
+
+    if (index >= m_slots.size())
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (m_slots[index].state == SlotState::Acquired)
+    {
+        m_slots[index].state = SlotState::Free;
+    }
+
+    return S_OK;
+}
+
+void SharedTextureRing::Reset()
+{
+    auto guard = m_cs.Guard();
+
+    // the consumer may still be reading a slot it holds, only the others go back to the pool
+    for (auto& slot : m_slots)
+    {
+        if (slot.texture == nullptr)
+        {
+            continue;
+        }
+
+        if (slot.state == SlotState::Free || slot.state == SlotState::Ready)
+        {
+            SharedTexture::Recycle(slot.texture);
+        }
+        else
+        {
+            slot.texture->Reset();
+
+            slot.texture = nullptr;
+        }
+    }
+    m_slots.clear();
+
+    m_width = 0;
+    m_height = 0;
+    m_format = DXGI_FORMAT_UNKNOWN;
+    m_syncMode = TextureSyncMode::None;
+    m_sequence = 0;
+}
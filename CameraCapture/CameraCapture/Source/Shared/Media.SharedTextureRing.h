@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.SharedTexture.h"
+
+#include <vector>
+
+#define MAX_SHARED_TEXTURES 8
+
+// a slot the consumer holds longer than this is taken back once the ring runs dry
+#define SHARED_TEXTURE_RELEASE_TIMEOUT_MS 1000
+
+// N-deep ring of shared textures, the media pipeline writes into one slot while
+// the consumer holds another. A slot handed to the consumer stays untouched
+// until it is released, if every slot is held the producer drops the frame,
+// a consumer that never releases loses its oldest slot after the timeout.
+// the textures come from and go back to the SharedTexturePool
+struct SharedTextureRing : winrt::implements<SharedTextureRing, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ winrt::com_ptr<ID3D11Device> const d3dDevice,
+        _In_ winrt::com_ptr<IMFDXGIDeviceManager> const dxgiDeviceManager,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ uint32_t count,
+        _In_ DXGI_FORMAT format,
+        _In_ TextureSyncMode syncMode,
+        _Out_ winrt::com_ptr<SharedTextureRing>& textureRing);
+
+    SharedTextureRing();
+    virtual ~SharedTextureRing();
+
+    // producer
+    HRESULT AcquireWrite(
+        _Out_ uint32_t* index,
+        _Out_ winrt::com_ptr<SharedTexture>& sharedTexture);
+    HRESULT Publish(
+        _In_ uint32_t index);
+    HRESULT Discard(
+        _In_ uint32_t index);
+
+    // consumer
+    HRESULT AcquireLatest(
+        _Out_ uint32_t* index,
+        _Out_ winrt::com_ptr<SharedTexture>& sharedTexture);
+    HRESULT Release(
+        _In_ uint32_t index);
+
+    uint32_t Count() const { return static_cast<uint32_t>(m_slots.size()); }
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    DXGI_FORMAT Format() const { return m_format; }
+    TextureSyncMode SyncMode() const { return m_syncMode; }
+
+    void Reset();
+
+private:
+    enum class SlotState
+    {
+        Free = 0,
+        Writing,
+        Ready,
+        Acquired
+    };
+
+    struct Slot
+    {
+        SlotState state;
+        uint64_t sequence;
+        ULONGLONG acquiredTicks;
+        winrt::com_ptr<SharedTexture> texture;
+    };
+
+    CriticalSection m_cs;
+
+    uint32_t m_width;
+    uint32_t m_height;
+    DXGI_FORMAT m_format;
+    TextureSyncMode m_syncMode;
+    uint64_t m_sequence;
+    std::vector<Slot> m_slots;
+};
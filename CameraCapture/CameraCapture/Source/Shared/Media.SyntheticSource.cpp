@@ -0,0 +1,315 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.SyntheticSource.h"
+
+#include <mferror.h>
+#include <winrt/Windows.Foundation.Numerics.h>
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation::Numerics;
+
+#if !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+EXTERN_GUID(MFSampleExtension_DeviceTimestamp, 0x8f3e35e7, 0x2dcd, 0x4887, 0x86, 0x22, 0x2a, 0x58, 0xba, 0xa6, 0x52, 0xb0);
+EXTERN_GUID(MFSampleExtension_Spatial_CameraViewTransform, 0x4e251fa4, 0x830f, 0x4770, 0x85, 0x9a, 0x4b, 0x8d, 0x99, 0xaa, 0x80, 0x9b);
+EXTERN_GUID(MFSampleExtension_Spatial_CameraProjectionTransform, 0x47f9fcb5, 0x2a02, 0x4f26, 0xa4, 0x77, 0x79, 0x2f, 0xdf, 0x95, 0x88, 0x6a);
+#endif
+
+// roughly a hololens photo/video camera
+#define SYNTHETIC_SOURCE_FIELD_OF_VIEW 1.1f
+
+_Use_decl_annotations_
+HRESULT SyntheticSource::Create(
+    ID3D11Device* mediaDevice,
+    uint32_t width,
+    uint32_t height,
+    DXGI_FORMAT format,
+    uint32_t frameRate,
+    uint32_t jitterMs,
+    com_ptr<SyntheticSource>& source)
+{
+    source = nullptr;
+
+    NULL_CHK_HR(mediaDevice, E_INVALIDARG);
+
+    if (format != DXGI_FORMAT_NV12 && format != DXGI_FORMAT_B8G8R8A8_UNORM)
+    {
+        IFR(MF_E_INVALIDMEDIATYPE);
+    }
+
+    // nv12 planes need even dimensions
+    if (width < 2 || height < 2 || frameRate < 1
+        || (format == DXGI_FORMAT_NV12 && ((width & 1) != 0 || (height & 1) != 0)))
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto syntheticSource = make_self<SyntheticSource>();
+    syntheticSource->m_width = width;
+    syntheticSource->m_height = height;
+    syntheticSource->m_format = format;
+    syntheticSource->m_frameDuration = 10000000ll / frameRate;
+    syntheticSource->m_jitterMs = jitterMs;
+
+    // shared like the camera's, so the zero copy path is covered too
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(format, width, height, 1, 1, D3D11_BIND_SHADER_RESOURCE);
+    textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+
+    bool isNv12 = format == DXGI_FORMAT_NV12;
+    uint32_t pitch = isNv12 ? width : width * 4;
+    std::vector<uint8_t> pixels(isNv12 ? width * height * 3 / 2 : pitch * height);
+
+    for (uint32_t i = 0; i < SYNTHETIC_SOURCE_BUFFERS; ++i)
+    {
+        // a diagonal ramp shifted per buffer, a frame can be told apart by its first pixel
+        uint8_t shift = static_cast<uint8_t>(i * 256 / SYNTHETIC_SOURCE_BUFFERS);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint8_t value = static_cast<uint8_t>(x + y + shift);
+                if (isNv12)
+                {
+                    pixels[y * pitch + x] = value;
+                }
+                else
+                {
+                    uint8_t* pixel = &pixels[y * pitch + x * 4];
+                    pixel[0] = value;
+                    pixel[1] = static_cast<uint8_t>(y);
+                    pixel[2] = shift;
+                    pixel[3] = 0xff;
+                }
+            }
+        }
+
+        // neutral chroma
+        if (isNv12)
+        {
+            memset(&pixels[width * height], 0x80, width * height / 2);
+        }
+
+        D3D11_SUBRESOURCE_DATA initialData{ pixels.data(), pitch, 0 };
+
+        com_ptr<ID3D11Texture2D> texture = nullptr;
+        IFR(mediaDevice->CreateTexture2D(&textureDesc, &initialData, texture.put()));
+
+        com_ptr<IMFMediaBuffer> buffer = nullptr;
+        IFR(MFCreateDXGISurfaceBuffer(__uuidof(ID3D11Texture2D), texture.get(), 0, FALSE, buffer.put()));
+
+        DWORD length = 0;
+        IFR(buffer.as<IMF2DBuffer>()->GetContiguousLength(&length));
+        IFR(buffer->SetCurrentLength(length));
+
+        syntheticSource->m_textures.push_back(texture);
+        syntheticSource->m_buffers.push_back(buffer);
+    }
+
+    source = syntheticSource;
+
+    return S_OK;
+}
+
+SyntheticSource::SyntheticSource()
+    : m_width(0)
+    , m_height(0)
+    , m_format(DXGI_FORMAT_UNKNOWN)
+    , m_frameDuration(0)
+    , m_jitterMs(0)
+    , m_textures()
+    , m_buffers()
+    , m_streamSink(nullptr)
+    , m_running(false)
+    , m_workItemKey(0)
+    , m_workItemScheduled(false)
+    , m_qpcFrequency(0)
+    , m_startQpc(0)
+    , m_frameIndex(0)
+    , m_random(SYNTHETIC_SOURCE_SEED)
+{
+    IFT(MFStartup(MF_VERSION));
+
+    LARGE_INTEGER frequency{};
+    QueryPerformanceFrequency(&frequency);
+
+    m_qpcFrequency = frequency.QuadPart;
+}
+
+SyntheticSource::~SyntheticSource()
+{
+    Stop();
+
+    m_buffers.clear();
+    m_textures.clear();
+
+    MFShutdown();
+}
+
+_Use_decl_annotations_
+HRESULT SyntheticSource::Start(
+    com_ptr<IMFStreamSink> const& streamSink)
+{
+    NULL_CHK_HR(streamSink, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    if (m_running)
+    {
+        IFR(MF_E_INVALIDREQUEST);
+    }
+
+    m_streamSink = streamSink;
+    m_running = true;
+    m_frameIndex = 0;
+    m_random.seed(SYNTHETIC_SOURCE_SEED);
+
+    LARGE_INTEGER counter{};
+    QueryPerformanceCounter(&counter);
+
+    m_startQpc = counter.QuadPart;
+
+    HRESULT hr = ScheduleFrame();
+    if (FAILED(hr))
+    {
+        m_running = false;
+        m_streamSink = nullptr;
+    }
+
+    return hr;
+}
+
+// a frame already in Invoke still reaches the sink, the sink drops it once it's shut down
+void SyntheticSource::Stop()
+{
+    auto guard = m_cs.Guard();
+
+    m_running = false;
+
+    if (m_workItemScheduled)
+    {
+        MFCancelWorkItem(m_workItemKey);
+
+        m_workItemScheduled = false;
+    }
+
+    m_streamSink = nullptr;
+}
+
+// IMFAsyncCallback
+_Use_decl_annotations_
+HRESULT SyntheticSource::GetParameters(
+    DWORD* pdwFlags,
+    DWORD* pdwQueue)
+{
+    // off the timer thread, delivery runs the whole sink
+    *pdwFlags = 0;
+    *pdwQueue = MFASYNC_CALLBACK_QUEUE_MULTITHREADED;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SyntheticSource::Invoke(
+    IMFAsyncResult* pAsyncResult)
+{
+    UNREFERENCED_PARAMETER(pAsyncResult);
+
+    LARGE_INTEGER counter{};
+    QueryPerformanceCounter(&counter);
+
+    com_ptr<IMFStreamSink> streamSink = nullptr;
+    com_ptr<IMFSample> sample = nullptr;
+    {
+        auto guard = m_cs.Guard();
+
+        m_workItemScheduled = false;
+
+        if (!m_running)
+        {
+            return S_OK;
+        }
+
+        // the capture time, what a camera driver stamps on its samples
+        if (SUCCEEDED(CreateSample(counter.QuadPart, sample)))
+        {
+            streamSink = m_streamSink;
+        }
+
+        ++m_frameIndex;
+
+        ScheduleFrame();
+    }
+
+    // the sink drops it with MF_E_NOTACCEPTING when it has no request outstanding, like a camera
+    if (streamSink != nullptr)
+    {
+        streamSink->ProcessSample(sample.get());
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SyntheticSource::CreateSample(
+    LONGLONG deviceTime,
+    com_ptr<IMFSample>& sample)
+{
+    sample = nullptr;
+
+    com_ptr<IMFSample> frameSample = nullptr;
+    IFR(MFCreateSample(frameSample.put()));
+    IFR(frameSample->AddBuffer(m_buffers[m_frameIndex % m_buffers.size()].get()));
+
+    IFR(frameSample->SetSampleTime(static_cast<LONGLONG>(m_frameIndex) * m_frameDuration));
+    IFR(frameSample->SetSampleDuration(m_frameDuration));
+    IFR(frameSample->SetUINT32(MFSampleExtension_CleanPoint, TRUE));
+
+    // qpc in 100ns units, split so the multiply can't overflow
+    LONGLONG seconds = deviceTime / m_qpcFrequency;
+    LONGLONG remainder = deviceTime % m_qpcFrequency;
+    LONGLONG deviceTimeHns = seconds * 10000000ll + remainder * 10000000ll / m_qpcFrequency;
+    IFR(frameSample->SetUINT64(MFSampleExtension_DeviceTimestamp, static_cast<UINT64>(deviceTimeHns)));
+
+    // a camera at the origin looking down -z, enough for the transform stage to run
+    auto view = float4x4::identity();
+    auto projection = make_float4x4_perspective_field_of_view(
+        SYNTHETIC_SOURCE_FIELD_OF_VIEW, static_cast<float>(m_width) / static_cast<float>(m_height), 0.1f, 100.0f);
+    IFR(frameSample->SetBlob(MFSampleExtension_Spatial_CameraViewTransform, reinterpret_cast<UINT8 const*>(&view), sizeof(view)));
+    IFR(frameSample->SetBlob(MFSampleExtension_Spatial_CameraProjectionTransform, reinterpret_cast<UINT8 const*>(&projection), sizeof(projection)));
+
+    sample = frameSample;
+
+    return S_OK;
+}
+
+// deadlines are absolute, late frames and timer slack don't add up into a slower rate
+HRESULT SyntheticSource::ScheduleFrame()
+{
+    LONGLONG frameTicks = m_frameDuration * m_qpcFrequency / 10000000ll;
+    LONGLONG targetQpc = m_startQpc + static_cast<LONGLONG>(m_frameIndex) * frameTicks;
+
+    if (m_jitterMs > 0)
+    {
+        std::uniform_int_distribution<int32_t> jitter(-static_cast<int32_t>(m_jitterMs), static_cast<int32_t>(m_jitterMs));
+
+        targetQpc += static_cast<LONGLONG>(jitter(m_random)) * m_qpcFrequency / 1000;
+    }
+
+    LARGE_INTEGER counter{};
+    QueryPerformanceCounter(&counter);
+
+    // behind, the next frame goes out on the next timer tick
+    LONGLONG delayMs = (targetQpc - counter.QuadPart) * 1000 / m_qpcFrequency;
+    if (delayMs < 1)
+    {
+        delayMs = 1;
+    }
+
+    IFR(MFScheduleWorkItem(this, nullptr, -delayMs, &m_workItemKey));
+
+    m_workItemScheduled = true;
+
+    return S_OK;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <mfapi.h>
+#include <mfidl.h>
+
+#include <random>
+#include <vector>
+
+// textures the frames cycle through, like a sensor's buffer pool
+#define SYNTHETIC_SOURCE_BUFFERS 4
+
+// the jitter is the same from run to run
+#define SYNTHETIC_SOURCE_SEED 0x5eed
+
+// stands in for the camera when load testing, dxgi backed nv12 or bgra frames with a fixed
+// pattern, a device timestamp and fake spatial transforms are pushed into a stream sink at
+// the frame rate, each frame's deadline moves by up to the jitter, thread safe
+struct SyntheticSource : winrt::implements<SyntheticSource, IMFAsyncCallback>
+{
+    static HRESULT Create(
+        _In_ ID3D11Device* mediaDevice,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ DXGI_FORMAT format,
+        _In_ uint32_t frameRate,
+        _In_ uint32_t jitterMs,
+        _Out_ winrt::com_ptr<SyntheticSource>& source);
+
+    SyntheticSource();
+    virtual ~SyntheticSource();
+
+    // the stream sink has to be started, frame times count from 0
+    HRESULT Start(
+        _In_ winrt::com_ptr<IMFStreamSink> const& streamSink);
+    void Stop();
+
+    // IMFAsyncCallback
+    STDOVERRIDEMETHODIMP GetParameters(
+        _Out_ DWORD* pdwFlags,
+        _Out_ DWORD* pdwQueue);
+    STDOVERRIDEMETHODIMP Invoke(
+        _In_ IMFAsyncResult* pAsyncResult);
+
+private:
+    HRESULT CreateSample(
+        _In_ LONGLONG deviceTime,
+        _Out_ winrt::com_ptr<IMFSample>& sample);
+
+    // called with the lock held
+    HRESULT ScheduleFrame();
+
+private:
+    CriticalSection m_cs;
+
+    uint32_t m_width;
+    uint32_t m_height;
+    DXGI_FORMAT m_format;
+    LONGLONG m_frameDuration;       // 100ns units
+    uint32_t m_jitterMs;
+
+    std::vector<winrt::com_ptr<ID3D11Texture2D>> m_textures;
+    std::vector<winrt::com_ptr<IMFMediaBuffer>> m_buffers;
+
+    winrt::com_ptr<IMFStreamSink> m_streamSink;
+    bool m_running;
+    MFWORKITEM_KEY m_workItemKey;
+    bool m_workItemScheduled;
+
+    LONGLONG m_qpcFrequency;
+    LONGLONG m_startQpc;
+    uint64_t m_frameIndex;
+    std::mt19937 m_random;
+};
@@ -4,12 +4,16 @@
 
 #include <Media.Payload.h>
 
+#include "PipelineCache.h"
+
 #include <winrt/windows.perception.spatial.preview.h>
 #include <winrt/windows.foundation.metadata.h>
 
 #include <mfidl.h>
 #include <mferror.h>
 
+#include <DirectXMath.h>
+
 using namespace winrt;
 using namespace CameraCapture::Media::implementation;
 
@@ -27,12 +31,62 @@ EXTERN_GUID(MFSampleExtension_Spatial_CameraViewTransform, 0x4e251fa4, 0x830f, 0
 EXTERN_GUID(MFSampleExtension_Spatial_CameraProjectionTransform, 0x47f9fcb5, 0x2a02, 0x4f26, 0xa4, 0x77, 0x79, 0x2f, 0xdf, 0x95, 0x88, 0x6a);
 #endif
 
+// float4x4 and XMFLOAT4X4 share the row major layout and row vector convention,
+// the per frame math runs in sse/neon registers and is stored once
+static_assert(sizeof(Windows::Foundation::Numerics::float4x4) == sizeof(DirectX::XMFLOAT4X4), "matrix layout mismatch");
+
+static inline DirectX::XMMATRIX XM_CALLCONV LoadMatrix(Windows::Foundation::Numerics::float4x4 const& matrix)
+{
+    return DirectX::XMLoadFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4 const*>(&matrix));
+}
+
+static inline void XM_CALLCONV StoreMatrix(Windows::Foundation::Numerics::float4x4* destination, DirectX::FXMMATRIX matrix)
+{
+    DirectX::XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(destination), matrix);
+}
+
+static inline DirectX::XMMATRIX XM_CALLCONV PoseMatrix(
+    Windows::Foundation::Numerics::quaternion const& orientation,
+    Windows::Foundation::Numerics::float3 const& position)
+{
+    return DirectX::XMMatrixMultiply(
+        DirectX::XMMatrixRotationQuaternion(DirectX::XMVectorSet(orientation.x, orientation.y, orientation.z, orientation.w)),
+        DirectX::XMMatrixTranslation(position.x, position.y, position.z));
+}
+
+// the api surface only changes with the os build, which the pipeline cache is stamped with,
+// so a cold start skips the metadata lookups and every transform after the first skips them too
+static bool IsSpatialGraphInteropPresent()
+{
+    static bool const s_isPresent = []()
+    {
+        auto& pipelineCache = PipelineCache::Instance();
+
+        std::wstring persisted;
+        if (pipelineCache.TryGet(L"SpatialGraphInteropPresent", persisted))
+        {
+            return persisted == L"1";
+        }
+
+        bool isPresent =
+            ApiInformation::IsApiContractPresent(L"Windows.Foundation.UniversalApiContract", 8)
+            &&
+            ApiInformation::IsMethodPresent(L"Windows.Perception.Spatial.Preview.SpatialGraphInteropPreview", L"CreateLocatorForNode");
+
+        pipelineCache.Set(L"SpatialGraphInteropPresent", isPresent ? L"1" : L"0");
+
+        return isPresent;
+    }();
+
+    return s_isPresent;
+}
+
 static inline Windows::Foundation::Numerics::float4x4 GetProjection(MFPinholeCameraIntrinsics const& cameraIntrinsics)
 {
     // Default camera projection, which has
     // scale up 2.0f to x and y for (-1, -1) to (1, 1) viewport 
     // and taking camera affine
-    Windows::Foundation::Numerics::float4x4 const defaultProjection(
+    DirectX::XMMATRIX const defaultProjection(
         2.0f, 0.0f, 0.0f, 0.0f,
         0.0f, -2.0f, 0.0f, 0.0f,
         -1.0f, 1.0f, 1.0f, 1.0f,
@@ -43,22 +97,83 @@ static inline Windows::Foundation::Numerics::float4x4 GetProjection(MFPinholeCam
     float px = cameraIntrinsics.IntrinsicModels[0].CameraModel.PrincipalPoint.x / static_cast<float>(cameraIntrinsics.IntrinsicModels[0].Width);
     float py = cameraIntrinsics.IntrinsicModels[0].CameraModel.PrincipalPoint.y / static_cast<float>(cameraIntrinsics.IntrinsicModels[0].Height);
 
-    Windows::Foundation::Numerics::float4x4 const cameraAffine(
+    DirectX::XMMATRIX const cameraAffine(
         fx, 0.0f, 0.0f, 0.0f,
         0.0f, -fy, 0.0f, 0.0f,
         -px, -py, -1.0f, 0.0f,
         0.0f, 0.0f, 0.0f, 1.0f);
 
-    return cameraAffine * defaultProjection;
+    Windows::Foundation::Numerics::float4x4 projection;
+    StoreMatrix(&projection, DirectX::XMMatrixMultiply(cameraAffine, defaultProjection));
+
+    return projection;
+}
+
+_Use_decl_annotations_
+HRESULT GetCameraIntrinsics(
+    com_ptr<IMFSample> const& sample,
+    uint32_t width,
+    uint32_t height,
+    CAMERA_INTRINSICS& intrinsics)
+{
+    ZeroMemory(&intrinsics, sizeof(CAMERA_INTRINSICS));
+
+    NULL_CHK_HR(sample, E_INVALIDARG);
+
+    // one model per supported resolution, the blob grows past the declared struct
+    UINT32 blobSize = 0;
+    IFR(sample->GetBlobSize(MFSampleExtension_PinholeCameraIntrinsics, &blobSize));
+    if (blobSize < sizeof(MFPinholeCameraIntrinsics))
+    {
+        IFR(MF_E_INVALIDTYPE);
+    }
+
+    std::vector<uint8_t> blob(blobSize);
+    IFR(sample->GetBlob(MFSampleExtension_PinholeCameraIntrinsics, blob.data(), blobSize, &blobSize));
+
+    auto cameraIntrinsics = reinterpret_cast<MFPinholeCameraIntrinsics const*>(blob.data());
+
+    size_t maxModels = 1 + (blobSize - sizeof(MFPinholeCameraIntrinsics)) / sizeof(MFPinholeCameraIntrinsic_IntrinsicModel);
+    size_t modelCount = min(static_cast<size_t>(cameraIntrinsics->IntrinsicModelCount), maxModels);
+    if (modelCount == 0)
+    {
+        IFR(MF_E_INVALIDTYPE);
+    }
+
+    auto model = &cameraIntrinsics->IntrinsicModels[0];
+    for (size_t i = 0; i < modelCount; ++i)
+    {
+        if (cameraIntrinsics->IntrinsicModels[i].Width == width && cameraIntrinsics->IntrinsicModels[i].Height == height)
+        {
+            model = &cameraIntrinsics->IntrinsicModels[i];
+            break;
+        }
+    }
+
+    intrinsics.width = model->Width;
+    intrinsics.height = model->Height;
+    intrinsics.focalLength = { model->CameraModel.FocalLength.x, model->CameraModel.FocalLength.y };
+    intrinsics.principalPoint = { model->CameraModel.PrincipalPoint.x, model->CameraModel.PrincipalPoint.y };
+    intrinsics.radialK1 = model->DistortionModel.Radial_k1;
+    intrinsics.radialK2 = model->DistortionModel.Radial_k2;
+    intrinsics.radialK3 = model->DistortionModel.Radial_k3;
+    intrinsics.tangentialP1 = model->DistortionModel.Tangential_p1;
+    intrinsics.tangentialP2 = model->DistortionModel.Tangential_p2;
+
+    return S_OK;
 }
 
 Transform::Transform()
-    : m_useNewApi(
-        ApiInformation::IsApiContractPresent(L"Windows.Foundation.UniversalApiContract", 8)
-        &&
-        ApiInformation::IsMethodPresent(L"Windows.Perception.Spatial.Preview.SpatialGraphInteropPreview", L"CreateLocatorForNode"))
+    : m_useNewApi(IsSpatialGraphInteropPresent())
     , m_currentDynamicNodeId()
+    , m_isClosed(false)
+    , m_hasPose(false)
+    , m_pose()
+    , m_poseRequested(false)
+    , m_tickScheduled(false)
+    , m_tickKey(0)
 {
+    IFT(MFStartup(MF_VERSION));
 }
 
 // Transform
@@ -75,14 +190,100 @@ bool Transform::ProcessWorldTransform(Media::Payload const& payload, Windows::Pe
     {
         hr = UpdateV2(payload, worldOrigin);
     }
-    else
+
+    // no extrinsics, a frame reader's depth or ir source, the coordinate system still locates it
+    if (!m_useNewApi || FAILED(hr))
     {
         hr = Update(payload, worldOrigin);
     }
 
+    if (SUCCEEDED(hr))
+    {
+        payload.as<IStreamSample>()->MarkStage(PayloadStage::Transformed, QueryPerformanceTime());
+    }
+
     return SUCCEEDED(hr);
 }
 
+void Transform::Close()
+{
+    auto guard = m_cs.Guard();
+
+    m_isClosed = true;
+
+    if (m_tickScheduled)
+    {
+        MFCancelWorkItem(m_tickKey);
+
+        m_tickScheduled = false;
+    }
+
+    Reset();
+}
+
+// IMFAsyncCallback
+_Use_decl_annotations_
+HRESULT Transform::GetParameters(
+    DWORD* pdwFlags,
+    DWORD* pdwQueue)
+{
+    // off the timer thread, locating can take a while
+    *pdwFlags = 0;
+    *pdwQueue = MFASYNC_CALLBACK_QUEUE_MULTITHREADED;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT Transform::Invoke(
+    IMFAsyncResult* pAsyncResult)
+{
+    UNREFERENCED_PARAMETER(pAsyncResult);
+
+    SpatialLocator locator = nullptr;
+    SpatialCoordinateSystem cameraCoordinateSystem = nullptr;
+    SpatialCoordinateSystem worldOrigin = nullptr;
+    {
+        auto guard = m_cs.Guard();
+
+        m_tickScheduled = false;
+
+        // no frame since the last tick, the next one schedules it again
+        if (m_isClosed || !m_poseRequested || m_poseWorldOrigin == nullptr)
+        {
+            return S_OK;
+        }
+        m_poseRequested = false;
+
+        locator = m_poseLocator;
+        cameraCoordinateSystem = m_poseCameraCoordinateSystem;
+        worldOrigin = m_poseWorldOrigin;
+    }
+
+    // the node is located for now, frames arriving until the next tick reuse it
+    PerceptionTimestamp timestamp = nullptr;
+    if (locator != nullptr)
+    {
+        timestamp = PerceptionTimestampHelper::FromHistoricalTargetTime(clock::now());
+    }
+
+    Numerics::float4x4 pose{};
+    hresult hr = LocatePose(locator, cameraCoordinateSystem, worldOrigin, timestamp, pose);
+
+    auto guard = m_cs.Guard();
+
+    // dropped when the frames moved to another node or origin meanwhile
+    if (SUCCEEDED(hr) && locator == m_poseLocator && cameraCoordinateSystem == m_poseCameraCoordinateSystem && worldOrigin == m_poseWorldOrigin)
+    {
+        m_pose = pose;
+        m_hasPose = true;
+    }
+
+    ScheduleTick();
+
+    return S_OK;
+}
+
 // ITransform
 _Use_decl_annotations_
 hresult Transform::Update(
@@ -104,25 +305,37 @@ hresult Transform::Update(
     SpatialCoordinateSystem cameraCoordinateSystem = nullptr;
     IFR(streamSample->Sample()->GetUnknown(MFSampleExtension_Spatial_CameraCoordinateSystem, winrt::guid_of<SpatialCoordinateSystem>(), winrt::put_abi(cameraCoordinateSystem)));
 
-    // sample projection matrix
+    // sample projection matrix, made from the intrinsics when the source sent none
     UINT32 sizeCameraProject = 0;
     Windows::Foundation::Numerics::float4x4 cameraProjection{};
-    IFR(streamSample->Sample()->GetBlob(MFSampleExtension_Spatial_CameraProjectionTransform, (UINT8*)&cameraProjection, sizeof(cameraProjection), &sizeCameraProject));
+    if (FAILED(streamSample->Sample()->GetBlob(MFSampleExtension_Spatial_CameraProjectionTransform, (UINT8*)&cameraProjection, sizeof(cameraProjection), &sizeCameraProject)))
+    {
+        UINT32 sizeCameraIntrinsics = 0;
+        MFPinholeCameraIntrinsics cameraIntrinsics;
+        IFR(streamSample->Sample()->GetBlob(MFSampleExtension_PinholeCameraIntrinsics, (UINT8*)&cameraIntrinsics, sizeof(cameraIntrinsics), &sizeCameraIntrinsics));
+
+        if (sizeCameraIntrinsics != sizeof(cameraIntrinsics) || cameraIntrinsics.IntrinsicModelCount == 0)
+        {
+            IFR(MF_E_INVALIDTYPE);
+        }
 
-    auto transformRef = cameraCoordinateSystem.TryGetTransformTo(appCoordinateSystem);
-    NULL_CHK_HR(transformRef, E_POINTER);
+        cameraProjection = GetProjection(cameraIntrinsics);
+    }
 
-    // transform matrix to convert to app world space
-    const auto& cameraToWorld = transformRef.Value();
+    // transform matrix to convert to app world space, a camera coordinate system that
+    // changes every sample falls back to locating per frame
+    Numerics::float4x4 cameraToWorld{};
+    IFR(CachedPose(nullptr, cameraCoordinateSystem, appCoordinateSystem, TimeSpan{}, cameraToWorld));
 
-    // transform to world space
-    Numerics::float4x4 invertedCameraView{};
-    if (Numerics::invert(cameraView, &invertedCameraView))
+    // transform to world space, same singular test as Numerics::invert
+    DirectX::XMVECTOR determinant;
+    DirectX::XMMATRIX const invertedCameraView = DirectX::XMMatrixInverse(&determinant, LoadMatrix(cameraView));
+    if (fabsf(DirectX::XMVectorGetX(determinant)) >= FLT_EPSILON)
     {
-        // overwrite the cameraView with new value
-        invertedCameraView *= cameraToWorld;
+        Numerics::float4x4 cameraViewToWorld;
+        StoreMatrix(&cameraViewToWorld, DirectX::XMMatrixMultiply(invertedCameraView, LoadMatrix(cameraToWorld)));
 
-        streamSample->SetTransformAndProjection(invertedCameraView, cameraProjection);
+        streamSample->SetTransformAndProjection(cameraViewToWorld, cameraProjection);
     }
 
     return S_OK;
@@ -169,32 +382,23 @@ hresult Transform::UpdateV2(
     }
 
     // compute extrinsic transform from sample data
-    const auto& translation
-        = make_float4x4_translation(calibratedTransform.Position.x, calibratedTransform.Position.y, calibratedTransform.Position.z);
-    const auto& rotation
-        = make_float4x4_from_quaternion(Numerics::quaternion{ calibratedTransform.Orientation.x, calibratedTransform.Orientation.y, calibratedTransform.Orientation.z, calibratedTransform.Orientation.w });
-    const auto& cameraToLocator
-        = rotation * translation;
+    DirectX::XMMATRIX const cameraToLocator = PoseMatrix(
+        Numerics::quaternion{ calibratedTransform.Orientation.x, calibratedTransform.Orientation.y, calibratedTransform.Orientation.z, calibratedTransform.Orientation.w },
+        Numerics::float3{ calibratedTransform.Position.x, calibratedTransform.Position.y, calibratedTransform.Position.z });
 
     // get timestamp
     UINT64 sampleTimeQpc = 0;
     IFR(streamSample->Sample()->GetUINT64(MFSampleExtension_DeviceTimestamp, &sampleTimeQpc));
 
-    TimeSpan deviceTimestamp{ sampleTimeQpc };
-    auto frameTimestamp = PerceptionTimestampHelper::FromSystemRelativeTargetTime(deviceTimestamp);
-
-    if (worldOrigin && m_locator && frameTimestamp)
+    if (worldOrigin && m_locator)
     {
-        // locate dynamic node with respect to appCoordinateSystem
-        const auto& location = m_locator.TryLocateAtTimestamp(frameTimestamp, worldOrigin);
-        NULL_CHK_HR(location, MF_E_NOT_FOUND);
-
-        const auto& dynamicNodeToCoordinateSystem
-            = make_float4x4_from_quaternion(location.Orientation()) * make_float4x4_translation(location.Position());
+        // dynamic node with respect to appCoordinateSystem
+        Numerics::float4x4 dynamicNodeToCoordinateSystem{};
+        IFR(CachedPose(m_locator, nullptr, worldOrigin, TimeSpan{ static_cast<int64_t>(sampleTimeQpc) }, dynamicNodeToCoordinateSystem));
 
         // transform matrix from locator to app world space
-        Windows::Foundation::Numerics::float4x4 cameraToWorld 
-            = cameraToLocator * dynamicNodeToCoordinateSystem;
+        Windows::Foundation::Numerics::float4x4 cameraToWorld;
+        StoreMatrix(&cameraToWorld, DirectX::XMMatrixMultiply(cameraToLocator, LoadMatrix(dynamicNodeToCoordinateSystem)));
 
         // generate the older projection matrix
         streamSample->SetTransformAndProjection(
@@ -204,8 +408,101 @@ hresult Transform::UpdateV2(
     return S_OK;
 }
 
+// private
+_Use_decl_annotations_
+hresult Transform::CachedPose(
+    SpatialLocator const& locator,
+    SpatialCoordinateSystem const& cameraCoordinateSystem,
+    SpatialCoordinateSystem const& worldOrigin,
+    TimeSpan const& sampleTime,
+    Numerics::float4x4& pose)
+{
+    NULL_CHK_HR(worldOrigin, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    if (locator != m_poseLocator || cameraCoordinateSystem != m_poseCameraCoordinateSystem || worldOrigin != m_poseWorldOrigin)
+    {
+        m_poseLocator = locator;
+        m_poseCameraCoordinateSystem = cameraCoordinateSystem;
+        m_poseWorldOrigin = worldOrigin;
+        m_hasPose = false;
+    }
+
+    // first frame for this key, located at the frame time like before
+    if (!m_hasPose)
+    {
+        PerceptionTimestamp timestamp = nullptr;
+        if (locator != nullptr)
+        {
+            timestamp = PerceptionTimestampHelper::FromSystemRelativeTargetTime(sampleTime);
+        }
+
+        IFR(LocatePose(locator, cameraCoordinateSystem, worldOrigin, timestamp, m_pose));
+
+        m_hasPose = true;
+    }
+
+    pose = m_pose;
+
+    m_poseRequested = true;
+    ScheduleTick();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+hresult Transform::LocatePose(
+    SpatialLocator const& locator,
+    SpatialCoordinateSystem const& cameraCoordinateSystem,
+    SpatialCoordinateSystem const& worldOrigin,
+    PerceptionTimestamp const& timestamp,
+    Numerics::float4x4& pose)
+{
+    if (locator != nullptr)
+    {
+        NULL_CHK_HR(timestamp, MF_E_NOT_FOUND);
+
+        const auto& location = locator.TryLocateAtTimestamp(timestamp, worldOrigin);
+        NULL_CHK_HR(location, MF_E_NOT_FOUND);
+
+        StoreMatrix(&pose, PoseMatrix(location.Orientation(), location.Position()));
+    }
+    else
+    {
+        NULL_CHK_HR(cameraCoordinateSystem, E_INVALIDARG);
+
+        auto transformRef = cameraCoordinateSystem.TryGetTransformTo(worldOrigin);
+        NULL_CHK_HR(transformRef, E_POINTER);
+
+        pose = transformRef.Value();
+    }
+
+    return S_OK;
+}
+
+// called under m_cs
+void Transform::ScheduleTick()
+{
+    if (m_tickScheduled || m_isClosed)
+    {
+        return;
+    }
+
+    if (SUCCEEDED(MFScheduleWorkItem(this, nullptr, -TRANSFORM_POSE_REFRESH_MS, &m_tickKey)))
+    {
+        m_tickScheduled = true;
+    }
+}
+
 void Transform::Reset()
 {
     m_locator = nullptr;
     m_frameOfReference = nullptr;
+
+    m_poseLocator = nullptr;
+    m_poseCameraCoordinateSystem = nullptr;
+    m_poseWorldOrigin = nullptr;
+    m_hasPose = false;
+    m_poseRequested = false;
 }
@@ -4,6 +4,9 @@
 #include <winrt/windows.perception.spatial.h>
 #include <mfapi.h>
 
+// the cached pose is refreshed this often off the payload thread, it is at most one tick old
+#define TRANSFORM_POSE_REFRESH_MS 100
+
 
 //struct __declspec(uuid("27ee71f8-e7d3-435c-b394-42058efa6591")) ITransformPriv : ::IUnknown
 //{
@@ -12,18 +15,36 @@
 //        _In_ winrt::Windows::Perception::Spatial::SpatialCoordinateSystem const& appCoordinateSystem) = 0;
 //};
 //
+
+// reads MFSampleExtension_PinholeCameraIntrinsics, picks the model for the frame size or the first one
+HRESULT GetCameraIntrinsics(
+    _In_ winrt::com_ptr<IMFSample> const& sample,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _Out_ CAMERA_INTRINSICS& intrinsics);
+
 namespace winrt::CameraCapture::Media::implementation
 {
-    struct Transform : TransformT<Transform>
+    struct Transform : TransformT<Transform, IMFAsyncCallback>
     {
         Transform();
-        ~Transform() { Reset(); }
+        ~Transform() { Close(); MFShutdown(); }
 
         // Trasform
         bool ProcessWorldTransform(
             Media::Payload const& payload, 
             Windows::Perception::Spatial::SpatialCoordinateSystem const& worldOrigin);
 
+        // not part of the runtime class, stops the refresh tick so it releases the transform
+        void Close();
+
+        // IMFAsyncCallback
+        STDOVERRIDEMETHODIMP GetParameters(
+            _Out_ DWORD* pdwFlags,
+            _Out_ DWORD* pdwQueue);
+        STDOVERRIDEMETHODIMP Invoke(
+            _In_ IMFAsyncResult* pAsyncResult);
+
     private:
         void Reset();
 
@@ -35,11 +56,43 @@ namespace winrt::CameraCapture::Media::implementation
             _In_ Media::Payload const& payload,
             _In_ Windows::Perception::Spatial::SpatialCoordinateSystem const& appCoordinateSystem);
 
+        // the node (or camera coordinate system) to world transform, located again only when
+        // the node or world origin changes, the tick keeps it current after that
+        hresult CachedPose(
+            _In_opt_ Windows::Perception::Spatial::SpatialLocator const& locator,
+            _In_opt_ Windows::Perception::Spatial::SpatialCoordinateSystem const& cameraCoordinateSystem,
+            _In_ Windows::Perception::Spatial::SpatialCoordinateSystem const& worldOrigin,
+            _In_ Windows::Foundation::TimeSpan const& sampleTime,
+            _Out_ Windows::Foundation::Numerics::float4x4& pose);
+
+        static hresult LocatePose(
+            _In_opt_ Windows::Perception::Spatial::SpatialLocator const& locator,
+            _In_opt_ Windows::Perception::Spatial::SpatialCoordinateSystem const& cameraCoordinateSystem,
+            _In_ Windows::Perception::Spatial::SpatialCoordinateSystem const& worldOrigin,
+            _In_opt_ Windows::Perception::PerceptionTimestamp const& timestamp,
+            _Out_ Windows::Foundation::Numerics::float4x4& pose);
+
+        void ScheduleTick();
+
     private:
         boolean m_useNewApi;
         guid m_currentDynamicNodeId;
         Windows::Perception::Spatial::SpatialLocator m_locator{ nullptr };
         Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_frameOfReference{ nullptr };
+
+        // shared with the tick, the payload thread only locates when the key changes
+        CriticalSection m_cs;
+        boolean m_isClosed;
+        Windows::Perception::Spatial::SpatialLocator m_poseLocator{ nullptr };
+        Windows::Perception::Spatial::SpatialCoordinateSystem m_poseCameraCoordinateSystem{ nullptr };
+        Windows::Perception::Spatial::SpatialCoordinateSystem m_poseWorldOrigin{ nullptr };
+        boolean m_hasPose;
+        Windows::Foundation::Numerics::float4x4 m_pose;
+
+        // the tick stops once frames stop asking for the pose
+        boolean m_poseRequested;
+        boolean m_tickScheduled;
+        MFWORKITEM_KEY m_tickKey;
     };
 }
 
@@ -0,0 +1,565 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.VideoEncoder.h"
+#include "Media.Functions.h"
+
+#include <mfapi.h>
+#include <mferror.h>
+#include <codecapi.h>
+#include <icodecapi.h>
+
+using namespace winrt;
+
+// returns the offset of the next annex b start code at or after offset, or length
+static size_t FindStartCode(
+    _In_reads_(length) uint8_t const* data,
+    _In_ size_t length,
+    _In_ size_t offset,
+    _Out_ size_t* codeLength)
+{
+    *codeLength = 0;
+
+    for (size_t i = offset; i + 3 <= length; ++i)
+    {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)
+        {
+            continue;
+        }
+
+        // 4 byte start codes carry a leading zero
+        if (i > offset && data[i - 1] == 0)
+        {
+            *codeLength = 4;
+
+            return i - 1;
+        }
+
+        *codeLength = 3;
+
+        return i;
+    }
+
+    return length;
+}
+
+// best effort, not every hardware encoder exposes every property
+static void SetCodecValue(
+    _In_ com_ptr<ICodecAPI> const& codecApi,
+    _In_ GUID const& property,
+    _In_ uint32_t value)
+{
+    VARIANT var{};
+    var.vt = VT_UI4;
+    var.ulVal = value;
+
+    HRESULT hr = codecApi->SetValue(&property, &var);
+    if (FAILED(hr))
+    {
+        Log(L"ICodecAPI::SetValue failed: 0x%lx\n", hr);
+    }
+}
+
+_Use_decl_annotations_
+HRESULT VideoEncoder::Create(
+    com_ptr<ID3D11Device> const& d3dDevice,
+    com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+    VideoCodec codec,
+    uint32_t width, uint32_t height,
+    uint32_t frameRate,
+    uint32_t bitrate,
+    EncodedFrameCallback fnCallback,
+    void* pCallbackObject,
+    com_ptr<VideoEncoder>& videoEncoder)
+{
+    NULL_CHK_HR(d3dDevice, E_INVALIDARG);
+    NULL_CHK_HR(dxgiDeviceManager, E_INVALIDARG);
+    NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+    // nv12 needs even dimensions
+    if (width < 2 || height < 2 || (width % 2) != 0 || (height % 2) != 0 || frameRate < 1 || bitrate < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    videoEncoder = nullptr;
+
+    GUID const& outputSubtype = codec == VideoCodec::Hevc ? MFVideoFormat_HEVC : MFVideoFormat_H264;
+
+    // find the hardware encoder
+    MFT_REGISTER_TYPE_INFO inputInfo = { MFMediaType_Video, MFVideoFormat_NV12 };
+    MFT_REGISTER_TYPE_INFO outputInfo = { MFMediaType_Video, outputSubtype };
+
+    IMFActivate** activates = nullptr;
+    UINT32 activateCount = 0;
+    IFR(MFTEnumEx(MFT_CATEGORY_VIDEO_ENCODER, MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER, &inputInfo, &outputInfo, &activates, &activateCount));
+
+    com_ptr<IMFTransform> transform = nullptr;
+    HRESULT hr = activateCount > 0 ? activates[0]->ActivateObject(IID_PPV_ARGS(transform.put())) : MF_E_TOPO_CODEC_NOT_FOUND;
+
+    for (UINT32 i = 0; i < activateCount; ++i)
+    {
+        activates[i]->Release();
+    }
+    CoTaskMemFree(activates);
+
+    IFR(hr);
+
+    // hardware encoders are asynchronous and have to be unlocked first
+    com_ptr<IMFAttributes> attributes = nullptr;
+    IFR(transform->GetAttributes(attributes.put()));
+    IFR(attributes->SetUINT32(MF_TRANSFORM_ASYNC_UNLOCK, TRUE));
+    IFR(attributes->SetUINT32(MF_LOW_LATENCY, TRUE));
+
+    auto eventGenerator = transform.try_as<IMFMediaEventGenerator>();
+    NULL_CHK_HR(eventGenerator, MF_E_ASYNC_OP_NOT_SUPPORTED);
+
+    // encode from the textures on the media device
+    IFR(transform->ProcessMessage(MFT_MESSAGE_SET_D3D_MANAGER, reinterpret_cast<ULONG_PTR>(dxgiDeviceManager.get())));
+
+    // encoders want the output type before the input type
+    com_ptr<IMFMediaType> outputType = nullptr;
+    IFR(MFCreateMediaType(outputType.put()));
+    IFR(outputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    IFR(outputType->SetGUID(MF_MT_SUBTYPE, outputSubtype));
+    IFR(outputType->SetUINT32(MF_MT_AVG_BITRATE, bitrate));
+    IFR(outputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    IFR(MFSetAttributeSize(outputType.get(), MF_MT_FRAME_SIZE, width, height));
+    IFR(MFSetAttributeRatio(outputType.get(), MF_MT_FRAME_RATE, frameRate, 1));
+    IFR(MFSetAttributeRatio(outputType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+    IFR(transform->SetOutputType(0, outputType.get(), 0));
+
+    com_ptr<IMFMediaType> inputType = nullptr;
+    IFR(MFCreateMediaType(inputType.put()));
+    IFR(inputType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    IFR(inputType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12));
+    IFR(inputType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    IFR(MFSetAttributeSize(inputType.get(), MF_MT_FRAME_SIZE, width, height));
+    IFR(MFSetAttributeRatio(inputType.get(), MF_MT_FRAME_RATE, frameRate, 1));
+    IFR(MFSetAttributeRatio(inputType.get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+    IFR(transform->SetInputType(0, inputType.get(), 0));
+
+    // constant bitrate, no b-frames and a key frame every second for late joiners
+    auto codecApi = transform.try_as<ICodecAPI>();
+    if (codecApi != nullptr)
+    {
+        SetCodecValue(codecApi, CODECAPI_AVEncCommonRateControlMode, eAVEncCommonRateControlMode_CBR);
+        SetCodecValue(codecApi, CODECAPI_AVEncCommonMeanBitRate, bitrate);
+        SetCodecValue(codecApi, CODECAPI_AVEncMPVGOPSize, frameRate);
+        SetCodecValue(codecApi, CODECAPI_AVEncMPVDefaultBPictureCount, 0);
+    }
+
+    MFT_OUTPUT_STREAM_INFO outputInfoStream{};
+    IFR(transform->GetOutputStreamInfo(0, &outputInfoStream));
+
+    auto encoder = make<VideoEncoder>().as<VideoEncoder>();
+    encoder->m_codec = codec;
+    encoder->m_width = width;
+    encoder->m_height = height;
+    encoder->m_fnCallback = fnCallback;
+    encoder->m_callbackObject = pCallbackObject;
+    encoder->m_d3dDevice = d3dDevice;
+    encoder->m_transform = transform;
+    encoder->m_eventGenerator = eventGenerator;
+    encoder->m_outputProvidesSamples = (outputInfoStream.dwFlags & (MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES)) != 0;
+
+    if (!encoder->m_outputProvidesSamples)
+    {
+        DWORD bufferSize = outputInfoStream.cbSize > 0 ? outputInfoStream.cbSize : width * height * 3 / 2;
+
+        com_ptr<IMFMediaBuffer> outputBuffer = nullptr;
+        IFR(MFCreateMemoryBuffer(bufferSize, outputBuffer.put()));
+
+        IFR(MFCreateSample(encoder->m_outputSample.put()));
+        IFR(encoder->m_outputSample->AddBuffer(outputBuffer.get()));
+    }
+
+    IFR(transform->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0));
+    IFR(transform->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0));
+
+    // the event loop keeps the encoder alive until shutdown
+    IFR(eventGenerator->BeginGetEvent(encoder.get(), nullptr));
+
+    videoEncoder = encoder;
+
+    return S_OK;
+}
+
+VideoEncoder::VideoEncoder()
+    : m_isShutdown(false)
+    , m_codec(VideoCodec::H264)
+    , m_width(0)
+    , m_height(0)
+    , m_fnCallback(nullptr)
+    , m_callbackObject(nullptr)
+    , m_d3dDevice(nullptr)
+    , m_transform(nullptr)
+    , m_eventGenerator(nullptr)
+    , m_inputRequests(0)
+    , m_videoProcessor(nullptr)
+    , m_videoProcessorFormat(DXGI_FORMAT_UNKNOWN)
+    , m_inputIndex(0)
+    , m_outputProvidesSamples(false)
+    , m_outputSample(nullptr)
+{}
+
+VideoEncoder::~VideoEncoder()
+{
+    Shutdown();
+}
+
+_Use_decl_annotations_
+HRESULT VideoEncoder::Encode(
+    com_ptr<IMFSample> const& sample)
+{
+    NULL_CHK_HR(sample, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        IFR(MF_E_SHUTDOWN);
+    }
+
+    com_ptr<IMFSample> inputSample = nullptr;
+    IFR(PrepareInput(sample, inputSample));
+
+    if (m_inputRequests > 0 && m_pendingSamples.empty())
+    {
+        --m_inputRequests;
+
+        IFR(m_transform->ProcessInput(0, inputSample.get(), 0));
+
+        return S_OK;
+    }
+
+    // the encoder is behind, drop the oldest frame instead of adding latency
+    m_pendingSamples.push_back(inputSample);
+    while (m_pendingSamples.size() > MAX_ENCODER_PENDING_SAMPLES)
+    {
+        m_pendingSamples.pop_front();
+    }
+
+    return S_OK;
+}
+
+void VideoEncoder::Shutdown()
+{
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        return;
+    }
+    m_isShutdown = true;
+
+    m_pendingSamples.clear();
+
+    if (m_transform != nullptr)
+    {
+        m_transform->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, 0);
+        m_transform->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+
+        // ends the pending BeginGetEvent, Invoke sees MF_E_SHUTDOWN
+        auto shutdown = m_transform.try_as<IMFShutdown>();
+        if (shutdown != nullptr)
+        {
+            shutdown->Shutdown();
+        }
+
+        m_transform->ProcessMessage(MFT_MESSAGE_SET_D3D_MANAGER, 0);
+    }
+
+    m_inputSamples.clear();
+    m_inputTextures.clear();
+
+    if (m_videoProcessor != nullptr)
+    {
+        m_videoProcessor->Reset();
+
+        m_videoProcessor = nullptr;
+    }
+
+    m_outputSample = nullptr;
+    m_eventGenerator = nullptr;
+    m_transform = nullptr;
+    m_d3dDevice = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT VideoEncoder::GetParameters(
+    DWORD* pdwFlags,
+    DWORD* pdwQueue)
+{
+    UNREFERENCED_PARAMETER(pdwFlags);
+    UNREFERENCED_PARAMETER(pdwQueue);
+
+    return E_NOTIMPL;
+}
+
+_Use_decl_annotations_
+HRESULT VideoEncoder::Invoke(
+    IMFAsyncResult* pAsyncResult)
+{
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        return S_OK;
+    }
+
+    com_ptr<IMFMediaEvent> mediaEvent = nullptr;
+    IFR(m_eventGenerator->EndGetEvent(pAsyncResult, mediaEvent.put()));
+
+    MediaEventType eventType = MEUnknown;
+    IFR(mediaEvent->GetType(&eventType));
+
+    HRESULT hr = S_OK;
+    switch (eventType)
+    {
+    case METransformNeedInput:
+        if (!m_pendingSamples.empty())
+        {
+            auto inputSample = m_pendingSamples.front();
+            m_pendingSamples.pop_front();
+
+            hr = m_transform->ProcessInput(0, inputSample.get(), 0);
+        }
+        else
+        {
+            ++m_inputRequests;
+        }
+        break;
+
+    case METransformHaveOutput:
+        hr = ProcessOutput();
+        break;
+
+    default:
+        break;
+    }
+
+    // a bad frame only costs that frame, keep the event loop running
+    if (FAILED(hr))
+    {
+        Log(L"VideoEncoder event %d failed: 0x%lx\n", eventType, hr);
+    }
+
+    IFR(m_eventGenerator->BeginGetEvent(this, nullptr));
+
+    return S_OK;
+}
+
+// private
+_Use_decl_annotations_
+HRESULT VideoEncoder::PrepareInput(
+    com_ptr<IMFSample> const& sample,
+    com_ptr<IMFSample>& inputSample)
+{
+    inputSample = nullptr;
+
+    com_ptr<ID3D11Texture2D> texture = nullptr;
+    uint32_t subresourceIndex = 0;
+    IFR(GetTextureFromSample(sample, texture, &subresourceIndex));
+
+    D3D11_TEXTURE2D_DESC desc{};
+    texture->GetDesc(&desc);
+
+    // unpadded nv12 capture samples go to the encoder as is
+    if (desc.Format == DXGI_FORMAT_NV12 && desc.Width == m_width && desc.Height == m_height && desc.ArraySize == 1)
+    {
+        inputSample = sample;
+
+        return S_OK;
+    }
+
+    if (desc.Format != DXGI_FORMAT_NV12 && desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM)
+    {
+        IFR(MF_E_UNSUPPORTED_D3D_TYPE);
+    }
+
+    if (m_videoProcessor == nullptr || m_videoProcessorFormat != desc.Format)
+    {
+        m_videoProcessor = nullptr;
+
+        auto inputColorSpace = desc.Format == DXGI_FORMAT_NV12 ? DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709 : DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
+
+        IFR(VideoProcessor::Create(
+            m_d3dDevice,
+            m_width, m_height, inputColorSpace,
+            m_width, m_height, DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709,
+            m_videoProcessor));
+
+        m_videoProcessorFormat = desc.Format;
+    }
+
+    IFR(CreateInputSamples());
+
+    // the encoder may still hold a few of these, round robin over the pool
+    auto const& target = m_inputTextures[m_inputIndex];
+    auto const& targetSample = m_inputSamples[m_inputIndex];
+    m_inputIndex = (m_inputIndex + 1) % MAX_ENCODER_INPUT_TEXTURES;
+
+    com_ptr<ID3D11DeviceContext> mediaContext = nullptr;
+    m_d3dDevice->GetImmediateContext(mediaContext.put());
+
+    IFR(m_videoProcessor->Blt(mediaContext, texture, subresourceIndex, target));
+
+    LONGLONG sampleTime = 0;
+    IFR(sample->GetSampleTime(&sampleTime));
+    IFR(targetSample->SetSampleTime(sampleTime));
+
+    LONGLONG sampleDuration = 0;
+    IFR(sample->GetSampleDuration(&sampleDuration));
+    IFR(targetSample->SetSampleDuration(sampleDuration));
+
+    inputSample = targetSample;
+
+    return S_OK;
+}
+
+HRESULT VideoEncoder::CreateInputSamples()
+{
+    if (!m_inputSamples.empty())
+    {
+        return S_OK;
+    }
+
+    auto desc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_NV12, m_width, m_height, 1, 1, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+
+    std::vector<com_ptr<ID3D11Texture2D>> textures;
+    std::vector<com_ptr<IMFSample>> samples;
+    for (uint32_t i = 0; i < MAX_ENCODER_INPUT_TEXTURES; ++i)
+    {
+        com_ptr<ID3D11Texture2D> texture = nullptr;
+        IFR(m_d3dDevice->CreateTexture2D(&desc, nullptr, texture.put()));
+
+        com_ptr<IMFMediaBuffer> mediaBuffer = nullptr;
+        IFR(MFCreateDXGISurfaceBuffer(__uuidof(ID3D11Texture2D), texture.get(), 0, /*fBottomUpWhenLinear*/false, mediaBuffer.put()));
+
+        // some encoders check the buffer length before touching the surface
+        auto buffer2d = mediaBuffer.try_as<IMF2DBuffer>();
+        if (buffer2d != nullptr)
+        {
+            DWORD length = 0;
+            IFR(buffer2d->GetContiguousLength(&length));
+            IFR(mediaBuffer->SetCurrentLength(length));
+        }
+
+        com_ptr<IMFSample> mediaSample = nullptr;
+        IFR(MFCreateSample(mediaSample.put()));
+        IFR(mediaSample->AddBuffer(mediaBuffer.get()));
+
+        textures.push_back(texture);
+        samples.push_back(mediaSample);
+    }
+
+    m_inputTextures = std::move(textures);
+    m_inputSamples = std::move(samples);
+    m_inputIndex = 0;
+
+    return S_OK;
+}
+
+HRESULT VideoEncoder::ProcessOutput()
+{
+    if (m_outputSample != nullptr)
+    {
+        com_ptr<IMFMediaBuffer> outputBuffer = nullptr;
+        IFR(m_outputSample->GetBufferByIndex(0, outputBuffer.put()));
+        IFR(outputBuffer->SetCurrentLength(0));
+    }
+
+    MFT_OUTPUT_DATA_BUFFER outputData{};
+    outputData.dwStreamID = 0;
+    outputData.pSample = m_outputProvidesSamples ? nullptr : m_outputSample.get();
+
+    DWORD status = 0;
+    HRESULT hr = m_transform->ProcessOutput(0, 1, &outputData, &status);
+
+    if (outputData.pEvents != nullptr)
+    {
+        outputData.pEvents->Release();
+        outputData.pEvents = nullptr;
+    }
+
+    // samples provided by the encoder belong to us now
+    com_ptr<IMFSample> sample = nullptr;
+    if (m_outputProvidesSamples)
+    {
+        sample.attach(outputData.pSample);
+    }
+    else
+    {
+        sample = m_outputSample;
+    }
+
+    // the encoder picked different output parameters, take whatever it offers
+    if (hr == MF_E_TRANSFORM_STREAM_CHANGE)
+    {
+        com_ptr<IMFMediaType> outputType = nullptr;
+        IFR(m_transform->GetOutputAvailableType(0, 0, outputType.put()));
+        IFR(m_transform->SetOutputType(0, outputType.get(), 0));
+
+        return S_OK;
+    }
+    IFR(hr);
+
+    NULL_CHK_HR(sample, E_UNEXPECTED);
+
+    return EmitNalUnits(sample);
+}
+
+_Use_decl_annotations_
+HRESULT VideoEncoder::EmitNalUnits(
+    com_ptr<IMFSample> const& sample)
+{
+    LONGLONG sampleTime = 0;
+    IFR(sample->GetSampleTime(&sampleTime));
+
+    boolean keyFrame = MFGetAttributeUINT32(sample.get(), MFSampleExtension_CleanPoint, FALSE) != FALSE;
+
+    com_ptr<IMFMediaBuffer> mediaBuffer = nullptr;
+    IFR(sample->ConvertToContiguousBuffer(mediaBuffer.put()));
+
+    BYTE* data = nullptr;
+    DWORD dataLength = 0;
+    IFR(mediaBuffer->Lock(&data, nullptr, &dataLength));
+
+    // annex b start codes become big endian lengths, the buffer is reused between frames
+    m_nalUnits.clear();
+
+    size_t codeLength = 0;
+    size_t start = FindStartCode(data, dataLength, 0, &codeLength);
+    while (start < dataLength)
+    {
+        size_t nalStart = start + codeLength;
+
+        size_t nextCodeLength = 0;
+        size_t next = FindStartCode(data, dataLength, nalStart, &nextCodeLength);
+
+        uint32_t nalLength = static_cast<uint32_t>(next - nalStart);
+        if (nalLength > 0)
+        {
+            m_nalUnits.push_back(static_cast<uint8_t>(nalLength >> 24));
+            m_nalUnits.push_back(static_cast<uint8_t>(nalLength >> 16));
+            m_nalUnits.push_back(static_cast<uint8_t>(nalLength >> 8));
+            m_nalUnits.push_back(static_cast<uint8_t>(nalLength));
+            m_nalUnits.insert(m_nalUnits.end(), data + nalStart, data + next);
+        }
+
+        start = next;
+        codeLength = nextCodeLength;
+    }
+
+    IFR(mediaBuffer->Unlock());
+
+    if (!m_nalUnits.empty())
+    {
+        m_fnCallback(m_callbackObject, m_nalUnits.data(), static_cast<uint32_t>(m_nalUnits.size()), sampleTime, keyFrame);
+    }
+
+    return S_OK;
+}
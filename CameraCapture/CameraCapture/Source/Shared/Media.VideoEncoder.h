@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.VideoProcessor.h"
+
+#include <mfidl.h>
+#include <mftransform.h>
+
+#include <deque>
+#include <vector>
+
+#define MAX_ENCODER_PENDING_SAMPLES 2
+#define MAX_ENCODER_INPUT_TEXTURES 6
+
+// hardware h264/hevc encoder mft on the media device, frames go in as d3d textures
+// and come out as 4 byte big endian length prefixed nal units on a work queue thread
+struct VideoEncoder : winrt::implements<VideoEncoder, IMFAsyncCallback>
+{
+    static HRESULT Create(
+        _In_ winrt::com_ptr<ID3D11Device> const& d3dDevice,
+        _In_ winrt::com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+        _In_ VideoCodec codec,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ uint32_t frameRate,
+        _In_ uint32_t bitrate,
+        _In_ EncodedFrameCallback fnCallback,
+        _In_ void* pCallbackObject,
+        _Out_ winrt::com_ptr<VideoEncoder>& videoEncoder);
+
+    VideoEncoder();
+    virtual ~VideoEncoder();
+
+    // a busy encoder keeps the newest MAX_ENCODER_PENDING_SAMPLES frames
+    HRESULT Encode(
+        _In_ winrt::com_ptr<IMFSample> const& sample);
+
+    void Shutdown();
+
+    VideoCodec Codec() const { return m_codec; }
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+    // IMFAsyncCallback
+    STDOVERRIDEMETHODIMP GetParameters(
+        _Out_ DWORD* pdwFlags,
+        _Out_ DWORD* pdwQueue);
+    STDOVERRIDEMETHODIMP Invoke(
+        _In_ IMFAsyncResult* pAsyncResult);
+
+private:
+    HRESULT PrepareInput(
+        _In_ winrt::com_ptr<IMFSample> const& sample,
+        _Out_ winrt::com_ptr<IMFSample>& inputSample);
+    HRESULT CreateInputSamples();
+    HRESULT ProcessOutput();
+    HRESULT EmitNalUnits(
+        _In_ winrt::com_ptr<IMFSample> const& sample);
+
+private:
+    CriticalSection m_cs;
+    boolean m_isShutdown;
+
+    VideoCodec m_codec;
+    uint32_t m_width;
+    uint32_t m_height;
+
+    EncodedFrameCallback m_fnCallback;
+    void* m_callbackObject;
+
+    winrt::com_ptr<ID3D11Device> m_d3dDevice;
+    winrt::com_ptr<IMFTransform> m_transform;
+    winrt::com_ptr<IMFMediaEventGenerator> m_eventGenerator;
+
+    // METransformNeedInput requests not answered yet
+    uint32_t m_inputRequests;
+    std::deque<winrt::com_ptr<IMFSample>> m_pendingSamples;
+
+    // bgra or padded samples are converted into nv12 textures the encoder can take
+    winrt::com_ptr<VideoProcessor> m_videoProcessor;
+    DXGI_FORMAT m_videoProcessorFormat;
+    std::vector<winrt::com_ptr<ID3D11Texture2D>> m_inputTextures;
+    std::vector<winrt::com_ptr<IMFSample>> m_inputSamples;
+    uint32_t m_inputIndex;
+
+    boolean m_outputProvidesSamples;
+    winrt::com_ptr<IMFSample> m_outputSample;
+    std::vector<uint8_t> m_nalUnits;
+};
@@ -0,0 +1,215 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "Media.VideoProcessor.h"
+
+#include <mferror.h>
+
+using namespace winrt;
+
+_Use_decl_annotations_
+HRESULT VideoProcessor::Create(
+    com_ptr<ID3D11Device> const& d3dDevice,
+    uint32_t inputWidth, uint32_t inputHeight,
+    DXGI_COLOR_SPACE_TYPE const inputColorSpace,
+    uint32_t outputWidth, uint32_t outputHeight,
+    DXGI_COLOR_SPACE_TYPE const outputColorSpace,
+    com_ptr<VideoProcessor>& videoProcessor)
+{
+    NULL_CHK_HR(d3dDevice, E_INVALIDARG);
+    if (inputWidth < 1 || inputHeight < 1 || outputWidth < 1 || outputHeight < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    videoProcessor = nullptr;
+
+    auto videoDevice = d3dDevice.try_as<ID3D11VideoDevice>();
+    NULL_CHK_HR(videoDevice, E_NOINTERFACE);
+
+    // create enumerator
+    D3D11_VIDEO_PROCESSOR_CONTENT_DESC vpcdesc{};
+    vpcdesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
+    vpcdesc.InputFrameRate.Numerator = 30;
+    vpcdesc.InputFrameRate.Denominator = 1;
+    vpcdesc.InputWidth = inputWidth;
+    vpcdesc.InputHeight = inputHeight;
+    vpcdesc.OutputFrameRate.Numerator = 30;
+    vpcdesc.OutputFrameRate.Denominator = 1;
+    vpcdesc.OutputWidth = outputWidth;
+    vpcdesc.OutputHeight = outputHeight;
+    vpcdesc.Usage = D3D11_VIDEO_USAGE_OPTIMAL_SPEED;
+
+    com_ptr<ID3D11VideoProcessorEnumerator> videoProcEnum = nullptr;
+    IFR(videoDevice->CreateVideoProcessorEnumerator(&vpcdesc, videoProcEnum.put()));
+
+    // create processor
+    com_ptr<ID3D11VideoProcessor> videoProc = nullptr;
+    IFR(videoDevice->CreateVideoProcessor(videoProcEnum.get(), 0, videoProc.put()));
+
+    auto processor = make<VideoProcessor>().as<VideoProcessor>();
+    processor->m_inputWidth = inputWidth;
+    processor->m_inputHeight = inputHeight;
+    processor->m_outputWidth = outputWidth;
+    processor->m_outputHeight = outputHeight;
+    processor->m_inputColorSpace = inputColorSpace;
+    processor->m_outputColorSpace = outputColorSpace;
+    processor->m_videoDevice = videoDevice;
+    processor->m_videoProcessorEnum = videoProcEnum;
+    processor->m_videoProcessor = videoProc;
+
+    videoProcessor = processor;
+
+    return S_OK;
+}
+
+VideoProcessor::VideoProcessor()
+    : m_inputWidth(0)
+    , m_inputHeight(0)
+    , m_outputWidth(0)
+    , m_outputHeight(0)
+    , m_inputColorSpace(DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709)
+    , m_outputColorSpace(DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709)
+    , m_videoDevice(nullptr)
+    , m_videoProcessorEnum(nullptr)
+    , m_videoProcessor(nullptr)
+{}
+
+VideoProcessor::~VideoProcessor()
+{
+    Reset();
+}
+
+_Use_decl_annotations_
+HRESULT VideoProcessor::Blt(
+    com_ptr<ID3D11DeviceContext> const& d3dDeviceContext,
+    com_ptr<ID3D11Texture2D> const& source,
+    uint32_t sourceArraySlice,
+    com_ptr<ID3D11Texture2D> const& target)
+{
+    // capture textures can be padded past the frame size
+    RECT sourceRect = { 0, 0, static_cast<LONG>(m_inputWidth), static_cast<LONG>(m_inputHeight) };
+
+    return Blt(d3dDeviceContext, source, sourceArraySlice, sourceRect, target);
+}
+
+_Use_decl_annotations_
+HRESULT VideoProcessor::Blt(
+    com_ptr<ID3D11DeviceContext> const& d3dDeviceContext,
+    com_ptr<ID3D11Texture2D> const& source,
+    uint32_t sourceArraySlice,
+    RECT const& sourceRect,
+    com_ptr<ID3D11Texture2D> const& target)
+{
+    NULL_CHK_HR(d3dDeviceContext, E_INVALIDARG);
+    NULL_CHK_HR(source, E_INVALIDARG);
+    NULL_CHK_HR(target, E_INVALIDARG);
+    NULL_CHK_HR(m_videoProcessor, MF_E_NOT_INITIALIZED);
+
+    auto videoContext = d3dDeviceContext.as<ID3D11VideoContext1>();
+
+    com_ptr<ID3D11VideoProcessorInputView> inputView = nullptr;
+    IFR(GetInputView(source, sourceArraySlice, inputView));
+
+    com_ptr<ID3D11VideoProcessorOutputView> outputView = nullptr;
+    IFR(GetOutputView(target, outputView));
+
+    // stream state is per context, set it every blt
+    videoContext->VideoProcessorSetStreamFrameFormat(m_videoProcessor.get(), 0, D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE);
+    videoContext->VideoProcessorSetStreamColorSpace1(m_videoProcessor.get(), 0, m_inputColorSpace);
+    videoContext->VideoProcessorSetOutputColorSpace1(m_videoProcessor.get(), m_outputColorSpace);
+    videoContext->VideoProcessorSetStreamAutoProcessingMode(m_videoProcessor.get(), 0, FALSE);
+
+    RECT targetRect = { 0, 0, static_cast<LONG>(m_outputWidth), static_cast<LONG>(m_outputHeight) };
+    videoContext->VideoProcessorSetStreamSourceRect(m_videoProcessor.get(), 0, TRUE, &sourceRect);
+    videoContext->VideoProcessorSetStreamDestRect(m_videoProcessor.get(), 0, TRUE, &targetRect);
+    videoContext->VideoProcessorSetOutputTargetRect(m_videoProcessor.get(), TRUE, &targetRect);
+
+    D3D11_VIDEO_PROCESSOR_STREAM vpStream{};
+    vpStream.Enable = TRUE;
+    vpStream.pInputSurface = inputView.get();
+    IFR(videoContext->VideoProcessorBlt(m_videoProcessor.get(), outputView.get(), 0, 1, &vpStream));
+
+    return S_OK;
+}
+
+void VideoProcessor::Reset()
+{
+    m_inputViews.clear();
+    m_outputViews.clear();
+
+    m_videoProcessor = nullptr;
+    m_videoProcessorEnum = nullptr;
+    m_videoDevice = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT VideoProcessor::GetInputView(
+    com_ptr<ID3D11Texture2D> const& source,
+    uint32_t arraySlice,
+    com_ptr<ID3D11VideoProcessorInputView>& inputView)
+{
+    for (auto const& cached : m_inputViews)
+    {
+        if (cached.texture == source.get() && cached.arraySlice == arraySlice)
+        {
+            inputView = cached.view;
+
+            return S_OK;
+        }
+    }
+
+    D3D11_VIDEO_PROCESSOR_INPUT_VIEW_DESC inputDesc{};
+    inputDesc.ViewDimension = D3D11_VPIV_DIMENSION_TEXTURE2D;
+    inputDesc.Texture2D.MipSlice = 0;
+    inputDesc.Texture2D.ArraySlice = arraySlice;
+
+    com_ptr<ID3D11VideoProcessorInputView> view = nullptr;
+    IFR(m_videoDevice->CreateVideoProcessorInputView(source.get(), m_videoProcessorEnum.get(), &inputDesc, view.put()));
+
+    // the pipeline changed its sample pool, start over
+    if (m_inputViews.size() >= MAX_VIDEO_PROCESSOR_VIEWS)
+    {
+        m_inputViews.clear();
+    }
+    m_inputViews.push_back({ source.get(), arraySlice, view });
+
+    inputView = view;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT VideoProcessor::GetOutputView(
+    com_ptr<ID3D11Texture2D> const& target,
+    com_ptr<ID3D11VideoProcessorOutputView>& outputView)
+{
+    for (auto const& cached : m_outputViews)
+    {
+        if (cached.texture == target.get())
+        {
+            outputView = cached.view;
+
+            return S_OK;
+        }
+    }
+
+    D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC outputDesc{};
+    outputDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
+    outputDesc.Texture2D.MipSlice = 0;
+
+    com_ptr<ID3D11VideoProcessorOutputView> view = nullptr;
+    IFR(m_videoDevice->CreateVideoProcessorOutputView(target.get(), m_videoProcessorEnum.get(), &outputDesc, view.put()));
+
+    if (m_outputViews.size() >= MAX_VIDEO_PROCESSOR_VIEWS)
+    {
+        m_outputViews.clear();
+    }
+    m_outputViews.push_back({ target.get(), view });
+
+    outputView = view;
+
+    return S_OK;
+}
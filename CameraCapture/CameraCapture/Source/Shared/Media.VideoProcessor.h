@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11_4.h>
+
+#include <vector>
+
+#define MAX_VIDEO_PROCESSOR_VIEWS 16
+
+// keeps the ID3D11VideoProcessor and its views alive between frames,
+// CopyToTargetTexture recreates all of them on every call
+struct VideoProcessor : winrt::implements<VideoProcessor, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ winrt::com_ptr<ID3D11Device> const& d3dDevice,
+        _In_ uint32_t inputWidth,
+        _In_ uint32_t inputHeight,
+        _In_ DXGI_COLOR_SPACE_TYPE const inputColorSpace,
+        _In_ uint32_t outputWidth,
+        _In_ uint32_t outputHeight,
+        _In_ DXGI_COLOR_SPACE_TYPE const outputColorSpace,
+        _Out_ winrt::com_ptr<VideoProcessor>& videoProcessor);
+
+    VideoProcessor();
+    virtual ~VideoProcessor();
+
+    HRESULT Blt(
+        _In_ winrt::com_ptr<ID3D11DeviceContext> const& d3dDeviceContext,
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& source,
+        _In_ uint32_t sourceArraySlice,
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& target);
+
+    // only sourceRect of the input, scaled to the whole output
+    HRESULT Blt(
+        _In_ winrt::com_ptr<ID3D11DeviceContext> const& d3dDeviceContext,
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& source,
+        _In_ uint32_t sourceArraySlice,
+        _In_ RECT const& sourceRect,
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& target);
+
+    uint32_t InputWidth() const { return m_inputWidth; }
+    uint32_t InputHeight() const { return m_inputHeight; }
+    uint32_t OutputWidth() const { return m_outputWidth; }
+    uint32_t OutputHeight() const { return m_outputHeight; }
+
+    void Reset();
+
+private:
+    HRESULT GetInputView(
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& source,
+        _In_ uint32_t arraySlice,
+        _Out_ winrt::com_ptr<ID3D11VideoProcessorInputView>& inputView);
+    HRESULT GetOutputView(
+        _In_ winrt::com_ptr<ID3D11Texture2D> const& target,
+        _Out_ winrt::com_ptr<ID3D11VideoProcessorOutputView>& outputView);
+
+private:
+    struct InputView
+    {
+        ID3D11Texture2D* texture;
+        uint32_t arraySlice;
+        winrt::com_ptr<ID3D11VideoProcessorInputView> view;
+    };
+
+    struct OutputView
+    {
+        ID3D11Texture2D* texture;
+        winrt::com_ptr<ID3D11VideoProcessorOutputView> view;
+    };
+
+    uint32_t m_inputWidth;
+    uint32_t m_inputHeight;
+    uint32_t m_outputWidth;
+    uint32_t m_outputHeight;
+    DXGI_COLOR_SPACE_TYPE m_inputColorSpace;
+    DXGI_COLOR_SPACE_TYPE m_outputColorSpace;
+
+    winrt::com_ptr<ID3D11VideoDevice> m_videoDevice;
+    winrt::com_ptr<ID3D11VideoProcessorEnumerator> m_videoProcessorEnum;
+    winrt::com_ptr<ID3D11VideoProcessor> m_videoProcessor;
+
+    // the capture pipeline and the texture ring recycle the same textures,
+    // views hold a reference to their resource so the pointers stay valid
+    std::vector<InputView> m_inputViews;
+    std::vector<OutputView> m_outputViews;
+};
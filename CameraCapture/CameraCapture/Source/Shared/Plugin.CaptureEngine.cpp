@@ -6,6 +6,7 @@
 #include "Plugin.CaptureEngine.g.cpp"
 
 #include "Media.Functions.h"
+#include "Media.DeviceCache.h"
 #include "Media.Payload.h"
 #include "Media.Capture.MrcAudioEffect.h"
 #include "Media.Capture.MrcVideoEffect.h"
@@ -29,11 +30,14 @@ _Use_decl_annotations_
 CameraCapture::Plugin::Module CaptureEngine::Create(
 	std::weak_ptr<IUnityDeviceResource> const& unityDevice,
 	StateChangedCallback fnCallback,
-	void* pCallbackObject)
+	void* pCallbackObject,
+	hstring const& videoDeviceId)
 {
 	auto capture = CameraCapture::Plugin::CaptureEngine();
 	if (SUCCEEDED(capture.as<IModulePriv>()->Initialize(unityDevice, fnCallback, pCallbackObject)))
 	{
+		get_self<CaptureEngine>(capture)->m_videoDeviceId = videoDeviceId;
+
 		return capture;
 	}
 
@@ -45,26 +49,89 @@ CaptureEngine::CaptureEngine()
 	, m_startPreviewEventHandle(CreateEvent(nullptr, true, true, nullptr))
 	, m_stopPreviewEventHandle(CreateEvent(nullptr, true, true, nullptr))
 	, m_takePhotoEventHandle(CreateEvent(nullptr, true, true, nullptr))
+	, m_sharedMediaDevice(nullptr)
+	, m_deviceLostToken()
+	, m_mediaDeviceLost(false)
 	, m_mediaDevice(nullptr)
 	, m_dxgiDeviceManager(nullptr)
+	, m_videoDeviceId()
 	, m_category(MediaCategory::Communications)
 	, m_streamType(MediaStreamType::VideoPreview)
 	, m_videoProfile(KnownVideoProfile::VideoConferencing)
 	, m_sharingMode(MediaCaptureSharingMode::ExclusiveControl)
 	, m_startPreviewOp(nullptr)
 	, m_stopPreviewOp(nullptr)
+	, m_setResolutionOp(nullptr)
 	, m_mediaCapture(nullptr)
 	, m_initSettings(nullptr)
+	, m_keepWarm(false)
+	, m_isWarm(false)
+	, m_captureWidth(0)
+	, m_captureHeight(0)
+	, m_captureAudio(false)
+	, m_captureFormat(PreviewFormat::Bgra8)
+	, m_encodingProfile(nullptr)
+	, m_useSyntheticSource(false)
+	, m_syntheticFrameRate(30)
+	, m_syntheticJitterMs(0)
+	, m_syntheticSource(nullptr)
 	, m_mrcAudioEffect(nullptr)
 	, m_mrcVideoEffect(nullptr)
 	, m_mrcPreviewEffect(nullptr)
 	, m_mediaSink(nullptr)
 	, m_payloadHandler(nullptr)
 	, m_audioSample(nullptr)
-	, m_sharedVideoTexture(nullptr)
+	, m_audioBufferLength(0)
+	, m_audioRingBuffer(nullptr)
+	, m_targetFrameRate(0)
+	, m_sampleRequests(0)
+	, m_videoTextureCount(1)
+	, m_textureSync(TextureSyncMode::None)
+	, m_previewFormat(PreviewFormat::Bgra8)
+	, m_videoProcessor(nullptr)
+	, m_region()
+	, m_cropProcessor(nullptr)
+	, m_videoTextureRing(nullptr)
+	, m_pendingVideoTextureRing(nullptr)
+	, m_gpuSampleCopies(0)
+	, m_cpuSampleCopies(0)
+	, m_intrinsicsMediaType(nullptr)
+	, m_intrinsics()
+	, m_zeroCopy(false)
+	, m_frameSample(nullptr)
+	, m_previousFrameSample(nullptr)
+	, m_streamCodec(VideoCodec::H264)
+	, m_streamBitrate(0)
+	, m_fnStreamCallback(nullptr)
+	, m_streamCallbackObject(nullptr)
+	, m_videoEncoder(nullptr)
+	, m_frameTapWidth(0)
+	, m_frameTapHeight(0)
+	, m_fnFrameTapCallback(nullptr)
+	, m_frameTapCallbackObject(nullptr)
+	, m_frameTap(nullptr)
+	, m_frameSource(nullptr)
+	, m_frameSequence(0)
+	, m_frameTexture(nullptr)
+	, m_renderSequence(0)
+	, m_renderTexture(nullptr)
 	, m_photoTexture(nullptr)
 	, m_photoTextureSRV(nullptr)
 	, m_photoSample(nullptr)
+	, m_photoTextureBytes(0)
+	, m_photoMode(PhotoMode::Capture)
+	, m_grabPhoto(false)
+	, m_grabTexture(nullptr)
+	, m_fnPhotoCallback(nullptr)
+	, m_photoCallbackObject(nullptr)
+	, m_encodedPhoto(nullptr)
+	, m_encodedPhotoWidth(0)
+	, m_encodedPhotoHeight(0)
+	, m_burstFrameCount(0)
+	, m_fnBurstCallback(nullptr)
+	, m_burstCallbackObject(nullptr)
+	, m_burstTexture(nullptr)
+	, m_burstFrameTexture(nullptr)
 {
 }
 
@@ -95,7 +162,12 @@ void CaptureEngine::Shutdown()
 			}).get();
 	}
 
-	if (m_mediaCapture != nullptr)
+	StopFrameSource();
+
+	// stop preview releases a warm device too
+	m_keepWarm = false;
+
+	if (m_mediaCapture != nullptr || m_syntheticSource != nullptr)
 	{
 		StopPreview();
 	}
@@ -124,13 +196,65 @@ void CaptureEngine::Shutdown()
 	Module::Shutdown();
 }
 
-hresult CaptureEngine::StartPreview(uint32_t width, uint32_t height, bool enableAudio, bool enableMrc)
+void CaptureEngine::OnRenderEvent(uint16_t frameNumber)
+{
+	Module::OnRenderEvent(frameNumber);
+
+	auto guard = m_cs.Guard();
+
+	if (m_isShutdown)
+	{
+		return;
+	}
+
+	// hands its own textures over, it runs at a different rate than the preview
+	if (m_frameSource != nullptr)
+	{
+		m_frameSource->OnRenderEvent();
+	}
+
+	if (m_renderSequence == m_frameSequence)
+	{
+		return;
+	}
+
+	// the same slot came back, it has to be handed over before it can be taken again
+	if (m_renderTexture != nullptr && m_renderTexture == m_frameTexture)
+	{
+		m_renderTexture->EndFrameRead();
+
+		m_renderTexture = nullptr;
+	}
+
+	// never wait on the render thread, the media device still owns the newest frame,
+	// keep drawing the one we hold and try again on the next event
+	if (m_frameTexture != nullptr && FAILED(m_frameTexture->BeginFrameRead(SHARED_TEXTURE_SYNC_TIMEOUT_MS)))
+	{
+		return;
+	}
+
+	// the newest frame is ours, the previous one goes back to the media device right away
+	if (m_renderTexture != nullptr)
+	{
+		m_renderTexture->EndFrameRead();
+	}
+
+	m_renderTexture = m_frameTexture;
+	m_renderSequence = m_frameSequence;
+}
+
+hresult CaptureEngine::StartPreview(uint32_t width, uint32_t height, bool enableAudio, bool enableMrc, uint32_t textureCount, uint32_t sampleRequests)
 {
 	if (m_startPreviewOp != nullptr)
 	{
 		IFR(E_ABORT);
 	}
 
+	if (textureCount > MAX_SHARED_TEXTURES || sampleRequests > MAX_SAMPLE_REQUESTS)
+	{
+		IFR(E_INVALIDARG);
+	}
+
 	if (m_stopPreviewOp != nullptr && m_stopPreviewOp.Status() == AsyncStatus::Started)
 	{
 		concurrency::create_task([this]()
@@ -149,15 +273,26 @@ hresult CaptureEngine::StartPreview(uint32_t width, uint32_t height, bool enable
 
 	ResetEvent(m_startPreviewEventHandle.get());
 
-	IFR(CreateDeviceResources());
-
-	if (m_sharedVideoTexture != nullptr)
+	// nothing holds the removed device's manager anymore
+	if (m_mediaDeviceLost && m_mediaCapture == nullptr)
 	{
-		m_sharedVideoTexture->Reset();
+		ReleaseDeviceResources();
 
-		m_sharedVideoTexture = nullptr;
+		m_mediaDeviceLost = false;
 	}
 
+	IFR(CreateDeviceResources());
+
+	ReleaseVideoTextures();
+
+	// 0 keeps a single texture that is overwritten every frame
+	m_videoTextureCount = textureCount > 0 ? textureCount : 1;
+
+	// picked up when the sink is created
+	m_sampleRequests = sampleRequests;
+
+	m_latencyStats.Clear();
+
 	m_startPreviewOp = StartPreviewCoroutine(width, height, enableAudio, enableMrc);
 	m_startPreviewOp.Completed([this, strong = get_strong()](auto const& result, auto const& status)
 		{
@@ -244,6 +379,57 @@ hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc
 		IFR(E_ABORT);
 	}
 
+	// picked up by the next preview frame, the size is the preview size
+	if (m_photoMode == PhotoMode::PreviewFrame)
+	{
+		auto guard = m_cs.Guard();
+
+		NULL_CHK_HR(m_mediaSink, MF_E_INVALIDREQUEST);
+
+		if (m_grabPhoto)
+		{
+			IFR(E_ABORT);
+		}
+
+		m_grabPhoto = true;
+
+		return S_OK;
+	}
+
+	return StartTakePhoto(width, height, enableMrc);
+}
+
+hresult CaptureEngine::TakeJpegPhoto(uint32_t width, uint32_t height, bool enableMrc, EncodedPhotoCallback fnCallback, void* pCallbackObject)
+{
+	NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+	if (m_takePhotoOp)
+	{
+		IFR(E_ABORT);
+	}
+
+	{
+		auto guard = m_cs.Guard();
+
+		m_fnPhotoCallback = fnCallback;
+		m_photoCallbackObject = pCallbackObject;
+	}
+
+	// always the photo stream, the preview frames aren't encoded
+	hresult hr = StartTakePhoto(width, height, enableMrc);
+	if (FAILED(hr))
+	{
+		auto guard = m_cs.Guard();
+
+		m_fnPhotoCallback = nullptr;
+		m_photoCallbackObject = nullptr;
+	}
+
+	return hr;
+}
+
+hresult CaptureEngine::StartTakePhoto(uint32_t width, uint32_t height, bool enableMrc)
+{
 	if (m_stopPreviewOp != nullptr && m_stopPreviewOp.Status() == AsyncStatus::Started)
 	{
 		concurrency::create_task([this]()
@@ -269,10 +455,37 @@ hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc
 		{
 			m_takePhotoOp = nullptr;
 
+			EncodedPhotoCallback fnPhotoCallback = nullptr;
+			void* photoCallbackObject = nullptr;
+			Windows::Storage::Streams::IBuffer encodedPhoto = nullptr;
+			uint32_t encodedWidth = 0, encodedHeight = 0;
+			{
+				auto guard = m_cs.Guard();
+
+				fnPhotoCallback = m_fnPhotoCallback;
+				photoCallbackObject = m_photoCallbackObject;
+				encodedPhoto = m_encodedPhoto;
+				encodedWidth = m_encodedPhotoWidth;
+				encodedHeight = m_encodedPhotoHeight;
+
+				m_fnPhotoCallback = nullptr;
+				m_photoCallbackObject = nullptr;
+				m_encodedPhoto = nullptr;
+			}
+
 			if (status == AsyncStatus::Error)
 			{
 				Failed(result.ErrorCode());
 			}
+			else if (status == AsyncStatus::Completed && fnPhotoCallback != nullptr)
+			{
+				// outside the lock, the callback can take the next photo
+				uint8_t* data = nullptr;
+				if (encodedPhoto != nullptr && SUCCEEDED(encodedPhoto.as<IBufferByteAccess>()->Buffer(&data)))
+				{
+					fnPhotoCallback(photoCallbackObject, data, encodedPhoto.Length(), encodedWidth, encodedHeight);
+				}
+			}
 			else if (status == AsyncStatus::Completed)
 			{
 				CALLBACK_STATE state{};
@@ -287,7 +500,7 @@ hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc
 				// Set state values
 				state.value.captureState.width = m_photoTextureDesc.Width;
 				state.value.captureState.height = m_photoTextureDesc.Height;
-				state.value.captureState.texturePtr = m_photoTextureSRV.get();
+				state.value.captureState.texturePtr = GetUnityTexture(m_photoTextureSRV.get());
 
 				Callback(state);
 			}
@@ -296,744 +509,2506 @@ hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc
 	return S_OK;
 }
 
-CameraCapture::Media::PayloadHandler CaptureEngine::PayloadHandler()
-{
-	auto guard = m_cs.Guard();
-
-	return m_payloadHandler;
-}
-void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& value)
+hresult CaptureEngine::TakeBurst(uint32_t frameCount, BurstCallback fnCallback, void* pCallbackObject)
 {
-	auto strong = get_strong();
+	NULL_CHK_HR(fnCallback, E_INVALIDARG);
 
-	m_payloadHandler = value;
-
-	if (m_mediaSink != nullptr)
+	if (frameCount < 1 || frameCount > MAX_BURST_FRAMES)
 	{
-		m_mediaSink.PayloadHandler(m_payloadHandler);
+		IFR(E_INVALIDARG);
 	}
 
-	m_payloadEventRevoker = m_payloadHandler.OnStreamPayload(winrt::auto_revoke, [this, strong](auto const sender, Media::Payload const& payload)
-		{
-			auto guard = m_cs.Guard();
-
-			if (m_isShutdown)
-			{
-				return;
-			}
-
-			if (sender != m_payloadHandler)
-			{
-				return;
-			}
-
-			if (payload == nullptr)
-			{
-				return;
-			}
-
-			GUID majorType = GUID_NULL;
-
-			auto mediaStreamSample = payload.MediaStreamSample();
-			if (mediaStreamSample != nullptr)
-			{
-				auto type = mediaStreamSample.ExtendedProperties().TryLookup(MF_MT_MAJOR_TYPE);
-				if (type != nullptr)
-				{
-					majorType = winrt::unbox_value<guid>(type);
-				}
-			}
-
-			auto streamSample = payload.as<IStreamSample>();
-			if (streamSample == nullptr)
-			{
-				return;
-			}
+	auto guard = m_cs.Guard();
 
-			if (MFMediaType_Audio == majorType)
-			{
-				if (m_audioSample == nullptr)
-				{
-					DWORD bufferSize = 0;
-					IFV(streamSample->Sample()->GetTotalLength(&bufferSize));
+	// frames come from the running preview
+	NULL_CHK_HR(m_mediaSink, MF_E_INVALIDREQUEST);
 
-					com_ptr<IMFMediaBuffer> dstBuffer = nullptr;
-					IFV(MFCreateMemoryBuffer(bufferSize, dstBuffer.put()));
+	if (m_fnBurstCallback != nullptr)
+	{
+		IFR(E_ABORT);
+	}
 
-					com_ptr<IMFSample> dstSample = nullptr;
-					IFV(MFCreateSample(dstSample.put()));
+	m_burstFrameCount = frameCount;
+	m_burstFrames.clear();
+	m_burstFrames.reserve(frameCount);
+	m_fnBurstCallback = fnCallback;
+	m_burstCallbackObject = pCallbackObject;
 
-					IFV(dstSample->AddBuffer(dstBuffer.get()));
+	return S_OK;
+}
 
-					m_audioSample.attach(dstSample.detach());
-				}
+hresult CaptureEngine::ReleaseFrame(uint32_t textureIndex)
+{
+	auto guard = m_cs.Guard();
 
-				IFV(CopySample(MFMediaType_Audio, streamSample->Sample(), m_audioSample));
+	NULL_CHK_HR(m_videoTextureRing, MF_E_NOT_INITIALIZED);
 
-				CALLBACK_STATE state{};
-				ZeroMemory(&state, sizeof(CALLBACK_STATE));
+	return m_videoTextureRing->Release(textureIndex);
+}
 
-				state.type = CallbackType::Capture;
+// a newer video frame supersedes the one of the same stream still waiting, the client only wants the latest
+_Use_decl_annotations_
+bool CaptureEngine::IsSuperseded(CALLBACK_STATE const& queued, CALLBACK_STATE const& state)
+{
+	if (state.type != CallbackType::Capture || queued.type != CallbackType::Capture)
+	{
+		return false;
+	}
 
-				ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+	auto stateType = state.value.captureState.stateType;
+	if (stateType != CaptureStateType::PreviewVideoFrame && stateType != CaptureStateType::DepthVideoFrame && stateType != CaptureStateType::InfraredVideoFrame)
+	{
+		return false;
+	}
 
-				state.value.captureState.stateType = CaptureStateType::PreviewAudioFrame;
-				//state.value.captureState.width = 0;
-				//state.value.captureState.height = 0;
-				//state.value.captureState.texturePtr = nullptr;
-				Callback(state);
-			}
-			else if (MFMediaType_Video == majorType)
-			{
-				boolean bufferChanged = false;
+	return queued.value.captureState.stateType == stateType;
+}
 
-				auto videoProps = payload.EncodingProperties().as<IVideoEncodingProperties>();
+// a preview frame coalesced away in polled mode still holds its ring slot
+_Use_decl_annotations_
+void CaptureEngine::OnStateDropped(CALLBACK_STATE const& state)
+{
+	if (state.type != CallbackType::Capture || state.value.captureState.textureIndex == UINT32_MAX)
+	{
+		return;
+	}
 
-				if (m_sharedVideoTexture == nullptr
-					||
-					m_sharedVideoTexture->frameTexture == nullptr
-					||
-					m_sharedVideoTexture->frameTextureDesc.Width != videoProps.Width()
-					||
-					m_sharedVideoTexture->frameTextureDesc.Height != videoProps.Height())
-				{
-					auto resources = m_d3d11DeviceResources.lock();
-					NULL_CHK_R(resources);
+	auto stateType = state.value.captureState.stateType;
 
-					// make sure we have created our own d3d device
-					IFV(CreateDeviceResources());
+	auto guard = m_cs.Guard();
 
-					IFV(SharedTexture::Create(resources->GetDevice(), m_dxgiDeviceManager, videoProps.Width(), videoProps.Height(), m_sharedVideoTexture));
+	if (stateType == CaptureStateType::PreviewVideoFrame && m_videoTextureRing != nullptr)
+	{
+		m_videoTextureRing->Release(state.value.captureState.textureIndex);
+	}
+	else if ((stateType == CaptureStateType::DepthVideoFrame || stateType == CaptureStateType::InfraredVideoFrame) && m_frameSource != nullptr)
+	{
+		m_frameSource->Release(state.value.captureState.textureIndex);
+	}
+}
 
-					bufferChanged = true;
-				}
+hresult CaptureEngine::SetTextureSync(int32_t syncMode)
+{
+	if (syncMode < static_cast<int32_t>(TextureSyncMode::None) || syncMode > static_cast<int32_t>(TextureSyncMode::Fence))
+	{
+		IFR(E_INVALIDARG);
+	}
 
-				// copy the data
-				IFV(CopySample(MFMediaType_Video, streamSample->Sample(), m_sharedVideoTexture->mediaSample));
+	auto guard = m_cs.Guard();
 
-				// did the texture description change, if so, raise callback
-				CALLBACK_STATE state{};
-				ZeroMemory(&state, sizeof(CALLBACK_STATE));
+	// takes effect when the preview textures are created
+	m_textureSync = static_cast<TextureSyncMode>(syncMode);
 
-				state.type = CallbackType::Capture;
+	return S_OK;
+}
 
-				ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+hresult CaptureEngine::SetPreviewFormat(int32_t previewFormat)
+{
+	if (previewFormat < static_cast<int32_t>(PreviewFormat::Bgra8) || previewFormat > static_cast<int32_t>(PreviewFormat::Nv12))
+	{
+		IFR(E_INVALIDARG);
+	}
 
-				state.value.captureState.stateType = CaptureStateType::PreviewVideoFrame;
-				state.value.captureState.width = m_sharedVideoTexture->frameTextureDesc.Width;
-				state.value.captureState.height = m_sharedVideoTexture->frameTextureDesc.Height;
-				state.value.captureState.texturePtr = m_sharedVideoTexture->frameTextureSRV.get();
-				if (m_payloadHandler.ProceesTranform(payload))
-				{
-					state.value.captureState.worldMatrix = payload.CameraToWorld();
-					state.value.captureState.projectionMatrix = payload.CameraProjection();
+	auto guard = m_cs.Guard();
 
-					bufferChanged = true;
-				}
+	// takes effect on the next StartPreview
+	m_previewFormat = static_cast<PreviewFormat>(previewFormat);
 
-				// Send the callback every frame
-				Callback(state);
-			}
-		});
+	return S_OK;
 }
 
-CameraCapture::Media::Capture::Sink CaptureEngine::MediaSink()
+hresult CaptureEngine::SetZeroCopy(bool enable)
 {
 	auto guard = m_cs.Guard();
 
-	return m_mediaSink;
+	// samples that can't be shared keep using the texture ring
+	m_zeroCopy = enable;
+
+	return S_OK;
 }
 
-// private
-hresult CaptureEngine::CreateDeviceResources()
+hresult CaptureEngine::SetKeepWarm(bool enable)
 {
-	if (m_mediaDevice != nullptr && m_dxgiDeviceManager != nullptr)
 	{
-		return S_OK;
-	}
+		auto guard = m_cs.Guard();
 
-	// get the adapter from an existing d3dDevice
-	auto resources = m_d3d11DeviceResources.lock();
-	NULL_CHK_HR(resources, MF_E_UNEXPECTED);
+		m_keepWarm = enable;
 
-	com_ptr<IDXGIAdapter> dxgiAdapter = nullptr;
-	com_ptr<IDXGIDevice> dxgiDevice = resources->GetDevice().try_as<IDXGIDevice>();
-	if (dxgiDevice != nullptr)
-	{
-		IFR(dxgiDevice->GetAdapter(dxgiAdapter.put()));
+		if (enable || !m_isWarm)
+		{
+			return S_OK;
+		}
 	}
 
-	com_ptr<ID3D11Device> mediaDevice = nullptr;
-	IFR(CreateMediaDevice(dxgiAdapter.get(), mediaDevice.put()));
-
-	// create DXGIManager
-	uint32_t resetToken;
-	com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager = nullptr;
-	IFR(MFCreateDXGIDeviceManager(&resetToken, dxgiDeviceManager.put()));
-
-	// associate device with dxgiManager
-	IFR(dxgiDeviceManager->ResetDevice(mediaDevice.get(), resetToken));
-
-	// success, store the values
-	m_mediaDevice.attach(mediaDevice.detach());
-	m_dxgiDeviceManager.attach(dxgiDeviceManager.detach());
-	m_resetToken = resetToken;
-
-	return S_OK;
+	// nothing is streaming, stopping only releases the warm device
+	return StopPreview();
 }
 
-void CaptureEngine::ReleaseDeviceResources()
+hresult CaptureEngine::SetSyntheticSource(bool enable, uint32_t frameRate, uint32_t jitterMs)
 {
-	if (m_audioSample != nullptr)
+	if (enable && (frameRate < 1 || frameRate > 240 || jitterMs > 1000))
 	{
-		m_audioSample = nullptr;
+		IFR(E_INVALIDARG);
 	}
 
-	if (m_sharedVideoTexture != nullptr)
-	{
-		m_sharedVideoTexture->Reset();
+	auto guard = m_cs.Guard();
 
-		m_sharedVideoTexture = nullptr;
-	}
+	// picked up by the next StartPreview
+	m_useSyntheticSource = enable;
+	m_syntheticFrameRate = frameRate;
+	m_syntheticJitterMs = jitterMs;
 
-	if (m_photoTexture != nullptr)
-	{
-		m_photoTexture = nullptr;
-	}
+	return S_OK;
+}
 
-	if (m_photoTextureSRV != nullptr)
+hresult CaptureEngine::StartFrameSource(FrameSourceKind sourceKind, Windows::Perception::Spatial::SpatialCoordinateSystem const& appCoordinateSystem)
+{
+	com_ptr<FrameReaderStream> frameSource = nullptr;
 	{
-		m_photoTextureSRV = nullptr;
-	}
+		auto guard = m_cs.Guard();
 
-	if (m_dxgiDeviceManager != nullptr)
-	{
-		if (m_mediaDevice != nullptr)
+		if (m_isShutdown)
 		{
-			m_dxgiDeviceManager->ResetDevice(nullptr, m_resetToken);
+			IFR(MF_E_SHUTDOWN);
+		}
 
-			m_mediaDevice = nullptr;
+		if (m_frameSource != nullptr)
+		{
+			IFR(E_ABORT);
 		}
 
-		m_dxgiDeviceManager = nullptr;
-	}
+		IFR(CreateDeviceResources());
 
-	if (m_mediaDevice != nullptr)
-	{
-		m_mediaDevice = nullptr;
-	}
-}
+		IFR(FrameReaderStream::Create(m_d3d11DeviceResources, m_dxgiDeviceManager, sourceKind, m_textureSync,
+			[weak = get_weak()](CAPTURE_STATE& captureState, ID3D11ShaderResourceView* textureSRV)
+			{
+				if (auto strong = weak.get())
+				{
+					strong->OnSourceFrame(captureState, textureSRV);
+				}
+			}, frameSource));
+
+		frameSource->AppCoordinateSystem(appCoordinateSystem);
+
+		m_frameSource = frameSource;
+	}
+
+	// the device opens off this thread, a failure is raised as a failed state
+	auto startOp = frameSource->StartAsync(m_videoDeviceId);
+	startOp.Completed([this, strong = get_strong(), frameSource](auto const& result, auto const& status)
+		{
+			if (status != AsyncStatus::Error)
+			{
+				return;
+			}
+
+			{
+				auto guard = m_cs.Guard();
+
+				if (m_frameSource == frameSource)
+				{
+					m_frameSource = nullptr;
+				}
+			}
+
+			frameSource->Close();
+
+			Failed(result.ErrorCode());
+		});
+
+	return S_OK;
+}
+
+hresult CaptureEngine::StopFrameSource()
+{
+	com_ptr<FrameReaderStream> frameSource = nullptr;
+	{
+		auto guard = m_cs.Guard();
+
+		frameSource = m_frameSource;
+		m_frameSource = nullptr;
+	}
+
+	// outside the lock, closing waits on a frame that may be raising its state
+	if (frameSource != nullptr)
+	{
+		frameSource->Close();
+	}
+
+	return S_OK;
+}
+
+hresult CaptureEngine::ReleaseSourceFrame(uint32_t textureIndex)
+{
+	auto guard = m_cs.Guard();
+
+	NULL_CHK_HR(m_frameSource, MF_E_NOT_INITIALIZED);
+
+	return m_frameSource->Release(textureIndex);
+}
+
+void CaptureEngine::FrameSourceCoordinateSystem(Windows::Perception::Spatial::SpatialCoordinateSystem const& value)
+{
+	auto guard = m_cs.Guard();
+
+	if (m_frameSource != nullptr)
+	{
+		m_frameSource->AppCoordinateSystem(value);
+	}
+}
+
+hresult CaptureEngine::SetPhotoMode(int32_t photoMode)
+{
+	if (photoMode < static_cast<int32_t>(PhotoMode::Capture) || photoMode > static_cast<int32_t>(PhotoMode::PreviewFrame))
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_cs.Guard();
+
+	m_photoMode = static_cast<PhotoMode>(photoMode);
+	m_grabPhoto = false;
+
+	return S_OK;
+}
+
+hresult CaptureEngine::SetTargetFrameRate(uint32_t framesPerSecond)
+{
+	auto guard = m_cs.Guard();
+
+	m_targetFrameRate = framesPerSecond;
+
+	// a running preview switches on the next sample
+	if (m_mediaSink != nullptr)
+	{
+		ApplySinkProperties(m_mediaSink);
+	}
+
+	return S_OK;
+}
+
+hresult CaptureEngine::SetPreviewResolution(uint32_t width, uint32_t height)
+{
+	if (width < 2 || height < 2)
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_cs.Guard();
+
+	if (m_setResolutionOp != nullptr)
+	{
+		IFR(E_ABORT);
+	}
+
+	// a running camera stream, the synthetic source has no controller and a recording keeps its size
+	NULL_CHK_HR(m_mediaSink, MF_E_INVALIDREQUEST);
+	NULL_CHK_HR(m_mediaCapture, MF_E_INVALIDREQUEST);
+	if (m_initSettings.SharingMode() != MediaCaptureSharingMode::ExclusiveControl || get_self<Sink>(m_mediaSink)->IsRecording())
+	{
+		IFR(MF_E_INVALIDREQUEST);
+	}
+
+	auto videoController = m_mediaCapture.VideoDeviceController();
+	auto videoEncProps = GetVideoDeviceProperties(videoController, m_streamType, width, height, MediaEncodingSubtypes::Nv12());
+	NULL_CHK_HR(videoEncProps, MF_E_INVALIDMEDIATYPE);
+
+	// the closest the camera has, the sink keeps converting to the subtype it was started with
+	auto videoProps = videoEncProps.as<IVideoEncodingProperties>();
+	auto sinkProps = m_mediaSink.EncodingProfile().Video();
+
+	bool isNv12Sample = _wcsicmp(sinkProps.Subtype().c_str(), MediaEncodingSubtypes::Nv12().c_str()) == 0;
+
+	DXGI_FORMAT textureFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+	if (isNv12Sample && m_previewFormat == PreviewFormat::Nv12)
+	{
+		textureFormat = DXGI_FORMAT_NV12;
+	}
+
+	RECT cropRect{};
+	uint32_t frameWidth = videoProps.Width();
+	uint32_t frameHeight = videoProps.Height();
+	bool cropFrame = GetRegionRect(videoProps.Width(), videoProps.Height(), textureFormat == DXGI_FORMAT_NV12, cropRect, frameWidth, frameHeight);
+
+	// out of the texture pool now, the frame that brings the new size only swaps it in. zero copy
+	// frames never go through the ring
+	if (!(m_zeroCopy && !cropFrame && (!isNv12Sample || textureFormat == DXGI_FORMAT_NV12)))
+	{
+		auto resources = m_d3d11DeviceResources.lock();
+		NULL_CHK_HR(resources, MF_E_NOT_INITIALIZED);
+
+		IFR(CreateDeviceResources());
+
+		if (m_pendingVideoTextureRing != nullptr)
+		{
+			m_pendingVideoTextureRing->Reset();
+
+			m_pendingVideoTextureRing = nullptr;
+		}
+
+		IFR(SharedTextureRing::Create(resources->GetDevice(), m_dxgiDeviceManager, frameWidth, frameHeight, GetVideoTextureCount(), textureFormat, m_textureSync, m_pendingVideoTextureRing));
+	}
+
+	// the sink keeps running, the payload handler sees the new size once the new media type arrives
+	m_setResolutionOp = videoController.SetMediaStreamPropertiesAsync(m_streamType, videoEncProps);
+	m_setResolutionOp.Completed([this, strong = get_strong(), width, height](auto const& result, auto const& status)
+		{
+			auto guard = m_cs.Guard();
+
+			m_setResolutionOp = nullptr;
+
+			if (status == AsyncStatus::Error)
+			{
+				if (m_pendingVideoTextureRing != nullptr)
+				{
+					m_pendingVideoTextureRing->Reset();
+
+					m_pendingVideoTextureRing = nullptr;
+				}
+
+				Failed(result.ErrorCode());
+			}
+			else if (status == AsyncStatus::Completed)
+			{
+				// a warm start at this size reuses the device setup, any other size sets it up again
+				m_captureWidth = width;
+				m_captureHeight = height;
+				m_encodingProfile = nullptr;
+			}
+		});
+
+	return S_OK;
+}
+
+hresult CaptureEngine::GetSampleQueueOccupancy(float& averageOccupancy)
+{
+	averageOccupancy = 0.0f;
+
+	auto guard = m_cs.Guard();
+
+	NULL_CHK_HR(m_mediaSink, MF_E_NOT_INITIALIZED);
+
+	averageOccupancy = get_self<Sink>(m_mediaSink)->VideoQueueOccupancy();
+
+	return S_OK;
+}
+
+hresult CaptureEngine::SetAudioBufferLength(uint32_t milliseconds)
+{
+	if (milliseconds > MAX_AUDIO_BUFFER_MS)
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_cs.Guard();
+
+	// 0 keeps the PreviewAudioFrame callback per packet
+	m_audioBufferLength = milliseconds;
+
+	return S_OK;
+}
+
+hresult CaptureEngine::GetAudioFormat(uint32_t& sampleRate, uint32_t& channelCount)
+{
+	auto audioGuard = m_audioCs.Guard();
+
+	NULL_CHK_HR(m_audioRingBuffer, MF_E_NOT_INITIALIZED);
+
+	sampleRate = m_audioRingBuffer->SampleRate();
+	channelCount = m_audioRingBuffer->ChannelCount();
+
+	return S_OK;
+}
+
+hresult CaptureEngine::ReadAudio(array_view<float> samples, uint32_t& samplesRead, int64_t& timestamp)
+{
+	samplesRead = 0;
+	timestamp = 0;
+
+	// only the pointer swap is locked, never the payload handler
+	com_ptr<AudioRingBuffer> ringBuffer = nullptr;
+	{
+		auto audioGuard = m_audioCs.Guard();
+
+		ringBuffer = m_audioRingBuffer;
+	}
+
+	// silence until the first packet arrived
+	if (ringBuffer == nullptr)
+	{
+		return S_OK;
+	}
+
+	LONGLONG sampleTime = 0;
+	samplesRead = ringBuffer->Read(samples.data(), samples.size(), &sampleTime);
+	timestamp = sampleTime;
+
+	return S_OK;
+}
+
+hresult CaptureEngine::StartRecording(hstring const& path)
+{
+	if (path.empty())
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_cs.Guard();
+
+	// records from the running preview, no second capture graph
+	NULL_CHK_HR(m_mediaSink, MF_E_INVALIDREQUEST);
+	NULL_CHK_HR(m_dxgiDeviceManager, MF_E_NOT_INITIALIZED);
+
+	return get_self<Sink>(m_mediaSink)->StartRecording(path.c_str(), m_dxgiDeviceManager);
+}
+
+hresult CaptureEngine::StopRecording()
+{
+	CameraCapture::Media::Capture::Sink mediaSink = nullptr;
+	{
+		auto guard = m_cs.Guard();
+
+		mediaSink = m_mediaSink;
+	}
+
+	NULL_CHK_HR(mediaSink, MF_E_INVALIDREQUEST);
+
+	// the payload handler keeps running while the file is closed
+	return get_self<Sink>(mediaSink)->StopRecording();
+}
+
+hresult CaptureEngine::StartStreaming(VideoCodec codec, uint32_t bitrate, EncodedFrameCallback fnCallback, void* pCallbackObject)
+{
+	NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+	if (codec < VideoCodec::H264 || codec > VideoCodec::Hevc || bitrate < 1)
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_cs.Guard();
+
+	// the encoder is created on the next video frame, once the size is known
+	if (m_videoEncoder != nullptr)
+	{
+		m_videoEncoder->Shutdown();
+
+		m_videoEncoder = nullptr;
+	}
+
+	m_streamCodec = codec;
+	m_streamBitrate = bitrate;
+	m_fnStreamCallback = fnCallback;
+	m_streamCallbackObject = pCallbackObject;
+
+	return S_OK;
+}
+
+hresult CaptureEngine::StopStreaming()
+{
+	auto guard = m_cs.Guard();
+
+	m_fnStreamCallback = nullptr;
+	m_streamCallbackObject = nullptr;
+
+	if (m_videoEncoder != nullptr)
+	{
+		m_videoEncoder->Shutdown();
+
+		m_videoEncoder = nullptr;
+	}
+
+	return S_OK;
+}
+
+hresult CaptureEngine::StartFrameTap(uint32_t width, uint32_t height, FrameTapCallback fnCallback, void* pCallbackObject)
+{
+	NULL_CHK_HR(fnCallback, E_INVALIDARG);
+
+	if (width < 2)
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_cs.Guard();
+
+	// created on the next video frame, once the input size is known
+	if (m_frameTap != nullptr)
+	{
+		m_frameTap->Reset();
+
+		m_frameTap = nullptr;
+	}
+
+	m_frameTapWidth = width;
+	m_frameTapHeight = height;
+	m_fnFrameTapCallback = fnCallback;
+	m_frameTapCallbackObject = pCallbackObject;
+
+	return S_OK;
+}
+
+hresult CaptureEngine::StopFrameTap()
+{
+	auto guard = m_cs.Guard();
+
+	m_fnFrameTapCallback = nullptr;
+	m_frameTapCallbackObject = nullptr;
+
+	if (m_frameTap != nullptr)
+	{
+		m_frameTap->Reset();
+
+		m_frameTap = nullptr;
+	}
+
+	return S_OK;
+}
+
+hresult CaptureEngine::GetStats(CAPTURE_STATS& stats)
+{
+	auto guard = m_cs.Guard();
+
+	m_latencyStats.Compute(stats);
+
+	return S_OK;
+}
+
+hresult CaptureEngine::GetIntrinsics(CAMERA_INTRINSICS& intrinsics)
+{
+	ZeroMemory(&intrinsics, sizeof(CAMERA_INTRINSICS));
+
+	auto guard = m_cs.Guard();
+
+	if (m_intrinsics.version == 0)
+	{
+		IFR(MF_E_ATTRIBUTENOTFOUND);
+	}
+
+	intrinsics = m_intrinsics;
+
+	return S_OK;
+}
+
+hresult CaptureEngine::SetRegionOfInterest(REGION_OF_INTEREST const& region)
+{
+	bool isEnabled = region.width > 0.0f && region.height > 0.0f;
+	if (isEnabled
+		&&
+		(region.x < 0.0f || region.y < 0.0f || region.width > 1.0f || region.height > 1.0f))
+	{
+		IFR(E_INVALIDARG);
+	}
+
+	auto guard = m_regionCs.Guard();
+
+	// the next frame is cropped, a new size recreates the ring
+	m_region = region;
+	if (!isEnabled)
+	{
+		ZeroMemory(&m_region, sizeof(REGION_OF_INTEREST));
+	}
+
+	return S_OK;
+}
+
+hresult CaptureEngine::GetSampleCopyCounts(uint64_t& gpuCopies, uint64_t& cpuCopies)
+{
+	auto guard = m_cs.Guard();
+
+	gpuCopies = m_gpuSampleCopies;
+	cpuCopies = m_cpuSampleCopies;
+
+	return S_OK;
+}
+
+CameraCapture::Media::PayloadHandler CaptureEngine::PayloadHandler()
+{
+	auto guard = m_cs.Guard();
+
+	return m_payloadHandler;
+}
+void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& value)
+{
+	auto strong = get_strong();
+
+	m_payloadHandler = value;
+
+	if (m_mediaSink != nullptr)
+	{
+		m_mediaSink.PayloadHandler(m_payloadHandler);
+	}
+
+	m_payloadEventRevoker = m_payloadHandler.OnStreamPayload(winrt::auto_revoke, [this, strong](auto const sender, Media::Payload const& payload)
+		{
+			auto guard = m_cs.Guard();
+
+			if (m_isShutdown)
+			{
+				return;
+			}
+
+			if (sender != m_payloadHandler)
+			{
+				return;
+			}
+
+			if (payload == nullptr)
+			{
+				return;
+			}
+
+			auto streamSample = payload.try_as<IStreamSample>();
+			if (streamSample == nullptr)
+			{
+				return;
+			}
+
+			// avoids creating the MediaStreamSample just to read the type
+			GUID majorType = streamSample->MajorType();
+
+			if (MFMediaType_Audio == majorType)
+			{
+				// unity pulls the pcm in bulk, no copy or callback per packet
+				if (m_audioBufferLength > 0 && SUCCEEDED(WriteAudioSample(payload, streamSample->Sample())))
+				{
+					return;
+				}
+
+				if (m_audioSample == nullptr)
+				{
+					DWORD bufferSize = 0;
+					IFV(streamSample->Sample()->GetTotalLength(&bufferSize));
+
+					com_ptr<IMFMediaBuffer> dstBuffer = nullptr;
+					IFV(MFCreateMemoryBuffer(bufferSize, dstBuffer.put()));
+
+					com_ptr<IMFSample> dstSample = nullptr;
+					IFV(MFCreateSample(dstSample.put()));
+
+					IFV(dstSample->AddBuffer(dstBuffer.get()));
+
+					m_audioSample.attach(dstSample.detach());
+				}
+
+				IFV(CopySample(MFMediaType_Audio, streamSample->Sample(), m_audioSample));
+
+				CALLBACK_STATE state{};
+				ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+				state.type = CallbackType::Capture;
+
+				ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+
+				state.value.captureState.stateType = CaptureStateType::PreviewAudioFrame;
+				//state.value.captureState.width = 0;
+				//state.value.captureState.height = 0;
+				//state.value.captureState.texturePtr = nullptr;
+				Callback(state);
+			}
+			else if (MFMediaType_Video == majorType)
+			{
+				boolean bufferChanged = false;
+
+				auto videoProps = payload.EncodingProperties().as<IVideoEncodingProperties>();
+
+				UpdateIntrinsics(streamSample, videoProps.Width(), videoProps.Height());
+
+				bool isNv12Sample = _wcsicmp(videoProps.Subtype().c_str(), MediaEncodingSubtypes::Nv12().c_str()) == 0;
+
+				// nv12 planes are only handed out as is when requested, otherwise the frame is converted
+				DXGI_FORMAT textureFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+				if (isNv12Sample && m_previewFormat == PreviewFormat::Nv12)
+				{
+					textureFormat = DXGI_FORMAT_NV12;
+				}
+
+				// the stream only loses this frame, preview continues
+				if (m_fnStreamCallback != nullptr)
+				{
+					HRESULT hrEncode = EncodeVideoSample(streamSample->Sample(), videoProps);
+
+					// no encoder for this format, stop instead of retrying every frame
+					if (FAILED(hrEncode) && m_videoEncoder == nullptr)
+					{
+						m_fnStreamCallback = nullptr;
+						m_streamCallbackObject = nullptr;
+
+						Failed(hrEncode);
+					}
+				}
+
+				// copies still in flight only delay the tap, preview continues
+				if (m_fnFrameTapCallback != nullptr)
+				{
+					HRESULT hrTap = TapVideoSample(streamSample->Sample(), videoProps);
+					if (FAILED(hrTap) && m_frameTap == nullptr)
+					{
+						m_fnFrameTapCallback = nullptr;
+						m_frameTapCallbackObject = nullptr;
+
+						Failed(hrTap);
+					}
+				}
+
+				// the photo is this frame, no photo stream setup or allocation per shot
+				if (m_photoMode == PhotoMode::PreviewFrame)
+				{
+					boolean grabRequested = m_grabPhoto;
+
+					HRESULT hrGrab = GrabPhotoFrame(streamSample->Sample(), videoProps, isNv12Sample);
+					if (FAILED(hrGrab) && grabRequested)
+					{
+						m_grabPhoto = false;
+
+						Failed(hrGrab);
+					}
+				}
+
+				// every burst frame gets its own array slice until the burst is full
+				if (m_fnBurstCallback != nullptr)
+				{
+					HRESULT hrBurst = BurstVideoSample(payload, streamSample, videoProps, isNv12Sample);
+					if (FAILED(hrBurst))
+					{
+						m_fnBurstCallback = nullptr;
+						m_burstCallbackObject = nullptr;
+
+						Failed(hrBurst);
+					}
+				}
+
+				// a region of interest is cropped and scaled on the media device, the ring is sized to it
+				RECT cropRect{};
+				uint32_t frameWidth = videoProps.Width();
+				uint32_t frameHeight = videoProps.Height();
+				bool cropFrame = GetRegionRect(videoProps.Width(), videoProps.Height(), textureFormat == DXGI_FORMAT_NV12, cropRect, frameWidth, frameHeight);
+
+				// unity samples the capture texture directly, no copy into the ring
+				if (m_zeroCopy && !cropFrame && (!isNv12Sample || textureFormat == DXGI_FORMAT_NV12))
+				{
+					com_ptr<SampleTexture> sampleTexture = nullptr;
+					if (SUCCEEDED(GetSampleTexture(streamSample->Sample(), videoProps.Width(), videoProps.Height(), sampleTexture)))
+					{
+						// unity can still be drawing the previous frame
+						m_previousFrameSample = m_frameSample;
+						m_frameSample = streamSample->Sample();
+
+						CALLBACK_STATE state{};
+						ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+						state.type = CallbackType::Capture;
+
+						ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+
+						state.value.captureState.stateType = CaptureStateType::PreviewVideoFrame;
+						state.value.captureState.width = sampleTexture->frameTextureDesc.Width;
+						state.value.captureState.height = sampleTexture->frameTextureDesc.Height;
+						state.value.captureState.texturePtr = GetUnityTexture(sampleTexture->frameTextureSRV.get());
+						state.value.captureState.textureIndex = UINT32_MAX; // not a ring slot
+						if (sampleTexture->frameChromaSRV != nullptr)
+						{
+							state.value.captureState.lumaTexturePtr = GetUnityTexture(sampleTexture->frameTextureSRV.get());
+							state.value.captureState.chromaTexturePtr = GetUnityTexture(sampleTexture->frameChromaSRV.get());
+						}
+						// straight into the callback struct, no projected property calls
+						if (m_payloadHandler.ProceesTranform(payload))
+						{
+							streamSample->GetTransformAndProjection(&state.value.captureState.worldMatrix, &state.value.captureState.projectionMatrix);
+						}
+
+						RecordFrameLatency(payload, state.value.captureState);
+
+						Callback(state);
+
+						return;
+					}
+				}
+
+				uint32_t textureCount = GetVideoTextureCount();
+				if (!IsTextureRingFor(m_videoTextureRing, textureCount, textureFormat, frameWidth, frameHeight))
+				{
+					auto resources = m_d3d11DeviceResources.lock();
+					NULL_CHK_R(resources);
+
+					// make sure we have created our own d3d device
+					IFV(CreateDeviceResources());
+
+					// a resolution change already allocated it, nothing is created on this frame
+					auto pendingRing = m_pendingVideoTextureRing;
+					m_pendingVideoTextureRing = nullptr;
+
+					ReleaseVideoTextures();
+
+					com_ptr<SharedTextureRing> textureRing = nullptr;
+					if (IsTextureRingFor(pendingRing, textureCount, textureFormat, frameWidth, frameHeight))
+					{
+						textureRing = pendingRing;
+					}
+					else
+					{
+						// still waiting for the frames at its size
+						m_pendingVideoTextureRing = pendingRing;
+					}
+
+					if (textureRing == nullptr)
+					{
+						IFV(SharedTextureRing::Create(resources->GetDevice(), m_dxgiDeviceManager, frameWidth, frameHeight, textureCount, textureFormat, m_textureSync, textureRing));
+					}
+
+					m_videoTextureRing = textureRing;
+
+					bufferChanged = true;
+				}
+
+				// every slot is still held by the consumer, drop the frame
+				uint32_t writeIndex = 0;
+				com_ptr<SharedTexture> writeTexture = nullptr;
+				if (FAILED(m_videoTextureRing->AcquireWrite(&writeIndex, writeTexture)))
+				{
+					return;
+				}
+
+				// the unity device still owns the texture, drop the frame
+				if (FAILED(writeTexture->BeginMediaWrite(SHARED_TEXTURE_SYNC_TIMEOUT_MS)))
+				{
+					m_videoTextureRing->Discard(writeIndex);
+
+					return;
+				}
+
+				// copy the data, nv12 samples are converted on the media device unless the planes are exposed
+				HRESULT hrCopy = S_OK;
+				if (cropFrame)
+				{
+					hrCopy = CropVideoSample(streamSample->Sample(), videoProps.Width(), videoProps.Height(), isNv12Sample, cropRect, writeTexture);
+				}
+				else if (isNv12Sample && textureFormat != DXGI_FORMAT_NV12)
+				{
+					hrCopy = ConvertVideoSample(streamSample->Sample(), writeTexture);
+				}
+				else
+				{
+					CopySamplePath copyPath = CopySamplePath::None;
+					hrCopy = CopySample(MFMediaType_Video, streamSample->Sample(), writeTexture->mediaSample, &copyPath);
+					if (copyPath == CopySamplePath::Gpu)
+					{
+						++m_gpuSampleCopies;
+					}
+					else if (copyPath == CopySamplePath::Cpu)
+					{
+						++m_cpuSampleCopies;
+					}
+				}
+
+				// release ownership or signal the fence so the unity device can read
+				writeTexture->EndMediaWrite();
+
+				if (FAILED(hrCopy))
+				{
+					m_videoTextureRing->Discard(writeIndex);
+
+					return;
+				}
+
+				streamSample->MarkStage(PayloadStage::Copied, QueryPerformanceTime());
+
+				IFV(m_videoTextureRing->Publish(writeIndex));
+
+				// hand the newest completed slot to the consumer, it stays untouched until released
+				uint32_t frameIndex = 0;
+				com_ptr<SharedTexture> frameTexture = nullptr;
+				IFV(m_videoTextureRing->AcquireLatest(&frameIndex, frameTexture));
+
+				// picked up by the next render event
+				m_frameTexture = frameTexture;
+				++m_frameSequence;
+
+				// did the texture description change, if so, raise callback
+				CALLBACK_STATE state{};
+				ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+				state.type = CallbackType::Capture;
+
+				ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+
+				state.value.captureState.stateType = CaptureStateType::PreviewVideoFrame;
+				state.value.captureState.width = frameTexture->frameTextureDesc.Width;
+				state.value.captureState.height = frameTexture->frameTextureDesc.Height;
+				state.value.captureState.texturePtr = GetUnityTexture(frameTexture->frameTextureSRV.get());
+				state.value.captureState.textureIndex = frameIndex;
+				if (frameTexture->frameChromaSRV != nullptr)
+				{
+					state.value.captureState.lumaTexturePtr = GetUnityTexture(frameTexture->frameTextureSRV.get());
+					state.value.captureState.chromaTexturePtr = GetUnityTexture(frameTexture->frameChromaSRV.get());
+				}
+				if (m_payloadHandler.ProceesTranform(payload))
+				{
+					streamSample->GetTransformAndProjection(&state.value.captureState.worldMatrix, &state.value.captureState.projectionMatrix);
+
+					// the crop's own projection, world points still land on the right pixels
+					if (cropFrame)
+					{
+						state.value.captureState.projectionMatrix = GetCropProjection(state.value.captureState.projectionMatrix, cropRect, videoProps.Width(), videoProps.Height());
+					}
+
+					bufferChanged = true;
+				}
+
+				RecordFrameLatency(payload, state.value.captureState);
+
+				// Send the callback every frame
+				Callback(state);
+			}
+		});
+}
+
+CameraCapture::Media::Capture::Sink CaptureEngine::MediaSink()
+{
+	auto guard = m_cs.Guard();
+
+	return m_mediaSink;
+}
+
+// private
+hresult CaptureEngine::CreateDeviceResources()
+{
+	if (m_mediaDevice != nullptr && m_dxgiDeviceManager != nullptr)
+	{
+		return S_OK;
+	}
+
+	// get the adapter from an existing d3dDevice
+	auto resources = m_d3d11DeviceResources.lock();
+	NULL_CHK_HR(resources, MF_E_UNEXPECTED);
+
+	com_ptr<IDXGIAdapter> dxgiAdapter = nullptr;
+	com_ptr<IDXGIDevice> dxgiDevice = resources->GetDevice().try_as<IDXGIDevice>();
+	if (dxgiDevice != nullptr)
+	{
+		IFR(dxgiDevice->GetAdapter(dxgiAdapter.put()));
+	}
+
+	// every engine on the adapter uses the same media device and dxgi manager
+	com_ptr<SharedMediaDevice> sharedMediaDevice = nullptr;
+	IFR(SharedMediaDevice::Acquire(dxgiAdapter.get(), sharedMediaDevice));
+
+	// success, store the values
+	m_sharedMediaDevice = sharedMediaDevice;
+	m_mediaDevice = sharedMediaDevice->Device();
+	m_dxgiDeviceManager = sharedMediaDevice->DeviceManager();
+
+	m_deviceLostToken = m_sharedMediaDevice->DeviceLost([weak = get_weak()](HRESULT reason)
+		{
+			auto strong = weak.get();
+			if (strong != nullptr)
+			{
+				strong->OnMediaDeviceLost(reason);
+			}
+		});
+
+	return S_OK;
+}
+
+void CaptureEngine::OnMediaDeviceLost(HRESULT reason)
+{
+	Log(L"CaptureEngine::OnMediaDeviceLost: 0x%x\n", reason);
+
+	// swapped for a new device on the next StartPreview after the capture is released
+	m_mediaDeviceLost = true;
+
+	Failed(reason);
+}
+
+// unity's device only backs the textures handed out, the capture and the media device carry on
+void CaptureEngine::OnDeviceResetStarted()
+{
+	auto guard = m_cs.Guard();
+
+	if (m_isShutdown)
+	{
+		return;
+	}
+
+	Log(L"CaptureEngine::OnDeviceResetStarted\n");
+
+	// the next preview frame builds a ring on the new device and raises the buffer change
+	ReleaseVideoTextures();
+
+	if (m_frameSource != nullptr)
+	{
+		m_frameSource->ReleaseTextures();
+	}
+
+	ReleasePhotoTexture();
+
+	// grabs and bursts create theirs again when they're next asked for
+	if (m_grabTexture != nullptr)
+	{
+		m_grabTexture->Reset();
+
+		m_grabTexture = nullptr;
+	}
+
+	if (m_burstTexture != nullptr)
+	{
+		m_burstTexture->Reset();
+
+		m_burstTexture = nullptr;
+	}
+
+	if (m_burstFrameTexture != nullptr)
+	{
+		m_burstFrameTexture->Reset();
+
+		m_burstFrameTexture = nullptr;
+	}
+}
+
+void CaptureEngine::ReleaseDeviceResources()
+{
+	if (m_audioSample != nullptr)
+	{
+		m_audioSample = nullptr;
+	}
+
+	{
+		auto audioGuard = m_audioCs.Guard();
+
+		m_audioRingBuffer = nullptr;
+	}
+
+	ReleaseVideoTextures();
+
+	if (m_frameTap != nullptr)
+	{
+		m_frameTap->Reset();
+
+		m_frameTap = nullptr;
+	}
+
+	// recreated on the next frame if streaming is still on
+	if (m_videoEncoder != nullptr)
+	{
+		m_videoEncoder->Shutdown();
+
+		m_videoEncoder = nullptr;
+	}
+
+	if (m_videoProcessor != nullptr)
+	{
+		m_videoProcessor->Reset();
+
+		m_videoProcessor = nullptr;
+	}
+
+	if (m_cropProcessor != nullptr)
+	{
+		m_cropProcessor->Reset();
+
+		m_cropProcessor = nullptr;
+	}
+
+	ReleasePhotoTexture();
+
+	// pooled for the next engine or the next session, unless the media device is gone
+	SharedTexture::Recycle(m_grabTexture);
+	SharedTexture::Recycle(m_burstTexture);
+	SharedTexture::Recycle(m_burstFrameTexture);
+
+	if (m_mediaDeviceLost)
+	{
+		SharedTexturePool::Instance().Drop(m_mediaDevice.get());
+	}
+
+	// other engines can still be using it, the last one releases the device
+	if (m_sharedMediaDevice != nullptr)
+	{
+		m_sharedMediaDevice->DeviceLost(m_deviceLostToken);
+	}
+	m_dxgiDeviceManager = nullptr;
+	m_mediaDevice = nullptr;
+	m_sharedMediaDevice = nullptr;
+}
+
+IAsyncAction CaptureEngine::StartPreviewCoroutine(
+	uint32_t width, uint32_t height,
+	boolean enableAudio, boolean enableMrc)
+{
+	winrt::apartment_context calling_thread;
+
+	co_await resume_background();
+
+	auto guard = m_cs.Guard();
+
+	if (m_useSyntheticSource)
+	{
+		if (m_isWarm)
+		{
+			co_await ReleaseMediaCaptureAsync();
+
+			m_isWarm = false;
+		}
+
+		IFT(StartSyntheticSource(width, height));
+
+		SetEvent(m_startPreviewEventHandle.get());
+
+		co_await calling_thread;
+
+		co_return;
+	}
+
+	// a warm device is only reused for the streams it was set up for
+	auto warmStart = m_isWarm
+		&& m_captureWidth == width
+		&& m_captureHeight == height
+		&& m_captureAudio == enableAudio
+		&& m_captureFormat == m_previewFormat;
+	if (m_isWarm && !warmStart)
+	{
+		co_await ReleaseMediaCaptureAsync();
+	}
+	m_isWarm = false;
+
+	if (m_mediaCapture == nullptr)
+	{
+		co_await CreateMediaCaptureAsync(width, height, enableAudio);
+	}
+	else
+	{
+		co_await RemoveMrcEffectsAsync();
+	}
+
+	// warm starts keep the stream properties and profile of the last session
+	auto encodingProfile = m_encodingProfile;
+	if (!warmStart || encodingProfile == nullptr)
+	{
+		encodingProfile = co_await ConfigureStreamsAsync(width, height, enableAudio);
+
+		m_encodingProfile = encodingProfile;
+		m_captureWidth = width;
+		m_captureHeight = height;
+		m_captureAudio = enableAudio;
+		m_captureFormat = m_previewFormat;
+	}
+
+	// media sink
+	auto mediaSink = CameraCapture::Media::Capture::Sink(encodingProfile);
+	ApplySinkProperties(mediaSink);
+
+	// create mrc effects first
+	if (enableMrc)
+	{
+		co_await AddMrcEffectsAsync(enableAudio);
+	}
+
+	if (m_streamType == MediaStreamType::VideoRecord)
+	{
+		co_await m_mediaCapture.StartRecordToCustomSinkAsync(encodingProfile, mediaSink);
+	}
+	else if (m_streamType == MediaStreamType::VideoPreview)
+	{
+		co_await m_mediaCapture.StartPreviewToCustomSinkAsync(encodingProfile, mediaSink);
+	}
+
+	// store locals
+	m_mediaSink = mediaSink;
+
+	if (m_payloadHandler != nullptr)
+	{
+		m_mediaSink.PayloadHandler(m_payloadHandler);
+	}
+
+	SetEvent(m_startPreviewEventHandle.get());
+
+	co_await calling_thread;
+}
+
+IAsyncOperation<MediaEncodingProfile> CaptureEngine::ConfigureStreamsAsync(
+	uint32_t const width,
+	uint32_t const height,
+	boolean const enableAudio)
+{
+	// set video controller properties
+	auto videoController = m_mediaCapture.VideoDeviceController();
+
+	try
+	{
+		videoController.DesiredOptimization(Windows::Media::Devices::MediaCaptureOptimization::LatencyThenQuality);
+	}
+	catch (hresult_error const& er)
+	{
+		Log(L"DesiredOptimization failed: 0x%lx", er.code());
+	}
+
+	// override video controller media stream properties
+	if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
+	{
+		auto videoEncProps = GetVideoDeviceProperties(videoController, m_streamType, width, height, MediaEncodingSubtypes::Nv12());
+		co_await videoController.SetMediaStreamPropertiesAsync(m_streamType, videoEncProps);
+
+		auto captureSettings = m_mediaCapture.MediaCaptureSettings();
+		if (m_streamType != MediaStreamType::VideoPreview
+			&&
+			captureSettings.VideoDeviceCharacteristic() != VideoDeviceCharacteristic::AllStreamsIdentical
+			&&
+			captureSettings.VideoDeviceCharacteristic() != VideoDeviceCharacteristic::PreviewRecordStreamsIdentical)
+		{
+			videoEncProps = GetVideoDeviceProperties(videoController, MediaStreamType::VideoRecord, width, height, MediaEncodingSubtypes::Nv12());
+			co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::VideoRecord, videoEncProps);
+		}
+	}
+
+	// encoding profile based on 720p
+	auto encodingProfile = MediaEncodingProfile::CreateMp4(VideoEncodingQuality::HD720p);
+	encodingProfile.Container(nullptr);
+
+	// update the audio profile to match device
+	if (enableAudio)
+	{
+		auto audioController = m_mediaCapture.AudioDeviceController();
+		auto audioMediaProperties = audioController.GetMediaStreamProperties(MediaStreamType::Audio);
+		auto audioMediaProperty = audioMediaProperties.as<AudioEncodingProperties>();
+
+		encodingProfile.Audio().Bitrate(audioMediaProperty.Bitrate());
+		encodingProfile.Audio().BitsPerSample(audioMediaProperty.BitsPerSample());
+		encodingProfile.Audio().ChannelCount(audioMediaProperty.ChannelCount());
+		encodingProfile.Audio().SampleRate(audioMediaProperty.SampleRate());
+		if (m_streamType == MediaStreamType::VideoPreview) // for local playback only
+		{
+			encodingProfile.Audio().Subtype(MediaEncodingSubtypes::Float());
+		}
+	}
+	else
+	{
+		encodingProfile.Audio(nullptr);
+	}
+
+	auto videoMediaProperty = videoController.GetMediaStreamProperties(m_streamType).as<VideoEncodingProperties>();
+	if (videoMediaProperty != nullptr)
+	{
+		encodingProfile.Video().Width(videoMediaProperty.Width());
+		encodingProfile.Video().Height(videoMediaProperty.Height());
+		if (m_streamType == MediaStreamType::VideoPreview) // for local playback only
+		{
+			// keep the native nv12 samples when we convert or expose them ourselves
+			if (m_previewFormat == PreviewFormat::Nv12ToBgra8 || m_previewFormat == PreviewFormat::Nv12)
+			{
+				encodingProfile.Video().Subtype(MediaEncodingSubtypes::Nv12());
+			}
+			else
+			{
+				encodingProfile.Video().Subtype(MediaEncodingSubtypes::Bgra8());
+			}
+		}
+	}
+
+	co_return encodingProfile;
+}
+
+IAsyncAction CaptureEngine::StopPreviewCoroutine()
+{
+	winrt::apartment_context calling_thread;
+
+	co_await resume_background();
+
+	auto guard = m_cs.Guard();
+
+	m_payloadEventRevoker.revoke();
+
+	// no frame left to take the photo or the rest of the burst from
+	m_grabPhoto = false;
+	m_fnBurstCallback = nullptr;
+	m_burstCallbackObject = nullptr;
+
+	m_payloadHandler = nullptr;
+
+	if (m_mediaSink != nullptr)
+	{
+		m_mediaSink.PayloadHandler(nullptr);
+	}
+
+	hresult hr = S_OK;
+
+	if (m_syntheticSource != nullptr)
+	{
+		StopSyntheticSource();
+	}
+
+	if (m_mediaCapture != nullptr)
+	{
+		try
+		{
+			if (m_mediaCapture.CameraStreamState() == Windows::Media::Devices::CameraStreamState::Streaming)
+			{
+				if (m_streamType == MediaStreamType::VideoRecord)
+				{
+					co_await m_mediaCapture.StopRecordAsync();
+				}
+				else if (m_streamType == MediaStreamType::VideoPreview)
+				{
+					co_await m_mediaCapture.StopPreviewAsync();
+				}
+			}
+		}
+		catch (hresult_error er)
+		{
+			Log(L"StopPreviewAsync failed: %s", er.message().c_str());
+
+			hr = er.code();
+		}
+
+		// a warm device stays initialized, the next start only attaches a new sink
+		if (m_keepWarm)
+		{
+			co_await RemoveMrcEffectsAsync();
+
+			m_isWarm = true;
+		}
+		else
+		{
+			co_await ReleaseMediaCaptureAsync();
+		}
+
+		if (m_mediaSink != nullptr)
+		{
+			auto mfSink = m_mediaSink.try_as<IMFMediaSink>();
+			if (mfSink != nullptr)
+			{
+				mfSink->Shutdown();
+			}
+
+			m_mediaSink = nullptr;
+		}
+	}
+
+	SetEvent(m_stopPreviewEventHandle.get());
+
+	if (FAILED(hr))
+	{
+		throw_hresult(hr);
+	}
+
+	co_await calling_thread;
+}
+
+// the sink is set up the way ConfigureStreamsAsync would for a camera, the source takes the
+// place of media capture and its presentation clock
+hresult CaptureEngine::StartSyntheticSource(uint32_t width, uint32_t height)
+{
+	bool isNv12 = m_previewFormat == PreviewFormat::Nv12ToBgra8 || m_previewFormat == PreviewFormat::Nv12;
+
+	com_ptr<SyntheticSource> source = nullptr;
+	com_ptr<IMFStreamSink> streamSink = nullptr;
+	CameraCapture::Media::Capture::Sink mediaSink = nullptr;
+
+	hresult hr = S_OK;
+
+	try
+	{
+		auto encodingProfile = MediaEncodingProfile::CreateMp4(VideoEncodingQuality::HD720p);
+		encodingProfile.Container(nullptr);
+		encodingProfile.Audio(nullptr);
+
+		// 0 keeps the profile's 720p, nv12 planes need even dimensions
+		auto videoProperties = encodingProfile.Video();
+		if (width > 0 && height > 0)
+		{
+			videoProperties.Width(isNv12 ? width & ~1u : width);
+			videoProperties.Height(isNv12 ? height & ~1u : height);
+		}
+		videoProperties.Subtype(isNv12 ? MediaEncodingSubtypes::Nv12() : MediaEncodingSubtypes::Bgra8());
+		videoProperties.FrameRate().Numerator(m_syntheticFrameRate);
+		videoProperties.FrameRate().Denominator(1);
+
+		IFR(SyntheticSource::Create(
+			m_mediaDevice.get(),
+			videoProperties.Width(), videoProperties.Height(),
+			isNv12 ? DXGI_FORMAT_NV12 : DXGI_FORMAT_B8G8R8A8_UNORM,
+			m_syntheticFrameRate, m_syntheticJitterMs,
+			source));
+
+		mediaSink = CameraCapture::Media::Capture::Sink(encodingProfile);
+		ApplySinkProperties(mediaSink);
+
+		// video only, the stream is 0
+		auto mfSink = mediaSink.as<IMFMediaSink>();
+		IFR(mfSink->GetStreamSinkById(0, streamSink.put()));
+		IFR(mediaSink.as<IMFClockStateSink>()->OnClockStart(MFGetSystemTime(), 0));
+	}
+	catch (hresult_error const& e)
+	{
+		hr = e.code();
+	}
+
+	IFR(hr);
+
+	m_mediaSink = mediaSink;
 
-IAsyncAction CaptureEngine::StartPreviewCoroutine(
-	uint32_t width, uint32_t height,
-	boolean enableAudio, boolean enableMrc)
+	if (m_payloadHandler != nullptr)
+	{
+		m_mediaSink.PayloadHandler(m_payloadHandler);
+	}
+
+	hr = source->Start(streamSink);
+	if (FAILED(hr))
+	{
+		StopSyntheticSource();
+
+		IFR(hr);
+	}
+
+	m_syntheticSource = source;
+
+	return S_OK;
+}
+
+void CaptureEngine::StopSyntheticSource()
+{
+	if (m_syntheticSource != nullptr)
+	{
+		m_syntheticSource->Stop();
+		m_syntheticSource = nullptr;
+	}
+
+	if (m_mediaSink != nullptr)
+	{
+		auto mfSink = m_mediaSink.try_as<IMFMediaSink>();
+		if (mfSink != nullptr)
+		{
+			mfSink->Shutdown();
+		}
+
+		m_mediaSink = nullptr;
+	}
+}
+
+IAsyncAction CaptureEngine::TakePhotoCoroutine(
+	uint32_t const width,
+	uint32_t const height,
+	boolean const enableMrc)
 {
 	winrt::apartment_context calling_thread;
 
-	co_await resume_background();
+	co_await resume_background();
+
+	auto guard = m_cs.Guard();
+
+	auto createdCapture = false;
+	if (m_mediaCapture == nullptr)
+	{
+		co_await CreateMediaCaptureAsync(width, height, false);
+
+		createdCapture = true;
+	}
+
+	auto captureSettings = m_mediaCapture.MediaCaptureSettings();
+
+	auto characteristic = captureSettings.VideoDeviceCharacteristic();
+
+	auto addedEffect = false;
+	if (enableMrc
+		&&
+		characteristic != VideoDeviceCharacteristic::AllStreamsIndependent
+		&&
+		characteristic != VideoDeviceCharacteristic::PreviewPhotoStreamsIdentical)
+	{
+		try
+		{
+			auto mrcVideoEffect = Media::Capture::MrcVideoEffect();
+			mrcVideoEffect.StreamType(MediaStreamType::Photo);
+
+			co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::Photo);
+		}
+		catch (hresult_error const& error)
+		{
+			Log(L"can't add the mrc extension - %s\n", error.message().c_str());
+		}
+
+		addedEffect = true;
+	}
+
+	// set video controller properties
+	auto videoController = m_mediaCapture.VideoDeviceController();
+
+	// override video controller media stream properties
+	if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
+	{
+		// find the closest resolution
+		auto videoEncProps = GetVideoDeviceProperties(videoController, MediaStreamType::Photo, width, height, MediaEncodingSubtypes::Nv12());
+		co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::Photo, videoEncProps);
+	}
+
+	auto photoProps = videoController.GetMediaStreamProperties(MediaStreamType::Photo).as<VideoEncodingProperties>();
+
+	// encoded by the camera pipeline, the hardware jpeg encoder where there is one, no texture or readback
+	if (m_fnPhotoCallback != nullptr)
+	{
+		auto jpegProperties = ImageEncodingProperties::CreateJpeg();
+		jpegProperties.Width(photoProps.Width());
+		jpegProperties.Height(photoProps.Height());
+
+		auto stream = Windows::Storage::Streams::InMemoryRandomAccessStream();
+		co_await m_mediaCapture.CapturePhotoToStreamAsync(jpegProperties, stream);
+
+		auto size = static_cast<uint32_t>(stream.Size());
+		auto buffer = Windows::Storage::Streams::Buffer(size);
+		m_encodedPhoto = co_await stream.GetInputStreamAt(0).ReadAsync(buffer, size, Windows::Storage::Streams::InputStreamOptions::None);
+		m_encodedPhotoWidth = photoProps.Width();
+		m_encodedPhotoHeight = photoProps.Height();
+	}
+	else
+	{
+		co_await CaptureLowLagPhotoAsync(photoProps);
+	}
+
+	if (addedEffect)
+	{
+		try
+		{
+			co_await m_mediaCapture.ClearEffectsAsync(MediaStreamType::Photo);
+		}
+		catch (hresult_error const& error)
+		{
+			Log(L"can't clear the mrc extension - %s", error.message().c_str());
+		}
+	}
+
+	if (createdCapture)
+	{
+		co_await ReleaseMediaCaptureAsync();
+	}
+
+	SetEvent(m_takePhotoEventHandle.get());
+
+	co_await calling_thread;
+}
+
+IAsyncAction CaptureEngine::CaptureLowLagPhotoAsync(
+	VideoEncodingProperties const& photoProps)
+{
+	if (m_photoSample == nullptr
+		||
+		m_photoTextureDesc.Width != photoProps.Width()
+		||
+		m_photoTextureDesc.Height != photoProps.Height())
+	{
+		CreatePhotoTexture(photoProps.Width(), photoProps.Height());
+	}
+
+	auto encProperties = ImageEncodingProperties::CreateUncompressed(MediaPixelFormat::Bgra8);
+	encProperties.Width(photoProps.Width());
+	encProperties.Height(photoProps.Height());
+
+	auto photoCapture = co_await m_mediaCapture.PrepareLowLagPhotoCaptureAsync(encProperties);
+
+	auto capturedPhoto = co_await photoCapture.CaptureAsync();
+
+	com_ptr<IMFGetService> spService = capturedPhoto.Frame().try_as<IMFGetService>();
+	if (spService != nullptr)
+	{
+		com_ptr<IMFMediaType> mediaType = nullptr;
+		IFT(MFCreateMediaTypeFromProperties(winrt::get_unknown(encProperties), mediaType.put()));
+
+		com_ptr<IMFSample> spSample = nullptr;
+		IFT(spService->GetService(MF_WRAPPED_SAMPLE_SERVICE, __uuidof(IMFSample), spSample.put_void()));
+
+		// copy the data
+		IFT(CopySample(MFMediaType_Video, spSample, m_photoSample));
+	}
+
+	co_await photoCapture.FinishAsync();
+}
+
+IAsyncAction CaptureEngine::CreateMediaCaptureAsync(
+	uint32_t const& width,
+	uint32_t const& height,
+	boolean const& enableAudio)
+{
+	if (m_mediaCapture != nullptr)
+	{
+		co_return;
+	}
+
+	// enumerated once per app launch, the device cache watches for changes and a cold start
+	// goes with the devices of the last launch while they're enumerated again
+	auto& deviceCache = DeviceCache::Instance();
+
+	hstring audioDeviceId;
+	if (enableAudio)
+	{
+		audioDeviceId = co_await deviceCache.FirstDeviceIdAsync(Windows::Devices::Enumeration::DeviceClass::AudioCapture);
+	}
+
+	// the camera picked at CreateCapture, otherwise the first one
+	hstring videoDeviceId = m_videoDeviceId;
+	if (videoDeviceId.empty())
+	{
+		videoDeviceId = co_await deviceCache.FirstDeviceIdAsync(Windows::Devices::Enumeration::DeviceClass::VideoCapture);
+		if (videoDeviceId.empty())
+		{
+			IFT(MF_E_NO_CAPTURE_DEVICES_AVAILABLE);
+		}
+	}
+
+	// initialize settings
+	auto initSettings = MediaCaptureInitializationSettings();
+	initSettings.MemoryPreference(MediaCaptureMemoryPreference::Auto);
+	initSettings.StreamingCaptureMode(enableAudio ? StreamingCaptureMode::AudioAndVideo : StreamingCaptureMode::Video);
+	initSettings.MediaCategory(m_category);
+	initSettings.VideoDeviceId(videoDeviceId);
+	if (!audioDeviceId.empty())
+	{
+		initSettings.AudioDeviceId(audioDeviceId);
+	}
+
+	// which stream should photo capture use
+	if (m_streamType == MediaStreamType::VideoPreview)
+	{
+		initSettings.PhotoCaptureSource(PhotoCaptureSource::VideoPreview);
+	}
+	else
+	{
+		initSettings.PhotoCaptureSource(PhotoCaptureSource::Auto);
+	}
+
+	// set the DXGIManger for the media capture
+	auto advancedInitSettings = initSettings.as<IAdvancedMediaCaptureInitializationSettings>();
+	IFT(advancedInitSettings->SetDirectxDeviceManager(m_dxgiDeviceManager.get()));
+
+	// if profiles are supported
+	MediaCaptureVideoProfile videoProfile = nullptr;
+	MediaCaptureVideoProfileMediaDescription videoProfileMediaDescription = nullptr;
+	if (deviceCache.IsVideoProfileSupported(videoDeviceId))
+	{
+		initSettings.SharingMode(MediaCaptureSharingMode::ExclusiveControl);
+
+		setlocale(LC_ALL, "");
+
+		// the profile / mediaDescription that worked last launch, otherwise the one that matches
+		if (!deviceCache.FindKnownGoodProfile(videoDeviceId, m_videoProfile, m_streamType, width, height, videoProfile, videoProfileMediaDescription))
+		{
+			auto profiles = deviceCache.FindKnownVideoProfiles(videoDeviceId, m_videoProfile);
+			for (auto const& profile : profiles)
+			{
+				auto const& videoProfileMediaDescriptions = m_streamType == (MediaStreamType::VideoPreview) ? profile.SupportedPreviewMediaDescription() : profile.SupportedRecordMediaDescription();
+				auto const& found = std::find_if(begin(videoProfileMediaDescriptions), end(videoProfileMediaDescriptions), [&](MediaCaptureVideoProfileMediaDescription const& desc)
+					{
+						Log(L"\tFormat: %s: %i x %i @ %f fps",
+							desc.Subtype().c_str(),
+							desc.Width(),
+							desc.Height(),
+							desc.FrameRate());
+
+						// store a default
+						if (videoProfile == nullptr)
+						{
+							videoProfile = profile;
+						}
+
+						if (videoProfileMediaDescription == nullptr)
+						{
+							videoProfileMediaDescription = desc;
+						}
+
+						// select a size that will be == width/height @ 30fps, final size will be set with enc props
+						bool match =
+							_wcsicmp(desc.Subtype().c_str(), MediaEncodingSubtypes::Nv12().c_str()) == 0 &&
+							desc.Width() == width &&
+							desc.Height() == height &&
+							desc.FrameRate() == 30.0;
+						if (match)
+						{
+							Log(L" - found\n");
+						}
+						else
+						{
+							Log(L"\n");
+						}
+
+						return match;
+					});
+
+				if (found != end(videoProfileMediaDescriptions))
+				{
+					videoProfile = profile;
+					videoProfileMediaDescription = *found;
+					break;
+				}
+			}
+		}
+
+		initSettings.VideoProfile(videoProfile);
+		if (m_streamType == MediaStreamType::VideoPreview)
+		{
+			initSettings.PreviewMediaDescription(videoProfileMediaDescription);
+		}
+		else
+		{
+			initSettings.RecordMediaDescription(videoProfileMediaDescription);
+		}
+		initSettings.PhotoMediaDescription(videoProfileMediaDescription);
+	}
+	else
+	{
+		initSettings.SharingMode(MediaCaptureSharingMode::ExclusiveControl);
+	}
+
+	auto mediaCapture = Windows::Media::Capture::MediaCapture();
+
+	HRESULT hr = S_OK;
+	try
+	{
+		co_await mediaCapture.InitializeAsync(initSettings);
+	}
+	catch (hresult_error const& e)
+	{
+		hr = e.code();
+	}
+
+	if (FAILED(hr))
+	{
+		mediaCapture.Close();
+
+		initSettings.as<IAdvancedMediaCaptureInitializationSettings>()->SetDirectxDeviceManager(nullptr);
+
+		// what an earlier launch stored can be stale, look it all up again once
+		if (!deviceCache.ForgetKnownGood(videoDeviceId, m_videoProfile, m_streamType, width, height))
+		{
+			IFT(hr);
+		}
+
+		Log(L"failed to initialize with the cached settings, trying again: 0x%08x\n", hr);
+
+		co_await CreateMediaCaptureAsync(width, height, enableAudio);
+
+		co_return;
+	}
+
+	deviceCache.SetKnownGood(videoDeviceId, m_videoProfile, m_streamType, width, height, videoProfile, videoProfileMediaDescription);
+
+	m_mediaCapture = mediaCapture;
+	m_initSettings = initSettings;
+}
+
+IAsyncAction CaptureEngine::ReleaseMediaCaptureAsync()
+{
+	if (m_mediaCapture == nullptr)
+	{
+		co_return;
+	}
+
+	co_await RemoveMrcEffectsAsync();
 
-	auto guard = m_cs.Guard();
+	m_isWarm = false;
+	m_encodingProfile = nullptr;
 
-	if (m_mediaCapture == nullptr)
+	if (m_initSettings != nullptr)
 	{
-		co_await CreateMediaCaptureAsync(width, height, enableAudio);
+		m_initSettings.as<IAdvancedMediaCaptureInitializationSettings>()->SetDirectxDeviceManager(nullptr);
+
+		m_initSettings = nullptr;
 	}
-	else
+
+	m_mediaCapture.Close();
+
+	m_mediaCapture = nullptr;
+}
+
+IAsyncAction CaptureEngine::AddMrcEffectsAsync(
+	boolean enableAudio)
+{
+	if (m_mediaCapture == nullptr)
 	{
-		co_await RemoveMrcEffectsAsync();
+		co_return;
 	}
 
-	// set video controller properties
-	auto videoController = m_mediaCapture.VideoDeviceController();
+	auto captureSettings = m_mediaCapture.MediaCaptureSettings();
 
 	try
 	{
-		videoController.DesiredOptimization(Windows::Media::Devices::MediaCaptureOptimization::LatencyThenQuality);
+		auto mrcVideoEffect = Media::Capture::MrcVideoEffect();
+
+		if (captureSettings.VideoDeviceCharacteristic() == VideoDeviceCharacteristic::AllStreamsIdentical ||
+			captureSettings.VideoDeviceCharacteristic() == VideoDeviceCharacteristic::PreviewRecordStreamsIdentical)
+		{
+			mrcVideoEffect.StreamType(MediaStreamType::VideoRecord);
+			m_mrcVideoEffect = co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::VideoRecord);
+		}
+		else
+		{
+			mrcVideoEffect.StreamType(MediaStreamType::VideoPreview);
+			m_mrcPreviewEffect = co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::VideoPreview);
+
+			mrcVideoEffect.StreamType(MediaStreamType::VideoRecord);
+			m_mrcVideoEffect = co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::VideoRecord);
+		}
+
+		if (enableAudio)
+		{
+			auto mrcAudioEffect = make<MrcAudioEffect>().as<IAudioEffectDefinition>();
+
+			m_mrcAudioEffect = co_await m_mediaCapture.AddAudioEffectAsync(mrcAudioEffect);
+		}
 	}
-	catch (hresult_error const& er)
+	catch (hresult_error const& e)
 	{
-		Log(L"DesiredOptimization failed: 0x%lx", er.code());
+		Log(L"failed to add Mrc effects to streams: %s\n", e.message().c_str());
 	}
 
-	// override video controller media stream properties
-	if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
+	co_return;
+}
+
+IAsyncAction CaptureEngine::RemoveMrcEffectsAsync()
+{
+	if (m_mediaCapture == nullptr)
 	{
-		auto videoEncProps = GetVideoDeviceProperties(videoController, m_streamType, width, height, MediaEncodingSubtypes::Nv12());
-		co_await videoController.SetMediaStreamPropertiesAsync(m_streamType, videoEncProps);
+		co_return;
+	}
 
-		auto captureSettings = m_mediaCapture.MediaCaptureSettings();
-		if (m_streamType != MediaStreamType::VideoPreview
-			&&
-			captureSettings.VideoDeviceCharacteristic() != VideoDeviceCharacteristic::AllStreamsIdentical
-			&&
-			captureSettings.VideoDeviceCharacteristic() != VideoDeviceCharacteristic::PreviewRecordStreamsIdentical)
+	if (m_mrcAudioEffect != nullptr || m_mrcPreviewEffect != nullptr || m_mrcVideoEffect != nullptr)
+	{
+		if (m_mrcAudioEffect != nullptr)
 		{
-			videoEncProps = GetVideoDeviceProperties(videoController, MediaStreamType::VideoRecord, width, height, MediaEncodingSubtypes::Nv12());
-			co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::VideoRecord, videoEncProps);
+			co_await m_mediaCapture.RemoveEffectAsync(m_mrcAudioEffect);
+			m_mrcAudioEffect = nullptr;
 		}
-	}
 
-	// encoding profile based on 720p
-	auto encodingProfile = MediaEncodingProfile::CreateMp4(VideoEncodingQuality::HD720p);
-	encodingProfile.Container(nullptr);
-
-	// update the audio profile to match device
-	if (enableAudio)
-	{
-		auto audioController = m_mediaCapture.AudioDeviceController();
-		auto audioMediaProperties = audioController.GetMediaStreamProperties(MediaStreamType::Audio);
-		auto audioMediaProperty = audioMediaProperties.as<AudioEncodingProperties>();
+		if (m_mrcPreviewEffect != nullptr)
+		{
+			co_await m_mediaCapture.RemoveEffectAsync(m_mrcPreviewEffect);
+			m_mrcPreviewEffect = nullptr;
+		}
 
-		encodingProfile.Audio().Bitrate(audioMediaProperty.Bitrate());
-		encodingProfile.Audio().BitsPerSample(audioMediaProperty.BitsPerSample());
-		encodingProfile.Audio().ChannelCount(audioMediaProperty.ChannelCount());
-		encodingProfile.Audio().SampleRate(audioMediaProperty.SampleRate());
-		if (m_streamType == MediaStreamType::VideoPreview) // for local playback only
+		if (m_mrcVideoEffect != nullptr)
 		{
-			encodingProfile.Audio().Subtype(MediaEncodingSubtypes::Float());
+			co_await m_mediaCapture.RemoveEffectAsync(m_mrcVideoEffect);
+			m_mrcVideoEffect = nullptr;
 		}
 	}
 	else
 	{
-		encodingProfile.Audio(nullptr);
+		co_return;
 	}
+}
 
-	auto videoMediaProperty = videoController.GetMediaStreamProperties(m_streamType).as<VideoEncodingProperties>();
-	if (videoMediaProperty != nullptr)
+void CaptureEngine::ApplySinkProperties(CameraCapture::Media::Capture::Sink const& mediaSink)
+{
+	// frames over the target rate are dropped before a payload is created
+	LONGLONG frameInterval = 0;
+	if (m_targetFrameRate > 0)
 	{
-		encodingProfile.Video().Width(videoMediaProperty.Width());
-		encodingProfile.Video().Height(videoMediaProperty.Height());
-		if (m_streamType == MediaStreamType::VideoPreview) // for local playback only
-		{
-			encodingProfile.Video().Subtype(MediaEncodingSubtypes::Bgra8());
-		}
+		frameInterval = 10000000ll / m_targetFrameRate;
 	}
 
-	// media sink
-	auto mediaSink = CameraCapture::Media::Capture::Sink(encodingProfile);
+	auto properties = Windows::Foundation::Collections::PropertySet();
+	properties.Insert(PROPERTY_TARGETFRAMEINTERVAL, box_value<int64_t>(frameInterval));
+	properties.Insert(PROPERTY_VIDEOSAMPLEREQUESTS, box_value<uint32_t>(m_sampleRequests));
 
-	// create mrc effects first
-	if (enableMrc)
+	mediaSink.SetProperties(properties);
+}
+
+void CaptureEngine::UpdateIntrinsics(com_ptr<IStreamSample> const& streamSample, uint32_t width, uint32_t height)
+{
+	auto mediaType = streamSample->MediaType();
+	if (mediaType == m_intrinsicsMediaType)
 	{
-		co_await AddMrcEffectsAsync(enableAudio);
+		return;
 	}
 
-	if (m_streamType == MediaStreamType::VideoRecord)
+	m_intrinsicsMediaType = mediaType;
+
+	// devices without calibration data keep the last values, the version tells callers nothing changed
+	CAMERA_INTRINSICS intrinsics{};
+	if (FAILED(GetCameraIntrinsics(streamSample->Sample(), width, height, intrinsics)))
 	{
-		co_await m_mediaCapture.StartRecordToCustomSinkAsync(encodingProfile, mediaSink);
+		return;
 	}
-	else if (m_streamType == MediaStreamType::VideoPreview)
+
+	intrinsics.version = m_intrinsics.version;
+	if (memcmp(&intrinsics, &m_intrinsics, sizeof(CAMERA_INTRINSICS)) != 0)
 	{
-		co_await m_mediaCapture.StartPreviewToCustomSinkAsync(encodingProfile, mediaSink);
-	}
+		intrinsics.version = m_intrinsics.version + 1;
 
-	// store locals
-	m_mediaSink = mediaSink;
+		m_intrinsics = intrinsics;
+	}
+}
 
-	if (m_payloadHandler != nullptr)
+void CaptureEngine::RecordFrameLatency(CameraCapture::Media::Payload const& payload, CAPTURE_STATE& captureState)
+{
+	auto streamSample = payload.try_as<IStreamSample>();
+	if (streamSample == nullptr)
 	{
-		m_mediaSink.PayloadHandler(m_payloadHandler);
+		return;
 	}
 
-	SetEvent(m_startPreviewEventHandle.get());
+	// stamped as late as possible, the callback goes out right after
+	streamSample->MarkStage(PayloadStage::Delivered, QueryPerformanceTime());
 
-	co_await calling_thread;
+	std::array<uint32_t, LATENCY_STAGE_COUNT> stageLatency{};
+	m_latencyStats.Record(streamSample, stageLatency);
+
+	captureState.sensorLatency = stageLatency[static_cast<size_t>(LatencyStage::Sensor)];
+	captureState.queueLatency = stageLatency[static_cast<size_t>(LatencyStage::Queue)];
+	captureState.copyLatency = stageLatency[static_cast<size_t>(LatencyStage::Copy)];
+	captureState.transformLatency = stageLatency[static_cast<size_t>(LatencyStage::Transform)];
+	captureState.callbackLatency = stageLatency[static_cast<size_t>(LatencyStage::Callback)];
 }
 
-IAsyncAction CaptureEngine::StopPreviewCoroutine()
+// the frame reader's thread, what unity takes for the view depends on its graphics api
+void CaptureEngine::OnSourceFrame(CAPTURE_STATE const& captureState, ID3D11ShaderResourceView* textureSRV)
 {
-	winrt::apartment_context calling_thread;
-
-	co_await resume_background();
-
-	auto guard = m_cs.Guard();
+	CALLBACK_STATE state{};
+	ZeroMemory(&state, sizeof(CALLBACK_STATE));
 
-	m_payloadEventRevoker.revoke();
+	state.type = CallbackType::Capture;
+	state.value.captureState = captureState;
+	state.value.captureState.texturePtr = GetUnityTexture(textureSRV);
 
-	m_payloadHandler = nullptr;
+	Callback(state);
+}
 
-	if (m_mediaSink != nullptr)
+void CaptureEngine::ReleaseVideoTextures()
+{
+	if (m_renderTexture != nullptr)
 	{
-		m_mediaSink.PayloadHandler(nullptr);
+		m_renderTexture->EndFrameRead();
+
+		m_renderTexture = nullptr;
 	}
 
-	hresult hr = S_OK;
+	m_frameTexture = nullptr;
+	m_renderSequence = m_frameSequence;
 
-	if (m_mediaCapture != nullptr)
+	m_previousFrameSample = nullptr;
+	m_frameSample = nullptr;
+
+	for (auto& sampleTexture : m_sampleTextures)
 	{
-		try
-		{
-			if (m_mediaCapture.CameraStreamState() == Windows::Media::Devices::CameraStreamState::Streaming)
-			{
-				if (m_streamType == MediaStreamType::VideoRecord)
-				{
-					co_await m_mediaCapture.StopRecordAsync();
-				}
-				else if (m_streamType == MediaStreamType::VideoPreview)
-				{
-					co_await m_mediaCapture.StopPreviewAsync();
-				}
-			}
-		}
-		catch (hresult_error er)
-		{
-			Log(L"StopPreviewAsync failed: %s", er.message().c_str());
+		sampleTexture->Reset();
+	}
+	m_sampleTextures.clear();
 
-			hr = er.code();
-		}
+	if (m_videoTextureRing != nullptr)
+	{
+		m_videoTextureRing->Reset();
 
-		co_await ReleaseMediaCaptureAsync();
+		m_videoTextureRing = nullptr;
+	}
 
-		if (m_mediaSink != nullptr)
-		{
-			auto mfSink = m_mediaSink.try_as<IMFMediaSink>();
-			if (mfSink != nullptr)
-			{
-				mfSink->Shutdown();
-			}
+	if (m_pendingVideoTextureRing != nullptr)
+	{
+		m_pendingVideoTextureRing->Reset();
 
-			m_mediaSink = nullptr;
-		}
+		m_pendingVideoTextureRing = nullptr;
 	}
+}
 
-	SetEvent(m_stopPreviewEventHandle.get());
-
-	if (FAILED(hr))
+// synchronized textures need a second slot so the devices don't wait on each other
+uint32_t CaptureEngine::GetVideoTextureCount()
+{
+	uint32_t textureCount = m_videoTextureCount;
+	if (m_textureSync != TextureSyncMode::None && textureCount < 2)
 	{
-		throw_hresult(hr);
+		textureCount = 2;
 	}
 
-	co_await calling_thread;
+	return textureCount;
 }
 
-IAsyncAction CaptureEngine::TakePhotoCoroutine(
-	uint32_t const width,
-	uint32_t const height,
-	boolean const enableMrc)
+bool CaptureEngine::IsTextureRingFor(com_ptr<SharedTextureRing> const& textureRing, uint32_t textureCount, DXGI_FORMAT textureFormat, uint32_t width, uint32_t height)
 {
-	winrt::apartment_context calling_thread;
+	return textureRing != nullptr
+		&& textureRing->Count() == textureCount
+		&& textureRing->SyncMode() == m_textureSync
+		&& textureRing->Format() == textureFormat
+		&& textureRing->Width() == width
+		&& textureRing->Height() == height;
+}
 
-	co_await resume_background();
+hresult CaptureEngine::ConvertVideoSample(com_ptr<IMFSample> const& sample, com_ptr<SharedTexture> const& target)
+{
+	PLUGIN_TRACE_SCOPE("CaptureEngine.ConvertVideoSample", PLUGIN_TRACE_KEYWORD_TEXTURE);
 
-	auto guard = m_cs.Guard();
+	NULL_CHK_HR(m_mediaDevice, MF_E_NOT_INITIALIZED);
 
-	auto createdCapture = false;
-	if (m_mediaCapture == nullptr)
+	com_ptr<ID3D11Texture2D> sourceTexture = nullptr;
+	uint32_t subresourceIndex = 0;
+	IFR(GetTextureFromSample(sample, sourceTexture, &subresourceIndex));
+
+	auto width = target->frameTextureDesc.Width;
+	auto height = target->frameTextureDesc.Height;
+
+	if (m_videoProcessor == nullptr
+		||
+		m_videoProcessor->InputWidth() != width
+		||
+		m_videoProcessor->InputHeight() != height)
 	{
-		co_await CreateMediaCaptureAsync(width, height, false);
+		m_videoProcessor = nullptr;
 
-		createdCapture = true;
+		IFR(VideoProcessor::Create(
+			m_mediaDevice,
+			width, height, DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709,
+			width, height, DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709,
+			m_videoProcessor));
 	}
 
-	auto captureSettings = m_mediaCapture.MediaCaptureSettings();
+	com_ptr<ID3D11DeviceContext> mediaContext = nullptr;
+	m_mediaDevice->GetImmediateContext(mediaContext.put());
 
-	auto characteristic = captureSettings.VideoDeviceCharacteristic();
+	IFR(m_videoProcessor->Blt(mediaContext, sourceTexture, subresourceIndex, target->mediaTexture));
 
-	auto addedEffect = false;
-	if (enableMrc
-		&&
-		characteristic != VideoDeviceCharacteristic::AllStreamsIndependent
-		&&
-		characteristic != VideoDeviceCharacteristic::PreviewPhotoStreamsIdentical)
+	// without a keyed mutex or fence, submit so the unity device sees the frame
+	if (target->syncMode == TextureSyncMode::None)
 	{
-		try
-		{
-			auto mrcVideoEffect = Media::Capture::MrcVideoEffect();
-			mrcVideoEffect.StreamType(MediaStreamType::Photo);
+		mediaContext->Flush();
+	}
 
-			co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::Photo);
-		}
-		catch (hresult_error const& error)
-		{
-			Log(L"can't add the mrc extension - %s\n", error.message().c_str());
-		}
+	// keep the sample attributes and timing in line with CopySample
+	IFR(sample->CopyAllItems(target->mediaSample.get()));
 
-		addedEffect = true;
+	LONGLONG sampleTime = 0;
+	IFR(sample->GetSampleTime(&sampleTime));
+	IFR(target->mediaSample->SetSampleTime(sampleTime));
+
+	LONGLONG sampleDuration = 0;
+	IFR(sample->GetSampleDuration(&sampleDuration));
+	IFR(target->mediaSample->SetSampleDuration(sampleDuration));
+
+	return S_OK;
+}
+
+// the region in pixels of a width x height frame and the size it's scaled to, false without one
+bool CaptureEngine::GetRegionRect(uint32_t width, uint32_t height, bool isNv12Output, RECT& sourceRect, uint32_t& outputWidth, uint32_t& outputHeight)
+{
+	REGION_OF_INTEREST region{};
+	{
+		auto guard = m_regionCs.Guard();
+
+		region = m_region;
 	}
 
-	// set video controller properties
-	auto videoController = m_mediaCapture.VideoDeviceController();
+	if (region.width <= 0.0f || region.height <= 0.0f)
+	{
+		return false;
+	}
 
-	// override video controller media stream properties
-	if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
+	LONG left = static_cast<LONG>(region.x * width);
+	LONG top = static_cast<LONG>(region.y * height);
+	LONG right = min(static_cast<LONG>((region.x + region.width) * width + 0.5f), static_cast<LONG>(width));
+	LONG bottom = min(static_cast<LONG>((region.y + region.height) * height + 0.5f), static_cast<LONG>(height));
+	if (right - left < 2 || bottom - top < 2)
 	{
-		// find the closest resolution
-		auto videoEncProps = GetVideoDeviceProperties(videoController, MediaStreamType::Photo, width, height, MediaEncodingSubtypes::Nv12());
-		co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::Photo, videoEncProps);
+		return false;
+	}
+
+	sourceRect = { left, top, right, bottom };
+	outputWidth = region.outputWidth > 0 ? region.outputWidth : static_cast<uint32_t>(right - left);
+	outputHeight = region.outputHeight > 0 ? region.outputHeight : static_cast<uint32_t>(bottom - top);
+
+	// nv12 planes need even dimensions
+	if (isNv12Output)
+	{
+		outputWidth &= ~1u;
+		outputHeight &= ~1u;
 	}
 
-	auto photoProps = videoController.GetMediaStreamProperties(MediaStreamType::Photo).as<VideoEncodingProperties>();
+	return true;
+}
 
-	if (m_photoSample == nullptr
+// like ConvertVideoSample, a processor of its own so toggling the crop doesn't recreate the other
+hresult CaptureEngine::CropVideoSample(com_ptr<IMFSample> const& sample, uint32_t width, uint32_t height, bool isNv12Sample, RECT const& sourceRect, com_ptr<SharedTexture> const& target)
+{
+	PLUGIN_TRACE_SCOPE("CaptureEngine.CropVideoSample", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+	NULL_CHK_HR(m_mediaDevice, MF_E_NOT_INITIALIZED);
+
+	com_ptr<ID3D11Texture2D> sourceTexture = nullptr;
+	uint32_t subresourceIndex = 0;
+	IFR(GetTextureFromSample(sample, sourceTexture, &subresourceIndex));
+
+	auto outputWidth = target->frameTextureDesc.Width;
+	auto outputHeight = target->frameTextureDesc.Height;
+
+	if (m_cropProcessor == nullptr
 		||
-		m_photoTextureDesc.Width != photoProps.Width()
+		m_cropProcessor->InputWidth() != width
 		||
-		m_photoTextureDesc.Height != photoProps.Height())
+		m_cropProcessor->InputHeight() != height
+		||
+		m_cropProcessor->OutputWidth() != outputWidth
+		||
+		m_cropProcessor->OutputHeight() != outputHeight)
 	{
-		CreatePhotoTexture(photoProps.Width(), photoProps.Height());
-	}
+		m_cropProcessor = nullptr;
 
-	auto encProperties = ImageEncodingProperties::CreateUncompressed(MediaPixelFormat::Bgra8);
-	encProperties.Width(photoProps.Width());
-	encProperties.Height(photoProps.Height());
+		auto inputColorSpace = isNv12Sample ? DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709 : DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
+		auto outputColorSpace = target->frameTextureDesc.Format == DXGI_FORMAT_NV12 ? DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709 : DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
 
-	auto photoCapture = co_await m_mediaCapture.PrepareLowLagPhotoCaptureAsync(encProperties);
+		IFR(VideoProcessor::Create(
+			m_mediaDevice,
+			width, height, inputColorSpace,
+			outputWidth, outputHeight, outputColorSpace,
+			m_cropProcessor));
+	}
 
-	auto capturedPhoto = co_await photoCapture.CaptureAsync();
+	com_ptr<ID3D11DeviceContext> mediaContext = nullptr;
+	m_mediaDevice->GetImmediateContext(mediaContext.put());
 
-	com_ptr<IMFGetService> spService = capturedPhoto.Frame().try_as<IMFGetService>();
-	if (spService != nullptr)
+	IFR(m_cropProcessor->Blt(mediaContext, sourceTexture, subresourceIndex, sourceRect, target->mediaTexture));
+
+	// without a keyed mutex or fence, submit so the unity device sees the frame
+	if (target->syncMode == TextureSyncMode::None)
 	{
-		com_ptr<IMFMediaType> mediaType = nullptr;
-		IFT(MFCreateMediaTypeFromProperties(winrt::get_unknown(encProperties), mediaType.put()));
+		mediaContext->Flush();
+	}
 
-		com_ptr<IMFSample> spSample = nullptr;
-		IFT(spService->GetService(MF_WRAPPED_SAMPLE_SERVICE, __uuidof(IMFSample), spSample.put_void()));
+	IFR(sample->CopyAllItems(target->mediaSample.get()));
 
-		// copy the data
-		IFT(CopySample(MFMediaType_Video, spSample, m_photoSample));
-	}
+	LONGLONG sampleTime = 0;
+	IFR(sample->GetSampleTime(&sampleTime));
+	IFR(target->mediaSample->SetSampleTime(sampleTime));
 
-	co_await photoCapture.FinishAsync();
+	LONGLONG sampleDuration = 0;
+	IFR(sample->GetSampleDuration(&sampleDuration));
+	IFR(target->mediaSample->SetSampleDuration(sampleDuration));
 
-	if (addedEffect)
+	return S_OK;
+}
+
+hresult CaptureEngine::WriteAudioSample(CameraCapture::Media::Payload const& payload, com_ptr<IMFSample> const& sample)
+{
+	NULL_CHK_HR(sample, E_INVALIDARG);
+
+	auto audioProps = payload.EncodingProperties().try_as<IAudioEncodingProperties>();
+	NULL_CHK_HR(audioProps, MF_E_INVALIDMEDIATYPE);
+
+	// the preview profile asks for float pcm, anything else keeps the packet callback
+	if (_wcsicmp(audioProps.Subtype().c_str(), MediaEncodingSubtypes::Float().c_str()) != 0 || audioProps.BitsPerSample() != 32)
 	{
-		try
-		{
-			co_await m_mediaCapture.ClearEffectsAsync(MediaStreamType::Photo);
-		}
-		catch (hresult_error const& error)
-		{
-			Log(L"can't clear the mrc extension - %s", error.message().c_str());
-		}
+		IFR(MF_E_INVALIDMEDIATYPE);
 	}
 
-	if (createdCapture)
+	if (m_audioRingBuffer == nullptr
+		||
+		m_audioRingBuffer->SampleRate() != audioProps.SampleRate()
+		||
+		m_audioRingBuffer->ChannelCount() != audioProps.ChannelCount()
+		||
+		m_audioRingBuffer->Milliseconds() != m_audioBufferLength)
 	{
-		co_await ReleaseMediaCaptureAsync();
+		com_ptr<AudioRingBuffer> ringBuffer = nullptr;
+		IFR(AudioRingBuffer::Create(audioProps.SampleRate(), audioProps.ChannelCount(), m_audioBufferLength, ringBuffer));
+
+		auto audioGuard = m_audioCs.Guard();
+
+		m_audioRingBuffer = ringBuffer;
 	}
 
-	SetEvent(m_takePhotoEventHandle.get());
+	LONGLONG sampleTime = 0;
+	IFR(sample->GetSampleTime(&sampleTime));
 
-	co_await calling_thread;
+	com_ptr<IMFMediaBuffer> mediaBuffer = nullptr;
+	IFR(sample->ConvertToContiguousBuffer(mediaBuffer.put()));
+
+	BYTE* data = nullptr;
+	DWORD dataLength = 0;
+	IFR(mediaBuffer->Lock(&data, nullptr, &dataLength));
+
+	// a full buffer drops the newest samples, the ring counts them
+	m_audioRingBuffer->Write(reinterpret_cast<float const*>(data), dataLength / sizeof(float), sampleTime);
+
+	IFR(mediaBuffer->Unlock());
+
+	return S_OK;
 }
 
-IAsyncAction CaptureEngine::CreateMediaCaptureAsync(
-	uint32_t const& width,
-	uint32_t const& height,
-	boolean const& enableAudio)
+hresult CaptureEngine::GetSampleTexture(com_ptr<IMFSample> const& sample, uint32_t width, uint32_t height, com_ptr<SampleTexture>& sampleTexture)
 {
-	if (m_mediaCapture != nullptr)
-	{
-		co_return;
-	}
+	sampleTexture = nullptr;
 
-	auto audioDevice = co_await GetFirstDeviceAsync(Windows::Devices::Enumeration::DeviceClass::AudioCapture);
-	auto videoDevice = co_await GetFirstDeviceAsync(Windows::Devices::Enumeration::DeviceClass::VideoCapture);
+	com_ptr<ID3D11Texture2D> mediaTexture = nullptr;
+	uint32_t subresourceIndex = 0;
+	IFR(GetTextureFromSample(sample, mediaTexture, &subresourceIndex));
 
-	// initialize settings
-	auto initSettings = MediaCaptureInitializationSettings();
-	initSettings.MemoryPreference(MediaCaptureMemoryPreference::Auto);
-	initSettings.StreamingCaptureMode(enableAudio ? StreamingCaptureMode::AudioAndVideo : StreamingCaptureMode::Video);
-	initSettings.MediaCategory(m_category);
-	initSettings.VideoDeviceId(videoDevice.Id());
-	if (enableAudio)
+	// the capture pipeline recycles its textures, open each one only once
+	for (auto const& cached : m_sampleTextures)
 	{
-		initSettings.AudioDeviceId(audioDevice.Id());
+		if (cached->mediaTexture == mediaTexture)
+		{
+			sampleTexture = cached;
+
+			return S_OK;
+		}
 	}
 
-	// which stream should photo capture use
-	if (m_streamType == MediaStreamType::VideoPreview)
+	D3D11_TEXTURE2D_DESC desc{};
+	mediaTexture->GetDesc(&desc);
+
+	// padded textures would need a uv scale on the unity side
+	if (!SampleTexture::IsShareable(desc) || subresourceIndex != 0 || desc.Width != width || desc.Height != height)
 	{
-		initSettings.PhotoCaptureSource(PhotoCaptureSource::VideoPreview);
+		IFR(MF_E_UNSUPPORTED_D3D_TYPE);
 	}
-	else
+
+	auto resources = m_d3d11DeviceResources.lock();
+	NULL_CHK_HR(resources, MF_E_UNEXPECTED);
+
+	com_ptr<SampleTexture> texture = nullptr;
+	IFR(SampleTexture::Create(resources->GetDevice(), mediaTexture, texture));
+
+	// the pipeline changed its sample pool, start over
+	if (m_sampleTextures.size() >= MAX_SAMPLE_TEXTURES)
 	{
-		initSettings.PhotoCaptureSource(PhotoCaptureSource::Auto);
+		m_sampleTextures.clear();
 	}
+	m_sampleTextures.push_back(texture);
 
-	// set the DXGIManger for the media capture
-	auto advancedInitSettings = initSettings.as<IAdvancedMediaCaptureInitializationSettings>();
-	IFT(advancedInitSettings->SetDirectxDeviceManager(m_dxgiDeviceManager.get()));
+	sampleTexture = texture;
 
-	// if profiles are supported
-	if (MediaCapture::IsVideoProfileSupported(videoDevice.Id()))
+	return S_OK;
+}
+
+hresult CaptureEngine::EncodeVideoSample(com_ptr<IMFSample> const& sample, IVideoEncodingProperties const& videoProps)
+{
+	if (m_videoEncoder == nullptr
+		||
+		m_videoEncoder->Codec() != m_streamCodec
+		||
+		m_videoEncoder->Width() != videoProps.Width()
+		||
+		m_videoEncoder->Height() != videoProps.Height())
 	{
-		initSettings.SharingMode(MediaCaptureSharingMode::ExclusiveControl);
+		if (m_videoEncoder != nullptr)
+		{
+			m_videoEncoder->Shutdown();
 
-		setlocale(LC_ALL, "");
+			m_videoEncoder = nullptr;
+		}
+
+		IFR(CreateDeviceResources());
 
-		// set the profile / mediaDescription that matches
-		MediaCaptureVideoProfile videoProfile = nullptr;
-		MediaCaptureVideoProfileMediaDescription videoProfileMediaDescription = nullptr;
-		auto profiles = MediaCapture::FindKnownVideoProfiles(videoDevice.Id(), m_videoProfile);
-		for (auto const& profile : profiles)
+		uint32_t frameRate = 30;
+		auto rate = videoProps.FrameRate();
+		if (rate.Numerator() > 0 && rate.Denominator() > 0)
 		{
-			auto const& videoProfileMediaDescriptions = m_streamType == (MediaStreamType::VideoPreview) ? profile.SupportedPreviewMediaDescription() : profile.SupportedRecordMediaDescription();
-			auto const& found = std::find_if(begin(videoProfileMediaDescriptions), end(videoProfileMediaDescriptions), [&](MediaCaptureVideoProfileMediaDescription const& desc)
-				{
-					Log(L"\tFormat: %s: %i x %i @ %f fps",
-						desc.Subtype().c_str(),
-						desc.Width(),
-						desc.Height(),
-						desc.FrameRate());
-
-					// store a default
-					if (videoProfile == nullptr)
-					{
-						videoProfile = profile;
-					}
+			frameRate = max(rate.Numerator() / rate.Denominator(), 1u);
+		}
 
-					if (videoProfileMediaDescription == nullptr)
-					{
-						videoProfileMediaDescription = desc;
-					}
+		IFR(VideoEncoder::Create(
+			m_mediaDevice, m_dxgiDeviceManager,
+			m_streamCodec,
+			videoProps.Width(), videoProps.Height(),
+			frameRate, m_streamBitrate,
+			m_fnStreamCallback, m_streamCallbackObject,
+			m_videoEncoder));
+	}
 
-					// select a size that will be == width/height @ 30fps, final size will be set with enc props
-					bool match =
-						_wcsicmp(desc.Subtype().c_str(), MediaEncodingSubtypes::Nv12().c_str()) == 0 &&
-						desc.Width() == width &&
-						desc.Height() == height &&
-						desc.FrameRate() == 30.0;
-					if (match)
-					{
-						Log(L" - found\n");
-					}
-					else
-					{
-						Log(L"\n");
-					}
+	return m_videoEncoder->Encode(sample);
+}
 
-					return match;
-				});
+hresult CaptureEngine::TapVideoSample(com_ptr<IMFSample> const& sample, IVideoEncodingProperties const& videoProps)
+{
+	com_ptr<ID3D11Texture2D> sourceTexture = nullptr;
+	uint32_t subresourceIndex = 0;
+	IFR(GetTextureFromSample(sample, sourceTexture, &subresourceIndex));
 
-			if (found != end(videoProfileMediaDescriptions))
-			{
-				videoProfile = profile;
-				videoProfileMediaDescription = *found;
-				break;
-			}
-		}
+	D3D11_TEXTURE2D_DESC sourceDesc{};
+	sourceTexture->GetDesc(&sourceDesc);
 
-		initSettings.VideoProfile(videoProfile);
-		if (m_streamType == MediaStreamType::VideoPreview)
-		{
-			initSettings.PreviewMediaDescription(videoProfileMediaDescription);
-		}
-		else
-		{
-			initSettings.RecordMediaDescription(videoProfileMediaDescription);
-		}
-		initSettings.PhotoMediaDescription(videoProfileMediaDescription);
+	auto inputWidth = videoProps.Width();
+	auto inputHeight = videoProps.Height();
+
+	// a height of 0 keeps the aspect ratio, nv12 needs even sizes
+	auto outputWidth = (m_frameTapWidth + 1) & ~1u;
+	auto outputHeight = m_frameTapHeight;
+	if (outputHeight == 0 && inputWidth > 0)
+	{
+		outputHeight = static_cast<uint32_t>((static_cast<uint64_t>(outputWidth) * inputHeight) / inputWidth);
 	}
-	else
+	outputHeight = max((outputHeight + 1) & ~1u, 2u);
+
+	if (m_frameTap == nullptr
+		||
+		m_frameTap->InputWidth() != inputWidth
+		||
+		m_frameTap->InputHeight() != inputHeight
+		||
+		m_frameTap->InputFormat() != sourceDesc.Format
+		||
+		m_frameTap->OutputWidth() != outputWidth
+		||
+		m_frameTap->OutputHeight() != outputHeight)
 	{
-		initSettings.SharingMode(MediaCaptureSharingMode::ExclusiveControl);
+		if (m_frameTap != nullptr)
+		{
+			m_frameTap->Reset();
+
+			m_frameTap = nullptr;
+		}
+
+		IFR(CreateDeviceResources());
+
+		IFR(FrameTap::Create(
+			m_mediaDevice,
+			inputWidth, inputHeight, sourceDesc.Format,
+			outputWidth, outputHeight,
+			m_fnFrameTapCallback, m_frameTapCallbackObject,
+			m_frameTap));
 	}
 
-	auto mediaCapture = Windows::Media::Capture::MediaCapture();
-	co_await mediaCapture.InitializeAsync(initSettings);
+	LONGLONG sampleTime = 0;
+	IFR(sample->GetSampleTime(&sampleTime));
 
-	m_mediaCapture = mediaCapture;
-	m_initSettings = initSettings;
+	return m_frameTap->Process(sourceTexture, subresourceIndex, sampleTime);
 }
 
-IAsyncAction CaptureEngine::ReleaseMediaCaptureAsync()
+hresult CaptureEngine::GrabPhotoFrame(com_ptr<IMFSample> const& sample, IVideoEncodingProperties const& videoProps, bool isNv12Sample)
 {
-	if (m_mediaCapture == nullptr)
+	IFR(CreateBgraTexture(videoProps.Width(), videoProps.Height(), m_grabTexture));
+
+	if (!m_grabPhoto)
 	{
-		co_return;
+		return S_OK;
 	}
 
-	co_await RemoveMrcEffectsAsync();
+	m_grabPhoto = false;
 
-	if (m_initSettings != nullptr)
-	{
-		m_initSettings.as<IAdvancedMediaCaptureInitializationSettings>()->SetDirectxDeviceManager(nullptr);
+	IFR(CopyToBgraTexture(sample, isNv12Sample, m_grabTexture));
 
-		m_initSettings = nullptr;
-	}
+	CALLBACK_STATE state{};
+	ZeroMemory(&state, sizeof(CALLBACK_STATE));
 
-	m_mediaCapture.Close();
+	state.type = CallbackType::Capture;
 
-	m_mediaCapture = nullptr;
+	ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+
+	state.value.captureState.stateType = CaptureStateType::PhotoFrame;
+	state.value.captureState.width = m_grabTexture->frameTextureDesc.Width;
+	state.value.captureState.height = m_grabTexture->frameTextureDesc.Height;
+	state.value.captureState.texturePtr = GetUnityTexture(m_grabTexture->frameTextureSRV.get());
+
+	Callback(state);
+
+	return S_OK;
 }
 
-IAsyncAction CaptureEngine::AddMrcEffectsAsync(
-	boolean enableAudio)
+hresult CaptureEngine::BurstVideoSample(CameraCapture::Media::Payload const& payload, com_ptr<IStreamSample> const& streamSample, IVideoEncodingProperties const& videoProps, bool isNv12Sample)
 {
-	if (m_mediaCapture == nullptr)
-	{
-		co_return;
-	}
-
-	auto captureSettings = m_mediaCapture.MediaCaptureSettings();
+	auto width = videoProps.Width();
+	auto height = videoProps.Height();
 
-	try
+	// sized from the first frame, kept for the next burst of the same shape
+	if (m_burstFrames.empty())
 	{
-		auto mrcVideoEffect = Media::Capture::MrcVideoEffect();
-
-		if (captureSettings.VideoDeviceCharacteristic() == VideoDeviceCharacteristic::AllStreamsIdentical ||
-			captureSettings.VideoDeviceCharacteristic() == VideoDeviceCharacteristic::PreviewRecordStreamsIdentical)
-		{
-			mrcVideoEffect.StreamType(MediaStreamType::VideoRecord);
-			m_mrcVideoEffect = co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::VideoRecord);
-		}
-		else
+		if (m_burstTexture == nullptr
+			||
+			m_burstTexture->frameTextureDesc.Width != width
+			||
+			m_burstTexture->frameTextureDesc.Height != height
+			||
+			m_burstTexture->frameTextureDesc.ArraySize != m_burstFrameCount)
 		{
-			mrcVideoEffect.StreamType(MediaStreamType::VideoPreview);
-			m_mrcPreviewEffect = co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::VideoPreview);
+			auto resources = m_d3d11DeviceResources.lock();
+			NULL_CHK_HR(resources, MF_E_UNEXPECTED);
 
-			mrcVideoEffect.StreamType(MediaStreamType::VideoRecord);
-			m_mrcVideoEffect = co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::VideoRecord);
-		}
+			IFR(CreateDeviceResources());
 
-		if (enableAudio)
-		{
-			auto mrcAudioEffect = make<MrcAudioEffect>().as<IAudioEffectDefinition>();
+			SharedTexture::Recycle(m_burstTexture);
 
-			m_mrcAudioEffect = co_await m_mediaCapture.AddAudioEffectAsync(mrcAudioEffect);
+			IFR(SharedTexture::Create(resources->GetDevice(), m_dxgiDeviceManager, width, height, DXGI_FORMAT_B8G8R8A8_UNORM, TextureSyncMode::None, m_burstTexture, m_burstFrameCount));
 		}
 	}
-	catch (hresult_error const& e)
+	else if (m_burstTexture->frameTextureDesc.Width != width || m_burstTexture->frameTextureDesc.Height != height)
 	{
-		Log(L"failed to add Mrc effects to streams: %s\n", e.message().c_str());
+		// the preview changed size under the burst
+		IFR(MF_E_INVALIDMEDIATYPE);
 	}
 
-	co_return;
+	// nv12 and padded samples go through a single bgra texture, then into the slice,
+	// not the photo texture, unity may still be reading that one
+	IFR(CreateBgraTexture(width, height, m_burstFrameTexture));
+	IFR(CopyToBgraTexture(streamSample->Sample(), isNv12Sample, m_burstFrameTexture));
+
+	com_ptr<ID3D11DeviceContext> mediaContext = nullptr;
+	m_mediaDevice->GetImmediateContext(mediaContext.put());
+
+	auto slice = static_cast<uint32_t>(m_burstFrames.size());
+	mediaContext->CopySubresourceRegion(
+		m_burstTexture->mediaTexture.get(), D3D11CalcSubresource(0, slice, 1),
+		0, 0, 0,
+		m_burstFrameTexture->mediaTexture.get(), 0,
+		nullptr);
+
+	BURST_FRAME frame{};
+	frame.cameraToWorld = Windows::Foundation::Numerics::float4x4::identity();
+	frame.cameraProjection = Windows::Foundation::Numerics::float4x4::identity();
+	IFR(streamSample->Sample()->GetSampleTime(&frame.timestamp));
+	if (m_payloadHandler.ProceesTranform(payload))
+	{
+		streamSample->GetTransformAndProjection(&frame.cameraToWorld, &frame.cameraProjection);
+	}
+	m_burstFrames.push_back(frame);
+
+	if (m_burstFrames.size() < m_burstFrameCount)
+	{
+		return S_OK;
+	}
+
+	mediaContext->Flush();
+
+	// one callback for the whole burst, the array stays valid until the next one starts
+	auto fnCallback = m_fnBurstCallback;
+	auto callbackObject = m_burstCallbackObject;
+	m_fnBurstCallback = nullptr;
+	m_burstCallbackObject = nullptr;
+
+	fnCallback(callbackObject, GetUnityTexture(m_burstTexture->frameTextureSRV.get()), width, height, m_burstFrames.data(), static_cast<uint32_t>(m_burstFrames.size()));
+
+	return S_OK;
 }
 
-IAsyncAction CaptureEngine::RemoveMrcEffectsAsync()
+hresult CaptureEngine::CreateBgraTexture(uint32_t width, uint32_t height, com_ptr<SharedTexture>& texture)
 {
-	if (m_mediaCapture == nullptr)
+	if (texture != nullptr
+		&&
+		texture->frameTextureDesc.Width == width
+		&&
+		texture->frameTextureDesc.Height == height)
 	{
-		co_return;
+		return S_OK;
 	}
 
-	if (m_mrcAudioEffect != nullptr || m_mrcPreviewEffect != nullptr || m_mrcVideoEffect != nullptr)
-	{
-		if (m_mrcAudioEffect != nullptr)
-		{
-			co_await m_mediaCapture.RemoveEffectAsync(m_mrcAudioEffect);
-			m_mrcAudioEffect = nullptr;
-		}
+	auto resources = m_d3d11DeviceResources.lock();
+	NULL_CHK_HR(resources, MF_E_UNEXPECTED);
 
-		if (m_mrcPreviewEffect != nullptr)
-		{
-			co_await m_mediaCapture.RemoveEffectAsync(m_mrcPreviewEffect);
-			m_mrcPreviewEffect = nullptr;
-		}
+	IFR(CreateDeviceResources());
 
-		if (m_mrcVideoEffect != nullptr)
-		{
-			co_await m_mediaCapture.RemoveEffectAsync(m_mrcVideoEffect);
-			m_mrcVideoEffect = nullptr;
-		}
-	}
-	else
+	SharedTexture::Recycle(texture);
+
+	// unity only reads it after the callback, no cross device sync needed
+	return SharedTexture::Create(resources->GetDevice(), m_dxgiDeviceManager, width, height, DXGI_FORMAT_B8G8R8A8_UNORM, TextureSyncMode::None, texture);
+}
+
+hresult CaptureEngine::CopyToBgraTexture(com_ptr<IMFSample> const& sample, bool isNv12Sample, com_ptr<SharedTexture> const& texture)
+{
+	NULL_CHK_HR(texture, MF_E_NOT_INITIALIZED);
+
+	// photos are always bgra, nv12 frames are converted on the media device
+	if (isNv12Sample)
 	{
-		co_return;
+		return ConvertVideoSample(sample, texture);
 	}
+
+	IFR(CopySample(MFMediaType_Video, sample, texture->mediaSample));
+
+	com_ptr<ID3D11DeviceContext> mediaContext = nullptr;
+	m_mediaDevice->GetImmediateContext(mediaContext.put());
+	mediaContext->Flush();
+
+	return S_OK;
 }
 
 hresult CaptureEngine::CreatePhotoTexture(uint32_t width, uint32_t height)
@@ -1047,7 +3022,7 @@ hresult CaptureEngine::CreatePhotoTexture(uint32_t width, uint32_t height)
 	auto desc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, width, height);
 	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
 	desc.MipLevels = 1;
-	desc.MiscFlags = 0;
+	desc.MiscFlags = GetUnityTextureMiscFlags();
 	desc.Usage = D3D11_USAGE_DEFAULT;
 
 	com_ptr<ID3D11Texture2D> photoTexture = nullptr;
@@ -1068,10 +3043,29 @@ hresult CaptureEngine::CreatePhotoTexture(uint32_t width, uint32_t height)
 
 	IFR(mediaSample->AddBuffer(dxgiMediaBuffer.get()));
 
+	ReleasePhotoTexture();
+
+	m_photoTextureBytes = GetTextureBytes(desc.Format, width, height, 1);
+	SharedTexturePool::Instance().OnAllocated(m_photoTextureBytes);
+
 	m_photoTextureDesc = desc;
 	m_photoTexture = photoTexture;
 	m_photoTextureSRV = srv;
 	m_photoSample = mediaSample;
 
 	return S_OK;
+}
+
+void CaptureEngine::ReleasePhotoTexture()
+{
+	if (m_photoTextureBytes != 0)
+	{
+		SharedTexturePool::Instance().OnReleased(m_photoTextureBytes);
+
+		m_photoTextureBytes = 0;
+	}
+
+	m_photoSample = nullptr;
+	m_photoTextureSRV = nullptr;
+	m_photoTexture = nullptr;
 }
\ No newline at end of file
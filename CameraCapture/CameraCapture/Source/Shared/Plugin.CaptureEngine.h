@@ -6,14 +6,25 @@
 #include "Plugin.CaptureEngine.g.h"
 #include "Plugin.Module.h"
 #include "Media.PayloadHandler.h"
-#include "Media.SharedTexture.h"
+#include "Media.SharedTextureRing.h"
+#include "Media.SampleTexture.h"
+#include "AudioRingBuffer.h"
 #include "Media.Capture.Sink.h"
 #include "Media.Transform.h"
+#include "Media.VideoProcessor.h"
+#include "Media.VideoEncoder.h"
+#include "Media.FrameTap.h"
+#include "Media.LatencyStats.h"
+#include "SharedMediaDevice.h"
+#include "Media.SyntheticSource.h"
+#include "Media.FrameReaderStream.h"
 
 #include <mfapi.h>
 #include <winrt/windows.media.h>
 #include <winrt/Windows.Media.Capture.h>
 
+#define MAX_BURST_FRAMES 32
+
 namespace winrt::CameraCapture::Plugin::implementation
 {
     struct CaptureEngine : CaptureEngineT<CaptureEngine, Module>
@@ -21,16 +32,53 @@ namespace winrt::CameraCapture::Plugin::implementation
         static Plugin::Module Create(
             _In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice,
             _In_ StateChangedCallback fnCallback,
-            _In_ void* pCallbackObject);
+            _In_ void* pCallbackObject,
+            _In_ hstring const& videoDeviceId);
 
         CaptureEngine();
         ~CaptureEngine() { Shutdown(); }
 
         virtual void Shutdown() override;
+        virtual void OnRenderEvent(uint16_t frameNumber) override;
 
-        hresult StartPreview(uint32_t width, uint32_t height, bool enableAudio, bool enableMrc);
+        hresult StartPreview(uint32_t width, uint32_t height, bool enableAudio, bool enableMrc, uint32_t textureCount, uint32_t sampleRequests);
         hresult StopPreview();
         hresult TakePhoto(uint32_t width, uint32_t height, bool enableMrc);
+        hresult ReleaseFrame(uint32_t textureIndex);
+        hresult SetTextureSync(int32_t syncMode);
+        hresult SetPreviewFormat(int32_t previewFormat);
+        hresult SetZeroCopy(bool enable);
+        hresult GetSampleCopyCounts(uint64_t& gpuCopies, uint64_t& cpuCopies);
+        hresult SetAudioBufferLength(uint32_t milliseconds);
+        hresult GetAudioFormat(uint32_t& sampleRate, uint32_t& channelCount);
+        hresult ReadAudio(array_view<float> samples, uint32_t& samplesRead, int64_t& timestamp);
+        hresult StartRecording(hstring const& path);
+        hresult StopRecording();
+        hresult SetKeepWarm(bool enable);
+        hresult SetPhotoMode(int32_t photoMode);
+        hresult SetTargetFrameRate(uint32_t framesPerSecond);
+        hresult SetPreviewResolution(uint32_t width, uint32_t height);
+        hresult GetSampleQueueOccupancy(float& averageOccupancy);
+
+        // not part of the runtime class, the callback can't cross the abi
+        hresult StartStreaming(VideoCodec codec, uint32_t bitrate, EncodedFrameCallback fnCallback, void* pCallbackObject);
+        hresult StopStreaming();
+        hresult StartFrameTap(uint32_t width, uint32_t height, FrameTapCallback fnCallback, void* pCallbackObject);
+        hresult StopFrameTap();
+        hresult TakeBurst(uint32_t frameCount, BurstCallback fnCallback, void* pCallbackObject);
+        hresult TakeJpegPhoto(uint32_t width, uint32_t height, bool enableMrc, EncodedPhotoCallback fnCallback, void* pCallbackObject);
+        hresult GetStats(CAPTURE_STATS& stats);
+        hresult GetIntrinsics(CAMERA_INTRINSICS& intrinsics);
+        hresult SetRegionOfInterest(REGION_OF_INTEREST const& region);
+
+        // not part of the runtime class, load testing only, the next StartPreview uses no camera
+        hresult SetSyntheticSource(bool enable, uint32_t frameRate, uint32_t jitterMs);
+
+        // not part of the runtime class, depth or ir next to the preview, with or without it running
+        hresult StartFrameSource(FrameSourceKind sourceKind, Windows::Perception::Spatial::SpatialCoordinateSystem const& appCoordinateSystem);
+        hresult StopFrameSource();
+        hresult ReleaseSourceFrame(uint32_t textureIndex);
+        void FrameSourceCoordinateSystem(Windows::Perception::Spatial::SpatialCoordinateSystem const& value);
 
         CameraCapture::Media::Capture::Sink MediaSink();
 
@@ -38,21 +86,53 @@ namespace winrt::CameraCapture::Plugin::implementation
         void PayloadHandler(CameraCapture::Media::PayloadHandler const& value);
 
 
+    protected:
+        virtual bool IsSuperseded(_In_ CALLBACK_STATE const& queued, _In_ CALLBACK_STATE const& state) override;
+        virtual void OnStateDropped(_In_ CALLBACK_STATE const& state) override;
+        virtual void OnDeviceResetStarted() override;
+
     private:
         hresult CreateDeviceResources();
+        void OnMediaDeviceLost(HRESULT reason);
         void ReleaseDeviceResources();
 
         Windows::Foundation::IAsyncAction StartPreviewCoroutine(uint32_t const width, uint32_t const height, boolean const enableAudio, boolean const enableMrc);
         Windows::Foundation::IAsyncAction StopPreviewCoroutine();
+        hresult StartSyntheticSource(uint32_t width, uint32_t height);
+        void StopSyntheticSource();
+        hresult StartTakePhoto(uint32_t width, uint32_t height, bool enableMrc);
         Windows::Foundation::IAsyncAction TakePhotoCoroutine(uint32_t const width, uint32_t const height, boolean const enableMrc);
+        Windows::Foundation::IAsyncAction CaptureLowLagPhotoAsync(Windows::Media::MediaProperties::VideoEncodingProperties const& photoProps);
 
         Windows::Foundation::IAsyncAction CreateMediaCaptureAsync(uint32_t const& width, uint32_t const& height, boolean const& enableAudio);
         Windows::Foundation::IAsyncAction ReleaseMediaCaptureAsync();
+        Windows::Foundation::IAsyncOperation<Windows::Media::MediaProperties::MediaEncodingProfile> ConfigureStreamsAsync(uint32_t const width, uint32_t const height, boolean const enableAudio);
 
         Windows::Foundation::IAsyncAction AddMrcEffectsAsync(boolean const enableAudio);
         Windows::Foundation::IAsyncAction RemoveMrcEffectsAsync();
 
+        void ApplySinkProperties(CameraCapture::Media::Capture::Sink const& mediaSink);
+        void RecordFrameLatency(CameraCapture::Media::Payload const& payload, CAPTURE_STATE& captureState);
+        void OnSourceFrame(CAPTURE_STATE const& captureState, ID3D11ShaderResourceView* textureSRV);
+        void UpdateIntrinsics(com_ptr<IStreamSample> const& streamSample, uint32_t width, uint32_t height);
+
+        void ReleaseVideoTextures();
+        uint32_t GetVideoTextureCount();
+        bool IsTextureRingFor(com_ptr<SharedTextureRing> const& textureRing, uint32_t textureCount, DXGI_FORMAT textureFormat, uint32_t width, uint32_t height);
+        hresult ConvertVideoSample(com_ptr<IMFSample> const& sample, com_ptr<SharedTexture> const& target);
+        bool GetRegionRect(uint32_t width, uint32_t height, bool isNv12Output, RECT& sourceRect, uint32_t& outputWidth, uint32_t& outputHeight);
+        hresult CropVideoSample(com_ptr<IMFSample> const& sample, uint32_t width, uint32_t height, bool isNv12Sample, RECT const& sourceRect, com_ptr<SharedTexture> const& target);
+        hresult WriteAudioSample(CameraCapture::Media::Payload const& payload, com_ptr<IMFSample> const& sample);
+        hresult GetSampleTexture(com_ptr<IMFSample> const& sample, uint32_t width, uint32_t height, com_ptr<SampleTexture>& sampleTexture);
+        hresult EncodeVideoSample(com_ptr<IMFSample> const& sample, Windows::Media::MediaProperties::IVideoEncodingProperties const& videoProps);
+        hresult TapVideoSample(com_ptr<IMFSample> const& sample, Windows::Media::MediaProperties::IVideoEncodingProperties const& videoProps);
+
         hresult CreatePhotoTexture(uint32_t width, uint32_t height);
+        void ReleasePhotoTexture();
+        hresult GrabPhotoFrame(com_ptr<IMFSample> const& sample, Windows::Media::MediaProperties::IVideoEncodingProperties const& videoProps, bool isNv12Sample);
+        hresult BurstVideoSample(CameraCapture::Media::Payload const& payload, com_ptr<IStreamSample> const& streamSample, Windows::Media::MediaProperties::IVideoEncodingProperties const& videoProps, bool isNv12Sample);
+        hresult CreateBgraTexture(uint32_t width, uint32_t height, com_ptr<SharedTexture>& texture);
+        hresult CopyToBgraTexture(com_ptr<IMFSample> const& sample, bool isNv12Sample, com_ptr<SharedTexture> const& texture);
 
     private:
         CriticalSection m_cs;
@@ -62,13 +142,20 @@ namespace winrt::CameraCapture::Plugin::implementation
         winrt::handle m_stopPreviewEventHandle;
         winrt::handle m_takePhotoEventHandle;
 
+        // shared with the other engines on the adapter, the two below are its device and manager
+        com_ptr<SharedMediaDevice> m_sharedMediaDevice;
         com_ptr<ID3D11Device> m_mediaDevice;
-        uint32_t m_resetToken;
         com_ptr<IMFDXGIDeviceManager> m_dxgiDeviceManager;
+        event_token m_deviceLostToken;
+        std::atomic<boolean> m_mediaDeviceLost;
+
+        // empty picks the first camera
+        hstring m_videoDeviceId;
 
         Windows::Foundation::IAsyncAction m_startPreviewOp;
         Windows::Foundation::IAsyncAction m_stopPreviewOp;
         Windows::Foundation::IAsyncAction m_takePhotoOp;
+        Windows::Foundation::IAsyncAction m_setResolutionOp;
 
         // media capture
         Windows::Media::Capture::MediaCategory m_category;
@@ -78,6 +165,21 @@ namespace winrt::CameraCapture::Plugin::implementation
         Windows::Media::Capture::MediaCapture m_mediaCapture;
         Windows::Media::Capture::MediaCaptureInitializationSettings m_initSettings;
 
+        // keep warm, the initialized device and its stream setup outlive StopPreview
+        boolean m_keepWarm;
+        boolean m_isWarm;
+        uint32_t m_captureWidth;
+        uint32_t m_captureHeight;
+        boolean m_captureAudio;
+        PreviewFormat m_captureFormat;
+        Windows::Media::MediaProperties::MediaEncodingProfile m_encodingProfile;
+
+        // frames come from the synthetic source instead of a camera
+        boolean m_useSyntheticSource;
+        uint32_t m_syntheticFrameRate;
+        uint32_t m_syntheticJitterMs;
+        com_ptr<SyntheticSource> m_syntheticSource;
+
         Windows::Media::IMediaExtension m_mrcAudioEffect;
         Windows::Media::IMediaExtension m_mrcVideoEffect;
         Windows::Media::IMediaExtension m_mrcPreviewEffect;
@@ -90,12 +192,96 @@ namespace winrt::CameraCapture::Plugin::implementation
 
         // buffers
         com_ptr<IMFSample> m_audioSample;
-        com_ptr<SharedTexture> m_sharedVideoTexture;
+
+        // filled by the payload handler, drained by the unity audio thread
+        uint32_t m_audioBufferLength;
+        CriticalSection m_audioCs;
+        com_ptr<AudioRingBuffer> m_audioRingBuffer;
+
+        // 0 delivers every camera frame, otherwise the sink drops the excess
+        uint32_t m_targetFrameRate;
+
+        // outstanding video sample requests, 0 keeps the stream sink default
+        uint32_t m_sampleRequests;
+
+        uint32_t m_videoTextureCount;
+        TextureSyncMode m_textureSync;
+        PreviewFormat m_previewFormat;
+        com_ptr<VideoProcessor> m_videoProcessor;
+
+        // set from the app thread every frame for gaze driven crops, its own lock so that doesn't
+        // wait on a frame being copied
+        CriticalSection m_regionCs;
+        REGION_OF_INTEREST m_region;
+        com_ptr<VideoProcessor> m_cropProcessor;
+        com_ptr<SharedTextureRing> m_videoTextureRing;
+
+        // allocated by SetPreviewResolution, swapped in by the first frame at the new size
+        com_ptr<SharedTextureRing> m_pendingVideoTextureRing;
+        uint64_t m_gpuSampleCopies;
+        uint64_t m_cpuSampleCopies;
+
+        // time from the camera to the video callback, per stage
+        LatencyStats m_latencyStats;
+
+        // read again only when the video media type changes
+        com_ptr<IMFMediaType> m_intrinsicsMediaType;
+        CAMERA_INTRINSICS m_intrinsics;
+
+        // zero copy, the capture sample stays alive until unity moved past it
+        boolean m_zeroCopy;
+        std::vector<com_ptr<SampleTexture>> m_sampleTextures;
+        com_ptr<IMFSample> m_frameSample;
+        com_ptr<IMFSample> m_previousFrameSample;
+
+        // encoded from the capture texture before it is copied for unity
+        VideoCodec m_streamCodec;
+        uint32_t m_streamBitrate;
+        EncodedFrameCallback m_fnStreamCallback;
+        void* m_streamCallbackObject;
+        com_ptr<VideoEncoder> m_videoEncoder;
+
+        // luma for cpu vision, read back a few frames behind the preview
+        uint32_t m_frameTapWidth;
+        uint32_t m_frameTapHeight;
+        FrameTapCallback m_fnFrameTapCallback;
+        void* m_frameTapCallbackObject;
+        com_ptr<FrameTap> m_frameTap;
+
+        // depth or ir from a frame reader, its own capture, ring and transform so the preview never waits on it
+        com_ptr<FrameReaderStream> m_frameSource;
+
+        // newest frame handed to the consumer and the one the unity device owns
+        uint64_t m_frameSequence;
+        com_ptr<SharedTexture> m_frameTexture;
+        uint64_t m_renderSequence;
+        com_ptr<SharedTexture> m_renderTexture;
 
         CD3D11_TEXTURE2D_DESC m_photoTextureDesc;
         com_ptr<ID3D11Texture2D> m_photoTexture;
         com_ptr<ID3D11ShaderResourceView> m_photoTextureSRV;
         com_ptr<IMFSample> m_photoSample;
+        uint64_t m_photoTextureBytes;   // unity's device only, counted in the pool's total but not pooled
+
+        // preview frame photos, the texture is allocated with the first frame so a grab only copies
+        PhotoMode m_photoMode;
+        boolean m_grabPhoto;
+        com_ptr<SharedTexture> m_grabTexture;
+
+        // encoded photos skip the texture, the bytes are handed out once the capture completes
+        EncodedPhotoCallback m_fnPhotoCallback;
+        void* m_photoCallbackObject;
+        Windows::Storage::Streams::IBuffer m_encodedPhoto;
+        uint32_t m_encodedPhotoWidth;
+        uint32_t m_encodedPhotoHeight;
+
+        // burst, one texture array slice per preview frame, a single callback at the end
+        uint32_t m_burstFrameCount;
+        std::vector<BURST_FRAME> m_burstFrames;
+        BurstCallback m_fnBurstCallback;
+        void* m_burstCallbackObject;
+        com_ptr<SharedTexture> m_burstTexture;
+        com_ptr<SharedTexture> m_burstFrameTexture;
     };
 }
 
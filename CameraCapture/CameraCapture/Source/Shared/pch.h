@@ -19,7 +19,10 @@
 #include <windows.h>
 #include <strsafe.h>
 
+#include "PluginTrace.h"
+
 #pragma comment(lib, "mfuuid")
+#pragma comment(lib, "mfreadwrite")
 
 struct __declspec(uuid("905a0fef-bc53-11df-8c49-001e4fc686da")) IBufferByteAccess : ::IUnknown
 {
@@ -147,8 +150,50 @@ typedef int32_t INSTANCE_HANDLE;
 #ifndef INSTANCE_HANDLE_INVALID
 #define INSTANCE_HANDLE_INVALID static_cast<INSTANCE_HANDLE>(0x0bad)
 #define INSTANCE_HANDLE_START static_cast<INSTANCE_HANDLE>(0x0bae)
+
+// a render event for this handle is for every live instance
+#define INSTANCE_HANDLE_BROADCAST static_cast<INSTANCE_HANDLE>(0)
 #endif // INSTANCE_HANDLE_INVALID
 
+typedef enum class _TextureSyncMode : int32_t
+{
+    None = 0,
+    KeyedMutex,
+    Fence
+} TextureSyncMode;
+
+typedef enum class _PreviewFormat : int32_t
+{
+    Bgra8 = 0,      // converted by the capture pipeline
+    Nv12ToBgra8,    // converted by the video processor on the media device
+    Nv12            // not converted, luma and chroma planes are handed out as is
+} PreviewFormat;
+
+typedef enum class _PhotoMode : int32_t
+{
+    Capture = 0,    // low lag photo capture on the photo stream
+    PreviewFrame    // the next preview frame, copied into a texture kept for photos
+} PhotoMode;
+
+typedef enum class _VideoCodec : int32_t
+{
+    H264 = 0,
+    Hevc
+} VideoCodec;
+
+typedef enum class _PayloadQueueMode : int32_t
+{
+    Shared = 0,     // a serial queue on media foundation's shared multithreaded queue
+    Capture,        // a dedicated queue on threads registered with the mmcss "Capture" task
+    Playback        // same with the "Playback" task
+} PayloadQueueMode;
+
+typedef enum class _FrameSourceKind : int32_t
+{
+    Depth = 0,      // r16 in the sensor's depth units
+    Infrared        // r16, 8 bit sensors are widened
+} FrameSourceKind;
+
 typedef enum class _CallbackType : int32_t
 {
     None = 0,
@@ -168,7 +213,9 @@ typedef enum class _CaptureStateType : int32_t
     PreviewStopped,
     PreviewAudioFrame,
     PreviewVideoFrame,
-    PhotoFrame
+    PhotoFrame,
+    DepthVideoFrame,    // the frame source, released with CaptureReleaseSourceFrame
+    InfraredVideoFrame
 } CaptureStateType;
 
 typedef struct _CAPTURE_STATE
@@ -179,8 +226,64 @@ typedef struct _CAPTURE_STATE
     void* texturePtr;
     winrt::Windows::Foundation::Numerics::float4x4 worldMatrix;
     winrt::Windows::Foundation::Numerics::float4x4 projectionMatrix;
+    uint32_t textureIndex;
+    void* lumaTexturePtr;
+    void* chromaTexturePtr;
+    // microseconds this frame spent in each stage, 0 for stages it skipped
+    uint32_t sensorLatency;     // device timestamp to the stream sink
+    uint32_t queueLatency;      // stream sink to the payload handler thread
+    uint32_t copyLatency;       // payload handler to the texture copy
+    uint32_t transformLatency;  // copy to the camera to world transform
+    uint32_t callbackLatency;   // transform to the state callback
 } CAPTURE_STATE;
 
+typedef enum class _LatencyStage : int32_t
+{
+    Sensor = 0,
+    Queue,
+    Copy,
+    Transform,
+    Callback,
+    Pipeline    // stream sink to the state callback
+} LatencyStage;
+
+#define LATENCY_STAGE_COUNT 6
+
+// pinhole model and lens distortion for the frame size, focal length and principal point in pixels
+typedef struct _CAMERA_INTRINSICS
+{
+    uint32_t version;   // changes whenever the values do, 0 until a frame carried intrinsics
+    uint32_t width;
+    uint32_t height;
+    winrt::Windows::Foundation::Numerics::float2 focalLength;
+    winrt::Windows::Foundation::Numerics::float2 principalPoint;
+    float radialK1;
+    float radialK2;
+    float radialK3;
+    float tangentialP1;
+    float tangentialP2;
+} CAMERA_INTRINSICS;
+
+// rolling percentiles in microseconds, indexed by LatencyStage
+typedef struct _CAPTURE_STATS
+{
+    uint32_t frameCount;
+    uint32_t p50[LATENCY_STAGE_COUNT];
+    uint32_t p99[LATENCY_STAGE_COUNT];
+} CAPTURE_STATS;
+
+// a crop of the camera frame in 0-1 frame coordinates, scaled to the output size on the media
+// device, an output size of 0 keeps the crop's size, a width or height of 0 turns cropping off
+typedef struct _REGION_OF_INTEREST
+{
+    float x;
+    float y;
+    float width;
+    float height;
+    uint32_t outputWidth;
+    uint32_t outputHeight;
+} REGION_OF_INTEREST;
+
 #pragma pack(push, 4)
 typedef struct _CALLBACK_STATE
 {
@@ -194,3 +297,26 @@ typedef struct _CALLBACK_STATE
 #pragma pack(pop)
 
 extern "C" typedef void(__stdcall *StateChangedCallback)(_In_ void* callbackObject, _In_ CALLBACK_STATE args);
+
+// teardown of an async released instance finished, called on a background thread
+extern "C" typedef void(__stdcall *ReleaseCompletedCallback)(_In_ void* callbackObject, _In_ INSTANCE_HANDLE id);
+
+// one encoded frame as 4 byte big endian length prefixed nal units, only valid during the call
+extern "C" typedef void(__stdcall *EncodedFrameCallback)(_In_ void* callbackObject, _In_reads_bytes_(length) uint8_t const* data, _In_ uint32_t length, _In_ int64_t timestamp, _In_ boolean keyFrame);
+
+// a photo encoded by the camera pipeline, jpeg, only valid during the call
+extern "C" typedef void(__stdcall *EncodedPhotoCallback)(_In_ void* callbackObject, _In_reads_bytes_(length) uint8_t const* data, _In_ uint32_t length, _In_ uint32_t width, _In_ uint32_t height);
+
+// one slice of a burst, identity matrices without a coordinate system
+typedef struct _BURST_FRAME
+{
+    int64_t timestamp;
+    winrt::Windows::Foundation::Numerics::float4x4 cameraToWorld;
+    winrt::Windows::Foundation::Numerics::float4x4 cameraProjection;
+} BURST_FRAME;
+
+// a finished burst, slice i of the bgra texture array is frames[i], the array stays valid until the next burst
+extern "C" typedef void(__stdcall *BurstCallback)(_In_ void* callbackObject, _In_ void* textureArrayPtr, _In_ uint32_t width, _In_ uint32_t height, _In_reads_(frameCount) BURST_FRAME const* frames, _In_ uint32_t frameCount);
+
+// downscaled luma of one frame, tightly packed rows, only valid during the call
+extern "C" typedef void(__stdcall *FrameTapCallback)(_In_ void* callbackObject, _In_reads_bytes_(width * height) uint8_t const* data, _In_ uint32_t width, _In_ uint32_t height, _In_ int64_t timestamp);
@@ -16,6 +16,15 @@ namespace CameraCapture
 
         internal const Int32 InvalidHandle = 0x0bad;
 
+        // a render event for this handle services every live instance
+        internal const Int32 BroadcastHandle = 0;
+
+        // one render event a frame for all instances instead of one each
+        internal static bool BatchRenderEvents = true;
+
+        // the unity frame the broadcast render event was last issued in
+        internal static int LastBroadcastFrame = -1;
+
         internal enum CallbackType : Int32
         {
             None = 0,
@@ -23,6 +32,44 @@ namespace CameraCapture
             Capture,
         };
 
+        internal enum CallbackMode : Int32
+        {
+            Immediate = 0,
+            Polled,
+        };
+
+        internal enum TextureSyncMode : Int32
+        {
+            None = 0,
+            KeyedMutex,
+            Fence,
+        };
+
+        internal enum PreviewFormat : Int32
+        {
+            Bgra8 = 0,
+            Nv12ToBgra8,
+            Nv12,
+        };
+
+        internal enum PhotoMode : Int32
+        {
+            Capture = 0,
+            PreviewFrame,
+        };
+
+        internal enum VideoCodec : Int32
+        {
+            H264 = 0,
+            Hevc,
+        };
+
+        internal enum FrameSourceKind : Int32
+        {
+            Depth = 0,
+            Infrared,
+        };
+
         internal enum CaptureStateType : Int32
         {
             None = 0,
@@ -31,6 +78,8 @@ namespace CameraCapture
             PreviewAudioFrame,
             PreviewVideoFrame,
             PhotoFrame,
+            DepthVideoFrame,
+            InfraredVideoFrame,
         };
 
         [StructLayout(LayoutKind.Sequential)]
@@ -55,6 +104,14 @@ namespace CameraCapture
             public IntPtr imgTexture;
             public SpatialTranformHelper.Matrix4x4 cameraWorld;
             public SpatialTranformHelper.Matrix4x4 cameraProjection;
+            public UInt32 textureIndex;
+            public IntPtr lumaTexture;
+            public IntPtr chromaTexture;
+            public UInt32 sensorLatency;
+            public UInt32 queueLatency;
+            public UInt32 copyLatency;
+            public UInt32 transformLatency;
+            public UInt32 callbackLatency;
 
             public override string ToString()
             {
@@ -63,10 +120,63 @@ namespace CameraCapture
                 sb.AppendLine("width: " + width);
                 sb.AppendLine("height: " + height);
                 sb.AppendLine("imgTexture: " + imgTexture);
+                sb.AppendLine("textureIndex: " + textureIndex);
+                sb.AppendLine("lumaTexture: " + lumaTexture);
+                sb.AppendLine("chromaTexture: " + chromaTexture);
+                sb.AppendLine("latency (us): sensor " + sensorLatency + ", queue " + queueLatency + ", copy " + copyLatency + ", transform " + transformLatency + ", callback " + callbackLatency);
                 return sb.ToString();
             }
         }
 
+        internal enum LatencyStage : Int32
+        {
+            Sensor = 0,
+            Queue,
+            Copy,
+            Transform,
+            Callback,
+            Pipeline,
+            Count
+        };
+
+        // pinhole model and lens distortion for the frame size, in pixels
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct CameraIntrinsics
+        {
+            public UInt32 version;
+            public UInt32 width;
+            public UInt32 height;
+            public float focalLengthX;
+            public float focalLengthY;
+            public float principalPointX;
+            public float principalPointY;
+            public float radialK1;
+            public float radialK2;
+            public float radialK3;
+            public float tangentialP1;
+            public float tangentialP2;
+        }
+
+        // one slice of a burst, identity matrices without a coordinate system
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct BurstFrame
+        {
+            public Int64 timestamp;
+            public SpatialTranformHelper.Matrix4x4 cameraToWorld;
+            public SpatialTranformHelper.Matrix4x4 cameraProjection;
+        }
+
+        // rolling percentiles in microseconds, indexed by LatencyStage
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct CaptureStats
+        {
+            public UInt32 frameCount;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = (int)LatencyStage.Count)]
+            public UInt32[] p50;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = (int)LatencyStage.Count)]
+            public UInt32[] p99;
+        }
+
         [StructLayout(LayoutKind.Explicit, Pack = 4)]
         internal struct CallbackState
         {
@@ -83,19 +193,59 @@ namespace CameraCapture
         [UnmanagedFunctionPointer(CallingConvention.StdCall)]
         internal delegate void StateChangedCallback(IntPtr senderPtr, CallbackState args);
 
+        // background teardown of ReleaseInstanceAsync is done, called on a plugin thread
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        internal delegate void ReleaseCompletedCallback(IntPtr senderPtr, Int32 instanceId);
+
+        // length prefixed nal units, data is only valid during the call
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        internal delegate void EncodedFrameCallback(IntPtr senderPtr, IntPtr data, UInt32 length, Int64 timestamp, [MarshalAs(UnmanagedType.I1)] Boolean keyFrame);
+
+        // downscaled luma with rows width bytes apart, data is only valid during the call
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        internal delegate void FrameTapCallback(IntPtr senderPtr, IntPtr data, UInt32 width, UInt32 height, Int64 timestamp);
+
+        // bgra texture array, frames points at frameCount BurstFrame structs, only valid during the call
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        internal delegate void BurstCallback(IntPtr senderPtr, IntPtr textureArray, UInt32 width, UInt32 height, IntPtr frames, UInt32 frameCount);
+
+        // jpeg bytes, data is only valid during the call
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        internal delegate void EncodedPhotoCallback(IntPtr senderPtr, IntPtr data, UInt32 length, UInt32 width, UInt32 height);
+
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetRenderEventFunc")]
         internal static extern IntPtr GetRenderEventFunc();
 
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "ReleaseInstance")]
         internal static extern void ReleaseInstance(Int32 instanceId);
 
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "ReleaseInstanceAsync")]
+        internal static extern Int32 ReleaseInstanceAsync(Int32 instanceId, [MarshalAs(UnmanagedType.FunctionPtr)] Wrapper.ReleaseCompletedCallback callback, IntPtr objectPtr);
+
+        // d3d11 debug layer on media devices created afterwards, on by default in debug plugin builds only
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetMediaDeviceDebugLayer")]
+        internal static extern void SetMediaDeviceDebugLayer([MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+        // polled states wait in the plugin for PollState, only the newest preview video frame is kept
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetCallbackMode")]
+        internal static extern Int32 SetCallbackMode(Int32 instanceId, CallbackMode callbackMode);
+
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "PollState")]
+        internal static extern Int32 PollState(Int32 instanceId, [Out] CallbackState[] states, UInt32 capacity, out UInt32 stateCount);
+
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CreateCapture")]
-        internal static extern Int32 CreateCapture([MarshalAs(UnmanagedType.FunctionPtr)]Wrapper.StateChangedCallback callback, IntPtr objectPtr, out Int32 instanceId);
+        internal static extern Int32 CreateCapture([MarshalAs(UnmanagedType.FunctionPtr)]Wrapper.StateChangedCallback callback, IntPtr objectPtr, [MarshalAs(UnmanagedType.LPWStr)] string videoDeviceId, out Int32 instanceId);
     }
 
     internal static class CallbackWrapper
     {
         // TODO: il2cpp doesn't support generics for static method callback
+        [AOT.MonoPInvokeCallback(typeof(Wrapper.ReleaseCompletedCallback))]
+        internal static void PInvokeReleaseCompletedHandler(IntPtr senderPtr, Int32 instanceId)
+        {
+            // the managed object can be gone by now, nothing to route it to
+        }
+
         [AOT.MonoPInvokeCallback(typeof(Wrapper.StateChangedCallback))]
         internal static void PInvokeCallbackHandler(IntPtr senderPtr, Wrapper.CallbackState args)
         {
@@ -153,6 +303,10 @@ namespace CameraCapture
         protected Wrapper.StateChangedCallback stateChangedCallback
             = new Wrapper.StateChangedCallback(CallbackWrapper.PInvokeCallbackHandler);
 
+        // static, the plugin can call it after this object is destroyed
+        private static readonly Wrapper.ReleaseCompletedCallback releaseCompletedCallback
+            = new Wrapper.ReleaseCompletedCallback(CallbackWrapper.PInvokeReleaseCompletedHandler);
+
         // pin GC memory location for the object
         protected GCHandle thisObject = default(GCHandle);
 
@@ -163,6 +317,9 @@ namespace CameraCapture
         private IEnumerator coroutine = null;
         private IEnumerator callbacksCoroutine = null;
         public bool oneCallbackPerFrame = true;
+        public bool releaseAsync = false; // tear down on a plugin thread, no main thread stall on scene unload
+        public bool pollCallbacks = false; // drain plugin states once per frame, no callbacks from media threads
+        private readonly Wrapper.CallbackState[] polledStates = new Wrapper.CallbackState[16];
         private readonly object eventLock = new object();
         private readonly List<Action> callbacks = new List<Action>();
         private readonly List<Action> callbacksToProcess = new List<Action>();
@@ -218,7 +375,14 @@ namespace CameraCapture
 
             if (instanceId != Wrapper.InvalidHandle)
             {
-                Wrapper.ReleaseInstance(instanceId);
+                if (releaseAsync)
+                {
+                    Wrapper.ReleaseInstanceAsync(instanceId, releaseCompletedCallback, IntPtr.Zero);
+                }
+                else
+                {
+                    Wrapper.ReleaseInstance(instanceId);
+                }
 
                 instanceId = Wrapper.InvalidHandle;
             }
@@ -232,18 +396,79 @@ namespace CameraCapture
                 // the update callback will be on this thread, which is not the Unity Main thread
                 yield return new WaitForEndOfFrame();
 
+                if (pollCallbacks)
+                {
+                    PollStates();
+                }
+
                 if (instanceId != Wrapper.InvalidHandle && renderFuncPtr != IntPtr.Zero)
                 {
-                    // hi - lastFrameIndex / low - instanceId
-                    int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
+                    if (Wrapper.BatchRenderEvents)
+                    {
+                        // the first instance to get here issues the frame's event for all of them
+                        if (Wrapper.LastBroadcastFrame != Time.frameCount)
+                        {
+                            Wrapper.LastBroadcastFrame = Time.frameCount;
 
-                    GL.IssuePluginEvent(renderFuncPtr, packedValue);
+                            int broadcastValue = ((0xffff & Time.frameCount) << 16) | (0xffff & Wrapper.BroadcastHandle);
+
+                            GL.IssuePluginEvent(renderFuncPtr, broadcastValue);
+                        }
+                    }
+                    else
+                    {
+                        // hi - lastFrameIndex / low - instanceId
+                        int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
+
+                        GL.IssuePluginEvent(renderFuncPtr, packedValue);
+                    }
                 }
             }
 
             yield return null;
         }
 
+        // call once the instance exists
+        protected void ApplyCallbackMode()
+        {
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return;
+            }
+
+            CheckHR(Wrapper.SetCallbackMode(instanceId, pollCallbacks ? Wrapper.CallbackMode.Polled : Wrapper.CallbackMode.Immediate));
+        }
+
+        // coroutines run on the app thread, states are handled right here
+        private void PollStates()
+        {
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return;
+            }
+
+            UInt32 stateCount = 0;
+            do
+            {
+                if (Wrapper.PollState(instanceId, polledStates, (UInt32)polledStates.Length, out stateCount) != 0)
+                {
+                    return;
+                }
+
+                for (int i = 0; i < stateCount; ++i)
+                {
+                    try
+                    {
+                        DispatchState(polledStates[i]);
+                    }
+                    catch (Exception ex)
+                    {
+                        Debug.LogWarning("State not able to execute: " + ex);
+                    }
+                }
+            } while (stateCount == polledStates.Length && instanceId != Wrapper.InvalidHandle);
+        }
+
         protected virtual void OnFailed(Wrapper.FailedState args)
         {
             // failed could be called on a non-ui thread, see OnUpdate
@@ -288,18 +513,23 @@ namespace CameraCapture
             // if not queue callback action(QueueCallback(() => { OnStateChanged(args); });)
             QueueCallback(() =>
             {
-                switch (args.Type)
-                {
-                    case Wrapper.CallbackType.Failed:
-                        OnFailed(args.FailState);
-                        break;
-                    default:
-                        OnCallback(args.Type, args);
-                        break;
-                }
+                DispatchState(args);
             });
         }
 
+        private void DispatchState(Wrapper.CallbackState args)
+        {
+            switch (args.Type)
+            {
+                case Wrapper.CallbackType.Failed:
+                    OnFailed(args.FailState);
+                    break;
+                default:
+                    OnCallback(args.Type, args);
+                    break;
+            }
+        }
+
         internal void QueueCallback(Action action)
         {
             if (action == null)
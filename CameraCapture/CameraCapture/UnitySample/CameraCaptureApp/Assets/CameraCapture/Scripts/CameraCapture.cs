@@ -16,10 +16,28 @@ namespace CameraCapture
         public Boolean EnableAudio = false;
         public Boolean EnableMrc = false;
         public Boolean EnabledPreview = false;
+        public string VideoDeviceId = null; // DeviceInformation.Id of the camera, empty picks the first one
+        public UInt32 TextureCount = 3;
+        public Wrapper.TextureSyncMode TextureSync = Wrapper.TextureSyncMode.None;
+        public Wrapper.PreviewFormat PreviewFormat = Wrapper.PreviewFormat.Bgra8;
+        public Boolean ZeroCopy = false;
+        public Boolean KeepWarm = false; // the camera stays initialized between previews of the same size
+        public Wrapper.PhotoMode PhotoMode = Wrapper.PhotoMode.Capture; // PreviewFrame takes the next frame at preview size
+        public UInt32 AudioBufferLength = 0; // ms, 0 raises PreviewAudioFrame per packet instead
+        public UInt32 TargetFrameRate = 0; // 0 delivers every camera frame
+        public UInt32 SampleRequests = 0; // 1 for lowest latency, 3-4 for bursts, 0 keeps the default of 2
         public SpatialCameraTracker CameraTracker = null;
 
         public Renderer VideoRenderer = null;
         private Texture2D videoTexture = null;
+        private IntPtr videoTexturePtr = IntPtr.Zero;
+        private UInt32? videoTextureIndex = null;
+
+        public Renderer SourceRenderer = null; // depth or ir from StartFrameSource, r16 in the sensor's units
+        public SpatialCameraTracker SourceCameraTracker = null;
+        private Texture2D sourceTexture = null;
+        private IntPtr sourceTexturePtr = IntPtr.Zero;
+        private UInt32? sourceTextureIndex = null;
 
         private IntPtr spatialCoordinateSystemPtr = IntPtr.Zero;
 
@@ -139,6 +157,11 @@ namespace CameraCapture
                     case Wrapper.CaptureStateType.PreviewVideoFrame:
                         OnPreviewFrameChanged(args.CaptureState);
                         break;
+
+                    case Wrapper.CaptureStateType.DepthVideoFrame:
+                    case Wrapper.CaptureStateType.InfraredVideoFrame:
+                        OnSourceFrameChanged(args.CaptureState);
+                        break;
                 }
             }
         }
@@ -182,6 +205,21 @@ namespace CameraCapture
 
                 sizeChanged = true;
             }
+            else if (videoTexturePtr != state.imgTexture)
+            {
+                // next slot in the texture ring
+                videoTexture.UpdateExternalTexture(state.imgTexture);
+            }
+
+            videoTexturePtr = state.imgTexture;
+
+            // hand the previous slot back to the plugin
+            if (videoTextureIndex.HasValue && videoTextureIndex.Value != state.textureIndex)
+            {
+                Native.ReleaseFrame(instanceId, videoTextureIndex.Value);
+            }
+
+            videoTextureIndex = state.textureIndex;
 
             if (sizeChanged)
             {
@@ -197,6 +235,41 @@ namespace CameraCapture
             }
         }
 
+        protected void OnSourceFrameChanged(Wrapper.CaptureState state)
+        {
+            if (sourceTexture == null || sourceTexture.width != state.width || sourceTexture.height != state.height)
+            {
+                sourceTexture = Texture2D.CreateExternalTexture(state.width, state.height, TextureFormat.R16, false, true, state.imgTexture);
+
+                if (SourceRenderer != null)
+                {
+                    SourceRenderer.enabled = true;
+                    SourceRenderer.sharedMaterial.SetTexture("_MainTex", sourceTexture);
+                    SourceRenderer.sharedMaterial.SetTextureScale("_MainTex", new Vector2(1, -1)); // flip texture
+                }
+            }
+            else if (sourceTexturePtr != state.imgTexture)
+            {
+                // next slot in the texture ring
+                sourceTexture.UpdateExternalTexture(state.imgTexture);
+            }
+
+            sourceTexturePtr = state.imgTexture;
+
+            // hand the previous slot back to the plugin
+            if (sourceTextureIndex.HasValue && sourceTextureIndex.Value != state.textureIndex)
+            {
+                Native.ReleaseSourceFrame(instanceId, sourceTextureIndex.Value);
+            }
+
+            sourceTextureIndex = state.textureIndex;
+
+            if (SourceCameraTracker != null)
+            {
+                SourceCameraTracker.UpdateCameraMatrices(state.cameraWorld, state.cameraProjection);
+            }
+        }
+
         private void SetSpatialCoordinateSystem()
         {
             spatialCoordinateSystemPtr = UnityEngine.XR.WSA.WorldManager.GetNativeISpatialCoordinateSystemPtr();
@@ -209,12 +282,14 @@ namespace CameraCapture
         private void CreateCapture()
         {
             IntPtr thisObjectPtr = GCHandle.ToIntPtr(thisObject);
-            CheckHR(Wrapper.CreateCapture(stateChangedCallback, thisObjectPtr, out instanceId));
+            CheckHR(Wrapper.CreateCapture(stateChangedCallback, thisObjectPtr, string.IsNullOrEmpty(VideoDeviceId) ? null : VideoDeviceId, out instanceId));
+
+            ApplyCallbackMode();
         }
 
         public async void StartPreview()
         {
-            await StartPreviewAsync(Width, Height, EnableAudio, EnableMrc);
+            await StartPreviewAsync(Width, Height, EnableAudio, EnableMrc, TextureCount);
         }
 
         public async void StopPreview()
@@ -225,11 +300,19 @@ namespace CameraCapture
             }
         }
 
-        public async Task<bool> StartPreviewAsync(int width, int height, bool enableAudio, bool useMrc)
+        public async Task<bool> StartPreviewAsync(int width, int height, bool enableAudio, bool useMrc, UInt32 textureCount)
         {
             startPreviewCompletionSource?.TrySetCanceled();
 
-            var hr = Native.StartPreview(instanceId, (UInt32)width, (UInt32)height, enableAudio, useMrc);
+            CheckHR(Native.SetTextureSync(instanceId, TextureSync));
+            CheckHR(Native.SetPreviewFormat(instanceId, PreviewFormat));
+            CheckHR(Native.SetZeroCopy(instanceId, ZeroCopy));
+            CheckHR(Native.SetKeepWarm(instanceId, KeepWarm));
+            CheckHR(Native.SetPhotoMode(instanceId, PhotoMode));
+            CheckHR(Native.SetAudioBufferLength(instanceId, AudioBufferLength));
+            CheckHR(Native.SetTargetFrameRate(instanceId, TargetFrameRate));
+
+            var hr = Native.StartPreview(instanceId, (UInt32)width, (UInt32)height, enableAudio, useMrc, textureCount, SampleRequests);
             if (hr == 0)
             {
                 EnabledPreview = true;
@@ -285,6 +368,126 @@ namespace CameraCapture
             stopCompletionSource = null;
 
             videoTexture = null;
+            videoTexturePtr = IntPtr.Zero;
+            videoTextureIndex = null;
+
+            return CheckHR(hr) == 0;
+        }
+
+        // call from OnAudioFilterRead, returns the number of samples copied
+        public int ReadAudio(float[] data, out Int64 timestamp)
+        {
+            timestamp = 0;
+
+            UInt32 samplesRead = 0;
+            if (Native.ReadAudio(instanceId, data, (UInt32)data.Length, out timestamp, out samplesRead) != 0)
+            {
+                return 0;
+            }
+
+            return (int)samplesRead;
+        }
+
+        // records the running preview to a fragmented mp4, path must be writable by the app
+        public bool StartRecording(string path)
+        {
+            return CheckHR(Native.StartRecording(instanceId, path)) == 0;
+        }
+
+        public bool StopRecording()
+        {
+            return CheckHR(Native.StopRecording(instanceId)) == 0;
+        }
+
+        // the callback runs on a media foundation thread, copy the data out and return
+        internal bool StartStreaming(Wrapper.VideoCodec codec, UInt32 bitrate, Wrapper.EncodedFrameCallback callback)
+        {
+            // keep the delegate alive while the plugin holds the function pointer
+            encodedFrameCallback = callback;
+
+            return CheckHR(Native.StartStreaming(instanceId, codec, bitrate, encodedFrameCallback, IntPtr.Zero)) == 0;
+        }
+
+        internal bool StopStreaming()
+        {
+            var hr = Native.StopStreaming(instanceId);
+
+            encodedFrameCallback = null;
+
+            return CheckHR(hr) == 0;
+        }
+
+        private Wrapper.EncodedFrameCallback encodedFrameCallback = null;
+
+        // luma for marker detection, height 0 keeps the aspect ratio, the callback runs on a media foundation thread
+        internal bool StartFrameTap(UInt32 width, UInt32 height, Wrapper.FrameTapCallback callback)
+        {
+            // keep the delegate alive while the plugin holds the function pointer
+            frameTapCallback = callback;
+
+            return CheckHR(Native.StartFrameTap(instanceId, width, height, frameTapCallback, IntPtr.Zero)) == 0;
+        }
+
+        internal bool StopFrameTap()
+        {
+            var hr = Native.StopFrameTap(instanceId);
+
+            frameTapCallback = null;
+
+            return CheckHR(hr) == 0;
+        }
+
+        private Wrapper.FrameTapCallback frameTapCallback = null;
+
+        // frameCount consecutive preview frames, the callback runs on a media foundation thread once the last one is in
+        internal bool TakeBurst(UInt32 frameCount, Wrapper.BurstCallback callback)
+        {
+            // keep the delegate alive while the plugin holds the function pointer
+            burstCallback = callback;
+
+            return CheckHR(Native.TakeBurst(instanceId, frameCount, burstCallback, IntPtr.Zero)) == 0;
+        }
+
+        private Wrapper.BurstCallback burstCallback = null;
+
+        // a jpeg from the photo stream, encoded by the camera pipeline, no texture readback or managed encode
+        internal bool TakeJpegPhoto(UInt32 width, UInt32 height, bool enableMrc, Wrapper.EncodedPhotoCallback callback)
+        {
+            // keep the delegate alive while the plugin holds the function pointer
+            photoCallback = callback;
+
+            return CheckHR(Native.TakeJpegPhoto(instanceId, width, height, enableMrc, photoCallback, IntPtr.Zero)) == 0;
+        }
+
+        private Wrapper.EncodedPhotoCallback photoCallback = null;
+
+        // crops the preview to a 0-1 rect of the frame and scales it to outputWidth x outputHeight, 0 keeps the
+        // crop's size, cheap enough to call every frame, a zero size rect turns it off
+        internal bool SetRegionOfInterest(Rect region, UInt32 outputWidth, UInt32 outputHeight)
+        {
+            return CheckHR(Native.SetRegionOfInterest(instanceId, region.x, region.y, region.width, region.height, outputWidth, outputHeight)) == 0;
+        }
+
+        // switches the running preview to the camera's closest size without restarting it, the first frame
+        // at the new size comes through OnPreviewFrameChanged as a size change
+        public bool SetPreviewResolution(UInt32 width, UInt32 height)
+        {
+            return CheckHR(Native.SetPreviewResolution(instanceId, width, height)) == 0;
+        }
+
+        // depth or ir frames from the same device on a capture of their own, the preview doesn't have to be running
+        public bool StartFrameSource(Wrapper.FrameSourceKind sourceKind)
+        {
+            return CheckHR(Native.StartFrameSource(instanceId, sourceKind)) == 0;
+        }
+
+        public bool StopFrameSource()
+        {
+            var hr = Native.StopFrameSource(instanceId);
+
+            sourceTexture = null;
+            sourceTexturePtr = IntPtr.Zero;
+            sourceTextureIndex = null;
 
             return CheckHR(hr) == 0;
         }
@@ -292,11 +495,92 @@ namespace CameraCapture
         private static class Native
         {
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStartPreview")]
-            internal static extern Int32 StartPreview(Int32 handle, UInt32 width, UInt32 height, [MarshalAs(UnmanagedType.I1)] Boolean enableAudio, [MarshalAs(UnmanagedType.I1)] Boolean enableMrc);
+            internal static extern Int32 StartPreview(Int32 handle, UInt32 width, UInt32 height, [MarshalAs(UnmanagedType.I1)] Boolean enableAudio, [MarshalAs(UnmanagedType.I1)] Boolean enableMrc, UInt32 textureCount, UInt32 sampleRequests);
 
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStopPreview")]
             internal static extern Int32 StopPreview(Int32 handle);
 
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureReleaseFrame")]
+            internal static extern Int32 ReleaseFrame(Int32 handle, UInt32 textureIndex);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetTextureSync")]
+            internal static extern Int32 SetTextureSync(Int32 handle, Wrapper.TextureSyncMode syncMode);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetPreviewFormat")]
+            internal static extern Int32 SetPreviewFormat(Int32 handle, Wrapper.PreviewFormat previewFormat);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetZeroCopy")]
+            internal static extern Int32 SetZeroCopy(Int32 handle, [MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetKeepWarm")]
+            internal static extern Int32 SetKeepWarm(Int32 handle, [MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetPhotoMode")]
+            internal static extern Int32 SetPhotoMode(Int32 handle, Wrapper.PhotoMode photoMode);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetSampleCopyCounts")]
+            internal static extern Int32 GetSampleCopyCounts(Int32 handle, out UInt64 gpuCopies, out UInt64 cpuCopies);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetAudioBufferLength")]
+            internal static extern Int32 SetAudioBufferLength(Int32 handle, UInt32 milliseconds);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetTargetFrameRate")]
+            internal static extern Int32 SetTargetFrameRate(Int32 handle, UInt32 framesPerSecond);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetPreviewResolution")]
+            internal static extern Int32 SetPreviewResolution(Int32 handle, UInt32 width, UInt32 height);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetSampleQueueOccupancy")]
+            internal static extern Int32 GetSampleQueueOccupancy(Int32 handle, out float averageOccupancy);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetStats")]
+            internal static extern Int32 GetStats(Int32 handle, out Wrapper.CaptureStats stats);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetIntrinsics")]
+            internal static extern Int32 GetIntrinsics(Int32 handle, out Wrapper.CameraIntrinsics intrinsics);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetAudioFormat")]
+            internal static extern Int32 GetAudioFormat(Int32 handle, out UInt32 sampleRate, out UInt32 channelCount);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureReadAudio")]
+            internal static extern Int32 ReadAudio(Int32 handle, [Out] float[] samples, UInt32 count, out Int64 timestamp, out UInt32 samplesRead);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStartStreaming")]
+            internal static extern Int32 StartStreaming(Int32 handle, Wrapper.VideoCodec codec, UInt32 bitrate, [MarshalAs(UnmanagedType.FunctionPtr)] Wrapper.EncodedFrameCallback callback, IntPtr objectPtr);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStopStreaming")]
+            internal static extern Int32 StopStreaming(Int32 handle);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStartFrameSource")]
+            internal static extern Int32 StartFrameSource(Int32 handle, Wrapper.FrameSourceKind sourceKind);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStopFrameSource")]
+            internal static extern Int32 StopFrameSource(Int32 handle);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureReleaseSourceFrame")]
+            internal static extern Int32 ReleaseSourceFrame(Int32 handle, UInt32 textureIndex);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStartFrameTap")]
+            internal static extern Int32 StartFrameTap(Int32 handle, UInt32 width, UInt32 height, [MarshalAs(UnmanagedType.FunctionPtr)] Wrapper.FrameTapCallback callback, IntPtr objectPtr);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStopFrameTap")]
+            internal static extern Int32 StopFrameTap(Int32 handle);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode, EntryPoint = "CaptureStartRecording")]
+            internal static extern Int32 StartRecording(Int32 handle, [MarshalAs(UnmanagedType.LPWStr)] string path);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureStopRecording")]
+            internal static extern Int32 StopRecording(Int32 handle);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureTakeBurst")]
+            internal static extern Int32 TakeBurst(Int32 handle, UInt32 frameCount, [MarshalAs(UnmanagedType.FunctionPtr)] Wrapper.BurstCallback callback, IntPtr objectPtr);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetRegionOfInterest")]
+            internal static extern Int32 SetRegionOfInterest(Int32 handle, float x, float y, float width, float height, UInt32 outputWidth, UInt32 outputHeight);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureTakeJpegPhoto")]
+            internal static extern Int32 TakeJpegPhoto(Int32 handle, UInt32 width, UInt32 height, [MarshalAs(UnmanagedType.I1)] Boolean enableMrc, [MarshalAs(UnmanagedType.FunctionPtr)] Wrapper.EncodedPhotoCallback callback, IntPtr objectPtr);
+
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetCoordinateSystem")]
             internal static extern Int32 SetCoordinateSystem(Int32 instanceId, IntPtr spatialCoordinateSystemPtr);
         }
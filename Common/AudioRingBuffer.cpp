@@ -0,0 +1,131 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "AudioRingBuffer.h"
+
+using namespace winrt;
+
+_Use_decl_annotations_
+HRESULT AudioRingBuffer::Create(
+    uint32_t sampleRate,
+    uint32_t channelCount,
+    uint32_t milliseconds,
+    com_ptr<AudioRingBuffer>& ringBuffer)
+{
+    if (sampleRate < 1 || channelCount < 1 || milliseconds < 1 || milliseconds > MAX_AUDIO_BUFFER_MS)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    ringBuffer = nullptr;
+
+    uint64_t frameCount = (static_cast<uint64_t>(sampleRate) * milliseconds + 999) / 1000;
+
+    auto buffer = make<AudioRingBuffer>().as<AudioRingBuffer>();
+    buffer->m_sampleRate = sampleRate;
+    buffer->m_channelCount = channelCount;
+    buffer->m_milliseconds = milliseconds;
+    buffer->m_samples.resize(static_cast<size_t>(frameCount * channelCount));
+
+    ringBuffer = buffer;
+
+    return S_OK;
+}
+
+AudioRingBuffer::AudioRingBuffer()
+    : m_sampleRate(0)
+    , m_channelCount(0)
+    , m_milliseconds(0)
+    , m_writePosition(0)
+    , m_readPosition(0)
+    , m_timeBase(0)
+    , m_overruns(0)
+{}
+
+_Use_decl_annotations_
+uint32_t AudioRingBuffer::Write(
+    float const* samples,
+    uint32_t count,
+    LONGLONG sampleTime)
+{
+    if (samples == nullptr || m_samples.empty())
+    {
+        return 0;
+    }
+
+    uint64_t capacity = m_samples.size();
+    uint64_t writePosition = m_writePosition.load(std::memory_order_relaxed);
+    uint64_t readPosition = m_readPosition.load(std::memory_order_acquire);
+
+    // whole frames only, so the consumer never sees half a frame
+    uint64_t available = capacity - (writePosition - readPosition);
+    uint32_t toWrite = static_cast<uint32_t>(min(static_cast<uint64_t>(count), available));
+    toWrite -= toWrite % m_channelCount;
+
+    if (toWrite < count)
+    {
+        m_overruns.fetch_add(count - toWrite, std::memory_order_relaxed);
+    }
+
+    // the packet time also moves the time base, so clock drift doesn't accumulate
+    LONGLONG elapsed = static_cast<LONGLONG>((writePosition / m_channelCount) * 10000000ull / m_sampleRate);
+    m_timeBase.store(sampleTime - elapsed, std::memory_order_relaxed);
+
+    size_t offset = static_cast<size_t>(writePosition % capacity);
+    size_t first = min(static_cast<size_t>(toWrite), m_samples.size() - offset);
+    memcpy(m_samples.data() + offset, samples, first * sizeof(float));
+    memcpy(m_samples.data(), samples + first, (toWrite - first) * sizeof(float));
+
+    m_writePosition.store(writePosition + toWrite, std::memory_order_release);
+
+    return toWrite;
+}
+
+_Use_decl_annotations_
+uint32_t AudioRingBuffer::Read(
+    float* samples,
+    uint32_t count,
+    LONGLONG* timestamp)
+{
+    if (timestamp != nullptr)
+    {
+        *timestamp = 0;
+    }
+
+    if (samples == nullptr || m_samples.empty())
+    {
+        return 0;
+    }
+
+    uint64_t capacity = m_samples.size();
+    uint64_t readPosition = m_readPosition.load(std::memory_order_relaxed);
+    uint64_t writePosition = m_writePosition.load(std::memory_order_acquire);
+
+    uint32_t toRead = static_cast<uint32_t>(min(static_cast<uint64_t>(count), writePosition - readPosition));
+    toRead -= toRead % m_channelCount;
+
+    if (timestamp != nullptr)
+    {
+        *timestamp = PositionToTime(readPosition);
+    }
+
+    size_t offset = static_cast<size_t>(readPosition % capacity);
+    size_t first = min(static_cast<size_t>(toRead), m_samples.size() - offset);
+    memcpy(samples, m_samples.data() + offset, first * sizeof(float));
+    memcpy(samples + first, m_samples.data(), (toRead - first) * sizeof(float));
+
+    m_readPosition.store(readPosition + toRead, std::memory_order_release);
+
+    return toRead;
+}
+
+_Use_decl_annotations_
+LONGLONG AudioRingBuffer::PositionToTime(
+    uint64_t position) const
+{
+    LONGLONG elapsed = static_cast<LONGLONG>((position / m_channelCount) * 10000000ull / m_sampleRate);
+
+    return m_timeBase.load(std::memory_order_relaxed) + elapsed;
+}
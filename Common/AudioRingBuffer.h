@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#define MAX_AUDIO_BUFFER_MS 1000
+
+// interleaved float pcm between a media pipeline and the unity audio thread.
+// one producer and one consumer, no locks, when the buffer is full the newest
+// samples are dropped and counted as an overrun
+struct AudioRingBuffer : winrt::implements<AudioRingBuffer, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ uint32_t sampleRate,
+        _In_ uint32_t channelCount,
+        _In_ uint32_t milliseconds,
+        _Out_ winrt::com_ptr<AudioRingBuffer>& ringBuffer);
+
+    AudioRingBuffer();
+    virtual ~AudioRingBuffer() = default;
+
+    // producer, returns the number of samples stored
+    uint32_t Write(
+        _In_reads_(count) float const* samples,
+        _In_ uint32_t count,
+        _In_ LONGLONG sampleTime);
+
+    // consumer, timestamp is the 100ns time of the first sample read
+    uint32_t Read(
+        _Out_writes_to_(count, return) float* samples,
+        _In_ uint32_t count,
+        _Out_ LONGLONG* timestamp);
+
+    uint32_t SampleRate() const { return m_sampleRate; }
+    uint32_t ChannelCount() const { return m_channelCount; }
+    uint32_t Milliseconds() const { return m_milliseconds; }
+    uint64_t Overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+
+private:
+    LONGLONG PositionToTime(
+        _In_ uint64_t position) const;
+
+private:
+    uint32_t m_sampleRate;
+    uint32_t m_channelCount;
+    uint32_t m_milliseconds;
+    std::vector<float> m_samples;
+
+    // keep the producer and consumer positions on separate cache lines
+    alignas(64) std::atomic<uint64_t> m_writePosition;
+    alignas(64) std::atomic<uint64_t> m_readPosition;
+    std::atomic<LONGLONG> m_timeBase;  // sample time of position 0
+    std::atomic<uint64_t> m_overruns;
+};
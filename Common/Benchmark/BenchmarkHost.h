@@ -0,0 +1,599 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+#include <d3d12.h>
+#include <crtdbg.h>
+
+#include "Unity/IUnityGraphics.h"
+#include "Unity/IUnityGraphicsD3D11.h"
+#include "Unity/IUnityGraphicsD3D12.h"
+#include "TexturePool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#pragma comment(lib, "d3d11")
+#pragma comment(lib, "d3d12")
+
+// how often the host issues a render event, faster than any stream so the loop adds no latency of its own
+#define BENCHMARK_FRAME_MILLISECONDS 2
+
+// frames left out of the numbers while the pipeline, pools and caches fill
+#define BENCHMARK_WARMUP_FRAMES 30
+
+// stands in for unity, one d3d11 device handed out through IUnityGraphicsD3D11, or a d3d12 device
+// and its queue through IUnityGraphicsD3D12v5, the plugin's exports looked up by name and a render
+// event per RunFrame. the main thread and the render thread are the same one here, like unity
+// with multithreaded rendering off, not thread safe
+struct BenchmarkHost
+{
+    static BenchmarkHost& Instance()
+    {
+        static BenchmarkHost s_host;
+
+        return s_host;
+    }
+
+    BenchmarkHost()
+        : m_plugin(nullptr)
+        , m_pluginUnload(nullptr)
+        , m_renderEvent(nullptr)
+        , m_deviceEventCallback(nullptr)
+        , m_renderer(kUnityGfxRendererD3D11)
+        , m_frameId(0)
+    {
+        m_interfaces.GetInterface = GetInterface;
+        m_interfaces.RegisterInterface = RegisterInterface;
+        m_interfaces.GetInterfaceSplit = GetInterfaceSplit;
+        m_interfaces.RegisterInterfaceSplit = RegisterInterfaceSplit;
+
+        m_graphics.GetRenderer = GetRenderer;
+        m_graphics.RegisterDeviceEventCallback = RegisterDeviceEventCallback;
+        m_graphics.UnregisterDeviceEventCallback = UnregisterDeviceEventCallback;
+        m_graphics.ReserveEventIDRange = ReserveEventIDRange;
+
+        m_graphicsD3D11.GetDevice = GetDevice;
+        m_graphicsD3D11.TextureFromRenderBuffer = TextureFromRenderBuffer;
+        m_graphicsD3D11.TextureFromNativeTexture = TextureFromNativeTexture;
+        m_graphicsD3D11.RTVFromRenderBuffer = RTVFromRenderBuffer;
+        m_graphicsD3D11.SRVFromNativeTexture = SRVFromNativeTexture;
+
+        m_graphicsD3D12.GetDevice = GetDevice12;
+        m_graphicsD3D12.GetFrameFence = GetFrameFence;
+        m_graphicsD3D12.GetNextFrameFenceValue = GetNextFrameFenceValue;
+        m_graphicsD3D12.ExecuteCommandList = ExecuteCommandList;
+        m_graphicsD3D12.SetPhysicalVideoMemoryControlValues = SetPhysicalVideoMemoryControlValues;
+        m_graphicsD3D12.GetCommandQueue = GetCommandQueue;
+        m_graphicsD3D12.TextureFromRenderBuffer = TextureFromRenderBuffer12;
+    }
+
+    // loads the plugin the way unity does, UnityPluginLoad initializes it on the host's device
+    HRESULT Load(
+        _In_ LPCWSTR pluginPath,
+        _In_ UnityGfxRenderer renderer = kUnityGfxRendererD3D11)
+    {
+        m_renderer = renderer;
+
+        if (m_renderer == kUnityGfxRendererD3D12)
+        {
+            IFR(CreateDevice12());
+        }
+        else
+        {
+            IFR(CreateDevice11());
+        }
+
+        m_plugin = LoadLibraryW(pluginPath);
+        NULL_CHK_HR(m_plugin, HRESULT_FROM_WIN32(GetLastError()));
+
+        auto pluginLoad = reinterpret_cast<decltype(&UnityPluginLoad)>(GetProcAddress(m_plugin, "UnityPluginLoad"));
+        NULL_CHK_HR(pluginLoad, HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND));
+
+        m_pluginUnload = reinterpret_cast<decltype(&UnityPluginUnload)>(GetProcAddress(m_plugin, "UnityPluginUnload"));
+        NULL_CHK_HR(m_pluginUnload, HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND));
+
+        auto getRenderEventFunc = reinterpret_cast<UnityRenderingEvent(UNITY_INTERFACE_API*)()>(GetProcAddress(m_plugin, "GetRenderEventFunc"));
+        NULL_CHK_HR(getRenderEventFunc, HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND));
+
+        m_renderEvent = getRenderEventFunc();
+
+        pluginLoad(&m_interfaces);
+
+        return S_OK;
+    }
+
+    // what unity raises around a lost device, the same device comes back here, what the plugin
+    // made on it is still released and made again
+    void ResetDevice()
+    {
+        if (m_deviceEventCallback != nullptr)
+        {
+            m_deviceEventCallback(kUnityGfxDeviceEventBeforeReset);
+            m_deviceEventCallback(kUnityGfxDeviceEventAfterReset);
+        }
+    }
+
+    // unity's device goes away before the plugin is unloaded
+    void Unload()
+    {
+        if (m_plugin == nullptr)
+        {
+            return;
+        }
+
+        if (m_deviceEventCallback != nullptr)
+        {
+            m_deviceEventCallback(kUnityGfxDeviceEventShutdown);
+        }
+
+        m_pluginUnload();
+
+        FreeLibrary(m_plugin);
+        m_plugin = nullptr;
+
+        m_context = nullptr;
+        m_device = nullptr;
+        m_queue12 = nullptr;
+        m_fence12 = nullptr;
+        m_device12 = nullptr;
+    }
+
+    template <typename TExport>
+    HRESULT GetExport(
+        _In_ char const* name,
+        _Out_ TExport& pluginExport)
+    {
+        pluginExport = reinterpret_cast<TExport>(GetProcAddress(m_plugin, name));
+        NULL_CHK_HR(pluginExport, HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND));
+
+        return S_OK;
+    }
+
+    // one unity frame, the render event for every instance and the frame's work handed to the gpu,
+    // on d3d12 the plugin's Synchronize already queued its wait on the host's queue
+    void RunFrame()
+    {
+        ++m_frameId;
+
+        m_renderEvent(static_cast<int>((static_cast<uint32_t>(m_frameId) << 16) | static_cast<uint16_t>(INSTANCE_HANDLE_BROADCAST)));
+
+        if (m_context != nullptr)
+        {
+            m_context->Flush();
+        }
+
+        Sleep(BENCHMARK_FRAME_MILLISECONDS);
+    }
+
+private:
+    HRESULT CreateDevice11()
+    {
+        // what unity asks for, bgra for the textures the plugins share with it
+        UINT flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+#if defined(_DEBUG)
+        flags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+
+        D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_1, D3D_FEATURE_LEVEL_11_0, D3D_FEATURE_LEVEL_10_1, D3D_FEATURE_LEVEL_10_0 };
+
+        HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, flags, featureLevels, ARRAYSIZE(featureLevels), D3D11_SDK_VERSION, m_device.put(), nullptr, m_context.put());
+        if (FAILED(hr) && (flags & D3D11_CREATE_DEVICE_DEBUG) != 0)
+        {
+            // no sdk layers installed
+            flags &= ~D3D11_CREATE_DEVICE_DEBUG;
+
+            hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, flags, featureLevels, ARRAYSIZE(featureLevels), D3D11_SDK_VERSION, m_device.put(), nullptr, m_context.put());
+        }
+        IFR(hr);
+
+        return S_OK;
+    }
+
+    // the debug layer catches a texture the plugin released while unity's queue still had it
+    HRESULT CreateDevice12()
+    {
+#if defined(_DEBUG)
+        winrt::com_ptr<ID3D12Debug> debug = nullptr;
+        if (SUCCEEDED(D3D12GetDebugInterface(__uuidof(ID3D12Debug), debug.put_void())))
+        {
+            debug->EnableDebugLayer();
+        }
+#endif
+
+        IFR(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, __uuidof(ID3D12Device), m_device12.put_void()));
+
+        D3D12_COMMAND_QUEUE_DESC queueDesc{};
+        queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+        IFR(m_device12->CreateCommandQueue(&queueDesc, __uuidof(ID3D12CommandQueue), m_queue12.put_void()));
+
+        IFR(m_device12->CreateFence(0, D3D12_FENCE_FLAG_NONE, __uuidof(ID3D12Fence), m_fence12.put_void()));
+
+        return S_OK;
+    }
+
+    static IUnityInterface* UNITY_INTERFACE_API GetInterface(UnityInterfaceGUID guid)
+    {
+        return GetInterfaceSplit(guid.m_GUIDHigh, guid.m_GUIDLow);
+    }
+
+    static void UNITY_INTERFACE_API RegisterInterface(UnityInterfaceGUID guid, IUnityInterface* ptr)
+    {
+        UNREFERENCED_PARAMETER(guid);
+        UNREFERENCED_PARAMETER(ptr);
+    }
+
+    // only the renderer's own interface, the others are unavailable like on a player
+    static IUnityInterface* UNITY_INTERFACE_API GetInterfaceSplit(unsigned long long guidHigh, unsigned long long guidLow)
+    {
+        UnityInterfaceGUID guid(guidHigh, guidLow);
+        if (guid == UNITY_GET_INTERFACE_GUID(IUnityGraphics))
+        {
+            return &Instance().m_graphics;
+        }
+        else if (guid == UNITY_GET_INTERFACE_GUID(IUnityGraphicsD3D11) && Instance().m_renderer == kUnityGfxRendererD3D11)
+        {
+            return &Instance().m_graphicsD3D11;
+        }
+        else if (guid == UNITY_GET_INTERFACE_GUID(IUnityGraphicsD3D12v5) && Instance().m_renderer == kUnityGfxRendererD3D12)
+        {
+            return &Instance().m_graphicsD3D12;
+        }
+
+        return nullptr;
+    }
+
+    static void UNITY_INTERFACE_API RegisterInterfaceSplit(unsigned long long guidHigh, unsigned long long guidLow, IUnityInterface* ptr)
+    {
+        UNREFERENCED_PARAMETER(guidHigh);
+        UNREFERENCED_PARAMETER(guidLow);
+        UNREFERENCED_PARAMETER(ptr);
+    }
+
+    static UnityGfxRenderer UNITY_INTERFACE_API GetRenderer()
+    {
+        return Instance().m_renderer;
+    }
+
+    // one plugin per host, the initialize event is raised by UnityPluginLoad itself
+    static void UNITY_INTERFACE_API RegisterDeviceEventCallback(IUnityGraphicsDeviceEventCallback callback)
+    {
+        Instance().m_deviceEventCallback = callback;
+    }
+
+    static void UNITY_INTERFACE_API UnregisterDeviceEventCallback(IUnityGraphicsDeviceEventCallback callback)
+    {
+        if (Instance().m_deviceEventCallback == callback)
+        {
+            Instance().m_deviceEventCallback = nullptr;
+        }
+    }
+
+    static int UNITY_INTERFACE_API ReserveEventIDRange(int count)
+    {
+        UNREFERENCED_PARAMETER(count);
+
+        return 0;
+    }
+
+    static ID3D11Device* UNITY_INTERFACE_API GetDevice()
+    {
+        return Instance().m_device.get();
+    }
+
+    // the plugins hand textures to unity, they never ask for unity's
+    static ID3D11Resource* UNITY_INTERFACE_API TextureFromRenderBuffer(UnityRenderBuffer buffer)
+    {
+        UNREFERENCED_PARAMETER(buffer);
+
+        return nullptr;
+    }
+
+    static ID3D11Resource* UNITY_INTERFACE_API TextureFromNativeTexture(UnityTextureID texture)
+    {
+        UNREFERENCED_PARAMETER(texture);
+
+        return nullptr;
+    }
+
+    static ID3D11RenderTargetView* UNITY_INTERFACE_API RTVFromRenderBuffer(UnityRenderBuffer surface)
+    {
+        UNREFERENCED_PARAMETER(surface);
+
+        return nullptr;
+    }
+
+    static ID3D11ShaderResourceView* UNITY_INTERFACE_API SRVFromNativeTexture(UnityTextureID texture)
+    {
+        UNREFERENCED_PARAMETER(texture);
+
+        return nullptr;
+    }
+
+    static ID3D12Device* UNITY_INTERFACE_API GetDevice12()
+    {
+        return Instance().m_device12.get();
+    }
+
+    // the host draws nothing, its frame fence never moves
+    static ID3D12Fence* UNITY_INTERFACE_API GetFrameFence()
+    {
+        return Instance().m_fence12.get();
+    }
+
+    static UINT64 UNITY_INTERFACE_API GetNextFrameFenceValue()
+    {
+        return Instance().m_fence12->GetCompletedValue() + 1;
+    }
+
+    // the plugins order their work through the queue's fence wait, they never hand over a list
+    static UINT64 UNITY_INTERFACE_API ExecuteCommandList(ID3D12GraphicsCommandList* commandList, int stateCount, UnityGraphicsD3D12ResourceState* states)
+    {
+        UNREFERENCED_PARAMETER(commandList);
+        UNREFERENCED_PARAMETER(stateCount);
+        UNREFERENCED_PARAMETER(states);
+
+        return 0;
+    }
+
+    static void UNITY_INTERFACE_API SetPhysicalVideoMemoryControlValues(UnityGraphicsD3D12PhysicalVideoMemoryControlValues const* memInfo)
+    {
+        UNREFERENCED_PARAMETER(memInfo);
+    }
+
+    static ID3D12CommandQueue* UNITY_INTERFACE_API GetCommandQueue()
+    {
+        return Instance().m_queue12.get();
+    }
+
+    static ID3D12Resource* UNITY_INTERFACE_API TextureFromRenderBuffer12(UnityRenderBuffer* buffer)
+    {
+        UNREFERENCED_PARAMETER(buffer);
+
+        return nullptr;
+    }
+
+private:
+    IUnityInterfaces m_interfaces{};
+    IUnityGraphics m_graphics{};
+    IUnityGraphicsD3D11 m_graphicsD3D11{};
+    IUnityGraphicsD3D12v5 m_graphicsD3D12{};
+
+    winrt::com_ptr<ID3D11Device> m_device;
+    winrt::com_ptr<ID3D11DeviceContext> m_context;
+
+    winrt::com_ptr<ID3D12Device> m_device12;
+    winrt::com_ptr<ID3D12CommandQueue> m_queue12;
+    winrt::com_ptr<ID3D12Fence> m_fence12;
+
+    HMODULE m_plugin;
+    decltype(&UnityPluginUnload) m_pluginUnload;
+    UnityRenderingEvent m_renderEvent;
+    IUnityGraphicsDeviceEventCallback m_deviceEventCallback;
+    UnityGfxRenderer m_renderer;
+    uint16_t m_frameId;
+};
+
+// qpc, the clock the plugins stamp their frames with
+inline int64_t BenchmarkTicks()
+{
+    LARGE_INTEGER ticks{};
+    QueryPerformanceCounter(&ticks);
+
+    return ticks.QuadPart;
+}
+
+inline double BenchmarkMilliseconds(int64_t ticks)
+{
+    LARGE_INTEGER frequency{};
+    QueryPerformanceFrequency(&frequency);
+
+    return static_cast<double>(ticks) * 1000.0 / static_cast<double>(frequency.QuadPart);
+}
+
+// allocations through the crt the exe and the plugin share, counted by the debug heap's hook so
+// only a debug build has them, what the os components allocate on their side isn't seen
+struct AllocationCounter
+{
+    static AllocationCounter& Instance()
+    {
+        static AllocationCounter s_counter;
+
+        return s_counter;
+    }
+
+    static bool IsAvailable()
+    {
+#if defined(_DEBUG)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Start()
+    {
+        m_allocations = 0;
+        m_bytes = 0;
+
+#if defined(_DEBUG)
+        _CrtSetAllocHook(AllocHook);
+#endif
+    }
+
+    void Stop()
+    {
+#if defined(_DEBUG)
+        _CrtSetAllocHook(nullptr);
+#endif
+    }
+
+    uint64_t Allocations() const { return m_allocations; }
+    uint64_t Bytes() const { return m_bytes; }
+
+private:
+#if defined(_DEBUG)
+    // runs inside the allocator, nothing here may allocate
+    static int __cdecl AllocHook(int allocType, void* userData, size_t size, int blockType, long requestNumber, unsigned char const* filename, int lineNumber)
+    {
+        UNREFERENCED_PARAMETER(userData);
+        UNREFERENCED_PARAMETER(requestNumber);
+        UNREFERENCED_PARAMETER(filename);
+        UNREFERENCED_PARAMETER(lineNumber);
+
+        if ((allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) && blockType != _CRT_BLOCK)
+        {
+            ++Instance().m_allocations;
+            Instance().m_bytes += size;
+        }
+
+        return TRUE;
+    }
+#endif
+
+private:
+    std::atomic<uint64_t> m_allocations{ 0 };
+    std::atomic<uint64_t> m_bytes{ 0 };
+};
+
+// what one run measured, printed as a line per figure, the per frame times in milliseconds
+struct BenchmarkResult
+{
+    BenchmarkResult(
+        _In_ std::wstring const& name,
+        _In_ std::wstring const& timeName)
+        : m_name(name)
+        , m_timeName(timeName)
+        , m_frameCount(0)
+        , m_startTicks(0)
+        , m_endTicks(0)
+        , m_allocations(0)
+        , m_allocatedBytes(0)
+        , m_textureAllocations(0)
+        , m_hasMemoryStats(false)
+    {
+    }
+
+    // from the first frame after the warmup, allocation counts start here too, the samples are
+    // reserved up front so the run's own bookkeeping isn't counted, the texture pool's misses
+    // are only reported for plugins that have one
+    void Start(
+        _In_ uint32_t frameCount,
+        _In_opt_ TEXTURE_MEMORY_STATS const* memoryStats)
+    {
+        m_frameCount = 0;
+        m_times.clear();
+        m_times.reserve(frameCount);
+        m_startTicks = BenchmarkTicks();
+        m_hasMemoryStats = memoryStats != nullptr;
+        if (m_hasMemoryStats)
+        {
+            m_startMemoryStats = *memoryStats;
+        }
+
+        AllocationCounter::Instance().Start();
+    }
+
+    void Stop(
+        _In_opt_ TEXTURE_MEMORY_STATS const* memoryStats)
+    {
+        m_endTicks = BenchmarkTicks();
+
+        AllocationCounter::Instance().Stop();
+
+        m_allocations = AllocationCounter::Instance().Allocations();
+        m_allocatedBytes = AllocationCounter::Instance().Bytes();
+        if (m_hasMemoryStats && memoryStats != nullptr)
+        {
+            m_textureAllocations = memoryStats->misses - m_startMemoryStats.misses;
+        }
+    }
+
+    // a frame done, with the time the run is about
+    void AddFrame(
+        _In_ double milliseconds)
+    {
+        ++m_frameCount;
+
+        m_times.push_back(milliseconds);
+    }
+
+    uint32_t FrameCount() const { return m_frameCount; }
+
+    void Print() const
+    {
+        double seconds = BenchmarkMilliseconds(m_endTicks - m_startTicks) / 1000.0;
+        double frames = m_frameCount > 0 ? static_cast<double>(m_frameCount) : 1.0;
+
+        wprintf(L"%s\n", m_name.c_str());
+        wprintf(L"  frames                  %u in %.2f s\n", m_frameCount, seconds);
+        wprintf(L"  throughput              %.1f frames/s\n", seconds > 0.0 ? m_frameCount / seconds : 0.0);
+        wprintf(L"  %-22s p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", m_timeName.c_str(), Percentile(0.50), Percentile(0.99), Percentile(1.0));
+
+        if (AllocationCounter::IsAvailable())
+        {
+            wprintf(L"  allocations per frame   %.1f, %.0f bytes\n", m_allocations / frames, m_allocatedBytes / frames);
+        }
+        else
+        {
+            wprintf(L"  allocations per frame   n/a, counted by debug builds\n");
+        }
+
+        if (m_hasMemoryStats)
+        {
+            wprintf(L"  textures per frame      %.3f allocated outside the pool\n", m_textureAllocations / frames);
+        }
+    }
+
+private:
+    // nearest rank
+    double Percentile(double percentile) const
+    {
+        if (m_times.empty())
+        {
+            return 0.0;
+        }
+
+        std::vector<double> sorted(m_times);
+        std::sort(sorted.begin(), sorted.end());
+
+        size_t rank = static_cast<size_t>(percentile * static_cast<double>(sorted.size() - 1) + 0.5);
+
+        return sorted[(std::min)(rank, sorted.size() - 1)];
+    }
+
+private:
+    std::wstring m_name;
+    std::wstring m_timeName;
+
+    uint32_t m_frameCount;
+    std::vector<double> m_times;
+    int64_t m_startTicks;
+    int64_t m_endTicks;
+
+    TEXTURE_MEMORY_STATS m_startMemoryStats{};
+    uint64_t m_allocations;
+    uint64_t m_allocatedBytes;
+    uint64_t m_textureAllocations;
+    bool m_hasMemoryStats;
+};
+
+// the directory the benchmark runs from, where the post build step puts the plugin and its inputs
+inline std::wstring BenchmarkDirectory()
+{
+    wchar_t modulePath[MAX_PATH]{};
+    if (GetModuleFileNameW(nullptr, modulePath, ARRAYSIZE(modulePath)) == 0)
+    {
+        return std::wstring();
+    }
+
+    std::wstring directory(modulePath);
+
+    return directory.substr(0, directory.find_last_of(L"\\/"));
+}
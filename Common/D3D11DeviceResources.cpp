@@ -27,12 +27,14 @@ void D3D11DeviceResources::ProcessDeviceEvent(
     UnityGfxDeviceEventType type,
     IUnityInterfaces* interfaces)
 {
-    auto gurad = m_cs.Guard();
+    std::lock_guard<winrt::slim_mutex> guard(m_mutex);
 
     switch (type)
     {
     case kUnityGfxDeviceEventInitialize:
+    case kUnityGfxDeviceEventAfterReset:
     {
+        // the device can be a different one after a reset
         IUnityGraphicsD3D11* d3d = interfaces->Get<IUnityGraphicsD3D11>();
         if (d3d != nullptr)
         {
@@ -55,16 +57,12 @@ void D3D11DeviceResources::ProcessDeviceEvent(
     {
         break;
     }
-    case kUnityGfxDeviceEventAfterReset:
-    {
-        break;
-    }
     }
 }
 
 bool D3D11DeviceResources::GetUsesReverseZ()
 {
-    auto gurad = m_cs.Guard();
+    std::shared_lock<winrt::slim_mutex> guard(m_mutex);
 
     return (int)m_unityDevice->GetFeatureLevel() >= (int)D3D_FEATURE_LEVEL_10_0;
 }
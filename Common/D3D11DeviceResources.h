@@ -5,6 +5,7 @@
 
 #include <d3d11_1.h>
 #include <DirectXMath.h>
+#include <shared_mutex>
 #include "PlatformBase.h"
 #include "UnityDeviceResource.h"
 
@@ -22,7 +23,7 @@ struct D3D11DeviceResources
     // ID3D11DeviceResource
     virtual winrt::com_ptr<ID3D11Device> __stdcall GetDevice() override
     {
-        auto gurad = m_cs.Guard();
+        std::shared_lock<winrt::slim_mutex> guard(m_mutex);
 
         return m_unityDevice;
     }
@@ -31,13 +32,12 @@ struct D3D11DeviceResources
     virtual void __stdcall ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces) override;
     virtual bool __stdcall GetUsesReverseZ() override;
 
-
 private:
     HRESULT InitializeResources(ID3D11Device* d3dDevice);
     void ReleaseResources();
 
 private:
-    CriticalSection m_cs;
+    winrt::slim_mutex m_mutex;
 
     winrt::com_ptr<ID3D11Device> m_unityDevice;
 };
@@ -0,0 +1,220 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "D3D12DeviceResources.h"
+#include "MediaDevice.h"
+#include "Unity/IUnityGraphicsD3D12.h"
+#include <dxgi1_4.h>
+
+#pragma comment(lib, "dxgi")
+
+using namespace winrt;
+
+// private data of a d3d11 texture, the d3d12 resource unity was handed for it
+// {6B2E3A4D-9C71-4F25-8E0B-1D5A7C3F92E4}
+static const GUID s_unityResourceGuid = { 0x6b2e3a4d, 0x9c71, 0x4f25, { 0x8e, 0x0b, 0x1d, 0x5a, 0x7c, 0x3f, 0x92, 0xe4 } };
+
+std::shared_ptr<IUnityDeviceResource> __stdcall CreateD3D12DeviceResources()
+{
+    return std::make_shared<D3D12DeviceResources>();
+}
+
+D3D12DeviceResources::D3D12DeviceResources()
+    : m_unityDevice(nullptr)
+    , m_unityQueue(nullptr)
+    , m_unityFence(nullptr)
+    , m_device(nullptr)
+    , m_context(nullptr)
+    , m_fence(nullptr)
+    , m_fenceValue(0)
+{
+}
+
+D3D12DeviceResources::~D3D12DeviceResources()
+{
+    ReleaseResources();
+}
+
+_Use_decl_annotations_
+void D3D12DeviceResources::ProcessDeviceEvent(
+    UnityGfxDeviceEventType type,
+    IUnityInterfaces* interfaces)
+{
+    std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+    switch (type)
+    {
+    case kUnityGfxDeviceEventInitialize:
+    {
+        // the queue is there from v4 on
+        ID3D12Device* device = nullptr;
+        ID3D12CommandQueue* commandQueue = nullptr;
+
+        IUnityGraphicsD3D12v5* d3d5 = interfaces->Get<IUnityGraphicsD3D12v5>();
+        if (d3d5 != nullptr)
+        {
+            device = d3d5->GetDevice();
+            commandQueue = d3d5->GetCommandQueue();
+        }
+        else
+        {
+            IUnityGraphicsD3D12v4* d3d4 = interfaces->Get<IUnityGraphicsD3D12v4>();
+            if (d3d4 != nullptr)
+            {
+                device = d3d4->GetDevice();
+                commandQueue = d3d4->GetCommandQueue();
+            }
+        }
+
+        if (device != nullptr && commandQueue != nullptr)
+        {
+            IFV(InitializeResources(device, commandQueue));
+        }
+
+        break;
+    }
+    case kUnityGfxDeviceEventShutdown:
+    {
+        ReleaseResources();
+
+        break;
+    }
+    case kUnityGfxDeviceEventBeforeReset:
+    {
+        break;
+    }
+    case kUnityGfxDeviceEventAfterReset:
+    {
+        break;
+    }
+    }
+}
+
+bool D3D12DeviceResources::GetUsesReverseZ()
+{
+    return true;
+}
+
+_Use_decl_annotations_
+HRESULT D3D12DeviceResources::GetUnityTexture(
+    ID3D11ShaderResourceView* textureSRV,
+    void** unityTexture)
+{
+    NULL_CHK_HR(textureSRV, E_INVALIDARG);
+    NULL_CHK_HR(unityTexture, E_POINTER);
+
+    *unityTexture = nullptr;
+
+    std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+    NULL_CHK_HR(m_unityDevice, E_NOT_VALID_STATE);
+
+    com_ptr<ID3D11Resource> resource = nullptr;
+    textureSRV->GetResource(resource.put());
+
+    // the texture holds the resource, it goes away with it
+    com_ptr<ID3D12Resource> unityResource = nullptr;
+    UINT dataSize = sizeof(IUnknown*);
+    if (FAILED(resource->GetPrivateData(s_unityResourceGuid, &dataSize, unityResource.put_void())) || unityResource == nullptr)
+    {
+        auto dxgiResource = resource.try_as<IDXGIResource1>();
+        NULL_CHK_HR(dxgiResource, E_NOINTERFACE);
+
+        HANDLE sharedHandle = nullptr;
+        IFR(dxgiResource->CreateSharedHandle(nullptr, DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE, nullptr, &sharedHandle));
+
+        HRESULT hr = m_unityDevice->OpenSharedHandle(sharedHandle, __uuidof(ID3D12Resource), unityResource.put_void());
+
+        CloseHandle(sharedHandle);
+
+        IFR(hr);
+
+        IFR(resource->SetPrivateDataInterface(s_unityResourceGuid, unityResource.get()));
+    }
+
+    *unityTexture = unityResource.get();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT D3D12DeviceResources::InitializeResources(
+    ID3D12Device* d3dDevice,
+    ID3D12CommandQueue* commandQueue)
+{
+    com_ptr<IDXGIFactory4> dxgiFactory = nullptr;
+    IFR(CreateDXGIFactory1(__uuidof(IDXGIFactory4), dxgiFactory.put_void()));
+
+    com_ptr<IDXGIAdapter> adapter = nullptr;
+    IFR(dxgiFactory->EnumAdapterByLuid(d3dDevice->GetAdapterLuid(), __uuidof(IDXGIAdapter), adapter.put_void()));
+
+    // multithread protected with video support, like the media device
+    com_ptr<ID3D11Device> device = nullptr;
+    IFR(CreateMediaDevice(adapter.get(), device.put()));
+
+    auto device5 = device.try_as<ID3D11Device5>();
+    NULL_CHK_HR(device5, E_NOINTERFACE);
+
+    com_ptr<ID3D11DeviceContext> context = nullptr;
+    device->GetImmediateContext(context.put());
+
+    auto context4 = context.try_as<ID3D11DeviceContext4>();
+    NULL_CHK_HR(context4, E_NOINTERFACE);
+
+    // signaled by the d3d11 device, waited on by unity's queue
+    com_ptr<ID3D12Fence> unityFence = nullptr;
+    IFR(d3dDevice->CreateFence(0, D3D12_FENCE_FLAG_SHARED, __uuidof(ID3D12Fence), unityFence.put_void()));
+
+    HANDLE fenceHandle = nullptr;
+    IFR(d3dDevice->CreateSharedHandle(unityFence.get(), nullptr, GENERIC_ALL, nullptr, &fenceHandle));
+
+    com_ptr<ID3D11Fence> fence = nullptr;
+    HRESULT hr = device5->OpenSharedFence(fenceHandle, __uuidof(ID3D11Fence), fence.put_void());
+
+    CloseHandle(fenceHandle);
+
+    IFR(hr);
+
+    m_unityDevice.copy_from(d3dDevice);
+    m_unityQueue.copy_from(commandQueue);
+    m_unityFence = unityFence;
+    m_device = device;
+    m_context = context4;
+    m_fence = fence;
+    m_fenceValue = 0;
+
+    return S_OK;
+}
+
+void D3D12DeviceResources::ReleaseResources()
+{
+    m_fence = nullptr;
+    m_context = nullptr;
+    m_device = nullptr;
+
+    m_unityFence = nullptr;
+    m_unityQueue = nullptr;
+    m_unityDevice = nullptr;
+}
+
+HRESULT D3D12DeviceResources::Synchronize()
+{
+    std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+    return SignalUnityQueue();
+}
+
+// under the lock, queue waits are strictly increasing
+HRESULT D3D12DeviceResources::SignalUnityQueue()
+{
+    NULL_CHK_HR(m_context, E_NOT_VALID_STATE);
+
+    IFR(m_context->Signal(m_fence.get(), ++m_fenceValue));
+
+    m_context->Flush();
+
+    IFR(m_unityQueue->Wait(m_unityFence.get(), m_fenceValue));
+
+    return S_OK;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11_4.h>
+#include <d3d12.h>
+#include "PlatformBase.h"
+#include "UnityDeviceResource.h"
+#include "D3D11DeviceResources.h"
+
+struct ID3D12DeviceResource
+{
+    virtual winrt::com_ptr<ID3D12Device> __stdcall GetDevice12() = 0;
+
+    // the d3d12 resource behind a view of a texture created with D3D11_RESOURCE_MISC_SHARED_NTHANDLE,
+    // opened the first time and kept with the texture, the lookup doesn't touch unity's queue,
+    // the render event's Synchronize orders the d3d11 work
+    virtual HRESULT __stdcall GetUnityTexture(_In_ ID3D11ShaderResourceView* textureSRV, _Out_ void** unityTexture) = 0;
+
+    // the d3d11 work submitted so far completes before unity's queue runs what comes next
+    virtual HRESULT __stdcall Synchronize() = 0;
+};
+
+// unity renders with d3d12, the modules keep a d3d11 device, one created on unity's adapter,
+// a fence shared with unity's device orders what it wrote before unity's queue reads it
+struct D3D12DeviceResources
+    : ID3D11DeviceResource, ID3D12DeviceResource, IUnityDeviceResource
+{
+    D3D12DeviceResources();
+    virtual ~D3D12DeviceResources();
+
+    // ID3D11DeviceResource
+    virtual winrt::com_ptr<ID3D11Device> __stdcall GetDevice() override
+    {
+        std::shared_lock<winrt::slim_mutex> guard(m_mutex);
+
+        return m_device;
+    }
+
+    // ID3D12DeviceResource
+    virtual winrt::com_ptr<ID3D12Device> __stdcall GetDevice12() override
+    {
+        std::shared_lock<winrt::slim_mutex> guard(m_mutex);
+
+        return m_unityDevice;
+    }
+    virtual HRESULT __stdcall GetUnityTexture(_In_ ID3D11ShaderResourceView* textureSRV, _Out_ void** unityTexture) override;
+    virtual HRESULT __stdcall Synchronize() override;
+
+    // IUnityDeviceResource
+    virtual void __stdcall ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInterfaces* interfaces) override;
+    virtual bool __stdcall GetUsesReverseZ() override;
+
+private:
+    HRESULT InitializeResources(ID3D12Device* d3dDevice, ID3D12CommandQueue* commandQueue);
+    void ReleaseResources();
+    HRESULT SignalUnityQueue();
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    winrt::com_ptr<ID3D12Device> m_unityDevice;
+    winrt::com_ptr<ID3D12CommandQueue> m_unityQueue;
+    winrt::com_ptr<ID3D12Fence> m_unityFence;
+
+    winrt::com_ptr<ID3D11Device> m_device;
+    winrt::com_ptr<ID3D11DeviceContext4> m_context;
+    winrt::com_ptr<ID3D11Fence> m_fence;
+    uint64_t m_fenceValue;
+};
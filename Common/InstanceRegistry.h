@@ -0,0 +1,220 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// instances alive at once, a handle is a slot and the generation it was handed out in
+#define INSTANCE_REGISTRY_CAPACITY 256
+
+// render events carry the handle in 16 bits, the generations that fit past INSTANCE_HANDLE_START
+#define INSTANCE_REGISTRY_GENERATIONS ((0x10000 - INSTANCE_HANDLE_START) / INSTANCE_REGISTRY_CAPACITY)
+
+// first handle past the registry's range, for handles that never reach a render event
+#define INSTANCE_REGISTRY_HANDLE_END (INSTANCE_HANDLE_START + INSTANCE_REGISTRY_GENERATIONS * INSTANCE_REGISTRY_CAPACITY)
+
+// fixed slots of instances behind generation tagged handles. lookups from any thread are wait
+// free and don't take a reference, a slot's reader count keeps its value alive while it's visited
+// and Remove waits for the readers that are already in. Add and Remove are serialized with each
+// other, a released handle stays invalid until its slot has gone through every generation.
+// a visit that removes its own handle never returns
+template <typename T>
+struct InstanceRegistry
+{
+    static_assert(INSTANCE_REGISTRY_GENERATIONS > 1, "InstanceRegistry capacity leaves no room for generations");
+
+    InstanceRegistry()
+        : m_nextSlot(0)
+    {
+    }
+
+    HRESULT Add(T const& value, _Out_ INSTANCE_HANDLE* handleId)
+    {
+        NULL_CHK_HR(value, E_INVALIDARG);
+        NULL_CHK_HR(handleId, E_POINTER);
+
+        *handleId = INSTANCE_HANDLE_INVALID;
+
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        // the slot past the last one handed out, so a released handle isn't reused right away
+        for (uint32_t i = 0; i < INSTANCE_REGISTRY_CAPACITY; ++i)
+        {
+            uint32_t index = (m_nextSlot + i) % INSTANCE_REGISTRY_CAPACITY;
+
+            auto& slot = m_slots[index];
+            if (slot.handle.load(std::memory_order_relaxed) != INSTANCE_HANDLE_INVALID)
+            {
+                continue;
+            }
+
+            auto handle = static_cast<INSTANCE_HANDLE>(INSTANCE_HANDLE_START + slot.generation * INSTANCE_REGISTRY_CAPACITY + index);
+
+            slot.value = value;
+
+            // publishes the value with the handle
+            slot.handle.store(handle, std::memory_order_release);
+
+            m_nextSlot = (index + 1) % INSTANCE_REGISTRY_CAPACITY;
+
+            *handleId = handle;
+
+            return S_OK;
+        }
+
+        return HRESULT_FROM_WIN32(ERROR_NO_MORE_ITEMS);
+    }
+
+    // a reference of its own for the caller
+    HRESULT Get(INSTANCE_HANDLE id, _Out_ T& value)
+    {
+        value = nullptr;
+
+        return Visit(id, [&value](T const& found)
+        {
+            value = found;
+        });
+    }
+
+    // fn gets the value without a reference being taken, Remove waits for it to return
+    template <typename Fn>
+    HRESULT Visit(INSTANCE_HANDLE id, Fn const& fn)
+    {
+        if (id < INSTANCE_HANDLE_START || id >= INSTANCE_REGISTRY_HANDLE_END)
+        {
+            IFR(E_INVALIDARG);
+        }
+
+        auto& slot = m_slots[static_cast<uint32_t>(id - INSTANCE_HANDLE_START) % INSTANCE_REGISTRY_CAPACITY];
+
+        // seen by Remove before it lets go of the value, or the handle is already gone
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+
+        HRESULT hr = HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+        if (slot.handle.load(std::memory_order_seq_cst) == id)
+        {
+            fn(slot.value);
+
+            hr = S_OK;
+        }
+
+        slot.readers.fetch_sub(1, std::memory_order_release);
+
+        return hr;
+    }
+
+    // every live value in slot order
+    template <typename Fn>
+    void ForEach(Fn const& fn)
+    {
+        for (auto& slot : m_slots)
+        {
+            if (slot.handle.load(std::memory_order_relaxed) == INSTANCE_HANDLE_INVALID)
+            {
+                continue;
+            }
+
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+
+            auto handle = slot.handle.load(std::memory_order_seq_cst);
+            if (handle != INSTANCE_HANDLE_INVALID)
+            {
+                fn(handle, slot.value);
+            }
+
+            slot.readers.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // the value goes to the caller once no reader is left in the slot
+    HRESULT Remove(INSTANCE_HANDLE id, _Out_ T& value)
+    {
+        value = nullptr;
+
+        if (id < INSTANCE_HANDLE_START || id >= INSTANCE_REGISTRY_HANDLE_END)
+        {
+            IFR(E_INVALIDARG);
+        }
+
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        auto& slot = m_slots[static_cast<uint32_t>(id - INSTANCE_HANDLE_START) % INSTANCE_REGISTRY_CAPACITY];
+        if (slot.handle.load(std::memory_order_relaxed) != id)
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+        }
+
+        Release(slot, value);
+
+        return S_OK;
+    }
+
+    // everything still registered, for unload
+    std::vector<T> Clear()
+    {
+        std::vector<T> values;
+
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        for (auto& slot : m_slots)
+        {
+            if (slot.handle.load(std::memory_order_relaxed) == INSTANCE_HANDLE_INVALID)
+            {
+                continue;
+            }
+
+            T value = nullptr;
+            Release(slot, value);
+
+            values.push_back(value);
+        }
+
+        m_nextSlot = 0;
+
+        return values;
+    }
+
+private:
+    struct Slot
+    {
+        Slot()
+            : value(nullptr)
+            , handle(INSTANCE_HANDLE_INVALID)
+            , readers(0)
+            , generation(0)
+        {
+        }
+
+        T value;
+        std::atomic<INSTANCE_HANDLE> handle;
+        std::atomic<uint32_t> readers;
+        uint32_t generation;
+    };
+
+    // under the lock
+    void Release(Slot& slot, T& value)
+    {
+        slot.handle.store(INSTANCE_HANDLE_INVALID, std::memory_order_seq_cst);
+
+        // a visit that got in before the handle was cleared, render events are short
+        while (slot.readers.load(std::memory_order_acquire) != 0)
+        {
+            YieldProcessor();
+        }
+
+        value = std::move(slot.value);
+        slot.value = nullptr;
+
+        slot.generation = (slot.generation + 1) % INSTANCE_REGISTRY_GENERATIONS;
+    }
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    std::array<Slot, INSTANCE_REGISTRY_CAPACITY> m_slots;
+    uint32_t m_nextSlot;
+};
@@ -0,0 +1,16 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11_4.h>
+
+// video capable, bgra capable and multithread protected, on the default hardware adapter
+// or warp when no adapter is given and the hardware one fails
+HRESULT CreateMediaDevice(
+    _In_opt_ IDXGIAdapter* pDXGIAdapter,
+    _COM_Outptr_ ID3D11Device** ppDevice);
+
+// applies to media devices created after the call, the default is on for debug builds only
+void SetMediaDeviceDebugLayer(
+    _In_ bool enable);
@@ -0,0 +1,246 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <windows.h>
+
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.System.Profile.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+// bumped when a key or a value changes meaning, a file from another version is dropped whole
+#define PIPELINE_CACHE_VERSION 1
+
+// a cache file is a few lines, anything bigger isn't one of ours
+#define PIPELINE_CACHE_MAX_BYTES (64 * 1024)
+
+extern "C" IMAGE_DOS_HEADER __ImageBase;
+
+// what a plugin found out on an earlier launch, device ids, profiles and api checks, so a cold
+// start doesn't wait on enumeration. one text file per dll in the app's local folder, stamped
+// with the cache version and the os build since either can change every answer in it. callers
+// still check what they read against the devices and store it again once it's known good, an
+// app without a local folder only caches in memory, thread safe
+struct PipelineCache
+{
+    static PipelineCache& Instance()
+    {
+        static PipelineCache s_cache;
+
+        return s_cache;
+    }
+
+    PipelineCache()
+        : m_isLoaded(false)
+    {
+    }
+
+    bool TryGet(std::wstring const& key, std::wstring& value)
+    {
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        Load();
+
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+        {
+            return false;
+        }
+
+        value = it->second;
+
+        return true;
+    }
+
+    // written through, the file only changes when a value does
+    void Set(std::wstring const& key, std::wstring const& value)
+    {
+        // one entry per line, the key ends at the first tab
+        if (key.empty() || key.find_first_of(L"\t\r\n") != std::wstring::npos || value.find_first_of(L"\r\n") != std::wstring::npos)
+        {
+            return;
+        }
+
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        Load();
+
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second == value)
+        {
+            return;
+        }
+
+        m_entries[key] = value;
+
+        Save();
+    }
+
+    // true when there was an entry to drop
+    bool Remove(std::wstring const& key)
+    {
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        Load();
+
+        if (m_entries.erase(key) == 0)
+        {
+            return false;
+        }
+
+        Save();
+
+        return true;
+    }
+
+private:
+    // called with the lock held, the first lookup reads the file
+    void Load()
+    {
+        if (m_isLoaded)
+        {
+            return;
+        }
+
+        m_isLoaded = true;
+
+        m_stamp = L"PipelineCache " + std::to_wstring(PIPELINE_CACHE_VERSION);
+        try
+        {
+            m_stamp += L" " + std::wstring(winrt::Windows::System::Profile::AnalyticsInfo::VersionInfo().DeviceFamilyVersion());
+        }
+        catch (winrt::hresult_error const&)
+        {
+            // no os build to compare against, a stale file can't be told apart
+            return;
+        }
+
+        // named after the dll, the plugins don't share their files
+        wchar_t modulePath[MAX_PATH]{};
+        if (GetModuleFileNameW(reinterpret_cast<HMODULE>(&__ImageBase), modulePath, ARRAYSIZE(modulePath)) == 0)
+        {
+            return;
+        }
+
+        std::wstring moduleName(modulePath);
+        moduleName = moduleName.substr(moduleName.find_last_of(L"\\/") + 1);
+        moduleName = moduleName.substr(0, moduleName.find_last_of(L'.'));
+
+        try
+        {
+            m_path = std::wstring(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path()) + L"\\" + moduleName + L".pipeline.cache";
+        }
+        catch (winrt::hresult_error const&)
+        {
+            // not packaged, memory only
+            return;
+        }
+
+        HANDLE file = CreateFile2(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        std::string text;
+
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= PIPELINE_CACHE_MAX_BYTES)
+        {
+            text.resize(static_cast<size_t>(size.QuadPart));
+
+            DWORD bytesRead = 0;
+            if (!ReadFile(file, &text[0], static_cast<DWORD>(text.size()), &bytesRead, nullptr))
+            {
+                bytesRead = 0;
+            }
+
+            text.resize(bytesRead);
+        }
+
+        CloseHandle(file);
+
+        std::wstring contents(winrt::to_hstring(text));
+
+        size_t lineStart = 0;
+        bool isStamped = false;
+        while (lineStart < contents.size())
+        {
+            size_t lineEnd = contents.find(L'\n', lineStart);
+            if (lineEnd == std::wstring::npos)
+            {
+                lineEnd = contents.size();
+            }
+
+            std::wstring line = contents.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            // another version or os build, nothing in it can be trusted
+            if (!isStamped)
+            {
+                if (line != m_stamp)
+                {
+                    break;
+                }
+
+                isStamped = true;
+
+                continue;
+            }
+
+            size_t separator = line.find(L'\t');
+            if (separator != std::wstring::npos && separator > 0)
+            {
+                m_entries[line.substr(0, separator)] = line.substr(separator + 1);
+            }
+        }
+    }
+
+    // called with the lock held, a crash halfway leaves the old file since the new one is moved over it
+    void Save()
+    {
+        if (m_path.empty())
+        {
+            return;
+        }
+
+        std::wstring contents = m_stamp + L"\n";
+        for (auto const& kv : m_entries)
+        {
+            contents += kv.first + L"\t" + kv.second + L"\n";
+        }
+
+        std::string text = winrt::to_string(contents);
+
+        std::wstring tempPath = m_path + L".tmp";
+
+        HANDLE file = CreateFile2(tempPath.c_str(), GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        DWORD bytesWritten = 0;
+        bool isWritten = WriteFile(file, text.data(), static_cast<DWORD>(text.size()), &bytesWritten, nullptr)
+            && bytesWritten == text.size();
+
+        CloseHandle(file);
+
+        if (!isWritten || !MoveFileExW(tempPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            DeleteFileW(tempPath.c_str());
+        }
+    }
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    bool m_isLoaded;
+    std::wstring m_stamp;
+    std::wstring m_path;
+    std::map<std::wstring, std::wstring> m_entries;
+};
@@ -0,0 +1,348 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "Plugin.Module.h"
+#if __has_include("Plugin.Module.g.cpp")
+#include "Plugin.Module.g.cpp"
+#endif
+
+using namespace winrt;
+using namespace PLUGIN_NAMESPACE::Plugin::implementation;
+using namespace Windows::Foundation;
+
+_Use_decl_annotations_
+void Module::Shutdown()
+{
+    std::vector<CALLBACK_STATE> dropped;
+    {
+        std::lock_guard<slim_mutex> guard(m_mailboxMutex);
+
+        dropped.assign(m_mailbox.begin(), m_mailbox.end());
+        m_mailbox.clear();
+    }
+    DropStates(dropped);
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_deviceResources.reset();
+    m_d3d11DeviceResources.reset();
+    m_d3d12DeviceResources.reset();
+}
+
+_Use_decl_annotations_
+void Module::OnRenderEvent(
+    uint16_t frameNumber)
+{
+    std::shared_lock<slim_mutex> slock(m_mutex);
+
+    UNREFERENCED_PARAMETER(frameNumber);
+}
+
+_Use_decl_annotations_
+hresult Module::Initialize(
+    std::weak_ptr<IUnityDeviceResource> const& unityDevice,
+    StateChangedCallback stateCallback,
+    void* pCallbackObject)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    NULL_CHK_HR(stateCallback, E_INVALIDARG);
+
+    auto resources = unityDevice.lock();
+    if (resources != nullptr)
+    {
+        m_pClientObject = pCallbackObject;
+        m_stateCallbacks = stateCallback;
+        m_deviceResources = unityDevice;
+        m_d3d11DeviceResources = std::dynamic_pointer_cast<ID3D11DeviceResource>(resources);
+        m_d3d12DeviceResources = std::dynamic_pointer_cast<ID3D12DeviceResource>(resources);
+    }
+
+    return S_OK;
+}
+
+void Module::DeviceResetStarted()
+{
+    OnDeviceResetStarted();
+}
+
+_Use_decl_annotations_
+void Module::DeviceResetCompleted(
+    std::weak_ptr<IUnityDeviceResource> const& unityDevice)
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        auto resources = unityDevice.lock();
+
+        m_deviceResources = unityDevice;
+        m_d3d11DeviceResources = std::dynamic_pointer_cast<ID3D11DeviceResource>(resources);
+        m_d3d12DeviceResources = std::dynamic_pointer_cast<ID3D12DeviceResource>(resources);
+    }
+
+    // not under the module lock, the hooks take their own
+    OnDeviceResetCompleted();
+}
+
+_Use_decl_annotations_
+void* Module::GetUnityTexture(
+    ID3D11ShaderResourceView* textureSRV)
+{
+    if (textureSRV == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto resources = m_d3d12DeviceResources.lock();
+    if (resources == nullptr)
+    {
+        return textureSRV;
+    }
+
+    // not shareable, unity gets nothing rather than a view it can't use
+    void* unityTexture = nullptr;
+    if (FAILED(resources->GetUnityTexture(textureSRV, &unityTexture)))
+    {
+        return nullptr;
+    }
+
+    return unityTexture;
+}
+
+_Use_decl_annotations_
+void* Module::AddRefUnityTexture(
+    ID3D11ShaderResourceView* textureSRV)
+{
+    void* unityTexture = GetUnityTexture(textureSRV);
+    if (unityTexture != nullptr)
+    {
+        static_cast<IUnknown*>(unityTexture)->AddRef();
+    }
+
+    return unityTexture;
+}
+
+UINT Module::GetUnityTextureMiscFlags()
+{
+    return m_d3d12DeviceResources.expired() ? 0 : D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+}
+
+_Use_decl_annotations_
+hresult Module::Callback(
+    CALLBACK_STATE state)
+{
+    PLUGIN_TRACE_SCOPE("Module.Callback", PLUGIN_TRACE_KEYWORD_CALLBACK);
+
+    bool queued = false;
+    std::vector<CALLBACK_STATE> dropped;
+    {
+        std::lock_guard<slim_mutex> guard(m_mailboxMutex);
+
+        if (m_callbackMode == CallbackMode::Polled)
+        {
+            QueueState(state, dropped);
+
+            queued = true;
+        }
+    }
+
+    // the producer may hold its own lock, which a dropped state can need
+    if (queued)
+    {
+        DropStates(dropped);
+
+        return S_OK;
+    }
+
+    std::shared_lock<slim_mutex> slock(m_mutex);
+
+    NULL_CHK_HR(m_stateCallbacks, S_OK);
+
+    m_stateCallbacks(m_pClientObject, state);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+hresult Module::Failed(hresult hr)
+{
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Failed;
+
+    ZeroMemory(&state.value.failedState, sizeof(FAILED_STATE));
+    state.value.failedState.hresult = hr;
+
+    bool queued = false;
+    std::vector<CALLBACK_STATE> dropped;
+    {
+        std::lock_guard<slim_mutex> guard(m_mailboxMutex);
+
+        if (m_callbackMode == CallbackMode::Polled)
+        {
+            QueueState(state, dropped);
+
+            queued = true;
+        }
+    }
+
+    if (queued)
+    {
+        DropStates(dropped);
+
+        return hr;
+    }
+
+    std::shared_lock<slim_mutex> slock(m_mutex);
+
+    NULL_CHK_HR(m_stateCallbacks, E_NOT_VALID_STATE);
+
+    m_stateCallbacks(m_pClientObject, state);
+
+    return state.value.failedState.hresult;
+}
+
+// nothing reaches the client after this returns, the client object may be freed
+void Module::DetachCallbacks()
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        m_stateCallbacks = nullptr;
+        m_pClientObject = nullptr;
+    }
+
+    std::vector<CALLBACK_STATE> dropped;
+    {
+        std::lock_guard<slim_mutex> guard(m_mailboxMutex);
+
+        dropped.assign(m_mailbox.begin(), m_mailbox.end());
+        m_mailbox.clear();
+    }
+    DropStates(dropped);
+}
+
+_Use_decl_annotations_
+hresult Module::SetCallbackMode(
+    CallbackMode mode)
+{
+    if (mode != CallbackMode::Immediate && mode != CallbackMode::Polled)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    std::vector<CALLBACK_STATE> pending;
+    {
+        std::lock_guard<slim_mutex> guard(m_mailboxMutex);
+
+        m_callbackMode = mode;
+
+        // leaving polled mode, what was queued goes out on this thread
+        if (mode == CallbackMode::Immediate)
+        {
+            pending.assign(m_mailbox.begin(), m_mailbox.end());
+            m_mailbox.clear();
+        }
+    }
+
+    std::vector<CALLBACK_STATE> dropped;
+    {
+        std::shared_lock<slim_mutex> slock(m_mutex);
+
+        for (auto const& state : pending)
+        {
+            if (m_stateCallbacks != nullptr)
+            {
+                m_stateCallbacks(m_pClientObject, state);
+            }
+            else
+            {
+                dropped.push_back(state);
+            }
+        }
+    }
+    DropStates(dropped);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+hresult Module::PollState(
+    CALLBACK_STATE* pStates,
+    uint32_t capacity,
+    uint32_t* pStateCount)
+{
+    NULL_CHK_HR(pStateCount, E_INVALIDARG);
+
+    *pStateCount = 0;
+
+    if (capacity > 0)
+    {
+        NULL_CHK_HR(pStates, E_INVALIDARG);
+    }
+
+    std::lock_guard<slim_mutex> guard(m_mailboxMutex);
+
+    uint32_t count = 0;
+    while (count < capacity && !m_mailbox.empty())
+    {
+        pStates[count++] = m_mailbox.front();
+
+        m_mailbox.pop_front();
+    }
+
+    *pStateCount = count;
+
+    return S_OK;
+}
+
+// private, called under m_mailboxMutex
+_Use_decl_annotations_
+void Module::QueueState(
+    CALLBACK_STATE const& state,
+    std::vector<CALLBACK_STATE>& dropped)
+{
+    // the client only wants the latest of what the plugin says supersedes
+    auto it = std::find_if(m_mailbox.begin(), m_mailbox.end(), [this, &state](CALLBACK_STATE const& queued)
+        {
+            return IsSuperseded(queued, state);
+        });
+    if (it != m_mailbox.end())
+    {
+        dropped.push_back(*it);
+
+        m_mailbox.erase(it);
+    }
+
+    // nobody is polling, keep failures and let go of the oldest updates
+    if (m_mailbox.size() >= MAX_QUEUED_STATES)
+    {
+        it = std::find_if(m_mailbox.begin(), m_mailbox.end(), [](CALLBACK_STATE const& queued)
+            {
+                return queued.type != CallbackType::Failed;
+            });
+        if (it == m_mailbox.end())
+        {
+            it = m_mailbox.begin();
+        }
+
+        dropped.push_back(*it);
+
+        m_mailbox.erase(it);
+    }
+
+    m_mailbox.push_back(state);
+}
+
+// private
+_Use_decl_annotations_
+void Module::DropStates(
+    std::vector<CALLBACK_STATE> const& states)
+{
+    for (auto const& state : states)
+    {
+        OnStateDropped(state);
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+// where cppwinrt puts the generated base depends on the plugin's project settings
+#if __has_include("Plugin.Module.g.h")
+#include "Plugin.Module.g.h"
+#else
+#include "Plugin/Module.g.h"
+#endif
+#include "D3D11DeviceResources.h"
+#include "D3D12DeviceResources.h"
+
+#include <algorithm>
+#include <deque>
+#include <shared_mutex>
+#include <vector>
+
+// states held for PollState before the oldest are dropped
+#define MAX_QUEUED_STATES 64
+
+typedef enum class _CallbackMode : int32_t
+{
+    Immediate = 0,  // the state callback runs on the thread that raised the state
+    Polled          // states wait in the module until PollState, a superseded state is dropped
+} CallbackMode;
+
+struct __declspec(uuid("34fe2ecf-68d3-4732-a05a-2a737b63c386")) IModulePriv : ::IUnknown
+{
+    virtual winrt::hresult __stdcall Initialize(_In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice, _In_ StateChangedCallback stateCallback, _In_ void* pCallbackObject) = 0;
+    virtual winrt::hresult __stdcall Callback(_In_ CALLBACK_STATE state) = 0;
+    virtual winrt::hresult __stdcall Failed(winrt::hresult hr) = 0;
+    virtual void __stdcall DetachCallbacks() = 0;
+    virtual winrt::hresult __stdcall SetCallbackMode(_In_ CallbackMode mode) = 0;
+    virtual winrt::hresult __stdcall PollState(_Out_writes_to_(capacity, *pStateCount) CALLBACK_STATE* pStates, _In_ uint32_t capacity, _Out_ uint32_t* pStateCount) = 0;
+    virtual void __stdcall DeviceResetStarted() = 0;
+    virtual void __stdcall DeviceResetCompleted(_In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice) = 0;
+};
+
+// the base of every plugin instance, PLUGIN_NAMESPACE is set by each plugin's items project
+namespace winrt::PLUGIN_NAMESPACE::Plugin::implementation
+{
+    struct Module : ModuleT<Module, IModulePriv>
+    {
+        Module() = default;
+
+        virtual void Shutdown();
+        virtual void OnRenderEvent(uint16_t frameNumber);
+
+        // IModulePriv
+        virtual hresult __stdcall Initialize(_In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice, _In_ StateChangedCallback stateCallback, _In_ void* pCallbackObject) override;
+        virtual hresult __stdcall Callback(_In_ CALLBACK_STATE state) override;
+        virtual hresult __stdcall Failed(winrt::hresult hr) override;
+        virtual void __stdcall DetachCallbacks() override;
+        virtual hresult __stdcall SetCallbackMode(_In_ CallbackMode mode) override;
+        virtual hresult __stdcall PollState(_Out_writes_to_(capacity, *pStateCount) CALLBACK_STATE* pStates, _In_ uint32_t capacity, _Out_ uint32_t* pStateCount) override;
+        virtual void __stdcall DeviceResetStarted() override;
+        virtual void __stdcall DeviceResetCompleted(_In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice) override;
+
+    protected:
+        // true when a newer state makes one still waiting in the mailbox pointless, called under the mailbox lock
+        virtual bool IsSuperseded(_In_ CALLBACK_STATE const& queued, _In_ CALLBACK_STATE const& state) { UNREFERENCED_PARAMETER(queued); UNREFERENCED_PARAMETER(state); return false; }
+
+        // a queued state the client will never see, give back what it holds, not called under a module lock
+        virtual void OnStateDropped(_In_ CALLBACK_STATE const& state) { UNREFERENCED_PARAMETER(state); }
+
+        // unity's device is going away, let go of everything made on it, the instance keeps running
+        virtual void OnDeviceResetStarted() {}
+
+        // the device resources point at the new device, rebuild what was released
+        virtual void OnDeviceResetCompleted() {}
+
+        // what unity's CreateExternalTexture takes, the view on d3d11, the shared resource on d3d12
+        void* GetUnityTexture(_In_ ID3D11ShaderResourceView* textureSRV);
+
+        // the same, with a reference the caller owns on whichever of the two it got
+        void* AddRefUnityTexture(_In_ ID3D11ShaderResourceView* textureSRV);
+
+        // textures handed to unity on d3d12 need an nt handle
+        UINT GetUnityTextureMiscFlags();
+
+    private:
+        void QueueState(_In_ CALLBACK_STATE const& state, _Inout_ std::vector<CALLBACK_STATE>& dropped);
+        void DropStates(_In_ std::vector<CALLBACK_STATE> const& states);
+
+    protected:
+        std::weak_ptr<IUnityDeviceResource> m_deviceResources;
+        std::weak_ptr<ID3D11DeviceResource> m_d3d11DeviceResources;
+        std::weak_ptr<ID3D12DeviceResource> m_d3d12DeviceResources;
+
+    private:
+        winrt::slim_mutex m_mutex;
+        void* m_pClientObject = nullptr;
+        StateChangedCallback m_stateCallbacks = nullptr;
+
+        // polled mode, producers only hold this long enough to queue a state
+        winrt::slim_mutex m_mailboxMutex;
+        CallbackMode m_callbackMode = CallbackMode::Immediate;
+        std::deque<CALLBACK_STATE> m_mailbox;
+    };
+}
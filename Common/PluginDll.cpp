@@ -0,0 +1,201 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "PluginDll.h"
+#include "D3D12DeviceResources.h"
+#include "MediaDevice.h"
+
+namespace winrt
+{
+    using namespace winrt::PLUGIN_NAMESPACE::Plugin;
+}
+
+static InstanceRegistry<winrt::IModule> s_instances;
+
+static std::shared_ptr<IUnityDeviceResource> s_deviceResource;
+static UnityGfxRenderer s_deviceType = kUnityGfxRendererNull;
+static IUnityInterfaces* s_unityInterfaces = nullptr;
+static IUnityGraphics* s_unityGraphics = nullptr;
+
+HRESULT GetModule(INSTANCE_HANDLE id, _Out_ winrt::IModule& module)
+{
+    IFR(s_instances.Get(id, module));
+
+    NULL_CHK_HR(module, E_POINTER);
+
+    return S_OK;
+}
+
+HRESULT TrackModule(winrt::IModule const& module, INSTANCE_HANDLE* handleId)
+{
+    return s_instances.Add(module, handleId);
+}
+
+InstanceRegistry<winrt::IModule>& GetModules()
+{
+    return s_instances;
+}
+
+std::shared_ptr<IUnityDeviceResource> const& GetUnityDeviceResource()
+{
+    return s_deviceResource;
+}
+
+// shared by all the plugins, registered for as long as unity has the dll loaded
+TRACELOGGING_DEFINE_PROVIDER(
+    g_hPluginTraceProvider,
+    "MixedReality.UnityPlugins",
+    (0x6b5f0b8e, 0x3c1a, 0x4e62, 0x9d, 0x1f, 0x2a, 0x7c, 0x4e, 0x9b, 0x8d, 0x13));
+
+// --------------------------------------------------------------------------
+// UnitySetInterfaces
+static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces)
+{
+    OnPluginLoad();
+
+    TraceLoggingRegister(g_hPluginTraceProvider);
+
+    s_unityInterfaces = unityInterfaces;
+    s_unityGraphics = s_unityInterfaces->Get<IUnityGraphics>();
+    s_unityGraphics->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
+
+    // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
+    OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
+{
+    OnPluginUnloading();
+
+    for (auto&& module : s_instances.Clear())
+    {
+        module.Shutdown();
+        module = nullptr;
+    }
+
+    OnPluginUnload();
+
+    s_unityGraphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+
+    TraceLoggingUnregister(g_hPluginTraceProvider);
+}
+
+// --------------------------------------------------------------------------
+// GraphicsDeviceEvent
+static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
+{
+    // modules let go of what they made on unity's device while it's still there, a shutdown
+    // with modules alive is a device being recreated under them
+    if (eventType == kUnityGfxDeviceEventBeforeReset || eventType == kUnityGfxDeviceEventShutdown)
+    {
+        s_instances.ForEach([](INSTANCE_HANDLE, winrt::IModule const& module)
+        {
+            module.as<IModulePriv>()->DeviceResetStarted();
+        });
+
+        // then what the plugin pools on it, anything recycled after this is released instead
+        OnPluginDeviceResetStarted();
+    }
+
+    // Create graphics API implementation upon initialization
+    if (eventType == kUnityGfxDeviceEventInitialize)
+    {
+        assert(s_deviceResource == nullptr);
+
+        s_deviceType = s_unityGraphics->GetRenderer();
+
+        s_deviceResource = CreateDeviceResource(s_deviceType);
+    }
+
+    // Let the implementation process the device related event
+    if (s_deviceResource != nullptr)
+    {
+        s_deviceResource->ProcessDeviceEvent(eventType, s_unityInterfaces);
+    }
+
+    // Cleanup graphics API implementation upon shutdown
+    if (eventType == kUnityGfxDeviceEventShutdown)
+    {
+        s_deviceResource.reset();
+        s_deviceResource = nullptr;
+        s_deviceType = kUnityGfxRendererNull;
+    }
+
+    // and rebuild it on the device that's there now, module state stays as it is
+    if (eventType == kUnityGfxDeviceEventAfterReset || eventType == kUnityGfxDeviceEventInitialize)
+    {
+        s_instances.ForEach([](INSTANCE_HANDLE, winrt::IModule const& module)
+        {
+            module.as<IModulePriv>()->DeviceResetCompleted(s_deviceResource);
+        });
+    }
+}
+
+
+// --------------------------------------------------------------------------
+// OnRenderEvent
+// This will be called for GL.IssuePluginEvent script calls; eventID will
+// be the integer passed to IssuePluginEvent. In this example, we just ignore
+// that value.
+static void UNITY_INTERFACE_API OnRenderEvent(int32_t eventID)
+{
+    DWORD dwId = static_cast<DWORD>(eventID);
+
+    INSTANCE_HANDLE id = static_cast<INSTANCE_HANDLE>(LOWORD(dwId));
+
+    uint16_t frameId = static_cast<uint16_t>(HIWORD(dwId));
+
+    // one event a frame services every module, in slot order
+    if (id == INSTANCE_HANDLE_BROADCAST)
+    {
+        s_instances.ForEach([frameId](INSTANCE_HANDLE, winrt::IModule const& module)
+        {
+            module.OnRenderEvent(frameId);
+        });
+    }
+    else
+    {
+        // no reference taken, a release on the main thread waits for the event to finish
+        s_instances.Visit(id, [frameId](winrt::IModule const& module)
+        {
+            module.OnRenderEvent(frameId);
+        });
+    }
+
+    // what the modules wrote for this event lands before unity's queue draws with it
+    auto d3d12Resources = std::dynamic_pointer_cast<ID3D12DeviceResource>(s_deviceResource);
+    if (d3d12Resources != nullptr)
+    {
+        d3d12Resources->Synchronize();
+    }
+}
+
+// --------------------------------------------------------------------------
+// GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
+extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc()
+{
+    return OnRenderEvent;
+}
+
+
+// --------------------------------------------------------------------------
+// Other function
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstance(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    if (SUCCEEDED(s_instances.Remove(id, module)))
+    {
+        module.Shutdown();
+        module = nullptr;
+    }
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetMediaDeviceDebugLayer(
+    _In_ boolean enable)
+{
+    ::SetMediaDeviceDebugLayer(enable != 0);
+}
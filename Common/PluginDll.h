@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Unity/IUnityGraphics.h"
+#include "PlatformBase.h"
+#include "UnityDeviceResource.h"
+#include "InstanceRegistry.h"
+#include "Plugin.Module.h"
+
+// the instances every render event reaches, looked up from unity's render thread while the
+// main thread adds and releases. UnityPluginLoad, UnityPluginUnload, GetRenderEventFunc,
+// ReleaseInstance and SetMediaDeviceDebugLayer are exported from PluginDll.cpp
+HRESULT GetModule(INSTANCE_HANDLE id, _Out_ winrt::PLUGIN_NAMESPACE::Plugin::IModule& module);
+HRESULT TrackModule(winrt::PLUGIN_NAMESPACE::Plugin::IModule const& module, _Out_ INSTANCE_HANDLE* handleId);
+
+// the table itself, for what reaches every instance or releases one on its own terms
+InstanceRegistry<winrt::PLUGIN_NAMESPACE::Plugin::IModule>& GetModules();
+
+// unity's device as the modules see it, nullptr while unity has none
+std::shared_ptr<IUnityDeviceResource> const& GetUnityDeviceResource();
+
+// each plugin's own part of the entry points, called on the thread that calls into the dll
+void OnPluginLoad();
+
+// before the modules shut down
+void OnPluginUnloading();
+
+// after, what's left is process wide, pools and caches
+void OnPluginUnload();
+
+// the modules have let go of unity's device, whatever the plugin pools on it goes too
+void OnPluginDeviceResetStarted();
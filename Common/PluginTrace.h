@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <windows.h>
+#include <winmeta.h>
+#include <TraceLoggingProvider.h>
+
+// one TraceLogging provider for the CameraCapture, VideoPlayer and PDFLoader plugins,
+// each dll defines it next to UnityPluginLoad. collect with wpr or tracelog using
+// *MixedReality.UnityPlugins or {6b5f0b8e-3c1a-4e62-9d1f-2a7c4e9b8d13}
+TRACELOGGING_DECLARE_PROVIDER(g_hPluginTraceProvider);
+
+#define PLUGIN_TRACE_KEYWORD_SAMPLE     0x1     // media samples through the pipeline
+#define PLUGIN_TRACE_KEYWORD_TEXTURE    0x2     // texture copies and conversions
+#define PLUGIN_TRACE_KEYWORD_RENDER     0x4     // pdf page renders
+#define PLUGIN_TRACE_KEYWORD_CALLBACK   0x8     // state callbacks into unity
+
+// TraceLoggingWrite tests the enabled flag before it touches any argument,
+// so with no session listening an event is a single branch
+#define PLUGIN_TRACE_BEGIN(eventName, keyword) \
+    TraceLoggingWrite(g_hPluginTraceProvider, eventName, \
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE), \
+        TraceLoggingKeyword(keyword), \
+        TraceLoggingOpcode(WINEVENT_OPCODE_START))
+
+#define PLUGIN_TRACE_END(eventName, keyword) \
+    TraceLoggingWrite(g_hPluginTraceProvider, eventName, \
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE), \
+        TraceLoggingKeyword(keyword), \
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP))
+
+template <typename TEnd>
+struct PluginTraceScope
+{
+    PluginTraceScope(TEnd end) : m_end(end) {}
+    ~PluginTraceScope() { m_end(); }
+
+    PluginTraceScope(PluginTraceScope const&) = delete;
+    PluginTraceScope& operator=(PluginTraceScope const&) = delete;
+
+private:
+    TEnd m_end;
+};
+
+#define PLUGIN_TRACE_CONCAT_(a, b) a##b
+#define PLUGIN_TRACE_CONCAT(a, b) PLUGIN_TRACE_CONCAT_(a, b)
+
+// begin event now, end event when the enclosing scope exits, early returns included
+#define PLUGIN_TRACE_SCOPE(eventName, keyword) \
+    PLUGIN_TRACE_BEGIN(eventName, keyword); \
+    PluginTraceScope PLUGIN_TRACE_CONCAT(pluginTraceScope, __LINE__)([]() { PLUGIN_TRACE_END(eventName, keyword); })
@@ -0,0 +1,232 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "SharedMediaDevice.h"
+#include "MediaDevice.h"
+
+#include <mfapi.h>
+
+#pragma comment(lib, "mfplat")
+
+using namespace winrt;
+
+winrt::slim_mutex SharedMediaDevice::s_mutex;
+std::map<uint64_t, weak_ref<SharedMediaDevice>> SharedMediaDevice::s_devices;
+
+_Use_decl_annotations_
+HRESULT SharedMediaDevice::Acquire(
+    IDXGIAdapter* pDXGIAdapter,
+    com_ptr<SharedMediaDevice>& sharedMediaDevice)
+{
+    sharedMediaDevice = nullptr;
+
+    uint64_t adapterKey = 0;
+    IFR(GetAdapterKey(pDXGIAdapter, &adapterKey));
+
+    std::lock_guard<winrt::slim_mutex> guard(s_mutex);
+
+    auto it = s_devices.find(adapterKey);
+    if (it != s_devices.end())
+    {
+        auto existing = it->second.get();
+        if (existing != nullptr)
+        {
+            sharedMediaDevice = existing;
+
+            return S_OK;
+        }
+    }
+
+    com_ptr<ID3D11Device> mediaDevice = nullptr;
+    IFR(CreateMediaDevice(pDXGIAdapter, mediaDevice.put()));
+
+    // a manager of its own, the locked process default can only hold one device
+    uint32_t resetToken;
+    com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager = nullptr;
+    IFR(MFCreateDXGIDeviceManager(&resetToken, dxgiDeviceManager.put()));
+
+    // associate device with dxgiManager
+    IFR(dxgiDeviceManager->ResetDevice(mediaDevice.get(), resetToken));
+
+    auto device = make<SharedMediaDevice>().as<SharedMediaDevice>();
+    device->m_adapterKey = adapterKey;
+    device->m_mediaDevice = mediaDevice;
+    device->m_resetToken = resetToken;
+    device->m_dxgiDeviceManager = dxgiDeviceManager;
+
+    // without a removal event holders still see the error on their next d3d call
+    device->WatchDeviceRemoved();
+
+    s_devices[adapterKey] = device->get_weak();
+
+    sharedMediaDevice = device;
+
+    return S_OK;
+}
+
+SharedMediaDevice::SharedMediaDevice()
+    : m_adapterKey(0)
+    , m_mediaDevice(nullptr)
+    , m_resetToken(0)
+    , m_dxgiDeviceManager(nullptr)
+    , m_deviceRemovedEvent()
+    , m_deviceRemovedCookie(0)
+    , m_deviceRemovedWait(nullptr)
+{}
+
+SharedMediaDevice::~SharedMediaDevice()
+{
+    {
+        std::lock_guard<winrt::slim_mutex> guard(s_mutex);
+
+        // an Acquire racing this destructor may already have put a new device in the slot
+        auto it = s_devices.find(m_adapterKey);
+        if (it != s_devices.end() && it->second.get() == nullptr)
+        {
+            s_devices.erase(it);
+        }
+    }
+
+    if (m_deviceRemovedWait != nullptr)
+    {
+        // a running callback can't resolve this entry anymore, wait for it to leave
+        SetThreadpoolWait(m_deviceRemovedWait, nullptr, nullptr);
+        WaitForThreadpoolWaitCallbacks(m_deviceRemovedWait, TRUE);
+        CloseThreadpoolWait(m_deviceRemovedWait);
+
+        m_deviceRemovedWait = nullptr;
+    }
+
+    if (m_deviceRemovedCookie != 0)
+    {
+        auto device4 = m_mediaDevice.try_as<ID3D11Device4>();
+        if (device4 != nullptr)
+        {
+            device4->UnregisterDeviceRemoved(m_deviceRemovedCookie);
+        }
+
+        m_deviceRemovedCookie = 0;
+    }
+
+    if (m_dxgiDeviceManager != nullptr)
+    {
+        if (m_mediaDevice != nullptr)
+        {
+            m_dxgiDeviceManager->ResetDevice(nullptr, m_resetToken);
+        }
+
+        m_dxgiDeviceManager = nullptr;
+    }
+
+    m_mediaDevice = nullptr;
+}
+
+event_token SharedMediaDevice::DeviceLost(delegate<HRESULT> const& handler)
+{
+    return m_deviceLostEvent.add(handler);
+}
+
+void SharedMediaDevice::DeviceLost(event_token const& token)
+{
+    m_deviceLostEvent.remove(token);
+}
+
+// private
+HRESULT SharedMediaDevice::WatchDeviceRemoved()
+{
+    auto device4 = m_mediaDevice.try_as<ID3D11Device4>();
+    NULL_CHK_HR(device4, E_NOINTERFACE);
+
+    winrt::handle deviceRemovedEvent(CreateEvent(nullptr, false, false, nullptr));
+    if (!deviceRemovedEvent)
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    PTP_WAIT wait = CreateThreadpoolWait(&SharedMediaDevice::OnDeviceRemoved, this, nullptr);
+    NULL_CHK_HR(wait, HRESULT_FROM_WIN32(GetLastError()));
+
+    DWORD cookie = 0;
+    HRESULT hr = device4->RegisterDeviceRemovedEvent(deviceRemovedEvent.get(), &cookie);
+    if (FAILED(hr))
+    {
+        CloseThreadpoolWait(wait);
+
+        IFR(hr);
+    }
+
+    SetThreadpoolWait(wait, deviceRemovedEvent.get(), nullptr);
+
+    m_deviceRemovedEvent = std::move(deviceRemovedEvent);
+    m_deviceRemovedCookie = cookie;
+    m_deviceRemovedWait = wait;
+
+    return S_OK;
+}
+
+// private, threadpool
+_Use_decl_annotations_
+void CALLBACK SharedMediaDevice::OnDeviceRemoved(
+    PTP_CALLBACK_INSTANCE instance,
+    PVOID context,
+    PTP_WAIT wait,
+    TP_WAIT_RESULT waitResult)
+{
+    UNREFERENCED_PARAMETER(wait);
+    UNREFERENCED_PARAMETER(waitResult);
+
+    auto pThis = static_cast<SharedMediaDevice*>(context);
+    if (pThis == nullptr)
+    {
+        return;
+    }
+
+    com_ptr<SharedMediaDevice> device = nullptr;
+    {
+        std::lock_guard<winrt::slim_mutex> guard(s_mutex);
+
+        // only while the broker still hands it out, a destructor may be waiting on this callback
+        auto it = s_devices.find(pThis->m_adapterKey);
+        if (it == s_devices.end())
+        {
+            return;
+        }
+
+        device = it->second.get();
+        if (device.get() != pThis)
+        {
+            return;
+        }
+
+        s_devices.erase(it);
+    }
+
+    // the last holder may let go during the fan-out, its destructor waits on this callback
+    DisassociateCurrentThreadFromCallback(instance);
+
+    device->m_deviceLostEvent(device->m_mediaDevice->GetDeviceRemovedReason());
+}
+
+// private
+_Use_decl_annotations_
+HRESULT SharedMediaDevice::GetAdapterKey(
+    IDXGIAdapter* pDXGIAdapter,
+    uint64_t* pKey)
+{
+    NULL_CHK_HR(pKey, E_INVALIDARG);
+
+    // the default adapter
+    *pKey = 0;
+
+    if (pDXGIAdapter != nullptr)
+    {
+        DXGI_ADAPTER_DESC desc{};
+        IFR(pDXGIAdapter->GetDesc(&desc));
+
+        *pKey = (static_cast<uint64_t>(static_cast<uint32_t>(desc.AdapterLuid.HighPart)) << 32) | desc.AdapterLuid.LowPart;
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11_4.h>
+#include <mfidl.h>
+
+#include <map>
+#include <mutex>
+
+// one video capable d3d device and dxgi device manager per adapter, shared by every capture
+// engine and playback manager in the process so concurrent streams don't each bring up a gpu
+// context for the video engine, the entry lives as long as someone holds it, a removed device
+// is dropped from the broker and DeviceLost tells every holder, thread safe
+struct SharedMediaDevice : winrt::implements<SharedMediaDevice, winrt::Windows::Foundation::IInspectable>
+{
+    // returns the live device for the adapter or creates it
+    static HRESULT Acquire(
+        _In_opt_ IDXGIAdapter* pDXGIAdapter,
+        _Out_ winrt::com_ptr<SharedMediaDevice>& sharedMediaDevice);
+
+    SharedMediaDevice();
+    virtual ~SharedMediaDevice();
+
+    winrt::com_ptr<ID3D11Device> const& Device() const { return m_mediaDevice; }
+    winrt::com_ptr<IMFDXGIDeviceManager> const& DeviceManager() const { return m_dxgiDeviceManager; }
+
+    // raised once on a threadpool thread with the removed reason, the next Acquire creates a new device
+    winrt::event_token DeviceLost(winrt::delegate<HRESULT> const& handler);
+    void DeviceLost(winrt::event_token const& token);
+
+private:
+    HRESULT WatchDeviceRemoved();
+
+    static void CALLBACK OnDeviceRemoved(
+        _Inout_ PTP_CALLBACK_INSTANCE instance,
+        _Inout_opt_ PVOID context,
+        _Inout_ PTP_WAIT wait,
+        _In_ TP_WAIT_RESULT waitResult);
+
+    static HRESULT GetAdapterKey(
+        _In_opt_ IDXGIAdapter* pDXGIAdapter,
+        _Out_ uint64_t* pKey);
+
+private:
+    uint64_t m_adapterKey;
+    winrt::com_ptr<ID3D11Device> m_mediaDevice;
+    uint32_t m_resetToken;
+    winrt::com_ptr<IMFDXGIDeviceManager> m_dxgiDeviceManager;
+
+    // signaled by the device on removal, not every driver supports it
+    winrt::handle m_deviceRemovedEvent;
+    DWORD m_deviceRemovedCookie;
+    PTP_WAIT m_deviceRemovedWait;
+    winrt::event<winrt::delegate<HRESULT>> m_deviceLostEvent;
+
+    // weak, the last holder to let go releases the device
+    static winrt::slim_mutex s_mutex;
+    static std::map<uint64_t, winrt::weak_ref<SharedMediaDevice>> s_devices;
+};
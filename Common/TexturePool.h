@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <dxgiformat.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+
+// what a plugin may hold on the gpu before idle textures are dropped, live ones are never refused
+#define TEXTURE_POOL_DEFAULT_BUDGET_BYTES (512ull * 1024 * 1024)
+
+// textures a plugin holds on the gpu, live ones and the idle ones kept for reuse
+typedef struct _TEXTURE_MEMORY_STATS
+{
+    uint64_t budgetBytes;
+    uint64_t allocatedBytes;    // live and pooled
+    uint64_t pooledBytes;
+    uint32_t pooledTextures;
+    uint32_t hits;              // acquires served from the pool
+    uint32_t misses;            // acquires that had to allocate
+    uint32_t evictions;         // pooled textures dropped to stay in the budget
+} TEXTURE_MEMORY_STATS;
+
+// everything that decides an allocation, the devices are only compared, a pooled texture keeps
+// both alive so an address can't be reused while it's in the pool
+struct TEXTURE_POOL_KEY
+{
+    void const* device;
+    void const* mediaDevice;
+    uint32_t width;
+    uint32_t height;
+    DXGI_FORMAT format;
+    uint32_t arraySize;
+    uint32_t flags;             // bind, misc or sync flags, up to the texture type
+
+    bool operator==(TEXTURE_POOL_KEY const& other) const
+    {
+        return device == other.device
+            && mediaDevice == other.mediaDevice
+            && width == other.width
+            && height == other.height
+            && format == other.format
+            && arraySize == other.arraySize
+            && flags == other.flags;
+    }
+};
+
+// close enough for the budget, the driver's padding isn't visible through d3d11
+inline uint64_t GetTextureBytes(
+    _In_ DXGI_FORMAT format,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _In_ uint32_t arraySize)
+{
+    uint64_t pixels = static_cast<uint64_t>(width) * height * arraySize;
+
+    switch (format)
+    {
+    case DXGI_FORMAT_NV12:
+        return pixels * 3 / 2;
+    case DXGI_FORMAT_P010:
+        return pixels * 3;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        return pixels * 8;
+    case DXGI_FORMAT_R16_UNORM:
+        return pixels * 2;
+    case DXGI_FORMAT_R8_UNORM:
+        return pixels;
+    default:
+        return pixels * 4;
+    }
+}
+
+// idle textures of one type kept for reuse, one pool per plugin shared by all of its instances.
+// the least recently recycled are dropped first once the plugin's total passes the budget.
+// T carries poolKey, poolBytes and poolGeneration, its Create reports the allocation with
+// OnAllocated and its Reset with OnReleased, thread safe
+template <typename TPtr>
+struct TexturePool
+{
+    static TexturePool& Instance()
+    {
+        static TexturePool s_pool;
+
+        return s_pool;
+    }
+
+    TexturePool()
+        : m_budgetBytes(TEXTURE_POOL_DEFAULT_BUDGET_BYTES)
+        , m_allocatedBytes(0)
+        , m_pooledBytes(0)
+        , m_generation(0)
+        , m_hits(0)
+        , m_misses(0)
+        , m_evictions(0)
+    {
+    }
+
+    // textures from before the last Clear aren't taken back
+    uint32_t Generation() const { return m_generation.load(); }
+
+    void SetBudget(uint64_t budgetBytes)
+    {
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+            m_budgetBytes = budgetBytes;
+
+            Evict(0, evicted);
+        }
+    }
+
+    // a pooled texture for the key, on a miss the pool makes room for bytes and returns null
+    TPtr Acquire(TEXTURE_POOL_KEY const& key, uint64_t bytes)
+    {
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+            // most recently recycled first, still warm in the driver's residency
+            for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it)
+            {
+                if (it->key == key)
+                {
+                    TPtr texture = std::move(it->texture);
+
+                    m_pooledBytes -= it->bytes;
+                    m_entries.erase(std::next(it).base());
+
+                    ++m_hits;
+
+                    return texture;
+                }
+            }
+
+            ++m_misses;
+
+            Evict(bytes, evicted);
+        }
+
+        return nullptr;
+    }
+
+    // dropped instead when it's older than the last Clear or the budget has no room left
+    void Recycle(TPtr texture)
+    {
+        if (texture == nullptr)
+        {
+            return;
+        }
+
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+            if (texture->poolGeneration != m_generation.load() || texture->poolBytes == 0)
+            {
+                evicted.push_back({ texture->poolKey, 0, std::move(texture) });
+
+                return;
+            }
+
+            m_entries.push_back({ texture->poolKey, texture->poolBytes, std::move(texture) });
+            m_pooledBytes += m_entries.back().bytes;
+
+            // pooled bytes are already part of the total
+            Evict(0, evicted);
+        }
+    }
+
+    // the device is going away, everything pooled is released and the rest isn't taken back
+    void Clear()
+    {
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+            ++m_generation;
+
+            evicted.swap(m_entries);
+            m_pooledBytes = 0;
+        }
+    }
+
+    // a device was lost, only its pooled textures are released
+    void Drop(void const* device)
+    {
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+            for (auto it = m_entries.begin(); it != m_entries.end();)
+            {
+                auto next = std::next(it);
+                if (it->key.device == device || it->key.mediaDevice == device)
+                {
+                    m_pooledBytes -= it->bytes;
+
+                    evicted.splice(evicted.end(), m_entries, it);
+                }
+                it = next;
+            }
+        }
+    }
+
+    void OnAllocated(uint64_t bytes) { m_allocatedBytes += bytes; }
+    void OnReleased(uint64_t bytes) { m_allocatedBytes -= bytes; }
+
+    void GetStats(TEXTURE_MEMORY_STATS& stats)
+    {
+        std::lock_guard<winrt::slim_mutex> guard(m_mutex);
+
+        stats.budgetBytes = m_budgetBytes;
+        stats.allocatedBytes = m_allocatedBytes.load();
+        stats.pooledBytes = m_pooledBytes;
+        stats.pooledTextures = static_cast<uint32_t>(m_entries.size());
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.evictions = m_evictions;
+    }
+
+private:
+    struct Entry
+    {
+        TEXTURE_POOL_KEY key;
+        uint64_t bytes;
+        TPtr texture;
+    };
+
+    // oldest first until bytes more fit, the textures are released by the caller after the lock
+    void Evict(uint64_t bytes, std::list<Entry>& evicted)
+    {
+        // still counted in the total until they're released
+        uint64_t evictedBytes = 0;
+
+        while (!m_entries.empty() && m_allocatedBytes.load() - evictedBytes + bytes > m_budgetBytes)
+        {
+            evictedBytes += m_entries.front().bytes;
+            m_pooledBytes -= m_entries.front().bytes;
+
+            evicted.splice(evicted.end(), m_entries, m_entries.begin());
+
+            ++m_evictions;
+        }
+    }
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    uint64_t m_budgetBytes;
+    std::atomic<uint64_t> m_allocatedBytes;
+    uint64_t m_pooledBytes;
+    std::atomic<uint32_t> m_generation;
+    uint32_t m_hits;
+    uint32_t m_misses;
+    uint32_t m_evictions;
+
+    // least recently recycled first
+    std::list<Entry> m_entries;
+};
@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "BenchmarkHost.h"
+
+// copied next to the benchmark by the post build step, with the sample's document
+#define BENCHMARK_PLUGIN L"PDFLoader.dll"
+#define BENCHMARK_DEFAULT_DOCUMENT L"mm0150.pdf"
+
+#define BENCHMARK_DEFAULT_PAGES 200
+
+// a stalled render ends the run instead of hanging it
+#define BENCHMARK_TIMEOUT_MILLISECONDS 60000
+
+typedef int32_t(UNITY_INTERFACE_API* CreatePdfFn)(StateChangedCallback fnCallback, INSTANCE_HANDLE* handleId);
+typedef int32_t(UNITY_INTERFACE_API* LoadFileFn)(INSTANCE_HANDLE id, LPCWSTR pszBaseFolder, LPCWSTR pszFilename);
+typedef int32_t(UNITY_INTERFACE_API* GetPageCountFn)(INSTANCE_HANDLE id, uint32_t* pageCount);
+typedef int32_t(UNITY_INTERFACE_API* SelectPageFn)(INSTANCE_HANDLE id, uint32_t pageIndex);
+typedef int32_t(UNITY_INTERFACE_API* SetPageCacheBudgetFn)(INSTANCE_HANDLE id, uint32_t megabytes);
+typedef void(UNITY_INTERFACE_API* ReleaseInstanceFn)(INSTANCE_HANDLE id);
+
+// what the loader's threads raised, read by the benchmark's loop
+struct DocumentContext
+{
+    winrt::slim_mutex mutex;
+    HRESULT failed = S_OK;
+    bool isOpened = false;
+    uint32_t selectedCount = 0;
+    int64_t selectedTicks = 0;  // qpc of the newest Selected
+};
+
+// CreatePdf has no callback object, one document at a time
+static DocumentContext s_context;
+
+static void __stdcall OnStateChanged(
+    _In_ void* callbackObject,
+    _In_ CALLBACK_STATE args)
+{
+    UNREFERENCED_PARAMETER(callbackObject);
+
+    int64_t ticks = BenchmarkTicks();
+
+    std::lock_guard<winrt::slim_mutex> guard(s_context.mutex);
+
+    if (args.type == CallbackType::Failed)
+    {
+        s_context.failed = args.value.failedState.hresult;
+    }
+    else if (args.type == CallbackType::Pdf && args.value.pdfState.stateType == PdfStateType::Opened)
+    {
+        s_context.isOpened = true;
+    }
+    else if (args.type == CallbackType::Pdf && args.value.pdfState.stateType == PdfStateType::Selected)
+    {
+        ++s_context.selectedCount;
+        s_context.selectedTicks = ticks;
+    }
+}
+
+// render events until the callback has raised what's waited for
+template <typename TDone>
+static HRESULT WaitFor(
+    _In_ TDone const& isDone)
+{
+    auto& host = BenchmarkHost::Instance();
+
+    ULONGLONG timeout = GetTickCount64() + BENCHMARK_TIMEOUT_MILLISECONDS;
+    for (;;)
+    {
+        {
+            std::lock_guard<winrt::slim_mutex> guard(s_context.mutex);
+
+            IFR(s_context.failed);
+
+            if (isDone())
+            {
+                return S_OK;
+            }
+        }
+
+        if (GetTickCount64() > timeout)
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+        }
+
+        host.RunFrame();
+    }
+}
+
+// SelectPage to the Selected callback, one page at a time through the document, the page cache
+// is off so every select renders. an instance left by a failure is shut down by UnityPluginUnload
+static HRESULT RunDocument(
+    _In_ uint32_t selectCount,
+    _In_ std::wstring const& documentPath)
+{
+    auto& host = BenchmarkHost::Instance();
+
+    CreatePdfFn createPdf = nullptr;
+    LoadFileFn loadFile = nullptr;
+    GetPageCountFn getPageCount = nullptr;
+    SelectPageFn selectPage = nullptr;
+    SetPageCacheBudgetFn setPageCacheBudget = nullptr;
+    ReleaseInstanceFn releaseInstance = nullptr;
+    IFR(host.GetExport("CreatePdf", createPdf));
+    IFR(host.GetExport("LoadFile", loadFile));
+    IFR(host.GetExport("GetPageCount", getPageCount));
+    IFR(host.GetExport("SelectPage", selectPage));
+    IFR(host.GetExport("SetPageCacheBudget", setPageCacheBudget));
+    IFR(host.GetExport("ReleaseInstance", releaseInstance));
+
+    // LoadFile takes a full path as the folder
+    size_t separator = documentPath.find_last_of(L"\\/");
+    if (separator == std::wstring::npos)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    std::wstring folder = documentPath.substr(0, separator);
+    std::wstring fileName = documentPath.substr(separator + 1);
+
+    INSTANCE_HANDLE id = INSTANCE_HANDLE_INVALID;
+    IFR(createPdf(OnStateChanged, &id));
+    IFR(setPageCacheBudget(id, 0));
+    IFR(loadFile(id, folder.c_str(), fileName.c_str()));
+
+    IFR(WaitFor([]() { return s_context.isOpened; }));
+
+    uint32_t pageCount = 0;
+    IFR(getPageCount(id, &pageCount));
+    if (pageCount == 0)
+    {
+        IFR(E_UNEXPECTED);
+    }
+
+    BenchmarkResult result(L"PDFLoader SelectPage, " + fileName + L", " + std::to_wstring(pageCount) + L" pages", L"select to callback");
+
+    for (uint32_t select = 0; select < BENCHMARK_WARMUP_FRAMES + selectCount; ++select)
+    {
+        if (select == BENCHMARK_WARMUP_FRAMES)
+        {
+            result.Start(selectCount, nullptr);
+        }
+
+        uint32_t selectedCount = 0;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(s_context.mutex);
+
+            selectedCount = s_context.selectedCount;
+        }
+
+        int64_t startTicks = BenchmarkTicks();
+
+        IFR(selectPage(id, select % pageCount));
+
+        IFR(WaitFor([selectedCount]() { return s_context.selectedCount != selectedCount; }));
+
+        int64_t selectedTicks = 0;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(s_context.mutex);
+
+            selectedTicks = s_context.selectedTicks;
+        }
+
+        if (select >= BENCHMARK_WARMUP_FRAMES)
+        {
+            result.AddFrame(BenchmarkMilliseconds(selectedTicks - startTicks));
+        }
+    }
+
+    result.Stop(nullptr);
+
+    releaseInstance(id);
+
+    result.Print();
+
+    return S_OK;
+}
+
+// Benchmark.exe [selects] [document], the sample's document by default
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    uint32_t selectCount = argc > 1 ? static_cast<uint32_t>(_wtoi(argv[1])) : BENCHMARK_DEFAULT_PAGES;
+    std::wstring documentPath = argc > 2 ? std::wstring(argv[2]) : BenchmarkDirectory() + L"\\" BENCHMARK_DEFAULT_DOCUMENT;
+    if (selectCount == 0)
+    {
+        wprintf(L"usage: Benchmark.exe [selects] [document]\n");
+
+        return 1;
+    }
+
+    // a relative path is taken from where the benchmark was started
+    wchar_t fullPath[MAX_PATH]{};
+    if (GetFullPathNameW(documentPath.c_str(), ARRAYSIZE(fullPath), fullPath, nullptr) != 0)
+    {
+        documentPath = fullPath;
+    }
+
+    winrt::init_apartment();
+
+    auto& host = BenchmarkHost::Instance();
+
+    HRESULT hr = host.Load(BENCHMARK_PLUGIN);
+    if (SUCCEEDED(hr))
+    {
+        hr = RunDocument(selectCount, documentPath);
+    }
+
+    host.Unload();
+
+    if (FAILED(hr))
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<uint32_t>(hr));
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "BlockCompress.h"
+
+static uint16_t ToRGB565(uint32_t r, uint32_t g, uint32_t b)
+{
+    return static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+// the endpoint as the gpu decodes it, top bits replicated into the bottom
+static void FromRGB565(uint16_t color, int32_t rgb[3])
+{
+    uint32_t r = (color >> 11) & 0x1f;
+    uint32_t g = (color >> 5) & 0x3f;
+    uint32_t b = color & 0x1f;
+
+    rgb[0] = static_cast<int32_t>((r << 3) | (r >> 2));
+    rgb[1] = static_cast<int32_t>((g << 2) | (g >> 4));
+    rgb[2] = static_cast<int32_t>((b << 3) | (b >> 2));
+}
+
+// 16 pixels as b, g, r, a
+static void CompressBlock(uint8_t const block[16][4], uint8_t* output)
+{
+    uint32_t minColor[3] = { 255, 255, 255 };
+    uint32_t maxColor[3] = { 0, 0, 0 };
+
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            uint32_t value = block[i][2 - c];
+            minColor[c] = value < minColor[c] ? value : minColor[c];
+            maxColor[c] = value > maxColor[c] ? value : maxColor[c];
+        }
+    }
+
+    uint16_t color0 = ToRGB565(maxColor[0], maxColor[1], maxColor[2]);
+    uint16_t color1 = ToRGB565(minColor[0], minColor[1], minColor[2]);
+
+    // color0 > color1 picks the four color mode, equal ones are a flat block
+    if (color0 < color1)
+    {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    int32_t palette[4][3];
+    FromRGB565(color0, palette[0]);
+    FromRGB565(color1, palette[1]);
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t best = 0;
+            int32_t bestDistance = INT32_MAX;
+
+            for (uint32_t p = 0; p < 4; ++p)
+            {
+                int32_t dr = static_cast<int32_t>(block[i][2]) - palette[p][0];
+                int32_t dg = static_cast<int32_t>(block[i][1]) - palette[p][1];
+                int32_t db = static_cast<int32_t>(block[i][0]) - palette[p][2];
+
+                int32_t distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance)
+                {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= best << (2 * i);
+        }
+    }
+
+    output[0] = static_cast<uint8_t>(color0 & 0xff);
+    output[1] = static_cast<uint8_t>(color0 >> 8);
+    output[2] = static_cast<uint8_t>(color1 & 0xff);
+    output[3] = static_cast<uint8_t>(color1 >> 8);
+    output[4] = static_cast<uint8_t>(indices & 0xff);
+    output[5] = static_cast<uint8_t>((indices >> 8) & 0xff);
+    output[6] = static_cast<uint8_t>((indices >> 16) & 0xff);
+    output[7] = static_cast<uint8_t>(indices >> 24);
+}
+
+_Use_decl_annotations_
+HRESULT CompressBC1(
+    uint8_t const* pixels,
+    uint32_t stride,
+    uint32_t width,
+    uint32_t height,
+    std::vector<uint8_t>& blocks)
+{
+    blocks.clear();
+
+    NULL_CHK_HR(pixels, E_INVALIDARG);
+
+    if (width == 0 || height == 0 || (width % 4) != 0 || (height % 4) != 0 || stride < width * 4)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    uint32_t blocksWide = width / 4;
+    uint32_t blocksHigh = height / 4;
+
+    blocks.resize(static_cast<size_t>(blocksWide) * blocksHigh * BC1_BLOCK_BYTES);
+
+    uint8_t block[16][4];
+    for (uint32_t by = 0; by < blocksHigh; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksWide; ++bx)
+        {
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                memcpy_s(block[y * 4], 16, pixels + static_cast<size_t>(by * 4 + y) * stride + bx * 16, 16);
+            }
+
+            CompressBlock(block, blocks.data() + (static_cast<size_t>(by) * blocksWide + bx) * BC1_BLOCK_BYTES);
+        }
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,19 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <vector>
+
+// bytes per 4 x 4 block of bc1
+#define BC1_BLOCK_BYTES 8
+
+// opaque bgra pixels to bc1 blocks, row after row of blocks, width and height multiples of 4,
+// endpoints are the corners of the block's color bounds, so flat color and black on white text
+// keep their extremes, antialiased edges land on the two colors in between
+HRESULT CompressBC1(
+    _In_reads_bytes_(stride * height) uint8_t const* pixels,
+    _In_ uint32_t stride,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _Out_ std::vector<uint8_t>& blocks);
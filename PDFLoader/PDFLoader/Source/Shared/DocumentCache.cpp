@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "DocumentCache.h"
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Data::Pdf;
+using namespace winrt::Windows::Storage::Streams;
+
+slim_mutex DocumentCache::s_mutex;
+std::map<std::wstring, std::weak_ptr<SharedDocument>> DocumentCache::s_documents;
+
+SharedDocument::SharedDocument()
+    : key()
+    , loaded(CreateEvent(nullptr, TRUE, FALSE, nullptr))
+    , started(false)
+    , finished(false)
+    , hr(S_OK)
+    , document(nullptr)
+    , loadAsync(nullptr)
+    , waiters(0)
+    , bytesRead(0)
+    , bytesTotal(0)
+{
+}
+
+_Use_decl_annotations_
+std::shared_ptr<SharedDocument> DocumentCache::Acquire(
+    hstring const& key)
+{
+    std::lock_guard<slim_mutex> guard(s_mutex);
+
+    // entries of documents every loader let go of
+    for (auto it = s_documents.begin(); it != s_documents.end();)
+    {
+        it = it->second.expired() ? s_documents.erase(it) : std::next(it);
+    }
+
+    auto shared = s_documents[key.c_str()].lock();
+    if (shared == nullptr)
+    {
+        shared = std::make_shared<SharedDocument>();
+        shared->key = key;
+
+        s_documents[key.c_str()] = shared;
+    }
+
+    return shared;
+}
+
+_Use_decl_annotations_
+IAsyncOperationWithProgress<PdfDocument, double> DocumentCache::LoadAsync(
+    std::shared_ptr<SharedDocument> shared,
+    DocumentOpenStream openStream)
+{
+    auto progress = co_await get_progress_token();
+
+    {
+        std::lock_guard<slim_mutex> guard(shared->mutex);
+
+        ++shared->waiters;
+
+        if (!shared->started)
+        {
+            shared->started = true;
+            shared->loadAsync = LoadDocumentAsync(shared, openStream);
+        }
+    }
+
+    try
+    {
+        // a cancel lands at the next wait at the latest
+        while (!co_await resume_on_signal(shared->loaded.get(), std::chrono::milliseconds(PDF_LOAD_PROGRESS_INTERVAL)))
+        {
+            uint64_t bytesRead = 0, bytesTotal = 0;
+            {
+                std::lock_guard<slim_mutex> guard(shared->mutex);
+
+                bytesRead = shared->bytesRead;
+                bytesTotal = shared->bytesTotal;
+            }
+
+            if (bytesTotal > 0)
+            {
+                progress(static_cast<double>(bytesRead < bytesTotal ? bytesRead : bytesTotal) / bytesTotal);
+            }
+        }
+    }
+    catch (hresult_error const&)
+    {
+        LeaveWait(shared);
+
+        throw;
+    }
+
+    LeaveWait(shared);
+
+    std::lock_guard<slim_mutex> guard(shared->mutex);
+
+    IFT(shared->hr);
+
+    co_return shared->document;
+}
+
+_Use_decl_annotations_
+IAsyncAction DocumentCache::LoadDocumentAsync(
+    std::shared_ptr<SharedDocument> shared,
+    DocumentOpenStream openStream)
+{
+    auto cancellation = co_await get_cancellation_token();
+
+    // a cancel stops the fetch or the parse under way
+    cancellation.enable_propagation();
+
+    PdfDocument document = nullptr;
+
+    HRESULT hr = S_OK;
+
+    // the event is set whatever happens, a waiter could be on its way in
+    try
+    {
+        co_await resume_background();
+
+        auto stream = co_await openStream([shared](uint64_t bytesRead, uint64_t bytesTotal)
+        {
+            std::lock_guard<slim_mutex> guard(shared->mutex);
+
+            shared->bytesRead = bytesRead;
+            shared->bytesTotal = bytesTotal;
+        });
+
+        document = co_await PdfDocument::LoadFromStreamAsync(stream);
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    if (FAILED(hr))
+    {
+        Forget(shared);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(shared->mutex);
+
+        shared->finished = true;
+        shared->hr = hr;
+        shared->document = document;
+
+        // it holds the entry, the entry no longer holds it
+        shared->loadAsync = nullptr;
+    }
+
+    SetEvent(shared->loaded.get());
+}
+
+// the last loader waiting gave up, nobody is left to open the document for
+_Use_decl_annotations_
+void DocumentCache::LeaveWait(
+    std::shared_ptr<SharedDocument> const& shared)
+{
+    IAsyncAction loadAsync = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(shared->mutex);
+
+        if (--shared->waiters > 0 || shared->finished)
+        {
+            return;
+        }
+
+        loadAsync = shared->loadAsync;
+    }
+
+    // a loader asking again starts over
+    Forget(shared);
+
+    if (loadAsync != nullptr)
+    {
+        loadAsync.Cancel();
+    }
+}
+
+_Use_decl_annotations_
+void DocumentCache::Forget(
+    std::shared_ptr<SharedDocument> const& shared)
+{
+    std::lock_guard<slim_mutex> guard(s_mutex);
+
+    auto it = s_documents.find(shared->key.c_str());
+    if (it != s_documents.end() && it->second.lock() == shared)
+    {
+        s_documents.erase(it);
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <winrt/Windows.Data.Pdf.h>
+#include <winrt/Windows.Storage.Streams.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+// how often a loader waiting on a document reports its progress and checks for cancel, in ms
+#define PDF_LOAD_PROGRESS_INTERVAL 100
+
+// bytes of the file read so far and its size, 0 when it isn't known
+typedef std::function<void(uint64_t bytesRead, uint64_t bytesTotal)> DocumentLoadProgress;
+
+typedef std::function<winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::Streams::IRandomAccessStream>(
+    DocumentLoadProgress const& progress)> DocumentOpenStream;
+
+// a document open in the process, kept alive by the loaders holding it
+struct SharedDocument
+{
+    SharedDocument();
+
+    winrt::hstring key;
+
+    winrt::slim_mutex mutex;
+    winrt::handle loaded;
+    bool started;
+    bool finished;
+    HRESULT hr;
+    winrt::Windows::Data::Pdf::PdfDocument document;
+
+    // the load runs while any loader still waits on it
+    winrt::Windows::Foundation::IAsyncAction loadAsync;
+    uint32_t waiters;
+    uint64_t bytesRead;
+    uint64_t bytesTotal;
+};
+
+// documents by path or url, parsed once and shared by every loader showing them, a document still
+// loading for one loader is waited on by the next, different documents load side by side, thread
+// safe
+struct DocumentCache
+{
+    // the document for the key, a new entry when no loader holds it anymore
+    static std::shared_ptr<SharedDocument> Acquire(
+        _In_ winrt::hstring const& key);
+
+    // the first caller starts the load with openStream, the others wait for it, progress is the
+    // part of the file read, a failed load is dropped from the cache so the next Acquire tries
+    // again, the load is cancelled once every caller waiting on it was
+    static winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Data::Pdf::PdfDocument, double> LoadAsync(
+        _In_ std::shared_ptr<SharedDocument> shared,
+        _In_ DocumentOpenStream openStream);
+
+private:
+    // on its own, a loader that gives up waiting doesn't cancel it for the rest
+    static winrt::Windows::Foundation::IAsyncAction LoadDocumentAsync(
+        _In_ std::shared_ptr<SharedDocument> shared,
+        _In_ DocumentOpenStream openStream);
+
+    static void LeaveWait(
+        _In_ std::shared_ptr<SharedDocument> const& shared);
+    static void Forget(
+        _In_ std::shared_ptr<SharedDocument> const& shared);
+
+private:
+    static winrt::slim_mutex s_mutex;
+    static std::map<std::wstring, std::weak_ptr<SharedDocument>> s_documents;
+};
@@ -0,0 +1,260 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "HttpFileCache.h"
+
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Security.Cryptography.h>
+#include <winrt/Windows.Security.Cryptography.Core.h>
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.Web.Http.h>
+#include <winrt/Windows.Web.Http.Filters.h>
+#include <winrt/Windows.Web.Http.Headers.h>
+
+#include <string>
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Security::Cryptography;
+using namespace winrt::Windows::Security::Cryptography::Core;
+using namespace winrt::Windows::Storage;
+using namespace winrt::Windows::Storage::Streams;
+using namespace winrt::Windows::Web::Http;
+using namespace winrt::Windows::Web::Http::Filters;
+
+// until the server's max-age runs out, without one every open revalidates
+static clock::time_point ExpiresAt(HttpResponseMessage const& response)
+{
+    auto now = clock::now();
+
+    auto maxAge = response.Headers().CacheControl().MaxAge();
+
+    return maxAge != nullptr ? now + maxAge.Value() : now;
+}
+
+static hstring HeaderValue(Collections::IMap<hstring, hstring> const& headers, wchar_t const* name)
+{
+    return headers.HasKey(name) ? headers.Lookup(name) : hstring();
+}
+
+_Use_decl_annotations_
+bool HttpFileCache::TryParseWebUri(
+    hstring const& name,
+    Uri& uri)
+{
+    uri = nullptr;
+
+    // Uri takes anything with a colon in it, a drive letter too
+    if (std::wstring_view(name).find(L"://") == std::wstring_view::npos)
+    {
+        return false;
+    }
+
+    try
+    {
+        auto parsed = Uri(name);
+
+        auto scheme = parsed.SchemeName();
+        if (_wcsicmp(scheme.c_str(), L"http") == 0 || _wcsicmp(scheme.c_str(), L"https") == 0)
+        {
+            uri = parsed;
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+
+    return uri != nullptr;
+}
+
+_Use_decl_annotations_
+IAsyncOperation<IRandomAccessStream> HttpFileCache::OpenAsync(
+    Uri uri,
+    std::function<void(uint64_t, uint64_t)> progress)
+{
+    auto cancellation = co_await get_cancellation_token();
+
+    // a cancel stops the transfer, not just the next step
+    cancellation.enable_propagation();
+
+    auto cacheFolder = co_await ApplicationData::Current().LocalFolder().CreateFolderAsync(
+        PDF_HTTP_CACHE_FOLDER, CreationCollisionOption::OpenIfExists);
+
+    auto key = CacheKey(uri);
+
+    Entry entry{};
+    entry.url = uri.AbsoluteUri();
+
+    StorageFile cachedFile = nullptr;
+
+    auto cachedItem = co_await cacheFolder.TryGetItemAsync(key + L".pdf");
+    if (cachedItem != nullptr && co_await ReadEntryAsync(cacheFolder, key, entry))
+    {
+        cachedFile = cachedItem.as<StorageFile>();
+
+        if (clock::now() < entry.expires)
+        {
+            co_return co_await cachedFile.OpenAsync(FileAccessMode::Read);
+        }
+    }
+
+    HttpResponseMessage response = nullptr;
+
+    try
+    {
+        // this is the cache, the 304 has to reach it
+        HttpBaseProtocolFilter filter;
+        filter.CacheControl().ReadBehavior(HttpCacheReadBehavior::NoCache);
+        filter.CacheControl().WriteBehavior(HttpCacheWriteBehavior::NoCache);
+
+        HttpClient client(filter);
+
+        HttpRequestMessage request(HttpMethod::Get(), uri);
+        if (cachedFile != nullptr && !entry.etag.empty())
+        {
+            request.Headers().TryAppendWithoutValidation(L"If-None-Match", entry.etag);
+        }
+        if (cachedFile != nullptr && !entry.lastModified.empty())
+        {
+            request.Headers().TryAppendWithoutValidation(L"If-Modified-Since", entry.lastModified);
+        }
+
+        response = co_await client.SendRequestAsync(request, HttpCompletionOption::ResponseHeadersRead);
+    }
+    catch (hresult_error const&)
+    {
+        if (cachedFile == nullptr)
+        {
+            throw;
+        }
+    }
+
+    // offline, the last copy we have
+    if (response == nullptr)
+    {
+        co_return co_await cachedFile.OpenAsync(FileAccessMode::Read);
+    }
+
+    if (cachedFile != nullptr && response.StatusCode() == HttpStatusCode::NotModified)
+    {
+        entry.expires = ExpiresAt(response);
+
+        co_await WriteEntryAsync(cacheFolder, key, entry);
+
+        co_return co_await cachedFile.OpenAsync(FileAccessMode::Read);
+    }
+
+    response.EnsureSuccessStatusCode();
+
+    // downloaded to the side, a failed transfer leaves the cached copy alone
+    auto downloadFile = co_await cacheFolder.CreateFileAsync(key + L".download", CreationCollisionOption::ReplaceExisting);
+
+    auto contentLength = response.Content().Headers().ContentLength();
+    uint64_t bytesTotal = contentLength != nullptr ? contentLength.Value() : 0;
+
+    IRandomAccessStream output = nullptr;
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        output = co_await downloadFile.OpenAsync(FileAccessMode::ReadWrite);
+
+        auto write = response.Content().WriteToStreamAsync(output);
+        write.Progress([progress, bytesTotal](auto const&, uint64_t bytesWritten)
+        {
+            if (progress != nullptr)
+            {
+                progress(bytesWritten, bytesTotal);
+            }
+        });
+
+        co_await write;
+        co_await output.FlushAsync();
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    if (output != nullptr)
+    {
+        output.Close();
+    }
+
+    // no await, a cancelled operation throws at the next one, the partial file goes now
+    if (FAILED(hr))
+    {
+        DeleteFileW(downloadFile.Path().c_str());
+    }
+
+    IFT(hr);
+
+    co_await downloadFile.RenameAsync(key + L".pdf", NameCollisionOption::ReplaceExisting);
+
+    entry.etag = HeaderValue(response.Headers(), L"ETag");
+    entry.lastModified = HeaderValue(response.Content().Headers(), L"Last-Modified");
+    entry.expires = ExpiresAt(response);
+
+    co_await WriteEntryAsync(cacheFolder, key, entry);
+
+    co_return co_await downloadFile.OpenAsync(FileAccessMode::Read);
+}
+
+// file names from a hash of the url, query strings and all
+_Use_decl_annotations_
+hstring HttpFileCache::CacheKey(
+    Uri const& uri)
+{
+    auto sha256 = HashAlgorithmProvider::OpenAlgorithm(HashAlgorithmNames::Sha256());
+
+    auto url = CryptographicBuffer::ConvertStringToBinary(uri.AbsoluteUri(), BinaryStringEncoding::Utf8);
+
+    return CryptographicBuffer::EncodeToHexString(sha256.HashData(url));
+}
+
+// url, etag, last-modified and expiry in file time, one per line, false when there's no entry for
+// the url
+_Use_decl_annotations_
+IAsyncOperation<bool> HttpFileCache::ReadEntryAsync(
+    StorageFolder cacheFolder,
+    hstring key,
+    Entry& entry)
+{
+    auto item = co_await cacheFolder.TryGetItemAsync(key + L".entry");
+    if (item == nullptr)
+    {
+        co_return false;
+    }
+
+    auto lines = co_await FileIO::ReadLinesAsync(item.as<StorageFile>());
+    if (lines.Size() < 4 || lines.GetAt(0) != entry.url)
+    {
+        co_return false;
+    }
+
+    entry.etag = lines.GetAt(1);
+    entry.lastModified = lines.GetAt(2);
+    entry.expires = clock::from_file_time(file_time{ std::wcstoull(lines.GetAt(3).c_str(), nullptr, 10) });
+
+    co_return true;
+}
+
+_Use_decl_annotations_
+IAsyncAction HttpFileCache::WriteEntryAsync(
+    StorageFolder cacheFolder,
+    hstring key,
+    Entry entry)
+{
+    auto file = co_await cacheFolder.CreateFileAsync(key + L".entry", CreationCollisionOption::ReplaceExisting);
+
+    auto lines = single_threaded_vector<hstring>({
+        entry.url,
+        entry.etag,
+        entry.lastModified,
+        to_hstring(clock::to_file_time(entry.expires).value) });
+
+    co_await FileIO::WriteLinesAsync(file, lines);
+}
@@ -0,0 +1,48 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <winrt/Windows.Storage.Streams.h>
+
+#include <functional>
+
+// under the app's local folder
+#define PDF_HTTP_CACHE_FOLDER L"PdfCache"
+
+// files fetched over http kept on disk by url, a copy the server said is fresh opens without the
+// network, a stale one is revalidated with the etag and last-modified it came with, and the copy
+// is opened as is when the server can't be reached
+struct HttpFileCache
+{
+    // http and https only, anything else is a file name
+    static bool TryParseWebUri(
+        _In_ winrt::hstring const& name,
+        _Out_ winrt::Windows::Foundation::Uri& uri);
+
+    // progress is bytes downloaded against the content length, 0 when the server sent none
+    static winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::Streams::IRandomAccessStream> OpenAsync(
+        _In_ winrt::Windows::Foundation::Uri uri,
+        _In_opt_ std::function<void(uint64_t, uint64_t)> progress);
+
+private:
+    struct Entry
+    {
+        winrt::hstring url;
+        winrt::hstring etag;
+        winrt::hstring lastModified;
+        winrt::clock::time_point expires;
+    };
+
+    static winrt::hstring CacheKey(
+        _In_ winrt::Windows::Foundation::Uri const& uri);
+
+    static winrt::Windows::Foundation::IAsyncOperation<bool> ReadEntryAsync(
+        _In_ winrt::Windows::Storage::StorageFolder cacheFolder,
+        _In_ winrt::hstring key,
+        _Inout_ Entry& entry);
+    static winrt::Windows::Foundation::IAsyncAction WriteEntryAsync(
+        _In_ winrt::Windows::Storage::StorageFolder cacheFolder,
+        _In_ winrt::hstring key,
+        _In_ Entry entry);
+};
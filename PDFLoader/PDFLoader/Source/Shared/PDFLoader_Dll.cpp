@@ -3,9 +3,7 @@
 
 #include "pch.h"
 
-#include "Unity/IUnityGraphics.h"
-#include "PlatformBase.h"
-#include "UnityDeviceResource.h"
+#include "PluginDll.h"
 
 #include "Plugin.PdfLoader.h"
 
@@ -19,185 +17,309 @@ namespace winrt
     using namespace winrt::PDFLoader::Plugin;
 }
 
-static INSTANCE_HANDLE s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
-static std::unordered_map<INSTANCE_HANDLE, winrt::IModule> s_instances;
-HRESULT GetModule(INSTANCE_HANDLE id, _Out_ winrt::IModule& module)
+void OnPluginLoad()
 {
-    if (id < INSTANCE_HANDLE_START)
-    {
-        IFR(E_INVALIDARG);
-    }
-
-    auto it = s_instances.find(id);
-    if (it == s_instances.end())
-    {
-        IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
-    }
+}
 
-    module = it->second;
+void OnPluginUnloading()
+{
+}
 
-    NULL_CHK_HR(module, E_POINTER);
+void OnPluginUnload()
+{
+}
 
-    return S_OK;
+void OnPluginDeviceResetStarted()
+{
 }
 
-static std::shared_ptr<IUnityDeviceResource> s_deviceResource;
-static UnityGfxRenderer s_deviceType = kUnityGfxRendererNull;
-static IUnityInterfaces* s_unityInterfaces = nullptr;
-static IUnityGraphics* s_unityGraphics = nullptr;
 
-HRESULT TrackModule(winrt::IModule &module, INSTANCE_HANDLE * handleId)
+// PdfLoaders
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreatePdf(
+    _In_ StateChangedCallback fnCallback,
+    _Out_ INSTANCE_HANDLE* handleId)
 {
-    // get the last index value;
-    auto handle = s_lastPluginHandleIndex;
+    winrt::IModule module = impl::PdfLoader::Create(GetUnityDeviceResource(), fnCallback);
+
+    return TrackModule(module, handleId);
+}
 
-    // add to map
-    auto success = s_instances.emplace(handle, module);
-    if (success.second)
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LoadFile(
+    _In_ INSTANCE_HANDLE id,
+    _In_ LPCWSTR pszBaseFolder,
+    _In_ LPCWSTR pszFilename)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        *handleId = handle++;
-        s_lastPluginHandleIndex = handle;
+        auto loader = module.as<winrt::PdfLoader>();
+
+        hr = loader.LoadFile(pszBaseFolder, pszFilename);
     }
 
-    return (success.second ? S_OK : E_UNEXPECTED);
+    return hr;
 }
 
-// --------------------------------------------------------------------------
-// UnitySetInterfaces
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
-
-extern "C" void	UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces)
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CancelLoad(
+    _In_ INSTANCE_HANDLE id)
 {
-    s_lastPluginHandleIndex = INSTANCE_HANDLE_START;
-    s_instances.clear();
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto loader = module.as<winrt::PdfLoader>();
 
-    s_unityInterfaces = unityInterfaces;
-    s_unityGraphics = s_unityInterfaces->Get<IUnityGraphics>();
-    s_unityGraphics->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
+        hr = loader.CancelLoad();
+    }
 
-    // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
-    OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
+    return hr;
 }
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPageCount(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ uint32_t* pageCount)
 {
-    for (auto&& kv : s_instances)
+    NULL_CHK_HR(pageCount, E_INVALIDARG);
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        kv.second.Shutdown();
-        kv.second = nullptr;
-    }
-    s_instances.clear();
+        auto loader = module.as<winrt::PdfLoader>();
 
-    s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
+        *pageCount = loader.PageCount();
+    }
 
-    s_unityGraphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+    return hr;
 }
 
-// --------------------------------------------------------------------------
-// GraphicsDeviceEvent
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SelectPage(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t pageIndex)
 {
-    // Create graphics API implementation upon initialization
-    if (eventType == kUnityGfxDeviceEventInitialize)
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        assert(s_deviceResource == nullptr);
+        auto loader = module.as<winrt::PdfLoader>();
 
-        s_deviceType = s_unityGraphics->GetRenderer();
+        hr = loader.SelectPage(pageIndex);
+    }
 
-        s_deviceResource = CreateDeviceResource(s_deviceType);
+    return hr;
+}
+
+// the page fit into maxWidth x maxHeight with its aspect kept, or scaled by dpi when it's not 0
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SelectPageAtSize(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t pageIndex,
+    _In_ uint32_t maxWidth,
+    _In_ uint32_t maxHeight,
+    _In_ float dpi)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto loader = module.as<winrt::PdfLoader>();
+
+        hr = loader.SelectPageAtSize(pageIndex, maxWidth, maxHeight, dpi);
     }
 
-    // Let the implementation process the device related event
-    if (s_deviceResource != nullptr)
+    return hr;
+}
+
+// video memory kept for rendered pages and prefetched neighbours, 0 keeps only the selected page
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPageCacheBudget(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t megabytes)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        s_deviceResource->ProcessDeviceEvent(eventType, s_unityInterfaces);
+        auto loader = module.as<winrt::PdfLoader>();
+
+        hr = loader.SetPageCacheBudget(megabytes);
     }
 
-    // Cleanup graphics API implementation upon shutdown
-    if (eventType == kUnityGfxDeviceEventShutdown)
+    return hr;
+}
+
+// a page the size of the one shown is copied into its texture, the Selected state keeps the
+// same texture pointer until the size changes
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureReuse(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        s_deviceResource.reset();
-        s_deviceResource = nullptr;
-        s_deviceType = kUnityGfxRendererNull;
+        auto loader = module.as<winrt::PdfLoader>();
+
+        hr = loader.SetTextureReuse(enable != 0);
     }
+
+    return hr;
 }
 
+// pages are kept as bc1, the Selected state's format says which a page is
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPageCompression(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto loader = module.as<winrt::PdfLoader>();
+
+        hr = loader.SetPageCompression(enable != 0);
+    }
+
+    return hr;
+}
 
-// --------------------------------------------------------------------------
-// OnRenderEvent
-// This will be called for GL.IssuePluginEvent script calls; eventID will
-// be the integer passed to IssuePluginEvent. In this example, we just ignore
-// that value.
-static void UNITY_INTERFACE_API OnRenderEvent(int32_t eventID)
+// renders alongside other requests, the Selected state carries the request id and slot,
+// a newer request on the same slot cancels this one
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API RequestPage(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t slot,
+    _In_ uint32_t pageIndex,
+    _In_ uint32_t maxWidth,
+    _In_ uint32_t maxHeight,
+    _In_ float dpi,
+    _Out_ uint32_t* requestId)
 {
-    DWORD dwId = static_cast<DWORD>(eventID);
+    NULL_CHK_HR(requestId, E_INVALIDARG);
 
-    INSTANCE_HANDLE id = static_cast<INSTANCE_HANDLE>(LOWORD(dwId));
+    *requestId = 0;
 
     winrt::IModule module = nullptr;
-    if (SUCCEEDED(GetModule(id, module)))
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        uint16_t frameId = static_cast<uint16_t>(HIWORD(dwId));
+        auto loader = module.as<winrt::PdfLoader>();
 
-        module.OnRenderEvent(frameId);
+        hr = loader.RequestPage(slot, pageIndex, maxWidth, maxHeight, dpi, *requestId);
     }
+
+    return hr;
 }
 
-// --------------------------------------------------------------------------
-// GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
-extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc()
+// x, y, width and height in normalized trim box coordinates, the region is fit into
+// pixelWidth x pixelHeight with its aspect kept
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API RequestRegion(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t slot,
+    _In_ uint32_t pageIndex,
+    _In_ float x,
+    _In_ float y,
+    _In_ float width,
+    _In_ float height,
+    _In_ uint32_t pixelWidth,
+    _In_ uint32_t pixelHeight,
+    _Out_ uint32_t* requestId)
 {
-    return OnRenderEvent;
-}
+    NULL_CHK_HR(requestId, E_INVALIDARG);
 
+    *requestId = 0;
 
-// --------------------------------------------------------------------------
-// Other function
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstance(
-    _In_ INSTANCE_HANDLE id)
-{
     winrt::IModule module = nullptr;
-    if (SUCCEEDED(GetModule(id, module)))
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
     {
-        s_instances.erase(id);
-        module.Shutdown();
-        module = nullptr;
+        auto loader = module.as<winrt::PdfLoader>();
+
+        hr = loader.RequestRegion(slot, pageIndex, winrt::Windows::Foundation::Rect{ x, y, width, height }, pixelWidth, pixelHeight, *requestId);
     }
+
+    return hr;
 }
 
+// the part of the page on screen in normalized trim box coordinates and how many pixels wide
+// it's shown, Tiles is raised as its tiles land in the atlas
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTileView(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t pageIndex,
+    _In_ float x,
+    _In_ float y,
+    _In_ float width,
+    _In_ float height,
+    _In_ uint32_t viewPixels)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto loader = module.as<winrt::PdfLoader>();
 
-// PdfLoaders
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreatePdf(
-    _In_ StateChangedCallback fnCallback,
-    _Out_ INSTANCE_HANDLE* handleId)
+        hr = loader.SetTileView(pageIndex, winrt::Windows::Foundation::Rect{ x, y, width, height }, viewPixels);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetTiles(
+    _In_ INSTANCE_HANDLE id,
+    _Out_writes_to_(capacity, *count) TILE_INFO* tiles,
+    _In_ uint32_t capacity,
+    _Out_ uint32_t* count)
 {
-    winrt::IModule module = impl::PdfLoader::Create(s_deviceResource, fnCallback);
+    NULL_CHK_HR(tiles, E_INVALIDARG);
+    NULL_CHK_HR(count, E_INVALIDARG);
 
-    return TrackModule(module, handleId);
+    *count = 0;
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto loader = module.as<winrt::PdfLoader>();
+
+        *count = winrt::get_self<impl::PdfLoader>(loader)->GetTiles(tiles, capacity);
+    }
+
+    return hr;
 }
 
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LoadFile(
+// count pages from firstPage into one atlas of thumbSize square cells, Thumbnails is raised
+// with the request id once they're all drawn
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API RenderThumbnails(
     _In_ INSTANCE_HANDLE id,
-    _In_ LPCWSTR pszBaseFolder,
-    _In_ LPCWSTR pszFilename)
+    _In_ uint32_t firstPage,
+    _In_ uint32_t count,
+    _In_ uint32_t thumbSize,
+    _Out_ uint32_t* requestId)
 {
+    NULL_CHK_HR(requestId, E_INVALIDARG);
+
+    *requestId = 0;
+
     winrt::IModule module = nullptr;
     HRESULT hr = GetModule(id, module);
     if (SUCCEEDED(hr))
     {
         auto loader = module.as<winrt::PdfLoader>();
 
-        hr = loader.LoadFile(pszBaseFolder, pszFilename);
+        hr = loader.RenderThumbnails(firstPage, count, thumbSize, *requestId);
     }
 
     return hr;
 }
 
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPageCount(
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetThumbnails(
     _In_ INSTANCE_HANDLE id,
-    _Out_ uint32_t* pageCount)
+    _Out_writes_to_(capacity, *count) THUMBNAIL_INFO* thumbnails,
+    _In_ uint32_t capacity,
+    _Out_ uint32_t* count)
 {
-    NULL_CHK_HR(pageCount, E_INVALIDARG);
+    NULL_CHK_HR(thumbnails, E_INVALIDARG);
+    NULL_CHK_HR(count, E_INVALIDARG);
+
+    *count = 0;
 
     winrt::IModule module = nullptr;
     HRESULT hr = GetModule(id, module);
@@ -205,23 +327,34 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPageCount(
     {
         auto loader = module.as<winrt::PdfLoader>();
 
-        *pageCount = loader.PageCount();
+        *count = winrt::get_self<impl::PdfLoader>(loader)->GetThumbnails(thumbnails, capacity);
     }
 
     return hr;
 }
 
-extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SelectPage(
+// pages indexed so far, TextIndexed is raised once the whole document is, no page is rendered
+// for a search
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SearchText(
     _In_ INSTANCE_HANDLE id,
-    _In_ uint32_t pageIndex)
+    _In_ LPCWSTR query,
+    _Out_writes_to_(capacity, *count) TEXT_HIT* hits,
+    _In_ uint32_t capacity,
+    _Out_ uint32_t* count)
 {
+    NULL_CHK_HR(query, E_INVALIDARG);
+    NULL_CHK_HR(hits, E_INVALIDARG);
+    NULL_CHK_HR(count, E_INVALIDARG);
+
+    *count = 0;
+
     winrt::IModule module = nullptr;
     HRESULT hr = GetModule(id, module);
     if (SUCCEEDED(hr))
     {
         auto loader = module.as<winrt::PdfLoader>();
 
-        hr = loader.SelectPage(pageIndex);
+        *count = winrt::get_self<impl::PdfLoader>(loader)->SearchText(query, hits, capacity);
     }
 
     return hr;
@@ -4,8 +4,21 @@
 #include "pch.h"
 #include "Plugin.PdfLoader.h"
 #include "WICTextureLoader.h"
+#include "TilePyramid.h"
+#include "HttpFileCache.h"
+#include "DocumentCache.h"
+#include "BlockCompress.h"
+#include <winrt/Windows.Graphics.Imaging.h>
+#include <winrt/Windows.Media.Ocr.h>
 #include <winrt/windows.storage.streams.h>
 #include <Winrt/Windows.Web.Http.h>
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <vector>
+
+#pragma comment(lib, "d2d1")
+#pragma comment(lib, "d3d11")
 
 using namespace winrt;
 using namespace PDFLoader::Plugin::implementation;
@@ -22,7 +35,7 @@ PDFLoader::Plugin::IModule PdfLoader::Create(
 {
     auto loader = make<PdfLoader>();
 
-    if (SUCCEEDED(loader.as<IModulePriv>()->Initialize(unityDevice, fnCallback)))
+    if (SUCCEEDED(loader.as<IModulePriv>()->Initialize(unityDevice, fnCallback, nullptr)))
     {
         return loader;
     }
@@ -32,11 +45,40 @@ PDFLoader::Plugin::IModule PdfLoader::Create(
 
 PdfLoader::PdfLoader()
     : m_loadDataAsyncOp(nullptr)
-    , m_selectPageAsync(nullptr)
+    , m_sharedDocument(nullptr)
     , m_document(nullptr)
     , m_page(nullptr)
-    , m_pageTexture(nullptr)
-    , m_pageTextureSRV(nullptr) {
+    , m_nextRequestId(0)
+    , m_slotRequests()
+    , m_slotPages()
+    , m_pendingRequests()
+    , m_activeRenders()
+    , m_lastRequest()
+    , m_prefetchAsync(nullptr)
+    , m_tilePyramid(nullptr)
+    , m_tilesAsync(nullptr)
+    , m_tileViewPage(0)
+    , m_tileView()
+    , m_tileViewPixels(0)
+    , m_thumbnailAtlas(nullptr)
+    , m_thumbnailRequest(nullptr)
+    , m_thumbnailsAsync(nullptr)
+    , m_resetRequests()
+    , m_resetThumbnails(nullptr)
+    , m_resetTileViewPixels(0)
+    , m_textIndex(nullptr)
+    , m_textIndexAsync(nullptr)
+    , m_reuseTextures(false)
+    , m_slotTextures()
+    , m_compressPages(false)
+    , m_pixelBuffers()
+    , m_pageCache()
+    , m_cacheBudgetBytes(static_cast<uint64_t>(PDF_PAGE_CACHE_DEFAULT_MB) * 1024 * 1024)
+    , m_renderDevice(nullptr)
+    , m_renderContext(nullptr)
+    , m_d2dDevice(nullptr)
+    , m_d2dContext(nullptr)
+    , m_pdfRenderer(nullptr) {
 }
 
 // IModule
@@ -48,11 +90,11 @@ void PdfLoader::Shutdown()
         m_loadDataAsyncOp = nullptr;
     }
 
-    if (m_selectPageAsync != nullptr)
-    {
-        m_selectPageAsync.Cancel();
-        m_selectPageAsync = nullptr;
-    }
+    CancelRequests();
+    CancelPrefetch();
+    CancelTiles(true);
+    CancelThumbnails();
+    CancelTextIndex();
 
     if (m_page != nullptr)
     {
@@ -65,19 +107,174 @@ void PdfLoader::Shutdown()
         m_document = nullptr;
     }
 
+    // closed once no other loader holds it
+    m_sharedDocument = nullptr;
+
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        m_slotPages.clear();
+        m_thumbnailAtlas = nullptr;
+        m_thumbnailRequest = nullptr;
+        m_textIndex = nullptr;
+    }
+
+    ClearPageCache();
+
+    {
+        std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+        m_slotTextures.clear();
+    }
+
+    m_pdfRenderer = nullptr;
+    m_d2dContext = nullptr;
+    m_d2dDevice = nullptr;
+    m_renderContext = nullptr;
+    m_renderDevice = nullptr;
+
     Module::Shutdown();
 }
 
+// every texture opened on unity's device goes, so does the render device made on its adapter,
+// the document, its pages and the text index stay open
+void PdfLoader::OnDeviceResetStarted()
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        // the newest request of every slot, shown or still rendering
+        for (auto const& kv : m_slotRequests)
+        {
+            m_resetRequests.push_back(kv.second);
+        }
+
+        m_resetThumbnails = m_thumbnailRequest;
+        m_resetTileViewPixels = m_tileViewPixels;
+
+        m_slotPages.clear();
+        m_thumbnailAtlas = nullptr;
+        m_thumbnailRequest = nullptr;
+        m_tileViewPixels = 0;
+    }
+
+    CancelRequests();
+    CancelPrefetch();
+    CancelTiles(true);
+    CancelThumbnails();
+
+    ClearPageCache();
+
+    std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+    m_slotTextures.clear();
+
+    m_pdfRenderer = nullptr;
+    m_d2dContext = nullptr;
+    m_d2dDevice = nullptr;
+    m_renderContext = nullptr;
+    m_renderDevice = nullptr;
+}
+
+void PdfLoader::OnDeviceResetCompleted()
+{
+    RestoreDeviceContentAsync();
+}
+
+// the slots raise PageSelected with new request ids, the tiles and thumbnails come back as
+// they would for the app asking again
+fire_and_forget PdfLoader::RestoreDeviceContentAsync()
+{
+    auto strong = get_strong();
+
+    co_await resume_background();
+
+    // whatever the app asked for again in the meantime is left to that
+    std::vector<PageRequest> requests;
+    std::shared_ptr<ThumbnailAtlas> thumbnails = nullptr;
+    uint32_t tileViewPage = 0;
+    Rect tileView{};
+    uint32_t tileViewPixels = 0;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        for (auto const& request : m_resetRequests)
+        {
+            if (m_slotRequests.find(request.slot) == m_slotRequests.end())
+            {
+                requests.push_back(request);
+            }
+        }
+        m_resetRequests.clear();
+
+        if (m_thumbnailRequest == nullptr)
+        {
+            thumbnails = m_resetThumbnails;
+        }
+        m_resetThumbnails = nullptr;
+
+        if (m_tileViewPixels == 0)
+        {
+            tileViewPage = m_tileViewPage;
+            tileView = m_tileView;
+            tileViewPixels = m_resetTileViewPixels;
+        }
+        m_resetTileViewPixels = 0;
+    }
+
+    if (m_document == nullptr)
+    {
+        co_return;
+    }
+
+    HRESULT hr = S_OK;
+
+    for (auto& request : requests)
+    {
+        hr = SubmitRequest(request);
+        if (FAILED(hr))
+        {
+            break;
+        }
+    }
+
+    if (SUCCEEDED(hr) && tileViewPixels > 0)
+    {
+        hr = SetTileView(tileViewPage, tileView, tileViewPixels);
+    }
+
+    if (SUCCEEDED(hr) && thumbnails != nullptr)
+    {
+        uint32_t requestId = 0;
+        hr = RenderThumbnails(thumbnails->firstPage, thumbnails->count, thumbnails->thumbSize, requestId);
+    }
+
+    if (FAILED(hr))
+    {
+        RaiseFailed(hr);
+    }
+}
+
 // PdfLoader
 HRESULT PdfLoader::LoadFile(hstring const& folderName, hstring const& fileName)
 {
     NULL_CHK_HR(fileName.c_str(), E_INVALIDARG);
 
+    // the newest file wins, the document an older load was waiting on keeps loading for
+    // whoever else asked for it
     if (m_loadDataAsyncOp != nullptr && m_loadDataAsyncOp.Status() == AsyncStatus::Started)
     {
-        return hresult_canceled().code();
+        m_loadDataAsyncOp.Cancel();
     }
 
+    // pages of the previous document
+    CancelRequests();
+    CancelPrefetch();
+    CancelTiles(false);
+    CancelThumbnails();
+    CancelTextIndex();
+    ClearPageCache();
+
     m_loadDataAsyncOp = LoadFileAsync(folderName, fileName);
     if (m_loadDataAsyncOp.Status() != AsyncStatus::Completed)
     {
@@ -115,9 +312,14 @@ HRESULT PdfLoader::LoadFile(hstring const& folderName, hstring const& fileName)
             }
 
             Callback(state);
+
+            if (status == AsyncStatus::Completed)
+            {
+                StartTextIndex();
+            }
         });
 
-        m_loadDataAsyncOp.Progress([&](auto&&, double progress)
+        m_loadDataAsyncOp.Progress([=](auto&&, double progress)
         {
             CALLBACK_STATE callbackState;
             ZeroMemory(&callbackState, sizeof(callbackState));
@@ -139,183 +341,2005 @@ HRESULT PdfLoader::LoadFile(hstring const& folderName, hstring const& fileName)
     return S_OK;
 }
 
+// the file being read or parsed is let go as soon as no other loader waits on it, nothing is
+// raised for the cancelled load
+HRESULT PdfLoader::CancelLoad()
+{
+    if (m_loadDataAsyncOp != nullptr && m_loadDataAsyncOp.Status() == AsyncStatus::Started)
+    {
+        m_loadDataAsyncOp.Cancel();
+    }
+
+    return S_OK;
+}
+
 HRESULT PdfLoader::SelectPage(uint32_t pageIndex)
 {
-    NULL_CHK_HR(m_document, E_NOT_VALID_STATE);
+    return SelectPageAtSize(pageIndex, PDF_PAGE_RENDER_SIZE, PDF_PAGE_RENDER_SIZE, 0.0f);
+}
+
+// a max of 0 leaves that side unbounded, a dpi of 0 fits the page to the max size
+HRESULT PdfLoader::SelectPageAtSize(uint32_t pageIndex, uint32_t maxWidth, uint32_t maxHeight, float dpi)
+{
+    uint32_t requestId = 0;
+
+    return RequestPage(0, pageIndex, maxWidth, maxHeight, dpi, requestId);
+}
+
+// pages of the size the slot shows are copied into its texture instead of handing unity a new one
+HRESULT PdfLoader::SetTextureReuse(bool enabled)
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
 
-    if (m_selectPageAsync != nullptr && m_selectPageAsync.Status() == AsyncStatus::Started)
+        m_reuseTextures = enabled;
+    }
+
+    if (!enabled)
     {
-        return hresult_canceled().code();
+        std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+        m_slotTextures.clear();
     }
 
-    m_selectPageAsync = SelectPageAsync(pageIndex);
-    if (m_selectPageAsync.Status() != AsyncStatus::Completed)
+    return S_OK;
+}
+
+// pages are read back and encoded to bc1 on the render thread, an eighth of the video memory
+// for a small cost at zoomed in text, pages already rendered are dropped
+HRESULT PdfLoader::SetPageCompression(bool enabled)
+{
     {
-        m_selectPageAsync.Completed([=](auto const& asyncOp, AsyncStatus const& status)
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        if (m_compressPages == enabled)
         {
-            UNREFERENCED_PARAMETER(asyncOp);
+            return S_OK;
+        }
 
-            if (status == AsyncStatus::Canceled)
-            {
-                return;
-            }
+        m_compressPages = enabled;
+    }
 
-            CALLBACK_STATE state{};
-            ZeroMemory(&state, sizeof(CALLBACK_STATE));
+    CancelPrefetch();
+    ClearPageCache();
 
-            if (status == AsyncStatus::Error)
-            {
-                state.type = CallbackType::Failed;
+    return S_OK;
+}
 
-                ZeroMemory(&state.value.failedState, sizeof(FAILED_STATE));
+// 0 keeps only the selected page
+HRESULT PdfLoader::SetPageCacheBudget(uint32_t megabytes)
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_cacheMutex);
 
-                state.value.failedState.hresult = to_hresult();
-            }
-            else
-            {
-                // notify plugin of the mesh vertex and index size
-                state.type = CallbackType::Pdf;
+        m_cacheBudgetBytes = static_cast<uint64_t>(megabytes) * 1024 * 1024;
+    }
 
-                ZeroMemory(&state.value.pdfState, sizeof(PDF_STATE));
-                state.value.pdfState.stateType = PdfStateType::Selected;
+    TrimPageCache();
 
-                auto trimbox = m_page.Dimensions().TrimBox();
+    return S_OK;
+}
 
-                state.value.pdfState.page = pageIndex;
-                state.value.pdfState.width = static_cast<int32_t>(trimbox.Width);
-                state.value.pdfState.height = static_cast<int32_t>(trimbox.Height);
-                state.value.pdfState.textureSRV = m_pageTextureSRV.get();
-            }
+// the page is raised with the request id once rendered, before returning when it's cached,
+// a newer request on the slot cancels this one
+HRESULT PdfLoader::RequestPage(uint32_t slot, uint32_t pageIndex, uint32_t maxWidth, uint32_t maxHeight, float dpi, uint32_t& requestId)
+{
+    requestId = 0;
 
-            Callback(state);
-        });
+    NULL_CHK_HR(m_document, E_NOT_VALID_STATE);
+
+    if (dpi < 0.0f || (dpi == 0.0f && (maxWidth == 0 || maxHeight == 0)))
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (pageIndex >= m_document.PageCount())
+    {
+        IFR(E_BOUNDS);
     }
 
+    PageRequest request{};
+    request.slot = slot;
+    request.pageIndex = pageIndex;
+    request.region = PageRequest::WholePage();
+    request.maxWidth = maxWidth;
+    request.maxHeight = maxHeight;
+    request.dpi = dpi;
+
+    IFR(SubmitRequest(request));
+
+    requestId = request.requestId;
+
     return S_OK;
 }
 
-// internal
-IAsyncActionWithProgress<double> PdfLoader::LoadFileAsync(hstring folderName, hstring fileName)
+// part of the page fit into width x height, a request like any other page on the slot, the
+// region is in normalized trim box coordinates
+HRESULT PdfLoader::RequestRegion(uint32_t slot, uint32_t pageIndex, Rect const& region, uint32_t width, uint32_t height, uint32_t& requestId)
 {
-    auto context = apartment_context();
+    requestId = 0;
 
-    co_await resume_background();
+    NULL_CHK_HR(m_document, E_NOT_VALID_STATE);
 
-    auto progress = co_await get_progress_token();
+    if (width == 0 || height == 0
+        || region.Width <= 0.0f || region.Height <= 0.0f
+        || region.X < 0.0f || region.Y < 0.0f
+        || region.X + region.Width > 1.0f || region.Y + region.Height > 1.0f)
+    {
+        IFR(E_INVALIDARG);
+    }
 
-    double currentProgress = 0;
-    double total = 4;
+    if (pageIndex >= m_document.PageCount())
+    {
+        IFR(E_BOUNDS);
+    }
 
-    progress(0.0);
+    PageRequest request{};
+    request.slot = slot;
+    request.pageIndex = pageIndex;
+    request.region = region;
+    request.maxWidth = width;
+    request.maxHeight = height;
+    request.dpi = 0.0f;
+
+    IFR(SubmitRequest(request));
+
+    requestId = request.requestId;
+
+    return S_OK;
+}
+
+// the view in normalized trim box coordinates, view pixels is how wide it's shown, the tiles
+// it needs are raised as they land in the atlas
+HRESULT PdfLoader::SetTileView(uint32_t pageIndex, Rect const& view, uint32_t viewPixels)
+{
+    NULL_CHK_HR(m_document, E_NOT_VALID_STATE);
+
+    if (viewPixels == 0 || view.Width <= 0.0f || view.Height <= 0.0f)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    if (pageIndex >= m_document.PageCount())
+    {
+        IFR(E_BOUNDS);
+    }
+
+    Rect bounds{};
 
-    std::wstring_view fileNameView = fileName;
+    HRESULT hr = S_OK;
 
-    Windows::Storage::Streams::IRandomAccessStream stream;
-    if (fileNameView.find_last_of(L"http:", 0) == 0 || 
-        fileNameView.find_last_of(L"https:", 0) == 0)
+    try
+    {
+        bounds = PageBounds(m_document.GetPage(pageIndex));
+    }
+    catch (hresult_error const& e)
     {
-        auto uri = Windows::Foundation::Uri(fileName);
-        auto streamReference = RandomAccessStreamReference::CreateFromUri(uri);
+        hr = e.code();
+    }
 
-        progress(++currentProgress / total);
+    IFR(hr);
 
-        stream = co_await streamReference.OpenReadAsync();
+    com_ptr<TilePyramid> tilePyramid = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
 
-        progress(++currentProgress / total);
+        tilePyramid = m_tilePyramid;
     }
-    else
+
+    if (tilePyramid == nullptr)
     {
-        Windows::Storage::StorageFolder storageFolder = nullptr;
-        try
-        {
-            storageFolder = Windows::Storage::ApplicationData::Current().LocalFolder();
-        }
-        catch (...)
-        {
-            storageFolder = Windows::Storage::KnownFolders::DocumentsLibrary();
-        }
+        com_ptr<ID3D11Device> unityDevice = nullptr;
+        IFR(GetUnityDevice(unityDevice));
 
-        if (!folderName.empty() && std::wstring(folderName).find(L":\\") != std::wstring::npos)
         {
-            storageFolder = co_await Windows::Storage::StorageFolder::GetFolderFromPathAsync(folderName);
+            std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+            // tiles are only drawn with direct2d
+            IFR(CreateRenderer(unityDevice.get()));
         }
-        else if (!folderName.empty())
+
+        IFR(TilePyramid::Create(m_renderDevice.get(), unityDevice.get(), tilePyramid));
+
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        m_tilePyramid = tilePyramid;
+    }
+
+    tilePyramid->SetView(pageIndex, Size{ bounds.Width, bounds.Height }, view, viewPixels);
+
+    // the running one picks up the new view with its next tile
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        m_tileViewPage = pageIndex;
+        m_tileView = view;
+        m_tileViewPixels = viewPixels;
+
+        if (m_tilesAsync != nullptr && m_tilesAsync.Status() == AsyncStatus::Started)
         {
-            storageFolder = co_await storageFolder.GetFolderAsync(folderName);
+            return S_OK;
         }
+    }
 
-        progress(++currentProgress / total);
-
-        auto storageFile = co_await storageFolder.GetFileAsync(fileName);
+    IAsyncAction tiles = nullptr;
 
-        progress(++currentProgress / total);
+    try
+    {
+        tiles = RenderTilesAsync(tilePyramid);
 
-        stream = co_await storageFile.OpenAsync(Windows::Storage::FileAccessMode::Read);
+        tiles.Completed([=](auto const& asyncOp, AsyncStatus const& status)
+        {
+            if (status == AsyncStatus::Error)
+            {
+                RaiseFailed(asyncOp.ErrorCode());
+            }
+        });
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
     }
 
-    progress(++currentProgress / total);
+    IFR(hr);
 
-    m_document = co_await PdfDocument::LoadFromStreamAsync(stream);
+    std::lock_guard<slim_mutex> guard(m_requestMutex);
 
-    progress(++currentProgress / total);
+    m_tilesAsync = tiles;
 
-    co_await context;
+    return S_OK;
+}
 
-    co_return;
+_Use_decl_annotations_
+uint32_t PdfLoader::GetTiles(TILE_INFO* tiles, uint32_t capacity)
+{
+    com_ptr<TilePyramid> tilePyramid = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        tilePyramid = m_tilePyramid;
+    }
+
+    return tilePyramid != nullptr ? tilePyramid->GetTiles(tiles, capacity) : 0;
 }
 
-IAsyncAction PdfLoader::SelectPageAsync(uint32_t pageIndex)
+// count pages from firstPage, each fit into a thumbSize square cell of one atlas, raised once
+// with every page's place in it, pages prepare in parallel and draw in turn
+HRESULT PdfLoader::RenderThumbnails(uint32_t firstPage, uint32_t count, uint32_t thumbSize, uint32_t& requestId)
 {
-    m_page = m_document.GetPage(pageIndex);
+    requestId = 0;
 
-    auto size = m_page.Size();
-    co_await m_page.PreparePageAsync();
+    NULL_CHK_HR(m_document, E_NOT_VALID_STATE);
 
-    InMemoryRandomAccessStream memStream;
-    auto renderOptions = PdfPageRenderOptions();
-    renderOptions.DestinationHeight(2048);
-    renderOptions.DestinationWidth(2048);
-    co_await m_page.RenderToStreamAsync(memStream, renderOptions);
+    uint32_t pageCount = m_document.PageCount();
+    if (firstPage >= pageCount)
+    {
+        IFR(E_BOUNDS);
+    }
 
-    com_ptr<IStream> spStream = nullptr;
-    IFT(CreateStreamOverRandomAccessStream(winrt::get_unknown(memStream), __uuidof(IStream), spStream.put_void()));
+    if (count == 0 || thumbSize == 0 || thumbSize > PDF_THUMBNAIL_MAX_SIZE)
+    {
+        IFR(E_INVALIDARG);
+    }
 
-    auto pWIC = DirectX::_GetWIC();
+    count = count < pageCount - firstPage ? count : pageCount - firstPage;
 
-    com_ptr<IWICStream> stream;
-    IFT(pWIC->CreateStream(stream.put()));
+    // as square as the grid gets
+    uint32_t columns = 1;
+    while (columns * columns < count)
+    {
+        ++columns;
+    }
+    uint32_t rows = (count + columns - 1) / columns;
+
+    if (columns * thumbSize > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION || rows * thumbSize > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+    {
+        IFR(E_INVALIDARG);
+    }
 
-    IFT(stream->InitializeFromIStream(spStream.get()));
+    CancelThumbnails();
 
-    com_ptr<IWICBitmapDecoder> decoder;
-    IFT(pWIC->CreateDecoderFromStream(stream.get(), 0, WICDecodeMetadataCacheOnDemand, decoder.put()));
+    auto atlas = std::make_shared<ThumbnailAtlas>();
+    atlas->firstPage = firstPage;
+    atlas->count = count;
+    atlas->thumbSize = thumbSize;
+    atlas->columns = columns;
+    atlas->width = columns * thumbSize;
+    atlas->height = rows * thumbSize;
 
-    com_ptr<IWICBitmapFrameDecode> frame;
-    IFT(decoder->GetFrame(0, frame.put()));
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
 
-    UINT width = 0, height = 0;
-    IFT(frame->GetSize(&width, &height));
+        atlas->requestId = ++m_nextRequestId;
 
-    auto resources = m_deviceResources.lock();
-    if (resources != nullptr)
+        m_thumbnailRequest = atlas;
+    }
+
+    IAsyncAction thumbnails = nullptr;
+
+    HRESULT hr = S_OK;
+
+    try
     {
-        com_ptr<ID3D11DeviceResource> spD3D11Resources = nullptr;
-        IFT(resources->QueryInterface(__uuidof(ID3D11DeviceResource), spD3D11Resources.put_void()));
+        thumbnails = RenderThumbnailsAsync(atlas);
+
+        thumbnails.Completed([=](auto const& asyncOp, AsyncStatus const& status)
+        {
+            if (status == AsyncStatus::Error)
+            {
+                RaiseFailed(asyncOp.ErrorCode());
+
+                return;
+            }
+
+            if (status != AsyncStatus::Completed)
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<slim_mutex> guard(m_requestMutex);
 
-        com_ptr<ID3D11Resource> texture;
-        com_ptr<ID3D11ShaderResourceView> textureSRV;
-        IFT(DirectX::CreateTextureFromWIC(
-            spD3D11Resources->GetDevice().get(), nullptr,
-            frame.get(), 0,
-            D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, DirectX::WIC_LOADER_DEFAULT,
-            texture.put(), textureSRV.put(),
-            true));
+                m_thumbnailAtlas = atlas;
+            }
 
-        m_pageTexture = texture;
-        m_pageTextureSRV = textureSRV;
+            RaiseThumbnailsReady(*atlas);
+        });
     }
-    else
+    catch (hresult_error const& e)
     {
-        throw_hresult(E_NOT_VALID_STATE);
+        hr = e.code();
+    }
+
+    IFR(hr);
+
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        m_thumbnailsAsync = thumbnails;
     }
+
+    requestId = atlas->requestId;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+uint32_t PdfLoader::GetThumbnails(THUMBNAIL_INFO* thumbnails, uint32_t capacity)
+{
+    if (thumbnails == nullptr)
+    {
+        return 0;
+    }
+
+    std::shared_ptr<ThumbnailAtlas> atlas = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        atlas = m_thumbnailAtlas;
+    }
+
+    if (atlas == nullptr)
+    {
+        return 0;
+    }
+
+    uint32_t count = static_cast<uint32_t>(atlas->thumbnails.size());
+    count = count < capacity ? count : capacity;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        thumbnails[i] = atlas->thumbnails[i];
+    }
+
+    return count;
+}
+
+// words in order, case and punctuation aside, hits on pages not indexed yet aren't found
+_Use_decl_annotations_
+uint32_t PdfLoader::SearchText(std::wstring_view query, TEXT_HIT* hits, uint32_t capacity)
+{
+    com_ptr<TextIndex> textIndex = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        textIndex = m_textIndex;
+    }
+
+    return textIndex != nullptr ? textIndex->Search(query, hits, capacity) : 0;
+}
+
+// takes the slot from an older request, raised at once when it's cached
+_Use_decl_annotations_
+HRESULT PdfLoader::SubmitRequest(PageRequest& request)
+{
+    // the neighbours of the last page are no longer the ones wanted
+    CancelPrefetch();
+
+    uint32_t slot = request.slot;
+
+    IAsyncAction stale = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        request.requestId = ++m_nextRequestId;
+
+        auto current = m_slotRequests.find(slot);
+        if (current != m_slotRequests.end())
+        {
+            auto active = m_activeRenders.find(current->second.requestId);
+            if (active != m_activeRenders.end())
+            {
+                stale = active->second;
+            }
+
+            m_pendingRequests.erase(
+                std::remove_if(m_pendingRequests.begin(), m_pendingRequests.end(), [slot](PageRequest const& pending) { return pending.slot == slot; }),
+                m_pendingRequests.end());
+        }
+
+        m_slotRequests[slot] = request;
+    }
+
+    // its completion sees it's no longer the slot's request
+    if (stale != nullptr)
+    {
+        stale.Cancel();
+    }
+
+    PageTexture cached{};
+    if (FindCachedPage(request, cached))
+    {
+        CompleteRequest(request, cached);
+
+        PrefetchPages();
+
+        return S_OK;
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        m_pendingRequests.push_back(request);
+    }
+
+    DispatchRequests();
+
+    return S_OK;
+}
+
+// internal
+// the part of the file read while it's fetched, parsing takes the rest, Loaded is only reported
+// once the document is open
+IAsyncActionWithProgress<double> PdfLoader::LoadFileAsync(hstring folderName, hstring fileName)
+{
+    auto context = apartment_context();
+
+    auto cancellation = co_await get_cancellation_token();
+
+    // CancelLoad stops the wait on the document right away
+    cancellation.enable_propagation();
+
+    co_await resume_background();
+
+    auto progress = co_await get_progress_token();
+
+    progress(0.0);
+
+    // opened only by the first loader of the document
+    std::wstring key;
+    DocumentOpenStream openStream;
+
+    Uri uri = nullptr;
+    if (HttpFileCache::TryParseWebUri(fileName, uri))
+    {
+        key = uri.AbsoluteUri();
+
+        // from the local copy when the server says it's unchanged
+        openStream = [uri](DocumentLoadProgress const& loadProgress) { return HttpFileCache::OpenAsync(uri, loadProgress); };
+    }
+    else
+    {
+        Windows::Storage::StorageFolder storageFolder = nullptr;
+
+        // a full path is opened as is, an unpackaged process has no local folder to start from
+        if (!folderName.empty() && std::wstring(folderName).find(L":\\") != std::wstring::npos)
+        {
+            storageFolder = co_await Windows::Storage::StorageFolder::GetFolderFromPathAsync(folderName);
+        }
+        else
+        {
+            try
+            {
+                storageFolder = Windows::Storage::ApplicationData::Current().LocalFolder();
+            }
+            catch (...)
+            {
+                storageFolder = Windows::Storage::KnownFolders::DocumentsLibrary();
+            }
+
+            if (!folderName.empty())
+            {
+                storageFolder = co_await storageFolder.GetFolderAsync(folderName);
+            }
+        }
+
+        auto storageFile = co_await storageFolder.GetFileAsync(fileName);
+
+        // paths don't care about case
+        key = storageFile.Path();
+        std::transform(key.begin(), key.end(), key.begin(), towlower);
+
+        // a local file opens at once, there's nothing to report before the parse
+        openStream = [storageFile](DocumentLoadProgress const& loadProgress)
+        {
+            UNREFERENCED_PARAMETER(loadProgress);
+
+            return storageFile.OpenAsync(Windows::Storage::FileAccessMode::Read);
+        };
+    }
+
+    // another loader may have it open already or be loading it
+    auto shared = DocumentCache::Acquire(hstring(key));
+
+    auto load = DocumentCache::LoadAsync(shared, openStream);
+    load.Progress([progress](auto const&, double fetched)
+    {
+        progress(fetched * PDF_LOAD_FETCH_PROGRESS);
+    });
+
+    auto document = co_await load;
+
+    // a newer LoadFile took over
+    if (cancellation())
+    {
+        co_return;
+    }
+
+    m_sharedDocument = shared;
+    m_document = document;
+
+    progress(1.0);
+
+    co_await context;
+
+    co_return;
+}
+
+IAsyncAction PdfLoader::RenderRequestAsync(PageRequest request)
+{
+    // the dispatcher starts several, none of them on the caller's thread
+    co_await resume_background();
+
+    auto rendered = std::make_shared<PageTexture>(PageTexture::ForRequest(request));
+
+    co_await RenderPageAsync(rendered);
+
+    AddCachedPage(*rendered);
+
+    CompleteRequest(request, *rendered);
+}
+
+// the pages either side of the last shown one, wrapping like the sample's page flips
+IAsyncAction PdfLoader::PrefetchPagesAsync(uint32_t pageIndex, uint32_t maxWidth, uint32_t maxHeight, float dpi)
+{
+    auto cancellation = co_await get_cancellation_token();
+
+    co_await resume_background();
+
+    uint32_t pageCount = m_document.PageCount();
+    if (pageCount < 2)
+    {
+        co_return;
+    }
+
+    uint32_t neighbours[] = { (pageIndex + 1) % pageCount, (pageIndex + pageCount - 1) % pageCount };
+    for (auto neighbour : neighbours)
+    {
+        if (cancellation())
+        {
+            co_return;
+        }
+
+        PageRequest request{};
+        request.pageIndex = neighbour;
+        request.region = PageRequest::WholePage();
+        request.maxWidth = maxWidth;
+        request.maxHeight = maxHeight;
+        request.dpi = dpi;
+
+        if (IsPageCached(request))
+        {
+            continue;
+        }
+
+        auto rendered = std::make_shared<PageTexture>(PageTexture::ForRequest(request));
+
+        try
+        {
+            co_await RenderPageAsync(rendered);
+        }
+        catch (hresult_error const&)
+        {
+            // selecting it later reports the failure
+            continue;
+        }
+
+        // the selection moved on while it rendered, the page is still worth keeping
+        AddCachedPage(*rendered);
+    }
+}
+
+// until every visible tile is in the atlas, the view can move while it runs
+IAsyncAction PdfLoader::RenderTilesAsync(com_ptr<TilePyramid> tilePyramid)
+{
+    auto cancellation = co_await get_cancellation_token();
+
+    co_await resume_background();
+
+    PdfPage page = nullptr;
+    uint32_t pageIndex = 0;
+    Rect bounds{};
+
+    TileKey key{};
+    Rect region{};
+    uint32_t width = 0, height = 0;
+    while (!cancellation() && tilePyramid->NextMissingTile(key, region, width, height))
+    {
+        if (page == nullptr || key.pageIndex != pageIndex)
+        {
+            page = m_document.GetPage(key.pageIndex);
+            pageIndex = key.pageIndex;
+            bounds = PageBounds(page);
+
+            co_await page.PreparePageAsync();
+        }
+
+        PLUGIN_TRACE_SCOPE("PdfLoader.RenderTile", PLUGIN_TRACE_KEYWORD_RENDER);
+
+        Rect sourceRect{
+            bounds.X + region.X * bounds.Width,
+            bounds.Y + region.Y * bounds.Height,
+            region.Width * bounds.Width,
+            region.Height * bounds.Height };
+
+        uint32_t slot = 0;
+
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+            com_ptr<ID3D11Texture2D> tileTexture = nullptr;
+            hr = DrawPage(page, sourceRect, width, height, 0, tileTexture);
+            if (SUCCEEDED(hr))
+            {
+                hr = tilePyramid->PlaceTile(m_renderContext.get(), tileTexture.get(), width, height, slot);
+                if (SUCCEEDED(hr))
+                {
+                    // unity samples the atlas on its own device
+                    hr = WaitForRender();
+                    if (FAILED(hr))
+                    {
+                        tilePyramid->ReleaseSlot(slot);
+                    }
+                }
+            }
+        }
+
+        // the view needs more tiles than the atlas holds, what's there is on screen
+        if (hr == HRESULT_FROM_WIN32(ERROR_BUFFER_OVERFLOW))
+        {
+            co_return;
+        }
+
+        IFT(hr);
+
+        if (cancellation())
+        {
+            tilePyramid->ReleaseSlot(slot);
+
+            co_return;
+        }
+
+        if (tilePyramid->CommitTile(key, slot, width, height))
+        {
+            RaiseTilesUpdated(key.pageIndex, tilePyramid.get());
+        }
+    }
+}
+
+IAsyncAction PdfLoader::RenderThumbnailsAsync(std::shared_ptr<ThumbnailAtlas> atlas)
+{
+    auto cancellation = co_await get_cancellation_token();
+
+    co_await resume_background();
+
+    PLUGIN_TRACE_SCOPE("PdfLoader.RenderThumbnails", PLUGIN_TRACE_KEYWORD_RENDER);
+
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    IFT(GetUnityDevice(unityDevice));
+
+    {
+        std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+        // thumbnails are only drawn with direct2d
+        IFT(CreateRenderer(unityDevice.get()));
+
+        auto atlasDesc = CD3D11_TEXTURE2D_DESC(
+            DXGI_FORMAT_B8G8R8A8_UNORM, atlas->width, atlas->height, 1, 1,
+            D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+        atlasDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+
+        IFT(m_renderDevice->CreateTexture2D(&atlasDesc, nullptr, atlas->renderTexture.put()));
+
+        // cells the grid doesn't fill and pages that fail stay transparent
+        com_ptr<ID3D11RenderTargetView> atlasRTV = nullptr;
+        IFT(m_renderDevice->CreateRenderTargetView(atlas->renderTexture.get(), nullptr, atlasRTV.put()));
+
+        float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        m_renderContext->ClearRenderTargetView(atlasRTV.get(), clearColor);
+    }
+
+    atlas->thumbnails.resize(atlas->count);
+
+    for (uint32_t batch = 0; batch < atlas->count; batch += PDF_MAX_CONCURRENT_RENDERS)
+    {
+        if (cancellation())
+        {
+            co_return;
+        }
+
+        uint32_t batchEnd = batch + PDF_MAX_CONCURRENT_RENDERS;
+        batchEnd = batchEnd < atlas->count ? batchEnd : atlas->count;
+
+        // prepared together, drawn one after the other on the one direct2d context
+        std::vector<PdfPage> pages;
+        std::vector<IAsyncAction> prepares;
+        for (uint32_t i = batch; i < batchEnd; ++i)
+        {
+            auto page = m_document.GetPage(atlas->firstPage + i);
+
+            pages.push_back(page);
+            prepares.push_back(page.PreparePageAsync());
+        }
+
+        for (auto& prepare : prepares)
+        {
+            co_await prepare;
+        }
+
+        for (uint32_t i = batch; i < batchEnd; ++i)
+        {
+            auto& page = pages[i - batch];
+            auto& info = atlas->thumbnails[i];
+
+            info.page = atlas->firstPage + i;
+
+            auto bounds = PageBounds(page);
+
+            uint32_t width = 0, height = 0;
+            FitPageSize(Size{ bounds.Width, bounds.Height }, atlas->thumbSize, atlas->thumbSize, 0.0f, width, height);
+
+            uint32_t x = (i % atlas->columns) * atlas->thumbSize;
+            uint32_t y = (i / atlas->columns) * atlas->thumbSize;
+
+            HRESULT hr = S_OK;
+            {
+                std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+                com_ptr<ID3D11Texture2D> thumbnail = nullptr;
+                hr = DrawPage(page, bounds, width, height, 0, thumbnail);
+                if (SUCCEEDED(hr))
+                {
+                    m_renderContext->CopySubresourceRegion(atlas->renderTexture.get(), 0, x, y, 0, thumbnail.get(), 0, nullptr);
+                }
+            }
+
+            // the rest of the document is still worth showing
+            if (FAILED(hr))
+            {
+                continue;
+            }
+
+            info.width = width;
+            info.height = height;
+            info.u = static_cast<float>(x) / atlas->width;
+            info.v = static_cast<float>(y) / atlas->height;
+            info.uvWidth = static_cast<float>(width) / atlas->width;
+            info.uvHeight = static_cast<float>(height) / atlas->height;
+        }
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+        // unity samples the atlas on its own device
+        IFT(WaitForRender());
+    }
+
+    IFT(OpenOnUnityDevice(unityDevice.get(), atlas->renderTexture.get(), atlas->texture, atlas->textureSRV));
+}
+
+// the pdf api has no text layer, each page is rendered off screen once and read with ocr,
+// the words land in the index as each page is done
+IAsyncAction PdfLoader::IndexTextAsync(PdfDocument document, com_ptr<TextIndex> textIndex)
+{
+    auto cancellation = co_await get_cancellation_token();
+
+    co_await resume_background();
+
+    PLUGIN_TRACE_SCOPE("PdfLoader.IndexText", PLUGIN_TRACE_KEYWORD_RENDER);
+
+    // no ocr language installed for the user
+    auto engine = Windows::Media::Ocr::OcrEngine::TryCreateFromUserProfileLanguages();
+    if (engine == nullptr)
+    {
+        throw_hresult(E_NOT_VALID_STATE);
+    }
+
+    uint32_t maxSize = Windows::Media::Ocr::OcrEngine::MaxImageDimension();
+    maxSize = maxSize < PDF_TEXT_INDEX_SIZE ? maxSize : PDF_TEXT_INDEX_SIZE;
+
+    for (uint32_t pageIndex = 0; pageIndex < document.PageCount(); ++pageIndex)
+    {
+        if (cancellation())
+        {
+            co_return;
+        }
+
+        auto page = document.GetPage(pageIndex);
+
+        auto bounds = PageBounds(page);
+
+        uint32_t width = 0, height = 0;
+        FitPageSize(Size{ bounds.Width, bounds.Height }, maxSize, maxSize, 0.0f, width, height);
+
+        // the trim box, hits line up with the page textures
+        InMemoryRandomAccessStream stream;
+        auto renderOptions = PdfPageRenderOptions();
+        renderOptions.SourceRect(bounds);
+        renderOptions.DestinationWidth(width);
+        renderOptions.DestinationHeight(height);
+        co_await page.RenderToStreamAsync(stream, renderOptions);
+
+        auto decoder = co_await Windows::Graphics::Imaging::BitmapDecoder::CreateAsync(stream);
+        auto bitmap = co_await decoder.GetSoftwareBitmapAsync(
+            Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8, Windows::Graphics::Imaging::BitmapAlphaMode::Premultiplied);
+
+        auto result = co_await engine.RecognizeAsync(bitmap);
+
+        std::vector<TextWord> words;
+
+        uint32_t line = 0;
+        for (auto const& ocrLine : result.Lines())
+        {
+            for (auto const& ocrWord : ocrLine.Words())
+            {
+                auto text = TextIndex::Normalize(ocrWord.Text());
+                if (text.empty())
+                {
+                    continue;
+                }
+
+                auto rect = ocrWord.BoundingRect();
+
+                words.push_back(TextWord{ text, Rect{ rect.X / width, rect.Y / height, rect.Width / width, rect.Height / height }, line });
+            }
+
+            ++line;
+        }
+
+        textIndex->AddPage(pageIndex, std::move(words));
+    }
+}
+
+IAsyncAction PdfLoader::RenderPageAsync(std::shared_ptr<PageTexture> rendered)
+{
+    // spans the awaits, ends when the texture is created or the render throws
+    PLUGIN_TRACE_SCOPE("PdfLoader.RenderPage", PLUGIN_TRACE_KEYWORD_RENDER);
+
+    auto page = m_document.GetPage(rendered->pageIndex);
+
+    auto bounds = PageBounds(page);
+
+    // the region asked for, in dips
+    Rect trimbox{
+        bounds.X + rendered->region.X * bounds.Width,
+        bounds.Y + rendered->region.Y * bounds.Height,
+        rendered->region.Width * bounds.Width,
+        rendered->region.Height * bounds.Height };
+
+    FitPageSize(Size{ trimbox.Width, trimbox.Height }, rendered->maxWidth, rendered->maxHeight, rendered->dpi, rendered->width, rendered->height);
+
+    bool compress = false;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        compress = m_compressPages;
+    }
+
+    // bc1 comes in 4 x 4 blocks, the aspect moves by less than a block
+    if (compress)
+    {
+        rendered->width = (rendered->width + 3) & ~3u;
+        rendered->height = (rendered->height + 3) & ~3u;
+    }
+
+    co_await page.PreparePageAsync();
+
+    // rasterized straight into the texture, no png encode and wic decode on the way
+    HRESULT hr = S_OK;
+    if (compress)
+    {
+        auto pixels = AcquirePixelBuffer();
+        {
+            std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+            hr = ReadPage(page, trimbox, rendered->width, rendered->height, pixels);
+        }
+
+        // encoded off the render lock, other pages draw meanwhile
+        if (SUCCEEDED(hr))
+        {
+            hr = CreateCompressedTexture(pixels, *rendered);
+        }
+
+        ReleasePixelBuffer(std::move(pixels));
+    }
+    else
+    {
+        std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+        hr = RenderPageToTexture(page, trimbox, *rendered);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        co_return;
+    }
+
+    // no direct2d on the adapter, the page goes through a png
+    InMemoryRandomAccessStream memStream;
+    auto renderOptions = PdfPageRenderOptions();
+    renderOptions.SourceRect(trimbox);
+    renderOptions.DestinationHeight(rendered->height);
+    renderOptions.DestinationWidth(rendered->width);
+    co_await page.RenderToStreamAsync(memStream, renderOptions);
+
+    // decoded into a pooled buffer, then created from it, another page's render overlaps either
+    auto pixels = AcquirePixelBuffer();
+
+    hr = DecodePageImage(memStream, pixels, rendered->width, rendered->height);
+    if (SUCCEEDED(hr))
+    {
+        hr = UploadPageImage(pixels, *rendered);
+    }
+
+    ReleasePixelBuffer(std::move(pixels));
+
+    IFT(hr);
+}
+
+// starts pending requests oldest first until PDF_MAX_CONCURRENT_RENDERS are running
+void PdfLoader::DispatchRequests()
+{
+    for (;;)
+    {
+        PageRequest request{};
+        {
+            std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+            if (m_pendingRequests.empty() || m_activeRenders.size() >= PDF_MAX_CONCURRENT_RENDERS)
+            {
+                return;
+            }
+
+            request = m_pendingRequests.front();
+            m_pendingRequests.pop_front();
+
+            // holds the place until the render exists
+            m_activeRenders[request.requestId] = nullptr;
+        }
+
+        IAsyncAction render = nullptr;
+
+        try
+        {
+            render = RenderRequestAsync(request);
+        }
+        catch (hresult_error const& e)
+        {
+            {
+                std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+                m_activeRenders.erase(request.requestId);
+            }
+
+            RaiseFailed(e.code());
+
+            continue;
+        }
+
+        {
+            std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+            m_activeRenders[request.requestId] = render;
+        }
+
+        render.Completed([=](auto const& asyncOp, AsyncStatus const& status)
+        {
+            OnRenderCompleted(request, asyncOp, status);
+        });
+    }
+}
+
+_Use_decl_annotations_
+void PdfLoader::OnRenderCompleted(PageRequest const& request, IAsyncAction const& render, AsyncStatus status)
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        m_activeRenders.erase(request.requestId);
+    }
+
+    // a stale request failing is of no interest
+    if (status == AsyncStatus::Error && IsCurrentRequest(request))
+    {
+        RaiseFailed(render.ErrorCode());
+    }
+
+    DispatchRequests();
+
+    PrefetchPages();
+}
+
+// shown on its slot unless a newer request took the slot meanwhile
+_Use_decl_annotations_
+void PdfLoader::CompleteRequest(PageRequest const& request, PageTexture const& page)
+{
+    PdfPage pdfPage = nullptr;
+    bool reuseTexture = false;
+
+    try
+    {
+        pdfPage = m_document.GetPage(request.pageIndex);
+    }
+    catch (hresult_error const&)
+    {
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        auto current = m_slotRequests.find(request.slot);
+        if (current == m_slotRequests.end() || current->second.requestId != request.requestId)
+        {
+            return;
+        }
+
+        m_slotPages[request.slot] = page;
+        m_lastRequest = request;
+
+        m_page = pdfPage;
+
+        reuseTexture = m_reuseTextures;
+    }
+
+    // the cached page keeps its own texture, the slot's shows a copy
+    PageTexture shown = page;
+    if (reuseTexture && FAILED(PresentPage(request.slot, shown)))
+    {
+        shown = page;
+    }
+
+    RaisePageSelected(request, shown);
+}
+
+_Use_decl_annotations_
+bool PdfLoader::IsCurrentRequest(PageRequest const& request)
+{
+    std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+    auto current = m_slotRequests.find(request.slot);
+
+    return current != m_slotRequests.end() && current->second.requestId == request.requestId;
+}
+
+// renders already under way finish, their pages still land in the cache
+void PdfLoader::CancelRequests()
+{
+    std::vector<IAsyncAction> renders;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        for (auto const& active : m_activeRenders)
+        {
+            if (active.second != nullptr)
+            {
+                renders.push_back(active.second);
+            }
+        }
+
+        m_pendingRequests.clear();
+        m_slotRequests.clear();
+        m_lastRequest = PageRequest{};
+    }
+
+    for (auto& render : renders)
+    {
+        render.Cancel();
+    }
+}
+
+_Use_decl_annotations_
+void PdfLoader::RaisePageSelected(PageRequest const& request, PageTexture const& page)
+{
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Pdf;
+
+    ZeroMemory(&state.value.pdfState, sizeof(PDF_STATE));
+    state.value.pdfState.stateType = PdfStateType::Selected;
+
+    state.value.pdfState.page = page.pageIndex;
+    state.value.pdfState.width = static_cast<int32_t>(page.width);
+    state.value.pdfState.height = static_cast<int32_t>(page.height);
+    state.value.pdfState.textureSRV = GetUnityTexture(page.textureSRV.get());
+    state.value.pdfState.requestId = request.requestId;
+    state.value.pdfState.slot = request.slot;
+    state.value.pdfState.format = static_cast<uint32_t>(page.format);
+
+    Callback(state);
+}
+
+_Use_decl_annotations_
+void PdfLoader::RaiseFailed(HRESULT hr)
+{
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Failed;
+
+    ZeroMemory(&state.value.failedState, sizeof(FAILED_STATE));
+
+    state.value.failedState.hresult = hr;
+
+    Callback(state);
+}
+
+// the atlas changed, GetTiles has the view's tiles
+_Use_decl_annotations_
+void PdfLoader::RaiseTilesUpdated(uint32_t pageIndex, TilePyramid* tilePyramid)
+{
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Pdf;
+
+    ZeroMemory(&state.value.pdfState, sizeof(PDF_STATE));
+    state.value.pdfState.stateType = PdfStateType::Tiles;
+
+    state.value.pdfState.page = pageIndex;
+    state.value.pdfState.width = static_cast<int32_t>(tilePyramid->AtlasSize());
+    state.value.pdfState.height = static_cast<int32_t>(tilePyramid->AtlasSize());
+    state.value.pdfState.textureSRV = GetUnityTexture(tilePyramid->AtlasSRV());
+
+    Callback(state);
+}
+
+_Use_decl_annotations_
+void PdfLoader::RaiseThumbnailsReady(ThumbnailAtlas const& atlas)
+{
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Pdf;
+
+    ZeroMemory(&state.value.pdfState, sizeof(PDF_STATE));
+    state.value.pdfState.stateType = PdfStateType::Thumbnails;
+
+    state.value.pdfState.page = atlas.firstPage;
+    state.value.pdfState.width = static_cast<int32_t>(atlas.width);
+    state.value.pdfState.height = static_cast<int32_t>(atlas.height);
+    state.value.pdfState.textureSRV = GetUnityTexture(atlas.textureSRV.get());
+    state.value.pdfState.requestId = atlas.requestId;
+
+    Callback(state);
+}
+
+_Use_decl_annotations_
+void PdfLoader::RaiseTextIndexed(uint32_t pageCount)
+{
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Pdf;
+
+    ZeroMemory(&state.value.pdfState, sizeof(PDF_STATE));
+    state.value.pdfState.stateType = PdfStateType::TextIndexed;
+
+    state.value.pdfState.page = pageCount;
+
+    Callback(state);
+}
+
+// the neighbours of the last shown page, once nothing asked for is left to render
+void PdfLoader::PrefetchPages()
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_cacheMutex);
+
+        // nowhere to keep them
+        if (m_cacheBudgetBytes == 0)
+        {
+            return;
+        }
+    }
+
+    PageRequest request{};
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        if (m_lastRequest.requestId == 0 || !m_pendingRequests.empty() || !m_activeRenders.empty())
+        {
+            return;
+        }
+
+        request = m_lastRequest;
+    }
+
+    IAsyncAction prefetch = nullptr;
+
+    try
+    {
+        prefetch = PrefetchPagesAsync(request.pageIndex, request.maxWidth, request.maxHeight, request.dpi);
+    }
+    catch (hresult_error const&)
+    {
+        return;
+    }
+
+    IAsyncAction previous = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        previous = m_prefetchAsync;
+        m_prefetchAsync = prefetch;
+    }
+
+    if (previous != nullptr)
+    {
+        previous.Cancel();
+    }
+}
+
+// a render already under way finishes, its page still lands in the cache
+void PdfLoader::CancelPrefetch()
+{
+    IAsyncAction prefetch = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        prefetch = m_prefetchAsync;
+        m_prefetchAsync = nullptr;
+    }
+
+    if (prefetch != nullptr)
+    {
+        prefetch.Cancel();
+    }
+}
+
+// SearchText finds what's indexed as soon as each page is, TextIndexed says all of them are
+void PdfLoader::StartTextIndex()
+{
+    CancelTextIndex();
+
+    auto document = m_document;
+    if (document == nullptr)
+    {
+        return;
+    }
+
+    auto textIndex = make_self<TextIndex>();
+
+    IAsyncAction indexing = nullptr;
+
+    try
+    {
+        indexing = IndexTextAsync(document, textIndex);
+
+        // text search is extra, a document without it still shows
+        indexing.Completed([=](auto const& asyncOp, AsyncStatus const& status)
+        {
+            UNREFERENCED_PARAMETER(asyncOp);
+
+            if (status == AsyncStatus::Completed)
+            {
+                RaiseTextIndexed(textIndex->IndexedPages());
+            }
+        });
+    }
+    catch (hresult_error const&)
+    {
+        return;
+    }
+
+    std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+    m_textIndex = textIndex;
+    m_textIndexAsync = indexing;
+}
+
+// the index is dropped with it, search finds nothing until the next document is read
+void PdfLoader::CancelTextIndex()
+{
+    IAsyncAction indexing = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        indexing = m_textIndexAsync;
+        m_textIndexAsync = nullptr;
+        m_textIndex = nullptr;
+    }
+
+    if (indexing != nullptr)
+    {
+        indexing.Cancel();
+    }
+}
+
+void PdfLoader::CancelThumbnails()
+{
+    IAsyncAction thumbnails = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        thumbnails = m_thumbnailsAsync;
+        m_thumbnailsAsync = nullptr;
+    }
+
+    if (thumbnails != nullptr)
+    {
+        thumbnails.Cancel();
+    }
+}
+
+// the atlas is emptied, released on shutdown, a tile already drawing still lands in it
+_Use_decl_annotations_
+void PdfLoader::CancelTiles(bool release)
+{
+    IAsyncAction tiles = nullptr;
+    com_ptr<TilePyramid> tilePyramid = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_requestMutex);
+
+        tiles = m_tilesAsync;
+        m_tilesAsync = nullptr;
+
+        tilePyramid = m_tilePyramid;
+        if (release)
+        {
+            m_tilePyramid = nullptr;
+        }
+    }
+
+    if (tiles != nullptr)
+    {
+        tiles.Cancel();
+    }
+
+    if (tilePyramid != nullptr)
+    {
+        tilePyramid->Clear();
+    }
+}
+
+_Use_decl_annotations_
+bool PdfLoader::FindCachedPage(PageRequest const& request, PageTexture& page)
+{
+    std::lock_guard<slim_mutex> guard(m_cacheMutex);
+
+    for (auto it = m_pageCache.begin(); it != m_pageCache.end(); ++it)
+    {
+        if (it->Matches(request))
+        {
+            // most recently used
+            m_pageCache.splice(m_pageCache.begin(), m_pageCache, it);
+
+            page = m_pageCache.front();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// leaves the order alone, a prefetch doesn't make a page recently used
+_Use_decl_annotations_
+bool PdfLoader::IsPageCached(PageRequest const& request)
+{
+    std::lock_guard<slim_mutex> guard(m_cacheMutex);
+
+    for (auto const& cached : m_pageCache)
+    {
+        if (cached.Matches(request))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+_Use_decl_annotations_
+void PdfLoader::AddCachedPage(PageTexture const& page)
+{
+    // rendered for a device that was reset while it drew
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    com_ptr<ID3D11Device> pageDevice = nullptr;
+    if (page.texture != nullptr)
+    {
+        page.texture->GetDevice(pageDevice.put());
+    }
+
+    if (FAILED(GetUnityDevice(unityDevice)) || pageDevice != unityDevice)
+    {
+        return;
+    }
+
+    auto key = page.Key();
+    {
+        std::lock_guard<slim_mutex> guard(m_cacheMutex);
+
+        m_pageCache.remove_if([&](PageTexture const& cached)
+        {
+            return cached.Matches(key);
+        });
+
+        m_pageCache.push_front(page);
+    }
+
+    TrimPageCache();
+}
+
+// least recently used out first, the pages shown on a slot live on in m_slotPages
+void PdfLoader::TrimPageCache()
+{
+    std::lock_guard<slim_mutex> guard(m_cacheMutex);
+
+    uint64_t bytes = 0;
+    for (auto const& cached : m_pageCache)
+    {
+        bytes += cached.Bytes();
+    }
+
+    while (m_pageCache.size() > 1 && bytes > m_cacheBudgetBytes)
+    {
+        bytes -= m_pageCache.back().Bytes();
+
+        m_pageCache.pop_back();
+    }
+}
+
+void PdfLoader::ClearPageCache()
+{
+    std::lock_guard<slim_mutex> guard(m_cacheMutex);
+
+    m_pageCache.clear();
+}
+
+// the page scaled by the dpi, or to the max size without one, and shrunk to fit the max size
+// and the largest texture d3d11 creates, aspect kept
+_Use_decl_annotations_
+void PdfLoader::FitPageSize(
+    Size const& pageSize,
+    uint32_t maxWidth,
+    uint32_t maxHeight,
+    float dpi,
+    uint32_t& width,
+    uint32_t& height)
+{
+    float pageWidth = pageSize.Width > 1.0f ? pageSize.Width : 1.0f;
+    float pageHeight = pageSize.Height > 1.0f ? pageSize.Height : 1.0f;
+
+    float boundWidth = static_cast<float>(maxWidth > 0 && maxWidth < D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION ? maxWidth : D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+    float boundHeight = static_cast<float>(maxHeight > 0 && maxHeight < D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION ? maxHeight : D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+
+    float scale = dpi > 0.0f ? dpi / PDF_PAGE_DPI : FLT_MAX;
+
+    float fitWidth = boundWidth / pageWidth;
+    float fitHeight = boundHeight / pageHeight;
+    float fit = fitWidth < fitHeight ? fitWidth : fitHeight;
+
+    scale = scale < fit ? scale : fit;
+
+    width = static_cast<uint32_t>(pageWidth * scale + 0.5f);
+    height = static_cast<uint32_t>(pageHeight * scale + 0.5f);
+
+    width = width > 0 ? width : 1;
+    height = height > 0 ? height : 1;
+}
+
+// the visible part of the page in dips, the whole page when there's no trim box
+_Use_decl_annotations_
+Rect PdfLoader::PageBounds(PdfPage const& page)
+{
+    auto trimbox = page.Dimensions().TrimBox();
+    if (trimbox.Width <= 0.0f || trimbox.Height <= 0.0f)
+    {
+        auto size = page.Size();
+        trimbox = Rect{ 0.0f, 0.0f, size.Width, size.Height };
+    }
+
+    return trimbox;
+}
+
+_Use_decl_annotations_
+HRESULT PdfLoader::GetUnityDevice(com_ptr<ID3D11Device>& unityDevice)
+{
+    unityDevice = nullptr;
+
+    auto resources = m_deviceResources.lock();
+    NULL_CHK_HR(resources, E_NOT_VALID_STATE);
+
+    auto d3d11Resources = std::dynamic_pointer_cast<ID3D11DeviceResource>(resources);
+    NULL_CHK_HR(d3d11Resources, E_NOINTERFACE);
+
+    unityDevice = d3d11Resources->GetDevice();
+    NULL_CHK_HR(unityDevice, E_NOT_VALID_STATE);
+
+    return S_OK;
+}
+
+// unity's device isn't created with bgra support and its immediate context belongs to the
+// render thread, direct2d gets a device of its own on the same adapter
+_Use_decl_annotations_
+HRESULT PdfLoader::CreateRenderer(ID3D11Device* unityDevice)
+{
+    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+
+    if (m_pdfRenderer != nullptr)
+    {
+        return S_OK;
+    }
+
+    com_ptr<IDXGIDevice> unityDxgiDevice = nullptr;
+    IFR(unityDevice->QueryInterface(__uuidof(IDXGIDevice), unityDxgiDevice.put_void()));
+
+    com_ptr<IDXGIAdapter> adapter = nullptr;
+    IFR(unityDxgiDevice->GetAdapter(adapter.put()));
+
+    D3D_FEATURE_LEVEL featureLevel = unityDevice->GetFeatureLevel();
+
+    com_ptr<ID3D11Device> device = nullptr;
+    com_ptr<ID3D11DeviceContext> context = nullptr;
+    IFR(D3D11CreateDevice(
+        adapter.get(), D3D_DRIVER_TYPE_UNKNOWN, nullptr,
+        D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+        &featureLevel, 1,
+        D3D11_SDK_VERSION,
+        device.put(), nullptr, context.put()));
+
+    auto dxgiDevice = device.try_as<IDXGIDevice>();
+    NULL_CHK_HR(dxgiDevice, E_NOINTERFACE);
+
+    com_ptr<ID2D1Device> d2dDevice = nullptr;
+    IFR(D2D1CreateDevice(dxgiDevice.get(), nullptr, d2dDevice.put()));
+
+    com_ptr<ID2D1DeviceContext> d2dContext = nullptr;
+    IFR(d2dDevice->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, d2dContext.put()));
+
+    // a pixel per dip, the destination size is in pixels
+    d2dContext->SetDpi(96.0f, 96.0f);
+
+    com_ptr<IPdfRendererNative> pdfRenderer = nullptr;
+    IFR(PdfCreateRenderer(dxgiDevice.get(), pdfRenderer.put()));
+
+    m_renderDevice = device;
+    m_renderContext = context;
+    m_d2dDevice = d2dDevice;
+    m_d2dContext = d2dContext;
+    m_pdfRenderer = pdfRenderer;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PdfLoader::RenderPageToTexture(PdfPage const& page, Rect const& sourceRect, PageTexture& rendered)
+{
+    NULL_CHK_HR(page, E_INVALIDARG);
+
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    IFR(GetUnityDevice(unityDevice));
+
+    IFR(CreateRenderer(unityDevice.get()));
+
+    com_ptr<ID3D11Texture2D> renderTexture = nullptr;
+    IFR(DrawPage(page, sourceRect, rendered.width, rendered.height, D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE, renderTexture));
+
+    // unity samples the texture on its own device
+    IFR(WaitForRender());
+
+    com_ptr<ID3D11Texture2D> texture = nullptr;
+    com_ptr<ID3D11ShaderResourceView> textureSRV = nullptr;
+    IFR(OpenOnUnityDevice(unityDevice.get(), renderTexture.get(), texture, textureSRV));
+
+    rendered.renderTexture = renderTexture;
+    rendered.texture = nullptr;
+    rendered.texture.copy_from(texture.get());
+    rendered.textureSRV = textureSRV;
+
+    return S_OK;
+}
+
+// render lock held, the page drawn and copied to memory as rows of width * 4 bytes
+_Use_decl_annotations_
+HRESULT PdfLoader::ReadPage(PdfPage const& page, Rect const& sourceRect, uint32_t width, uint32_t height, std::vector<uint8_t>& pixels)
+{
+    pixels.clear();
+
+    NULL_CHK_HR(page, E_INVALIDARG);
+
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    IFR(GetUnityDevice(unityDevice));
+
+    IFR(CreateRenderer(unityDevice.get()));
+
+    com_ptr<ID3D11Texture2D> renderTexture = nullptr;
+    IFR(DrawPage(page, sourceRect, width, height, 0, renderTexture));
+
+    auto stagingDesc = CD3D11_TEXTURE2D_DESC(
+        DXGI_FORMAT_B8G8R8A8_UNORM, width, height, 1, 1,
+        0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+
+    com_ptr<ID3D11Texture2D> stagingTexture = nullptr;
+    IFR(m_renderDevice->CreateTexture2D(&stagingDesc, nullptr, stagingTexture.put()));
+
+    m_renderContext->CopyResource(stagingTexture.get(), renderTexture.get());
+
+    // waits for the draw and the copy
+    D3D11_MAPPED_SUBRESOURCE mapped{};
+    IFR(m_renderContext->Map(stagingTexture.get(), 0, D3D11_MAP_READ, 0, &mapped));
+
+    uint32_t rowBytes = width * 4;
+    pixels.resize(static_cast<size_t>(rowBytes) * height);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        memcpy_s(pixels.data() + static_cast<size_t>(y) * rowBytes, rowBytes, static_cast<uint8_t const*>(mapped.pData) + static_cast<size_t>(y) * mapped.RowPitch, rowBytes);
+    }
+
+    m_renderContext->Unmap(stagingTexture.get(), 0);
+
+    return S_OK;
+}
+
+// created with its data on unity's device, which is free threaded, its context isn't touched
+_Use_decl_annotations_
+HRESULT PdfLoader::CreateCompressedTexture(std::vector<uint8_t> const& pixels, PageTexture& rendered)
+{
+    PLUGIN_TRACE_SCOPE("PdfLoader.CompressPage", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    std::vector<uint8_t> blocks;
+    IFR(CompressBC1(pixels.data(), rendered.width * 4, rendered.width, rendered.height, blocks));
+
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    IFR(GetUnityDevice(unityDevice));
+
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(
+        DXGI_FORMAT_BC1_UNORM, rendered.width, rendered.height, 1, 1,
+        D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+    // shared textures can't be immutable
+    textureDesc.MiscFlags = GetUnityTextureMiscFlags();
+    if (textureDesc.MiscFlags != 0)
+    {
+        textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    }
+
+    D3D11_SUBRESOURCE_DATA initialData{};
+    initialData.pSysMem = blocks.data();
+    initialData.SysMemPitch = (rendered.width / 4) * BC1_BLOCK_BYTES;
+
+    com_ptr<ID3D11Texture2D> texture = nullptr;
+    IFR(unityDevice->CreateTexture2D(&textureDesc, &initialData, texture.put()));
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC1_UNORM);
+
+    com_ptr<ID3D11ShaderResourceView> textureSRV = nullptr;
+    IFR(unityDevice->CreateShaderResourceView(texture.get(), &srvDesc, textureSRV.put()));
+
+    rendered.format = DXGI_FORMAT_BC1_UNORM;
+    rendered.renderTexture = nullptr;
+    rendered.texture = nullptr;
+    rendered.texture.copy_from(texture.get());
+    rendered.textureSRV = textureSRV;
+
+    return S_OK;
+}
+
+// a buffer a previous page was decoded into, its allocation kept
+std::vector<uint8_t> PdfLoader::AcquirePixelBuffer()
+{
+    std::lock_guard<slim_mutex> guard(m_pixelBufferMutex);
+
+    if (m_pixelBuffers.empty())
+    {
+        return std::vector<uint8_t>();
+    }
+
+    auto pixels = std::move(m_pixelBuffers.back());
+    m_pixelBuffers.pop_back();
+
+    return pixels;
+}
+
+// kept up to PDF_MAX_POOLED_PIXEL_BUFFERS, the rest are freed
+_Use_decl_annotations_
+void PdfLoader::ReleasePixelBuffer(std::vector<uint8_t>&& pixels)
+{
+    std::lock_guard<slim_mutex> guard(m_pixelBufferMutex);
+
+    if (m_pixelBuffers.size() < PDF_MAX_POOLED_PIXEL_BUFFERS)
+    {
+        m_pixelBuffers.push_back(std::move(pixels));
+    }
+}
+
+// the png RenderToStreamAsync wrote as premultiplied bgra rows of width * 4 bytes, the buffer
+// only grows
+_Use_decl_annotations_
+HRESULT PdfLoader::DecodePageImage(IRandomAccessStream const& imageStream, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height)
+{
+    PLUGIN_TRACE_SCOPE("PdfLoader.DecodePage", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    com_ptr<IStream> spStream = nullptr;
+    IFR(CreateStreamOverRandomAccessStream(winrt::get_unknown(imageStream), __uuidof(IStream), spStream.put_void()));
+
+    auto pWIC = DirectX::_GetWIC();
+    NULL_CHK_HR(pWIC, E_NOINTERFACE);
+
+    com_ptr<IWICStream> stream;
+    IFR(pWIC->CreateStream(stream.put()));
+
+    IFR(stream->InitializeFromIStream(spStream.get()));
+
+    com_ptr<IWICBitmapDecoder> decoder;
+    IFR(pWIC->CreateDecoderFromStream(stream.get(), 0, WICDecodeMetadataCacheOnDemand, decoder.put()));
+
+    com_ptr<IWICBitmapFrameDecode> frame;
+    IFR(decoder->GetFrame(0, frame.put()));
+
+    UINT frameWidth = 0, frameHeight = 0;
+    IFR(frame->GetSize(&frameWidth, &frameHeight));
+
+    WICPixelFormatGUID pixelFormat{};
+    IFR(frame->GetPixelFormat(&pixelFormat));
+
+    size_t rowBytes = static_cast<size_t>(frameWidth) * 4;
+    size_t imageBytes = rowBytes * frameHeight;
+    if (pixels.size() < imageBytes)
+    {
+        pixels.resize(imageBytes);
+    }
+
+    // the page png is bgra already, 24 and 32 bit bgr and rgb are swizzled by the loader's kernels,
+    // anything else goes through a converter
+    if (pixelFormat == GUID_WICPixelFormat32bppPBGRA || pixelFormat == GUID_WICPixelFormat32bppBGRA)
+    {
+        IFR(frame->CopyPixels(nullptr, static_cast<UINT>(rowBytes), static_cast<UINT>(imageBytes), pixels.data()));
+    }
+    else
+    {
+        HRESULT hr = DirectX::_CopyPixelsFast(frame.get(), pixelFormat, GUID_WICPixelFormat32bppBGRA, frameWidth, frameHeight, frameWidth, frameHeight, false, rowBytes, imageBytes, pixels.data());
+        IFR(hr);
+
+        if (hr == S_FALSE)
+        {
+            com_ptr<IWICFormatConverter> converter = nullptr;
+            IFR(pWIC->CreateFormatConverter(converter.put()));
+
+            IFR(converter->Initialize(frame.get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeMedianCut));
+
+            IFR(converter->CopyPixels(nullptr, static_cast<UINT>(rowBytes), static_cast<UINT>(imageBytes), pixels.data()));
+        }
+    }
+
+    width = frameWidth;
+    height = frameHeight;
+
+    return S_OK;
+}
+
+// created with its data on unity's device, free threaded, no context involved
+_Use_decl_annotations_
+HRESULT PdfLoader::UploadPageImage(std::vector<uint8_t> const& pixels, PageTexture& rendered)
+{
+    PLUGIN_TRACE_SCOPE("PdfLoader.UploadPage", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    IFR(GetUnityDevice(unityDevice));
+
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(
+        DXGI_FORMAT_B8G8R8A8_UNORM, rendered.width, rendered.height, 1, 1,
+        D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+    // shared textures can't be immutable
+    textureDesc.MiscFlags = GetUnityTextureMiscFlags();
+    if (textureDesc.MiscFlags != 0)
+    {
+        textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    }
+
+    D3D11_SUBRESOURCE_DATA initialData{};
+    initialData.pSysMem = pixels.data();
+    initialData.SysMemPitch = rendered.width * 4;
+
+    com_ptr<ID3D11Texture2D> texture = nullptr;
+    IFR(unityDevice->CreateTexture2D(&textureDesc, &initialData, texture.put()));
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_B8G8R8A8_UNORM);
+
+    com_ptr<ID3D11ShaderResourceView> textureSRV = nullptr;
+    IFR(unityDevice->CreateShaderResourceView(texture.get(), &srvDesc, textureSRV.put()));
+
+    rendered.format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    rendered.renderTexture = nullptr;
+    rendered.texture = nullptr;
+    rendered.texture.copy_from(texture.get());
+    rendered.textureSRV = textureSRV;
+
+    return S_OK;
+}
+
+// a shared texture of the render device as unity's device sees it, nt handles so that on d3d12 it
+// can be shared on with unity's device
+_Use_decl_annotations_
+HRESULT PdfLoader::OpenOnUnityDevice(ID3D11Device* unityDevice, ID3D11Texture2D* renderTexture, com_ptr<ID3D11Texture2D>& texture, com_ptr<ID3D11ShaderResourceView>& textureSRV)
+{
+    texture = nullptr;
+    textureSRV = nullptr;
+
+    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+    NULL_CHK_HR(renderTexture, E_INVALIDARG);
+
+    com_ptr<IDXGIResource1> dxgiResource = nullptr;
+    IFR(renderTexture->QueryInterface(__uuidof(IDXGIResource1), dxgiResource.put_void()));
+
+    com_ptr<ID3D11Device1> unityDevice1 = nullptr;
+    IFR(unityDevice->QueryInterface(__uuidof(ID3D11Device1), unityDevice1.put_void()));
+
+    HANDLE sharedHandle = nullptr;
+    IFR(dxgiResource->CreateSharedHandle(nullptr, DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE, nullptr, &sharedHandle));
+
+    HRESULT hr = unityDevice1->OpenSharedResource1(sharedHandle, __uuidof(ID3D11Texture2D), texture.put_void());
+
+    CloseHandle(sharedHandle);
+
+    IFR(hr);
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_B8G8R8A8_UNORM);
+    IFR(unityDevice->CreateShaderResourceView(texture.get(), &srvDesc, textureSRV.put()));
+
+    return S_OK;
+}
+
+// the page copied into the slot's texture, kept while pages of the same size follow so the
+// shader resource view unity wraps stays the same, wic and compressed pages keep their own
+_Use_decl_annotations_
+HRESULT PdfLoader::PresentPage(uint32_t slot, PageTexture& page)
+{
+    NULL_CHK_HR(page.renderTexture, E_NOT_VALID_STATE);
+
+    com_ptr<ID3D11Device> unityDevice = nullptr;
+    IFR(GetUnityDevice(unityDevice));
+
+    std::lock_guard<slim_mutex> guard(m_renderMutex);
+
+    NULL_CHK_HR(m_renderContext, E_NOT_VALID_STATE);
+
+    auto& slotTexture = m_slotTextures[slot];
+    if (slotTexture.renderTexture == nullptr || slotTexture.width != page.width || slotTexture.height != page.height)
+    {
+        PresentTexture created{};
+        created.width = page.width;
+        created.height = page.height;
+
+        auto textureDesc = CD3D11_TEXTURE2D_DESC(
+            DXGI_FORMAT_B8G8R8A8_UNORM, page.width, page.height, 1, 1,
+            D3D11_BIND_SHADER_RESOURCE);
+        textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+
+        IFR(m_renderDevice->CreateTexture2D(&textureDesc, nullptr, created.renderTexture.put()));
+        IFR(OpenOnUnityDevice(unityDevice.get(), created.renderTexture.get(), created.texture, created.textureSRV));
+
+        slotTexture = created;
+    }
+
+    // same size and format, a copy on the gpu
+    m_renderContext->CopyResource(slotTexture.renderTexture.get(), page.renderTexture.get());
+
+    IFR(WaitForRender());
+
+    page.texture = nullptr;
+    page.texture.copy_from(slotTexture.texture.get());
+    page.textureSRV = slotTexture.textureSRV;
+
+    return S_OK;
+}
+
+// render lock held, source rect in dips
+_Use_decl_annotations_
+HRESULT PdfLoader::DrawPage(PdfPage const& page, Rect const& sourceRect, uint32_t width, uint32_t height, UINT miscFlags, com_ptr<ID3D11Texture2D>& texture)
+{
+    texture = nullptr;
+
+    NULL_CHK_HR(m_d2dContext, E_NOT_VALID_STATE);
+
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(
+        DXGI_FORMAT_B8G8R8A8_UNORM, width, height, 1, 1,
+        D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+    textureDesc.MiscFlags = miscFlags;
+
+    com_ptr<ID3D11Texture2D> renderTexture = nullptr;
+    IFR(m_renderDevice->CreateTexture2D(&textureDesc, nullptr, renderTexture.put()));
+
+    auto surface = renderTexture.try_as<IDXGISurface>();
+    NULL_CHK_HR(surface, E_NOINTERFACE);
+
+    auto bitmapProperties = D2D1::BitmapProperties1(
+        D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+
+    com_ptr<ID2D1Bitmap1> targetBitmap = nullptr;
+    IFR(m_d2dContext->CreateBitmapFromDxgiSurface(surface.get(), &bitmapProperties, targetBitmap.put()));
+
+    PLUGIN_TRACE_SCOPE("PdfLoader.DrawPage", PLUGIN_TRACE_KEYWORD_RENDER);
+
+    // white background, same as RenderToStreamAsync
+    auto renderParams = PdfRenderParams(
+        D2D1::RectF(sourceRect.X, sourceRect.Y, sourceRect.X + sourceRect.Width, sourceRect.Y + sourceRect.Height),
+        width, height);
+
+    m_d2dContext->SetTarget(targetBitmap.get());
+    m_d2dContext->BeginDraw();
+
+    HRESULT hr = m_pdfRenderer->RenderPageToDeviceContext(get_unknown(page), m_d2dContext.get(), &renderParams);
+    HRESULT hrEnd = m_d2dContext->EndDraw();
+
+    m_d2dContext->SetTarget(nullptr);
+
+    IFR(hr);
+    IFR(hrEnd);
+
+    texture = renderTexture;
+
+    return S_OK;
+}
+
+// render lock held, everything drawn so far is done on the gpu, waiting is fine on the
+// background thread
+HRESULT PdfLoader::WaitForRender()
+{
+    NULL_CHK_HR(m_renderContext, E_NOT_VALID_STATE);
+
+    D3D11_QUERY_DESC queryDesc{ D3D11_QUERY_EVENT, 0 };
+
+    com_ptr<ID3D11Query> query = nullptr;
+    IFR(m_renderDevice->CreateQuery(&queryDesc, query.put()));
+
+    m_renderContext->End(query.get());
+    m_renderContext->Flush();
+
+    BOOL done = FALSE;
+    HRESULT hr = S_FALSE;
+    while ((hr = m_renderContext->GetData(query.get(), &done, sizeof(done), 0)) == S_FALSE)
+    {
+        SwitchToThread();
+    }
+
+    return hr;
 }
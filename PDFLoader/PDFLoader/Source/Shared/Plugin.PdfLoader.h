@@ -5,9 +5,148 @@
 
 #include "Plugin/PdfLoader.g.h"
 #include "Plugin.Module.h"
+#include "TilePyramid.h"
+#include "DocumentCache.h"
+#include "TextIndex.h"
+
+#include <d2d1_1.h>
+#include <windows.data.pdf.interop.h>
+
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+// the box a page is fit into when no size is asked for
+#define PDF_PAGE_RENDER_SIZE 2048
+
+// page dimensions are in dips
+#define PDF_PAGE_DPI 96.0f
+
+// video memory the rendered pages are kept in until SetPageCacheBudget says otherwise
+#define PDF_PAGE_CACHE_DEFAULT_MB 64
+
+// page renders running at once, later requests wait for one to finish
+#define PDF_MAX_CONCURRENT_RENDERS 3
+
+// decode buffers kept for the next page, one per render that can run at once
+#define PDF_MAX_POOLED_PIXEL_BUFFERS PDF_MAX_CONCURRENT_RENDERS
+
+// share of the load progress given to reading the file, parsing it is the rest
+#define PDF_LOAD_FETCH_PROGRESS 0.9
+
+// the box pages are fit into to read their text, about 240 dpi for a letter page
+#define PDF_TEXT_INDEX_SIZE 2048
+
+// largest thumbnail cell asked of RenderThumbnails
+#define PDF_THUMBNAIL_MAX_SIZE 1024
 
 namespace winrt::PDFLoader::Plugin::implementation
 {
+    // a page asked for on a slot, a newer request on the same slot makes it stale, the region
+    // is in normalized trim box coordinates
+    struct PageRequest
+    {
+        uint32_t requestId;
+        uint32_t slot;
+        uint32_t pageIndex;
+        Windows::Foundation::Rect region;
+        uint32_t maxWidth;
+        uint32_t maxHeight;
+        float dpi;
+
+        static Windows::Foundation::Rect WholePage() { return Windows::Foundation::Rect{ 0.0f, 0.0f, 1.0f, 1.0f }; }
+    };
+
+    // a rendered page or region and the size it was asked for
+    struct PageTexture
+    {
+        uint32_t pageIndex;
+        Windows::Foundation::Rect region;
+        uint32_t maxWidth;
+        uint32_t maxHeight;
+        float dpi;
+
+        uint32_t width;
+        uint32_t height;
+        DXGI_FORMAT format;
+        com_ptr<ID3D11Resource> texture;
+        com_ptr<ID3D11ShaderResourceView> textureSRV;
+
+        // the direct2d side of the shared texture, null on the wic path and for compressed pages
+        com_ptr<ID3D11Texture2D> renderTexture;
+
+        bool Matches(PageRequest const& request) const
+        {
+            return pageIndex == request.pageIndex
+                && region.X == request.region.X && region.Y == request.region.Y
+                && region.Width == request.region.Width && region.Height == request.region.Height
+                && maxWidth == request.maxWidth && maxHeight == request.maxHeight && dpi == request.dpi;
+        }
+
+        PageRequest Key() const
+        {
+            PageRequest key{};
+            key.pageIndex = pageIndex;
+            key.region = region;
+            key.maxWidth = maxWidth;
+            key.maxHeight = maxHeight;
+            key.dpi = dpi;
+
+            return key;
+        }
+
+        static PageTexture ForRequest(PageRequest const& request)
+        {
+            PageTexture page{};
+            page.pageIndex = request.pageIndex;
+            page.region = request.region;
+            page.maxWidth = request.maxWidth;
+            page.maxHeight = request.maxHeight;
+            page.dpi = request.dpi;
+            page.format = DXGI_FORMAT_B8G8R8A8_UNORM;
+
+            return page;
+        }
+
+        // bc1 is half a byte a pixel
+        uint64_t Bytes() const
+        {
+            uint64_t pixels = static_cast<uint64_t>(width) * height;
+
+            return format == DXGI_FORMAT_BC1_UNORM ? pixels / 2 : pixels * 4;
+        }
+    };
+
+    // what a slot shows when textures are reused, pages of its size are copied in
+    struct PresentTexture
+    {
+        uint32_t width;
+        uint32_t height;
+
+        com_ptr<ID3D11Texture2D> renderTexture;
+        com_ptr<ID3D11Texture2D> texture;
+        com_ptr<ID3D11ShaderResourceView> textureSRV;
+    };
+
+    // a document's thumbnails in a grid of square cells, one texture for the lot
+    struct ThumbnailAtlas
+    {
+        uint32_t requestId;
+        uint32_t firstPage;
+        uint32_t count;
+        uint32_t thumbSize;
+        uint32_t columns;
+        uint32_t width;
+        uint32_t height;
+
+        com_ptr<ID3D11Texture2D> renderTexture;
+        com_ptr<ID3D11Texture2D> texture;
+        com_ptr<ID3D11ShaderResourceView> textureSRV;
+        std::vector<THUMBNAIL_INFO> thumbnails;
+    };
+
     struct PdfLoader : PdfLoaderT<PdfLoader, PDFLoader::Plugin::implementation::Module>
     {
         static IModule Create(
@@ -20,24 +159,197 @@ namespace winrt::PDFLoader::Plugin::implementation
         virtual void Shutdown();
 
         HRESULT LoadFile(hstring const& folderName, hstring const& fileName);
+        HRESULT CancelLoad();
         HRESULT SelectPage(uint32_t pageIndex);
+        HRESULT SelectPageAtSize(uint32_t pageIndex, uint32_t maxWidth, uint32_t maxHeight, float dpi);
+        HRESULT SetPageCacheBudget(uint32_t megabytes);
+        HRESULT SetTextureReuse(bool enabled);
+        HRESULT SetPageCompression(bool enabled);
+        HRESULT RequestPage(uint32_t slot, uint32_t pageIndex, uint32_t maxWidth, uint32_t maxHeight, float dpi, uint32_t& requestId);
+        HRESULT RequestRegion(uint32_t slot, uint32_t pageIndex, Windows::Foundation::Rect const& region, uint32_t width, uint32_t height, uint32_t& requestId);
+        HRESULT SetTileView(uint32_t pageIndex, Windows::Foundation::Rect const& view, uint32_t viewPixels);
+        HRESULT RenderThumbnails(uint32_t firstPage, uint32_t count, uint32_t thumbSize, uint32_t& requestId);
+
+        // the tile view's tiles in the atlas, not projected, the dll calls it on the implementation
+        uint32_t GetTiles(
+            _Out_writes_to_(capacity, return) TILE_INFO* tiles,
+            _In_ uint32_t capacity);
+
+        // the last finished RenderThumbnails, not projected either
+        uint32_t GetThumbnails(
+            _Out_writes_to_(capacity, return) THUMBNAIL_INFO* thumbnails,
+            _In_ uint32_t capacity);
+
+        // the pages indexed so far, not projected either
+        uint32_t SearchText(
+            _In_ std::wstring_view query,
+            _Out_writes_to_(capacity, return) TEXT_HIT* hits,
+            _In_ uint32_t capacity);
 
         Windows::Data::Pdf::PdfDocument Document() { return m_document; }
         Windows::Data::Pdf::PdfPage Page() { return m_page; }
         uint32_t PageCount() { return (m_document != nullptr) ? m_document.PageCount() : 0; }
 
+    protected:
+        virtual void OnDeviceResetStarted() override;
+        virtual void OnDeviceResetCompleted() override;
+
     private:
+        fire_and_forget RestoreDeviceContentAsync();
+
         Windows::Foundation::IAsyncActionWithProgress<double> LoadFileAsync(hstring folderName, hstring fileName);
-        Windows::Foundation::IAsyncAction SelectPageAsync(uint32_t pageIndex);
+        Windows::Foundation::IAsyncAction RenderRequestAsync(PageRequest request);
+        Windows::Foundation::IAsyncAction PrefetchPagesAsync(uint32_t pageIndex, uint32_t maxWidth, uint32_t maxHeight, float dpi);
+        Windows::Foundation::IAsyncAction RenderPageAsync(std::shared_ptr<PageTexture> rendered);
+        Windows::Foundation::IAsyncAction RenderTilesAsync(com_ptr<TilePyramid> tilePyramid);
+        Windows::Foundation::IAsyncAction RenderThumbnailsAsync(std::shared_ptr<ThumbnailAtlas> atlas);
+        Windows::Foundation::IAsyncAction IndexTextAsync(Windows::Data::Pdf::PdfDocument document, com_ptr<TextIndex> textIndex);
+
+        HRESULT SubmitRequest(_Inout_ PageRequest& request);
+
+        void DispatchRequests();
+        void OnRenderCompleted(_In_ PageRequest const& request, _In_ Windows::Foundation::IAsyncAction const& render, _In_ Windows::Foundation::AsyncStatus status);
+        void CompleteRequest(_In_ PageRequest const& request, _In_ PageTexture const& page);
+        bool IsCurrentRequest(_In_ PageRequest const& request);
+        void CancelRequests();
+
+        void RaisePageSelected(_In_ PageRequest const& request, _In_ PageTexture const& page);
+        void RaiseFailed(_In_ HRESULT hr);
+        void RaiseTilesUpdated(_In_ uint32_t pageIndex, _In_ TilePyramid* tilePyramid);
+        void RaiseThumbnailsReady(_In_ ThumbnailAtlas const& atlas);
+        void RaiseTextIndexed(_In_ uint32_t pageCount);
+        void PrefetchPages();
+        void CancelPrefetch();
+        void CancelTiles(_In_ bool release);
+        void CancelThumbnails();
+        void StartTextIndex();
+        void CancelTextIndex();
+
+        bool FindCachedPage(_In_ PageRequest const& request, _Out_ PageTexture& page);
+        bool IsPageCached(_In_ PageRequest const& request);
+        void AddCachedPage(_In_ PageTexture const& page);
+        void TrimPageCache();
+        void ClearPageCache();
+
+        static void FitPageSize(
+            _In_ Windows::Foundation::Size const& pageSize,
+            _In_ uint32_t maxWidth,
+            _In_ uint32_t maxHeight,
+            _In_ float dpi,
+            _Out_ uint32_t& width,
+            _Out_ uint32_t& height);
+
+        static Windows::Foundation::Rect PageBounds(
+            _In_ Windows::Data::Pdf::PdfPage const& page);
+
+        HRESULT GetUnityDevice(_Out_ com_ptr<ID3D11Device>& unityDevice);
+        HRESULT CreateRenderer(_In_ ID3D11Device* unityDevice);
+        HRESULT RenderPageToTexture(
+            _In_ Windows::Data::Pdf::PdfPage const& page,
+            _In_ Windows::Foundation::Rect const& sourceRect,
+            _Inout_ PageTexture& rendered);
+        HRESULT DrawPage(
+            _In_ Windows::Data::Pdf::PdfPage const& page,
+            _In_ Windows::Foundation::Rect const& sourceRect,
+            _In_ uint32_t width,
+            _In_ uint32_t height,
+            _In_ UINT miscFlags,
+            _Out_ com_ptr<ID3D11Texture2D>& texture);
+        HRESULT WaitForRender();
+        HRESULT OpenOnUnityDevice(
+            _In_ ID3D11Device* unityDevice,
+            _In_ ID3D11Texture2D* renderTexture,
+            _Out_ com_ptr<ID3D11Texture2D>& texture,
+            _Out_ com_ptr<ID3D11ShaderResourceView>& textureSRV);
+        HRESULT PresentPage(
+            _In_ uint32_t slot,
+            _Inout_ PageTexture& page);
+        HRESULT ReadPage(
+            _In_ Windows::Data::Pdf::PdfPage const& page,
+            _In_ Windows::Foundation::Rect const& sourceRect,
+            _In_ uint32_t width,
+            _In_ uint32_t height,
+            _Out_ std::vector<uint8_t>& pixels);
+        HRESULT CreateCompressedTexture(
+            _In_ std::vector<uint8_t> const& pixels,
+            _Inout_ PageTexture& rendered);
+        std::vector<uint8_t> AcquirePixelBuffer();
+        void ReleasePixelBuffer(
+            _In_ std::vector<uint8_t>&& pixels);
+        static HRESULT DecodePageImage(
+            _In_ Windows::Storage::Streams::IRandomAccessStream const& imageStream,
+            _Inout_ std::vector<uint8_t>& pixels,
+            _Out_ uint32_t& width,
+            _Out_ uint32_t& height);
+        HRESULT UploadPageImage(
+            _In_ std::vector<uint8_t> const& pixels,
+            _Inout_ PageTexture& rendered);
 
     private:
         Windows::Foundation::IAsyncActionWithProgress<double> m_loadDataAsyncOp;
-        Windows::Foundation::IAsyncAction m_selectPageAsync;
 
+        // shared with the other loaders that have the same document open
+        std::shared_ptr<SharedDocument> m_sharedDocument;
         Windows::Data::Pdf::PdfDocument m_document;
         Windows::Data::Pdf::PdfPage m_page;
-        com_ptr<ID3D11Resource> m_pageTexture;
-        com_ptr<ID3D11ShaderResourceView> m_pageTextureSRV;
+
+        // the newest request per slot wins, the rest wait for a free render
+        slim_mutex m_requestMutex;
+        uint32_t m_nextRequestId;
+        std::map<uint32_t, PageRequest> m_slotRequests;
+        std::map<uint32_t, PageTexture> m_slotPages;
+        std::deque<PageRequest> m_pendingRequests;
+        std::map<uint32_t, Windows::Foundation::IAsyncAction> m_activeRenders;
+        PageRequest m_lastRequest;
+        Windows::Foundation::IAsyncAction m_prefetchAsync;
+
+        // one tile renders at a time, always the missing one nearest the view's center
+        com_ptr<TilePyramid> m_tilePyramid;
+        Windows::Foundation::IAsyncAction m_tilesAsync;
+        uint32_t m_tileViewPage;
+        Windows::Foundation::Rect m_tileView;
+        uint32_t m_tileViewPixels;
+
+        // a new RenderThumbnails cancels the running one, the last finished atlas stays
+        std::shared_ptr<ThumbnailAtlas> m_thumbnailAtlas;
+        std::shared_ptr<ThumbnailAtlas> m_thumbnailRequest;
+        Windows::Foundation::IAsyncAction m_thumbnailsAsync;
+
+        // what was asked for when unity's device went away, asked for again once it's back, the
+        // document, its text index and the requests made since are left alone
+        std::vector<PageRequest> m_resetRequests;
+        std::shared_ptr<ThumbnailAtlas> m_resetThumbnails;
+        uint32_t m_resetTileViewPixels;
+
+        // a new index for every document, read page by page once it's open
+        com_ptr<TextIndex> m_textIndex;
+        Windows::Foundation::IAsyncAction m_textIndexAsync;
+
+        // most recently used first, the newest page is kept even when it's over the budget,
+        // the pages shown on a slot live on in m_slotPages after they're evicted
+        slim_mutex m_cacheMutex;
+        std::list<PageTexture> m_pageCache;
+        uint64_t m_cacheBudgetBytes;
+
+        // direct2d on its own device on unity's adapter, pages are drawn into a texture unity opens,
+        // selection and prefetch take turns on it
+        slim_mutex m_renderMutex;
+        com_ptr<ID3D11Device> m_renderDevice;
+        com_ptr<ID3D11DeviceContext> m_renderContext;
+        com_ptr<ID2D1Device> m_d2dDevice;
+        com_ptr<ID2D1DeviceContext> m_d2dContext;
+        com_ptr<IPdfRendererNative> m_pdfRenderer;
+
+        // one per slot, replaced when the page size changes, under the render lock
+        bool m_reuseTextures;
+        std::map<uint32_t, PresentTexture> m_slotTextures;
+
+        // pages read back and stored as bc1, under the request lock
+        bool m_compressPages;
+
+        // cpu copies of pages on their way to a texture, reused across renders
+        slim_mutex m_pixelBufferMutex;
+        std::vector<std::vector<uint8_t>> m_pixelBuffers;
     };
 }
 
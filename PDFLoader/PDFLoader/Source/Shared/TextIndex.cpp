@@ -0,0 +1,195 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "TextIndex.h"
+
+#include <algorithm>
+#include <cwctype>
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+
+TextIndex::TextIndex()
+    : m_pages()
+    , m_postings()
+{
+}
+
+TextIndex::~TextIndex()
+{
+    Clear();
+}
+
+_Use_decl_annotations_
+std::wstring TextIndex::Normalize(
+    std::wstring_view word)
+{
+    size_t first = 0;
+    size_t last = word.size();
+
+    while (first < last && !std::iswalnum(word[first]))
+    {
+        ++first;
+    }
+
+    while (last > first && !std::iswalnum(word[last - 1]))
+    {
+        --last;
+    }
+
+    std::wstring normalized(word.substr(first, last - first));
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), towlower);
+
+    return normalized;
+}
+
+// a page read again replaces what it had
+_Use_decl_annotations_
+void TextIndex::AddPage(
+    uint32_t pageIndex,
+    std::vector<TextWord>&& words)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    if (m_pages.find(pageIndex) != m_pages.end())
+    {
+        for (auto& postings : m_postings)
+        {
+            postings.second.erase(
+                std::remove_if(postings.second.begin(), postings.second.end(), [pageIndex](Posting const& posting) { return posting.pageIndex == pageIndex; }),
+                postings.second.end());
+        }
+    }
+
+    for (uint32_t i = 0; i < words.size(); ++i)
+    {
+        m_postings[words[i].text].push_back(Posting{ pageIndex, i });
+    }
+
+    m_pages[pageIndex] = std::move(words);
+}
+
+uint32_t TextIndex::IndexedPages()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    return static_cast<uint32_t>(m_pages.size());
+}
+
+_Use_decl_annotations_
+uint32_t TextIndex::Search(
+    std::wstring_view query,
+    TEXT_HIT* hits,
+    uint32_t capacity)
+{
+    if (hits == nullptr || capacity == 0)
+    {
+        return 0;
+    }
+
+    std::vector<std::wstring> terms;
+    for (size_t start = 0; start < query.size() && terms.size() < PDF_TEXT_MAX_QUERY_WORDS;)
+    {
+        size_t end = query.find_first_of(L" \t\r\n", start);
+        end = end == std::wstring_view::npos ? query.size() : end;
+
+        auto term = Normalize(query.substr(start, end - start));
+        if (!term.empty())
+        {
+            terms.push_back(term);
+        }
+
+        start = end + 1;
+    }
+
+    if (terms.empty())
+    {
+        return 0;
+    }
+
+    std::vector<TEXT_HIT> found;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        auto postings = m_postings.find(terms[0]);
+        if (postings == m_postings.end())
+        {
+            return 0;
+        }
+
+        // the rest of the query follows the first word on the same page
+        for (auto const& posting : postings->second)
+        {
+            auto const& words = m_pages[posting.pageIndex];
+
+            uint32_t count = static_cast<uint32_t>(terms.size());
+            if (posting.word + count > words.size())
+            {
+                continue;
+            }
+
+            bool match = true;
+            for (uint32_t t = 1; t < count && match; ++t)
+            {
+                match = words[posting.word + t].text == terms[t];
+            }
+
+            if (match)
+            {
+                AddHits(words, posting.pageIndex, posting.word, count, found);
+            }
+        }
+    }
+
+    std::stable_sort(found.begin(), found.end(), [](TEXT_HIT const& a, TEXT_HIT const& b) { return a.page < b.page; });
+
+    uint32_t count = static_cast<uint32_t>(found.size());
+    count = count < capacity ? count : capacity;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        hits[i] = found[i];
+    }
+
+    return count;
+}
+
+void TextIndex::Clear()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_pages.clear();
+    m_postings.clear();
+}
+
+// the match's words joined into one rect per line
+_Use_decl_annotations_
+void TextIndex::AddHits(
+    std::vector<TextWord> const& words,
+    uint32_t pageIndex,
+    uint32_t first,
+    uint32_t count,
+    std::vector<TEXT_HIT>& hits)
+{
+    for (uint32_t i = first; i < first + count;)
+    {
+        auto rect = words[i].rect;
+        float right = rect.X + rect.Width;
+        float bottom = rect.Y + rect.Height;
+
+        uint32_t line = words[i].line;
+        for (++i; i < first + count && words[i].line == line; ++i)
+        {
+            auto const& next = words[i].rect;
+
+            rect.X = next.X < rect.X ? next.X : rect.X;
+            rect.Y = next.Y < rect.Y ? next.Y : rect.Y;
+            right = next.X + next.Width > right ? next.X + next.Width : right;
+            bottom = next.Y + next.Height > bottom ? next.Y + next.Height : bottom;
+        }
+
+        hits.push_back(TEXT_HIT{ pageIndex, rect.X, rect.Y, right - rect.X, bottom - rect.Y });
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// most words a query matches in a row
+#define PDF_TEXT_MAX_QUERY_WORDS 16
+
+// a word on a page, lower case without the punctuation around it, rect normalized to the page
+struct TextWord
+{
+    std::wstring text;
+    winrt::Windows::Foundation::Rect rect;
+    uint32_t line;
+};
+
+// the words of each indexed page and where every word occurs, pages are added as they're read,
+// searching covers what's indexed so far, thread safe
+struct TextIndex : winrt::implements<TextIndex, winrt::Windows::Foundation::IInspectable>
+{
+    TextIndex();
+    virtual ~TextIndex();
+
+    // lower case, punctuation trimmed, empty when nothing is left
+    static std::wstring Normalize(
+        _In_ std::wstring_view word);
+
+    void AddPage(
+        _In_ uint32_t pageIndex,
+        _In_ std::vector<TextWord>&& words);
+
+    uint32_t IndexedPages();
+
+    // the words of the query in order, case and punctuation aside, returns how many hits were
+    // written, pages in order
+    uint32_t Search(
+        _In_ std::wstring_view query,
+        _Out_writes_to_(capacity, return) TEXT_HIT* hits,
+        _In_ uint32_t capacity);
+
+    void Clear();
+
+private:
+    struct Posting
+    {
+        uint32_t pageIndex;
+        uint32_t word;
+    };
+
+    void AddHits(
+        _In_ std::vector<TextWord> const& words,
+        _In_ uint32_t pageIndex,
+        _In_ uint32_t first,
+        _In_ uint32_t count,
+        _Inout_ std::vector<TEXT_HIT>& hits);
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    std::unordered_map<uint32_t, std::vector<TextWord>> m_pages;
+    std::unordered_map<std::wstring, std::vector<Posting>> m_postings;
+};
@@ -0,0 +1,388 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "TilePyramid.h"
+
+#include <d3d11_1.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+
+#define PDF_TILES_PER_ROW (PDF_TILE_ATLAS_SIZE / PDF_TILE_SIZE)
+
+_Use_decl_annotations_
+HRESULT TilePyramid::Create(
+    ID3D11Device* renderDevice,
+    ID3D11Device* unityDevice,
+    com_ptr<TilePyramid>& tilePyramid)
+{
+    tilePyramid = nullptr;
+
+    NULL_CHK_HR(renderDevice, E_INVALIDARG);
+    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+
+    auto pyramid = make_self<TilePyramid>();
+
+    auto atlasDesc = CD3D11_TEXTURE2D_DESC(
+        DXGI_FORMAT_B8G8R8A8_UNORM, PDF_TILE_ATLAS_SIZE, PDF_TILE_ATLAS_SIZE, 1, 1,
+        D3D11_BIND_SHADER_RESOURCE);
+    atlasDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+
+    IFR(renderDevice->CreateTexture2D(&atlasDesc, nullptr, pyramid->m_renderAtlas.put()));
+
+    // nt handles, on d3d12 the atlas is shared on with unity's device
+    com_ptr<IDXGIResource1> dxgiResource = nullptr;
+    IFR(pyramid->m_renderAtlas->QueryInterface(__uuidof(IDXGIResource1), dxgiResource.put_void()));
+
+    com_ptr<ID3D11Device1> unityDevice1 = nullptr;
+    IFR(unityDevice->QueryInterface(__uuidof(ID3D11Device1), unityDevice1.put_void()));
+
+    HANDLE sharedHandle = nullptr;
+    IFR(dxgiResource->CreateSharedHandle(nullptr, DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE, nullptr, &sharedHandle));
+
+    HRESULT hr = unityDevice1->OpenSharedResource1(sharedHandle, __uuidof(ID3D11Texture2D), pyramid->m_atlas.put_void());
+
+    CloseHandle(sharedHandle);
+
+    IFR(hr);
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(pyramid->m_atlas.get(), D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_B8G8R8A8_UNORM);
+    IFR(unityDevice->CreateShaderResourceView(pyramid->m_atlas.get(), &srvDesc, pyramid->m_atlasSRV.put()));
+
+    // handed out from the top left
+    for (uint32_t slot = PDF_TILES_PER_ROW * PDF_TILES_PER_ROW; slot > 0; --slot)
+    {
+        pyramid->m_freeSlots.push_back(slot - 1);
+    }
+
+    tilePyramid = pyramid;
+
+    return S_OK;
+}
+
+TilePyramid::TilePyramid()
+    : m_renderAtlas(nullptr)
+    , m_atlas(nullptr)
+    , m_atlasSRV(nullptr)
+    , m_tiles()
+    , m_freeSlots()
+    , m_pageIndex(0)
+    , m_level(0)
+    , m_pageWidth(0)
+    , m_pageHeight(0)
+    , m_visible()
+    , m_viewCount(0)
+{
+}
+
+TilePyramid::~TilePyramid()
+{
+    m_tiles.clear();
+
+    m_atlasSRV = nullptr;
+    m_atlas = nullptr;
+    m_renderAtlas = nullptr;
+}
+
+_Use_decl_annotations_
+void TilePyramid::SetView(
+    uint32_t pageIndex,
+    Size const& pageSize,
+    Rect const& view,
+    uint32_t viewPixels)
+{
+    float pageWidth = pageSize.Width > 1.0f ? pageSize.Width : 1.0f;
+    float pageHeight = pageSize.Height > 1.0f ? pageSize.Height : 1.0f;
+    float longSide = pageWidth > pageHeight ? pageWidth : pageHeight;
+
+    // the shallowest level with as many page pixels across the view as it takes on screen
+    float wanted = static_cast<float>(viewPixels) / view.Width;
+
+    uint32_t level = 0;
+    uint32_t levelWidth = 0, levelHeight = 0;
+    for (; level <= PDF_TILE_MAX_LEVEL; ++level)
+    {
+        float scale = static_cast<float>(PDF_TILE_SIZE << level) / longSide;
+
+        levelWidth = static_cast<uint32_t>(std::ceil(pageWidth * scale));
+        levelHeight = static_cast<uint32_t>(std::ceil(pageHeight * scale));
+
+        if (static_cast<float>(levelWidth) >= wanted || level == PDF_TILE_MAX_LEVEL)
+        {
+            break;
+        }
+    }
+
+    uint32_t columns = (levelWidth + PDF_TILE_SIZE - 1) / PDF_TILE_SIZE;
+    uint32_t rows = (levelHeight + PDF_TILE_SIZE - 1) / PDF_TILE_SIZE;
+
+    float left = view.X * levelWidth / PDF_TILE_SIZE;
+    float top = view.Y * levelHeight / PDF_TILE_SIZE;
+    float right = (view.X + view.Width) * levelWidth / PDF_TILE_SIZE;
+    float bottom = (view.Y + view.Height) * levelHeight / PDF_TILE_SIZE;
+
+    uint32_t firstColumn = static_cast<uint32_t>(left > 0.0f ? left : 0.0f);
+    uint32_t firstRow = static_cast<uint32_t>(top > 0.0f ? top : 0.0f);
+    uint32_t lastColumn = static_cast<uint32_t>(std::ceil(right));
+    uint32_t lastRow = static_cast<uint32_t>(std::ceil(bottom));
+    lastColumn = lastColumn < columns ? lastColumn : columns;
+    lastRow = lastRow < rows ? lastRow : rows;
+
+    float centerColumn = (left + right) / 2.0f;
+    float centerRow = (top + bottom) / 2.0f;
+
+    std::vector<TileKey> visible;
+    for (uint32_t row = firstRow; row < lastRow; ++row)
+    {
+        for (uint32_t column = firstColumn; column < lastColumn; ++column)
+        {
+            visible.push_back(TileKey{ pageIndex, level, column, row });
+        }
+    }
+
+    std::sort(visible.begin(), visible.end(), [=](TileKey const& a, TileKey const& b)
+    {
+        float ax = a.column + 0.5f - centerColumn, ay = a.row + 0.5f - centerRow;
+        float bx = b.column + 0.5f - centerColumn, by = b.row + 0.5f - centerRow;
+
+        return (ax * ax + ay * ay) < (bx * bx + by * by);
+    });
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_pageIndex = pageIndex;
+    m_level = level;
+    m_pageWidth = levelWidth;
+    m_pageHeight = levelHeight;
+    m_visible = std::move(visible);
+
+    ++m_viewCount;
+    for (auto const& key : m_visible)
+    {
+        auto tile = FindTile(key);
+        if (tile != nullptr)
+        {
+            tile->lastSeen = m_viewCount;
+        }
+    }
+}
+
+_Use_decl_annotations_
+bool TilePyramid::NextMissingTile(
+    TileKey& key,
+    Rect& region,
+    uint32_t& width,
+    uint32_t& height)
+{
+    key = TileKey{};
+    region = Rect{};
+    width = 0;
+    height = 0;
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    for (auto const& visible : m_visible)
+    {
+        if (FindTile(visible) != nullptr)
+        {
+            continue;
+        }
+
+        uint32_t x = visible.column * PDF_TILE_SIZE;
+        uint32_t y = visible.row * PDF_TILE_SIZE;
+
+        // the last column and row stop at the page's edge
+        width = m_pageWidth - x < PDF_TILE_SIZE ? m_pageWidth - x : PDF_TILE_SIZE;
+        height = m_pageHeight - y < PDF_TILE_SIZE ? m_pageHeight - y : PDF_TILE_SIZE;
+
+        region.X = static_cast<float>(x) / m_pageWidth;
+        region.Y = static_cast<float>(y) / m_pageHeight;
+        region.Width = static_cast<float>(width) / m_pageWidth;
+        region.Height = static_cast<float>(height) / m_pageHeight;
+
+        key = visible;
+
+        return true;
+    }
+
+    return false;
+}
+
+_Use_decl_annotations_
+HRESULT TilePyramid::PlaceTile(
+    ID3D11DeviceContext* renderContext,
+    ID3D11Texture2D* tileTexture,
+    uint32_t width,
+    uint32_t height,
+    uint32_t& slot)
+{
+    slot = 0;
+
+    NULL_CHK_HR(renderContext, E_INVALIDARG);
+    NULL_CHK_HR(tileTexture, E_INVALIDARG);
+
+    if (width < 1 || height < 1 || width > PDF_TILE_SIZE || height > PDF_TILE_SIZE)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        // every tile in the atlas is on screen
+        if (!AcquireSlot(slot))
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_BUFFER_OVERFLOW));
+        }
+    }
+
+    D3D11_BOX box{ 0, 0, 0, width, height, 1 };
+
+    renderContext->CopySubresourceRegion(
+        m_renderAtlas.get(), 0,
+        (slot % PDF_TILES_PER_ROW) * PDF_TILE_SIZE, (slot / PDF_TILES_PER_ROW) * PDF_TILE_SIZE, 0,
+        tileTexture, 0, &box);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+bool TilePyramid::CommitTile(
+    TileKey const& key,
+    uint32_t slot,
+    uint32_t width,
+    uint32_t height)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    if (std::find(m_visible.begin(), m_visible.end(), key) == m_visible.end())
+    {
+        m_freeSlots.push_back(slot);
+
+        return false;
+    }
+
+    m_tiles.push_back(Tile{ key, slot, width, height, m_viewCount });
+
+    return true;
+}
+
+_Use_decl_annotations_
+void TilePyramid::ReleaseSlot(
+    uint32_t slot)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_freeSlots.push_back(slot);
+}
+
+_Use_decl_annotations_
+uint32_t TilePyramid::GetTiles(
+    TILE_INFO* tiles,
+    uint32_t capacity)
+{
+    if (tiles == nullptr)
+    {
+        return 0;
+    }
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    uint32_t count = 0;
+    for (auto const& key : m_visible)
+    {
+        if (count == capacity)
+        {
+            break;
+        }
+
+        auto tile = FindTile(key);
+        if (tile == nullptr)
+        {
+            continue;
+        }
+
+        auto& info = tiles[count++];
+        info.level = key.level;
+        info.column = key.column;
+        info.row = key.row;
+        info.pageX = static_cast<float>(key.column * PDF_TILE_SIZE) / m_pageWidth;
+        info.pageY = static_cast<float>(key.row * PDF_TILE_SIZE) / m_pageHeight;
+        info.pageWidth = static_cast<float>(tile->width) / m_pageWidth;
+        info.pageHeight = static_cast<float>(tile->height) / m_pageHeight;
+        info.u = static_cast<float>((tile->slot % PDF_TILES_PER_ROW) * PDF_TILE_SIZE) / PDF_TILE_ATLAS_SIZE;
+        info.v = static_cast<float>((tile->slot / PDF_TILES_PER_ROW) * PDF_TILE_SIZE) / PDF_TILE_ATLAS_SIZE;
+        info.uvWidth = static_cast<float>(tile->width) / PDF_TILE_ATLAS_SIZE;
+        info.uvHeight = static_cast<float>(tile->height) / PDF_TILE_ATLAS_SIZE;
+    }
+
+    return count;
+}
+
+void TilePyramid::Clear()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    for (auto const& tile : m_tiles)
+    {
+        m_freeSlots.push_back(tile.slot);
+    }
+
+    m_tiles.clear();
+    m_visible.clear();
+}
+
+// lock held
+_Use_decl_annotations_
+TilePyramid::Tile* TilePyramid::FindTile(
+    TileKey const& key)
+{
+    for (auto& tile : m_tiles)
+    {
+        if (tile.key == key)
+        {
+            return &tile;
+        }
+    }
+
+    return nullptr;
+}
+
+// lock held, a free slot or the one of the offscreen tile seen longest ago
+_Use_decl_annotations_
+bool TilePyramid::AcquireSlot(
+    uint32_t& slot)
+{
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+
+        return true;
+    }
+
+    auto stalest = m_tiles.end();
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it)
+    {
+        if (it->lastSeen < m_viewCount && (stalest == m_tiles.end() || it->lastSeen < stalest->lastSeen))
+        {
+            stalest = it;
+        }
+    }
+
+    if (stalest == m_tiles.end())
+    {
+        return false;
+    }
+
+    slot = stalest->slot;
+
+    m_tiles.erase(stalest);
+
+    return true;
+}
@@ -0,0 +1,118 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <vector>
+
+// pixels on each side of a tile
+#define PDF_TILE_SIZE 256
+
+// pixels on each side of the atlas, 16 x 16 tiles
+#define PDF_TILE_ATLAS_SIZE 4096
+
+// level n puts PDF_TILE_SIZE << n pixels on the page's long side, 6 is 16384
+#define PDF_TILE_MAX_LEVEL 6
+
+struct TileKey
+{
+    uint32_t pageIndex;
+    uint32_t level;
+    uint32_t column;
+    uint32_t row;
+
+    bool operator==(TileKey const& other) const
+    {
+        return pageIndex == other.pageIndex && level == other.level && column == other.column && row == other.row;
+    }
+};
+
+// the tiles of a page view at the level its on-screen size needs, kept in one atlas texture,
+// the offscreen tile seen longest ago makes room for a new one, thread safe
+struct TilePyramid : winrt::implements<TilePyramid, winrt::Windows::Foundation::IInspectable>
+{
+    // the atlas lives on the render device and is opened on unity's
+    static HRESULT Create(
+        _In_ ID3D11Device* renderDevice,
+        _In_ ID3D11Device* unityDevice,
+        _Out_ winrt::com_ptr<TilePyramid>& tilePyramid);
+
+    TilePyramid();
+    virtual ~TilePyramid();
+
+    ID3D11ShaderResourceView* AtlasSRV() const { return m_atlasSRV.get(); }
+    uint32_t AtlasSize() const { return PDF_TILE_ATLAS_SIZE; }
+
+    // view in normalized page coordinates, page size in dips, view pixels is how wide it's shown
+    void SetView(
+        _In_ uint32_t pageIndex,
+        _In_ winrt::Windows::Foundation::Size const& pageSize,
+        _In_ winrt::Windows::Foundation::Rect const& view,
+        _In_ uint32_t viewPixels);
+
+    // the visible tile nearest the view's center not in the atlas yet, region in normalized
+    // page coordinates
+    bool NextMissingTile(
+        _Out_ TileKey& key,
+        _Out_ winrt::Windows::Foundation::Rect& region,
+        _Out_ uint32_t& width,
+        _Out_ uint32_t& height);
+
+    // copies a rendered tile into a free slot on the render device's context, only returned by
+    // GetTiles once committed, a tile the view moved away from meanwhile gives its slot back
+    HRESULT PlaceTile(
+        _In_ ID3D11DeviceContext* renderContext,
+        _In_ ID3D11Texture2D* tileTexture,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _Out_ uint32_t& slot);
+    bool CommitTile(
+        _In_ TileKey const& key,
+        _In_ uint32_t slot,
+        _In_ uint32_t width,
+        _In_ uint32_t height);
+    void ReleaseSlot(
+        _In_ uint32_t slot);
+
+    // the view's tiles in the atlas, returns how many were written
+    uint32_t GetTiles(
+        _Out_writes_to_(capacity, return) TILE_INFO* tiles,
+        _In_ uint32_t capacity);
+
+    void Clear();
+
+private:
+    struct Tile
+    {
+        TileKey key;
+        uint32_t slot;
+        uint32_t width;
+        uint32_t height;
+        uint64_t lastSeen;
+    };
+
+    Tile* FindTile(
+        _In_ TileKey const& key);
+    bool AcquireSlot(
+        _Out_ uint32_t& slot);
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    winrt::com_ptr<ID3D11Texture2D> m_renderAtlas;
+    winrt::com_ptr<ID3D11Texture2D> m_atlas;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_atlasSRV;
+
+    std::vector<Tile> m_tiles;
+    std::vector<uint32_t> m_freeSlots;
+
+    // the view, visible tiles nearest the center first
+    uint32_t m_pageIndex;
+    uint32_t m_level;
+    uint32_t m_pageWidth;
+    uint32_t m_pageHeight;
+    std::vector<TileKey> m_visible;
+    uint64_t m_viewCount;
+};
@@ -31,6 +31,19 @@
 #include "pch.h"
 #include "WICTextureLoader.h"
 
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#define WIC_LOADER_NEON
+#elif defined(_M_ARM)
+#include <arm_neon.h>
+#define WIC_LOADER_NEON
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#define WIC_LOADER_SSE
+#endif
+
 using namespace DirectX;
 using namespace winrt;
 
@@ -252,8 +265,330 @@ namespace
         return bpp;
     }
 
+    //---------------------------------------------------------------------------------
+    // Pixel conversion kernels for the common 24bpp and 32bpp cases, everything else goes
+    // through IWICFormatConverter and IWICBitmapScaler
+    //---------------------------------------------------------------------------------
+#if defined(WIC_LOADER_SSE)
+    bool _HasSSSE3()
+    {
+        static const bool s_ssse3 = []()
+        {
+            int info[4] = {};
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+        }();
+
+        return s_ssse3;
+    }
+#endif
+
+    // 3 bytes per source pixel to 4, channels 0 and 2 swapped when swapRB, alpha opaque
+    void _ConvertRow24To32(_In_reads_bytes_(count * 3) const uint8_t* src, _Out_writes_bytes_(count * 4) uint8_t* dst, size_t count, bool swapRB)
+    {
+        size_t i = 0;
+
+#if defined(WIC_LOADER_NEON)
+        for (; i + 16 <= count; i += 16)
+        {
+            uint8x16x3_t bgr = vld3q_u8(src + i * 3);
+
+            uint8x16x4_t bgra;
+            bgra.val[0] = swapRB ? bgr.val[2] : bgr.val[0];
+            bgra.val[1] = bgr.val[1];
+            bgra.val[2] = swapRB ? bgr.val[0] : bgr.val[2];
+            bgra.val[3] = vdupq_n_u8(0xFF);
+
+            vst4q_u8(dst + i * 4, bgra);
+        }
+#elif defined(WIC_LOADER_SSE)
+        if (_HasSSSE3())
+        {
+            const __m128i shuffle = swapRB
+                ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+            // each load reads 16 bytes for 4 pixels, the last ones are left to the tail
+            for (; i + 6 <= count; i += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+                v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), v);
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            const uint8_t* s = src + i * 3;
+            uint8_t* d = dst + i * 4;
+
+            d[0] = swapRB ? s[2] : s[0];
+            d[1] = s[1];
+            d[2] = swapRB ? s[0] : s[2];
+            d[3] = 0xFF;
+        }
+    }
+
+    // 4 bytes per pixel, channels 0 and 2 swapped when swapRB, alpha set opaque when fillAlpha
+    void _ConvertRow32(_In_reads_bytes_(count * 4) const uint8_t* src, _Out_writes_bytes_(count * 4) uint8_t* dst, size_t count, bool swapRB, bool fillAlpha)
+    {
+        size_t i = 0;
+
+#if defined(WIC_LOADER_NEON)
+        for (; i + 16 <= count; i += 16)
+        {
+            uint8x16x4_t v = vld4q_u8(src + i * 4);
+            if (swapRB)
+            {
+                uint8x16_t t = v.val[0];
+                v.val[0] = v.val[2];
+                v.val[2] = t;
+            }
+            if (fillAlpha)
+            {
+                v.val[3] = vdupq_n_u8(0xFF);
+            }
+
+            vst4q_u8(dst + i * 4, v);
+        }
+#elif defined(WIC_LOADER_SSE)
+        const __m128i maskGA = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+        const __m128i maskR = _mm_set1_epi32(0x000000FF);
+        const __m128i alpha = _mm_set1_epi32(fillAlpha ? static_cast<int>(0xFF000000) : 0);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            if (swapRB)
+            {
+                v = _mm_or_si128(
+                    _mm_and_si128(v, maskGA),
+                    _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), maskR), _mm_slli_epi32(_mm_and_si128(v, maskR), 16)));
+            }
+            v = _mm_or_si128(v, alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), v);
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            const uint8_t* s = src + i * 4;
+            uint8_t* d = dst + i * 4;
+
+            uint8_t r = s[0];
+            d[0] = swapRB ? s[2] : r;
+            d[1] = s[1];
+            d[2] = swapRB ? r : s[2];
+            d[3] = fillAlpha ? 0xFF : s[3];
+        }
+    }
+
+    // each 32bpp output pixel the rounded average of a 2x2 block of the two rows
+    void _BoxDownscaleRow32(_In_ const uint8_t* row0, _In_ const uint8_t* row1, _Out_writes_bytes_(count * 4) uint8_t* dst, size_t count)
+    {
+        size_t i = 0;
+
+#if defined(WIC_LOADER_NEON)
+        for (; i + 4 <= count; i += 4)
+        {
+            // even and odd source pixels apart
+            uint32x4x2_t a = vld2q_u32(reinterpret_cast<const uint32_t*>(row0 + i * 8));
+            uint32x4x2_t b = vld2q_u32(reinterpret_cast<const uint32_t*>(row1 + i * 8));
+
+            uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]);
+            uint8x16_t a1 = vreinterpretq_u8_u32(a.val[1]);
+            uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]);
+            uint8x16_t b1 = vreinterpretq_u8_u32(b.val[1]);
+
+            uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a0), vget_low_u8(a1)), vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+            uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a0), vget_high_u8(a1)), vaddl_u8(vget_high_u8(b0), vget_high_u8(b1)));
+
+            vst1q_u8(dst + i * 4, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+#elif defined(WIC_LOADER_SSE)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(2);
+
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 8));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 8));
+
+            // pixels 0 and 1, then 2 and 3, as 16 bit channels
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+            __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(sum, zero));
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            const uint8_t* a = row0 + i * 8;
+            const uint8_t* b = row1 + i * 8;
+            uint8_t* d = dst + i * 4;
+
+            for (size_t c = 0; c < 4; ++c)
+            {
+                d[c] = static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+            }
+        }
+    }
+
 } // anonymous namespace
 
+  //---------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::_CopyPixelsFast(IWICBitmapFrameDecode* frame,
+    REFGUID pixelFormat,
+    REFGUID targetFormat,
+    UINT width,
+    UINT height,
+    UINT twidth,
+    UINT theight,
+    bool flip,
+    size_t rowPitch,
+    size_t imageSize,
+    uint8_t* pixels)
+{
+    // Channel order of the source and whether it carries alpha
+    bool srcRGB = false;
+    bool srcAlpha = false;
+    size_t srcBytes = 4;
+    if (memcmp(&GUID_WICPixelFormat24bppBGR, &pixelFormat, sizeof(GUID)) == 0)
+    {
+        srcBytes = 3;
+    }
+    else if (memcmp(&GUID_WICPixelFormat24bppRGB, &pixelFormat, sizeof(GUID)) == 0)
+    {
+        srcBytes = 3;
+        srcRGB = true;
+    }
+    else if (memcmp(&GUID_WICPixelFormat32bppBGRA, &pixelFormat, sizeof(GUID)) == 0)
+    {
+        srcAlpha = true;
+    }
+    else if (memcmp(&GUID_WICPixelFormat32bppRGBA, &pixelFormat, sizeof(GUID)) == 0)
+    {
+        srcRGB = true;
+        srcAlpha = true;
+    }
+    else if (memcmp(&GUID_WICPixelFormat32bppBGR, &pixelFormat, sizeof(GUID)) == 0)
+    {
+        // Alpha is filled in
+    }
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8) || defined(_WIN7_PLATFORM_UPDATE)
+    else if (memcmp(&GUID_WICPixelFormat32bppRGB, &pixelFormat, sizeof(GUID)) == 0)
+    {
+        srcRGB = true;
+    }
+#endif
+    else
+    {
+        // Premultiplied, indexed and wider formats are left to WIC
+        return S_FALSE;
+    }
+
+    bool identity = memcmp(&pixelFormat, &targetFormat, sizeof(GUID)) == 0;
+
+    bool dstRGB;
+    if (memcmp(&GUID_WICPixelFormat32bppRGBA, &targetFormat, sizeof(GUID)) == 0)
+    {
+        dstRGB = true;
+    }
+    else if (memcmp(&GUID_WICPixelFormat32bppBGRA, &targetFormat, sizeof(GUID)) == 0)
+    {
+        dstRGB = false;
+    }
+    else if (identity && srcBytes == 4)
+    {
+        dstRGB = srcRGB;
+    }
+    else
+    {
+        return S_FALSE;
+    }
+
+    // Only an exact halving is box filtered, any other size goes through the scaler
+    bool scale = twidth != width || theight != height;
+    if (scale && (twidth != width / 2 || theight != height / 2))
+        return S_FALSE;
+
+    // A plain copy is already what WIC does
+    if (identity && !scale)
+        return S_FALSE;
+
+    if (rowPitch < size_t(twidth) * 4 || imageSize < rowPitch * theight)
+        return E_INVALIDARG;
+
+    bool swapRB = srcRGB != dstRGB;
+    bool fillAlpha = !srcAlpha && !identity;
+
+    size_t srcPitch = size_t(width) * srcBytes;
+    std::unique_ptr<uint8_t[]> src(new (std::nothrow) uint8_t[srcPitch * height]);
+    if (!src)
+        return E_OUTOFMEMORY;
+
+    HRESULT hr = frame->CopyPixels(0, static_cast<UINT>(srcPitch), static_cast<UINT>(srcPitch * height), src.get());
+    if (FAILED(hr))
+        return hr;
+
+    // Two converted rows per output row when halving
+    std::unique_ptr<uint8_t[]> rows;
+    if (scale && !identity)
+    {
+        rows.reset(new (std::nothrow) uint8_t[size_t(width) * 8]);
+        if (!rows)
+            return E_OUTOFMEMORY;
+    }
+
+    for (UINT y = 0; y < theight; ++y)
+    {
+        uint8_t* dst = pixels + rowPitch * (flip ? theight - 1 - y : y);
+
+        if (!scale)
+        {
+            const uint8_t* s = src.get() + srcPitch * y;
+            if (srcBytes == 3)
+                _ConvertRow24To32(s, dst, width, swapRB);
+            else
+                _ConvertRow32(s, dst, width, swapRB, fillAlpha);
+            continue;
+        }
+
+        const uint8_t* s0 = src.get() + srcPitch * (size_t(y) * 2);
+        const uint8_t* s1 = s0 + srcPitch;
+        if (!identity)
+        {
+            uint8_t* r0 = rows.get();
+            uint8_t* r1 = r0 + size_t(width) * 4;
+            if (srcBytes == 3)
+            {
+                _ConvertRow24To32(s0, r0, width, swapRB);
+                _ConvertRow24To32(s1, r1, width, swapRB);
+            }
+            else
+            {
+                _ConvertRow32(s0, r0, width, swapRB, fillAlpha);
+                _ConvertRow32(s1, r1, width, swapRB, fillAlpha);
+            }
+            s0 = r0;
+            s1 = r1;
+        }
+
+        _BoxDownscaleRow32(s0, s1, dst, twidth);
+    }
+
+    return S_OK;
+}
+
+
   //---------------------------------------------------------------------------------
 HRESULT DirectX::CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
     _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -492,7 +827,15 @@ HRESULT DirectX::CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
         return hr;
 
     // Load image data
-    if (memcmp(&convertGUID, &pixelFormat, sizeof(GUID)) == 0
+    hr = _CopyPixelsFast(frame, pixelFormat, convertGUID, width, height, twidth, theight, flip, rowPitch, imageSize, temp.get());
+    if (FAILED(hr))
+        return hr;
+
+    if (hr == S_OK)
+    {
+        // Converted or halved without WIC
+    }
+    else if (memcmp(&convertGUID, &pixelFormat, sizeof(GUID)) == 0
         && twidth == width
         && theight == height)
     {
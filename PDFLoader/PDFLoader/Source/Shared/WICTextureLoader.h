@@ -51,6 +51,20 @@ namespace DirectX
 
     IWICImagingFactory* _GetWIC();
 
+    // Converts the common 24bpp and 32bpp formats to 32bppRGBA or 32bppBGRA, halving the size
+    // if asked, S_FALSE when the format or size is one for IWICFormatConverter and IWICBitmapScaler
+    HRESULT _CopyPixelsFast(_In_ IWICBitmapFrameDecode* frame,
+        _In_ REFGUID pixelFormat,
+        _In_ REFGUID targetFormat,
+        _In_ UINT width,
+        _In_ UINT height,
+        _In_ UINT twidth,
+        _In_ UINT theight,
+        _In_ bool flip,
+        _In_ size_t rowPitch,
+        _In_ size_t imageSize,
+        _Out_writes_bytes_(imageSize) uint8_t* pixels);
+
     HRESULT CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
         _In_opt_ ID3D11DeviceContext* d3dContext,
 #if defined(_XBOX_ONE) && defined(_TITLE)
@@ -12,6 +12,8 @@
 #include <ShCore.h>
 #pragma comment(lib, "ShCore")
 
+#include "PluginTrace.h"
+
 #ifndef IFR
 #define IFR(hresult) { HRESULT hrTest = hresult; if (FAILED(hrTest)) { return hrTest; } } 
 #endif
@@ -33,6 +35,9 @@ typedef int32_t INSTANCE_HANDLE;
 #ifndef INSTANCE_HANDLE_INVALID
 #define INSTANCE_HANDLE_INVALID static_cast<INSTANCE_HANDLE>(0x0bad)
 #define INSTANCE_HANDLE_START static_cast<INSTANCE_HANDLE>(0x0bae)
+
+// a render event for this handle is for every live instance
+#define INSTANCE_HANDLE_BROADCAST static_cast<INSTANCE_HANDLE>(0)
 #endif // INSTANCE_HANDLE_INVALID
 
 typedef enum class _CallbackType : int32_t
@@ -52,7 +57,10 @@ typedef enum class _PdfStateType : int32_t
     Loading = 0,
     Loaded,
     Opened,
-    Selected
+    Selected,
+    Tiles,
+    Thumbnails,
+    TextIndexed
 } PdfStateType;
 
 typedef struct _PDF_STATE
@@ -62,8 +70,49 @@ typedef struct _PDF_STATE
     int32_t width;
     int32_t height;
     void* textureSRV;
+    uint32_t requestId;
+    uint32_t slot;
+    uint32_t format;
 } PDF_STATE;
 
+// a tile of the tile view, where it sits on the page and in the atlas, both normalized
+typedef struct _TILE_INFO
+{
+    uint32_t level;
+    uint32_t column;
+    uint32_t row;
+    float pageX;
+    float pageY;
+    float pageWidth;
+    float pageHeight;
+    float u;
+    float v;
+    float uvWidth;
+    float uvHeight;
+} TILE_INFO;
+
+// a page's thumbnail in the thumbnail atlas, normalized, 0 size when the page failed to render
+typedef struct _THUMBNAIL_INFO
+{
+    uint32_t page;
+    uint32_t width;
+    uint32_t height;
+    float u;
+    float v;
+    float uvWidth;
+    float uvHeight;
+} THUMBNAIL_INFO;
+
+// where SearchText found the query, normalized to the page, one rect per line a match spans
+typedef struct _TEXT_HIT
+{
+    uint32_t page;
+    float x;
+    float y;
+    float width;
+    float height;
+} TEXT_HIT;
+
 #pragma pack(push, 4)
 typedef struct _CALLBACK_STATE
 {
@@ -76,4 +125,4 @@ typedef struct _CALLBACK_STATE
 } CALLBACK_STATE;
 #pragma pack(pop)
 
-extern "C" typedef void(__stdcall *StateChangedCallback)(_In_ CALLBACK_STATE args);
+extern "C" typedef void(__stdcall *StateChangedCallback)(_In_ void* callbackObject, _In_ CALLBACK_STATE args);
@@ -16,6 +16,15 @@ namespace PDFLoader
 
         internal const Int32 InvalidHandle = 0x0bad;
 
+        // a render event for this handle services every live instance
+        internal const Int32 BroadcastHandle = 0;
+
+        // one render event a frame for all instances instead of one each
+        internal static bool BatchRenderEvents = true;
+
+        // the unity frame the broadcast render event was last issued in
+        internal static int LastBroadcastFrame = -1;
+
         internal enum CallbackType : Int32
         {
             None = 0,
@@ -28,7 +37,10 @@ namespace PDFLoader
             Loading = 0,
             Loaded,
             Opened,
-            Selected
+            Selected,
+            Tiles,
+            Thumbnails,
+            TextIndexed
         };
 
         [StructLayout(LayoutKind.Sequential)]
@@ -52,6 +64,54 @@ namespace PDFLoader
             public Int32 Width;
             public Int32 Height;
             public IntPtr TexturePtr;
+            public UInt32 RequestId;
+            public UInt32 Slot;
+            public UInt32 Format;
+        }
+
+        // the dxgi formats a page texture comes in
+        internal const UInt32 FormatBGRA32 = 87;
+        internal const UInt32 FormatBC1 = 71;
+
+        // where a tile sits on the page and in the atlas, both normalized
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct TileInfo
+        {
+            public UInt32 Level;
+            public UInt32 Column;
+            public UInt32 Row;
+            public float PageX;
+            public float PageY;
+            public float PageWidth;
+            public float PageHeight;
+            public float U;
+            public float V;
+            public float UVWidth;
+            public float UVHeight;
+        }
+
+        // a page's thumbnail in the atlas, normalized, a page that failed to render is 0 x 0
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct ThumbnailInfo
+        {
+            public UInt32 Page;
+            public UInt32 Width;
+            public UInt32 Height;
+            public float U;
+            public float V;
+            public float UVWidth;
+            public float UVHeight;
+        }
+
+        // a match of SearchText on a page, normalized, one per line the match spans
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct TextHit
+        {
+            public UInt32 Page;
+            public float X;
+            public float Y;
+            public float Width;
+            public float Height;
         }
 
         [StructLayout(LayoutKind.Explicit, Pack = 4)]
@@ -68,7 +128,7 @@ namespace PDFLoader
         };
 
         [UnmanagedFunctionPointer(CallingConvention.StdCall)]
-        internal delegate void StateChangedCallback(CallbackState args);
+        internal delegate void StateChangedCallback(IntPtr senderPtr, CallbackState args);
 
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetRenderEventFunc")]
         internal static extern IntPtr GetRenderEventFunc();
@@ -122,7 +182,7 @@ namespace PDFLoader
         protected virtual void Awake()
         {
             // pin callback
-            stateChangedCallback = (args) =>
+            stateChangedCallback = (senderPtr, args) =>
             {
 #if UNITY_WSA_10_0
                 if (!UnityEngine.WSA.Application.RunningOnAppThread())
@@ -206,10 +266,25 @@ namespace PDFLoader
 
                 if (instanceId != Wrapper.InvalidHandle && renderFuncPtr != IntPtr.Zero)
                 {
-                    // hi - lastFrameIndex / low - instanceId
-                    int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
+                    if (Wrapper.BatchRenderEvents)
+                    {
+                        // the first instance to get here issues the frame's event for all of them
+                        if (Wrapper.LastBroadcastFrame != Time.frameCount)
+                        {
+                            Wrapper.LastBroadcastFrame = Time.frameCount;
 
-                    GL.IssuePluginEvent(renderFuncPtr, packedValue);
+                            int broadcastValue = ((0xffff & Time.frameCount) << 16) | (0xffff & Wrapper.BroadcastHandle);
+
+                            GL.IssuePluginEvent(renderFuncPtr, broadcastValue);
+                        }
+                    }
+                    else
+                    {
+                        // hi - lastFrameIndex / low - instanceId
+                        int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
+
+                        GL.IssuePluginEvent(renderFuncPtr, packedValue);
+                    }
                 }
             }
 
@@ -11,6 +11,38 @@ namespace PDFLoader
         public string RootFolder = null;
         public string FileName = null;
 
+        // pages are fit into this size with their aspect kept, 0 leaves a side unbounded
+        public UInt32 MaxPageWidth = 2048;
+        public UInt32 MaxPageHeight = 2048;
+
+        // renders at this resolution when smaller than the max size, 0 always fits the max size
+        public float PageDpi = 0.0f;
+
+        // video memory for rendered pages, flips to a cached page come back without a render
+        public UInt32 PageCacheMB = 64;
+
+        // pages of the same size are copied into the displayed texture instead of replacing it
+        public bool ReusePageTexture = true;
+
+        // pages are kept as bc1, an eighth of the video memory, text edges soften a little
+        public bool CompressPages = false;
+
+        // pages asked for with RequestPage on a slot other than 0, the displayed page is slot 0
+        internal event Action<Wrapper.PdfState> PageRendered;
+
+        // the atlas and the tiles of the view set with SetTileView that are in it so far
+        internal event Action<Wrapper.PdfState, Wrapper.TileInfo[], UInt32> TilesUpdated;
+
+        private Wrapper.TileInfo[] tiles = new Wrapper.TileInfo[256];
+
+        // the atlas of the last RenderThumbnails and where each page is in it
+        internal event Action<Wrapper.PdfState, Wrapper.ThumbnailInfo[], UInt32> ThumbnailsReady;
+
+        private Wrapper.ThumbnailInfo[] thumbnails = new Wrapper.ThumbnailInfo[0];
+
+        // every page's text is searchable, PageNumber is the page count
+        internal event Action<Wrapper.PdfState> TextIndexed;
+
         public bool LoadComplete
         {
             get; private set;
@@ -28,6 +60,7 @@ namespace PDFLoader
         private UInt32 currentPage = 0;
         private UInt32 pageCount = 0;
         private Texture2D pageTexture;
+        private IntPtr pageTexturePtr = IntPtr.Zero;
 
         private Vector3 defaultScale = Vector3.one;
 
@@ -63,6 +96,10 @@ namespace PDFLoader
 
             CreatePdf();
 
+            CheckHR(Native.SetPageCacheBudget(instanceId, PageCacheMB));
+            CheckHR(Native.SetTextureReuse(instanceId, ReusePageTexture));
+            CheckHR(Native.SetPageCompression(instanceId, CompressPages));
+
             if (!string.IsNullOrEmpty(FileName))
             {
                 LoadPDF(FileName);
@@ -99,7 +136,26 @@ namespace PDFLoader
                         OnLoaded(args.PdfState);
                         break;
                     case Wrapper.PdfStateType.Selected:
-                        OnPageSelected(args.PdfState);
+                        if (args.PdfState.Slot == 0)
+                        {
+                            OnPageSelected(args.PdfState);
+                        }
+                        else if (PageRendered != null)
+                        {
+                            PageRendered(args.PdfState);
+                        }
+                        break;
+                    case Wrapper.PdfStateType.Tiles:
+                        OnTilesUpdated(args.PdfState);
+                        break;
+                    case Wrapper.PdfStateType.Thumbnails:
+                        OnThumbnailsReady(args.PdfState);
+                        break;
+                    case Wrapper.PdfStateType.TextIndexed:
+                        if (TextIndexed != null)
+                        {
+                            TextIndexed(args.PdfState);
+                        }
                         break;
 
                 }
@@ -116,7 +172,7 @@ namespace PDFLoader
 
                 if (pageCount > 0)
                 {
-                    CheckHR(Native.SelectPage(instanceId, 0));
+                    CheckHR(Native.SelectPageAtSize(instanceId, 0, MaxPageWidth, MaxPageHeight, PageDpi));
                 }
             }
         }
@@ -126,9 +182,26 @@ namespace PDFLoader
             if (pageState.Width > 0 && pageState.Height > 0 && pageState.TexturePtr != IntPtr.Zero)
             {
                 currentPage = pageState.PageNumber;
-                pageTexture = Texture2D.CreateExternalTexture(pageState.Width, pageState.Height, TextureFormat.BGRA32, false, false, pageState.TexturePtr);
+
+                // a reused texture already shows the new page
+                bool reused = pageTexture != null && pageTexturePtr == pageState.TexturePtr
+                    && pageTexture.width == pageState.Width && pageTexture.height == pageState.Height;
+                if (reused)
+                {
+                    if (pageinfo != null)
+                    {
+                        pageinfo.text = currentPage + " / " + (pageCount - 1);
+                    }
+
+                    return;
+                }
+
+                var format = pageState.Format == Wrapper.FormatBC1 ? TextureFormat.DXT1 : TextureFormat.BGRA32;
+
+                pageTexture = Texture2D.CreateExternalTexture(pageState.Width, pageState.Height, format, false, false, pageState.TexturePtr);
                 pageTexture.filterMode = FilterMode.Bilinear;
                 pageTexture.wrapMode = TextureWrapMode.Clamp;
+                pageTexturePtr = pageState.TexturePtr;
             }
 
             if (canvas == null)
@@ -145,7 +218,7 @@ namespace PDFLoader
             else
             {
                 scale.x *= 1.0f;
-                scale.x *= (float)pageTexture.height / pageTexture.width;
+                scale.y *= (float)pageTexture.height / pageTexture.width;
             }
 
             var trans = canvas.GetComponent<RectTransform>();
@@ -166,11 +239,43 @@ namespace PDFLoader
             }
         }
 
+        private void OnTilesUpdated(Wrapper.PdfState atlasState)
+        {
+            if (TilesUpdated == null)
+            {
+                return;
+            }
+
+            UInt32 count = 0;
+            CheckHR(Native.GetTiles(instanceId, tiles, (UInt32)tiles.Length, out count));
+
+            TilesUpdated(atlasState, tiles, count);
+        }
+
+        private void OnThumbnailsReady(Wrapper.PdfState atlasState)
+        {
+            if (ThumbnailsReady == null)
+            {
+                return;
+            }
+
+            UInt32 count = 0;
+            CheckHR(Native.GetThumbnails(instanceId, thumbnails, (UInt32)thumbnails.Length, out count));
+
+            ThumbnailsReady(atlasState, thumbnails, count);
+        }
+
         public void LoadPDF(string filename)
         {
             CheckHR(Native.LoadFile(instanceId, RootFolder, filename));
         }
 
+        // the pdf being downloaded or parsed is dropped, no Opened follows
+        public void CancelLoad()
+        {
+            CheckHR(Native.CancelLoad(instanceId));
+        }
+
         internal void GetPage(Int32 newPageIndex)
         {
             if (newPageIndex == currentPage)
@@ -185,7 +290,62 @@ namespace PDFLoader
                 newPageIndex = 0;
             }
 
-            CheckHR(Native.SelectPage(instanceId, (UInt32)newPageIndex));
+            CheckHR(Native.SelectPageAtSize(instanceId, (UInt32)newPageIndex, MaxPageWidth, MaxPageHeight, PageDpi));
+        }
+
+        // renders alongside the displayed page, e.g. the other half of a spread or a thumbnail,
+        // a newer request on the same slot replaces this one
+        internal UInt32 RequestPage(UInt32 slot, UInt32 pageIndex, UInt32 maxWidth, UInt32 maxHeight, float dpi)
+        {
+            UInt32 requestId = 0;
+
+            CheckHR(Native.RequestPage(instanceId, slot, pageIndex, maxWidth, maxHeight, dpi, out requestId));
+
+            return requestId;
+        }
+
+        // part of the page in normalized coordinates, fit into width x height
+        internal UInt32 RequestRegion(UInt32 slot, UInt32 pageIndex, Rect region, UInt32 width, UInt32 height)
+        {
+            UInt32 requestId = 0;
+
+            CheckHR(Native.RequestRegion(instanceId, slot, pageIndex, region.x, region.y, region.width, region.height, width, height, out requestId));
+
+            return requestId;
+        }
+
+        // the part of the page on screen in normalized coordinates and its width in screen pixels
+        internal void SetTileView(UInt32 pageIndex, Rect view, UInt32 viewPixels)
+        {
+            CheckHR(Native.SetTileView(instanceId, pageIndex, view.x, view.y, view.width, view.height, viewPixels));
+        }
+
+        // the words in order on the pages indexed so far, no page is rendered for it
+        internal Wrapper.TextHit[] SearchText(string query, UInt32 maxHits = 256)
+        {
+            var hits = new Wrapper.TextHit[maxHits];
+
+            UInt32 count = 0;
+            CheckHR(Native.SearchText(instanceId, query, hits, maxHits, out count));
+
+            Array.Resize(ref hits, (int)count);
+
+            return hits;
+        }
+
+        // count pages from firstPage in one texture, each fit into a thumbSize square
+        internal UInt32 RenderThumbnails(UInt32 firstPage, UInt32 count, UInt32 thumbSize)
+        {
+            if (thumbnails.Length < count)
+            {
+                thumbnails = new Wrapper.ThumbnailInfo[count];
+            }
+
+            UInt32 requestId = 0;
+
+            CheckHR(Native.RenderThumbnails(instanceId, firstPage, count, thumbSize, out requestId));
+
+            return requestId;
         }
 
         public void FirstPage()
@@ -213,11 +373,47 @@ namespace PDFLoader
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "LoadFile")]
             public static extern Int32 LoadFile(Int32 handle, [MarshalAs(UnmanagedType.BStr)] string baseFolder, [MarshalAs(UnmanagedType.BStr)] string fileName);
 
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CancelLoad")]
+            public static extern Int32 CancelLoad(Int32 handle);
+
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetPageCount")]
             public static extern Int32 GetPageCount(Int32 handle, ref UInt32 pageCount);
 
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SelectPage")]
             public static extern Int32 SelectPage(Int32 handle, UInt32 pageIndex);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SelectPageAtSize")]
+            public static extern Int32 SelectPageAtSize(Int32 handle, UInt32 pageIndex, UInt32 maxWidth, UInt32 maxHeight, float dpi);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetPageCacheBudget")]
+            public static extern Int32 SetPageCacheBudget(Int32 handle, UInt32 megabytes);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetTextureReuse")]
+            public static extern Int32 SetTextureReuse(Int32 handle, [MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetPageCompression")]
+            public static extern Int32 SetPageCompression(Int32 handle, [MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "RequestPage")]
+            public static extern Int32 RequestPage(Int32 handle, UInt32 slot, UInt32 pageIndex, UInt32 maxWidth, UInt32 maxHeight, float dpi, out UInt32 requestId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "RequestRegion")]
+            public static extern Int32 RequestRegion(Int32 handle, UInt32 slot, UInt32 pageIndex, float x, float y, float width, float height, UInt32 pixelWidth, UInt32 pixelHeight, out UInt32 requestId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetTileView")]
+            public static extern Int32 SetTileView(Int32 handle, UInt32 pageIndex, float x, float y, float width, float height, UInt32 viewPixels);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetTiles")]
+            public static extern Int32 GetTiles(Int32 handle, [Out] Wrapper.TileInfo[] tiles, UInt32 capacity, out UInt32 count);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "RenderThumbnails")]
+            public static extern Int32 RenderThumbnails(Int32 handle, UInt32 firstPage, UInt32 count, UInt32 thumbSize, out UInt32 requestId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SearchText")]
+            public static extern Int32 SearchText(Int32 handle, [MarshalAs(UnmanagedType.BStr)] string query, [Out] Wrapper.TextHit[] hits, UInt32 capacity, out UInt32 count);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetThumbnails")]
+            public static extern Int32 GetThumbnails(Int32 handle, [Out] Wrapper.ThumbnailInfo[] thumbnails, UInt32 capacity, out UInt32 count);
         }
     }
 }
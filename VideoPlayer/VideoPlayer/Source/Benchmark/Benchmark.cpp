@@ -0,0 +1,330 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "BenchmarkHost.h"
+
+// copied next to the benchmark by the post build step
+#define BENCHMARK_PLUGIN L"VideoPlayer.dll"
+
+// a stalled player ends the run instead of hanging it
+#define BENCHMARK_TIMEOUT_MILLISECONDS 120000
+
+// the playback size before the clip opens, what the auto size replaces
+#define BENCHMARK_TEXTURE_WIDTH 640
+#define BENCHMARK_TEXTURE_HEIGHT 360
+
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerCreatePlayerFn)(StateChangedCallback fnCallback, void* managedObject, INSTANCE_HANDLE* handleId);
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerCreatePlaybackTextureFn)(INSTANCE_HANDLE id, int32_t width, int32_t height, void** playbackTexture);
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerSetAutoTextureSizeFn)(INSTANCE_HANDLE id, boolean enable, int32_t maxWidth, int32_t maxHeight);
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerLoadContentFn)(INSTANCE_HANDLE id, LPCWSTR contentLocation);
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerPlayFn)(INSTANCE_HANDLE id);
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerStopFn)(INSTANCE_HANDLE id);
+typedef int32_t(UNITY_INTERFACE_API* MediaPlayerGetStatsFn)(INSTANCE_HANDLE id, PLAYBACK_STATS* stats);
+typedef int32_t(UNITY_INTERFACE_API* GetMemoryStatsFn)(TEXTURE_MEMORY_STATS* stats);
+typedef void(UNITY_INTERFACE_API* ReleaseInstanceFn)(INSTANCE_HANDLE id);
+
+// what the player's threads raised, read by the benchmark's loop
+struct PlaybackContext
+{
+    PlaybackContext(uint32_t frameCapacity)
+        : failed(S_OK)
+        , isOpened(false)
+        , isEnded(false)
+        , textureCount(0)
+    {
+        // reserved so the callbacks don't allocate while the run counts allocations
+        frameTicks.reserve(frameCapacity);
+    }
+
+    winrt::slim_mutex mutex;
+    HRESULT failed;
+    bool isOpened;
+    bool isEnded;
+    uint32_t textureCount;              // playback states carrying a texture, the opened one and each restore
+    std::vector<int64_t> frameTicks;    // qpc of each VideoFrame, when its copy finished
+};
+
+static void __stdcall OnStateChanged(
+    _In_ void* callbackObject,
+    _In_ CALLBACK_STATE args)
+{
+    auto context = static_cast<PlaybackContext*>(callbackObject);
+
+    std::lock_guard<winrt::slim_mutex> guard(context->mutex);
+
+    switch (args.type)
+    {
+    case CallbackType::Failed:
+        context->failed = args.value.failedState.hresult;
+        break;
+    case CallbackType::VideoPlayer:
+        if (args.value.playbackState.state == MediaPlayerState::Opened)
+        {
+            context->isOpened = true;
+        }
+        else if (args.value.playbackState.state == MediaPlayerState::Ended)
+        {
+            context->isEnded = true;
+        }
+
+        if (args.value.playbackState.texturePtr != nullptr)
+        {
+            ++context->textureCount;
+        }
+        break;
+    case CallbackType::VideoFrame:
+        if (context->frameTicks.size() < context->frameTicks.capacity())
+        {
+            context->frameTicks.push_back(args.value.videoFrameState.systemTime);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// a path is opened as a file uri, anything with a scheme as it is
+static std::wstring GetContentUri(
+    _In_ std::wstring const& content)
+{
+    if (content.find(L"://") != std::wstring::npos)
+    {
+        return content;
+    }
+
+    std::wstring uri = L"file:///" + content;
+    std::replace(uri.begin(), uri.end(), L'\\', L'/');
+
+    return uri;
+}
+
+// decode to texture at the clip's own rate, the frame interval is the time between the copies
+// of two frames into the playback texture, the copy's own time is the plugin's percentiles.
+// the texture the app makes is resized once the clip opens, with a reset unity's device goes
+// away halfway and the plugin restores the playback texture on its own. an instance left by a
+// failure is shut down by UnityPluginUnload
+static HRESULT RunPlayback(
+    _In_ uint32_t frameCount,
+    _In_ bool resetDevice,
+    _In_ std::wstring const& content)
+{
+    auto& host = BenchmarkHost::Instance();
+
+    MediaPlayerCreatePlayerFn createPlayer = nullptr;
+    MediaPlayerCreatePlaybackTextureFn createPlaybackTexture = nullptr;
+    MediaPlayerSetAutoTextureSizeFn setAutoTextureSize = nullptr;
+    MediaPlayerLoadContentFn loadContent = nullptr;
+    MediaPlayerPlayFn play = nullptr;
+    MediaPlayerStopFn stop = nullptr;
+    MediaPlayerGetStatsFn getStats = nullptr;
+    GetMemoryStatsFn getMemoryStats = nullptr;
+    ReleaseInstanceFn releaseInstance = nullptr;
+    IFR(host.GetExport("MediaPlayerCreatePlayer", createPlayer));
+    IFR(host.GetExport("MediaPlayerCreatePlaybackTexture", createPlaybackTexture));
+    IFR(host.GetExport("MediaPlayerSetAutoTextureSize", setAutoTextureSize));
+    IFR(host.GetExport("MediaPlayerLoadContent", loadContent));
+    IFR(host.GetExport("MediaPlayerPlay", play));
+    IFR(host.GetExport("MediaPlayerStop", stop));
+    IFR(host.GetExport("MediaPlayerGetStats", getStats));
+    IFR(host.GetExport("GetMemoryStats", getMemoryStats));
+    IFR(host.GetExport("ReleaseInstance", releaseInstance));
+
+    PlaybackContext context(frameCount + BENCHMARK_WARMUP_FRAMES);
+
+    INSTANCE_HANDLE id = INSTANCE_HANDLE_INVALID;
+    IFR(createPlayer(OnStateChanged, &context, &id));
+
+    // the reference handed out is the caller's own, letting go of it leaves the plugin's
+    void* playbackTexture = nullptr;
+    IFR(createPlaybackTexture(id, BENCHMARK_TEXTURE_WIDTH, BENCHMARK_TEXTURE_HEIGHT, &playbackTexture));
+    NULL_CHK_HR(playbackTexture, E_POINTER);
+    if (static_cast<IUnknown*>(playbackTexture)->Release() == 0)
+    {
+        IFR(E_UNEXPECTED);
+    }
+
+    // the clip's own size, what's timed is the decode and copy, not a scale
+    IFR(setAutoTextureSize(id, true, 0, 0));
+    IFR(loadContent(id, GetContentUri(content).c_str()));
+
+    BenchmarkResult result(L"VideoPlayer decode to texture, " + content, L"frame interval");
+    TEXTURE_MEMORY_STATS memoryStats{};
+
+    bool isPlaying = false;
+    bool isStarted = false;
+    bool isReset = false;
+    uint32_t resetTextureCount = 0;
+    size_t frameIndex = BENCHMARK_WARMUP_FRAMES;
+
+    ULONGLONG timeout = GetTickCount64() + BENCHMARK_TIMEOUT_MILLISECONDS;
+    while (result.FrameCount() < frameCount)
+    {
+        if (GetTickCount64() > timeout)
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+        }
+
+        host.RunFrame();
+
+        HRESULT failed = S_OK;
+        bool isOpened = false;
+        bool isEnded = false;
+        uint32_t textureCount = 0;
+        size_t frameTickCount = 0;
+        {
+            std::lock_guard<winrt::slim_mutex> guard(context.mutex);
+
+            failed = context.failed;
+            isOpened = context.isOpened;
+            isEnded = context.isEnded;
+            textureCount = context.textureCount;
+            frameTickCount = context.frameTicks.size();
+        }
+        IFR(failed);
+
+        // halfway through, the frames after it are the restored texture's
+        if (resetDevice && !isReset && result.FrameCount() >= frameCount / 2)
+        {
+            host.ResetDevice();
+
+            resetTextureCount = textureCount;
+            isReset = true;
+        }
+
+        if (isOpened && !isPlaying)
+        {
+            IFR(play(id));
+
+            isPlaying = true;
+        }
+
+        if (!isStarted && frameTickCount >= BENCHMARK_WARMUP_FRAMES)
+        {
+            IFR(getMemoryStats(&memoryStats));
+
+            result.Start(frameCount, &memoryStats);
+
+            isStarted = true;
+        }
+
+        // only appended to, what's below the size is safe to read without the lock
+        for (; isStarted && frameIndex < frameTickCount && result.FrameCount() < frameCount; ++frameIndex)
+        {
+            result.AddFrame(BenchmarkMilliseconds(context.frameTicks[frameIndex] - context.frameTicks[frameIndex - 1]));
+        }
+
+        // a clip shorter than the run, what it had is reported
+        if (isEnded)
+        {
+            break;
+        }
+    }
+
+    if (!isStarted)
+    {
+        IFR(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+    }
+
+    // the restore raises the state with the new texture
+    if (isReset)
+    {
+        for (;;)
+        {
+            uint32_t textureCount = 0;
+            {
+                std::lock_guard<winrt::slim_mutex> guard(context.mutex);
+
+                IFR(context.failed);
+
+                textureCount = context.textureCount;
+            }
+
+            if (textureCount != resetTextureCount)
+            {
+                break;
+            }
+
+            if (GetTickCount64() > timeout)
+            {
+                IFR(HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+            }
+
+            host.RunFrame();
+        }
+    }
+
+    IFR(getMemoryStats(&memoryStats));
+
+    result.Stop(&memoryStats);
+
+    PLAYBACK_STATS stats{};
+    IFR(getStats(id, &stats));
+
+    IFR(stop(id));
+
+    releaseInstance(id);
+
+    result.Print();
+
+    wprintf(L"  copy                   p50 %.3f ms, p99 %.3f ms over %u frames\n", stats.p50CopyMilliseconds, stats.p99CopyMilliseconds, stats.copyHistoryFrames);
+    wprintf(L"  decoded                %llu, copied %llu, dropped %llu\n", stats.framesDecoded, stats.framesCopied, stats.framesDropped);
+
+    return S_OK;
+}
+
+// Benchmark.exe [/d3d12] [/reset] frames clip [clip...], a clip is a path or a uri, /d3d12 has the
+// host render with d3d12, /reset resets its device halfway through each clip
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    UnityGfxRenderer renderer = kUnityGfxRendererD3D11;
+    bool resetDevice = false;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == L'/'; ++arg)
+    {
+        if (_wcsicmp(argv[arg], L"/d3d12") == 0)
+        {
+            renderer = kUnityGfxRendererD3D12;
+        }
+        else if (_wcsicmp(argv[arg], L"/reset") == 0)
+        {
+            resetDevice = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    uint32_t frameCount = argc > arg + 1 ? static_cast<uint32_t>(_wtoi(argv[arg])) : 0;
+    if (frameCount == 0)
+    {
+        wprintf(L"usage: Benchmark.exe [/d3d12] [/reset] frames clip [clip...]\n");
+
+        return 1;
+    }
+
+    winrt::init_apartment();
+
+    auto& host = BenchmarkHost::Instance();
+
+    HRESULT hr = host.Load(BENCHMARK_PLUGIN, renderer);
+
+    // one player per clip, one after the other
+    for (int i = arg + 1; SUCCEEDED(hr) && i < argc; ++i)
+    {
+        hr = RunPlayback(frameCount, resetDevice, argv[i]);
+    }
+
+    host.Unload();
+
+    if (FAILED(hr))
+    {
+        wprintf(L"failed: 0x%08x\n", static_cast<uint32_t>(hr));
+
+        return 1;
+    }
+
+    return 0;
+}
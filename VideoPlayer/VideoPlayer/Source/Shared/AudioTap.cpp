@@ -0,0 +1,336 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "AudioTap.h"
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Media::Audio;
+using namespace winrt::Windows::Media::Core;
+using namespace winrt::Windows::Media::Render;
+
+struct __declspec(uuid("5b0d3235-4dba-4d44-865e-8f1d0e4fd04d")) __declspec(novtable) IMemoryBufferByteAccess : ::IUnknown
+{
+    virtual HRESULT __stdcall GetBuffer(uint8_t** value, uint32_t* capacity) = 0;
+};
+
+_Use_decl_annotations_
+HRESULT AudioTap::Create(
+    uint32_t milliseconds,
+    com_ptr<AudioTap>& audioTap)
+{
+    audioTap = nullptr;
+
+    if (milliseconds < 1 || milliseconds > MAX_AUDIO_BUFFER_MS)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto tap = make_self<AudioTap>();
+    tap->m_milliseconds = milliseconds;
+
+    audioTap = tap;
+
+    return S_OK;
+}
+
+AudioTap::AudioTap()
+    : m_milliseconds(0)
+    , m_closed(false)
+    , m_audioGraph(nullptr)
+    , m_inputNode(nullptr)
+    , m_outputNode(nullptr)
+    , m_quantumStartedToken()
+    , m_ringBuffer(nullptr)
+    , m_playing(false)
+    , m_position(-1)
+    , m_playbackRate(1.0)
+{
+}
+
+AudioTap::~AudioTap()
+{
+    Close();
+}
+
+// throws
+IAsyncAction AudioTap::OpenAsync(
+    MediaSource const source)
+{
+    auto strong = get_strong();
+
+    // the smallest quantum the endpoint allows, unity pulls whatever block size it runs at
+    AudioGraphSettings settings(AudioRenderCategory::Media);
+    settings.QuantumSizeSelectionMode(QuantumSizeSelectionMode::LowestLatency);
+
+    auto graphResult = co_await AudioGraph::CreateAsync(settings);
+    if (graphResult.Status() != AudioGraphCreationStatus::Success)
+    {
+        HRESULT hr = graphResult.ExtendedError();
+
+        throw_hresult(FAILED(hr) ? hr : E_FAIL);
+    }
+
+    auto audioGraph = graphResult.Graph();
+
+    auto inputResult = co_await audioGraph.CreateMediaSourceAudioInputNodeAsync(source);
+    if (inputResult.Status() != MediaSourceAudioInputNodeCreationStatus::Success)
+    {
+        HRESULT hr = inputResult.ExtendedError();
+
+        audioGraph.Close();
+
+        throw_hresult(FAILED(hr) ? hr : MF_E_UNSUPPORTED_FORMAT);
+    }
+
+    auto inputNode = inputResult.Node();
+
+    // no device output node, the frames only go to the ring
+    auto outputNode = audioGraph.CreateFrameOutputNode();
+    inputNode.AddOutgoingConnection(outputNode);
+
+    // the graph's own format, float at the endpoint's rate
+    auto encodingProperties = audioGraph.EncodingProperties();
+
+    com_ptr<AudioRingBuffer> ringBuffer = nullptr;
+    check_hresult(AudioRingBuffer::Create(encodingProperties.SampleRate(), encodingProperties.ChannelCount(), m_milliseconds, ringBuffer));
+
+    auto weak = get_weak();
+    auto quantumStartedToken = audioGraph.QuantumStarted([weak](AudioGraph const& sender, IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(sender);
+        UNREFERENCED_PARAMETER(args);
+
+        auto tap = weak.get();
+        if (tap != nullptr)
+        {
+            tap->OnQuantumStarted();
+        }
+    });
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    // closed while the graph was created
+    if (m_closed)
+    {
+        audioGraph.QuantumStarted(quantumStartedToken);
+        audioGraph.Close();
+
+        co_return;
+    }
+
+    m_audioGraph = audioGraph;
+    m_inputNode = inputNode;
+    m_outputNode = outputNode;
+    m_quantumStartedToken = quantumStartedToken;
+    m_ringBuffer = ringBuffer;
+
+    ApplyTransport();
+
+    m_audioGraph.Start();
+}
+
+void AudioTap::Close()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_closed = true;
+
+    if (m_audioGraph == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        m_audioGraph.QuantumStarted(m_quantumStartedToken);
+        m_audioGraph.Stop();
+        m_audioGraph.Close();
+    }
+    catch (hresult_error const&)
+    {
+    }
+
+    m_outputNode = nullptr;
+    m_inputNode = nullptr;
+    m_audioGraph = nullptr;
+}
+
+_Use_decl_annotations_
+void AudioTap::Start(
+    int64_t position)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_playing = true;
+    m_position = position;
+
+    ApplyTransport();
+}
+
+void AudioTap::Stop()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_playing = false;
+
+    ApplyTransport();
+}
+
+_Use_decl_annotations_
+void AudioTap::Seek(
+    int64_t position)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_position = position;
+
+    ApplyTransport();
+}
+
+_Use_decl_annotations_
+void AudioTap::SetPlaybackRate(
+    double rate)
+{
+    if (rate <= 0.0)
+    {
+        return;
+    }
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_playbackRate = rate;
+
+    ApplyTransport();
+}
+
+_Use_decl_annotations_
+HRESULT AudioTap::GetFormat(
+    uint32_t* sampleRate,
+    uint32_t* channelCount)
+{
+    NULL_CHK_HR(sampleRate, E_INVALIDARG);
+    NULL_CHK_HR(channelCount, E_INVALIDARG);
+
+    *sampleRate = 0;
+    *channelCount = 0;
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    NULL_CHK_HR(m_ringBuffer, MF_E_NOT_INITIALIZED);
+
+    *sampleRate = m_ringBuffer->SampleRate();
+    *channelCount = m_ringBuffer->ChannelCount();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+uint32_t AudioTap::Read(
+    float* samples,
+    uint32_t count,
+    int64_t* timestamp)
+{
+    *timestamp = 0;
+
+    // only the pointer is locked, never the ring
+    com_ptr<AudioRingBuffer> ringBuffer = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        ringBuffer = m_ringBuffer;
+    }
+
+    // silence until the graph runs
+    if (ringBuffer == nullptr)
+    {
+        return 0;
+    }
+
+    LONGLONG sampleTime = 0;
+    uint32_t samplesRead = ringBuffer->Read(samples, count, &sampleTime);
+
+    *timestamp = sampleTime;
+
+    return samplesRead;
+}
+
+// audio graph thread, a stopped input still produces silent quanta, those aren't kept
+void AudioTap::OnQuantumStarted()
+{
+    MediaSourceAudioInputNode inputNode = nullptr;
+    AudioFrameOutputNode outputNode = nullptr;
+    com_ptr<AudioRingBuffer> ringBuffer = nullptr;
+    bool playing = false;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        inputNode = m_inputNode;
+        outputNode = m_outputNode;
+        ringBuffer = m_ringBuffer;
+        playing = m_playing;
+    }
+
+    if (outputNode == nullptr || ringBuffer == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        // drained every quantum even when stopped, so the node never queues stale audio
+        auto frame = outputNode.GetFrame();
+        if (!playing)
+        {
+            return;
+        }
+
+        auto buffer = frame.LockBuffer(AudioBufferAccessMode::Read);
+        auto reference = buffer.CreateReference();
+
+        uint8_t* data = nullptr;
+        uint32_t capacity = 0;
+        check_hresult(reference.as<IMemoryBufferByteAccess>()->GetBuffer(&data, &capacity));
+
+        uint32_t length = buffer.Length() < capacity ? buffer.Length() : capacity;
+
+        // the input's position is where this quantum ends, close enough for a/v sync at these sizes
+        ringBuffer->Write(reinterpret_cast<float const*>(data), length / sizeof(float), inputNode.Position().count());
+    }
+    catch (hresult_error const&)
+    {
+    }
+}
+
+void AudioTap::ApplyTransport()
+{
+    if (m_inputNode == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        if (m_position >= 0)
+        {
+            m_inputNode.Seek(TimeSpan{ m_position });
+            m_position = -1;
+        }
+
+        m_inputNode.PlaybackSpeedFactor(m_playbackRate);
+
+        if (m_playing)
+        {
+            m_inputNode.Start();
+        }
+        else
+        {
+            m_inputNode.Stop();
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+}
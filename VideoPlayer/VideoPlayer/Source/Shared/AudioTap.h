@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "AudioRingBuffer.h"
+
+#include <winrt/Windows.Media.Audio.h>
+#include <winrt/Windows.Media.Core.h>
+#include <winrt/Windows.Media.Render.h>
+
+#include <mutex>
+
+// the audio of a clip decoded by an audio graph next to the player instead of going to the
+// default endpoint, every quantum lands in a ring that unity's audio thread drains in blocks of
+// its own size, the graph's input follows the transport the player reports, thread safe
+struct AudioTap : winrt::implements<AudioTap, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ uint32_t milliseconds,
+        _Out_ winrt::com_ptr<AudioTap>& audioTap);
+
+    AudioTap();
+    virtual ~AudioTap();
+
+    // done once the graph runs, the transport set before that is applied then
+    winrt::Windows::Foundation::IAsyncAction OpenAsync(
+        winrt::Windows::Media::Core::MediaSource const source);
+
+    void Close();
+
+    // positions in 100ns units
+    void Start(
+        _In_ int64_t position);
+    void Stop();
+    void Seek(
+        _In_ int64_t position);
+    void SetPlaybackRate(
+        _In_ double rate);
+
+    // MF_E_NOT_INITIALIZED until the graph runs
+    HRESULT GetFormat(
+        _Out_ uint32_t* sampleRate,
+        _Out_ uint32_t* channelCount);
+
+    // interleaved float samples, timestamp is the position of the first one
+    uint32_t Read(
+        _Out_writes_to_(count, return) float* samples,
+        _In_ uint32_t count,
+        _Out_ int64_t* timestamp);
+
+private:
+    void OnQuantumStarted();
+
+    // under m_mutex
+    void ApplyTransport();
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    uint32_t m_milliseconds;
+    bool m_closed;
+
+    winrt::Windows::Media::Audio::AudioGraph m_audioGraph;
+    winrt::Windows::Media::Audio::MediaSourceAudioInputNode m_inputNode;
+    winrt::Windows::Media::Audio::AudioFrameOutputNode m_outputNode;
+    winrt::event_token m_quantumStartedToken;
+
+    // set once the graph runs, the reader keeps its own reference
+    winrt::com_ptr<AudioRingBuffer> m_ringBuffer;
+
+    // the player's transport, the position is -1 once the input node is there
+    bool m_playing;
+    int64_t m_position;
+    double m_playbackRate;
+};
@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "CaptionAtlas.h"
+
+using namespace winrt;
+
+_Use_decl_annotations_
+HRESULT CaptionAtlas::Create(
+    ID3D11Device* unityDevice,
+    IMFDXGIDeviceManager* dxgiDeviceManager,
+    com_ptr<CaptionAtlas>& captionAtlas)
+{
+    captionAtlas = nullptr;
+
+    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+    NULL_CHK_HR(dxgiDeviceManager, E_INVALIDARG);
+
+    auto atlas = make_self<CaptionAtlas>();
+
+    // premultiplied bgra, what direct2d draws into and unity blends
+    IFR(SharedTextureBuffer::Acquire(unityDevice, dxgiDeviceManager, CAPTION_ATLAS_WIDTH, CAPTION_ATLAS_ROW_HEIGHT * CAPTION_ATLAS_ROWS, DXGI_FORMAT_B8G8R8A8_UNORM, atlas->m_atlasBuffer));
+
+    auto mediaTexture = atlas->m_atlasBuffer->mediaTexture;
+
+    com_ptr<ID3D11Device> mediaDevice = nullptr;
+    mediaTexture->GetDevice(mediaDevice.put());
+    mediaDevice->GetImmediateContext(atlas->m_mediaContext.put());
+
+    // cues come from the player's threads, the media device is multithread protected
+    com_ptr<ID2D1Factory> d2dFactory = nullptr;
+    IFR(D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, __uuidof(ID2D1Factory), d2dFactory.put_void()));
+
+    auto dxgiSurface = mediaTexture.as<IDXGISurface>();
+
+    auto renderTargetProperties = D2D1::RenderTargetProperties(
+        D2D1_RENDER_TARGET_TYPE_HARDWARE,
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+        96.0f,
+        96.0f);
+    IFR(d2dFactory->CreateDxgiSurfaceRenderTarget(dxgiSurface.get(), &renderTargetProperties, atlas->m_renderTarget.put()));
+
+    IFR(atlas->m_renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), atlas->m_textBrush.put()));
+
+    com_ptr<IDWriteFactory> dwriteFactory = nullptr;
+    IFR(DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), reinterpret_cast<::IUnknown**>(dwriteFactory.put())));
+
+    IFR(dwriteFactory->CreateTextFormat(
+        L"Segoe UI",
+        nullptr,
+        DWRITE_FONT_WEIGHT_SEMI_BOLD,
+        DWRITE_FONT_STYLE_NORMAL,
+        DWRITE_FONT_STRETCH_NORMAL,
+        CAPTION_ATLAS_FONT_SIZE,
+        L"",
+        atlas->m_textFormat.put()));
+
+    IFR(atlas->m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
+    IFR(atlas->m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER));
+
+    atlas->m_usedRows.resize(CAPTION_ATLAS_ROWS, false);
+
+    // starts out transparent
+    for (uint32_t row = 0; row < CAPTION_ATLAS_ROWS; ++row)
+    {
+        IFR(atlas->DrawRow(row, hstring()));
+    }
+
+    captionAtlas = atlas;
+
+    return S_OK;
+}
+
+CaptionAtlas::CaptionAtlas()
+    : m_atlasBuffer(nullptr)
+    , m_mediaContext(nullptr)
+    , m_renderTarget(nullptr)
+    , m_textBrush(nullptr)
+    , m_textFormat(nullptr)
+    , m_usedRows()
+{
+}
+
+CaptionAtlas::~CaptionAtlas()
+{
+    m_textFormat = nullptr;
+    m_textBrush = nullptr;
+    m_renderTarget = nullptr;
+    m_mediaContext = nullptr;
+    m_atlasBuffer = nullptr;
+}
+
+_Use_decl_annotations_
+int32_t CaptionAtlas::Add(
+    hstring const& text)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    for (uint32_t row = 0; row < m_usedRows.size(); ++row)
+    {
+        if (m_usedRows[row])
+        {
+            continue;
+        }
+
+        if (FAILED(DrawRow(row, text)))
+        {
+            return -1;
+        }
+
+        m_usedRows[row] = true;
+
+        return static_cast<int32_t>(row);
+    }
+
+    return -1;
+}
+
+_Use_decl_annotations_
+void CaptionAtlas::Remove(
+    int32_t row)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    if (row < 0 || static_cast<uint32_t>(row) >= m_usedRows.size() || !m_usedRows[row])
+    {
+        return;
+    }
+
+    m_usedRows[row] = false;
+
+    DrawRow(static_cast<uint32_t>(row), hstring());
+}
+
+// an empty text only clears the row
+_Use_decl_annotations_
+HRESULT CaptionAtlas::DrawRow(
+    uint32_t row,
+    hstring const& text)
+{
+    PLUGIN_TRACE_SCOPE("CaptionAtlas.DrawRow", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    auto rowRect = D2D1::RectF(
+        0.0f,
+        static_cast<float>(row * CAPTION_ATLAS_ROW_HEIGHT),
+        static_cast<float>(CAPTION_ATLAS_WIDTH),
+        static_cast<float>((row + 1) * CAPTION_ATLAS_ROW_HEIGHT));
+
+    m_renderTarget->BeginDraw();
+    m_renderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+
+    m_renderTarget->PushAxisAlignedClip(rowRect, D2D1_ANTIALIAS_MODE_ALIASED);
+    m_renderTarget->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+
+    if (!text.empty())
+    {
+        m_renderTarget->DrawText(text.c_str(), text.size(), m_textFormat.get(), rowRect, m_textBrush.get(), D2D1_DRAW_TEXT_OPTIONS_CLIP);
+    }
+
+    m_renderTarget->PopAxisAlignedClip();
+
+    IFR(m_renderTarget->EndDraw());
+
+    // unity reads the shared texture on its own device
+    m_mediaContext->Flush();
+
+    return S_OK;
+}
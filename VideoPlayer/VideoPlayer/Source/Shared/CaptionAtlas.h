@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "MediaHelpers.h"
+
+#include <d2d1_1.h>
+#include <dwrite.h>
+#pragma comment(lib, "d2d1")
+#pragma comment(lib, "dwrite")
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// one row per active cue, two lines of text fit a row
+#define CAPTION_ATLAS_WIDTH 1024
+#define CAPTION_ATLAS_ROW_HEIGHT 64
+#define CAPTION_ATLAS_ROWS 8
+#define CAPTION_ATLAS_FONT_SIZE 24.0f
+
+// active caption cues drawn with direct2d on the media device into a texture unity samples, a cue
+// is drawn once when it enters and its row cleared when it exits, thread safe
+struct CaptionAtlas : winrt::implements<CaptionAtlas, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ ID3D11Device* unityDevice,
+        _In_ IMFDXGIDeviceManager* dxgiDeviceManager,
+        _Out_ winrt::com_ptr<CaptionAtlas>& captionAtlas);
+
+    CaptionAtlas();
+    virtual ~CaptionAtlas();
+
+    ID3D11ShaderResourceView* TextureSRV() const { return m_atlasBuffer->frameTextureSRV.get(); }
+
+    // the row the text was drawn in, -1 when every row is taken
+    int32_t Add(
+        _In_ winrt::hstring const& text);
+
+    void Remove(
+        _In_ int32_t row);
+
+private:
+    HRESULT DrawRow(
+        _In_ uint32_t row,
+        _In_ winrt::hstring const& text);
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    std::shared_ptr<SharedTextureBuffer> m_atlasBuffer;
+    winrt::com_ptr<ID3D11DeviceContext> m_mediaContext;
+
+    winrt::com_ptr<ID2D1RenderTarget> m_renderTarget;
+    winrt::com_ptr<ID2D1SolidColorBrush> m_textBrush;
+    winrt::com_ptr<IDWriteTextFormat> m_textFormat;
+
+    std::vector<bool> m_usedRows;
+};
@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "FrameReadback.h"
+#include "MediaHelpers.h"
+
+using namespace winrt;
+using namespace winrt::Windows::Media::Playback;
+
+_Use_decl_annotations_
+HRESULT FrameReadback::Create(
+    ID3D11Device* mediaDevice,
+    uint32_t width,
+    uint32_t height,
+    com_ptr<FrameReadback>& frameReadback)
+{
+    frameReadback = nullptr;
+
+    NULL_CHK_HR(mediaDevice, E_INVALIDARG);
+
+    if (width < 1 || height < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto readback = make_self<FrameReadback>();
+    readback->m_mediaDevice.copy_from(mediaDevice);
+    readback->m_width = width;
+    readback->m_height = height;
+
+    // multithread protected, the player's own use of the device doesn't race this one
+    mediaDevice->GetImmediateContext(readback->m_mediaContext.put());
+
+    auto targetDesc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, width, height);
+    targetDesc.MipLevels = 1;
+    targetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+    auto stagingDesc = targetDesc;
+    stagingDesc.BindFlags = 0;
+    stagingDesc.Usage = D3D11_USAGE_STAGING;
+    stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    readback->m_slots.resize(READBACK_RING_SIZE);
+    for (auto& slot : readback->m_slots)
+    {
+        IFR(mediaDevice->CreateTexture2D(&targetDesc, nullptr, slot.targetTexture.put()));
+        IFR(GetSurfaceFromTexture(slot.targetTexture.get(), slot.targetSurface));
+        IFR(mediaDevice->CreateTexture2D(&stagingDesc, nullptr, slot.stagingTexture.put()));
+
+        slot.presentationTime = 0;
+        slot.pending = false;
+    }
+
+    frameReadback = readback;
+
+    return S_OK;
+}
+
+FrameReadback::FrameReadback()
+    : m_mediaDevice(nullptr)
+    , m_mediaContext(nullptr)
+    , m_width(0)
+    , m_height(0)
+    , m_slots()
+    , m_writeSlot(0)
+{
+}
+
+FrameReadback::~FrameReadback()
+{
+    m_slots.clear();
+
+    m_mediaContext = nullptr;
+    m_mediaDevice = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT FrameReadback::Capture(
+    MediaPlayer const& mediaPlayer,
+    int64_t presentationTime)
+{
+    NULL_CHK_HR(mediaPlayer, E_INVALIDARG);
+
+    // every slot is still waiting on the cpu, the oldest frame is dropped
+    auto& slot = m_slots[m_writeSlot];
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        PLUGIN_TRACE_SCOPE("FrameReadback.Capture", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+        // the video processor scales on the way, a 4k stream isn't read back at 4k
+        mediaPlayer.CopyFrameToVideoSurface(slot.targetSurface);
+
+        m_mediaContext->CopyResource(slot.stagingTexture.get(), slot.targetTexture.get());
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    IFR(hr);
+
+    slot.presentationTime = presentationTime;
+    slot.pending = true;
+
+    m_writeSlot = (m_writeSlot + 1) % static_cast<uint32_t>(m_slots.size());
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void FrameReadback::Deliver(
+    std::function<void(READBACK_FRAME_STATE const&)> const& deliver)
+{
+    // the slot after the write slot holds the oldest frame
+    for (uint32_t i = 0; i < m_slots.size(); ++i)
+    {
+        auto& slot = m_slots[(m_writeSlot + i) % m_slots.size()];
+        if (!slot.pending)
+        {
+            continue;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped{};
+        HRESULT hr = m_mediaContext->Map(slot.stagingTexture.get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+        {
+            // the newer ones were copied after it
+            return;
+        }
+
+        slot.pending = false;
+
+        if (FAILED(hr))
+        {
+            continue;
+        }
+
+        READBACK_FRAME_STATE state{};
+        state.data = mapped.pData;
+        state.width = m_width;
+        state.height = m_height;
+        state.stride = mapped.RowPitch;
+        state.presentationTime = slot.presentationTime;
+
+        deliver(state);
+
+        m_mediaContext->Unmap(slot.stagingTexture.get(), 0);
+    }
+}
@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <winrt/Windows.Media.Playback.h>
+#include <winrt/Windows.Graphics.DirectX.Direct3D11.h>
+
+#include <functional>
+#include <vector>
+
+// frames in flight between the copy and the cpu reading them, the oldest is dropped when all are taken
+#define READBACK_RING_SIZE 3
+
+// decoded frames scaled to the readback size and copied to staging textures on the media device,
+// a slot is mapped once the gpu is done with it, never waiting, so frame n is read while n + 1
+// decodes, player thread only
+struct FrameReadback : winrt::implements<FrameReadback, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ ID3D11Device* mediaDevice,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _Out_ winrt::com_ptr<FrameReadback>& frameReadback);
+
+    FrameReadback();
+    virtual ~FrameReadback();
+
+    ID3D11Device* Device() const { return m_mediaDevice.get(); }
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+    // scales the current frame into the next slot
+    HRESULT Capture(
+        _In_ winrt::Windows::Media::Playback::MediaPlayer const& mediaPlayer,
+        _In_ int64_t presentationTime);
+
+    // every finished slot oldest first, the pointer is only valid during the call
+    void Deliver(
+        _In_ std::function<void(READBACK_FRAME_STATE const&)> const& deliver);
+
+private:
+    struct Slot
+    {
+        winrt::com_ptr<ID3D11Texture2D> targetTexture;
+        winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface targetSurface;
+        winrt::com_ptr<ID3D11Texture2D> stagingTexture;
+        int64_t presentationTime;
+        bool pending;
+    };
+
+    winrt::com_ptr<ID3D11Device> m_mediaDevice;
+    winrt::com_ptr<ID3D11DeviceContext> m_mediaContext;
+    uint32_t m_width;
+    uint32_t m_height;
+
+    std::vector<Slot> m_slots;
+    uint32_t m_writeSlot;
+};
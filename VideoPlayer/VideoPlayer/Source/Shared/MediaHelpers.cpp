@@ -17,6 +17,7 @@
 #include <winrt/windows.media.playback.h>
 #include <windows.graphics.directx.direct3d11.interop.h>
 
+
 using namespace winrt;
 using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Graphics::DirectX::Direct3D11;
@@ -27,6 +28,7 @@ HRESULT SharedTextureBuffer::Create(
     _In_ IMFDXGIDeviceManager* dxgiDeviceManager,
     _In_ uint32_t width,
     _In_ uint32_t height,
+    _In_ DXGI_FORMAT format,
     _In_ std::weak_ptr<SharedTextureBuffer> outputBuffer)
 {
     NULL_CHK_HR(d3dDevice, E_INVALIDARG);
@@ -48,7 +50,8 @@ HRESULT SharedTextureBuffer::Create(
     // since the device is locked, unlock before we exit function
     HRESULT hr = S_OK;
 
-    auto textureDesc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, width, height);
+    // the video processor writes any of the output formats, it only converts to the bit depth asked for
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(format, width, height);
     textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
     textureDesc.MipLevels = 1;
     textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
@@ -116,6 +119,63 @@ done:
     return hr;
 }
 
+_Use_decl_annotations_
+HRESULT SharedTextureBuffer::Acquire(
+    ID3D11Device* d3dDevice,
+    IMFDXGIDeviceManager* dxgiDeviceManager,
+    uint32_t width,
+    uint32_t height,
+    DXGI_FORMAT format,
+    std::shared_ptr<SharedTextureBuffer>& sharedBuffer)
+{
+    sharedBuffer = nullptr;
+
+    NULL_CHK_HR(d3dDevice, E_INVALIDARG);
+    NULL_CHK_HR(dxgiDeviceManager, E_INVALIDARG);
+
+    // the media texture is opened on the manager's device, a pooled one has to match it
+    HANDLE deviceHandle;
+    IFR(dxgiDeviceManager->OpenDeviceHandle(&deviceHandle));
+
+    com_ptr<ID3D11Device> mediaDevice = nullptr;
+    HRESULT hr = dxgiDeviceManager->LockDevice(deviceHandle, __uuidof(ID3D11Device), mediaDevice.put_void(), TRUE);
+    if (SUCCEEDED(hr))
+    {
+        dxgiDeviceManager->UnlockDevice(deviceHandle, FALSE);
+    }
+
+    dxgiDeviceManager->CloseDeviceHandle(deviceHandle);
+
+    IFR(hr);
+
+    TEXTURE_POOL_KEY poolKey{ d3dDevice, mediaDevice.get(), width, height, format, 1, 0 };
+    uint64_t poolBytes = GetTextureBytes(format, width, height, 1);
+
+    auto& pool = SharedTextureBufferPool::Instance();
+
+    auto buffer = pool.Acquire(poolKey, poolBytes);
+    if (buffer == nullptr)
+    {
+        buffer = std::make_shared<SharedTextureBuffer>();
+
+        IFR(Create(d3dDevice, dxgiDeviceManager, width, height, format, buffer));
+
+        buffer->poolKey = poolKey;
+        buffer->poolBytes = poolBytes;
+        buffer->poolGeneration = pool.Generation();
+
+        pool.OnAllocated(poolBytes);
+    }
+
+    // the pool keeps the buffer itself, the pointer handed out only returns it
+    sharedBuffer = std::shared_ptr<SharedTextureBuffer>(buffer.get(), [buffer](SharedTextureBuffer*) mutable
+    {
+        SharedTextureBufferPool::Instance().Recycle(std::move(buffer));
+    });
+
+    return S_OK;
+}
+
 SharedTextureBuffer::SharedTextureBuffer()
     : frameTextureDesc{}
     , frameTexture(nullptr)
@@ -125,6 +185,9 @@ SharedTextureBuffer::SharedTextureBuffer()
     , mediaSurface(nullptr)
     , mediaBuffer(nullptr)
     , mediaSample(nullptr)
+    , poolKey{}
+    , poolBytes(0)
+    , poolGeneration(0)
 {}
 
 SharedTextureBuffer::~SharedTextureBuffer()
@@ -134,6 +197,13 @@ SharedTextureBuffer::~SharedTextureBuffer()
 
 void SharedTextureBuffer::Reset()
 {
+    if (poolBytes != 0)
+    {
+        SharedTextureBufferPool::Instance().OnReleased(poolBytes);
+
+        poolBytes = 0;
+    }
+
     // primary texture
     if (sharedTextureHandle != INVALID_HANDLE_VALUE)
     {
@@ -153,116 +223,6 @@ void SharedTextureBuffer::Reset()
     ZeroMemory(&frameTextureDesc, sizeof(CD3D11_TEXTURE2D_DESC));
 }
 
-// Check for SDK Layer support.
-inline bool SdkLayersAvailable()
-{
-    HRESULT hr = E_NOTIMPL;
-
-#if defined(_DEBUG)
-    hr = D3D11CreateDevice(
-        nullptr,
-        D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
-        0,
-        D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
-        nullptr,                    // Any feature level will do.
-        0,
-        D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
-        nullptr,                    // No need to keep the D3D device reference.
-        nullptr,                    // No need to know the feature level.
-        nullptr                     // No need to keep the D3D device context reference.
-    );
-#endif
-
-    return SUCCEEDED(hr);
-}
-
-_Use_decl_annotations_
-HRESULT CreateMediaDevice(
-    IDXGIAdapter* pDXGIAdapter, 
-    ID3D11Device** ppDevice)
-{
-    NULL_CHK_HR(ppDevice, E_INVALIDARG);
-
-    // Create the Direct3D 11 API device object and a corresponding context.
-    D3D_FEATURE_LEVEL featureLevel;
-
-    // This flag adds support for surfaces with a different color channel ordering
-    // than the API default. It is required for compatibility with Direct2D.
-    UINT creationFlags = D3D11_CREATE_DEVICE_VIDEO_SUPPORT | D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-
-    // If the project is in a debug build, enable debugging via SDK Layers with this flag.
-    if (SdkLayersAvailable())
-    {
-        creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
-    }
-
-    D3D_FEATURE_LEVEL featureLevels[] =
-    {
-        D3D_FEATURE_LEVEL_11_1,
-        D3D_FEATURE_LEVEL_11_0,
-        D3D_FEATURE_LEVEL_10_1,
-        D3D_FEATURE_LEVEL_10_0,
-    };
-
-    com_ptr<ID3D11Device> spDevice;
-    com_ptr<ID3D11DeviceContext> spContext;
-
-    D3D_DRIVER_TYPE driverType = (nullptr != pDXGIAdapter) ? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE;
-
-    // Create a device using the hardware graphics driver if adapter is not supplied
-    HRESULT hr = D3D11CreateDevice(
-        pDXGIAdapter,               // if nullptr will use default adapter.
-        driverType, 
-        0,                          // Should be 0 unless the driver is D3D_DRIVER_TYPE_SOFTWARE.
-        creationFlags,              // Set debug and Direct2D compatibility flags.
-        featureLevels,              // List of feature levels this app can support.
-        ARRAYSIZE(featureLevels),   // Size of the list above.
-        D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
-        spDevice.put(),             // Returns the Direct3D device created.
-        &featureLevel,              // Returns feature level of device created.
-        spContext.put()             // Returns the device immediate context.
-    );
-
-    if (FAILED(hr))
-    {
-        // fallback to WARP if we are not specifying an adapter
-        if (nullptr == pDXGIAdapter)
-        {
-            // If the initialization fails, fall back to the WARP device.
-            // For more information on WARP, see: 
-            // http://go.microsoft.com/fwlink/?LinkId=286690
-            hr = D3D11CreateDevice(
-                nullptr,
-                D3D_DRIVER_TYPE_WARP, // Create a WARP device instead of a hardware device.
-                0,
-                creationFlags,
-                featureLevels,
-                ARRAYSIZE(featureLevels),
-                D3D11_SDK_VERSION,
-                spDevice.put(),
-                &featureLevel,
-                spContext.put());
-        }
-
-        IFR(hr);
-    }
-    else
-    {
-        // workaround for nvidia GPU's, cast to ID3D11VideoDevice
-        auto videoDevice = spDevice.as<ID3D11VideoDevice>();
-    }
-
-    // Turn multithreading on 
-    auto spMultithread = spContext.as<ID3D10Multithread>();
-    NULL_CHK_HR(spMultithread, E_POINTER);
-
-    spMultithread->SetMultithreadProtected(TRUE);
-
-    *ppDevice = spDevice.detach();
-
-    return S_OK;
-}
-
 _Use_decl_annotations_
 HRESULT GetSurfaceFromTexture(
     ID3D11Texture2D* pTexture,
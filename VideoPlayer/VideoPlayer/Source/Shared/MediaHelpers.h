@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include "TexturePool.h"
+#include "MediaDevice.h"
+
 #include <d3d11_1.h>
 
 #include <mfapi.h>
@@ -18,6 +21,27 @@
 #include <mferror.h>
 #pragma comment(lib, "mfuuid")
 
+inline LONGLONG QueryPerformanceTime()
+{
+    LARGE_INTEGER counter{};
+    QueryPerformanceCounter(&counter);
+
+    return counter.QuadPart;
+}
+
+inline LONGLONG QueryPerformanceTicksPerSecond()
+{
+    static LONGLONG const frequency = []()
+    {
+        LARGE_INTEGER value{};
+        QueryPerformanceFrequency(&value);
+
+        return value.QuadPart;
+    }();
+
+    return frequency;
+}
+
 #include <winrt/windows.devices.enumeration.h>
 #include <winrt/windows.graphics.directx.direct3d11.h>
 #include <winrt/windows.media.devices.h>
@@ -30,8 +54,19 @@ struct SharedTextureBuffer
         _In_ IMFDXGIDeviceManager* dxgiDeviceManager,
         _In_ uint32_t width,
         _In_ uint32_t height,
+        _In_ DXGI_FORMAT format,
         _In_ std::weak_ptr<SharedTextureBuffer> outputBuffer);
 
+    // a pooled buffer of the same shape on the same devices or a new one, it goes back
+    // to the pool once the last copy of the pointer is released
+    static HRESULT Acquire(
+        _In_ ID3D11Device* d3dDevice,
+        _In_ IMFDXGIDeviceManager* dxgiDeviceManager,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ DXGI_FORMAT format,
+        _Out_ std::shared_ptr<SharedTextureBuffer>& sharedBuffer);
+
     SharedTextureBuffer();
 
     virtual ~SharedTextureBuffer();
@@ -46,11 +81,15 @@ struct SharedTextureBuffer
     winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface mediaSurface;
     winrt::com_ptr<IMFMediaBuffer> mediaBuffer;
     winrt::com_ptr<IMFSample> mediaSample;
+
+    // set by Acquire, a buffer that was Reset isn't taken back
+    TEXTURE_POOL_KEY poolKey;
+    uint64_t poolBytes;
+    uint32_t poolGeneration;
 };
 
-HRESULT CreateMediaDevice(
-    _In_opt_ IDXGIAdapter* pDXGIAdapter,
-    _COM_Outptr_ ID3D11Device** ppDevice);
+// one for every player in the process
+typedef TexturePool<std::shared_ptr<SharedTextureBuffer>> SharedTextureBufferPool;
 
 HRESULT GetSurfaceFromTexture(
     _In_ ID3D11Texture2D* pTexture,
@@ -0,0 +1,340 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "MediaStreamIngest.h"
+#include "MediaHelpers.h"
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Media::Core;
+using namespace winrt::Windows::Media::MediaProperties;
+using namespace winrt::Windows::Storage::Streams;
+
+_Use_decl_annotations_
+HRESULT StreamIngest::Create(
+    StreamCodec codec,
+    uint32_t width,
+    uint32_t height,
+    com_ptr<StreamIngest>& ingest)
+{
+    ingest = nullptr;
+
+    if ((codec != StreamCodec::H264 && codec != StreamCodec::Hevc) || width < 1 || height < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        auto streamIngest = make_self<StreamIngest>();
+
+        auto properties = codec == StreamCodec::Hevc ? VideoEncodingProperties::CreateHevc() : VideoEncodingProperties::CreateH264();
+        properties.Width(width);
+        properties.Height(height);
+
+        auto streamSource = MediaStreamSource(VideoStreamDescriptor(properties));
+
+        // live, the decoder starts on the first sample instead of buffering ahead
+        streamSource.CanSeek(false);
+        streamSource.BufferTime(TimeSpan{ 0 });
+
+        auto weak = streamIngest->get_weak();
+        streamIngest->m_sampleRequestedToken = streamSource.SampleRequested([weak](MediaStreamSource const& sender, MediaStreamSourceSampleRequestedEventArgs const& args)
+        {
+            UNREFERENCED_PARAMETER(sender);
+
+            auto strong = weak.get();
+            if (strong != nullptr)
+            {
+                strong->OnSampleRequested(args);
+            }
+        });
+
+        streamIngest->m_streamSource = streamSource;
+
+        ingest = streamIngest;
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+StreamIngest::StreamIngest()
+    : m_streamSource(nullptr)
+    , m_sampleRequestedToken()
+    , m_samples()
+    , m_endOfStream(false)
+    , m_closed(false)
+    , m_pendingRequest(nullptr)
+    , m_pendingDeferral(nullptr)
+    , m_bufferPool()
+{
+}
+
+StreamIngest::~StreamIngest()
+{
+    Close();
+}
+
+_Use_decl_annotations_
+HRESULT StreamIngest::Push(
+    uint8_t const* pData,
+    uint32_t size,
+    int64_t timestamp,
+    int64_t duration,
+    bool keyFrame)
+{
+    NULL_CHK_HR(pData, E_INVALIDARG);
+
+    if (size == 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        if (m_closed)
+        {
+            IFR(MF_E_SHUTDOWN);
+        }
+
+        if (m_endOfStream)
+        {
+            IFR(MF_E_END_OF_STREAM);
+        }
+
+        // the decoder fell behind, the caller decides what to drop
+        if (m_samples.size() >= MAX_INGEST_QUEUED_SAMPLES)
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_BUFFER_OVERFLOW));
+        }
+    }
+
+    auto buffer = AcquireBuffer(size);
+    NULL_CHK_HR(buffer, E_OUTOFMEMORY);
+
+    // the only copy, the decoder reads the sample's buffer in place
+    memcpy_s(buffer->m_buffer.data(), buffer->m_buffer.size(), pData, size);
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        buffer->Length(size);
+
+        auto sample = MediaStreamSample::CreateFromBuffer(buffer.as<IBuffer>(), TimeSpan{ timestamp });
+        if (duration > 0)
+        {
+            sample.Duration(TimeSpan{ duration });
+        }
+        sample.KeyFrame(keyFrame);
+
+        // the pipeline is done with the data, the buffer can carry the next access unit
+        auto weak = get_weak();
+        sample.Processed([weak, buffer](MediaStreamSample const& sender, IInspectable const& args)
+        {
+            UNREFERENCED_PARAMETER(sender);
+            UNREFERENCED_PARAMETER(args);
+
+            auto strong = weak.get();
+            if (strong != nullptr)
+            {
+                strong->ReleaseBuffer(buffer);
+            }
+        });
+
+        MediaStreamSourceSampleRequest request = nullptr;
+        MediaStreamSourceSampleRequestDeferral deferral = nullptr;
+        {
+            std::lock_guard<slim_mutex> guard(m_mutex);
+
+            if (m_pendingRequest != nullptr)
+            {
+                request = m_pendingRequest;
+                deferral = m_pendingDeferral;
+
+                m_pendingRequest = nullptr;
+                m_pendingDeferral = nullptr;
+            }
+            else
+            {
+                m_samples.push_back(sample);
+            }
+        }
+
+        if (request != nullptr)
+        {
+            request.Sample(sample);
+            deferral.Complete();
+        }
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+HRESULT StreamIngest::EndOfStream()
+{
+    MediaStreamSourceSampleRequest request = nullptr;
+    MediaStreamSourceSampleRequestDeferral deferral = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        if (m_closed)
+        {
+            IFR(MF_E_SHUTDOWN);
+        }
+
+        m_endOfStream = true;
+
+        request = m_pendingRequest;
+        deferral = m_pendingDeferral;
+
+        m_pendingRequest = nullptr;
+        m_pendingDeferral = nullptr;
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        // a request answered without a sample ends the stream
+        if (deferral != nullptr)
+        {
+            deferral.Complete();
+        }
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+void StreamIngest::Close()
+{
+    MediaStreamSourceSampleRequestDeferral deferral = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        if (m_closed)
+        {
+            return;
+        }
+
+        m_closed = true;
+
+        m_samples.clear();
+        m_bufferPool.clear();
+
+        deferral = m_pendingDeferral;
+
+        m_pendingRequest = nullptr;
+        m_pendingDeferral = nullptr;
+    }
+
+    try
+    {
+        if (deferral != nullptr)
+        {
+            deferral.Complete();
+        }
+
+        if (m_streamSource != nullptr)
+        {
+            m_streamSource.SampleRequested(m_sampleRequestedToken);
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+}
+
+// media foundation thread, waits on a deferral until the next Push when nothing is queued
+_Use_decl_annotations_
+void StreamIngest::OnSampleRequested(
+    MediaStreamSourceSampleRequestedEventArgs const& args)
+{
+    auto request = args.Request();
+
+    MediaStreamSample sample = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        if (!m_samples.empty())
+        {
+            sample = m_samples.front();
+            m_samples.pop_front();
+        }
+        else if (!m_endOfStream && !m_closed)
+        {
+            m_pendingRequest = request;
+            m_pendingDeferral = request.GetDeferral();
+
+            return;
+        }
+    }
+
+    // without a sample the stream ends
+    request.Sample(sample);
+}
+
+// a pooled buffer at least the size asked for or a new one
+_Use_decl_annotations_
+com_ptr<CustomBuffer> StreamIngest::AcquireBuffer(
+    uint32_t size)
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        for (auto it = m_bufferPool.begin(); it != m_bufferPool.end(); ++it)
+        {
+            if ((*it)->Capacity() >= size)
+            {
+                auto buffer = *it;
+
+                m_bufferPool.erase(it);
+
+                return buffer;
+            }
+        }
+    }
+
+    com_ptr<CustomBuffer> buffer = nullptr;
+
+    try
+    {
+        buffer = make_self<CustomBuffer>(size);
+    }
+    catch (...)
+    {
+    }
+
+    return buffer;
+}
+
+_Use_decl_annotations_
+void StreamIngest::ReleaseBuffer(
+    com_ptr<CustomBuffer> const& buffer)
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    if (m_closed || m_bufferPool.size() >= MAX_INGEST_POOLED_BUFFERS)
+    {
+        return;
+    }
+
+    m_bufferPool.push_back(buffer);
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <winrt/Windows.Media.Core.h>
+#include <winrt/Windows.Media.MediaProperties.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// samples pushed ahead of the decoder before MediaPlayerPushSample pushes back
+#define MAX_INGEST_QUEUED_SAMPLES 120
+
+// buffers kept for reuse once the pipeline let go of their sample
+#define MAX_INGEST_POOLED_BUFFERS 16
+
+// a media stream source fed with encoded access units instead of a file or uri, each unit is
+// copied once into a pooled buffer that the sample hands to the decoder as is, thread safe
+struct StreamIngest : winrt::implements<StreamIngest, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ StreamCodec codec,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _Out_ winrt::com_ptr<StreamIngest>& ingest);
+
+    StreamIngest();
+    virtual ~StreamIngest();
+
+    winrt::Windows::Media::Core::MediaStreamSource const& Source() const { return m_streamSource; }
+
+    // timestamps and durations in 100ns units, a duration of 0 is left to the decoder
+    HRESULT Push(
+        _In_reads_bytes_(size) uint8_t const* pData,
+        _In_ uint32_t size,
+        _In_ int64_t timestamp,
+        _In_ int64_t duration,
+        _In_ bool keyFrame);
+
+    // the player ends once the queued samples are decoded
+    HRESULT EndOfStream();
+
+    void Close();
+
+private:
+    void OnSampleRequested(
+        _In_ winrt::Windows::Media::Core::MediaStreamSourceSampleRequestedEventArgs const& args);
+
+    winrt::com_ptr<CustomBuffer> AcquireBuffer(
+        _In_ uint32_t size);
+    void ReleaseBuffer(
+        _In_ winrt::com_ptr<CustomBuffer> const& buffer);
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    winrt::Windows::Media::Core::MediaStreamSource m_streamSource;
+    winrt::event_token m_sampleRequestedToken;
+
+    std::deque<winrt::Windows::Media::Core::MediaStreamSample> m_samples;
+    bool m_endOfStream;
+    bool m_closed;
+
+    // the decoder asked before a sample was pushed, answered by the next Push
+    winrt::Windows::Media::Core::MediaStreamSourceSampleRequest m_pendingRequest;
+    winrt::Windows::Media::Core::MediaStreamSourceSampleRequestDeferral m_pendingDeferral;
+
+    std::vector<winrt::com_ptr<CustomBuffer>> m_bufferPool;
+};
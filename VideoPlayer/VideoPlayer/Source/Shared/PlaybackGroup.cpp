@@ -0,0 +1,274 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "PlaybackGroup.h"
+#include "Plugin.PlaybackManager.h"
+
+using namespace winrt;
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Media;
+
+using PlaybackManager = winrt::VideoPlayer::Plugin::implementation::PlaybackManager;
+
+_Use_decl_annotations_
+HRESULT PlaybackGroup::Create(
+    com_ptr<PlaybackGroup>& group)
+{
+    group = nullptr;
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        auto playbackGroup = make_self<PlaybackGroup>();
+
+        playbackGroup->m_timelineController = MediaTimelineController();
+
+        group = playbackGroup;
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+PlaybackGroup::PlaybackGroup()
+    : m_timelineController(nullptr)
+    , m_players()
+    , m_rendered(false)
+    , m_lastFrameNumber(0)
+    , m_heldFrames(0)
+{
+}
+
+PlaybackGroup::~PlaybackGroup()
+{
+    Close();
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackGroup::Add(
+    PlaybackManager* player)
+{
+    NULL_CHK_HR(player, E_INVALIDARG);
+
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        NULL_CHK_HR(m_timelineController, MF_E_SHUTDOWN);
+
+        for (auto const& weakPlayer : m_players)
+        {
+            if (weakPlayer.get().get() == player)
+            {
+                return S_OK;
+            }
+        }
+
+        m_players.push_back(player->get_weak());
+    }
+
+    // not under the lock, the player calls back here from its render event
+    return player->JoinGroup(get_strong(), m_timelineController);
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackGroup::Remove(
+    PlaybackManager* player)
+{
+    NULL_CHK_HR(player, E_INVALIDARG);
+
+    bool found = false;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        for (auto it = m_players.begin(); it != m_players.end(); ++it)
+        {
+            if (it->get().get() == player)
+            {
+                m_players.erase(it);
+
+                found = true;
+
+                break;
+            }
+        }
+    }
+
+    if (!found)
+    {
+        IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+    }
+
+    player->LeaveGroup();
+
+    return S_OK;
+}
+
+void PlaybackGroup::Close()
+{
+    std::vector<weak_ref<PlaybackManager>> players;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        players.swap(m_players);
+
+        if (m_timelineController != nullptr)
+        {
+            m_timelineController.Pause();
+        }
+    }
+
+    for (auto const& weakPlayer : players)
+    {
+        auto player = weakPlayer.get();
+        if (player != nullptr)
+        {
+            player->LeaveGroup();
+        }
+    }
+}
+
+HRESULT PlaybackGroup::Play()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    NULL_CHK_HR(m_timelineController, MF_E_SHUTDOWN);
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        // start always begins at the controller's position, resume only continues a pause
+        if (m_timelineController.State() == MediaTimelineControllerState::Paused)
+        {
+            m_timelineController.Resume();
+        }
+        else if (m_timelineController.State() != MediaTimelineControllerState::Running)
+        {
+            m_timelineController.Start();
+        }
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+HRESULT PlaybackGroup::Pause()
+{
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    NULL_CHK_HR(m_timelineController, MF_E_SHUTDOWN);
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_timelineController.Pause();
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackGroup::Seek(
+    TimeSpan const& position)
+{
+    if (position.count() < 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    NULL_CHK_HR(m_timelineController, MF_E_SHUTDOWN);
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_timelineController.Position(position);
+    }
+    catch (hresult_error const& e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+// render thread
+_Use_decl_annotations_
+void PlaybackGroup::OnRenderEvent(
+    uint16_t frameNumber)
+{
+    std::vector<com_ptr<PlaybackManager>> players;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        if (m_rendered && frameNumber == m_lastFrameNumber)
+        {
+            return;
+        }
+
+        m_rendered = true;
+        m_lastFrameNumber = frameNumber;
+
+        for (auto const& weakPlayer : m_players)
+        {
+            auto player = weakPlayer.get();
+            if (player != nullptr)
+            {
+                players.push_back(player);
+            }
+        }
+    }
+
+    // render driven players copy their current frame first, outside the lock since that raises callbacks
+    for (auto const& player : players)
+    {
+        player->PublishRenderFrame();
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        uint32_t pendingCount = 0;
+        for (auto const& player : players)
+        {
+            if (player->HasPendingFrame())
+            {
+                ++pendingCount;
+            }
+        }
+
+        if (pendingCount == 0)
+        {
+            return;
+        }
+
+        // a tile that is late only holds the wall back for a couple of frames
+        if (pendingCount < players.size() && ++m_heldFrames <= MAX_GROUP_HELD_FRAMES)
+        {
+            return;
+        }
+
+        m_heldFrames = 0;
+    }
+
+    for (auto const& player : players)
+    {
+        player->PresentFrame();
+    }
+}
@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <winrt/Windows.Media.h>
+
+#include <mutex>
+#include <vector>
+
+// render frames a tile without a new frame can hold the rest of the group back
+#define MAX_GROUP_HELD_FRAMES 2
+
+namespace winrt::VideoPlayer::Plugin::implementation
+{
+    struct PlaybackManager;
+}
+
+// players driven by one media timeline controller, so their clocks can't drift apart, and
+// presented together on the render thread, so every tile flips in the same unity frame
+struct PlaybackGroup : winrt::implements<PlaybackGroup, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _Out_ winrt::com_ptr<PlaybackGroup>& group);
+
+    PlaybackGroup();
+    virtual ~PlaybackGroup();
+
+    HRESULT Add(
+        _In_ winrt::VideoPlayer::Plugin::implementation::PlaybackManager* player);
+    HRESULT Remove(
+        _In_ winrt::VideoPlayer::Plugin::implementation::PlaybackManager* player);
+    void Close();
+
+    HRESULT Play();
+    HRESULT Pause();
+    HRESULT Seek(
+        _In_ winrt::Windows::Foundation::TimeSpan const& position);
+
+    // every member forwards its render event here, only the first one per unity frame counts
+    void OnRenderEvent(
+        _In_ uint16_t frameNumber);
+
+private:
+    winrt::slim_mutex m_mutex;
+    winrt::Windows::Media::MediaTimelineController m_timelineController;
+    std::vector<winrt::weak_ref<winrt::VideoPlayer::Plugin::implementation::PlaybackManager>> m_players;
+
+    bool m_rendered;
+    uint16_t m_lastFrameNumber;
+    uint32_t m_heldFrames;
+};
@@ -2,7 +2,6 @@
 #include "Plugin.PlaybackManager.h"
 #include "Plugin.PlaybackManager.g.cpp"
 
-#include <winrt/Windows.Media.Core.h>
 #include <winrt/Windows.Graphics.DirectX.Direct3D11.h>
 #include <Windows.Graphics.DirectX.Direct3D11.h>
 
@@ -28,16 +27,112 @@ VideoPlayer::Plugin::IModule PlaybackManager::Create(
 }
 
 PlaybackManager::PlaybackManager()
-    : m_d3dDevice(nullptr)
+    : m_sharedMediaDevice(nullptr)
+    , m_d3dDevice(nullptr)
+    , m_dxgiDeviceManager(nullptr)
+    , m_deviceLostToken()
+    , m_mediaDeviceLost(false)
     , m_mediaPlayer(nullptr)
+    , m_playbackList(nullptr)
+    , m_currentItemChangedToken()
+    , m_playlistGeneration(0)
+    , m_adaptiveSources()
+    , m_initialBitrate(0)
+    , m_minBitrate(0)
+    , m_maxBitrate(0)
+    , m_streamIngest(nullptr)
     , m_mediaPlaybackSession(nullptr)
-    , m_primaryBuffer(std::make_shared<SharedTextureBuffer>())
+    , m_frameBufferCount(DEFAULT_FRAME_BUFFERS)
+    , m_frameBuffers()
+    , m_latestBuffer(0)
+    , m_frameSequence(0)
+    , m_renderSequence(0)
+    , m_frameInfo{}
+    , m_renderTexture(nullptr)
+    , m_renderTextureSRV(nullptr)
+    , m_resetTextureWidth(0)
+    , m_resetTextureHeight(0)
+    , m_outputs()
+    , m_nextOutputId(1)
+    , m_frameReadback(nullptr)
+    , m_frameCacheMaxFrames(0)
+    , m_frameCacheMaxMegabytes(0)
+    , m_frameCache()
+    , m_frameCacheHead(0)
+    , m_frameCacheCount(0)
+    , m_frameCacheCursor(-1)
+    , m_cachedFrameBuffer(nullptr)
+    , m_autoTextureSize(false)
+    , m_maxTextureWidth(0)
+    , m_maxTextureHeight(0)
+    , m_mipmaps(false)
+    , m_outputFormat(OutputFormat::Bgra8)
+    , m_renderDriven(false)
+    , m_videoFrameAvailable(false)
+    , m_prerollPending(false)
+    , m_cueTracks()
+    , m_activeCues()
+    , m_nextCueId(1)
+    , m_captionAtlas(nullptr)
+    , m_audioTapMilliseconds(0)
+    , m_audioTap(nullptr)
+    , m_suspended(false)
+    , m_resumeItem(nullptr)
+    , m_resumePosition(-1)
+    , m_resumePlaying(false)
+    , m_resumeReadbackWidth(0)
+    , m_resumeReadbackHeight(0)
+    , m_stats{}
+    , m_lastDecodedTime(0)
+    , m_lastCopiedTime(0)
+    , m_decodedInterval(0.0f)
+    , m_copiedInterval(0.0f)
+    , m_copyHistory()
+    , m_group(nullptr)
+    , m_timelineController(nullptr)
+    , m_atlas(nullptr)
+    , m_atlasX(0)
+    , m_atlasY(0)
+    , m_atlasTileWidth(0)
+    , m_atlasTileHeight(0)
+    , m_seekPending(false)
+    , m_queuedSeekPosition(-1)
 {
 }
 
 void PlaybackManager::Shutdown()
 {
-    m_primaryBuffer.reset();
+    com_ptr<PlaybackGroup> group = nullptr;
+    com_ptr<VideoAtlas> atlas = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        group = m_group;
+        atlas = m_atlas;
+    }
+
+    if (group != nullptr)
+    {
+        group->Remove(this);
+    }
+
+    if (atlas != nullptr)
+    {
+        atlas->Remove(this);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_frameBuffers.clear();
+        m_renderTextureSRV = nullptr;
+        m_renderTexture = nullptr;
+        m_outputs.clear();
+        m_frameReadback = nullptr;
+        m_frameCache.clear();
+        m_frameCacheCount = 0;
+        m_cachedFrameBuffer = nullptr;
+    }
 
     ReleaseMediaPlayer();
 
@@ -56,64 +151,91 @@ void PlaybackManager::Closed(event_token const& token)
     m_closedEvent.remove(token);
 }
 
-_Use_decl_annotations_
-HRESULT PlaybackManager::CreatePlaybackTexture(
-    UINT32 width,
-    UINT32 height,
-    void** ppvTexture)
+// render thread, unity's immediate context is only touched here
+void PlaybackManager::OnRenderEvent(uint16_t frameNumber)
 {
-    NULL_CHK_HR(ppvTexture, E_INVALIDARG);
+    Module::OnRenderEvent(frameNumber);
 
-    if (width < 1 || height < 1)
+    com_ptr<PlaybackGroup> group = nullptr;
+    com_ptr<VideoAtlas> atlas = nullptr;
     {
-        IFR(E_INVALIDARG);
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        group = m_group;
+        atlas = m_atlas;
     }
 
-    *ppvTexture = nullptr;
+    // the group presents all of its players at once
+    if (group != nullptr)
+    {
+        group->OnRenderEvent(frameNumber);
 
-    m_primaryBuffer->Reset();
+        return;
+    }
 
-    auto resources = m_d3d11DeviceResources.lock();
-    NULL_CHK_HR(resources, E_POINTER);
+    // so does the atlas, one copy per tile into the shared texture
+    if (atlas != nullptr)
+    {
+        atlas->OnRenderEvent(frameNumber);
 
-    // make sure we have created our own d3d device
-    IFR(CreateResources(resources->GetDevice()));
+        return;
+    }
 
-    IFR(SharedTextureBuffer::Create(resources->GetDevice().get(), m_dxgiDeviceManager.get(), width, height, m_primaryBuffer));
+    PublishRenderFrame();
 
-    com_ptr<ID3D11ShaderResourceView> spSRV = nullptr;
-    m_primaryBuffer->frameTextureSRV.copy_to(spSRV.put());
+    PresentFrame();
+}
 
-    *ppvTexture = spSRV.detach();
+// render thread, copies the frame the player shows right now if one became available since the
+// last render event, also after render driven was turned off so a paused frame isn't lost
+void PlaybackManager::PublishRenderFrame()
+{
+    if (!m_videoFrameAvailable.exchange(false))
+    {
+        return;
+    }
 
-    return S_OK;
+    PublishVideoFrame();
 }
 
 _Use_decl_annotations_
-HRESULT PlaybackManager::LoadContent(
-    hstring const& contentLocation)
+HRESULT PlaybackManager::JoinGroup(
+    com_ptr<PlaybackGroup> const& group,
+    Windows::Media::MediaTimelineController const& timelineController)
 {
-    if (contentLocation.empty())
-    {
-        IFR(E_INVALIDARG);
-    }
+    NULL_CHK_HR(group, E_INVALIDARG);
+    NULL_CHK_HR(timelineController, E_INVALIDARG);
 
-    if (m_mediaPlayer == nullptr)
     {
-        IFR(CreateMediaPlayer());
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        if (m_group != nullptr && m_group != group)
+        {
+            IFR(HRESULT_FROM_WIN32(ERROR_ALREADY_ASSIGNED));
+        }
+
+        // an atlas presents on its own schedule, not the group's
+        if (m_atlas != nullptr)
+        {
+            IFR(E_ILLEGAL_METHOD_CALL);
+        }
+
+        m_group = group;
+        m_timelineController = timelineController;
     }
 
     HRESULT hr = S_OK;
 
     try
     {
-        auto uri = Windows::Foundation::Uri(contentLocation);
-
-        auto mediaSource = Windows::Media::Core::MediaSource::CreateFromUri(uri);
-
-        m_mediaPlayer.Source(mediaSource);
+        // the player can also be created later, CreateMediaPlayer attaches it then
+        if (m_mediaPlayer != nullptr)
+        {
+            m_mediaPlayer.CommandManager().IsEnabled(false);
+            m_mediaPlayer.TimelineController(timelineController);
+        }
     }
-    catch (hresult_error const & e)
+    catch (hresult_error const& e)
     {
         hr = e.code();
     }
@@ -121,250 +243,3217 @@ HRESULT PlaybackManager::LoadContent(
     return hr;
 }
 
-_Use_decl_annotations_
-HRESULT PlaybackManager::Play()
+void PlaybackManager::LeaveGroup()
 {
-    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-    HRESULT hr = S_OK;
+        m_group = nullptr;
+        m_timelineController = nullptr;
+    }
 
     try
     {
-        m_mediaPlayer.Play();
+        if (m_mediaPlayer != nullptr)
+        {
+            m_mediaPlayer.TimelineController(nullptr);
+            m_mediaPlayer.CommandManager().IsEnabled(true);
+        }
     }
-    catch (hresult_error const & e)
+    catch (hresult_error const&)
     {
-        hr = e.code();
     }
-
-    return hr;
 }
 
+// the tile is the playback texture's size, which has to be bgra8 for the region copy
 _Use_decl_annotations_
-HRESULT PlaybackManager::Pause()
+HRESULT PlaybackManager::JoinAtlas(
+    com_ptr<VideoAtlas> const& atlas,
+    uint32_t x,
+    uint32_t y)
 {
-    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+    NULL_CHK_HR(atlas, E_INVALIDARG);
 
-    HRESULT hr = S_OK;
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-    try
+    if (m_atlas != nullptr)
     {
-        m_mediaPlayer.Pause();
+        IFR(HRESULT_FROM_WIN32(ERROR_ALREADY_ASSIGNED));
     }
-    catch (hresult_error const & e)
+
+    // the group presents its players itself
+    if (m_group != nullptr)
     {
-        hr = e.code();
+        IFR(E_ILLEGAL_METHOD_CALL);
     }
 
-    return hr;
-}
+    NULL_CHK_HR(m_renderTexture, MF_E_NOT_INITIALIZED);
 
-_Use_decl_annotations_
-HRESULT PlaybackManager::Stop()
-{
-    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+    D3D11_TEXTURE2D_DESC desc{};
+    m_renderTexture->GetDesc(&desc);
 
-    HRESULT hr = S_OK;
+    if (desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM)
+    {
+        IFR(MF_E_INVALIDMEDIATYPE);
+    }
 
-    try
+    if (x >= atlas->Width() || y >= atlas->Height() || desc.Width > atlas->Width() - x || desc.Height > atlas->Height() - y)
     {
-        m_mediaPlayer.Source(nullptr);
+        IFR(E_INVALIDARG);
     }
-    catch (hresult_error const & e)
+
+    m_atlas = atlas;
+    m_atlasX = x;
+    m_atlasY = y;
+    m_atlasTileWidth = desc.Width;
+    m_atlasTileHeight = desc.Height;
+
+    // the newest frame goes into the tile with the next render event
+    if (m_frameSequence > 0)
     {
-        hr = e.code();
+        m_renderSequence = m_frameSequence - 1;
     }
 
-    return hr;
+    return S_OK;
 }
 
-_Use_decl_annotations_
-HRESULT PlaybackManager::CreateMediaPlayer()
+// the playback texture gets the frames again from the next one on
+void PlaybackManager::LeaveAtlas()
 {
-    if (m_mediaPlayer != nullptr)
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    m_atlas = nullptr;
+
+    if (m_frameSequence > 0)
     {
-        ReleaseMediaPlayer();
+        m_renderSequence = m_frameSequence - 1;
     }
+}
 
-    m_mediaPlayer = Windows::Media::Playback::MediaPlayer();
+bool PlaybackManager::HasPendingFrame()
+{
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-    m_endedToken = m_mediaPlayer.MediaEnded([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Foundation::IInspectable const& args)
+    return m_renderSequence != m_frameSequence;
+}
+
+// render thread
+void PlaybackManager::PresentFrame()
+{
+    auto resources = m_d3d11DeviceResources.lock();
+    if (resources == nullptr)
     {
-        UNREFERENCED_PARAMETER(sender);
-        UNREFERENCED_PARAMETER(args);
+        return;
+    }
 
-        CALLBACK_STATE state{};
-        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+    com_ptr<ID3D11DeviceContext> context = nullptr;
+    resources->GetDevice()->GetImmediateContext(context.put());
 
-        state.type = CallbackType::VideoPlayer;
+    PresentFrame(context.get(), nullptr);
+}
 
-        ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
-        state.value.playbackState.state = MediaPlayerState::Ended;
+// the player's tile in the atlas gets the frame instead of the playback texture
+_Use_decl_annotations_
+void PlaybackManager::PresentToAtlas(
+    ID3D11DeviceContext* context,
+    ID3D11Texture2D* atlasTexture)
+{
+    if (context == nullptr || atlasTexture == nullptr)
+    {
+        return;
+    }
 
-        Callback(state);
-    });
+    PresentFrame(context, atlasTexture);
+}
 
-    m_failedToken = m_mediaPlayer.MediaFailed([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Media::Playback::MediaPlayerFailedEventArgs const& args)
-    {
-        UNREFERENCED_PARAMETER(sender);
-        UNREFERENCED_PARAMETER(args);
+_Use_decl_annotations_
+void PlaybackManager::PresentFrame(
+    ID3D11DeviceContext* context,
+    ID3D11Texture2D* atlasTexture)
+{
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-        CALLBACK_STATE state{};
-        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+    if (m_renderSequence == m_frameSequence || m_renderTexture == nullptr || m_latestBuffer >= m_frameBuffers.size())
+    {
+        return;
+    }
 
-        state.type = CallbackType::Failed;
+    // stepping through the frame cache shows a cached frame instead of the decoder's newest
+    auto const& frameBuffer = m_cachedFrameBuffer != nullptr ? m_cachedFrameBuffer : m_frameBuffers[m_latestBuffer];
+    if (frameBuffer == nullptr || frameBuffer->frameTexture == nullptr)
+    {
+        return;
+    }
 
-        ZeroMemory(&state.value.failedState, sizeof(FAILED_STATE));
+    PLUGIN_TRACE_SCOPE("PlaybackManager.CopyRenderTexture", PLUGIN_TRACE_KEYWORD_TEXTURE);
 
-        state.value.failedState.hresult = args.ExtendedErrorCode();
+    if (atlasTexture != nullptr)
+    {
+        // a region copy, clipped to the tile in case the buffers grew with the clip
+        D3D11_TEXTURE2D_DESC frameDesc{};
+        frameBuffer->frameTexture->GetDesc(&frameDesc);
 
-        Callback(state);
-    });
+        D3D11_BOX box{};
+        box.right = frameDesc.Width < m_atlasTileWidth ? frameDesc.Width : m_atlasTileWidth;
+        box.bottom = frameDesc.Height < m_atlasTileHeight ? frameDesc.Height : m_atlasTileHeight;
+        box.back = 1;
 
-    m_openedToken = m_mediaPlayer.MediaOpened([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Foundation::IInspectable const& args)
+        context->CopySubresourceRegion(atlasTexture, 0, m_atlasX, m_atlasY, 0, frameBuffer->frameTexture.get(), 0, &box);
+    }
+    else
     {
-        UNREFERENCED_PARAMETER(sender);
-        UNREFERENCED_PARAMETER(args);
+        CopyToRenderTexture(context, m_renderTexture.get(), m_renderTextureSRV.get(), frameBuffer->frameTexture.get());
+    }
 
-        if (nullptr == m_mediaPlaybackSession)
+    m_renderSequence = m_frameSequence;
+
+    // published together with the playback texture, so they show the same frame
+    for (auto const& kv : m_outputs)
+    {
+        auto const& output = kv.second;
+        if (output->renderSequence == output->frameSequence || output->latestBuffer >= output->frameBuffers.size())
         {
-            return;
+            continue;
         }
 
-        CALLBACK_STATE state{};
-        ZeroMemory(&state, sizeof(CALLBACK_STATE));
-
-        state.type = CallbackType::VideoPlayer;
-
-        ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
-        state.value.playbackState.state = MediaPlayerState::Opened;
-        state.value.playbackState.width = static_cast<int32_t>(m_mediaPlaybackSession.NaturalVideoWidth());
-        state.value.playbackState.height = static_cast<int32_t>(m_mediaPlaybackSession.NaturalVideoHeight());
-        state.value.playbackState.canSeek = static_cast<boolean>(m_mediaPlaybackSession.CanSeek());
-        state.value.playbackState.duration = m_mediaPlaybackSession.NaturalDuration().count();
+        CopyToRenderTexture(context, output->renderTexture.get(), output->renderTextureSRV.get(), output->frameBuffers[output->latestBuffer]->frameTexture.get());
 
-        Callback(state);
-    });
+        output->renderSequence = output->frameSequence;
+    }
 
-    // set frameserver mode for video
-    m_mediaPlayer.IsVideoFrameServerEnabled(true);
-    m_videoFrameAvailableToken = m_mediaPlayer.VideoFrameAvailable([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Foundation::IInspectable const& args)
-    {
-        UNREFERENCED_PARAMETER(sender);
-        UNREFERENCED_PARAMETER(args);
+    // the newest frame is the one just copied, both only change under m_frameMutex
+    m_frameInfo.renderPresentationTime = m_frameInfo.presentationTime;
+    m_frameInfo.renderSystemTime = QueryPerformanceTime();
+}
 
-        if (nullptr != m_primaryBuffer->mediaSurface)
-        {
-            m_mediaPlayer.CopyFrameToVideoSurface(m_primaryBuffer->mediaSurface);
-        }
-    });
+// the caller owns a reference on what it gets, the view on d3d11, the shared resource on d3d12
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreatePlaybackTexture(
+    UINT32 width,
+    UINT32 height,
+    void** ppvTexture)
+{
+    NULL_CHK_HR(ppvTexture, E_INVALIDARG);
 
-    m_mediaPlaybackSession = m_mediaPlayer.PlaybackSession();
-    m_stateChangedEventToken = m_mediaPlaybackSession.PlaybackStateChanged([=](Windows::Media::Playback::MediaPlaybackSession const& sender, Windows::Foundation::IInspectable const& args)
+    if (width < 1 || height < 1)
     {
-        UNREFERENCED_PARAMETER(sender);
-        UNREFERENCED_PARAMETER(args);
-
-        if (nullptr == m_mediaPlaybackSession)
-        {
-            return;
-        }
+        IFR(E_INVALIDARG);
+    }
 
-        CALLBACK_STATE state{};
-        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+    *ppvTexture = nullptr;
 
-        state.type = CallbackType::VideoPlayer;
+    IFR(CreatePlaybackTextureInternal(width, height));
 
-        ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
-        state.value.playbackState.state = static_cast<MediaPlayerState>(m_mediaPlaybackSession.PlaybackState());
+    com_ptr<ID3D11ShaderResourceView> spSRV = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-        state.value.playbackState.width = static_cast<int32_t>(m_mediaPlaybackSession.NaturalVideoWidth());
-        state.value.playbackState.height = static_cast<int32_t>(m_mediaPlaybackSession.NaturalVideoHeight());
-        state.value.playbackState.canSeek = static_cast<boolean>(m_mediaPlaybackSession.CanSeek());
-        state.value.playbackState.duration = m_mediaPlaybackSession.NaturalDuration().count();
+        spSRV = m_renderTextureSRV;
+    }
 
-        Callback(state);
-    });
+    *ppvTexture = AddRefUnityTexture(spSRV.get());
 
     return S_OK;
 }
 
+// resize and restore go through here, the texture reaches the app with the opened state
 _Use_decl_annotations_
-void PlaybackManager::ReleaseMediaPlayer()
+HRESULT PlaybackManager::CreatePlaybackTextureInternal(
+    uint32_t width,
+    uint32_t height)
 {
-    if (m_mediaPlaybackSession != nullptr)
     {
-        m_mediaPlaybackSession.PlaybackStateChanged(m_stateChangedEventToken);
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-        m_mediaPlaybackSession = nullptr;
+        m_frameBuffers.clear();
+        m_renderTextureSRV = nullptr;
+        m_renderTexture = nullptr;
     }
 
-    if (m_mediaPlayer != nullptr)
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, E_POINTER);
+
+    // make sure we have created our own d3d device
+    IFR(CreateResources(resources->GetDevice()));
+
+    // a readback on a removed media device moves to the new one
+    com_ptr<FrameReadback> frameReadback = nullptr;
     {
-        m_mediaPlayer.MediaEnded(m_endedToken);
-        m_mediaPlayer.MediaFailed(m_failedToken);
-        m_mediaPlayer.MediaOpened(m_openedToken);
-        m_mediaPlayer.VideoFrameAvailable(m_videoFrameAvailableToken);
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-        m_mediaPlayer = nullptr;
+        frameReadback = m_frameReadback;
     }
-}
 
-_Use_decl_annotations_
-HRESULT PlaybackManager::CreateResources(com_ptr<ID3D11Device> const& unityDevice)
-{
-    if (m_d3dDevice != nullptr)
+    if (frameReadback != nullptr && frameReadback->Device() != m_d3dDevice.get())
     {
-        return S_OK;
+        IFR(SetReadback(true, frameReadback->Width(), frameReadback->Height()));
     }
 
-    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+    std::vector<std::shared_ptr<SharedTextureBuffer>> frameBuffers;
+    IFR(CreateFrameBuffers(resources->GetDevice().get(), width, height, GetDxgiFormat(m_outputFormat), m_frameBufferCount, frameBuffers));
 
-    auto sdxgiDevice = unityDevice.as<IDXGIDevice>();
-    NULL_CHK_HR(sdxgiDevice, E_POINTER);
+    com_ptr<ID3D11Texture2D> renderTexture = nullptr;
+    com_ptr<ID3D11ShaderResourceView> spSRV = nullptr;
+    IFR(CreateRenderTexture(resources->GetDevice().get(), frameBuffers[0]->frameTextureDesc, m_mipmaps, renderTexture, spSRV));
 
-    com_ptr<IDXGIAdapter> dxgiAdapter = nullptr;
-    IFR(sdxgiDevice->GetAdapter(dxgiAdapter.put()));
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_frameBuffers = std::move(frameBuffers);
+        m_latestBuffer = 0;
+        m_renderSequence = m_frameSequence;
+
+        ZeroMemory(&m_frameInfo, sizeof(VIDEO_FRAME_INFO));
+        m_renderTexture = renderTexture;
+        m_renderTextureSRV = spSRV;
+    }
 
-    // create dx device for media pipeline
-    com_ptr<ID3D11Device> d3dDevice = nullptr;
-    IFR(CreateMediaDevice(dxgiAdapter.get(), d3dDevice.put()));
+    // the media device may have been replaced
+    IFR(CreateOutputBuffers(resources->GetDevice().get()));
 
-    // lock the shared dxgi device manager
-    // will keep lock open for the life of object
-    //     call MFUnlockDXGIDeviceManager when unloading
-    uint32_t resetToken;
-    com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager;
-    IFR(MFLockDXGIDeviceManager(&resetToken, dxgiDeviceManager.put()));
+    // the cached frames have the size of the old texture
+    IFR(CreateFrameCache());
 
-    // associtate the device with the manager
-    IFR(dxgiDeviceManager->ResetDevice(d3dDevice.get(), resetToken));
-    
-    m_d3dDevice.attach(d3dDevice.detach());
-    m_resetToken = resetToken;
-    m_dxgiDeviceManager = dxgiDeviceManager;
+    // a stream capped by the old texture follows the new one
+    ApplyBitrateLimits();
 
     return S_OK;
 }
 
+// the outputs keep their textures and get new buffers on the current media device
 _Use_decl_annotations_
-void PlaybackManager::ReleaseResources()
+HRESULT PlaybackManager::CreateOutputBuffers(
+    ID3D11Device* unityDevice)
 {
-    if (m_dxgiDeviceManager != nullptr)
+    std::vector<std::shared_ptr<PlaybackOutput>> outputs;
     {
-        m_dxgiDeviceManager->ResetDevice(m_d3dDevice.get(), m_resetToken);
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
 
-        // release the default media foundation dxgi manager
-        MFUnlockDXGIDeviceManager();
-
-        m_dxgiDeviceManager = nullptr;
+        for (auto const& kv : m_outputs)
+        {
+            outputs.push_back(kv.second);
+        }
     }
 
-    if (m_d3dDevice != nullptr)
+    for (auto const& output : outputs)
     {
-        m_d3dDevice = nullptr;
+        D3D11_TEXTURE2D_DESC desc{};
+        output->renderTexture->GetDesc(&desc);
+
+        std::vector<std::shared_ptr<SharedTextureBuffer>> outputBuffers;
+        IFR(CreateFrameBuffers(unityDevice, desc.Width, desc.Height, desc.Format, OUTPUT_FRAME_BUFFERS, outputBuffers));
+
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        output->frameBuffers = std::move(outputBuffers);
+        output->latestBuffer = 0;
+        output->renderSequence = output->frameSequence;
     }
 
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::LoadContent(
+    hstring const& contentLocation)
+{
+    return OpenContent(contentLocation, false);
+}
+
+// opens the content paused and has the player render its first frame, Prerolled follows once
+// it's in the frame buffers so Play only has to start the clock
+_Use_decl_annotations_
+HRESULT PlaybackManager::Preroll(
+    hstring const& contentLocation)
+{
+    return OpenContent(contentLocation, true);
+}
+
+// the slow part of the first LoadContent, the media device and the player, can run on a worker
+// thread as long as the app doesn't call into the player until it returns
+_Use_decl_annotations_
+HRESULT PlaybackManager::Prepare()
+{
+    if (m_suspended)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, E_POINTER);
+
+    IFR(CreateResources(resources->GetDevice()));
+
+    if (m_mediaPlayer == nullptr)
+    {
+        IFR(CreateMediaPlayer());
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::OpenContent(
+    hstring const& contentLocation,
+    bool preroll)
+{
+    if (contentLocation.empty())
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    // Resume reopens what was loaded before
+    if (m_suspended)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    if (m_mediaPlayer == nullptr)
+    {
+        IFR(CreateMediaPlayer());
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        auto mediaSource = CreateMediaSource(contentLocation);
+
+        {
+            // a seek on the old source may never complete
+            std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+            m_seekPending = false;
+            m_queuedSeekPosition = -1;
+        }
+
+        // replaces whatever was queued
+        ReleasePlaybackList();
+        IFR(CreatePlaybackList());
+
+        m_playbackList.Items().Append(Windows::Media::Playback::MediaPlaybackItem(mediaSource));
+
+        // set before the source, MediaOpened asks for the first frame
+        m_prerollPending = preroll;
+        if (preroll)
+        {
+            m_mediaPlayer.AutoPlay(false);
+        }
+
+        m_mediaPlayer.Source(m_playbackList);
+
+        OpenAudioTap(contentLocation);
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+// replaces the playlist like LoadContent, the player decodes what PushSample hands it
+_Use_decl_annotations_
+HRESULT PlaybackManager::OpenStream(
+    StreamCodec codec,
+    uint32_t width,
+    uint32_t height)
+{
+    if (m_suspended)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    if (m_mediaPlayer == nullptr)
+    {
+        IFR(CreateMediaPlayer());
+    }
+
+    com_ptr<StreamIngest> streamIngest = nullptr;
+    IFR(StreamIngest::Create(codec, width, height, streamIngest));
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        {
+            std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+            m_seekPending = false;
+            m_queuedSeekPosition = -1;
+        }
+
+        ReleasePlaybackList();
+        IFR(CreatePlaybackList());
+
+        {
+            std::lock_guard<slim_mutex> guard(m_ingestMutex);
+
+            m_streamIngest = streamIngest;
+        }
+
+        auto mediaSource = Windows::Media::Core::MediaSource::CreateFromMediaStreamSource(streamIngest->Source());
+
+        m_playbackList.Items().Append(Windows::Media::Playback::MediaPlaybackItem(mediaSource));
+
+        m_mediaPlayer.Source(m_playbackList);
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+// any thread, one access unit with its start codes
+_Use_decl_annotations_
+HRESULT PlaybackManager::PushSample(
+    uint8_t const* pData,
+    uint32_t size,
+    int64_t timestamp,
+    int64_t duration,
+    bool keyFrame)
+{
+    com_ptr<StreamIngest> streamIngest = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_ingestMutex);
+
+        streamIngest = m_streamIngest;
+    }
+
+    NULL_CHK_HR(streamIngest, MF_E_NOT_INITIALIZED);
+
+    return streamIngest->Push(pData, size, timestamp, duration, keyFrame);
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::EndStream()
+{
+    com_ptr<StreamIngest> streamIngest = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_ingestMutex);
+
+        streamIngest = m_streamIngest;
+    }
+
+    NULL_CHK_HR(streamIngest, MF_E_NOT_INITIALIZED);
+
+    return streamIngest->EndOfStream();
+}
+
+// opened and buffered in the background while the current clip plays, the switch is gapless
+// and the texture keeps its size, CopyFrameToVideoSurface scales a clip of another size into it
+_Use_decl_annotations_
+HRESULT PlaybackManager::QueueContent(
+    hstring const& contentLocation)
+{
+    if (contentLocation.empty())
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    // nothing is playing yet, the first clip opens like LoadContent
+    if (m_playbackList == nullptr)
+    {
+        return LoadContent(contentLocation);
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        auto mediaSource = CreateMediaSource(contentLocation);
+
+        m_playbackList.Items().Append(Windows::Media::Playback::MediaPlaybackItem(mediaSource));
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::SkipToNext()
+{
+    NULL_CHK_HR(m_playbackList, MF_E_NOT_INITIALIZED);
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        if (m_playbackList.MoveNext() == nullptr)
+        {
+            hr = MF_E_END_OF_STREAM;
+        }
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+// applies from the next clip that opens, the opened callback carries the new srv
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetAutoTextureSize(
+    bool enable,
+    uint32_t maxWidth,
+    uint32_t maxHeight)
+{
+    m_maxTextureWidth = maxWidth;
+    m_maxTextureHeight = maxHeight;
+    m_autoTextureSize = enable;
+
+    return S_OK;
+}
+
+// the next frame the playback texture gets is scaled into the output as well, only decoded once
+_Use_decl_annotations_
+HRESULT PlaybackManager::AddOutput(
+    uint32_t width,
+    uint32_t height,
+    void** ppvTexture,
+    uint32_t* pOutputId)
+{
+    NULL_CHK_HR(ppvTexture, E_INVALIDARG);
+    NULL_CHK_HR(pOutputId, E_INVALIDARG);
+
+    if (width < 1 || height < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    *ppvTexture = nullptr;
+    *pOutputId = 0;
+
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, E_POINTER);
+
+    IFR(CreateResources(resources->GetDevice()));
+
+    auto output = std::make_shared<PlaybackOutput>();
+    output->latestBuffer = 0;
+    output->frameSequence = 0;
+    output->renderSequence = 0;
+
+    IFR(CreateFrameBuffers(resources->GetDevice().get(), width, height, GetDxgiFormat(m_outputFormat), OUTPUT_FRAME_BUFFERS, output->frameBuffers));
+    IFR(CreateRenderTexture(resources->GetDevice().get(), output->frameBuffers[0]->frameTextureDesc, m_mipmaps, output->renderTexture, output->renderTextureSRV));
+
+    uint32_t outputId = 0;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        if (m_outputs.size() >= MAX_PLAYBACK_OUTPUTS)
+        {
+            IFR(E_BOUNDS);
+        }
+
+        outputId = m_nextOutputId++;
+
+        m_outputs[outputId] = output;
+    }
+
+    // a reference on what the caller got, the output keeps its own
+    *ppvTexture = AddRefUnityTexture(output->renderTextureSRV.get());
+
+    *pOutputId = outputId;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::RemoveOutput(
+    uint32_t outputId)
+{
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    // a copy that is running holds the buffers until it's done
+    if (m_outputs.erase(outputId) == 0)
+    {
+        IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+    }
+
+    return S_OK;
+}
+
+// frames are copied on the render thread once per render event instead of on the player thread
+// for every decoded frame, the render event paces the copies
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetRenderDriven(
+    bool enable)
+{
+    m_renderDriven = enable;
+
+    return S_OK;
+}
+
+// applies to the textures created after the call, the playback texture and new outputs
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetMipmaps(
+    bool enable)
+{
+    m_mipmaps = enable;
+
+    return S_OK;
+}
+
+// applies to the textures created after the call like SetMipmaps
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetOutputFormat(
+    OutputFormat format)
+{
+    if (format != OutputFormat::Bgra8 && format != OutputFormat::Rgb10A2 && format != OutputFormat::Rgba16F)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    m_outputFormat = format;
+
+    return S_OK;
+}
+
+// every frame is scaled to width x height and read back to the cpu a frame or more later
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetReadback(
+    bool enable,
+    uint32_t width,
+    uint32_t height)
+{
+    com_ptr<FrameReadback> frameReadback = nullptr;
+
+    if (enable)
+    {
+        if (width < 1 || height < 1)
+        {
+            IFR(E_INVALIDARG);
+        }
+
+        auto resources = m_d3d11DeviceResources.lock();
+        NULL_CHK_HR(resources, E_POINTER);
+
+        IFR(CreateResources(resources->GetDevice()));
+
+        IFR(FrameReadback::Create(m_d3dDevice.get(), width, height, frameReadback));
+    }
+
+    // a frame still held by the player thread finishes on the old ring
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    m_frameReadback = frameReadback;
+
+    return S_OK;
+}
+
+// 0 frames turns the cache off, megabytes bound the frame count for large textures, 0 is unbounded
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetFrameCache(
+    uint32_t maxFrames,
+    uint32_t maxMegabytes)
+{
+    if (maxFrames > MAX_FRAME_CACHE_FRAMES)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_frameCacheMaxFrames = maxFrames;
+        m_frameCacheMaxMegabytes = maxMegabytes;
+    }
+
+    return CreateFrameCache();
+}
+
+// served from the frame cache while the shown frame isn't the newest decoded one, the decoder
+// steps otherwise
+_Use_decl_annotations_
+HRESULT PlaybackManager::StepForward()
+{
+    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+
+    if (m_timelineController != nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        if (m_frameCacheCursor >= 0)
+        {
+            PresentCachedFrame(m_frameCacheCursor + 1);
+
+            return S_OK;
+        }
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_mediaPlayer.StepForwardOneFrame();
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+// a frame before the cached window is decoded again from its keyframe
+_Use_decl_annotations_
+HRESULT PlaybackManager::StepBackward()
+{
+    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+
+    if (m_timelineController != nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    int64_t oldestTime = -1;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        int32_t cursor = m_frameCacheCursor >= 0 ? m_frameCacheCursor : static_cast<int32_t>(m_frameCacheCount) - 1;
+        if (cursor > 0)
+        {
+            PresentCachedFrame(cursor - 1);
+
+            return S_OK;
+        }
+
+        if (m_frameCacheCount > 0)
+        {
+            oldestTime = m_frameCache[m_frameCacheHead].presentationTime;
+        }
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_mediaPlayer.Pause();
+
+        if (oldestTime > 0 && m_mediaPlaybackSession != nullptr)
+        {
+            // the decoder is at the newest cached frame, not the oldest, land on the one before it
+            m_mediaPlaybackSession.Position(TimeSpan{ oldestTime - 1 });
+        }
+        else
+        {
+            m_mediaPlayer.StepBackwardOneFrame();
+        }
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+// called under m_frameMutex, the cursor counts from the oldest cached frame, the newest one
+// is where the decoder is so showing it follows the decoder again
+_Use_decl_annotations_
+void PlaybackManager::PresentCachedFrame(
+    int32_t cursor)
+{
+    if (cursor < 0 || static_cast<uint32_t>(cursor) >= m_frameCacheCount)
+    {
+        return;
+    }
+
+    auto const& cachedFrame = m_frameCache[(m_frameCacheHead + static_cast<uint32_t>(cursor)) % m_frameCache.size()];
+
+    if (static_cast<uint32_t>(cursor) + 1 == m_frameCacheCount)
+    {
+        m_frameCacheCursor = -1;
+        m_cachedFrameBuffer = nullptr;
+    }
+    else
+    {
+        m_frameCacheCursor = cursor;
+        m_cachedFrameBuffer = cachedFrame.frameBuffer;
+    }
+
+    ++m_frameSequence;
+    m_frameInfo.presentationTime = cachedFrame.presentationTime;
+}
+
+// sized like the playback texture, nothing to do until there is one
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreateFrameCache()
+{
+    uint32_t maxFrames = 0;
+    uint32_t maxMegabytes = 0;
+    D3D11_TEXTURE2D_DESC desc{};
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_frameCache.clear();
+        m_frameCacheHead = 0;
+        m_frameCacheCount = 0;
+        m_frameCacheCursor = -1;
+        m_cachedFrameBuffer = nullptr;
+
+        if (m_frameBuffers.empty() || m_frameCacheMaxFrames == 0)
+        {
+            return S_OK;
+        }
+
+        maxFrames = m_frameCacheMaxFrames;
+        maxMegabytes = m_frameCacheMaxMegabytes;
+        desc = m_frameBuffers[0]->frameTextureDesc;
+    }
+
+    uint64_t frameBytes = static_cast<uint64_t>(desc.Width) * desc.Height * (desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT ? 8 : 4);
+
+    uint32_t frameCount = maxFrames;
+    if (maxMegabytes > 0)
+    {
+        uint64_t budgetFrames = (static_cast<uint64_t>(maxMegabytes) << 20) / frameBytes;
+        frameCount = budgetFrames < frameCount ? static_cast<uint32_t>(budgetFrames) : frameCount;
+    }
+
+    if (frameCount == 0)
+    {
+        return S_OK;
+    }
+
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, E_POINTER);
+
+    std::vector<std::shared_ptr<SharedTextureBuffer>> frameBuffers;
+    IFR(CreateFrameBuffers(resources->GetDevice().get(), desc.Width, desc.Height, desc.Format, frameCount, frameBuffers));
+
+    std::vector<CachedFrame> frameCache;
+    for (auto const& frameBuffer : frameBuffers)
+    {
+        frameCache.push_back({ frameBuffer, 0 });
+    }
+
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    m_frameCache = std::move(frameCache);
+
+    return S_OK;
+}
+
+// applies to the streams of the current playlist right away, 0 leaves a limit to the source
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetBitrateLimits(
+    uint32_t initialBitrate,
+    uint32_t minBitrate,
+    uint32_t maxBitrate)
+{
+    if (maxBitrate > 0 && minBitrate > maxBitrate)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    m_initialBitrate = initialBitrate;
+    m_minBitrate = minBitrate;
+    m_maxBitrate = maxBitrate;
+
+    ApplyBitrateLimits();
+
+    return S_OK;
+}
+
+// player thread, keeps the texture when the clip already fits it
+_Use_decl_annotations_
+HRESULT PlaybackManager::ResizePlaybackTexture(
+    uint32_t naturalWidth,
+    uint32_t naturalHeight)
+{
+    if (naturalWidth < 1 || naturalHeight < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    uint32_t width = naturalWidth;
+    uint32_t height = naturalHeight;
+
+    // scaled down to the bounds, keeping the aspect ratio
+    uint32_t maxWidth = m_maxTextureWidth;
+    uint32_t maxHeight = m_maxTextureHeight;
+    if (maxWidth > 0 && width > maxWidth)
+    {
+        height = static_cast<uint32_t>((static_cast<uint64_t>(height) * maxWidth) / width);
+        width = maxWidth;
+    }
+    if (maxHeight > 0 && height > maxHeight)
+    {
+        width = static_cast<uint32_t>((static_cast<uint64_t>(width) * maxHeight) / height);
+        height = maxHeight;
+    }
+
+    // a sliver of a clip still needs a pixel
+    width = width > 0 ? width : 1;
+    height = height > 0 ? height : 1;
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        if (m_renderTexture != nullptr)
+        {
+            D3D11_TEXTURE2D_DESC desc{};
+            m_renderTexture->GetDesc(&desc);
+
+            if (desc.Width == width && desc.Height == height)
+            {
+                return S_OK;
+            }
+        }
+    }
+
+    // nothing handed out, the opened state carries the new texture
+    IFR(CreatePlaybackTextureInternal(width, height));
+
+    return S_OK;
+}
+
+// unity's device only backs the textures, the player and its media device keep decoding while
+// everything made on unity's device is let go, outputs and the caption atlas are asked for again
+void PlaybackManager::OnDeviceResetStarted()
+{
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        if (!m_frameBuffers.empty())
+        {
+            m_resetTextureWidth = m_frameBuffers[0]->frameTextureDesc.Width;
+            m_resetTextureHeight = m_frameBuffers[0]->frameTextureDesc.Height;
+        }
+
+        m_frameBuffers.clear();
+        m_renderTextureSRV = nullptr;
+        m_renderTexture = nullptr;
+        m_outputs.clear();
+        m_frameCache.clear();
+        m_frameCacheCount = 0;
+        m_cachedFrameBuffer = nullptr;
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_cueMutex);
+
+        m_captionAtlas = nullptr;
+
+        for (auto& activeCue : m_activeCues)
+        {
+            activeCue.atlasRow = -1;
+        }
+    }
+}
+
+void PlaybackManager::OnDeviceResetCompleted()
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        width = m_resetTextureWidth;
+        height = m_resetTextureHeight;
+
+        m_resetTextureWidth = 0;
+        m_resetTextureHeight = 0;
+    }
+
+    // there was no texture to bring back
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+
+    RestorePlaybackTexture(width, height);
+}
+
+// off the render thread, the next decoded frame lands in the new texture and the state
+// carrying it has the app swap its external texture
+_Use_decl_annotations_
+fire_and_forget PlaybackManager::RestorePlaybackTexture(
+    uint32_t width,
+    uint32_t height)
+{
+    auto strong = get_strong();
+
+    co_await resume_background();
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        // the app created one of its own in the meantime
+        if (m_renderTexture != nullptr)
+        {
+            co_return;
+        }
+    }
+
+    HRESULT hr = CreatePlaybackTextureInternal(width, height);
+
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    if (FAILED(hr))
+    {
+        state.type = CallbackType::Failed;
+        state.value.failedState.hresult = hr;
+
+        Callback(state);
+
+        co_return;
+    }
+
+    void* texturePtr = nullptr;
+    Windows::Media::Playback::MediaPlaybackSession playbackSession = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        texturePtr = GetUnityTexture(m_renderTextureSRV.get());
+
+        // off the app thread, a suspend may be detaching the player
+        playbackSession = m_mediaPlaybackSession;
+    }
+
+    state.type = CallbackType::VideoPlayer;
+
+    ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
+    state.value.playbackState.width = static_cast<int32_t>(width);
+    state.value.playbackState.height = static_cast<int32_t>(height);
+    state.value.playbackState.texturePtr = texturePtr;
+
+    try
+    {
+        if (playbackSession != nullptr)
+        {
+            state.value.playbackState.state = static_cast<MediaPlayerState>(playbackSession.PlaybackState());
+            state.value.playbackState.canSeek = static_cast<boolean>(playbackSession.CanSeek());
+            state.value.playbackState.duration = playbackSession.NaturalDuration().count();
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+
+    Callback(state);
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreatePlaybackList()
+{
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_playbackList = Windows::Media::Playback::MediaPlaybackList();
+        m_playbackList.MaxPrefetchTime(TimeSpan{ std::chrono::seconds(PLAYLIST_PREFETCH_SECONDS) });
+
+        m_currentItemChangedToken = m_playbackList.CurrentItemChanged([=](Windows::Media::Playback::MediaPlaybackList const& sender, Windows::Media::Playback::CurrentMediaPlaybackItemChangedEventArgs const& args)
+        {
+            UNREFERENCED_PARAMETER(sender);
+
+            // the first clip is reported by MediaOpened
+            if (args.OldItem() == nullptr || args.NewItem() == nullptr)
+            {
+                return;
+            }
+
+            // the tap only decodes the clip LoadContent opened, the player's audio is back for the next one
+            CloseAudioTap();
+
+            RaiseOpened(args.NewItem());
+        });
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::ReleasePlaybackList()
+{
+    DetachCueTracks();
+    CloseAudioTap();
+    ResetStats();
+
+    {
+        std::lock_guard<slim_mutex> guard(m_adaptiveMutex);
+
+        ++m_playlistGeneration;
+        m_adaptiveSources.clear();
+    }
+
+    com_ptr<StreamIngest> streamIngest = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_ingestMutex);
+
+        streamIngest = std::move(m_streamIngest);
+    }
+
+    // a pending request ends the stream, pushes after this fail
+    if (streamIngest != nullptr)
+    {
+        streamIngest->Close();
+    }
+
+    if (m_playbackList != nullptr)
+    {
+        m_playbackList.CurrentItemChanged(m_currentItemChangedToken);
+
+        m_playbackList = nullptr;
+    }
+}
+
+// throws, hls and dash go through a binder so the adaptive source is created when the list
+// opens the item and the order of the playlist is kept while it's created
+_Use_decl_annotations_
+Windows::Media::Core::MediaSource PlaybackManager::CreateMediaSource(
+    hstring const& contentLocation)
+{
+    auto uri = Windows::Foundation::Uri(contentLocation);
+
+    if (!IsAdaptiveContent(uri))
+    {
+        return Windows::Media::Core::MediaSource::CreateFromUri(uri);
+    }
+
+    auto binder = Windows::Media::Core::MediaBinder();
+    binder.Token(contentLocation);
+
+    auto weak = get_weak();
+    binder.Binding([weak](Windows::Media::Core::MediaBinder const& sender, Windows::Media::Core::MediaBindingEventArgs const& args)
+    {
+        UNREFERENCED_PARAMETER(sender);
+
+        auto strong = weak.get();
+        if (strong != nullptr)
+        {
+            strong->OnBinding(args);
+        }
+    });
+
+    return Windows::Media::Core::MediaSource::CreateFromMediaBinder(binder);
+}
+
+// the list is opening an adaptive item, it waits on the deferral until the source is set
+_Use_decl_annotations_
+void PlaybackManager::OnBinding(
+    Windows::Media::Core::MediaBindingEventArgs const& args)
+{
+    uint32_t generation = 0;
+    {
+        std::lock_guard<slim_mutex> guard(m_adaptiveMutex);
+
+        generation = m_playlistGeneration;
+    }
+
+    auto deferral = args.GetDeferral();
+
+    try
+    {
+        auto uri = Windows::Foundation::Uri(args.MediaBinder().Token());
+
+        auto weak = get_weak();
+        Windows::Media::Streaming::Adaptive::AdaptiveMediaSource::CreateFromUriAsync(uri).Completed([weak, args, deferral, generation](auto const& operation, AsyncStatus status)
+        {
+            auto strong = weak.get();
+
+            HRESULT hr = S_OK;
+
+            try
+            {
+                if (status != AsyncStatus::Completed)
+                {
+                    check_hresult(status == AsyncStatus::Error ? static_cast<HRESULT>(operation.ErrorCode()) : HRESULT_FROM_WIN32(ERROR_CANCELLED));
+                }
+
+                auto result = operation.GetResults();
+                if (result.Status() != Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceCreationStatus::Success)
+                {
+                    HRESULT extendedError = result.ExtendedError();
+                    check_hresult(FAILED(extendedError) ? extendedError : MF_E_UNSUPPORTED_FORMAT);
+                }
+
+                auto adaptiveSource = result.MediaSource();
+
+                if (strong != nullptr)
+                {
+                    {
+                        std::lock_guard<slim_mutex> guard(strong->m_adaptiveMutex);
+
+                        // the list this item belonged to was replaced
+                        if (generation == strong->m_playlistGeneration)
+                        {
+                            strong->m_adaptiveSources.push_back(adaptiveSource);
+                        }
+                    }
+
+                    strong->ApplyBitrateLimits(adaptiveSource);
+
+                    adaptiveSource.PlaybackBitrateChanged([weak](Windows::Media::Streaming::Adaptive::AdaptiveMediaSource const& sender, Windows::Media::Streaming::Adaptive::AdaptiveMediaSourcePlaybackBitrateChangedEventArgs const& bitrateArgs)
+                    {
+                        UNREFERENCED_PARAMETER(sender);
+
+                        auto player = weak.get();
+                        if (player == nullptr)
+                        {
+                            return;
+                        }
+
+                        if (!bitrateArgs.AudioOnly())
+                        {
+                            player->SetStatsBitrate(bitrateArgs.NewValue());
+                        }
+
+                        CALLBACK_STATE state{};
+                        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+                        state.type = CallbackType::BitrateChanged;
+
+                        ZeroMemory(&state.value.bitrateState, sizeof(BITRATE_STATE));
+                        state.value.bitrateState.oldBitrate = bitrateArgs.OldValue();
+                        state.value.bitrateState.newBitrate = bitrateArgs.NewValue();
+                        state.value.bitrateState.audioOnly = bitrateArgs.AudioOnly();
+
+                        player->Callback(state);
+                    });
+                }
+
+                args.SetAdaptiveMediaSource(adaptiveSource);
+            }
+            catch (hresult_error const& e)
+            {
+                hr = e.code();
+            }
+
+            // without a source the item fails to open and MediaFailed reports it as well
+            if (FAILED(hr) && strong != nullptr)
+            {
+                CALLBACK_STATE state{};
+                ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+                state.type = CallbackType::Failed;
+                state.value.failedState.hresult = hr;
+
+                strong->Callback(state);
+            }
+
+            deferral.Complete();
+        });
+    }
+    catch (hresult_error const&)
+    {
+        deferral.Complete();
+    }
+}
+
+_Use_decl_annotations_
+void PlaybackManager::ApplyBitrateLimits()
+{
+    std::vector<Windows::Media::Streaming::Adaptive::AdaptiveMediaSource> adaptiveSources;
+    {
+        std::lock_guard<slim_mutex> guard(m_adaptiveMutex);
+
+        adaptiveSources = m_adaptiveSources;
+    }
+
+    for (auto const& adaptiveSource : adaptiveSources)
+    {
+        ApplyBitrateLimits(adaptiveSource);
+    }
+}
+
+// snapped to the renditions the stream has, a cap below all of them keeps the lowest one
+_Use_decl_annotations_
+void PlaybackManager::ApplyBitrateLimits(
+    Windows::Media::Streaming::Adaptive::AdaptiveMediaSource const& adaptiveSource)
+{
+    uint32_t maxBitrate = m_maxBitrate;
+    if (maxBitrate == 0)
+    {
+        // paying for pixels the texture can't show is wasted bandwidth
+        maxBitrate = TextureBitrate();
+    }
+
+    try
+    {
+        auto bitrates = adaptiveSource.AvailableBitrates();
+        if (bitrates.Size() == 0)
+        {
+            return;
+        }
+
+        uint32_t minBitrate = m_minBitrate;
+        if (maxBitrate > 0)
+        {
+            maxBitrate = SnapBitrate(bitrates, maxBitrate);
+            minBitrate = minBitrate > maxBitrate ? maxBitrate : minBitrate;
+        }
+
+        adaptiveSource.DesiredMinBitrate(minBitrate > 0 ? IReference<uint32_t>(minBitrate) : nullptr);
+        adaptiveSource.DesiredMaxBitrate(maxBitrate > 0 ? IReference<uint32_t>(maxBitrate) : nullptr);
+
+        // the source starts on its own pick unless told otherwise, never above the cap
+        uint32_t initialBitrate = m_initialBitrate;
+        if (initialBitrate == 0)
+        {
+            initialBitrate = adaptiveSource.InitialBitrate();
+        }
+        if (maxBitrate > 0 && initialBitrate > maxBitrate)
+        {
+            initialBitrate = maxBitrate;
+        }
+        if (initialBitrate < minBitrate)
+        {
+            initialBitrate = minBitrate;
+        }
+
+        if (initialBitrate > 0)
+        {
+            adaptiveSource.InitialBitrate(SnapBitrate(bitrates, initialBitrate));
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+}
+
+// 0 without a texture, nothing to cap to yet
+_Use_decl_annotations_
+uint32_t PlaybackManager::TextureBitrate()
+{
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    if (m_renderTexture == nullptr)
+    {
+        return 0;
+    }
+
+    D3D11_TEXTURE2D_DESC desc{};
+    m_renderTexture->GetDesc(&desc);
+
+    uint64_t bitrate = static_cast<uint64_t>(desc.Width) * desc.Height * ADAPTIVE_BITS_PER_PIXEL_SECOND;
+
+    return bitrate > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(bitrate);
+}
+
+_Use_decl_annotations_
+DXGI_FORMAT PlaybackManager::GetDxgiFormat(
+    OutputFormat format)
+{
+    switch (format)
+    {
+    case OutputFormat::Rgb10A2:
+        return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case OutputFormat::Rgba16F:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    default:
+        return DXGI_FORMAT_B8G8R8A8_UNORM;
+    }
+}
+
+// from the media type of the selected video track, a stream without the attributes leaves them 0
+// the adaptive source's current rendition, else what the selected tracks declare
+_Use_decl_annotations_
+uint32_t PlaybackManager::GetTrackBitrate(
+    Windows::Media::Playback::MediaPlaybackItem const& item)
+{
+    if (item == nullptr)
+    {
+        return 0;
+    }
+
+    uint32_t bitrate = 0;
+
+    try
+    {
+        auto adaptiveSource = item.Source().AdaptiveMediaSource();
+        if (adaptiveSource != nullptr)
+        {
+            return adaptiveSource.CurrentPlaybackBitrate();
+        }
+
+        auto videoTracks = item.VideoTracks();
+        int32_t videoIndex = videoTracks.SelectedIndex();
+        if (videoIndex >= 0 && static_cast<uint32_t>(videoIndex) < videoTracks.Size())
+        {
+            bitrate += videoTracks.GetAt(static_cast<uint32_t>(videoIndex)).GetEncodingProperties().Bitrate();
+        }
+
+        auto audioTracks = item.AudioTracks();
+        int32_t audioIndex = audioTracks.SelectedIndex();
+        if (audioIndex >= 0 && static_cast<uint32_t>(audioIndex) < audioTracks.Size())
+        {
+            bitrate += audioTracks.GetAt(static_cast<uint32_t>(audioIndex)).GetEncodingProperties().Bitrate();
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+
+    return bitrate;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::GetColorInfo(
+    Windows::Media::Playback::MediaPlaybackItem const& item,
+    VIDEO_COLOR_INFO* pColorInfo)
+{
+    ZeroMemory(pColorInfo, sizeof(VIDEO_COLOR_INFO));
+
+    if (item == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        auto videoTracks = item.VideoTracks();
+
+        int32_t selectedIndex = videoTracks.SelectedIndex();
+        if (selectedIndex < 0 || static_cast<uint32_t>(selectedIndex) >= videoTracks.Size())
+        {
+            return;
+        }
+
+        auto properties = videoTracks.GetAt(static_cast<uint32_t>(selectedIndex)).GetEncodingProperties().Properties();
+
+        auto lookup = [&properties](guid const& key)
+        {
+            return properties.HasKey(key) ? unbox_value_or<uint32_t>(properties.Lookup(key), 0) : 0;
+        };
+
+        pColorInfo->primaries = lookup(MF_MT_VIDEO_PRIMARIES);
+        pColorInfo->transferFunction = lookup(MF_MT_TRANSFER_FUNCTION);
+        pColorInfo->nominalRange = lookup(MF_MT_VIDEO_NOMINAL_RANGE);
+        pColorInfo->maxMasteringLuminance = lookup(MF_MT_MAX_MASTERING_LUMINANCE);
+        pColorInfo->minMasteringLuminance = lookup(MF_MT_MIN_MASTERING_LUMINANCE);
+        pColorInfo->maxContentLightLevel = lookup(MF_MT_MAX_LUMINANCE_LEVEL);
+        pColorInfo->maxFrameAverageLightLevel = lookup(MF_MT_MAX_FRAME_AVERAGE_LUMINANCE_LEVEL);
+    }
+    catch (hresult_error const&)
+    {
+    }
+}
+
+// hls playlists and dash manifests, anything else opens as a plain source
+_Use_decl_annotations_
+bool PlaybackManager::IsAdaptiveContent(
+    Windows::Foundation::Uri const& uri)
+{
+    std::wstring path(uri.Path());
+
+    auto endsWith = [&path](wchar_t const* extension)
+    {
+        size_t length = wcslen(extension);
+
+        return path.size() >= length && _wcsicmp(path.c_str() + path.size() - length, extension) == 0;
+    };
+
+    return endsWith(L".m3u8") || endsWith(L".mpd");
+}
+
+// the highest rendition at or below the bitrate, or the lowest one
+_Use_decl_annotations_
+uint32_t PlaybackManager::SnapBitrate(
+    Windows::Foundation::Collections::IVectorView<uint32_t> const& bitrates,
+    uint32_t bitrate)
+{
+    uint32_t lowest = UINT32_MAX;
+    uint32_t snapped = 0;
+
+    for (auto const& available : bitrates)
+    {
+        lowest = available < lowest ? available : lowest;
+
+        if (available <= bitrate && available > snapped)
+        {
+            snapped = available;
+        }
+    }
+
+    return snapped > 0 ? snapped : lowest;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::Play()
+{
+    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+
+    // the group's timeline controller owns the clock
+    if (m_timelineController != nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    // stepped back through the frame cache, the decoder is still at the newest frame
+    int64_t cachedPosition = -1;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        if (m_frameCacheCursor >= 0)
+        {
+            cachedPosition = m_frameCache[(m_frameCacheHead + static_cast<uint32_t>(m_frameCacheCursor)) % m_frameCache.size()].presentationTime;
+        }
+    }
+
+    // the first frame is shown by the playing player anyway
+    m_prerollPending = false;
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        if (cachedPosition >= 0 && m_mediaPlaybackSession != nullptr)
+        {
+            m_mediaPlaybackSession.Position(TimeSpan{ cachedPosition });
+        }
+
+        m_mediaPlayer.Play();
+
+        auto audioTap = CurrentAudioTap();
+        if (audioTap != nullptr)
+        {
+            audioTap->Start(cachedPosition >= 0 ? cachedPosition : (m_mediaPlaybackSession != nullptr ? m_mediaPlaybackSession.Position().count() : 0));
+        }
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::Pause()
+{
+    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+
+    if (m_timelineController != nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_mediaPlayer.Pause();
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    auto audioTap = CurrentAudioTap();
+    if (audioTap != nullptr)
+    {
+        audioTap->Stop();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::Stop()
+{
+    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+
+    // the group's clock keeps running for the other players
+    if (m_timelineController != nullptr)
+    {
+        return S_OK;
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        // keeps the source and decoder, playing again doesn't reopen the content
+        m_mediaPlayer.Pause();
+
+        if (m_mediaPlaybackSession != nullptr)
+        {
+            m_mediaPlaybackSession.Position(TimeSpan{ 0 });
+        }
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    auto audioTap = CurrentAudioTap();
+    if (audioTap != nullptr)
+    {
+        audioTap->Stop();
+        audioTap->Seek(0);
+    }
+
+    return hr;
+}
+
+// keeps the playlist and the position, everything that decodes or holds a frame besides the
+// texture unity samples is released, which keeps showing the last frame
+_Use_decl_annotations_
+HRESULT PlaybackManager::Suspend()
+{
+    if (m_suspended)
+    {
+        return S_OK;
+    }
+
+    NULL_CHK_HR(m_mediaPlayer, MF_E_NOT_INITIALIZED);
+
+    // a grouped player follows the group's clock, a pushed stream can't be reopened
+    bool pushedStream = false;
+    {
+        std::lock_guard<slim_mutex> guard(m_ingestMutex);
+
+        pushedStream = m_streamIngest != nullptr;
+    }
+
+    if (m_timelineController != nullptr || pushedStream || m_playbackList == nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_resumeItem = m_playbackList.CurrentItem();
+        m_resumePosition = m_mediaPlaybackSession != nullptr ? m_mediaPlaybackSession.Position().count() : 0;
+
+        auto playbackState = m_mediaPlaybackSession != nullptr ? m_mediaPlaybackSession.PlaybackState() : Windows::Media::Playback::MediaPlaybackState::None;
+        m_resumePlaying = playbackState == Windows::Media::Playback::MediaPlaybackState::Playing
+            || playbackState == Windows::Media::Playback::MediaPlaybackState::Buffering
+            || playbackState == Windows::Media::Playback::MediaPlaybackState::Opening;
+
+        m_mediaPlayer.Pause();
+        m_mediaPlayer.Source(nullptr);
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    IFR(hr);
+
+    {
+        std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+        m_seekPending = false;
+        m_queuedSeekPosition = -1;
+    }
+
+    // the tap's graph keeps its source, it only stops producing
+    auto audioTap = CurrentAudioTap();
+    if (audioTap != nullptr)
+    {
+        audioTap->Stop();
+    }
+
+    // the decoder goes with the player
+    DetachMediaPlayer();
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_frameBuffers.clear();
+        m_latestBuffer = 0;
+        m_renderSequence = m_frameSequence;
+
+        for (auto const& kv : m_outputs)
+        {
+            kv.second->frameBuffers.clear();
+            kv.second->latestBuffer = 0;
+            kv.second->renderSequence = kv.second->frameSequence;
+        }
+
+        m_frameCache.clear();
+        m_frameCacheHead = 0;
+        m_frameCacheCount = 0;
+        m_frameCacheCursor = -1;
+        m_cachedFrameBuffer = nullptr;
+
+        m_resumeReadbackWidth = m_frameReadback != nullptr ? m_frameReadback->Width() : 0;
+        m_resumeReadbackHeight = m_frameReadback != nullptr ? m_frameReadback->Height() : 0;
+        m_frameReadback = nullptr;
+    }
+
+    // the last player on the adapter releases the media device
+    ReleaseMediaDevice();
+
+    m_suspended = true;
+
+    return S_OK;
+}
+
+// the buffers come back at the size of the texture unity holds, the clip reopens where it was
+_Use_decl_annotations_
+HRESULT PlaybackManager::Resume()
+{
+    if (!m_suspended)
+    {
+        return S_OK;
+    }
+
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, E_POINTER);
+
+    IFR(CreateResources(resources->GetDevice()));
+
+    D3D11_TEXTURE2D_DESC desc{};
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        NULL_CHK_HR(m_renderTexture, MF_E_NOT_INITIALIZED);
+
+        m_renderTexture->GetDesc(&desc);
+    }
+
+    std::vector<std::shared_ptr<SharedTextureBuffer>> frameBuffers;
+    IFR(CreateFrameBuffers(resources->GetDevice().get(), desc.Width, desc.Height, desc.Format, m_frameBufferCount, frameBuffers));
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_frameBuffers = std::move(frameBuffers);
+        m_latestBuffer = 0;
+        m_renderSequence = m_frameSequence;
+    }
+
+    IFR(CreateOutputBuffers(resources->GetDevice().get()));
+    IFR(CreateFrameCache());
+
+    if (m_resumeReadbackWidth > 0 && m_resumeReadbackHeight > 0)
+    {
+        IFR(SetReadback(true, m_resumeReadbackWidth, m_resumeReadbackHeight));
+    }
+
+    IFR(CreateMediaPlayer());
+
+    auto audioTap = CurrentAudioTap();
+    int64_t resumePosition = m_resumePosition;
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        // the position is applied once the item opened, see MediaOpened
+        m_mediaPlayer.AutoPlay(false);
+        m_mediaPlayer.IsMuted(audioTap != nullptr);
+
+        if (m_resumeItem != nullptr)
+        {
+            m_playbackList.StartingItem(m_resumeItem);
+        }
+
+        m_mediaPlayer.Source(m_playbackList);
+
+        if (m_resumePlaying)
+        {
+            m_mediaPlayer.Play();
+
+            if (audioTap != nullptr)
+            {
+                audioTap->Start(resumePosition > 0 ? resumePosition : 0);
+            }
+        }
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    m_resumeItem = nullptr;
+    m_suspended = false;
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::Seek(
+    int64_t position,
+    SeekMode mode)
+{
+    NULL_CHK_HR(m_mediaPlaybackSession, MF_E_NOT_INITIALIZED);
+
+    if (position < 0 || (mode != SeekMode::Accurate && mode != SeekMode::Keyframe))
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    // seek the group instead
+    if (m_timelineController != nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+        if (mode == SeekMode::Keyframe && m_seekPending)
+        {
+            // SeekCompleted picks up the newest position, the ones in between are never decoded
+            m_queuedSeekPosition = position;
+
+            return S_OK;
+        }
+
+        m_seekPending = true;
+        m_queuedSeekPosition = -1;
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_mediaPlaybackSession.Position(TimeSpan{ position });
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    if (FAILED(hr))
+    {
+        std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+        m_seekPending = false;
+    }
+    else
+    {
+        auto audioTap = CurrentAudioTap();
+        if (audioTap != nullptr)
+        {
+            audioTap->Seek(position);
+        }
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetPlaybackRate(
+    double rate)
+{
+    NULL_CHK_HR(m_mediaPlaybackSession, MF_E_NOT_INITIALIZED);
+
+    if (rate <= 0.0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    // the group's timeline controller sets the rate for every player
+    if (m_timelineController != nullptr)
+    {
+        IFR(E_ILLEGAL_METHOD_CALL);
+    }
+
+    HRESULT hr = S_OK;
+
+    try
+    {
+        m_mediaPlaybackSession.PlaybackRate(rate);
+    }
+    catch (hresult_error const & e)
+    {
+        hr = e.code();
+    }
+
+    auto audioTap = CurrentAudioTap();
+    if (SUCCEEDED(hr) && audioTap != nullptr)
+    {
+        audioTap->SetPlaybackRate(rate);
+    }
+
+    return hr;
+}
+
+// applies to the next CreatePlaybackTexture, more buffers keep a handed out frame around longer
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetFrameBufferCount(
+    uint32_t bufferCount)
+{
+    if (bufferCount < MIN_FRAME_BUFFERS || bufferCount > MAX_FRAME_BUFFERS)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    m_frameBufferCount = bufferCount;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::GetFrameInfo(
+    VIDEO_FRAME_INFO* pFrameInfo)
+{
+    NULL_CHK_HR(pFrameInfo, E_INVALIDARG);
+
+    std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+    *pFrameInfo = m_frameInfo;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreateMediaPlayer()
+{
+    if (m_mediaPlayer != nullptr)
+    {
+        ReleaseMediaPlayer();
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_mediaPlayer = Windows::Media::Playback::MediaPlayer();
+    }
+
+    if (m_timelineController != nullptr)
+    {
+        m_mediaPlayer.CommandManager().IsEnabled(false);
+        m_mediaPlayer.TimelineController(m_timelineController);
+    }
+
+    m_endedToken = m_mediaPlayer.MediaEnded([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(sender);
+        UNREFERENCED_PARAMETER(args);
+
+        CALLBACK_STATE state{};
+        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+        state.type = CallbackType::VideoPlayer;
+
+        ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
+        state.value.playbackState.state = MediaPlayerState::Ended;
+
+        Callback(state);
+    });
+
+    m_failedToken = m_mediaPlayer.MediaFailed([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Media::Playback::MediaPlayerFailedEventArgs const& args)
+    {
+        UNREFERENCED_PARAMETER(sender);
+        UNREFERENCED_PARAMETER(args);
+
+        CALLBACK_STATE state{};
+        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+        state.type = CallbackType::Failed;
+
+        ZeroMemory(&state.value.failedState, sizeof(FAILED_STATE));
+
+        state.value.failedState.hresult = args.ExtendedErrorCode();
+
+        Callback(state);
+    });
+
+    m_openedToken = m_mediaPlayer.MediaOpened([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(args);
+
+        // reopened by Resume
+        int64_t resumePosition = m_resumePosition.exchange(-1);
+        if (resumePosition > 0)
+        {
+            sender.PlaybackSession().Position(TimeSpan{ resumePosition });
+        }
+        else if (m_prerollPending)
+        {
+            // a paused player only decodes a frame for a seek
+            sender.PlaybackSession().Position(sender.PlaybackSession().Position());
+        }
+
+        auto playbackList = m_playbackList;
+        RaiseOpened(playbackList != nullptr ? playbackList.CurrentItem() : nullptr);
+    });
+
+    // set frameserver mode for video
+    m_mediaPlayer.IsVideoFrameServerEnabled(true);
+    m_videoFrameAvailableToken = m_mediaPlayer.VideoFrameAvailable([=](Windows::Media::Playback::MediaPlayer const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(sender);
+        UNREFERENCED_PARAMETER(args);
+
+        RecordDecodedFrame();
+
+        // the render event picks the frame up, the one it flagged before is never copied
+        if (m_renderDriven)
+        {
+            if (m_videoFrameAvailable.exchange(true))
+            {
+                RecordDroppedFrame();
+            }
+
+            return;
+        }
+
+        PublishVideoFrame();
+    });
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        m_mediaPlaybackSession = m_mediaPlayer.PlaybackSession();
+    }
+
+    m_seekCompletedEventToken = m_mediaPlaybackSession.SeekCompleted([=](Windows::Media::Playback::MediaPlaybackSession const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(args);
+
+        int64_t position = -1;
+        {
+            std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+            position = m_queuedSeekPosition;
+            m_queuedSeekPosition = -1;
+            m_seekPending = (position >= 0);
+        }
+
+        if (position >= 0)
+        {
+            try
+            {
+                sender.Position(TimeSpan{ position });
+            }
+            catch (hresult_error const&)
+            {
+                std::lock_guard<slim_mutex> guard(m_seekMutex);
+
+                m_seekPending = false;
+            }
+        }
+    });
+    m_bufferingProgressEventToken = m_mediaPlaybackSession.BufferingProgressChanged([=](Windows::Media::Playback::MediaPlaybackSession const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(args);
+
+        double bufferingProgress = sender.BufferingProgress();
+
+        std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+        m_stats.bufferingProgress = bufferingProgress;
+    });
+    m_downloadProgressEventToken = m_mediaPlaybackSession.DownloadProgressChanged([=](Windows::Media::Playback::MediaPlaybackSession const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(args);
+
+        double downloadProgress = sender.DownloadProgress();
+
+        std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+        m_stats.downloadProgress = downloadProgress;
+    });
+    m_stateChangedEventToken = m_mediaPlaybackSession.PlaybackStateChanged([=](Windows::Media::Playback::MediaPlaybackSession const& sender, Windows::Foundation::IInspectable const& args)
+    {
+        UNREFERENCED_PARAMETER(sender);
+        UNREFERENCED_PARAMETER(args);
+
+        if (nullptr == m_mediaPlaybackSession)
+        {
+            return;
+        }
+
+        CALLBACK_STATE state{};
+        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+        state.type = CallbackType::VideoPlayer;
+
+        ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
+        state.value.playbackState.state = static_cast<MediaPlayerState>(m_mediaPlaybackSession.PlaybackState());
+
+        state.value.playbackState.width = static_cast<int32_t>(m_mediaPlaybackSession.NaturalVideoWidth());
+        state.value.playbackState.height = static_cast<int32_t>(m_mediaPlaybackSession.NaturalVideoHeight());
+        state.value.playbackState.canSeek = static_cast<boolean>(m_mediaPlaybackSession.CanSeek());
+        state.value.playbackState.duration = m_mediaPlaybackSession.NaturalDuration().count();
+
+        Callback(state);
+    });
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::ReleaseMediaPlayer()
+{
+    ReleasePlaybackList();
+
+    DetachMediaPlayer();
+}
+
+// the player and its events, the playlist stays. no new frame is raised once VideoFrameAvailable
+// is revoked, one being published holds its own copy of the player until its copies are done
+_Use_decl_annotations_
+void PlaybackManager::DetachMediaPlayer()
+{
+    if (m_mediaPlayer != nullptr)
+    {
+        m_mediaPlayer.VideoFrameAvailable(m_videoFrameAvailableToken);
+    }
+
+    // a frame flagged for the render event belonged to this player
+    m_videoFrameAvailable = false;
+
+    Windows::Media::Playback::MediaPlayer mediaPlayer = nullptr;
+    Windows::Media::Playback::MediaPlaybackSession mediaPlaybackSession = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        mediaPlayer = std::move(m_mediaPlayer);
+        mediaPlaybackSession = std::move(m_mediaPlaybackSession);
+
+        m_mediaPlayer = nullptr;
+        m_mediaPlaybackSession = nullptr;
+    }
+
+    if (mediaPlaybackSession != nullptr)
+    {
+        mediaPlaybackSession.PlaybackStateChanged(m_stateChangedEventToken);
+        mediaPlaybackSession.SeekCompleted(m_seekCompletedEventToken);
+        mediaPlaybackSession.BufferingProgressChanged(m_bufferingProgressEventToken);
+        mediaPlaybackSession.DownloadProgressChanged(m_downloadProgressEventToken);
+    }
+
+    if (mediaPlayer != nullptr)
+    {
+        mediaPlayer.MediaEnded(m_endedToken);
+        mediaPlayer.MediaFailed(m_failedToken);
+        mediaPlayer.MediaOpened(m_openedToken);
+    }
+}
+
+// a clip opened, the first one or the next one in the playlist
+_Use_decl_annotations_
+void PlaybackManager::RaiseOpened(
+    Windows::Media::Playback::MediaPlaybackItem const& item)
+{
+    if (nullptr == m_mediaPlaybackSession)
+    {
+        return;
+    }
+
+    uint32_t naturalWidth = m_mediaPlaybackSession.NaturalVideoWidth();
+    uint32_t naturalHeight = m_mediaPlaybackSession.NaturalVideoHeight();
+
+    void* texturePtr = nullptr;
+    if (m_autoTextureSize && naturalWidth > 0 && naturalHeight > 0)
+    {
+        HRESULT hr = ResizePlaybackTexture(naturalWidth, naturalHeight);
+        if (FAILED(hr))
+        {
+            CALLBACK_STATE failedState{};
+            ZeroMemory(&failedState, sizeof(CALLBACK_STATE));
+
+            failedState.type = CallbackType::Failed;
+            failedState.value.failedState.hresult = hr;
+
+            Callback(failedState);
+        }
+
+        // the previous texture is still in use when resizing failed
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        texturePtr = GetUnityTexture(m_renderTextureSRV.get());
+    }
+
+    // the cues of the new clip, the first one enters after Opened
+    AttachCueTracks(item);
+
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::VideoPlayer;
+
+    ZeroMemory(&state.value.playbackState, sizeof(PLAYBACK_STATE));
+    state.value.playbackState.state = MediaPlayerState::Opened;
+    state.value.playbackState.width = static_cast<int32_t>(naturalWidth);
+    state.value.playbackState.height = static_cast<int32_t>(naturalHeight);
+    state.value.playbackState.canSeek = static_cast<boolean>(m_mediaPlaybackSession.CanSeek());
+    state.value.playbackState.duration = m_mediaPlaybackSession.NaturalDuration().count();
+    state.value.playbackState.texturePtr = texturePtr;
+
+    GetColorInfo(item, &state.value.playbackState.colorInfo);
+
+    SetStatsBitrate(GetTrackBitrate(item));
+
+    Callback(state);
+}
+
+// the player leaves caption tracks alone in frame server mode, with the presentation mode set
+// to application presented their cues are raised while they are current
+_Use_decl_annotations_
+void PlaybackManager::AttachCueTracks(
+    Windows::Media::Playback::MediaPlaybackItem const& item)
+{
+    DetachCueTracks();
+
+    if (item == nullptr)
+    {
+        return;
+    }
+
+    std::vector<CueTrack> cueTracks;
+
+    try
+    {
+        auto weak = get_weak();
+
+        auto tracks = item.TimedMetadataTracks();
+        for (uint32_t i = 0; i < tracks.Size(); ++i)
+        {
+            auto track = tracks.GetAt(i);
+
+            auto kind = track.TimedMetadataKind();
+            if (kind != Windows::Media::Core::TimedMetadataKind::Subtitle && kind != Windows::Media::Core::TimedMetadataKind::Caption)
+            {
+                continue;
+            }
+
+            tracks.SetPresentationMode(i, Windows::Media::Playback::TimedMetadataTrackPresentationMode::ApplicationPresented);
+
+            CueTrack cueTrack{ track, {}, {} };
+
+            cueTrack.cueEnteredToken = track.CueEntered([weak](Windows::Media::Core::TimedMetadataTrack const& sender, Windows::Media::Core::MediaCueEventArgs const& args)
+            {
+                UNREFERENCED_PARAMETER(sender);
+
+                auto strong = weak.get();
+                if (strong != nullptr)
+                {
+                    strong->OnCueEntered(args.Cue());
+                }
+            });
+
+            cueTrack.cueExitedToken = track.CueExited([weak](Windows::Media::Core::TimedMetadataTrack const& sender, Windows::Media::Core::MediaCueEventArgs const& args)
+            {
+                UNREFERENCED_PARAMETER(sender);
+
+                auto strong = weak.get();
+                if (strong != nullptr)
+                {
+                    strong->OnCueExited(args.Cue());
+                }
+            });
+
+            cueTracks.push_back(cueTrack);
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+
+    std::lock_guard<slim_mutex> guard(m_cueMutex);
+
+    m_cueTracks = std::move(cueTracks);
+}
+
+// the cues still active are reported as exited
+_Use_decl_annotations_
+void PlaybackManager::DetachCueTracks()
+{
+    std::vector<CueTrack> cueTracks;
+    std::vector<ActiveCue> activeCues;
+    {
+        std::lock_guard<slim_mutex> guard(m_cueMutex);
+
+        cueTracks = std::move(m_cueTracks);
+        activeCues = std::move(m_activeCues);
+
+        m_cueTracks.clear();
+        m_activeCues.clear();
+
+        for (auto const& activeCue : activeCues)
+        {
+            if (m_captionAtlas != nullptr)
+            {
+                m_captionAtlas->Remove(activeCue.atlasRow);
+            }
+        }
+    }
+
+    for (auto const& cueTrack : cueTracks)
+    {
+        try
+        {
+            cueTrack.track.CueEntered(cueTrack.cueEnteredToken);
+            cueTrack.track.CueExited(cueTrack.cueExitedToken);
+        }
+        catch (hresult_error const&)
+        {
+        }
+    }
+
+    for (auto const& activeCue : activeCues)
+    {
+        CALLBACK_STATE state{};
+        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+        state.type = CallbackType::CueExited;
+        state.value.cueState.cueId = activeCue.cueId;
+        state.value.cueState.atlasRow = activeCue.atlasRow;
+
+        Callback(state);
+    }
+}
+
+// media foundation thread, only text cues are raised
+_Use_decl_annotations_
+void PlaybackManager::OnCueEntered(
+    Windows::Media::Core::IMediaCue const& cue)
+{
+    auto textCue = cue.try_as<Windows::Media::Core::TimedTextCue>();
+    if (textCue == nullptr)
+    {
+        return;
+    }
+
+    std::wstring text;
+    int64_t startTime = 0;
+    int64_t duration = 0;
+
+    try
+    {
+        for (auto const& line : textCue.Lines())
+        {
+            if (!text.empty())
+            {
+                text += L'\n';
+            }
+
+            text += line.Text();
+        }
+
+        startTime = cue.StartTime().count();
+        duration = cue.Duration().count();
+    }
+    catch (hresult_error const&)
+    {
+        return;
+    }
+
+    uint32_t cueId = 0;
+    int32_t atlasRow = -1;
+    {
+        std::lock_guard<slim_mutex> guard(m_cueMutex);
+
+        cueId = m_nextCueId++;
+
+        if (m_captionAtlas != nullptr)
+        {
+            atlasRow = m_captionAtlas->Add(hstring(text));
+        }
+
+        m_activeCues.push_back({ cue, cueId, atlasRow });
+    }
+
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::CueEntered;
+    state.value.cueState.text = text.c_str();
+    state.value.cueState.cueId = cueId;
+    state.value.cueState.startTime = startTime;
+    state.value.cueState.duration = duration;
+    state.value.cueState.atlasRow = atlasRow;
+
+    Callback(state);
+}
+
+_Use_decl_annotations_
+void PlaybackManager::OnCueExited(
+    Windows::Media::Core::IMediaCue const& cue)
+{
+    ActiveCue activeCue{ nullptr, 0, -1 };
+    {
+        std::lock_guard<slim_mutex> guard(m_cueMutex);
+
+        auto it = std::find_if(m_activeCues.begin(), m_activeCues.end(), [&cue](ActiveCue const& active)
+        {
+            return active.cue == cue;
+        });
+
+        if (it == m_activeCues.end())
+        {
+            return;
+        }
+
+        activeCue = *it;
+
+        m_activeCues.erase(it);
+
+        if (m_captionAtlas != nullptr)
+        {
+            m_captionAtlas->Remove(activeCue.atlasRow);
+        }
+    }
+
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::CueExited;
+    state.value.cueState.cueId = activeCue.cueId;
+    state.value.cueState.startTime = cue.StartTime().count();
+    state.value.cueState.duration = cue.Duration().count();
+    state.value.cueState.atlasRow = activeCue.atlasRow;
+
+    Callback(state);
+}
+
+// the texture is CAPTION_ATLAS_ROWS rows of CAPTION_ATLAS_ROW_HEIGHT, cues that are already
+// active when it's created aren't drawn into it
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetCaptionAtlas(
+    bool enable,
+    void** ppvTexture)
+{
+    NULL_CHK_HR(ppvTexture, E_INVALIDARG);
+
+    *ppvTexture = nullptr;
+
+    com_ptr<CaptionAtlas> captionAtlas = nullptr;
+    if (enable)
+    {
+        auto resources = m_d3d11DeviceResources.lock();
+        NULL_CHK_HR(resources, E_POINTER);
+
+        IFR(CreateResources(resources->GetDevice()));
+
+        IFR(CaptionAtlas::Create(resources->GetDevice().get(), m_dxgiDeviceManager.get(), captionAtlas));
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_cueMutex);
+
+        m_captionAtlas = captionAtlas;
+
+        // the rows belonged to the old atlas
+        for (auto& activeCue : m_activeCues)
+        {
+            activeCue.atlasRow = -1;
+        }
+    }
+
+    // the caller owns a reference, like CreatePlaybackTexture
+    if (captionAtlas != nullptr)
+    {
+        *ppvTexture = AddRefUnityTexture(captionAtlas->TextureSRV());
+    }
+
+    return S_OK;
+}
+
+// applies from the next LoadContent, turning it off gives the open clip its audio back right away
+_Use_decl_annotations_
+HRESULT PlaybackManager::SetAudioTap(
+    bool enable,
+    uint32_t milliseconds)
+{
+    if (enable && (milliseconds < 1 || milliseconds > MAX_AUDIO_BUFFER_MS))
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_audioMutex);
+
+        m_audioTapMilliseconds = enable ? milliseconds : 0;
+    }
+
+    if (!enable)
+    {
+        CloseAudioTap();
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::GetAudioFormat(
+    uint32_t* sampleRate,
+    uint32_t* channelCount)
+{
+    NULL_CHK_HR(sampleRate, E_INVALIDARG);
+    NULL_CHK_HR(channelCount, E_INVALIDARG);
+
+    *sampleRate = 0;
+    *channelCount = 0;
+
+    auto audioTap = CurrentAudioTap();
+    NULL_CHK_HR(audioTap, MF_E_NOT_INITIALIZED);
+
+    return audioTap->GetFormat(sampleRate, channelCount);
+}
+
+// unity's audio thread, never waits on the graph, fewer samples than asked for are silence
+_Use_decl_annotations_
+HRESULT PlaybackManager::ReadAudio(
+    float* samples,
+    uint32_t count,
+    uint32_t* samplesRead,
+    int64_t* timestamp)
+{
+    NULL_CHK_HR(samples, E_INVALIDARG);
+    NULL_CHK_HR(samplesRead, E_INVALIDARG);
+    NULL_CHK_HR(timestamp, E_INVALIDARG);
+
+    *samplesRead = 0;
+    *timestamp = 0;
+
+    auto audioTap = CurrentAudioTap();
+    NULL_CHK_HR(audioTap, MF_E_NOT_INITIALIZED);
+
+    *samplesRead = audioTap->Read(samples, count, timestamp);
+
+    return S_OK;
+}
+
+// adaptive clips go through a binder the graph can't open, those keep the player's audio
+_Use_decl_annotations_
+void PlaybackManager::OpenAudioTap(
+    hstring const& contentLocation)
+{
+    uint32_t milliseconds = 0;
+    {
+        std::lock_guard<slim_mutex> guard(m_audioMutex);
+
+        milliseconds = m_audioTapMilliseconds;
+    }
+
+    if (milliseconds == 0)
+    {
+        return;
+    }
+
+    auto uri = Windows::Foundation::Uri(contentLocation);
+    if (IsAdaptiveContent(uri))
+    {
+        return;
+    }
+
+    com_ptr<AudioTap> audioTap = nullptr;
+    if (FAILED(AudioTap::Create(milliseconds, audioTap)))
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_audioMutex);
+
+        m_audioTap = audioTap;
+    }
+
+    // quiet from the start, the tap's audio follows once its graph runs
+    m_mediaPlayer.IsMuted(true);
+
+    auto weak = get_weak();
+    audioTap->OpenAsync(Windows::Media::Core::MediaSource::CreateFromUri(uri)).Completed([weak, audioTap](IAsyncAction const& sender, AsyncStatus status)
+    {
+        auto strong = weak.get();
+        if (strong == nullptr || status == AsyncStatus::Completed)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<slim_mutex> guard(strong->m_audioMutex);
+
+            // replaced or closed while it opened
+            if (strong->m_audioTap != audioTap)
+            {
+                return;
+            }
+        }
+
+        HRESULT hr = static_cast<HRESULT>(sender.ErrorCode());
+
+        strong->CloseAudioTap();
+
+        CALLBACK_STATE state{};
+        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+        state.type = CallbackType::Failed;
+        state.value.failedState.hresult = FAILED(hr) ? hr : E_ABORT;
+
+        strong->Callback(state);
+    });
+}
+
+_Use_decl_annotations_
+void PlaybackManager::CloseAudioTap()
+{
+    com_ptr<AudioTap> audioTap = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_audioMutex);
+
+        audioTap = std::move(m_audioTap);
+    }
+
+    if (audioTap == nullptr)
+    {
+        return;
+    }
+
+    audioTap->Close();
+
+    try
+    {
+        auto mediaPlayer = m_mediaPlayer;
+        if (mediaPlayer != nullptr)
+        {
+            mediaPlayer.IsMuted(false);
+        }
+    }
+    catch (hresult_error const&)
+    {
+    }
+}
+
+_Use_decl_annotations_
+com_ptr<AudioTap> PlaybackManager::CurrentAudioTap()
+{
+    std::lock_guard<slim_mutex> guard(m_audioMutex);
+
+    return m_audioTap;
+}
+
+// a copy of what the player thread keeps up to date, polling every frame costs a lock
+_Use_decl_annotations_
+HRESULT PlaybackManager::GetStats(
+    PLAYBACK_STATS* pStats)
+{
+    NULL_CHK_HR(pStats, E_INVALIDARG);
+
+    LONGLONG now = QueryPerformanceTime();
+    LONGLONG ticksPerSecond = QueryPerformanceTicksPerSecond();
+
+    std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+    *pStats = m_stats;
+
+    // paused or stalled, the averages describe frames that are long gone
+    if (m_lastDecodedTime != 0 && now - m_lastDecodedTime < ticksPerSecond && m_decodedInterval > 0.0f)
+    {
+        pStats->decodedFramesPerSecond = static_cast<float>(ticksPerSecond) / m_decodedInterval;
+    }
+
+    bool copying = m_lastCopiedTime != 0 && now - m_lastCopiedTime < ticksPerSecond;
+    if (copying && m_copiedInterval > 0.0f)
+    {
+        pStats->copiedFramesPerSecond = static_cast<float>(ticksPerSecond) / m_copiedInterval;
+    }
+
+    if (!copying)
+    {
+        pStats->averageCopyMilliseconds = 0.0f;
+    }
+
+    // the copies since the content was loaded, at most the last STATS_HISTORY_FRAMES
+    uint32_t frameCount = static_cast<uint32_t>(std::min<uint64_t>(m_stats.framesCopied, STATS_HISTORY_FRAMES));
+    if (frameCount > 0)
+    {
+        std::array<float, STATS_HISTORY_FRAMES> values;
+        auto begin = values.begin();
+        auto end = std::copy_n(m_copyHistory.begin(), frameCount, begin);
+
+        auto p50 = begin + (frameCount - 1) * 50 / 100;
+        std::nth_element(begin, p50, end);
+
+        // the upper part is still unordered after the first pass
+        auto p99 = begin + (frameCount - 1) * 99 / 100;
+        std::nth_element(p50, p99, end);
+
+        pStats->copyHistoryFrames = frameCount;
+        pStats->p50CopyMilliseconds = *p50;
+        pStats->p99CopyMilliseconds = *p99;
+    }
+
+    return S_OK;
+}
+
+// new content, the buffering and download progress start over with it
+_Use_decl_annotations_
+void PlaybackManager::ResetStats()
+{
+    std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+    ZeroMemory(&m_stats, sizeof(PLAYBACK_STATS));
+
+    m_lastDecodedTime = 0;
+    m_lastCopiedTime = 0;
+    m_decodedInterval = 0.0f;
+    m_copiedInterval = 0.0f;
+}
+
+// player thread
+_Use_decl_annotations_
+void PlaybackManager::RecordDecodedFrame()
+{
+    LONGLONG now = QueryPerformanceTime();
+
+    std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+    ++m_stats.framesDecoded;
+
+    // a gap of a second or more is a pause or a seek, not the frame rate
+    if (m_lastDecodedTime != 0 && now - m_lastDecodedTime < QueryPerformanceTicksPerSecond())
+    {
+        float interval = static_cast<float>(now - m_lastDecodedTime);
+        m_decodedInterval = m_decodedInterval > 0.0f ? m_decodedInterval + (interval - m_decodedInterval) / STATS_AVERAGE_FRAMES : interval;
+    }
+
+    m_lastDecodedTime = now;
+}
+
+// player thread or the render thread when render driven
+_Use_decl_annotations_
+void PlaybackManager::RecordCopiedFrame(
+    LONGLONG copyTicks)
+{
+    LONGLONG now = QueryPerformanceTime();
+    float copyMilliseconds = static_cast<float>(copyTicks) * 1000.0f / static_cast<float>(QueryPerformanceTicksPerSecond());
+
+    std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+    m_copyHistory[m_stats.framesCopied % STATS_HISTORY_FRAMES] = copyMilliseconds;
+
+    ++m_stats.framesCopied;
+
+    m_stats.averageCopyMilliseconds = m_stats.framesCopied > 1 ? m_stats.averageCopyMilliseconds + (copyMilliseconds - m_stats.averageCopyMilliseconds) / STATS_AVERAGE_FRAMES : copyMilliseconds;
+    m_stats.maxCopyMilliseconds = copyMilliseconds > m_stats.maxCopyMilliseconds ? copyMilliseconds : m_stats.maxCopyMilliseconds;
+
+    if (m_lastCopiedTime != 0 && now - m_lastCopiedTime < QueryPerformanceTicksPerSecond())
+    {
+        float interval = static_cast<float>(now - m_lastCopiedTime);
+        m_copiedInterval = m_copiedInterval > 0.0f ? m_copiedInterval + (interval - m_copiedInterval) / STATS_AVERAGE_FRAMES : interval;
+    }
+
+    m_lastCopiedTime = now;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::RecordDroppedFrame()
+{
+    std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+    ++m_stats.framesDropped;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::SetStatsBitrate(
+    uint32_t bitrate)
+{
+    std::lock_guard<slim_mutex> guard(m_statsMutex);
+
+    m_stats.bitrate = bitrate;
+}
+
+// player thread or the render thread when render driven, fills the buffer the render thread
+// isn't going to read next
+_Use_decl_annotations_
+void PlaybackManager::PublishVideoFrame()
+{
+    struct OutputWrite
+    {
+        std::shared_ptr<PlaybackOutput> output;
+        uint32_t writeBuffer;
+        std::shared_ptr<SharedTextureBuffer> frameBuffer;
+    };
+
+    uint32_t writeBuffer = 0;
+    std::shared_ptr<SharedTextureBuffer> frameBuffer = nullptr;
+    std::vector<OutputWrite> outputWrites;
+    com_ptr<FrameReadback> frameReadback = nullptr;
+    uint32_t cacheSlot = 0;
+    std::shared_ptr<SharedTextureBuffer> cacheBuffer = nullptr;
+    Windows::Media::Playback::MediaPlayer mediaPlayer = nullptr;
+    Windows::Media::Playback::MediaPlaybackSession playbackSession = nullptr;
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        // detached by a suspend or a release, the frame went with it
+        if (m_mediaPlayer == nullptr)
+        {
+            return;
+        }
+
+        mediaPlayer = m_mediaPlayer;
+        playbackSession = m_mediaPlaybackSession;
+
+        // no texture yet or suspended
+        if (m_frameBuffers.empty())
+        {
+            RecordDroppedFrame();
+
+            return;
+        }
+
+        frameReadback = m_frameReadback;
+
+        // the slot after the newest, the oldest once the cache is full
+        if (!m_frameCache.empty())
+        {
+            cacheSlot = (m_frameCacheHead + m_frameCacheCount) % static_cast<uint32_t>(m_frameCache.size());
+            cacheBuffer = m_frameCache[cacheSlot].frameBuffer;
+        }
+
+        // the oldest buffer, the newest stays with the render thread
+        writeBuffer = (m_latestBuffer + 1) % static_cast<uint32_t>(m_frameBuffers.size());
+        frameBuffer = m_frameBuffers[writeBuffer];
+
+        for (auto const& kv : m_outputs)
+        {
+            auto const& output = kv.second;
+            if (output->frameBuffers.empty())
+            {
+                continue;
+            }
+
+            uint32_t outputBuffer = (output->latestBuffer + 1) % static_cast<uint32_t>(output->frameBuffers.size());
+
+            outputWrites.push_back({ output, outputBuffer, output->frameBuffers[outputBuffer] });
+        }
+    }
+
+    if (frameBuffer == nullptr || nullptr == frameBuffer->mediaSurface)
+    {
+        RecordDroppedFrame();
+
+        return;
+    }
+
+    // the position still belongs to the frame that raised VideoFrameAvailable
+    TimeSpan position = playbackSession != nullptr ? playbackSession.Position() : TimeSpan{};
+    double playbackRate = playbackSession != nullptr ? playbackSession.PlaybackRate() : 0.0;
+
+    LONGLONG copyStartTime = QueryPerformanceTime();
+
+    {
+        PLUGIN_TRACE_SCOPE("PlaybackManager.CopyFrameToVideoSurface", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+        mediaPlayer.CopyFrameToVideoSurface(frameBuffer->mediaSurface);
+
+        // the decoded frame is kept by the player, every copy only runs the video processor
+        for (auto const& outputWrite : outputWrites)
+        {
+            if (outputWrite.frameBuffer != nullptr && outputWrite.frameBuffer->mediaSurface != nullptr)
+            {
+                mediaPlayer.CopyFrameToVideoSurface(outputWrite.frameBuffer->mediaSurface);
+            }
+        }
+
+        if (cacheBuffer != nullptr && cacheBuffer->mediaSurface != nullptr)
+        {
+            mediaPlayer.CopyFrameToVideoSurface(cacheBuffer->mediaSurface);
+        }
+    }
+
+    LONGLONG systemTime = QueryPerformanceTime();
+    LONGLONG copyTicks = systemTime - copyStartTime;
+
+    if (frameReadback != nullptr)
+    {
+        // the frames copied before this one are done by now, then this one goes into the ring
+        frameReadback->Deliver([this](READBACK_FRAME_STATE const& readbackFrameState)
+        {
+            CALLBACK_STATE state{};
+            ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+            state.type = CallbackType::ReadbackFrame;
+            state.value.readbackFrameState = readbackFrameState;
+
+            Callback(state);
+        });
+
+        HRESULT hr = frameReadback->Capture(mediaPlayer, position.count());
+        if (FAILED(hr))
+        {
+            CALLBACK_STATE state{};
+            ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+            state.type = CallbackType::Failed;
+            state.value.failedState.hresult = hr;
+
+            Callback(state);
+        }
+    }
+
+    {
+        std::lock_guard<slim_mutex> guard(m_frameMutex);
+
+        // the buffers were replaced while copying
+        if (writeBuffer >= m_frameBuffers.size() || m_frameBuffers[writeBuffer] != frameBuffer)
+        {
+            RecordDroppedFrame();
+
+            return;
+        }
+
+        m_latestBuffer = writeBuffer;
+        ++m_frameSequence;
+
+        // a decoded frame ends stepping through the cache
+        m_frameCacheCursor = -1;
+        m_cachedFrameBuffer = nullptr;
+
+        if (cacheBuffer != nullptr && cacheSlot < m_frameCache.size() && m_frameCache[cacheSlot].frameBuffer == cacheBuffer)
+        {
+            uint32_t cacheSize = static_cast<uint32_t>(m_frameCache.size());
+
+            // a seek or new content, the cached frames are no longer next to this one
+            uint32_t newestSlot = (m_frameCacheHead + m_frameCacheCount + cacheSize - 1) % cacheSize;
+            if (m_frameCacheCount > 0 && position.count() <= m_frameCache[newestSlot].presentationTime)
+            {
+                m_frameCacheHead = cacheSlot;
+                m_frameCacheCount = 0;
+            }
+
+            m_frameCache[cacheSlot].presentationTime = position.count();
+
+            if (m_frameCacheCount < cacheSize)
+            {
+                ++m_frameCacheCount;
+            }
+            else
+            {
+                m_frameCacheHead = (m_frameCacheHead + 1) % cacheSize;
+            }
+        }
+
+        // an output that was removed or got new buffers while copying is left alone
+        for (auto const& outputWrite : outputWrites)
+        {
+            auto const& output = outputWrite.output;
+            if (outputWrite.writeBuffer < output->frameBuffers.size() && output->frameBuffers[outputWrite.writeBuffer] == outputWrite.frameBuffer)
+            {
+                output->latestBuffer = outputWrite.writeBuffer;
+                ++output->frameSequence;
+            }
+        }
+
+        ++m_frameInfo.frameCount;
+        m_frameInfo.presentationTime = position.count();
+        m_frameInfo.systemTime = systemTime;
+        m_frameInfo.playbackRate = playbackRate;
+    }
+
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::VideoFrame;
+
+    ZeroMemory(&state.value.videoFrameState, sizeof(VIDEO_FRAME_STATE));
+    state.value.videoFrameState.texturePtr = GetUnityTexture(frameBuffer->frameTextureSRV.get());
+    state.value.videoFrameState.bufferIndex = writeBuffer;
+    state.value.videoFrameState.presentationTime = position.count();
+    state.value.videoFrameState.systemTime = systemTime;
+
+    RecordCopiedFrame(copyTicks);
+
+    Callback(state);
+
+    if (m_prerollPending.exchange(false))
+    {
+        CALLBACK_STATE prerolledState{};
+        ZeroMemory(&prerolledState, sizeof(CALLBACK_STATE));
+
+        prerolledState.type = CallbackType::VideoPlayer;
+
+        ZeroMemory(&prerolledState.value.playbackState, sizeof(PLAYBACK_STATE));
+        prerolledState.value.playbackState.state = MediaPlayerState::Prerolled;
+
+        Callback(prerolledState);
+    }
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreateFrameBuffers(
+    ID3D11Device* unityDevice,
+    uint32_t width,
+    uint32_t height,
+    DXGI_FORMAT format,
+    uint32_t bufferCount,
+    std::vector<std::shared_ptr<SharedTextureBuffer>>& frameBuffers)
+{
+    frameBuffers.clear();
+
+    std::vector<std::shared_ptr<SharedTextureBuffer>> buffers(bufferCount);
+    for (auto& frameBuffer : buffers)
+    {
+        IFR(SharedTextureBuffer::Acquire(unityDevice, m_dxgiDeviceManager.get(), width, height, format, frameBuffer));
+    }
+
+    frameBuffers = std::move(buffers);
+
+    return S_OK;
+}
+
+// not shared, only unity's device reads it, the media surface stays a single mip since the
+// player can only write a texture with one subresource
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreateRenderTexture(
+    ID3D11Device* unityDevice,
+    D3D11_TEXTURE2D_DESC const& frameTextureDesc,
+    bool mipmaps,
+    com_ptr<ID3D11Texture2D>& renderTexture,
+    com_ptr<ID3D11ShaderResourceView>& renderTextureSRV)
+{
+    renderTexture = nullptr;
+    renderTextureSRV = nullptr;
+
+    auto renderTextureDesc = frameTextureDesc;
+    renderTextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    renderTextureDesc.MiscFlags = GetUnityTextureMiscFlags();
+
+    if (mipmaps)
+    {
+        // the whole chain down to 1x1, GenerateMips renders into it
+        renderTextureDesc.MipLevels = 0;
+        renderTextureDesc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+        renderTextureDesc.MiscFlags |= D3D11_RESOURCE_MISC_GENERATE_MIPS;
+    }
+
+    com_ptr<ID3D11Texture2D> texture = nullptr;
+    IFR(unityDevice->CreateTexture2D(&renderTextureDesc, nullptr, texture.put()));
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D);
+
+    com_ptr<ID3D11ShaderResourceView> srv = nullptr;
+    IFR(unityDevice->CreateShaderResourceView(texture.get(), &srvDesc, srv.put()));
+
+    renderTexture = texture;
+    renderTextureSRV = srv;
+
+    return S_OK;
+}
+
+// render thread, the frame lands in the top mip and the rest of the chain is filtered from it
+_Use_decl_annotations_
+void PlaybackManager::CopyToRenderTexture(
+    ID3D11DeviceContext* context,
+    ID3D11Texture2D* renderTexture,
+    ID3D11ShaderResourceView* renderTextureSRV,
+    ID3D11Texture2D* frameTexture)
+{
+    D3D11_TEXTURE2D_DESC desc{};
+    renderTexture->GetDesc(&desc);
+
+    if (desc.MipLevels <= 1)
+    {
+        context->CopyResource(renderTexture, frameTexture);
+
+        return;
+    }
+
+    context->CopySubresourceRegion(renderTexture, 0, 0, 0, 0, frameTexture, 0, nullptr);
+
+    PLUGIN_TRACE_SCOPE("PlaybackManager.GenerateMips", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    context->GenerateMips(renderTextureSRV);
+}
+
+_Use_decl_annotations_
+HRESULT PlaybackManager::CreateResources(com_ptr<ID3D11Device> const& unityDevice)
+{
+    if (m_d3dDevice != nullptr && !m_mediaDeviceLost)
+    {
+        return S_OK;
+    }
+
+    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+
+    // the removed device is no longer handed out, pick up its replacement
+    if (m_mediaDeviceLost && m_d3dDevice != nullptr)
+    {
+        SharedTextureBufferPool::Instance().Drop(m_d3dDevice.get());
+    }
+
+    ReleaseMediaDevice();
+    m_mediaDeviceLost = false;
+
+    auto sdxgiDevice = unityDevice.as<IDXGIDevice>();
+    NULL_CHK_HR(sdxgiDevice, E_POINTER);
+
+    com_ptr<IDXGIAdapter> dxgiAdapter = nullptr;
+    IFR(sdxgiDevice->GetAdapter(dxgiAdapter.put()));
+
+    // every player and capture on the adapter shares one media device and its dxgi device manager
+    com_ptr<SharedMediaDevice> sharedMediaDevice = nullptr;
+    IFR(SharedMediaDevice::Acquire(dxgiAdapter.get(), sharedMediaDevice));
+
+    m_sharedMediaDevice = sharedMediaDevice;
+    m_d3dDevice = sharedMediaDevice->Device();
+    m_dxgiDeviceManager = sharedMediaDevice->DeviceManager();
+
+    auto weak = get_weak();
+    m_deviceLostToken = m_sharedMediaDevice->DeviceLost([weak](HRESULT reason)
+    {
+        auto strong = weak.get();
+        if (strong != nullptr)
+        {
+            strong->OnMediaDeviceLost(reason);
+        }
+    });
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::OnMediaDeviceLost(HRESULT reason)
+{
+    // a new device is picked up by the next CreatePlaybackTexture
+    m_mediaDeviceLost = true;
+
+    CALLBACK_STATE state{};
+    ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+    state.type = CallbackType::Failed;
+
+    ZeroMemory(&state.value.failedState, sizeof(FAILED_STATE));
+
+    state.value.failedState.hresult = reason;
+
+    Callback(state);
+}
+
+_Use_decl_annotations_
+void PlaybackManager::ReleaseMediaDevice()
+{
+    // the other players can still be using it, the last one releases the device
+    if (m_sharedMediaDevice != nullptr)
+    {
+        m_sharedMediaDevice->DeviceLost(m_deviceLostToken);
+
+        m_sharedMediaDevice = nullptr;
+    }
+
+    m_dxgiDeviceManager = nullptr;
+    m_d3dDevice = nullptr;
+}
+
+_Use_decl_annotations_
+void PlaybackManager::ReleaseResources()
+{
+    ReleaseMediaDevice();
+
     if (m_closedEvent)
     {
         m_closedEvent(nullptr, *this);
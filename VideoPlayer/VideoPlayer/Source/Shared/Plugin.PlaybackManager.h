@@ -4,8 +4,47 @@
 #include "Plugin.Module.h"
 #include "D3D11DeviceResources.h"
 #include "MediaHelpers.h"
+#include "SharedMediaDevice.h"
+#include "PlaybackGroup.h"
+#include "MediaStreamIngest.h"
+#include "FrameReadback.h"
+#include "CaptionAtlas.h"
+#include "AudioTap.h"
+#include "VideoAtlas.h"
 
+#include <winrt/Windows.Media.Core.h>
 #include <winrt/Windows.Media.Playback.h>
+#include <winrt/Windows.Media.Streaming.Adaptive.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#define MIN_FRAME_BUFFERS 2
+#define DEFAULT_FRAME_BUFFERS 2
+#define MAX_FRAME_BUFFERS 8
+
+// extra textures fed from the same decoded frame, each with its own size
+#define MAX_PLAYBACK_OUTPUTS 8
+#define OUTPUT_FRAME_BUFFERS 2
+
+// recently decoded frames kept for stepping without the decoder
+#define MAX_FRAME_CACHE_FRAMES 240
+
+// how far ahead the playlist opens and buffers the next clip
+#define PLAYLIST_PREFETCH_SECONDS 10
+
+// frames the rolling averages of MediaPlayerGetStats cover
+#define STATS_AVERAGE_FRAMES 60
+
+// copies the latency percentiles of MediaPlayerGetStats are taken over
+#define STATS_HISTORY_FRAMES 256
+
+// without a max bitrate an adaptive stream is capped to the texture, about 0.1 bits per pixel at 30 fps
+#define ADAPTIVE_BITS_PER_PIXEL_SECOND 3
 
 struct __declspec(uuid("905a0fef-bc53-11df-8c49-001e4fc686da")) IPlaybackManagerPriv : ::IUnknown
 {
@@ -14,10 +53,74 @@ struct __declspec(uuid("905a0fef-bc53-11df-8c49-001e4fc686da")) IPlaybackManager
     STDMETHOD(Play)() PURE;
     STDMETHOD(Pause)() PURE;
     STDMETHOD(Stop)() PURE;
+    STDMETHOD(SetFrameBufferCount)(_In_ uint32_t bufferCount) PURE;
+    STDMETHOD(GetFrameInfo)(_Out_ VIDEO_FRAME_INFO* pFrameInfo) PURE;
+    STDMETHOD(Seek)(_In_ int64_t position, _In_ SeekMode mode) PURE;
+    STDMETHOD(SetPlaybackRate)(_In_ double rate) PURE;
+    STDMETHOD(QueueContent)(_In_ winrt::hstring const& contentLocation) PURE;
+    STDMETHOD(SkipToNext)() PURE;
+    STDMETHOD(SetAutoTextureSize)(_In_ bool enable, _In_ uint32_t maxWidth, _In_ uint32_t maxHeight) PURE;
+    STDMETHOD(SetBitrateLimits)(_In_ uint32_t initialBitrate, _In_ uint32_t minBitrate, _In_ uint32_t maxBitrate) PURE;
+    STDMETHOD(AddOutput)(_In_ uint32_t width, _In_ uint32_t height, _COM_Outptr_ void** ppvTexture, _Out_ uint32_t* pOutputId) PURE;
+    STDMETHOD(RemoveOutput)(_In_ uint32_t outputId) PURE;
+    STDMETHOD(SetMipmaps)(_In_ bool enable) PURE;
+    STDMETHOD(SetOutputFormat)(_In_ OutputFormat format) PURE;
+    STDMETHOD(OpenStream)(_In_ StreamCodec codec, _In_ uint32_t width, _In_ uint32_t height) PURE;
+    STDMETHOD(PushSample)(_In_reads_bytes_(size) uint8_t const* pData, _In_ uint32_t size, _In_ int64_t timestamp, _In_ int64_t duration, _In_ bool keyFrame) PURE;
+    STDMETHOD(EndStream)() PURE;
+    STDMETHOD(SetReadback)(_In_ bool enable, _In_ uint32_t width, _In_ uint32_t height) PURE;
+    STDMETHOD(SetFrameCache)(_In_ uint32_t maxFrames, _In_ uint32_t maxMegabytes) PURE;
+    STDMETHOD(StepForward)() PURE;
+    STDMETHOD(StepBackward)() PURE;
+    STDMETHOD(SetRenderDriven)(_In_ bool enable) PURE;
+    STDMETHOD(Suspend)() PURE;
+    STDMETHOD(Resume)() PURE;
+    STDMETHOD(SetCaptionAtlas)(_In_ bool enable, _COM_Outptr_result_maybenull_ void** ppvTexture) PURE;
+    STDMETHOD(SetAudioTap)(_In_ bool enable, _In_ uint32_t milliseconds) PURE;
+    STDMETHOD(GetAudioFormat)(_Out_ uint32_t* sampleRate, _Out_ uint32_t* channelCount) PURE;
+    STDMETHOD(ReadAudio)(_Out_writes_to_(count, *samplesRead) float* samples, _In_ uint32_t count, _Out_ uint32_t* samplesRead, _Out_ int64_t* timestamp) PURE;
+    STDMETHOD(GetStats)(_Out_ PLAYBACK_STATS* pStats) PURE;
+    STDMETHOD(Prepare)() PURE;
+    STDMETHOD(Preroll)(_In_ winrt::hstring const& contentLocation) PURE;
 };
 
 namespace winrt::VideoPlayer::Plugin::implementation
 {
+    // a texture besides the playback texture, the player scales every frame into its own ring of
+    // buffers and the render thread copies the newest one into the texture unity samples
+    struct PlaybackOutput
+    {
+        std::vector<std::shared_ptr<SharedTextureBuffer>> frameBuffers;
+        uint32_t latestBuffer;
+        uint32_t frameSequence;
+        uint32_t renderSequence;
+        com_ptr<ID3D11Texture2D> renderTexture;
+        com_ptr<ID3D11ShaderResourceView> renderTextureSRV;
+    };
+
+    // a decoded frame kept in the frame cache
+    struct CachedFrame
+    {
+        std::shared_ptr<SharedTextureBuffer> frameBuffer;
+        int64_t presentationTime;
+    };
+
+    // a subtitle or caption track of the open clip, its cues are handed to the app
+    struct CueTrack
+    {
+        Windows::Media::Core::TimedMetadataTrack track;
+        event_token cueEnteredToken;
+        event_token cueExitedToken;
+    };
+
+    // a cue between its CueEntered and CueExited
+    struct ActiveCue
+    {
+        Windows::Media::Core::IMediaCue cue;
+        uint32_t cueId;
+        int32_t atlasRow;
+    };
+
     struct PlaybackManager : PlaybackManagerT<PlaybackManager, Module, IPlaybackManagerPriv>
     {
 
@@ -28,7 +131,8 @@ namespace winrt::VideoPlayer::Plugin::implementation
 
         PlaybackManager();
 
-        virtual void Shutdown();
+        virtual void Shutdown() override;
+        virtual void OnRenderEvent(uint16_t frameNumber) override;
 
         event_token Closed(Windows::Foundation::EventHandler<Plugin::PlaybackManager> const& handler);
         void Closed(event_token const& token);
@@ -39,29 +143,261 @@ namespace winrt::VideoPlayer::Plugin::implementation
         STDOVERRIDEMETHODIMP Play();
         STDOVERRIDEMETHODIMP Pause();
         STDOVERRIDEMETHODIMP Stop();
+        STDOVERRIDEMETHODIMP SetFrameBufferCount(_In_ uint32_t bufferCount);
+        STDOVERRIDEMETHODIMP GetFrameInfo(_Out_ VIDEO_FRAME_INFO* pFrameInfo);
+        STDOVERRIDEMETHODIMP Seek(_In_ int64_t position, _In_ SeekMode mode);
+        STDOVERRIDEMETHODIMP SetPlaybackRate(_In_ double rate);
+        STDOVERRIDEMETHODIMP QueueContent(_In_ hstring const& contentLocation);
+        STDOVERRIDEMETHODIMP SkipToNext();
+        STDOVERRIDEMETHODIMP SetAutoTextureSize(_In_ bool enable, _In_ uint32_t maxWidth, _In_ uint32_t maxHeight);
+        STDOVERRIDEMETHODIMP SetBitrateLimits(_In_ uint32_t initialBitrate, _In_ uint32_t minBitrate, _In_ uint32_t maxBitrate);
+        STDOVERRIDEMETHODIMP AddOutput(_In_ uint32_t width, _In_ uint32_t height, _COM_Outptr_ void** ppvTexture, _Out_ uint32_t* pOutputId);
+        STDOVERRIDEMETHODIMP RemoveOutput(_In_ uint32_t outputId);
+        STDOVERRIDEMETHODIMP SetMipmaps(_In_ bool enable);
+        STDOVERRIDEMETHODIMP SetOutputFormat(_In_ OutputFormat format);
+        STDOVERRIDEMETHODIMP OpenStream(_In_ StreamCodec codec, _In_ uint32_t width, _In_ uint32_t height);
+        STDOVERRIDEMETHODIMP PushSample(_In_reads_bytes_(size) uint8_t const* pData, _In_ uint32_t size, _In_ int64_t timestamp, _In_ int64_t duration, _In_ bool keyFrame);
+        STDOVERRIDEMETHODIMP EndStream();
+        STDOVERRIDEMETHODIMP SetReadback(_In_ bool enable, _In_ uint32_t width, _In_ uint32_t height);
+        STDOVERRIDEMETHODIMP SetFrameCache(_In_ uint32_t maxFrames, _In_ uint32_t maxMegabytes);
+        STDOVERRIDEMETHODIMP StepForward();
+        STDOVERRIDEMETHODIMP StepBackward();
+        STDOVERRIDEMETHODIMP SetRenderDriven(_In_ bool enable);
+        STDOVERRIDEMETHODIMP Suspend();
+        STDOVERRIDEMETHODIMP Resume();
+        STDOVERRIDEMETHODIMP SetCaptionAtlas(_In_ bool enable, _COM_Outptr_result_maybenull_ void** ppvTexture);
+        STDOVERRIDEMETHODIMP SetAudioTap(_In_ bool enable, _In_ uint32_t milliseconds);
+        STDOVERRIDEMETHODIMP GetAudioFormat(_Out_ uint32_t* sampleRate, _Out_ uint32_t* channelCount);
+        STDOVERRIDEMETHODIMP ReadAudio(_Out_writes_to_(count, *samplesRead) float* samples, _In_ uint32_t count, _Out_ uint32_t* samplesRead, _Out_ int64_t* timestamp);
+        STDOVERRIDEMETHODIMP GetStats(_Out_ PLAYBACK_STATS* pStats);
+        STDOVERRIDEMETHODIMP Prepare();
+        STDOVERRIDEMETHODIMP Preroll(_In_ hstring const& contentLocation);
+
+        // not part of the runtime class, driven by PlaybackGroup
+        HRESULT JoinGroup(_In_ com_ptr<PlaybackGroup> const& group, _In_ Windows::Media::MediaTimelineController const& timelineController);
+        void LeaveGroup();
+        bool HasPendingFrame();
+        void PublishRenderFrame();
+        void PresentFrame();
+
+        // not part of the runtime class, driven by VideoAtlas
+        HRESULT JoinAtlas(_In_ com_ptr<VideoAtlas> const& atlas, _In_ uint32_t x, _In_ uint32_t y);
+        void LeaveAtlas();
+        void PresentToAtlas(_In_ ID3D11DeviceContext* context, _In_ ID3D11Texture2D* atlasTexture);
+
+    protected:
+        virtual void OnDeviceResetStarted() override;
+        virtual void OnDeviceResetCompleted() override;
 
     private:
         HRESULT CreateMediaPlayer();
+        HRESULT OpenContent(_In_ hstring const& contentLocation, _In_ bool preroll);
         void ReleaseMediaPlayer();
+        void DetachMediaPlayer();
+        HRESULT CreateOutputBuffers(_In_ ID3D11Device* unityDevice);
+        HRESULT CreatePlaybackTextureInternal(_In_ uint32_t width, _In_ uint32_t height);
+
+        void PublishVideoFrame();
+        void PresentFrame(_In_ ID3D11DeviceContext* context, _In_opt_ ID3D11Texture2D* atlasTexture);
+        void RaiseOpened(_In_ Windows::Media::Playback::MediaPlaybackItem const& item);
+        HRESULT ResizePlaybackTexture(_In_ uint32_t naturalWidth, _In_ uint32_t naturalHeight);
+        fire_and_forget RestorePlaybackTexture(_In_ uint32_t width, _In_ uint32_t height);
+        HRESULT CreateFrameCache();
+        void AttachCueTracks(_In_ Windows::Media::Playback::MediaPlaybackItem const& item);
+        void DetachCueTracks();
+        void OnCueEntered(_In_ Windows::Media::Core::IMediaCue const& cue);
+        void OnCueExited(_In_ Windows::Media::Core::IMediaCue const& cue);
+        void PresentCachedFrame(_In_ int32_t cursor);
+        void OpenAudioTap(_In_ hstring const& contentLocation);
+        void CloseAudioTap();
+        com_ptr<AudioTap> CurrentAudioTap();
+        void ResetStats();
+        void RecordDecodedFrame();
+        void RecordCopiedFrame(_In_ LONGLONG copyTicks);
+        void RecordDroppedFrame();
+        void SetStatsBitrate(_In_ uint32_t bitrate);
+        HRESULT CreatePlaybackList();
+        void ReleasePlaybackList();
+
+        Windows::Media::Core::MediaSource CreateMediaSource(_In_ hstring const& contentLocation);
+        void OnBinding(_In_ Windows::Media::Core::MediaBindingEventArgs const& args);
+        void ApplyBitrateLimits();
+        void ApplyBitrateLimits(_In_ Windows::Media::Streaming::Adaptive::AdaptiveMediaSource const& adaptiveSource);
+        uint32_t TextureBitrate();
+
+        static DXGI_FORMAT GetDxgiFormat(_In_ OutputFormat format);
+        static void GetColorInfo(_In_ Windows::Media::Playback::MediaPlaybackItem const& item, _Out_ VIDEO_COLOR_INFO* pColorInfo);
+        static uint32_t GetTrackBitrate(_In_ Windows::Media::Playback::MediaPlaybackItem const& item);
+
+        static bool IsAdaptiveContent(_In_ Windows::Foundation::Uri const& uri);
+        static uint32_t SnapBitrate(_In_ Windows::Foundation::Collections::IVectorView<uint32_t> const& bitrates, _In_ uint32_t bitrate);
+
+        HRESULT CreateFrameBuffers(
+            _In_ ID3D11Device* unityDevice,
+            _In_ uint32_t width,
+            _In_ uint32_t height,
+            _In_ DXGI_FORMAT format,
+            _In_ uint32_t bufferCount,
+            _Out_ std::vector<std::shared_ptr<SharedTextureBuffer>>& frameBuffers);
+        HRESULT CreateRenderTexture(
+            _In_ ID3D11Device* unityDevice,
+            _In_ D3D11_TEXTURE2D_DESC const& frameTextureDesc,
+            _In_ bool mipmaps,
+            _Out_ com_ptr<ID3D11Texture2D>& renderTexture,
+            _Out_ com_ptr<ID3D11ShaderResourceView>& renderTextureSRV);
+
+        static void CopyToRenderTexture(
+            _In_ ID3D11DeviceContext* context,
+            _In_ ID3D11Texture2D* renderTexture,
+            _In_ ID3D11ShaderResourceView* renderTextureSRV,
+            _In_ ID3D11Texture2D* frameTexture);
 
         HRESULT CreateResources(com_ptr<ID3D11Device> const& unityDevice);
         void ReleaseResources();
+        void ReleaseMediaDevice();
+        void OnMediaDeviceLost(HRESULT reason);
 
     private:
+        // shared with the other players on the adapter, the two below are its device and manager
+        com_ptr<SharedMediaDevice> m_sharedMediaDevice;
         com_ptr<ID3D11Device> m_d3dDevice;
-        uint32_t m_resetToken;
         com_ptr<IMFDXGIDeviceManager> m_dxgiDeviceManager;
+        event_token m_deviceLostToken;
+        std::atomic<boolean> m_mediaDeviceLost;
 
+        // only the app thread sets them, under m_frameMutex, PublishVideoFrame takes its own copies
+        // under it on the render and player threads
         Windows::Media::Playback::MediaPlayer m_mediaPlayer;
         event_token m_endedToken;
         event_token m_failedToken;
         event_token m_openedToken;
         event_token m_videoFrameAvailableToken;
 
+        // LoadContent starts a new list, QueueContent appends to it so the next clip is already open
+        Windows::Media::Playback::MediaPlaybackList m_playbackList;
+        event_token m_currentItemChangedToken;
+
+        // hls and dash clips of the current playlist, bound when the list opens them, the generation
+        // moves on with every new list so a late binding of the old one isn't kept
+        slim_mutex m_adaptiveMutex;
+        uint32_t m_playlistGeneration;
+        std::vector<Windows::Media::Streaming::Adaptive::AdaptiveMediaSource> m_adaptiveSources;
+
+        // bits per second, 0 leaves it to the source, the max follows the texture then
+        std::atomic<uint32_t> m_initialBitrate;
+        std::atomic<uint32_t> m_minBitrate;
+        std::atomic<uint32_t> m_maxBitrate;
+
+        // the pushed stream opened by OpenStream, part of the playlist like a uri, samples can
+        // come from any thread
+        slim_mutex m_ingestMutex;
+        com_ptr<StreamIngest> m_streamIngest;
+
         Windows::Media::Playback::MediaPlaybackSession m_mediaPlaybackSession;
         event_token m_stateChangedEventToken;
+        event_token m_seekCompletedEventToken;
+        event_token m_bufferingProgressEventToken;
+        event_token m_downloadProgressEventToken;
+
+        // keyframe seeks coalesce while one is running, -1 when nothing is queued
+        slim_mutex m_seekMutex;
+        bool m_seekPending;
+        int64_t m_queuedSeekPosition;
+
+        // the player writes the buffers round robin while the render thread copies the newest
+        // one into the texture unity samples, so a frame is never read while it's being written
+        slim_mutex m_frameMutex;
+        uint32_t m_frameBufferCount;
+        std::vector<std::shared_ptr<SharedTextureBuffer>> m_frameBuffers;
+        uint32_t m_latestBuffer;
+        uint32_t m_frameSequence;
+        uint32_t m_renderSequence;
+        VIDEO_FRAME_INFO m_frameInfo;
+        com_ptr<ID3D11Texture2D> m_renderTexture;
+        com_ptr<ID3D11ShaderResourceView> m_renderTextureSRV;
+
+        // the texture's size when unity's device went away, rebuilt at it once the device is back
+        uint32_t m_resetTextureWidth;
+        uint32_t m_resetTextureHeight;
+
+        // fed from the frame the playback texture gets, under m_frameMutex too
+        std::map<uint32_t, std::shared_ptr<PlaybackOutput>> m_outputs;
+        uint32_t m_nextOutputId;
+
+        // frames for the cpu, under m_frameMutex too, only the player thread reads it back
+        com_ptr<FrameReadback> m_frameReadback;
+
+        // a ring of the newest decoded frames in playback order, under m_frameMutex, the cursor
+        // is the cached frame shown while stepping, -1 while the decoder's newest frame is shown
+        uint32_t m_frameCacheMaxFrames;
+        uint32_t m_frameCacheMaxMegabytes;
+        std::vector<CachedFrame> m_frameCache;
+        uint32_t m_frameCacheHead;
+        uint32_t m_frameCacheCount;
+        int32_t m_frameCacheCursor;
+        std::shared_ptr<SharedTextureBuffer> m_cachedFrameBuffer;
+
+        // the texture follows the natural size of each clip, 0 leaves a side unbounded
+        std::atomic<bool> m_autoTextureSize;
+        std::atomic<uint32_t> m_maxTextureWidth;
+        std::atomic<uint32_t> m_maxTextureHeight;
+
+        // textures created from now on carry a full mip chain, filled on the render thread per frame
+        std::atomic<bool> m_mipmaps;
+        std::atomic<OutputFormat> m_outputFormat;
+
+        // render driven, VideoFrameAvailable only flags a frame and the render event copies the
+        // player's current one, a frame decoded and replaced between two render events is never copied
+        std::atomic<bool> m_renderDriven;
+        std::atomic<bool> m_videoFrameAvailable;
+
+        // opened paused by Preroll, until its first frame is copied or Play
+        std::atomic<bool> m_prerollPending;
+
+        // the caption tracks of the open clip and their active cues, the atlas draws the cues for
+        // the app when it asked for one
+        slim_mutex m_cueMutex;
+        std::vector<CueTrack> m_cueTracks;
+        std::vector<ActiveCue> m_activeCues;
+        uint32_t m_nextCueId;
+        com_ptr<CaptionAtlas> m_captionAtlas;
+
+        // the loaded clip's audio decoded a second time for the app to pull, the player is muted
+        // while there is one, 0 milliseconds leaves the audio to the player
+        slim_mutex m_audioMutex;
+        uint32_t m_audioTapMilliseconds;
+        com_ptr<AudioTap> m_audioTap;
+
+        // suspended, the player, its decoder, the media device and every buffer but the texture
+        // unity holds are released, the playlist and where it was are kept for Resume, app thread
+        bool m_suspended;
+        Windows::Media::Playback::MediaPlaybackItem m_resumeItem;
+        std::atomic<int64_t> m_resumePosition;
+        bool m_resumePlaying;
+        uint32_t m_resumeReadbackWidth;
+        uint32_t m_resumeReadbackHeight;
+
+        // what MediaPlayerGetStats returns, kept up to date as frames come so a poll is only a copy,
+        // the intervals are rolling averages in qpc ticks, taken after m_frameMutex, never before
+        slim_mutex m_statsMutex;
+        PLAYBACK_STATS m_stats;
+        LONGLONG m_lastDecodedTime;
+        LONGLONG m_lastCopiedTime;
+        float m_decodedInterval;
+        float m_copiedInterval;
+        std::array<float, STATS_HISTORY_FRAMES> m_copyHistory;
+
+        // set while grouped, the group's clock and render event drive this player
+        com_ptr<PlaybackGroup> m_group;
+        Windows::Media::MediaTimelineController m_timelineController;
 
-        std::shared_ptr<SharedTextureBuffer> m_primaryBuffer;
+        // set while in an atlas, the frames go to the atlas tile instead of the playback texture,
+        // the tile is the size the texture had when the player joined, under m_frameMutex
+        com_ptr<VideoAtlas> m_atlas;
+        uint32_t m_atlasX;
+        uint32_t m_atlasY;
+        uint32_t m_atlasTileWidth;
+        uint32_t m_atlasTileHeight;
 
         event<Windows::Foundation::EventHandler<Plugin::PlaybackManager>> m_closedEvent;
     };
@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+
+#include "VideoAtlas.h"
+#include "Plugin.PlaybackManager.h"
+
+using namespace winrt;
+
+using PlaybackManager = winrt::VideoPlayer::Plugin::implementation::PlaybackManager;
+
+_Use_decl_annotations_
+HRESULT VideoAtlas::Create(
+    ID3D11Device* unityDevice,
+    uint32_t width,
+    uint32_t height,
+    UINT miscFlags,
+    com_ptr<VideoAtlas>& atlas)
+{
+    atlas = nullptr;
+
+    NULL_CHK_HR(unityDevice, E_INVALIDARG);
+
+    if (width < 1 || height < 1 || width > MAX_ATLAS_SIZE || height > MAX_ATLAS_SIZE)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto videoAtlas = make_self<VideoAtlas>();
+    videoAtlas->m_unityDevice.copy_from(unityDevice);
+    videoAtlas->m_width = width;
+    videoAtlas->m_height = height;
+
+    // the tiles are copied in with CopySubresourceRegion, so the format is the players' bgra8
+    auto textureDesc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, width, height);
+    textureDesc.MipLevels = 1;
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    textureDesc.MiscFlags = miscFlags;
+
+    IFR(unityDevice->CreateTexture2D(&textureDesc, nullptr, videoAtlas->m_texture.put()));
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(videoAtlas->m_texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D);
+    IFR(unityDevice->CreateShaderResourceView(videoAtlas->m_texture.get(), &srvDesc, videoAtlas->m_textureSRV.put()));
+
+    atlas = videoAtlas;
+
+    return S_OK;
+}
+
+VideoAtlas::VideoAtlas()
+    : m_unityDevice(nullptr)
+    , m_texture(nullptr)
+    , m_textureSRV(nullptr)
+    , m_width(0)
+    , m_height(0)
+    , m_players()
+    , m_rendered(false)
+    , m_lastFrameNumber(0)
+{
+}
+
+VideoAtlas::~VideoAtlas()
+{
+    Close();
+}
+
+_Use_decl_annotations_
+HRESULT VideoAtlas::Add(
+    PlaybackManager* player,
+    uint32_t x,
+    uint32_t y)
+{
+    NULL_CHK_HR(player, E_INVALIDARG);
+
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        NULL_CHK_HR(m_texture, MF_E_SHUTDOWN);
+
+        for (auto const& weakPlayer : m_players)
+        {
+            if (weakPlayer.get().get() == player)
+            {
+                IFR(HRESULT_FROM_WIN32(ERROR_ALREADY_ASSIGNED));
+            }
+        }
+    }
+
+    // not under the lock, the player calls back here from its render event
+    IFR(player->JoinAtlas(get_strong(), x, y));
+
+    std::lock_guard<slim_mutex> guard(m_mutex);
+
+    m_players.push_back(player->get_weak());
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT VideoAtlas::Remove(
+    PlaybackManager* player)
+{
+    NULL_CHK_HR(player, E_INVALIDARG);
+
+    bool found = false;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        for (auto it = m_players.begin(); it != m_players.end(); ++it)
+        {
+            if (it->get().get() == player)
+            {
+                m_players.erase(it);
+
+                found = true;
+
+                break;
+            }
+        }
+    }
+
+    if (!found)
+    {
+        IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
+    }
+
+    player->LeaveAtlas();
+
+    return S_OK;
+}
+
+// the players present to their own textures again, unity may still hold the atlas texture
+void VideoAtlas::Close()
+{
+    std::vector<weak_ref<PlaybackManager>> players;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        players.swap(m_players);
+    }
+
+    for (auto const& weakPlayer : players)
+    {
+        auto player = weakPlayer.get();
+        if (player != nullptr)
+        {
+            player->LeaveAtlas();
+        }
+    }
+}
+
+// render thread
+_Use_decl_annotations_
+void VideoAtlas::OnRenderEvent(
+    uint16_t frameNumber)
+{
+    std::vector<com_ptr<PlaybackManager>> players;
+    {
+        std::lock_guard<slim_mutex> guard(m_mutex);
+
+        if (m_rendered && frameNumber == m_lastFrameNumber)
+        {
+            return;
+        }
+
+        m_rendered = true;
+        m_lastFrameNumber = frameNumber;
+
+        for (auto const& weakPlayer : m_players)
+        {
+            auto player = weakPlayer.get();
+            if (player != nullptr)
+            {
+                players.push_back(player);
+            }
+        }
+    }
+
+    if (players.empty())
+    {
+        return;
+    }
+
+    PLUGIN_TRACE_SCOPE("VideoAtlas.CopyTiles", PLUGIN_TRACE_KEYWORD_TEXTURE);
+
+    com_ptr<ID3D11DeviceContext> context = nullptr;
+    m_unityDevice->GetImmediateContext(context.put());
+
+    // outside the lock, render driven players raise callbacks while copying their frame
+    for (auto const& player : players)
+    {
+        player->PublishRenderFrame();
+        player->PresentToAtlas(context.get(), m_texture.get());
+    }
+}
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <mutex>
+#include <vector>
+
+// at most this many texels on a side, the d3d11 limit
+#define MAX_ATLAS_SIZE D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+
+namespace winrt::VideoPlayer::Plugin::implementation
+{
+    struct PlaybackManager;
+}
+
+// one texture on unity's device that players copy their frames into, each at its own tile, so a
+// grid of small videos is one texture and one material, the tiles are copied on the render thread
+struct VideoAtlas : winrt::implements<VideoAtlas, winrt::Windows::Foundation::IInspectable>
+{
+    static HRESULT Create(
+        _In_ ID3D11Device* unityDevice,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ UINT miscFlags,
+        _Out_ winrt::com_ptr<VideoAtlas>& atlas);
+
+    VideoAtlas();
+    virtual ~VideoAtlas();
+
+    ID3D11ShaderResourceView* TextureSRV() const { return m_textureSRV.get(); }
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+    // the tile is the player's playback texture size with its top left corner at x, y
+    HRESULT Add(
+        _In_ winrt::VideoPlayer::Plugin::implementation::PlaybackManager* player,
+        _In_ uint32_t x,
+        _In_ uint32_t y);
+    HRESULT Remove(
+        _In_ winrt::VideoPlayer::Plugin::implementation::PlaybackManager* player);
+    void Close();
+
+    // every member forwards its render event here, only the first one per unity frame counts
+    void OnRenderEvent(
+        _In_ uint16_t frameNumber);
+
+private:
+    winrt::slim_mutex m_mutex;
+
+    winrt::com_ptr<ID3D11Device> m_unityDevice;
+    winrt::com_ptr<ID3D11Texture2D> m_texture;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_textureSRV;
+    uint32_t m_width;
+    uint32_t m_height;
+
+    std::vector<winrt::weak_ref<winrt::VideoPlayer::Plugin::implementation::PlaybackManager>> m_players;
+
+    bool m_rendered;
+    uint16_t m_lastFrameNumber;
+};
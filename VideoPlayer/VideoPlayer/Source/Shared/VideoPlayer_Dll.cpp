@@ -3,9 +3,7 @@
 
 #include "pch.h"
 
-#include "Unity/IUnityGraphics.h"
-#include "PlatformBase.h"
-#include "UnityDeviceResource.h"
+#include "PluginDll.h"
 
 #include "Plugin.PlaybackManager.h"
 
@@ -19,40 +17,36 @@ namespace winrt
     using namespace winrt::VideoPlayer::Plugin;
 }
 
+// groups and atlases never reach a render event, their handles count up from past the players'
 static INSTANCE_HANDLE s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
-static std::unordered_map<INSTANCE_HANDLE, winrt::IModule> s_instances;
-HRESULT GetModule(INSTANCE_HANDLE id, _Out_ winrt::IModule& module)
+
+// groups and players take handles from ranges apart, so neither can be mistaken for the other
+static std::unordered_map<INSTANCE_HANDLE, winrt::com_ptr<PlaybackGroup>> s_groups;
+HRESULT GetGroup(INSTANCE_HANDLE id, _Out_ winrt::com_ptr<PlaybackGroup>& group)
 {
     if (id < INSTANCE_HANDLE_START)
     {
         IFR(E_INVALIDARG);
     }
 
-    auto it = s_instances.find(id);
-    if (it == s_instances.end())
+    auto it = s_groups.find(id);
+    if (it == s_groups.end())
     {
         IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
     }
 
-    module = it->second;
+    group = it->second;
 
-    NULL_CHK_HR(module, E_POINTER);
+    NULL_CHK_HR(group, E_POINTER);
 
     return S_OK;
 }
 
-static std::shared_ptr<IUnityDeviceResource> s_deviceResource;
-static UnityGfxRenderer s_deviceType = kUnityGfxRendererNull;
-static IUnityInterfaces* s_unityInterfaces = nullptr;
-static IUnityGraphics* s_unityGraphics = nullptr;
-
-HRESULT TrackModule(winrt::IModule &module, INSTANCE_HANDLE * handleId)
+HRESULT TrackGroup(winrt::com_ptr<PlaybackGroup> const& group, INSTANCE_HANDLE* handleId)
 {
-    // get the last index value;
     auto handle = s_lastPluginHandleIndex;
 
-    // add to map
-    auto success = s_instances.emplace(handle, module);
+    auto success = s_groups.emplace(handle, group);
     if (success.second)
     {
         *handleId = handle++;
@@ -62,107 +56,93 @@ HRESULT TrackModule(winrt::IModule &module, INSTANCE_HANDLE * handleId)
     return (success.second ? S_OK : E_UNEXPECTED);
 }
 
-// --------------------------------------------------------------------------
-// UnitySetInterfaces
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
-
-extern "C" void	UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces)
+// atlases too
+static std::unordered_map<INSTANCE_HANDLE, winrt::com_ptr<VideoAtlas>> s_atlases;
+HRESULT GetAtlas(INSTANCE_HANDLE id, _Out_ winrt::com_ptr<VideoAtlas>& atlas)
 {
-    s_lastPluginHandleIndex = INSTANCE_HANDLE_START;
-    s_instances.clear();
-
-    s_unityInterfaces = unityInterfaces;
-    s_unityGraphics = s_unityInterfaces->Get<IUnityGraphics>();
-    s_unityGraphics->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
-
-    // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
-    OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
-}
+    if (id < INSTANCE_HANDLE_START)
+    {
+        IFR(E_INVALIDARG);
+    }
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
-{
-    for (auto&& kv : s_instances)
+    auto it = s_atlases.find(id);
+    if (it == s_atlases.end())
     {
-        kv.second.Shutdown();
-        kv.second = nullptr;
+        IFR(HRESULT_FROM_WIN32(ERROR_NOT_FOUND));
     }
-    s_instances.clear();
 
-    s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
+    atlas = it->second;
 
-    s_unityGraphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+    NULL_CHK_HR(atlas, E_POINTER);
+
+    return S_OK;
 }
 
-// --------------------------------------------------------------------------
-// GraphicsDeviceEvent
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
+HRESULT TrackAtlas(winrt::com_ptr<VideoAtlas> const& atlas, INSTANCE_HANDLE* handleId)
 {
-    // Create graphics API implementation upon initialization
-    if (eventType == kUnityGfxDeviceEventInitialize)
+    auto handle = s_lastPluginHandleIndex;
+
+    auto success = s_atlases.emplace(handle, atlas);
+    if (success.second)
     {
-        assert(s_deviceResource == nullptr);
+        *handleId = handle++;
+        s_lastPluginHandleIndex = handle;
+    }
 
-        s_deviceType = s_unityGraphics->GetRenderer();
+    return (success.second ? S_OK : E_UNEXPECTED);
+}
 
-        s_deviceResource = CreateDeviceResource(s_deviceType);
-    }
+void OnPluginLoad()
+{
+    s_lastPluginHandleIndex = INSTANCE_REGISTRY_HANDLE_END;
+}
 
-    // Let the implementation process the device related event
-    if (s_deviceResource != nullptr)
+// groups and atlases hold players, they close first
+void OnPluginUnloading()
+{
+    for (auto&& kv : s_groups)
     {
-        s_deviceResource->ProcessDeviceEvent(eventType, s_unityInterfaces);
+        kv.second->Close();
+        kv.second = nullptr;
     }
+    s_groups.clear();
 
-    // Cleanup graphics API implementation upon shutdown
-    if (eventType == kUnityGfxDeviceEventShutdown)
+    for (auto&& kv : s_atlases)
     {
-        s_deviceResource.reset();
-        s_deviceResource = nullptr;
-        s_deviceType = kUnityGfxRendererNull;
+        kv.second->Close();
+        kv.second = nullptr;
     }
+    s_atlases.clear();
 }
 
-
-// --------------------------------------------------------------------------
-// OnRenderEvent
-// This will be called for GL.IssuePluginEvent script calls; eventID will
-// be the integer passed to IssuePluginEvent. In this example, we just ignore
-// that value.
-static void UNITY_INTERFACE_API OnRenderEvent(int32_t eventID)
+void OnPluginUnload()
 {
-    DWORD dwId = static_cast<DWORD>(eventID);
-
-    INSTANCE_HANDLE id = static_cast<INSTANCE_HANDLE>(LOWORD(dwId));
-
-    winrt::IModule module = nullptr;
-    if (SUCCEEDED(GetModule(id, module)))
-    {
-        uint16_t frameId = static_cast<uint16_t>(HIWORD(dwId));
+    s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
 
-        module.OnRenderEvent(frameId);
-    }
+    // pooled buffers keep their devices alive
+    SharedTextureBufferPool::Instance().Clear();
 }
 
-// --------------------------------------------------------------------------
-// GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
-extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc()
+void OnPluginDeviceResetStarted()
 {
-    return OnRenderEvent;
+    SharedTextureBufferPool::Instance().Clear();
 }
 
+// shared by every player, idle buffers past the budget are released oldest first
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureBudget(
+    _In_ uint64_t budgetBytes)
+{
+    SharedTextureBufferPool::Instance().SetBudget(budgetBytes);
+}
 
-// --------------------------------------------------------------------------
-// Other function
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstance(
-    _In_ INSTANCE_HANDLE id)
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetMemoryStats(
+    _Out_ TEXTURE_MEMORY_STATS* stats)
 {
-    winrt::IModule module = nullptr;
-    if (SUCCEEDED(GetModule(id, module)))
-    {
-        s_instances.erase(id);
-        module.Shutdown();
-        module = nullptr;
-    }
+    NULL_CHK_HR(stats, E_INVALIDARG);
+
+    SharedTextureBufferPool::Instance().GetStats(*stats);
+
+    return S_OK;
 }
 
 
@@ -176,7 +156,7 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerCreateP
     {
         return E_INVALIDARG;
     }
-    winrt::IModule module = impl::PlaybackManager::Create(s_deviceResource, fnCallback, managedObject);
+    winrt::IModule module = impl::PlaybackManager::Create(GetUnityDeviceResource(), fnCallback, managedObject);
 
     return TrackModule(module, handleId);
 }
@@ -219,6 +199,44 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerLoadCon
     return hr;
 }
 
+// creates the media device and the player ahead of MediaPlayerLoadContent, can be called from a
+// worker thread while nothing else calls into the player
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerPrepare(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->Prepare();
+    }
+
+    return hr;
+}
+
+// loads the content paused with its first frame decoded, MediaPlayerState::Prerolled once it's ready
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerPreroll(
+    _In_ INSTANCE_HANDLE id,
+    _In_ LPCWSTR contentLocation)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->Preroll(contentLocation);
+    }
+
+    return hr;
+}
+
 extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerPlay(
     _In_ INSTANCE_HANDLE id)
 {
@@ -269,3 +287,756 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerStop(
 
     return hr;
 }
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetFrameBufferCount(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t bufferCount)
+{
+    if (bufferCount < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetFrameBufferCount(static_cast<uint32_t>(bufferCount));
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGetFrameInfo(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ VIDEO_FRAME_INFO* frameInfo)
+{
+    NULL_CHK_HR(frameInfo, E_INVALIDARG);
+
+    ZeroMemory(frameInfo, sizeof(VIDEO_FRAME_INFO));
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->GetFrameInfo(frameInfo);
+    }
+
+    return hr;
+}
+
+// decode, copy and network counters, cheap enough to call every frame
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGetStats(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ PLAYBACK_STATS* stats)
+{
+    NULL_CHK_HR(stats, E_INVALIDARG);
+
+    ZeroMemory(stats, sizeof(PLAYBACK_STATS));
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->GetStats(stats);
+    }
+
+    return hr;
+}
+
+// position in 100ns units, mode is a SeekMode
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSeek(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int64_t position,
+    _In_ int32_t seekMode)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->Seek(position, static_cast<SeekMode>(seekMode));
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetPlaybackRate(
+    _In_ INSTANCE_HANDLE id,
+    _In_ double rate)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetPlaybackRate(rate);
+    }
+
+    return hr;
+}
+
+// plays after what is already loaded or queued, without a gap
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerQueueContent(
+    _In_ INSTANCE_HANDLE id,
+    _In_ LPCWSTR contentLocation)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->QueueContent(contentLocation);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSkipToNext(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SkipToNext();
+    }
+
+    return hr;
+}
+
+// the texture is sized to each clip as it opens, 0 leaves a side unbounded
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetAutoTextureSize(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ int32_t maxWidth,
+    _In_ int32_t maxHeight)
+{
+    if (maxWidth < 0 || maxHeight < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetAutoTextureSize(enable != 0, static_cast<uint32_t>(maxWidth), static_cast<uint32_t>(maxHeight));
+    }
+
+    return hr;
+}
+
+// bits per second for hls and dash content, 0 leaves a limit to the stream, the max then follows the texture
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetBitrateLimits(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t initialBitrate,
+    _In_ uint32_t minBitrate,
+    _In_ uint32_t maxBitrate)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetBitrateLimits(initialBitrate, minBitrate, maxBitrate);
+    }
+
+    return hr;
+}
+
+// textures created after the call carry a full mip chain, generated on the gpu every frame
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetMipmaps(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetMipmaps(enable != 0);
+    }
+
+    return hr;
+}
+
+// textures created after the call use the format, Rgb10A2 and Rgba16F keep a 10 bit stream's precision
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetOutputFormat(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t format)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetOutputFormat(static_cast<OutputFormat>(format));
+    }
+
+    return hr;
+}
+
+// plays encoded access units pushed with MediaPlayerPushSample instead of a file
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerOpenStream(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t codec,
+    _In_ int32_t width,
+    _In_ int32_t height)
+{
+    if (width < 1 || height < 1)
+    {
+        return E_INVALIDARG;
+    }
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->OpenStream(static_cast<StreamCodec>(codec), static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    }
+
+    return hr;
+}
+
+// any thread, the data is copied before the call returns, times in 100ns units
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerPushSample(
+    _In_ INSTANCE_HANDLE id,
+    _In_reads_bytes_(size) uint8_t const* data,
+    _In_ uint32_t size,
+    _In_ int64_t timestamp,
+    _In_ int64_t duration,
+    _In_ boolean keyFrame)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->PushSample(data, size, timestamp, duration, keyFrame != 0);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerEndStream(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->EndStream();
+    }
+
+    return hr;
+}
+
+// every frame scaled to width x height reaches the callback as bgra in cpu memory, for analytics
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetReadback(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ int32_t width,
+    _In_ int32_t height)
+{
+    if (width < 0 || height < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetReadback(enable != 0, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    }
+
+    return hr;
+}
+
+// keeps the newest decoded frames so stepping back doesn't go through the decoder, 0 frames is off
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetFrameCache(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t maxFrames,
+    _In_ int32_t maxMegabytes)
+{
+    if (maxFrames < 0 || maxMegabytes < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetFrameCache(static_cast<uint32_t>(maxFrames), static_cast<uint32_t>(maxMegabytes));
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerStepForward(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->StepForward();
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerStepBackward(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->StepBackward();
+    }
+
+    return hr;
+}
+
+// frames copied from the render event instead of the player thread, one copy per rendered frame
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetRenderDriven(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetRenderDriven(enable != 0);
+    }
+
+    return hr;
+}
+
+// releases the decoder and every buffer but the playback texture, for a player that is offscreen
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSuspend(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->Suspend();
+    }
+
+    return hr;
+}
+
+// reopens the content where MediaPlayerSuspend left it
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerResume(
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->Resume();
+    }
+
+    return hr;
+}
+
+// active caption cues drawn into a texture, the row of a cue comes with CueEntered, null when disabled
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetCaptionAtlas(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ void** atlasTexture)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetCaptionAtlas(enable != 0, atlasTexture);
+    }
+
+    return hr;
+}
+
+// the audio of the next loaded clip goes to MediaPlayerReadAudio instead of the speakers
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerSetAudioTap(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ int32_t milliseconds)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->SetAudioTap(enable != 0, milliseconds > 0 ? static_cast<uint32_t>(milliseconds) : 0);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGetAudioFormat(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ uint32_t* sampleRate,
+    _Out_ uint32_t* channelCount)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->GetAudioFormat(sampleRate, channelCount);
+    }
+
+    return hr;
+}
+
+// interleaved float samples, called from OnAudioFilterRead
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerReadAudio(
+    _In_ INSTANCE_HANDLE id,
+    _Out_writes_to_(count, *samplesRead) float* samples,
+    _In_ uint32_t count,
+    _Out_ int64_t* timestamp,
+    _Out_ uint32_t* samplesRead)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->ReadAudio(samples, count, samplesRead, timestamp);
+    }
+
+    return hr;
+}
+
+// another texture fed by the same decode, released with the player or MediaPlayerRemoveOutput
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerAddOutput(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t width,
+    _In_ int32_t height,
+    _In_ void** outputTexture,
+    _Out_ uint32_t* outputId)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->AddOutput(static_cast<uint32_t>(width), static_cast<uint32_t>(height), outputTexture, outputId);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerRemoveOutput(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t outputId)
+{
+    winrt::IModule module = nullptr;
+    HRESULT hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto mediaPlayer = module.as<IPlaybackManagerPriv>();
+
+        NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = mediaPlayer->RemoveOutput(outputId);
+    }
+
+    return hr;
+}
+
+
+// Playback Group
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerCreateGroup(
+    _Out_ INSTANCE_HANDLE* groupId)
+{
+    NULL_CHK_HR(groupId, E_INVALIDARG);
+
+    *groupId = INSTANCE_HANDLE_INVALID;
+
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    IFR(PlaybackGroup::Create(group));
+
+    return TrackGroup(group, groupId);
+}
+
+// the players keep playing on their own clocks
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerReleaseGroup(
+    _In_ INSTANCE_HANDLE groupId)
+{
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    if (SUCCEEDED(GetGroup(groupId, group)))
+    {
+        s_groups.erase(groupId);
+        group->Close();
+        group = nullptr;
+    }
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGroupAddPlayer(
+    _In_ INSTANCE_HANDLE groupId,
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    IFR(GetGroup(groupId, group));
+
+    winrt::IModule module = nullptr;
+    IFR(GetModule(id, module));
+
+    auto mediaPlayer = module.try_as<winrt::PlaybackManager>();
+    NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+    return group->Add(winrt::get_self<impl::PlaybackManager>(mediaPlayer));
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGroupRemovePlayer(
+    _In_ INSTANCE_HANDLE groupId,
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    IFR(GetGroup(groupId, group));
+
+    winrt::IModule module = nullptr;
+    IFR(GetModule(id, module));
+
+    auto mediaPlayer = module.try_as<winrt::PlaybackManager>();
+    NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+    return group->Remove(winrt::get_self<impl::PlaybackManager>(mediaPlayer));
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGroupPlay(
+    _In_ INSTANCE_HANDLE groupId)
+{
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    IFR(GetGroup(groupId, group));
+
+    return group->Play();
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGroupPause(
+    _In_ INSTANCE_HANDLE groupId)
+{
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    IFR(GetGroup(groupId, group));
+
+    return group->Pause();
+}
+
+// position in 100ns units
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerGroupSeek(
+    _In_ INSTANCE_HANDLE groupId,
+    _In_ int64_t position)
+{
+    winrt::com_ptr<PlaybackGroup> group = nullptr;
+    IFR(GetGroup(groupId, group));
+
+    return group->Seek(winrt::Windows::Foundation::TimeSpan(position));
+}
+
+
+// Video Atlas
+// one bgra8 texture on unity's device for many small players, atlasTexture is its shader resource view
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerCreateAtlas(
+    _In_ int32_t width,
+    _In_ int32_t height,
+    _COM_Outptr_ void** atlasTexture,
+    _Out_ INSTANCE_HANDLE* atlasId)
+{
+    NULL_CHK_HR(atlasTexture, E_INVALIDARG);
+    NULL_CHK_HR(atlasId, E_INVALIDARG);
+
+    *atlasTexture = nullptr;
+    *atlasId = INSTANCE_HANDLE_INVALID;
+
+    if (width < 1 || height < 1)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto resources = std::dynamic_pointer_cast<ID3D11DeviceResource>(GetUnityDeviceResource());
+    NULL_CHK_HR(resources, E_POINTER);
+
+    auto unityDevice = resources->GetDevice();
+    NULL_CHK_HR(unityDevice, MF_E_NOT_INITIALIZED);
+
+    // on d3d12 unity samples the atlas through a shared handle
+    auto d3d12Resources = std::dynamic_pointer_cast<ID3D12DeviceResource>(GetUnityDeviceResource());
+    UINT miscFlags = d3d12Resources != nullptr ? D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE : 0;
+
+    winrt::com_ptr<VideoAtlas> atlas = nullptr;
+    IFR(VideoAtlas::Create(unityDevice.get(), static_cast<uint32_t>(width), static_cast<uint32_t>(height), miscFlags, atlas));
+
+    // owned by the atlas on d3d12, released with it
+    void* unityTexture = nullptr;
+    if (d3d12Resources != nullptr)
+    {
+        IFR(d3d12Resources->GetUnityTexture(atlas->TextureSRV(), &unityTexture));
+    }
+
+    IFR(TrackAtlas(atlas, atlasId));
+
+    if (unityTexture != nullptr)
+    {
+        *atlasTexture = unityTexture;
+    }
+    else
+    {
+        winrt::com_ptr<ID3D11ShaderResourceView> spSRV = nullptr;
+        spSRV.copy_from(atlas->TextureSRV());
+
+        *atlasTexture = spSRV.detach();
+    }
+
+    return S_OK;
+}
+
+// the players present to their own textures again
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerReleaseAtlas(
+    _In_ INSTANCE_HANDLE atlasId)
+{
+    winrt::com_ptr<VideoAtlas> atlas = nullptr;
+    if (SUCCEEDED(GetAtlas(atlasId, atlas)))
+    {
+        s_atlases.erase(atlasId);
+        atlas->Close();
+        atlas = nullptr;
+    }
+}
+
+// the player's texture size is its tile, x and y are the tile's top left corner in texels
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerAtlasAddPlayer(
+    _In_ INSTANCE_HANDLE atlasId,
+    _In_ INSTANCE_HANDLE id,
+    _In_ int32_t x,
+    _In_ int32_t y)
+{
+    if (x < 0 || y < 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    winrt::com_ptr<VideoAtlas> atlas = nullptr;
+    IFR(GetAtlas(atlasId, atlas));
+
+    winrt::IModule module = nullptr;
+    IFR(GetModule(id, module));
+
+    auto mediaPlayer = module.try_as<winrt::PlaybackManager>();
+    NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+    return atlas->Add(winrt::get_self<impl::PlaybackManager>(mediaPlayer), static_cast<uint32_t>(x), static_cast<uint32_t>(y));
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API MediaPlayerAtlasRemovePlayer(
+    _In_ INSTANCE_HANDLE atlasId,
+    _In_ INSTANCE_HANDLE id)
+{
+    winrt::com_ptr<VideoAtlas> atlas = nullptr;
+    IFR(GetAtlas(atlasId, atlas));
+
+    winrt::IModule module = nullptr;
+    IFR(GetModule(id, module));
+
+    auto mediaPlayer = module.try_as<winrt::PlaybackManager>();
+    NULL_CHK_HR(mediaPlayer, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+    return atlas->Remove(winrt::get_self<impl::PlaybackManager>(mediaPlayer));
+}
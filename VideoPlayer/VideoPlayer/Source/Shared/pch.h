@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <shared_mutex>
+#include <vector>
 
 #define WIN32_LEAN_AND_MEAN
 
@@ -13,6 +14,9 @@
 #include <winrt/base.h>
 #include <winrt/windows.foundation.h>
 #include <winrt/windows.foundation.collections.h>
+#include <winrt/Windows.storage.streams.h>
+
+#include "PluginTrace.h"
 
 #ifndef IFR
 #define IFR(hresult) { HRESULT hrTest = hresult; if (FAILED(hrTest)) { return hrTest; } } 
@@ -30,18 +34,68 @@
 #define IFG(result, marker) { HRESULT hrTest = result; if (FAILED(hrTest)) { hr = hrTest; goto marker; } }
 #endif
 
+struct __declspec(uuid("905a0fef-bc53-11df-8c49-001e4fc686da")) IBufferByteAccess : ::IUnknown
+{
+    virtual HRESULT __stdcall Buffer(uint8_t** value) = 0;
+};
+
+struct CustomBuffer : winrt::implements<CustomBuffer, winrt::Windows::Storage::Streams::IBuffer, ::IBufferByteAccess>
+{
+    std::vector<uint8_t> m_buffer;
+    uint32_t m_length{};
+
+    CustomBuffer(uint32_t size) :
+        m_buffer(size)
+    {
+    }
+
+    uint32_t Capacity() const
+    {
+        return static_cast<uint32_t>(m_buffer.size());
+    }
+
+    uint32_t Length() const
+    {
+        return m_length;
+    }
+
+    void Length(uint32_t value)
+    {
+        if (value > m_buffer.size())
+        {
+            throw winrt::hresult_invalid_argument();
+        }
+
+        m_length = value;
+    }
+
+    HRESULT __stdcall Buffer(uint8_t** value) final
+    {
+        *value = m_buffer.data();
+        return S_OK;
+    }
+};
+
 typedef int32_t INSTANCE_HANDLE;
 
 #ifndef INSTANCE_HANDLE_INVALID
 #define INSTANCE_HANDLE_INVALID static_cast<INSTANCE_HANDLE>(0x0bad)
 #define INSTANCE_HANDLE_START static_cast<INSTANCE_HANDLE>(0x0bae)
+
+// a render event for this handle is for every live instance
+#define INSTANCE_HANDLE_BROADCAST static_cast<INSTANCE_HANDLE>(0)
 #endif // INSTANCE_HANDLE_INVALID
 
 typedef enum class _CallbackType : int32_t
 {
     None = 0,
     Failed,
-    VideoPlayer
+    VideoPlayer,
+    VideoFrame,
+    BitrateChanged,
+    ReadbackFrame,
+    CueEntered,
+    CueExited
 } CallbackType;
 
 typedef struct _FAILED_STATE
@@ -58,8 +112,44 @@ typedef enum class _MediaPlayerState : int32_t
     Paused,
     Opened,
     Ended,
+    Prerolled,  // MediaPlayerPreroll's first frame is in the frame buffers, shown from the next render event
 } MediaPlayerState;
 
+typedef enum class _SeekMode : int32_t
+{
+    Accurate = 0,   // lands on the requested frame
+    Keyframe        // for scrubbing, only the newest request is kept while a seek is running
+} SeekMode;
+
+// encoded access units handed to MediaPlayerPushSample
+typedef enum class _StreamCodec : int32_t
+{
+    H264 = 0,
+    Hevc
+} StreamCodec;
+
+// the pixel format of the playback texture and outputs, the wider ones keep a 10 bit decode
+// from being quantized to 8 bits
+typedef enum class _OutputFormat : int32_t
+{
+    Bgra8 = 0,  // DXGI_FORMAT_B8G8R8A8_UNORM
+    Rgb10A2,    // DXGI_FORMAT_R10G10B10A2_UNORM
+    Rgba16F     // DXGI_FORMAT_R16G16B16A16_FLOAT
+} OutputFormat;
+
+// colour description and hdr10 mastering metadata of the video stream, 0 when the stream has none,
+// the enums are the MFVideoPrimaries, MFVideoTransferFunction and MFNominalRange values
+typedef struct _VIDEO_COLOR_INFO
+{
+    uint32_t primaries;                 // MFVideoPrimaries_BT2020 for hdr10
+    uint32_t transferFunction;          // MFVideoTransFunc_2084 for hdr10
+    uint32_t nominalRange;
+    uint32_t maxMasteringLuminance;     // nits
+    uint32_t minMasteringLuminance;     // 1/10000 nits
+    uint32_t maxContentLightLevel;      // nits
+    uint32_t maxFrameAverageLightLevel; // nits
+} VIDEO_COLOR_INFO;
+
 typedef struct _PLAYBACK_STATE
 {
     MediaPlayerState state;
@@ -67,8 +157,77 @@ typedef struct _PLAYBACK_STATE
     int32_t height;
     bool canSeek;
     int64_t duration;
+    void* texturePtr;   // opened with an auto sized texture, the srv to sample from now on
+    VIDEO_COLOR_INFO colorInfo; // set when opened
 } PLAYBACK_STATE;
 
+// a decoded frame landed in one of the frame buffers, it is left alone for the next count - 1 frames
+typedef struct _VIDEO_FRAME_STATE
+{
+    void* texturePtr;           // srv of the frame buffer
+    uint32_t bufferIndex;
+    int64_t presentationTime;   // playback position of the frame in 100ns units
+    int64_t systemTime;         // qpc ticks when the copy finished, the clock of Stopwatch.GetTimestamp
+} VIDEO_FRAME_STATE;
+
+// a decoded frame read back to the cpu, bgra rows of stride bytes, only valid during the callback
+typedef struct _READBACK_FRAME_STATE
+{
+    void* data;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    int64_t presentationTime;   // playback position of the frame in 100ns units
+} READBACK_FRAME_STATE;
+
+// an adaptive stream switched to another rendition, bits per second
+typedef struct _BITRATE_STATE
+{
+    uint32_t oldBitrate;
+    uint32_t newBitrate;
+    bool audioOnly;
+} BITRATE_STATE;
+
+// a cue of a subtitle or caption track became active or inactive, the text is only valid during the callback
+typedef struct _CUE_STATE
+{
+    wchar_t const* text;    // lines separated by \n, null for CueExited
+    uint32_t cueId;         // the same for a cue's CueEntered and CueExited
+    int64_t startTime;      // 100ns units
+    int64_t duration;
+    int32_t atlasRow;       // row of the caption atlas the cue is drawn in, -1 without one or when it's full
+} CUE_STATE;
+
+// timing of the newest frames, positions in 100ns units and system times in qpc ticks
+typedef struct _VIDEO_FRAME_INFO
+{
+    uint32_t frameCount;                // frames copied since the texture was created
+    int64_t presentationTime;           // position of the newest copied frame
+    int64_t systemTime;                 // when that frame's copy finished
+    int64_t renderPresentationTime;     // position of the frame in unity's texture
+    int64_t renderSystemTime;           // when the render thread copied it there, 0 until it did
+    double playbackRate;
+} VIDEO_FRAME_INFO;
+
+// counters since the content was loaded, the rates and the copy time are rolling averages over
+// the newest frames, 0 once no frame came for a second
+typedef struct _PLAYBACK_STATS
+{
+    uint64_t framesDecoded;             // frames the player raised VideoFrameAvailable for
+    uint64_t framesCopied;              // frames copied into the playback texture's buffers
+    uint64_t framesDropped;             // decoded but never copied, replaced before a render driven copy or no buffer to copy to
+    float decodedFramesPerSecond;
+    float copiedFramesPerSecond;
+    float averageCopyMilliseconds;      // cpu time of the copies of one frame, the video processor runs on the gpu after
+    float maxCopyMilliseconds;          // the longest copy since the content was loaded
+    double bufferingProgress;           // 0 to 1, PlaybackSession.BufferingProgress
+    double downloadProgress;            // 0 to 1, PlaybackSession.DownloadProgress
+    uint32_t bitrate;                   // bits per second of the current rendition or the clip's tracks, 0 when unknown
+    uint32_t copyHistoryFrames;         // copies the percentiles cover, up to STATS_HISTORY_FRAMES
+    float p50CopyMilliseconds;
+    float p99CopyMilliseconds;
+} PLAYBACK_STATS;
+
 #pragma pack(push, 4)
 typedef struct _CALLBACK_STATE
 {
@@ -77,6 +236,10 @@ typedef struct _CALLBACK_STATE
     {
         FAILED_STATE failedState;
         PLAYBACK_STATE playbackState;
+        VIDEO_FRAME_STATE videoFrameState;
+        BITRATE_STATE bitrateState;
+        READBACK_FRAME_STATE readbackFrameState;
+        CUE_STATE cueState;
     } value;
 } CALLBACK_STATE;
 #pragma pack(pop)
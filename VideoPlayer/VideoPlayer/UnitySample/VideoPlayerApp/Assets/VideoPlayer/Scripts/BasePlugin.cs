@@ -16,11 +16,25 @@ namespace VideoPlayer
 
         internal const Int32 InvalidHandle = 0x0bad;
 
+        // a render event for this handle services every live instance
+        internal const Int32 BroadcastHandle = 0;
+
+        // one render event a frame for all instances instead of one each
+        internal static bool BatchRenderEvents = true;
+
+        // the unity frame the broadcast render event was last issued in
+        internal static int LastBroadcastFrame = -1;
+
         internal enum CallbackType : Int32
         {
             None = 0,
             Failed,
             MediaPlayer,
+            VideoFrame,
+            BitrateChanged,
+            ReadbackFrame,
+            CueEntered,
+            CueExited,
         };
 
         internal enum MediaPlayerState : Int32
@@ -32,6 +46,26 @@ namespace VideoPlayer
             Paused,
             Opened,
             Ended,
+            Prerolled,
+        };
+
+        internal enum SeekMode : Int32
+        {
+            Accurate = 0,
+            Keyframe, // scrubbing, only the newest position is kept while a seek runs
+        };
+
+        internal enum StreamCodec : Int32
+        {
+            H264 = 0,
+            Hevc,
+        };
+
+        internal enum OutputFormat : Int32
+        {
+            Bgra8 = 0,
+            Rgb10A2,
+            Rgba16F,
         };
 
         [StructLayout(LayoutKind.Sequential)]
@@ -47,6 +81,33 @@ namespace VideoPlayer
             }
         };
 
+        // MFVideoPrimaries, MFVideoTransferFunction and MFNominalRange values, hdr10 mastering metadata
+        // in nits, the min mastering luminance in 1/10000 nits, 0 when the stream has none
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct ColorInfo
+        {
+            [MarshalAs(UnmanagedType.U4)] public UInt32 primaries;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 transferFunction;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 nominalRange;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 maxMasteringLuminance;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 minMasteringLuminance;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 maxContentLightLevel;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 maxFrameAverageLightLevel;
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("primaries: " + primaries);
+                sb.AppendLine("transferFunction: " + transferFunction);
+                sb.AppendLine("nominalRange: " + nominalRange);
+                sb.AppendLine("maxMasteringLuminance: " + maxMasteringLuminance);
+                sb.AppendLine("minMasteringLuminance: " + minMasteringLuminance);
+                sb.AppendLine("maxContentLightLevel: " + maxContentLightLevel);
+                sb.AppendLine("maxFrameAverageLightLevel: " + maxFrameAverageLightLevel);
+                return sb.ToString();
+            }
+        }
+
         [StructLayout(LayoutKind.Sequential)]
         internal struct PlaybackState
         {
@@ -55,6 +116,8 @@ namespace VideoPlayer
             [MarshalAs(UnmanagedType.I4)] public Int32 height;
             [MarshalAs(UnmanagedType.U1)] public Boolean canSeek;
             [MarshalAs(UnmanagedType.U8)] public UInt64 duration;
+            public IntPtr texturePtr; // set when an auto sized texture was created for the clip
+            public ColorInfo colorInfo; // set when opened
 
             public override string ToString()
             {
@@ -64,6 +127,156 @@ namespace VideoPlayer
                 sb.AppendLine("height: " + height);
                 sb.AppendLine("canSeek: " + canSeek);
                 sb.AppendLine("duration: " + duration);
+                if (state == MediaPlayerState.Opened)
+                {
+                    sb.Append(colorInfo);
+                }
+                return sb.ToString();
+            }
+        }
+
+        // the buffer stays untouched for the next frame buffer count - 1 frames
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct VideoFrameState
+        {
+            public IntPtr texturePtr;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 bufferIndex;
+            [MarshalAs(UnmanagedType.I8)] public Int64 presentationTime; // 100ns units
+            [MarshalAs(UnmanagedType.I8)] public Int64 systemTime; // Stopwatch.GetTimestamp ticks
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("bufferIndex: " + bufferIndex);
+                sb.AppendLine("presentationTime: " + presentationTime);
+                sb.AppendLine("systemTime: " + systemTime);
+                return sb.ToString();
+            }
+        }
+
+        // bgra rows of stride bytes, data is only valid while the callback runs on the player thread
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct ReadbackFrameState
+        {
+            public IntPtr data;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 width;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 height;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 stride;
+            [MarshalAs(UnmanagedType.I8)] public Int64 presentationTime; // 100ns units
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("width: " + width);
+                sb.AppendLine("height: " + height);
+                sb.AppendLine("stride: " + stride);
+                sb.AppendLine("presentationTime: " + presentationTime);
+                return sb.ToString();
+            }
+        }
+
+        // the caption atlas is CaptionAtlasRows rows of text stacked from the top, see CueState.atlasRow
+        internal const Int32 CaptionAtlasWidth = 1024;
+        internal const Int32 CaptionAtlasRowHeight = 64;
+        internal const Int32 CaptionAtlasRows = 8;
+
+        // a subtitle or caption cue, text is only valid while the callback runs, the app gets it as a string
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct CueState
+        {
+            public IntPtr text;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 cueId;
+            [MarshalAs(UnmanagedType.I8)] public Int64 startTime; // 100ns units
+            [MarshalAs(UnmanagedType.I8)] public Int64 duration;
+            [MarshalAs(UnmanagedType.I4)] public Int32 atlasRow; // -1 when not drawn into the atlas
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("cueId: " + cueId);
+                sb.AppendLine("startTime: " + startTime);
+                sb.AppendLine("duration: " + duration);
+                sb.AppendLine("atlasRow: " + atlasRow);
+                return sb.ToString();
+            }
+        }
+
+        // an adaptive stream switched renditions, bits per second
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct BitrateState
+        {
+            [MarshalAs(UnmanagedType.U4)] public UInt32 oldBitrate;
+            [MarshalAs(UnmanagedType.U4)] public UInt32 newBitrate;
+            [MarshalAs(UnmanagedType.U1)] public Boolean audioOnly;
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("oldBitrate: " + oldBitrate);
+                sb.AppendLine("newBitrate: " + newBitrate);
+                sb.AppendLine("audioOnly: " + audioOnly);
+                return sb.ToString();
+            }
+        }
+
+        // positions in 100ns units, system times in Stopwatch.GetTimestamp ticks
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct VideoFrameInfo
+        {
+            [MarshalAs(UnmanagedType.U4)] public UInt32 frameCount;
+            [MarshalAs(UnmanagedType.I8)] public Int64 presentationTime;
+            [MarshalAs(UnmanagedType.I8)] public Int64 systemTime;
+            [MarshalAs(UnmanagedType.I8)] public Int64 renderPresentationTime;
+            [MarshalAs(UnmanagedType.I8)] public Int64 renderSystemTime; // 0 until the render thread showed a frame
+            [MarshalAs(UnmanagedType.R8)] public Double playbackRate;
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("frameCount: " + frameCount);
+                sb.AppendLine("presentationTime: " + presentationTime);
+                sb.AppendLine("systemTime: " + systemTime);
+                sb.AppendLine("renderPresentationTime: " + renderPresentationTime);
+                sb.AppendLine("renderSystemTime: " + renderSystemTime);
+                sb.AppendLine("playbackRate: " + playbackRate);
+                return sb.ToString();
+            }
+        }
+
+        // counters since the content was loaded, rates and copy time are rolling averages over the newest frames
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct PlaybackStats
+        {
+            [MarshalAs(UnmanagedType.U8)] public UInt64 framesDecoded;
+            [MarshalAs(UnmanagedType.U8)] public UInt64 framesCopied;
+            [MarshalAs(UnmanagedType.U8)] public UInt64 framesDropped;
+            [MarshalAs(UnmanagedType.R4)] public Single decodedFramesPerSecond;
+            [MarshalAs(UnmanagedType.R4)] public Single copiedFramesPerSecond;
+            [MarshalAs(UnmanagedType.R4)] public Single averageCopyMilliseconds;
+            [MarshalAs(UnmanagedType.R4)] public Single maxCopyMilliseconds;
+            [MarshalAs(UnmanagedType.R8)] public Double bufferingProgress; // 0 to 1
+            [MarshalAs(UnmanagedType.R8)] public Double downloadProgress; // 0 to 1
+            [MarshalAs(UnmanagedType.U4)] public UInt32 bitrate; // bits per second, 0 when unknown
+            [MarshalAs(UnmanagedType.U4)] public UInt32 copyHistoryFrames; // copies the percentiles cover
+            [MarshalAs(UnmanagedType.R4)] public Single p50CopyMilliseconds;
+            [MarshalAs(UnmanagedType.R4)] public Single p99CopyMilliseconds;
+
+            public override string ToString()
+            {
+                StringBuilder sb = new StringBuilder();
+                sb.AppendLine("framesDecoded: " + framesDecoded);
+                sb.AppendLine("framesCopied: " + framesCopied);
+                sb.AppendLine("framesDropped: " + framesDropped);
+                sb.AppendLine("decodedFramesPerSecond: " + decodedFramesPerSecond);
+                sb.AppendLine("copiedFramesPerSecond: " + copiedFramesPerSecond);
+                sb.AppendLine("averageCopyMilliseconds: " + averageCopyMilliseconds);
+                sb.AppendLine("maxCopyMilliseconds: " + maxCopyMilliseconds);
+                sb.AppendLine("bufferingProgress: " + bufferingProgress);
+                sb.AppendLine("downloadProgress: " + downloadProgress);
+                sb.AppendLine("bitrate: " + bitrate);
+                sb.AppendLine("copyHistoryFrames: " + copyHistoryFrames);
+                sb.AppendLine("p50CopyMilliseconds: " + p50CopyMilliseconds);
+                sb.AppendLine("p99CopyMilliseconds: " + p99CopyMilliseconds);
                 return sb.ToString();
             }
         }
@@ -79,6 +292,18 @@ namespace VideoPlayer
 
             [FieldOffset(4)]
             public PlaybackState PlaybackState;
+
+            [FieldOffset(4)]
+            public VideoFrameState VideoFrameState;
+
+            [FieldOffset(4)]
+            public BitrateState BitrateState;
+
+            [FieldOffset(4)]
+            public ReadbackFrameState ReadbackFrameState;
+
+            [FieldOffset(4)]
+            public CueState CueState;
         };
 
         [UnmanagedFunctionPointer(CallingConvention.StdCall)]
@@ -90,6 +315,10 @@ namespace VideoPlayer
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "ReleaseInstance")]
         internal static extern void ReleaseInstance(Int32 instanceId);
 
+        // d3d11 debug layer on media devices created afterwards, on by default in debug plugin builds only
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetMediaDeviceDebugLayer")]
+        internal static extern void SetMediaDeviceDebugLayer([MarshalAs(UnmanagedType.I1)] Boolean enable);
+
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerCreatePlayer")]
         internal static extern Int32 CreateMediaPlayer([MarshalAs(UnmanagedType.FunctionPtr)]StateChangedCallback callback, IntPtr objectPtr, out Int32 instanceId);
     }
@@ -102,6 +331,8 @@ namespace VideoPlayer
         // instance returned from plugin
         protected Int32 instanceId = Wrapper.InvalidHandle;
 
+        internal Int32 InstanceId { get { return instanceId; } }
+
         // current frame index
         protected UInt16 currentFrameIndex = 0;
 
@@ -191,10 +422,28 @@ namespace VideoPlayer
 
                 if (instanceId != Wrapper.InvalidHandle && renderFuncPtr != IntPtr.Zero)
                 {
-                    // hi - lastFrameIndex / low - instanceId
-                    int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
+                    // the same for every plugin instance in a unity frame, grouped players present once per frame
+                    currentFrameIndex = (UInt16)Time.frameCount;
 
-                    GL.IssuePluginEvent(renderFuncPtr, packedValue);
+                    if (Wrapper.BatchRenderEvents)
+                    {
+                        // the first instance to get here issues the frame's event for all of them
+                        if (Wrapper.LastBroadcastFrame != Time.frameCount)
+                        {
+                            Wrapper.LastBroadcastFrame = Time.frameCount;
+
+                            int broadcastValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & Wrapper.BroadcastHandle);
+
+                            GL.IssuePluginEvent(renderFuncPtr, broadcastValue);
+                        }
+                    }
+                    else
+                    {
+                        // hi - lastFrameIndex / low - instanceId
+                        int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
+
+                        GL.IssuePluginEvent(renderFuncPtr, packedValue);
+                    }
                 }
             }
 
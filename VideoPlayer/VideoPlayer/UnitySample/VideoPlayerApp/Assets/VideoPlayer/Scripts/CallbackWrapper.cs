@@ -46,23 +46,52 @@ namespace VideoPlayer
             //var thisObject = (T)handle.Target;
             var thisObject = (PlaybackEngine)handle.Target;
 
+            // the frame is unmapped when this returns, it can't wait for the app thread
+            if (args.Type == Wrapper.CallbackType.ReadbackFrame)
+            {
+                thisObject.OnReadbackFrame(args.ReadbackFrameState);
+
+                return;
+            }
+
+            // the text goes away with the callback, it's copied before going to the app thread
+            if (args.Type == Wrapper.CallbackType.CueEntered || args.Type == Wrapper.CallbackType.CueExited)
+            {
+                String text = args.CueState.text != IntPtr.Zero ? Marshal.PtrToStringUni(args.CueState.text) : null;
+
+                RunOnAppThread(() =>
+                {
+                    thisObject.OnCue(args.Type, args.CueState, text);
+                });
+
+                return;
+            }
+
             // complete callback
+            RunOnAppThread(() =>
+            {
+                thisObject.OnStateChanged(args);
+            });
+        }
+
+        private static void RunOnAppThread(Action action)
+        {
 #if UNITY_WSA_10_0
             if (!UnityEngine.WSA.Application.RunningOnAppThread())
             {
                 UnityEngine.WSA.Application.InvokeOnAppThread(() =>
                 {
-                    thisObject.OnStateChanged(args);
+                    action();
                 }, false);
             }
             else
             {
-                thisObject.OnStateChanged(args);
+                action();
             }
 #else
             // there is still a chance the callback is on a non AppThread(callbacks genereated from WaitForEndOfFrame are not)
             // this will process the callback on AppThread on a FixedUpdate
-            thisObject.OnStateChanged(args);
+            action();
 #endif
         }
     }
@@ -2,6 +2,7 @@
 using System.Collections;
 using System.Collections.Generic;
 using System.Runtime.InteropServices;
+using System.Threading.Tasks;
 using UnityEngine;
 
 namespace VideoPlayer
@@ -16,7 +17,71 @@ namespace VideoPlayer
         public Int32 textureWidth = 1920;
         public Int32 textureHeight = 1080;
 
+        // size the texture to each clip when it opens, bounded by the max values, 0 is unbounded
+        public bool autoTextureSize = false;
+        public Int32 maxTextureWidth = 0;
+        public Int32 maxTextureHeight = 0;
+
+        // bits per second for hls and dash content, 0 leaves it to the stream, the max then follows the texture size
+        public UInt32 initialBitrate = 0;
+        public UInt32 minBitrate = 0;
+        public UInt32 maxBitrate = 0;
+
+        // raised when an hls or dash stream switches rendition
+        public event Action<Wrapper.BitrateState> BitrateChanged;
+
+        // full mip chain generated every frame, for quads that are far away or seen at an angle
+        public bool mipmaps = false;
+
+        // Rgb10A2 or Rgba16F keep the precision of hdr10 and other 10 bit streams
+        public Wrapper.OutputFormat outputFormat = Wrapper.OutputFormat.Bgra8;
+
+        // every frame scaled to readbackWidth x readbackHeight in cpu memory, see ReadbackFrameReceived
+        public bool readback = false;
+        public Int32 readbackWidth = 960;
+        public Int32 readbackHeight = 540;
+
+        // frames copied on unity's render thread once per rendered frame instead of for every decoded one
+        public bool renderDriven = false;
+
+        // raised on the player thread, the render thread with renderDriven, copy the data out before
+        // returning, e.g. with Marshal.Copy
+        public event Action<Wrapper.ReadbackFrameState> ReadbackFrameReceived;
+
+        // the newest decoded frames kept so StepBackward doesn't decode from the last keyframe, 0 to 240,
+        // frameCacheMegabytes caps the gpu memory, 0 is no cap
+        public Int32 frameCacheFrames = 0;
+        public Int32 frameCacheMegabytes = 256;
+
+        // caption cues of the clip, with captionAtlas they are also drawn into CaptionAtlasTexture
+        public event Action<Wrapper.CueState, String> CueEntered;
+        public event Action<Wrapper.CueState> CueExited;
+        public bool captionAtlas = false;
+
+        // CaptionAtlasRows rows, GetCaptionAtlasRect gives the part a cue was drawn in
+        public Texture2D CaptionAtlasTexture { get; private set; }
+
+        // the clip's audio is pulled with ReadAudio, e.g. from OnAudioFilterRead of a spatialized
+        // AudioSource, instead of playing from the player, audioTapMilliseconds is buffered at most
+        public bool audioTap = false;
+        public Int32 audioTapMilliseconds = 200;
+
+        // the media device and the player are created on a worker thread, the clip opens paused with
+        // its first frame in the texture, FirstFrameReady is raised then and Play starts right away
+        public bool preroll = false;
+        public event Action FirstFrameReady;
+
+        // releases the decoder and the gpu buffers while no camera sees the renderer, see Suspend
+        public bool suspendWhenInvisible = false;
+
+        // buffers the decoder writes round robin, 2 to 8
+        public Int32 frameBufferCount = 2;
+
+        // the newest frame the plugin reported
+        public Int64 PresentationTime { get; private set; }
+
         private Texture2D playbackTexture = null;
+        private Task<Int32> prepareTask = null;
 
         protected override void Awake()
         {
@@ -49,18 +114,86 @@ namespace VideoPlayer
 
             CreateMediaPlayer();
 
-            // create native texture for playback
+            CheckHR(Native.SetFrameBufferCount(instanceId, frameBufferCount));
+
+            CheckHR(Native.SetAutoTextureSize(instanceId, autoTextureSize, maxTextureWidth, maxTextureHeight));
+
+            CheckHR(Native.SetBitrateLimits(instanceId, initialBitrate, minBitrate, maxBitrate));
+
+            CheckHR(Native.SetMipmaps(instanceId, mipmaps));
+
+            CheckHR(Native.SetRenderDriven(instanceId, renderDriven));
+
+            CheckHR(Native.SetOutputFormat(instanceId, outputFormat));
+
+            if (preroll)
+            {
+                PrepareAndOpen();
+
+                return;
+            }
+
+            OpenContent();
+        }
+
+        // the slow part of the first load off the main thread, nothing else calls into the player meanwhile
+        private async void PrepareAndOpen()
+        {
+            Int32 id = instanceId;
+
+            prepareTask = Task.Run(() => Native.Prepare(id));
+
+            Int32 hr = await prepareTask;
+
+            prepareTask = null;
+
+            if (instanceId != id || !isActiveAndEnabled)
+            {
+                return;
+            }
+
+            CheckHR(hr);
+
+            OpenContent();
+        }
+
+        private void OpenContent()
+        {
+            // create native texture for playback, with auto size it is replaced once the clip opens
             IntPtr nativeTexture = IntPtr.Zero;
             CheckHR(Native.CreatePlaybackTexture(instanceId, textureWidth, textureHeight, out nativeTexture));
 
-            // create the unity texture2d 
-            this.playbackTexture = Texture2D.CreateExternalTexture(textureWidth, textureWidth, TextureFormat.BGRA32, false, false, nativeTexture);
+            SetPlaybackTexture(textureWidth, textureHeight, nativeTexture);
 
-            // set texture for the shader
-            if (playbackRenderer != null)
+            if (captionAtlas)
             {
-                playbackRenderer.material.SetTexture("_MainTex", this.playbackTexture);
-                playbackRenderer.material.SetTextureScale("_MainTex", new Vector2(1, -1));
+                IntPtr atlasTexture = IntPtr.Zero;
+                if (CheckHR(Native.SetCaptionAtlas(instanceId, true, out atlasTexture)) == 0)
+                {
+                    CaptionAtlasTexture = Texture2D.CreateExternalTexture(Wrapper.CaptionAtlasWidth, Wrapper.CaptionAtlasRowHeight * Wrapper.CaptionAtlasRows, TextureFormat.BGRA32, false, false, atlasTexture);
+                }
+            }
+
+            if (readback)
+            {
+                CheckHR(Native.SetReadback(instanceId, true, readbackWidth, readbackHeight));
+            }
+
+            if (frameCacheFrames > 0)
+            {
+                CheckHR(Native.SetFrameCache(instanceId, frameCacheFrames, frameCacheMegabytes));
+            }
+
+            if (audioTap)
+            {
+                CheckHR(Native.SetAudioTap(instanceId, true, audioTapMilliseconds));
+            }
+
+            if (preroll)
+            {
+                CheckHR(Native.Preroll(instanceId, VideoPath));
+
+                return;
             }
 
             CheckHR(Native.LoadContent(instanceId, VideoPath));
@@ -70,16 +203,333 @@ namespace VideoPlayer
 
         protected override void OnDisable()
         {
+            // the player can't be released under the worker
+            if (prepareTask != null)
+            {
+                prepareTask.Wait();
+                prepareTask = null;
+            }
+
+            CheckHR(Native.Resume(instanceId));
+
             CheckHR(Native.Stop(instanceId));
 
             base.OnDisable();
         }
 
+        // only sent when this is on the renderer's game object
+        private void OnBecameInvisible()
+        {
+            if (suspendWhenInvisible)
+            {
+                Suspend();
+            }
+        }
+
+        private void OnBecameVisible()
+        {
+            if (suspendWhenInvisible)
+            {
+                Resume();
+            }
+        }
+
         protected override void OnCallback(Wrapper.CallbackType type, Wrapper.CallbackState args)
         {
+            if (type == Wrapper.CallbackType.VideoFrame)
+            {
+                PresentationTime = args.VideoFrameState.presentationTime;
+
+                return;
+            }
+
+            if (type == Wrapper.CallbackType.BitrateChanged)
+            {
+                BitrateChanged?.Invoke(args.BitrateState);
+
+                return;
+            }
+
+            if (args.PlaybackState.state == Wrapper.MediaPlayerState.Prerolled)
+            {
+                FirstFrameReady?.Invoke();
+
+                return;
+            }
+
+            if (args.PlaybackState.texturePtr != IntPtr.Zero && (this.playbackTexture == null || this.playbackTexture.GetNativeTexturePtr() != args.PlaybackState.texturePtr))
+            {
+                SetPlaybackTexture(args.PlaybackState.width, args.PlaybackState.height, args.PlaybackState.texturePtr);
+            }
+
             Debug.Log(args.PlaybackState);
         }
+
+        internal void OnCue(Wrapper.CallbackType type, Wrapper.CueState state, String text)
+        {
+            if (type == Wrapper.CallbackType.CueEntered)
+            {
+                var handler = CueEntered;
+                if (handler != null)
+                {
+                    handler(state, text);
+                }
+            }
+            else
+            {
+                var handler = CueExited;
+                if (handler != null)
+                {
+                    handler(state);
+                }
+            }
+        }
+
+        // uv rect of a cue's row in CaptionAtlasTexture, the native texture isn't flipped so the height is
+        // negative, the same as the -1 texture scale of the playback texture
+        public Rect GetCaptionAtlasRect(Int32 atlasRow)
+        {
+            float rowHeight = 1.0f / Wrapper.CaptionAtlasRows;
+
+            return new Rect(0.0f, (atlasRow + 1) * rowHeight, 1.0f, -rowHeight);
+        }
+
+        internal void OnReadbackFrame(Wrapper.ReadbackFrameState state)
+        {
+            var handler = ReadbackFrameReceived;
+            if (handler != null)
+            {
+                handler(state);
+            }
+        }
+
+        private void SetPlaybackTexture(Int32 width, Int32 height, IntPtr nativeTexture)
+        {
+            // create the unity texture2d 
+            this.playbackTexture = CreateExternalTexture(width, height, nativeTexture);
+
+            // set texture for the shader
+            if (playbackRenderer != null)
+            {
+                playbackRenderer.material.SetTexture("_MainTex", this.playbackTexture);
+                playbackRenderer.material.SetTextureScale("_MainTex", new Vector2(1, -1));
+            }
+        }
 		
+        // opened in the background and played right after the current clip, relative paths are under RootVideoFolder
+        public void QueueContent(String path)
+        {
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return;
+            }
+
+            if (!System.IO.Path.IsPathRooted(path))
+            {
+                path = (RootVideoFolder + path).Replace("/", "\\");
+            }
+
+            CheckHR(Native.QueueContent(instanceId, path));
+        }
+
+        public void SkipToNext()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SkipToNext(instanceId));
+            }
+        }
+
+        public void Seek(TimeSpan position, Wrapper.SeekMode mode = Wrapper.SeekMode.Accurate)
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.Seek(instanceId, position.Ticks, mode));
+            }
+        }
+
+        public void SetPlaybackRate(Double rate)
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetPlaybackRate(instanceId, rate));
+            }
+        }
+
+        public void Play()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.Play(instanceId));
+            }
+        }
+
+        public void Pause()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.Pause(instanceId));
+            }
+        }
+
+        // the texture keeps the last frame, the clip reopens where it was on Resume
+        public void Suspend()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.Suspend(instanceId));
+            }
+        }
+
+        public void Resume()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.Resume(instanceId));
+            }
+        }
+
+        // the tap's format once the clip's audio runs, set the AudioSource up to match
+        public bool GetAudioFormat(out UInt32 sampleRate, out UInt32 channelCount)
+        {
+            sampleRate = 0;
+            channelCount = 0;
+
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return false;
+            }
+
+            return Native.GetAudioFormat(instanceId, out sampleRate, out channelCount) == 0;
+        }
+
+        // call from OnAudioFilterRead, returns the number of samples copied
+        public int ReadAudio(float[] data, out Int64 timestamp)
+        {
+            timestamp = 0;
+
+            UInt32 samplesRead = 0;
+            if (instanceId == Wrapper.InvalidHandle || Native.ReadAudio(instanceId, data, (UInt32)data.Length, out timestamp, out samplesRead) != 0)
+            {
+                return 0;
+            }
+
+            return (int)samplesRead;
+        }
+
+        // paused playback only, a cached frame shows right away
+        public void StepForward()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.StepForward(instanceId));
+            }
+        }
+
+        public void StepBackward()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.StepBackward(instanceId));
+            }
+        }
+
+        // plays encoded access units handed to PushSample, e.g. h.264 received over a websocket, instead of VideoPath
+        public void OpenStream(Wrapper.StreamCodec codec, Int32 width, Int32 height)
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.OpenStream(instanceId, codec, width, height));
+            }
+        }
+
+        // one access unit with its start codes, copied before the call returns, times in 100ns units
+        public bool PushSample(byte[] data, Int32 length, Int64 timestamp, Int64 duration, bool keyFrame)
+        {
+            if (instanceId == Wrapper.InvalidHandle || data == null || length <= 0 || length > data.Length)
+            {
+                return false;
+            }
+
+            // fails while the decoder is behind, the caller picks what to drop
+            return CheckHR(Native.PushSample(instanceId, data, (UInt32)length, timestamp, duration, keyFrame)) == 0;
+        }
+
+        public void EndStream()
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.EndStream(instanceId));
+            }
+        }
+
+        // another texture of its own size showing the same decode, e.g. a thumbnail of the video wall, null when it failed
+        public Texture2D AddOutput(Int32 width, Int32 height, out UInt32 outputId)
+        {
+            outputId = 0;
+
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return null;
+            }
+
+            IntPtr nativeTexture = IntPtr.Zero;
+            if (CheckHR(Native.AddOutput(instanceId, width, height, out nativeTexture, out outputId)) != 0)
+            {
+                return null;
+            }
+
+            return CreateExternalTexture(width, height, nativeTexture);
+        }
+
+        private Texture2D CreateExternalTexture(Int32 width, Int32 height, IntPtr nativeTexture)
+        {
+            // unity has no 10 bit TextureFormat, the native srv decides how the texture is sampled
+            TextureFormat format = outputFormat == Wrapper.OutputFormat.Rgba16F ? TextureFormat.RGBAHalf : TextureFormat.BGRA32;
+
+            Texture2D texture = Texture2D.CreateExternalTexture(width, height, format, mipmaps, outputFormat != Wrapper.OutputFormat.Bgra8, nativeTexture);
+            if (mipmaps)
+            {
+                texture.filterMode = FilterMode.Trilinear;
+            }
+
+            return texture;
+        }
+
+        public void RemoveOutput(UInt32 outputId)
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.RemoveOutput(instanceId, outputId));
+            }
+        }
+
+        // timing of the newest decoded and rendered frames, for measuring presentation latency
+        public bool GetFrameInfo(out Wrapper.VideoFrameInfo frameInfo)
+        {
+            frameInfo = default(Wrapper.VideoFrameInfo);
+
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return false;
+            }
+
+            return CheckHR(Native.GetFrameInfo(instanceId, out frameInfo)) == 0;
+        }
+
+        // cheap enough to call every frame, e.g. from Update
+        public bool GetStats(out Wrapper.PlaybackStats stats)
+        {
+            stats = default(Wrapper.PlaybackStats);
+
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return false;
+            }
+
+            return CheckHR(Native.GetStats(instanceId, out stats)) == 0;
+        }
+
         private void CreateMediaPlayer()
         {
             IntPtr thisObjectPtr = GCHandle.ToIntPtr(thisObject);
@@ -94,6 +544,12 @@ namespace VideoPlayer
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerLoadContent")]
             internal static extern Int32 LoadContent(Int32 instanceId, [MarshalAs(UnmanagedType.BStr)] String contentLocation);
 
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerPrepare")]
+            internal static extern Int32 Prepare(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerPreroll")]
+            internal static extern Int32 Preroll(Int32 instanceId, [MarshalAs(UnmanagedType.BStr)] String contentLocation);
+
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerPlay")]
             internal static extern Int32 Play(Int32 instanceId);
 
@@ -102,6 +558,88 @@ namespace VideoPlayer
 
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerStop")]
             internal static extern Int32 Stop(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetFrameBufferCount")]
+            internal static extern Int32 SetFrameBufferCount(Int32 instanceId, Int32 bufferCount);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGetFrameInfo")]
+            internal static extern Int32 GetFrameInfo(Int32 instanceId, out Wrapper.VideoFrameInfo frameInfo);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGetStats")]
+            internal static extern Int32 GetStats(Int32 instanceId, out Wrapper.PlaybackStats stats);
+
+            // 100ns units
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSeek")]
+            internal static extern Int32 Seek(Int32 instanceId, Int64 position, Wrapper.SeekMode mode);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetPlaybackRate")]
+            internal static extern Int32 SetPlaybackRate(Int32 instanceId, Double rate);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerQueueContent")]
+            internal static extern Int32 QueueContent(Int32 instanceId, [MarshalAs(UnmanagedType.BStr)] String contentLocation);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSkipToNext")]
+            internal static extern Int32 SkipToNext(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetAutoTextureSize")]
+            internal static extern Int32 SetAutoTextureSize(Int32 instanceId, [MarshalAs(UnmanagedType.I1)] Boolean enable, Int32 maxWidth, Int32 maxHeight);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetBitrateLimits")]
+            internal static extern Int32 SetBitrateLimits(Int32 instanceId, UInt32 initialBitrate, UInt32 minBitrate, UInt32 maxBitrate);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerAddOutput")]
+            internal static extern Int32 AddOutput(Int32 instanceId, Int32 width, Int32 height, out IntPtr outputTexture, out UInt32 outputId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerRemoveOutput")]
+            internal static extern Int32 RemoveOutput(Int32 instanceId, UInt32 outputId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetMipmaps")]
+            internal static extern Int32 SetMipmaps(Int32 instanceId, [MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetOutputFormat")]
+            internal static extern Int32 SetOutputFormat(Int32 instanceId, Wrapper.OutputFormat format);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerOpenStream")]
+            internal static extern Int32 OpenStream(Int32 instanceId, Wrapper.StreamCodec codec, Int32 width, Int32 height);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerPushSample")]
+            internal static extern Int32 PushSample(Int32 instanceId, byte[] data, UInt32 size, Int64 timestamp, Int64 duration, [MarshalAs(UnmanagedType.I1)] Boolean keyFrame);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerEndStream")]
+            internal static extern Int32 EndStream(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetReadback")]
+            internal static extern Int32 SetReadback(Int32 instanceId, [MarshalAs(UnmanagedType.I1)] Boolean enable, Int32 width, Int32 height);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetFrameCache")]
+            internal static extern Int32 SetFrameCache(Int32 instanceId, Int32 maxFrames, Int32 maxMegabytes);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerStepForward")]
+            internal static extern Int32 StepForward(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerStepBackward")]
+            internal static extern Int32 StepBackward(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetRenderDriven")]
+            internal static extern Int32 SetRenderDriven(Int32 instanceId, [MarshalAs(UnmanagedType.I1)] Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSuspend")]
+            internal static extern Int32 Suspend(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerResume")]
+            internal static extern Int32 Resume(Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetCaptionAtlas")]
+            internal static extern Int32 SetCaptionAtlas(Int32 instanceId, [MarshalAs(UnmanagedType.I1)] Boolean enable, out System.IntPtr atlasTexture);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerSetAudioTap")]
+            internal static extern Int32 SetAudioTap(Int32 instanceId, [MarshalAs(UnmanagedType.I1)] Boolean enable, Int32 milliseconds);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGetAudioFormat")]
+            internal static extern Int32 GetAudioFormat(Int32 instanceId, out UInt32 sampleRate, out UInt32 channelCount);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerReadAudio")]
+            internal static extern Int32 ReadAudio(Int32 instanceId, [Out] float[] samples, UInt32 count, out Int64 timestamp, out UInt32 samplesRead);
         }
     }
 }
\ No newline at end of file
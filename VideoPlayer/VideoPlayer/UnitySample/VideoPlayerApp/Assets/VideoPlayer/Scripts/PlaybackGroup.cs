@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using UnityEngine;
+
+namespace VideoPlayer
+{
+    // players share one clock and flip their textures in the same frame, for video walls
+    internal class PlaybackGroup : MonoBehaviour
+    {
+        public List<PlaybackEngine> players = new List<PlaybackEngine>();
+
+        private Int32 groupId = Wrapper.InvalidHandle;
+
+        // after every player's OnEnable created its instance
+        private void Start()
+        {
+            if (BasePlugin<PlaybackEngine>.CheckHR(Native.CreateGroup(out groupId)) != 0)
+            {
+                groupId = Wrapper.InvalidHandle;
+
+                return;
+            }
+
+            foreach (var player in players)
+            {
+                if (player != null && player.InstanceId != Wrapper.InvalidHandle)
+                {
+                    BasePlugin<PlaybackEngine>.CheckHR(Native.AddPlayer(groupId, player.InstanceId));
+                }
+            }
+
+            Play();
+        }
+
+        private void OnDestroy()
+        {
+            if (groupId != Wrapper.InvalidHandle)
+            {
+                Native.ReleaseGroup(groupId);
+
+                groupId = Wrapper.InvalidHandle;
+            }
+        }
+
+        public void Play()
+        {
+            if (groupId != Wrapper.InvalidHandle)
+            {
+                BasePlugin<PlaybackEngine>.CheckHR(Native.Play(groupId));
+            }
+        }
+
+        public void Pause()
+        {
+            if (groupId != Wrapper.InvalidHandle)
+            {
+                BasePlugin<PlaybackEngine>.CheckHR(Native.Pause(groupId));
+            }
+        }
+
+        public void Seek(TimeSpan position)
+        {
+            if (groupId != Wrapper.InvalidHandle)
+            {
+                BasePlugin<PlaybackEngine>.CheckHR(Native.Seek(groupId, position.Ticks));
+            }
+        }
+
+        private static class Native
+        {
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerCreateGroup")]
+            internal static extern Int32 CreateGroup(out Int32 groupId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerReleaseGroup")]
+            internal static extern void ReleaseGroup(Int32 groupId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGroupAddPlayer")]
+            internal static extern Int32 AddPlayer(Int32 groupId, Int32 instanceId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGroupPlay")]
+            internal static extern Int32 Play(Int32 groupId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGroupPause")]
+            internal static extern Int32 Pause(Int32 groupId);
+
+            // 100ns units
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerGroupSeek")]
+            internal static extern Int32 Seek(Int32 groupId, Int64 position);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using UnityEngine;
+
+namespace VideoPlayer
+{
+    // players laid out in a grid of one texture, so a wall of thumbnails is one material and can
+    // batch, every player's textureWidth and textureHeight should be the tile size
+    internal class VideoAtlas : MonoBehaviour
+    {
+        public List<PlaybackEngine> players = new List<PlaybackEngine>();
+
+        public Int32 tileWidth = 320;
+        public Int32 tileHeight = 180;
+        public Int32 columns = 8;
+
+        // gets Texture as its main texture, the renderers use GetTileRect for their uvs
+        public Renderer atlasRenderer;
+
+        public Texture2D Texture { get; private set; }
+
+        private Int32 atlasId = Wrapper.InvalidHandle;
+        private Int32 rows = 0;
+
+        // after every player's OnEnable created its instance
+        private void Start()
+        {
+            rows = (players.Count + columns - 1) / columns;
+            if (rows == 0)
+            {
+                return;
+            }
+
+            IntPtr atlasTexture = IntPtr.Zero;
+            if (BasePlugin<PlaybackEngine>.CheckHR(Native.CreateAtlas(tileWidth * columns, tileHeight * rows, out atlasTexture, out atlasId)) != 0)
+            {
+                atlasId = Wrapper.InvalidHandle;
+
+                return;
+            }
+
+            Texture = Texture2D.CreateExternalTexture(tileWidth * columns, tileHeight * rows, TextureFormat.BGRA32, false, false, atlasTexture);
+
+            for (int i = 0; i < players.Count; ++i)
+            {
+                var player = players[i];
+                if (player != null && player.InstanceId != Wrapper.InvalidHandle)
+                {
+                    BasePlugin<PlaybackEngine>.CheckHR(Native.AddPlayer(atlasId, player.InstanceId, (i % columns) * tileWidth, (i / columns) * tileHeight));
+                }
+            }
+
+            if (atlasRenderer != null)
+            {
+                atlasRenderer.material.mainTexture = Texture;
+            }
+        }
+
+        private void OnDestroy()
+        {
+            if (atlasId != Wrapper.InvalidHandle)
+            {
+                Native.ReleaseAtlas(atlasId);
+
+                atlasId = Wrapper.InvalidHandle;
+            }
+        }
+
+        // the uv rect of a player's tile, flipped like the playback texture
+        public Rect GetTileRect(Int32 index)
+        {
+            if (rows == 0 || index < 0 || index >= players.Count)
+            {
+                return new Rect(0, 0, 0, 0);
+            }
+
+            float width = 1.0f / columns;
+            float height = 1.0f / rows;
+
+            return new Rect((index % columns) * width, ((index / columns) + 1) * height, width, -height);
+        }
+
+        private static class Native
+        {
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerCreateAtlas")]
+            internal static extern Int32 CreateAtlas(Int32 width, Int32 height, out System.IntPtr atlasTexture, out Int32 atlasId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerReleaseAtlas")]
+            internal static extern void ReleaseAtlas(Int32 atlasId);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "MediaPlayerAtlasAddPlayer")]
+            internal static extern Int32 AddPlayer(Int32 atlasId, Int32 instanceId, Int32 x, Int32 y);
+        }
+    }
+}